@@ -19,7 +19,9 @@
  ###########################################################*/
 
 #pragma once
-#include "MahonyAHRS.h"
+#include "biquad.h"
+#include "gyro_bias.h"
+#include "mahony.h"
 #include "main.h"
 //clang-format off
 #include "arm_math.h"
@@ -27,38 +29,104 @@
 namespace control {
     class AHRS {
       public:
-        AHRS(bool is_mag);
+        AHRS(bool is_mag, mahony_init_t init = MAHONY_DEFAULT_INIT,
+             gyro_bias_init_t bias_init = GYRO_BIAS_DEFAULT_INIT);
 
+        /**
+         * @brief 更新姿态
+         * @param dt 距离上一次更新的时间，单位为[s]
+         */
         void Update(float gx, float gy, float gz, float ax, float ay, float az, float mx, float my,
-                    float mz);
+                    float mz, float dt);
 
-        void Update(float gx, float gy, float gz, float ax, float ay, float az);
+        void Update(float gx, float gy, float gz, float ax, float ay, float az, float dt);
 
+        /**
+         * @brief 修改Mahony滤波的增益
+         */
+        void SetGain(mahony_init_t init);
+
+        /**
+         * @brief 重新开始估计陀螺仪零漂，不会阻塞姿态解算
+         */
+        /**
+         * @brief restart the gyro bias estimation, attitude fusion keeps running
+         */
         void Cailbrate();
 
+        /**
+         * @brief 判断零漂的置信度是否已经达到过1，调用Cailbrate()后重新判断
+         */
+        /**
+         * @brief check if the bias confidence has reached 1, cleared by Cailbrate()
+         */
         bool IsCailbrated();
 
+        /**
+         * @brief 获取零漂估计的置信度，范围为[0, 1]
+         */
+        /**
+         * @brief get the confidence of the bias estimation in the range [0, 1]
+         */
+        float GetBiasConfidence();
+
+        /**
+         * @brief 获取估计的陀螺仪零漂，单位为[rad/s]，可以保存下来作为下一次启动的先验
+         */
+        /**
+         * @brief get the estimated gyro bias in [rad/s], may be saved as the prior of the next boot
+         */
+        void GetGyroBias(float bias[3]);
+
+        /**
+         * @brief 设置陀螺仪零漂的先验
+         * @param bias       零漂，单位为[rad/s]
+         * @param confidence 先验的置信度，范围为[0, 1]
+         */
+        /**
+         * @brief set a prior of the gyro bias
+         * @param bias       bias in [rad/s]
+         * @param confidence confidence of the prior in the range [0, 1]
+         */
+        void SetGyroBiasPrior(const float bias[3], float confidence);
+
+        /**
+         * @brief 获取当前的姿态四元数，顺序为w, x, y, z
+         */
+        /**
+         * @brief get the current attitude quaternion in the order w, x, y, z
+         */
+        void GetQuaternion(float quat[4]);
+
+        /**
+         * @brief 获取扣除零漂后的角速度，单位为[rad/s]
+         */
+        /**
+         * @brief get the angular rate with the bias removed, in [rad/s]
+         */
+        void GetGyro(float gyro[3]);
+
         float INS_angle[3];
 
       private:
         float q[4];
-        float g_zerodrift[3] = {0};
+        Mahony mahony_;
+        GyroBiasEstimator bias_;
         bool is_mag_;
-        bool cailb_flag_;
         bool cailb_done_;
-        uint16_t calib_cnt_ = 0;
+        bool started_ = false;
         float accel_[3];
         float gyro_[3];
+        float rate_[3] = {0.0f, 0.0f, 0.0f};
         float mag_[3];
 
-        float accel_fliter_1[3] = {0.0f, 0.0f, 0.0f};
-        float accel_fliter_2[3] = {0.0f, 0.0f, 0.0f};
-        float accel_fliter_3[3] = {0.0f, 0.0f, 0.0f};
-        const float fliter_num[3] = {1.929454039488895f, -0.93178349823448126f,
-                                     0.002329458745586203f};
+        BiquadFilter<3> accel_filter_{ACCEL_LPF_COEFF};
+        float accel_filtered_[3] = {0.0f, 0.0f, 0.0f};
+
+        void Start(float ax, float ay, float az);
 
-        void CailbrateHandler(float gx, float gy, float gz, float ax, float ay, float az, float mx,
-                              float my, float mz);
+        // 用最新的原始数据更新零漂估计
+        void UpdateBias(float bias[3], float dt);
 
         void INSCalculate();
     };
@@ -19,25 +19,129 @@
  ###########################################################*/
 
 #pragma once
+#include "gyro_bias.h"
+#include "kalman.h"
 #include "main.h"
-//clang-format off
-#include "QuaternionEKF.h"
-#include "arm_math.h"
-//clang-format on
 namespace control {
 
     typedef float (*qekf_gettickoffset_t)(uint32_t* last_tick);  // refer to the dwt delay function
 
+    /**
+     * @brief 四元数EKF的参数
+     */
+    /**
+     * @brief parameters of the quaternion EKF
+     */
+    typedef struct {
+        float quaternion_noise;  /// 四元数的过程噪声
+        float bias_noise;        /// 陀螺仪零漂的过程噪声
+        float measure_noise;     /// 加速度计的观测噪声
+        float lambda;            /// 零漂方差的渐消因子，不大于1
+        float accel_lpf;         /// 加速度计一阶低通滤波的时间常数，单位为[s]，0表示不滤波
+    } qekf_init_t;
+
+    /**
+     * @brief 默认参数，与原来的QEKF相同
+     */
+    /**
+     * @brief default parameters, the same as the old QEKF
+     */
+    constexpr qekf_init_t QEKF_DEFAULT_INIT = {10, 0.001f, 10000000, 1, 0};
+
+    /**
+     * @brief 带陀螺仪零漂估计和卡方检验的四元数EKF
+     * @details 状态为四元数和x、y轴的陀螺仪零漂，观测为归一化的加速度。算法与
+     * third_party/QuaternionEKF相同，但是基于编译期维度的KalmanFilter实现，每个实例拥有自己的
+     * 状态，不再使用全局的QEKF_INS，也不需要动态内存
+     */
+    /**
+     * @brief quaternion EKF with gyro bias estimation and chi-square test
+     * @details the state is the quaternion plus the x and y gyro bias, the measurement is the
+     * normalized acceleration. The algorithm is the same as third_party/QuaternionEKF but built on
+     * the compile time sized KalmanFilter, so every instance owns its state instead of sharing the
+     * global QEKF_INS and nothing is allocated.
+     */
     class QEKF {
       public:
-        QEKF(qekf_gettickoffset_t gettickdelta);
+        /**
+         * @param gettickdelta 获取距离上一次调用的时间[s]的函数，只使用带dt的Update()时可以为空
+         * @param init         滤波器参数
+         * @param bias_init    陀螺仪零漂在线估计的参数
+         */
+        /**
+         * @param gettickdelta returns the time in [s] since its last call, may be null if only the
+         * Update() taking dt is used
+         * @param init         parameters of the filter
+         * @param bias_init    parameters of the online gyro bias estimator
+         */
+        QEKF(qekf_gettickoffset_t gettickdelta, qekf_init_t init = QEKF_DEFAULT_INIT,
+             gyro_bias_init_t bias_init = GYRO_BIAS_DEFAULT_INIT);
 
         void Update(float gx, float gy, float gz, float ax, float ay, float az);
 
+        /**
+         * @brief 使用给定的时间间隔更新
+         * @param dt 距离上一次更新的时间，单位为[s]
+         */
+        /**
+         * @brief update with a given time step
+         * @param dt time since the last update in [s]
+         */
+        void Update(float gx, float gy, float gz, float ax, float ay, float az, float dt);
+
+        /**
+         * @brief 重新开始估计陀螺仪零漂，不会阻塞姿态解算
+         */
+        /**
+         * @brief restart the gyro bias estimation, attitude fusion keeps running
+         */
         void Cailbrate();
 
+        /**
+         * @brief 判断零漂的置信度是否已经达到过1，调用Cailbrate()后重新判断
+         */
+        /**
+         * @brief check if the bias confidence has reached 1, cleared by Cailbrate()
+         */
         bool IsCailbrated();
 
+        /**
+         * @brief 获取零漂估计的置信度，范围为[0, 1]
+         */
+        /**
+         * @brief get the confidence of the bias estimation in the range [0, 1]
+         */
+        float GetBiasConfidence();
+
+        /**
+         * @brief 设置陀螺仪零漂的先验，例如上一次运行时由GetGyroBias()保存的值
+         * @param bias       零漂，单位为[rad/s]
+         * @param confidence 先验的置信度，范围为[0, 1]
+         */
+        /**
+         * @brief set a prior of the gyro bias, e.g. the value saved from GetGyroBias() last run
+         * @param bias       bias in [rad/s]
+         * @param confidence confidence of the prior in the range [0, 1]
+         */
+        void SetGyroBiasPrior(const float bias[3], float confidence);
+
+        /**
+         * @brief 获取姿态四元数，顺序为w, x, y, z
+         */
+        /**
+         * @brief get the attitude quaternion in the order of w, x, y, z
+         */
+        void GetQuaternion(float quaternion[4]) const;
+
+        /**
+         * @brief 获取估计的陀螺仪零漂，为静止时在线估计的零漂与EKF估计的x、y轴残差之和
+         */
+        /**
+         * @brief get the estimated gyro bias, the sum of the bias estimated online while stationary
+         * and the x and y residual estimated by the EKF
+         */
+        void GetGyroBias(float bias[3]) const;
+
         float INS_angle[3];
 
       private:
@@ -47,16 +151,22 @@ namespace control {
         float ticks_count_current_ = 0;
 
         float q[4];
-        float g_zerodrift[3] = {0};
-        bool cailb_flag_;
+        GyroBiasEstimator bias_;
         bool cailb_done_;
-        uint16_t calib_cnt_ = 0;
         float accel_[3];
         float gyro_[3];
 
-        void CailbrateHandler(float gx, float gy, float gz, float ax, float ay, float az, float mx,
-                              float my, float mz);
+        qekf_init_t param_;
+        KalmanFilter<6, 3> kf_;
+        float accel_filtered_[3] = {};
+        float gyro_bias_[3] = {};
+        float adaptive_gain_scale_ = 1;
+        uint32_t error_count_ = 0;
+        uint32_t update_count_ = 0;
+        bool converged_ = false;
+
+        void Filter(float gx, float gy, float gz, float ax, float ay, float az, float dt);
 
         void INSCalculate();
     };
-}  // namespace control
\ No newline at end of file
+}  // namespace control
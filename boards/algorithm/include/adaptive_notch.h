@@ -0,0 +1,186 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "biquad.h"
+
+namespace control {
+
+    /**
+     * @brief 自适应陷波滤波器的参数
+     */
+    /**
+     * @brief parameters of the adaptive notch filter
+     */
+    typedef struct {
+        float sample_rate;    /// 陀螺仪的采样频率，单位为[Hz]
+        float q;              /// 陷波的品质因数，等于陷波频率除以-3dB带宽
+        float min_frequency;  /// 频谱中搜索振动的最低频率，低于该值的陷波也会关闭，单位为[Hz]
+        float max_frequency;  /// 频谱中搜索振动的最高频率，单位为[Hz]
+        float peak_ratio;     /// 峰值功率至少为搜索范围内平均功率的倍数才认为存在振动
+        float smoothing;      /// 每次频谱分析后频率估计的一阶低通系数，范围为(0, 1]
+    } adaptive_notch_init_t;
+
+    /**
+     * @brief 1kHz陀螺仪的默认参数
+     */
+    /**
+     * @brief default parameters for a 1 kHz gyro
+     */
+    constexpr adaptive_notch_init_t ADAPTIVE_NOTCH_DEFAULT_INIT = {1000.0f, 5.0f, 40.0f,
+                                                                   450.0f,  20.0f, 0.5f};
+
+    /**
+     * @brief 用于陀螺仪的三轴自适应陷波滤波器
+     * @details 摩擦轮和底盘电机的振动会以窄带噪声的形式进入陀螺仪，再进入姿态解算和云台控制。
+     * 这里级联NOTCHES个陷波器，每个陷波器的频率可以在运行中修改，来源有两种：已知转速的电机
+     * 直接调用SetFrequency，例如摩擦轮的GetOmega() / 2π；未知的振动由Analyze从陀螺仪原始数据
+     * 的频谱中找出最强的峰。陷波器只在陷波频率附近衰减，控制频带内的相位滞后很小。
+     *
+     * Update在IMU中断或任务中每个样本调用一次，同时把原始数据写入FFT_LENGTH长的缓冲区；
+     * SetFrequency和Analyze在优先级更低的任务中调用，新的系数先放在一边，由下一次Update
+     * 换上，所以两边都不需要加锁，但是Update不能被它们打断
+     */
+    /**
+     * @brief three axis adaptive notch filter for the gyro
+     * @details vibration of the flywheel and chassis motors enters the gyro as narrowband noise
+     * and then the attitude estimation and the gimbal loop. Here NOTCHES notches are cascaded,
+     * each retunable at runtime from one of two sources: motors with a known speed call
+     * SetFrequency directly, e.g. with GetOmega() / 2π of a flywheel, while unknown vibration is
+     * found by Analyze as the strongest peak in the spectrum of the raw gyro data. A notch only
+     * attenuates around its frequency and adds little phase lag within the control bandwidth.
+     *
+     * Update is called once per sample from the IMU interrupt or task and also records the raw
+     * data into a buffer of FFT_LENGTH samples. SetFrequency and Analyze are called from lower
+     * priority tasks, the new coefficients are set aside and swapped in by the next Update, so
+     * neither side locks, but Update must not be preempted by them
+     */
+    class AdaptiveNotch {
+      public:
+        /**
+         * @brief 构造函数，所有陷波器都处于关闭状态
+         *
+         * @param init 滤波器参数
+         */
+        /**
+         * @brief constructor, every notch starts disabled
+         *
+         * @param init parameters of the filter
+         */
+        AdaptiveNotch(adaptive_notch_init_t init = ADAPTIVE_NOTCH_DEFAULT_INIT);
+
+        /**
+         * @brief 滤波一个样本
+         *
+         * @param input  三轴角速度，单位为[rad/s]
+         * @param output 滤波后的角速度，可以与input相同
+         */
+        /**
+         * @brief filter one sample
+         *
+         * @param input  angular rate of the three axes, in [rad/s]
+         * @param output filtered angular rate, may be the same as input
+         */
+        void Update(const float input[3], float output[3]);
+
+        /**
+         * @brief 设置一个陷波器的频率
+         *
+         * @param notch     陷波器的编号，范围为[0, NOTCHES)
+         * @param frequency 陷波频率，单位为[Hz]，低于min_frequency或者不低于奈奎斯特频率时关闭
+         */
+        /**
+         * @brief set the frequency of a notch
+         *
+         * @param notch     index of the notch in [0, NOTCHES)
+         * @param frequency notch frequency, in [Hz], disables the notch below min_frequency or at
+         *                  and above the Nyquist frequency
+         */
+        void SetFrequency(int notch, float frequency);
+
+        /**
+         * @brief 获取一个陷波器当前的频率，关闭时为0
+         */
+        /**
+         * @brief get the current frequency of a notch, 0 when disabled
+         */
+        float GetFrequency(int notch) const;
+
+        /**
+         * @brief 缓冲区满时分析频谱，用最强的振动频率调节一个陷波器
+         * @details 三轴数据加Hann窗后分别做实数FFT，功率谱相加后在[min_frequency,
+         * max_frequency]内找最大的峰，用对数抛物线插值得到小于一个频点的频率。峰值不够突出时
+         * 认为没有振动，连续几次之后关闭陷波器
+         *
+         * @param notch 由频谱分析调节的陷波器
+         *
+         * @return 缓冲区还没满时直接返回false
+         */
+        /**
+         * @brief analyze the spectrum once the buffer is full and tune a notch to the strongest
+         * vibration
+         * @details the three axes are Hann windowed and transformed with a real FFT each, and the
+         * strongest peak of the summed power within [min_frequency, max_frequency] is refined
+         * below a bin by log parabolic interpolation. A peak that does not stand out counts as no
+         * vibration, and the notch is disabled after a few of them in a row
+         *
+         * @param notch notch tuned by the spectrum analysis
+         *
+         * @return false straight away while the buffer is not full yet
+         */
+        bool Analyze(int notch);
+
+        static constexpr int NOTCHES = 2;
+        static constexpr int FFT_LENGTH = 256;
+
+      private:
+        void Spectrum();
+
+        adaptive_notch_init_t init_;
+        BiquadFilter<3, NOTCHES> filter_;
+        float frequency_[NOTCHES];
+
+        // 等待Update换上的系数 / coefficients waiting to be swapped in by Update
+        biquad_coeff_t pending_[NOTCHES];
+        std::atomic<uint32_t> pending_mask_;
+
+        // 由Update写入，写满后交给Analyze / written by Update and handed to Analyze when full
+        float buffer_[3][FFT_LENGTH];
+        int samples_;
+        std::atomic<bool> full_;
+
+        float work_[FFT_LENGTH];
+        float power_[FFT_LENGTH / 2];
+        // 每个陷波器连续没有找到振动的次数 / misses in a row of each notch
+        int misses_[NOTCHES];
+#ifdef BIQUAD_USE_CMSIS
+        float spectrum_[FFT_LENGTH];
+        arm_rfft_fast_instance_f32 rfft_;
+#else
+        float imag_[FFT_LENGTH];
+#endif
+    };
+
+}  // namespace control
@@ -0,0 +1,151 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#pragma once
+
+#include "main.h"
+
+namespace control {
+
+    /**
+     * @brief 线性自抗扰控制器的参数，采用带宽参数化，只需要整定b0、wc和wo
+     */
+    /**
+     * @brief parameters of a linear active disturbance rejection controller, bandwidth
+     * parameterized so only b0, wc and wo need tuning
+     */
+    typedef struct {
+        uint8_t order;  /// 被控对象的阶数，1：y' = f + b0*u，2：y'' = f + b0*u
+        float b0;       /// 控制增益的估计值，即单位输出产生的(角)加速度
+        float wc;       /// 控制器带宽，单位为[rad/s]
+        float wo;       /// 扩张状态观测器带宽，单位为[rad/s]，一般为wc的3~5倍
+        float max_out;  /// 输出限制
+    } adrc_init_t;
+
+    /**
+     * @brief 线性自抗扰控制器(LADRC)
+     * @details 扩张状态观测器(ESO)把模型误差、摩擦和外部扰动合并为一个总扰动f，和被控量一起估计，
+     * 控制律先抵消估计出的总扰动，再把被控对象当作纯积分器控制。一阶用于速度环，二阶直接从角度
+     * 计算电流，替代角度环和速度环串级。输出被限幅后，观测器使用限幅后的输出更新，不会积分饱和
+     * @note 观测器使用前向欧拉离散，wo*dt应小于0.5；测量有延迟时(例如CAN反馈)应适当降低wo。
+     * b0可以用电流阶跃测得：b0 ≈ 角加速度 / 电流输出，偏差30%以内观测器都可以补偿
+     */
+    /**
+     * @brief linear active disturbance rejection controller (LADRC)
+     * @details the extended state observer (ESO) lumps model error, friction and external
+     * disturbances into a single total disturbance f and estimates it together with the
+     * controlled variable. The control law cancels the estimated disturbance and then controls the
+     * plant as a pure integrator chain. First order is meant for speed loops, second order computes
+     * the current directly from the angle and replaces a cascaded angle and speed loop. The
+     * observer is updated with the clamped output so it never winds up.
+     * @note the observer uses forward Euler, keep wo*dt below 0.5 and lower wo when the measurement
+     * is delayed (e.g. CAN feedback). b0 can be measured with a current step: b0 ~ angular
+     * acceleration / output, the observer tolerates an error of about 30%.
+     */
+    class ADRC {
+      public:
+        /**
+         * @brief 构造函数
+         * @param init 控制器参数，阶数只能为1或2
+         */
+        /**
+         * @brief constructor
+         * @param init parameters of the controller, order must be 1 or 2
+         */
+        ADRC(adrc_init_t init);
+
+        /**
+         * @brief 修改控制器参数，观测器的状态保持不变
+         */
+        /**
+         * @brief change the parameters, the observer state is kept
+         */
+        void Reinit(adrc_init_t init);
+
+        /**
+         * @brief 清空观测器，下一次计算时从测量值重新开始
+         */
+        /**
+         * @brief clear the observer, it restarts from the measurement on the next computation
+         */
+        void Reset();
+
+        /**
+         * @brief 计算控制器输出
+         * @param target  目标值
+         * @param measure 测量值
+         * @param dt      距离上一次计算的时间，单位为[s]
+         * @return 限幅后的输出
+         */
+        /**
+         * @brief compute the output of the controller
+         * @param target  target value
+         * @param measure measured value
+         * @param dt      time since the last computation in [s]
+         * @return clamped output
+         */
+        float ComputeOutput(float target, float measure, float dt);
+
+        /**
+         * @brief 计算控制器输出，同时给出目标值的变化率作为前馈
+         * @param target      目标值
+         * @param target_rate 目标值的变化率，例如轨迹生成器给出的速度
+         * @param measure     测量值
+         * @param dt          距离上一次计算的时间，单位为[s]
+         * @return 限幅后的输出
+         */
+        /**
+         * @brief compute the output of the controller with the rate of the target as feedforward
+         * @param target      target value
+         * @param target_rate rate of change of the target, e.g. velocity from a trajectory
+         * @param measure     measured value
+         * @param dt          time since the last computation in [s]
+         * @return clamped output
+         */
+        float ComputeOutput(float target, float target_rate, float measure, float dt);
+
+        /**
+         * @brief 获取观测器的状态估计
+         * @param index 0为被控量，1为被控量的导数(二阶)或总扰动(一阶)，2为总扰动(二阶)
+         */
+        /**
+         * @brief get an estimate from the observer
+         * @param index 0 is the controlled variable, 1 is its derivative (second order) or the
+         * total disturbance (first order), 2 is the total disturbance (second order)
+         */
+        float GetEstimate(uint8_t index) const;
+
+        /**
+         * @brief 获取估计的总扰动换算成的输出，即抵消扰动所需要的输出
+         */
+        /**
+         * @brief get the estimated total disturbance in output units, i.e. the output needed to
+         * cancel it
+         */
+        float GetDisturbance() const;
+
+      private:
+        adrc_init_t param_;
+        float z_[3] = {};
+        float output_ = 0;
+        bool ready_ = false;
+    };
+
+}  // namespace control
@@ -0,0 +1,143 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+namespace control {
+
+    /**
+     * @brief 带时间戳的姿态历史，用于查询过去任意时刻的姿态
+     * @details 视觉需要相机曝光时刻的云台姿态，而姿态解算只给出最新的结果。IMU任务每次解算后
+     * 调用Push写入四元数和角速度，其他任务调用Query查询窗口内任意时刻的姿态，四元数用球面
+     * 线性插值，角速度用线性插值。
+     *
+     * 只允许一个写者，读者数量不限，都不加锁：每个格子带一个序号，写入前清零、写完后置为
+     * 样本的编号，读者读取前后序号一致且等于期望的编号时数据才有效，否则说明读取过程中被写者
+     * 覆盖，重新查找。写者可以在中断中调用，读者被打断不会影响写者。时间都以[us]为单位
+     */
+    /**
+     * @brief timestamped attitude history to look up the attitude at any past time
+     * @details vision needs the gimbal attitude at the camera exposure, while the attitude
+     * estimators only hold the latest result. The IMU task calls Push after every update to write
+     * the quaternion and the angular rate, and other tasks call Query for the attitude at any time
+     * within the window, with the quaternion spherically and the rate linearly interpolated.
+     *
+     * There is a single writer and any number of readers, none of them locks: every slot carries
+     * a sequence that is cleared before the write and set to the index of the sample after it. The
+     * data a reader copied is valid only if the sequence before and after equals the expected
+     * index, otherwise the writer overwrote the slot meanwhile and the lookup starts over. The
+     * writer may run in an interrupt, and a preempted reader never blocks it. All times are in
+     * [us]
+     */
+    class AttitudeHistory {
+      public:
+        AttitudeHistory();
+
+        /**
+         * @brief 写入一个样本，时间戳必须递增，否则丢弃。只能在一个任务或中断中调用
+         *
+         * @param timestamp 采样时间
+         * @param q         姿态四元数，顺序为w, x, y, z
+         * @param gyro      机体系角速度，单位为[rad/s]
+         */
+        /**
+         * @brief write a sample, dropped unless the timestamp increases. Must be called from a
+         * single task or interrupt only
+         *
+         * @param timestamp time of the sample
+         * @param q         attitude quaternion in the order w, x, y, z
+         * @param gyro      angular rate in the body frame, in [rad/s]
+         */
+        void Push(uint64_t timestamp, const float q[4], const float gyro[3]);
+
+        /**
+         * @brief 查询某个时刻的姿态
+         *
+         * @param timestamp 查询的时间
+         * @param q         输出插值后的四元数
+         * @param gyro      输出插值后的角速度，可以为空
+         *
+         * @return 时间不在窗口内时返回false，输出不变
+         */
+        /**
+         * @brief look up the attitude at a time
+         *
+         * @param timestamp time to look up
+         * @param q         output interpolated quaternion
+         * @param gyro      output interpolated angular rate, may be null
+         *
+         * @return false with the outputs untouched if the time is outside the window
+         */
+        bool Query(uint64_t timestamp, float q[4], float gyro[3] = nullptr) const;
+
+        /**
+         * @brief 获取最新的样本
+         *
+         * @return 还没有样本时返回false
+         */
+        /**
+         * @brief get the latest sample
+         *
+         * @return false if there is no sample yet
+         */
+        bool GetLatest(uint64_t* timestamp, float q[4], float gyro[3] = nullptr) const;
+
+        /**
+         * @brief 四元数的球面线性插值
+         *
+         * @param a 起点
+         * @param b 终点
+         * @param t 插值系数，0为a，1为b
+         * @param q 输出归一化的结果，可以与a或b相同
+         */
+        /**
+         * @brief spherical linear interpolation of quaternions
+         *
+         * @param a start
+         * @param b end
+         * @param t interpolation factor, 0 for a and 1 for b
+         * @param q output normalized result, may alias a or b
+         */
+        static void Slerp(const float a[4], const float b[4], float t, float q[4]);
+
+        static constexpr int CAPACITY = 128;
+
+      private:
+        typedef struct {
+            std::atomic<uint32_t> sequence;
+            uint64_t timestamp;
+            float q[4];
+            float gyro[3];
+        } slot_t;
+
+        bool ReadTime(uint32_t index, uint64_t* timestamp) const;
+        bool ReadSample(uint32_t index, uint64_t* timestamp, float q[4], float gyro[3]) const;
+
+        slot_t slot_[CAPACITY];
+        // 写入过的样本总数，最新样本的编号为count_ - 1
+        std::atomic<uint32_t> count_;
+        uint64_t last_;
+    };
+
+}  // namespace control
@@ -0,0 +1,185 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#pragma once
+
+#include "main.h"
+#include "pid.h"
+
+namespace control {
+
+    /**
+     * @brief 继电器自整定的初始化结构体
+     */
+    /**
+     * @brief initialization structure of the relay auto tuner
+     */
+    typedef struct {
+        float setpoint;    /// 振荡的中心，即被控量的目标值
+        float amplitude;   /// 继电器输出的幅值
+        float bias;        /// 继电器输出的偏置，用于抵消重力等恒定负载
+        float hysteresis;  /// 继电器的滞环宽度，应大于测量噪声
+        float period;      /// 控制周期，单位为[s]
+        float timeout;     /// 超时时间，单位为[s]
+        uint8_t cycles;    /// 判断收敛所需的振荡周期数
+    } relay_tune_init_t;
+
+    /**
+     * @brief 自整定的结果
+     */
+    /**
+     * @brief result of the auto tuning
+     */
+    typedef struct {
+        float ku;         /// 临界增益
+        float tu;         /// 临界周期，单位为[s]
+        float amplitude;  /// 被控量的振荡幅值
+    } relay_tune_result_t;
+
+    /**
+     * @brief 继电器反馈PID自整定
+     * @details 以继电器（bang-bang）输出代替PID，使闭环产生极限环振荡。
+     * 根据振荡的周期Tu和幅值a，由描述函数法得到临界增益 Ku = 4d / (pi * sqrt(a^2 - eps^2))，
+     * 再按照选择的整定规则计算PID参数。计算出的ki和kd已经换算为每次调用的增益，
+     * 可以直接用于ConstrainedPID
+     */
+    /**
+     * @brief relay feedback PID auto tuner
+     * @details replaces the PID with a relay (bang-bang) output so that the closed loop settles
+     * into a limit cycle. From the period Tu and the amplitude a of the oscillation, the describing
+     * function gives the ultimate gain Ku = 4d / (pi * sqrt(a^2 - eps^2)); PID gains are then
+     * derived with a selectable tuning rule. ki and kd are converted to per call gains, so they
+     * can be used by ConstrainedPID directly.
+     */
+    class RelayAutoTuner {
+      public:
+        /**
+         * @brief 自整定的状态
+         */
+        /**
+         * @brief state of the auto tuning
+         */
+        enum tune_state_t {
+            RUNNING = 0,  /// 正在振荡
+            SUCCESS,      /// 已经得到稳定的振荡
+            TIMEOUT,      /// 超时仍没有稳定的振荡，可以增大继电器幅值后重试
+        };
+
+        /**
+         * @brief 整定规则
+         */
+        /**
+         * @brief tuning rules
+         */
+        enum tune_rule_t {
+            ZIEGLER_NICHOLS_PI = 0,  /// Ziegler-Nichols PI，响应快，超调较大
+            ZIEGLER_NICHOLS_PID,     /// Ziegler-Nichols PID，响应快，超调较大
+            TYREUS_LUYBEN_PI,        /// Tyreus-Luyben PI，更保守，超调小
+            TYREUS_LUYBEN_PID,       /// Tyreus-Luyben PID，更保守，超调小
+            SOME_OVERSHOOT_PID,      /// 少量超调的PID
+            NO_OVERSHOOT_PID,        /// 无超调的PID
+        };
+
+        /**
+         * @brief 构造函数
+         * @param init 初始化结构体
+         */
+        /**
+         * @brief constructor
+         * @param init initialization structure
+         */
+        RelayAutoTuner(relay_tune_init_t init);
+
+        /**
+         * @brief 重新开始整定
+         */
+        /**
+         * @brief restart the tuning
+         */
+        void Restart();
+
+        /**
+         * @brief 计算继电器的输出，每个控制周期调用一次
+         * @param measure 被控量的测量值
+         * @return 继电器的输出，整定结束后为偏置
+         */
+        /**
+         * @brief compute the relay output, call once every control period
+         * @param measure measured value of the controlled variable
+         * @return relay output, the bias once the tuning has ended
+         */
+        float Update(float measure);
+
+        /**
+         * @brief 获取整定的状态
+         */
+        /**
+         * @brief get the state of the tuning
+         */
+        tune_state_t State() const;
+
+        /**
+         * @brief 获取临界增益和临界周期，仅在状态为SUCCESS时有效
+         */
+        /**
+         * @brief get the ultimate gain and period, only valid in the SUCCESS state
+         */
+        relay_tune_result_t Result() const;
+
+        /**
+         * @brief 按整定规则计算PID参数
+         * @param rule     整定规则
+         * @param max_iout 积分输出限制
+         * @param max_out  输出限制
+         * @return PID初始化结构体，模式为积分限幅
+         * @note 速度环的测量噪声较大，微分项会放大噪声，推荐使用PI规则
+         */
+        /**
+         * @brief derive PID gains with a tuning rule
+         * @param rule     tuning rule
+         * @param max_iout integral output constraint
+         * @param max_out  output constraint
+         * @return PID initialization structure with the Integral_Limit mode
+         * @note speed measurements are noisy and the derivative term amplifies the noise, prefer
+         *       the PI rules on speed loops
+         */
+        ConstrainedPID::PID_Init_t Gains(tune_rule_t rule, float max_iout, float max_out) const;
+
+      private:
+        relay_tune_init_t init_;
+        tune_state_t state_ = RUNNING;
+        relay_tune_result_t result_ = {};
+
+        bool high_ = true;           // 继电器当前是否输出高电平
+        uint32_t ticks_ = 0;         // 开始整定后的周期数
+        uint32_t last_switch_ = 0;   // 上一次切换到高电平的周期数
+        int switches_ = 0;           // 切换到高电平的次数
+        float max_ = 0;              // 本次振荡中的最大测量值
+        float min_ = 0;              // 本次振荡中的最小测量值
+
+        static constexpr int MAX_CYCLES = 16;
+        float periods_[MAX_CYCLES] = {0};
+        float amplitudes_[MAX_CYCLES] = {0};
+        int cycle_cnt_ = 0;
+
+        void FinishCycle();
+    };
+
+}  // namespace control
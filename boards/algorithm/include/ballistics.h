@@ -0,0 +1,139 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#pragma once
+
+namespace control {
+
+    /**
+     * @brief 弹道解算的参数
+     * @details 空气阻力按速度平方计算，drag = ρ·Cd·A / (2m)，ρ为空气密度，Cd为阻力系数，
+     * A为弹丸截面积，m为弹丸质量
+     */
+    /**
+     * @brief parameters of the ballistics solver
+     * @details the air drag is quadratic in the speed, drag = ρ·Cd·A / (2m) with ρ the air
+     * density, Cd the drag coefficient, A the cross section and m the mass of the projectile
+     */
+    typedef struct {
+        float drag;             /// 空气阻力系数，单位为[1/m]，为0时按真空计算
+        float muzzle_speed;     /// 还没有弹速测量时使用的弹速，单位为[m/s]
+        float speed_filter;     /// 弹速测量的低通系数，范围(0, 1]，每发弹丸更新一次
+        float speed_tolerance;  /// 单次测量最多让弹速改变的量，防止个别异常值，单位为[m/s]
+    } ballistics_init_t;
+
+    /**
+     * @brief 17mm弹丸的默认参数，3.2g，Cd取0.47
+     */
+    /**
+     * @brief default parameters of the 17mm projectile, 3.2g with a Cd of 0.47
+     */
+    constexpr ballistics_init_t BALLISTICS_17MM_INIT = {0.019f, 25.0f, 0.2f, 2.0f};
+
+    /**
+     * @brief 42mm弹丸的默认参数，41g，Cd取0.47
+     */
+    /**
+     * @brief default parameters of the 42mm projectile, 41g with a Cd of 0.47
+     */
+    constexpr ballistics_init_t BALLISTICS_42MM_INIT = {0.0095f, 15.0f, 0.2f, 2.0f};
+
+    /**
+     * @brief 带空气阻力的弹道解算，用于自瞄的俯仰角补偿
+     * @details 由目标的水平距离、高度差和实测弹速求出发射的俯仰角和飞行时间。弹道没有解析解，
+     * 这里把水平距离分成固定的几段，每段内把阻力中的|v|/vx看作常数（取段首和段尾的平均），
+     * 这时水平和竖直方向都有闭式解，其中的指数用短级数计算。俯仰角用固定次数的割线法求解，
+     * 耗时与输入无关。在俯仰角30°以内与精确积分的落点误差小于1cm，接近最大射程时小于12cm。
+     * 飞行时间用于对运动目标做提前量
+     */
+    /**
+     * @brief ballistics with air drag, for the pitch compensation of auto aiming
+     * @details solves the launch pitch and the time of flight from the horizontal distance and
+     * the height of the target and the measured muzzle speed. The trajectory has no closed form,
+     * so the distance is split into a fixed number of segments, and within each |v|/vx of the
+     * drag is taken as constant (the mean of both ends of the segment). Both the horizontal and
+     * the vertical motion then have a closed form, with the exponentials taken from short
+     * series. The pitch is found by a fixed number of secant steps, so the run time does not
+     * depend on the input. The point of impact is within 1cm of an exact integration up to a
+     * pitch of 30° and within 12cm near the maximum range. The time of flight gives the lead for
+     * a moving target
+     */
+    class Ballistics {
+      public:
+        /**
+         * @brief 构造函数
+         *
+         * @param init 弹道解算的参数
+         */
+        /**
+         * @brief constructor
+         *
+         * @param init parameters of the ballistics solver
+         */
+        Ballistics(ballistics_init_t init);
+
+        /**
+         * @brief 用裁判系统实时射击数据中的弹速更新弹速估计
+         *
+         * @param measured 测得的弹速，单位为[m/s]，非正数会被忽略
+         */
+        /**
+         * @brief update the muzzle speed estimate with the speed from the shoot data of the
+         * referee system
+         *
+         * @param measured measured muzzle speed, in [m/s], non-positive values are ignored
+         */
+        void UpdateMuzzleSpeed(float measured);
+
+        /**
+         * @brief 求击中目标的俯仰角和飞行时间，只取低弹道，俯仰角限制在-81°到45°之间
+         *
+         * @param distance 到目标的水平距离，单位为[m]
+         * @param height   目标相对枪口的高度，向上为正，单位为[m]
+         * @param pitch    输出俯仰角，抬头为正，单位为[rad]
+         * @param time     输出飞行时间，单位为[s]，可以为nullptr
+         *
+         * @return 目标在射程内返回true；否则返回false，输出为最接近目标的弹道
+         */
+        /**
+         * @brief solve the pitch and the time of flight that hit the target, on the low arc only
+         * with the pitch limited to -81° to 45°
+         *
+         * @param distance horizontal distance to the target, in [m]
+         * @param height   height of the target over the muzzle, positive upwards, in [m]
+         * @param pitch    output pitch, positive upwards, in [rad]
+         * @param time     output time of flight, in [s], can be nullptr
+         *
+         * @return true when the target is in range; otherwise false with the outputs of the
+         * trajectory closest to the target
+         */
+        bool Solve(float distance, float height, float* pitch, float* time = nullptr) const;
+
+        float GetMuzzleSpeed() const;
+
+      private:
+        float Trajectory(float pitch, float distance, float* time) const;
+
+        ballistics_init_t init_;
+        float speed_;
+        bool measured_;
+    };
+
+}  // namespace control
@@ -0,0 +1,381 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#pragma once
+
+// clang-format off
+#include "main.h"
+// clang-format on
+
+#include "arm_math.h"
+
+#if defined(ARM_MATH_CM3) || defined(ARM_MATH_CM4) || defined(ARM_MATH_CM7)
+#define BIQUAD_USE_CMSIS
+#endif
+
+namespace control {
+
+    /**
+     * @brief 一节二阶IIR滤波器的系数，已经按a0归一化
+     * @details y[n] = b0·x[n] + b1·x[n-1] + b2·x[n-2] - a1·y[n-1] - a2·y[n-2]
+     */
+    /**
+     * @brief coefficients of one second order IIR section, normalized by a0
+     * @details y[n] = b0·x[n] + b1·x[n-1] + b2·x[n-2] - a1·y[n-1] - a2·y[n-2]
+     */
+    typedef struct {
+        float b0;
+        float b1;
+        float b2;
+        float a1;
+        float a2;
+    } biquad_coeff_t;
+
+    /**
+     * @brief 巴特沃斯滤波器的品质因数
+     */
+    /**
+     * @brief quality factor of a Butterworth filter
+     */
+    constexpr float BUTTERWORTH_Q = 0.70710678f;
+
+    /**
+     * @brief 直通，输出等于输入
+     */
+    /**
+     * @brief pass through, the output equals the input
+     */
+    constexpr biquad_coeff_t BIQUAD_IDENTITY = {1, 0, 0, 0, 0};
+
+    /**
+     * @brief 原来AHRS和IMU_typeC中加速度计的低通滤波器，1kHz采样，只有极点，约7.8Hz，Q约0.7
+     */
+    /**
+     * @brief the accelerometer low pass of the old AHRS and IMU_typeC, all pole at 1 kHz, about
+     * 7.8 Hz with a Q of about 0.7
+     */
+    constexpr biquad_coeff_t ACCEL_LPF_COEFF = {0.002329458745586203f, 0, 0,
+                                                -1.929454039488895f, 0.93178349823448126f};
+
+    namespace detail {
+
+        // 编译期的正弦和余弦，只用于[0, pi]内的设计频率
+        // compile time sine and cosine, only meant for design frequencies in [0, pi]
+        constexpr double BiquadSin(double x) {
+            double term = x, sum = x;
+            for (int n = 1; n < 16; ++n) {
+                term *= -x * x / ((2 * n) * (2 * n + 1));
+                sum += term;
+            }
+            return sum;
+        }
+
+        constexpr double BiquadCos(double x) {
+            double term = 1, sum = 1;
+            for (int n = 1; n < 16; ++n) {
+                term *= -x * x / ((2 * n - 1) * (2 * n));
+                sum += term;
+            }
+            return sum;
+        }
+
+        constexpr biquad_coeff_t BiquadNormalize(double b0, double b1, double b2, double a0,
+                                                 double a1, double a2) {
+            return {(float)(b0 / a0), (float)(b1 / a0), (float)(b2 / a0), (float)(a1 / a0),
+                    (float)(a2 / a0)};
+        }
+
+    }  // namespace detail
+
+    /**
+     * @brief 用双线性变换设计二阶低通滤波器，直流增益为1
+     *
+     * @param fs 采样频率，单位为[Hz]
+     * @param fc 截止频率，单位为[Hz]，小于fs / 2
+     * @param q  品质因数，巴特沃斯为BUTTERWORTH_Q
+     */
+    /**
+     * @brief design a second order low pass through the bilinear transform, unit gain at DC
+     *
+     * @param fs sampling frequency, in [Hz]
+     * @param fc cutoff frequency, in [Hz], below fs / 2
+     * @param q  quality factor, BUTTERWORTH_Q for Butterworth
+     */
+    constexpr biquad_coeff_t BiquadLowPass(float fs, float fc, float q = BUTTERWORTH_Q) {
+        const double w = 2 * 3.14159265358979323846 * fc / fs;
+        const double cosine = detail::BiquadCos(w);
+        const double alpha = detail::BiquadSin(w) / (2 * q);
+        return detail::BiquadNormalize((1 - cosine) / 2, 1 - cosine, (1 - cosine) / 2, 1 + alpha,
+                                       -2 * cosine, 1 - alpha);
+    }
+
+    /**
+     * @brief 用双线性变换设计二阶高通滤波器，奈奎斯特频率处增益为1
+     *
+     * @param fs 采样频率，单位为[Hz]
+     * @param fc 截止频率，单位为[Hz]，小于fs / 2
+     * @param q  品质因数，巴特沃斯为BUTTERWORTH_Q
+     */
+    /**
+     * @brief design a second order high pass through the bilinear transform, unit gain at the
+     * Nyquist frequency
+     *
+     * @param fs sampling frequency, in [Hz]
+     * @param fc cutoff frequency, in [Hz], below fs / 2
+     * @param q  quality factor, BUTTERWORTH_Q for Butterworth
+     */
+    constexpr biquad_coeff_t BiquadHighPass(float fs, float fc, float q = BUTTERWORTH_Q) {
+        const double w = 2 * 3.14159265358979323846 * fc / fs;
+        const double cosine = detail::BiquadCos(w);
+        const double alpha = detail::BiquadSin(w) / (2 * q);
+        return detail::BiquadNormalize((1 + cosine) / 2, -(1 + cosine), (1 + cosine) / 2,
+                                       1 + alpha, -2 * cosine, 1 - alpha);
+    }
+
+    /**
+     * @brief 用双线性变换设计陷波滤波器，陷波频率处增益为0，其他地方增益接近1
+     *
+     * @param fs 采样频率，单位为[Hz]
+     * @param fc 陷波频率，单位为[Hz]，小于fs / 2
+     * @param q  品质因数，等于陷波频率除以-3dB带宽，越大陷波越窄
+     */
+    /**
+     * @brief design a notch through the bilinear transform, zero gain at the notch frequency and
+     * close to unit gain elsewhere
+     *
+     * @param fs sampling frequency, in [Hz]
+     * @param fc notch frequency, in [Hz], below fs / 2
+     * @param q  quality factor, the notch frequency over the -3 dB bandwidth, larger is narrower
+     */
+    constexpr biquad_coeff_t BiquadNotch(float fs, float fc, float q) {
+        const double w = 2 * 3.14159265358979323846 * fc / fs;
+        const double cosine = detail::BiquadCos(w);
+        const double alpha = detail::BiquadSin(w) / (2 * q);
+        return detail::BiquadNormalize(1, -2 * cosine, 1, 1 + alpha, -2 * cosine, 1 - alpha);
+    }
+
+    /**
+     * @brief 多通道的二阶IIR级联滤波器
+     * @details 所有通道使用相同的系数，每个通道有自己的状态，采用转置直接II型结构，每节只有两个
+     * 状态量，数值特性好。系数和状态的排列与CMSIS-DSP的arm_biquad_cascade_df2T_f32相同：
+     * Process()在目标板上直接调用它处理一段数据，在主机上使用同样计算的可移植实现。Update()每个
+     * 通道只处理一个样本，此时函数调用和循环准备的开销比计算本身还大，所以始终使用内联的实现。
+     * 两者共享状态，可以混用
+     *
+     * @tparam CHANNELS 通道数
+     * @tparam STAGES   级联的节数，滤波器的阶数为2 * STAGES
+     */
+    /**
+     * @brief multi channel cascade of second order IIR sections
+     * @details every channel shares the coefficients and owns its state. The sections use the
+     * transposed direct form II with two states per section, which behaves well numerically. The
+     * coefficients and states are laid out as for arm_biquad_cascade_df2T_f32 of CMSIS-DSP:
+     * Process() calls it directly on a block on target and runs a portable implementation of the
+     * same arithmetic on the host. Update() handles one sample per channel, where a call and its
+     * loop setup cost more than the arithmetic, so it is always inlined. Both share the state and
+     * may be mixed.
+     *
+     * @tparam CHANNELS number of channels
+     * @tparam STAGES   number of cascaded sections, the order of the filter is 2 * STAGES
+     */
+    template <int CHANNELS, int STAGES = 1>
+    class BiquadFilter {
+      public:
+        static_assert(CHANNELS > 0 && STAGES > 0 && STAGES < 256,
+                      "invalid biquad filter dimensions");
+
+        /**
+         * @brief 构造函数，每一节都使用相同的系数，状态为0
+         *
+         * @param coeff 每一节的系数
+         */
+        /**
+         * @brief constructor using the same coefficients for every section, zero state
+         *
+         * @param coeff coefficients of every section
+         */
+        BiquadFilter(const biquad_coeff_t& coeff) {
+            for (int s = 0; s < STAGES; ++s)
+                SetCoefficients(s, coeff);
+            Reset();
+        }
+
+        /**
+         * @brief 构造函数，状态为0
+         *
+         * @param stages 从输入到输出每一节的系数，共STAGES个
+         */
+        /**
+         * @brief constructor, zero state
+         *
+         * @param stages coefficients of the STAGES sections from the input to the output
+         */
+        BiquadFilter(const biquad_coeff_t* stages) {
+            for (int s = 0; s < STAGES; ++s)
+                SetCoefficients(s, stages[s]);
+            Reset();
+        }
+
+        /**
+         * @brief 重置状态，使滤波器处于输入恒为input时的稳态，为空时清零
+         *
+         * @param input 每个通道的输入
+         */
+        /**
+         * @brief reset the state to the steady state of a constant input, or to zero if null
+         *
+         * @param input input of every channel
+         */
+        void Reset(const float* input = nullptr) {
+            for (int c = 0; c < CHANNELS; ++c) {
+                float x = input != nullptr ? input[c] : 0;
+                for (int s = 0; s < STAGES; ++s) {
+                    const float* k = coeff_ + 5 * s;
+                    // 直流增益为(b0 + b1 + b2) / (1 + a1 + a2)，注意a1和a2已经取反
+                    // the DC gain is (b0 + b1 + b2) / (1 + a1 + a2), with a1 and a2 negated
+                    const float den = 1 - k[3] - k[4];
+                    const float y = den != 0 ? (k[0] + k[1] + k[2]) / den * x : 0;
+                    float* d = state_[c] + 2 * s;
+                    d[1] = k[2] * x + k[4] * y;
+                    d[0] = y - k[0] * x;
+                    x = y;
+                }
+            }
+        }
+
+        /**
+         * @brief 每个通道输入一个样本
+         *
+         * @param input  每个通道的输入
+         * @param output 每个通道的输出，可以与input相同
+         */
+        /**
+         * @brief feed one sample to every channel
+         *
+         * @param input  input of every channel
+         * @param output output of every channel, may be the same as input
+         */
+        void Update(const float* input, float* output) {
+            for (int c = 0; c < CHANNELS; ++c) {
+                float x = input[c];
+                float* d = state_[c];
+                for (int s = 0; s < STAGES; ++s, d += 2) {
+                    const float* k = coeff_ + 5 * s;
+                    const float y = k[0] * x + d[0];
+                    d[0] = k[1] * x + k[3] * y + d[1];
+                    d[1] = k[2] * x + k[4] * y;
+                    x = y;
+                }
+                output[c] = x;
+            }
+        }
+
+        /**
+         * @brief 单通道时输入一个样本
+         *
+         * @return 输出
+         */
+        /**
+         * @brief feed one sample when there is a single channel
+         *
+         * @return output
+         */
+        float Update(float input) {
+            static_assert(CHANNELS == 1, "use Update(input, output) for multiple channels");
+            float output;
+            Update(&input, &output);
+            return output;
+        }
+
+        /**
+         * @brief 处理一个通道的一段数据
+         *
+         * @param channel 通道
+         * @param input   输入
+         * @param output  输出，可以与input相同
+         * @param length  样本数
+         */
+        /**
+         * @brief process a block of one channel
+         *
+         * @param channel channel
+         * @param input   input
+         * @param output  output, may be the same as input
+         * @param length  number of samples
+         */
+        void Process(int channel, const float* input, float* output, int length) {
+#ifdef BIQUAD_USE_CMSIS
+            // 不调用arm_biquad_cascade_df2T_init_f32，它会清零状态
+            // arm_biquad_cascade_df2T_init_f32 is not called as it clears the state
+            arm_biquad_cascade_df2T_instance_f32 instance;
+            instance.numStages = STAGES;
+            instance.pState = state_[channel];
+            instance.pCoeffs = coeff_;
+            arm_biquad_cascade_df2T_f32(&instance, const_cast<float*>(input), output, length);
+#else
+            float* state = state_[channel];
+            for (int s = 0; s < STAGES; ++s) {
+                const float* k = coeff_ + 5 * s;
+                float d0 = state[2 * s], d1 = state[2 * s + 1];
+                for (int n = 0; n < length; ++n) {
+                    const float x = input[n];
+                    const float y = k[0] * x + d0;
+                    d0 = k[1] * x + k[3] * y + d1;
+                    d1 = k[2] * x + k[4] * y;
+                    output[n] = y;
+                }
+                state[2 * s] = d0;
+                state[2 * s + 1] = d1;
+                // 后面的节处理前一节的输出 / later sections filter the output of the previous one
+                input = output;
+            }
+#endif
+        }
+
+        /**
+         * @brief 修改一节的系数，保留状态，可以在运行中重新调节频率
+         *
+         * @param stage 第几节
+         * @param coeff 新的系数
+         */
+        /**
+         * @brief change the coefficients of a section keeping the state, so it can be retuned
+         * while running
+         *
+         * @param stage index of the section
+         * @param coeff new coefficients
+         */
+        void SetCoefficients(int stage, const biquad_coeff_t& coeff) {
+            // 与CMSIS-DSP相同，反馈系数取反 / the feedback coefficients are negated as in CMSIS
+            float* k = coeff_ + 5 * stage;
+            k[0] = coeff.b0;
+            k[1] = coeff.b1;
+            k[2] = coeff.b2;
+            k[3] = -coeff.a1;
+            k[4] = -coeff.a2;
+        }
+
+      private:
+
+        float coeff_[5 * STAGES];
+        float state_[CHANNELS][2 * STAGES];
+    };
+
+}  // namespace control
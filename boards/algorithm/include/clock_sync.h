@@ -0,0 +1,177 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+namespace control {
+
+    /**
+     * @brief 时钟同步的参数
+     */
+    /**
+     * @brief parameters of the clock synchronization
+     */
+    typedef struct {
+        uint32_t delay_tolerance;  /// 往返延迟比窗口内最小值大出该值的样本不参与拟合，单位为[us]
+        float max_drift;           /// 两个时钟频率差的上限，单位为[ppm]
+    } clock_sync_init_t;
+
+    constexpr clock_sync_init_t CLOCK_SYNC_DEFAULT_INIT = {500, 500.0f};
+
+    /**
+     * @brief 估计本地时钟和远端时钟之间的偏移和漂移
+     * @details 每次交换与NTP相同：本地在t1发出请求，远端在t2收到、t3回复，本地在t4收到，
+     * 偏移为((t2 - t1) + (t3 - t4)) / 2，往返延迟为(t4 - t1) - (t3 - t2)。排队和调度只会让
+     * 延迟变大并且通常不对称，所以每SLOT_EXCHANGES次交换只保留延迟最小的一个样本，窗口中
+     * 保存最近WINDOW个这样的样本，再去掉延迟比最小值大出delay_tolerance的，对偏移关于本地时间
+     * 做最小二乘直线拟合，斜率即两个时钟的频率差。固定的不对称延迟无法从交换中观测，会留下
+     * 其一半的误差。时间都以[us]为单位
+     *
+     * Update和Reset只能在一个任务或中断中调用，换算可以在其它任务中调用，读到的总是最近一次
+     * 完整发布的估计
+     */
+    /**
+     * @brief estimate the offset and the drift between the local and a remote clock
+     * @details every exchange is the same as NTP: the local side sends a request at t1, the
+     * remote side receives it at t2 and replies at t3, and the local side receives the reply at
+     * t4. The offset is ((t2 - t1) + (t3 - t4)) / 2 and the round trip delay is
+     * (t4 - t1) - (t3 - t2). Queueing and scheduling only make the delay longer and usually
+     * asymmetric, so only the sample with the smallest delay of every SLOT_EXCHANGES exchanges
+     * is kept, the window holds the latest WINDOW of them, and those more than delay_tolerance
+     * over the minimum delay are dropped. A least squares line of the offset over the local time
+     * is fitted to the rest, its slope being the frequency difference of the clocks. A constant
+     * asymmetry of the delay cannot be observed from the exchanges and leaves half of it as an
+     * error. All times are in [us]
+     *
+     * Update and Reset must be called from a single task or interrupt. The conversions may be
+     * called from any other task, they read the latest published estimate and never see one
+     * that is half written
+     */
+    class ClockSync {
+      public:
+        /**
+         * @brief 构造函数
+         *
+         * @param init 时钟同步的参数
+         */
+        /**
+         * @brief constructor
+         *
+         * @param init parameters of the clock synchronization
+         */
+        ClockSync(clock_sync_init_t init = CLOCK_SYNC_DEFAULT_INIT);
+
+        /**
+         * @brief 加入一次交换的四个时间戳
+         *
+         * @param request         本地发出请求的时间t1
+         * @param remote_receive  远端收到请求的时间t2
+         * @param remote_transmit 远端发出回复的时间t3
+         * @param response        本地收到回复的时间t4
+         */
+        /**
+         * @brief add the four timestamps of an exchange
+         *
+         * @param request         local time the request was sent, t1
+         * @param remote_receive  remote time the request was received, t2
+         * @param remote_transmit remote time the reply was sent, t3
+         * @param response        local time the reply was received, t4
+         */
+        void Update(uint64_t request, uint64_t remote_receive, uint64_t remote_transmit,
+                    uint64_t response);
+
+        /**
+         * @brief 把本地时间换算为远端时间
+         */
+        /**
+         * @brief convert a local time to the remote clock
+         */
+        uint64_t ToRemote(uint64_t local) const;
+
+        /**
+         * @brief 把远端时间换算为本地时间
+         */
+        /**
+         * @brief convert a remote time to the local clock
+         */
+        uint64_t ToLocal(uint64_t remote) const;
+
+        /**
+         * @brief 收到足够的交换后返回true，之前换算的结果没有意义
+         */
+        /**
+         * @brief true once enough exchanges arrived, conversions are meaningless before
+         */
+        bool IsSynchronized() const;
+
+        /**
+         * @brief 获取估计的频率差，远端比本地快为正，单位为[ppm]
+         */
+        /**
+         * @brief get the estimated frequency difference, positive when the remote clock is
+         * faster, in [ppm]
+         */
+        float GetDrift() const;
+
+        void Reset();
+
+        static constexpr int WINDOW = 16;
+        static constexpr int SLOT_EXCHANGES = 10;
+
+      private:
+        typedef struct {
+            uint64_t reference_time;
+            int64_t reference_offset;
+            float intercept;
+            float drift;
+            bool synchronized;
+        } estimate_t;
+
+        void Publish();
+        estimate_t Load() const;
+        static float Offset(const estimate_t& estimate, uint64_t local);
+
+        clock_sync_init_t init_;
+
+        uint64_t time_[WINDOW];
+        int64_t offset_[WINDOW];
+        int64_t delay_[WINDOW];
+        uint32_t exchanges_;
+        int count_;
+        int head_;
+
+        uint64_t reference_time_;
+        int64_t reference_offset_;
+        float intercept_;
+        float drift_;
+
+        // 两份估计轮流写入，读者读当前的一份时写者只会改另一份
+        // the estimate is written alternately into two copies, so while a reader copies the
+        // current one the writer only touches the other
+        estimate_t estimate_[2];
+        // 发布的次数，当前的估计为estimate_[sequence_ & 1]
+        std::atomic<uint32_t> sequence_;
+    };
+
+}  // namespace control
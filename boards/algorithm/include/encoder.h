@@ -0,0 +1,155 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#pragma once
+
+#include <stdint.h>
+
+namespace control {
+
+    /**
+     * @brief 整数计数的多圈编码器
+     * @details 每帧只用原始读数的差值累计转子转过的刻度数，两帧之间转子必须转过不到半圈。
+     * 减速比被近似为分母不超过MAX_DENOMINATOR的分数num / den，输出轴的圈数和圈内位置都以
+     * 「刻度 × den」为单位用整数维护，一圈为resolution × num，所以无论转多少圈都不会累积误差。
+     * 只有读取角度时才转换为浮点数，返回值的精度只受浮点数本身的表示范围限制
+     */
+    /**
+     * @brief multi-turn encoder counted in integers
+     * @details every frame only the difference of the raw readings is added to the ticks the
+     * rotor has turned, so the rotor must turn less than half a revolution between two frames.
+     * The gear ratio is approximated by a fraction num / den with a denominator up to
+     * MAX_DENOMINATOR, and the turns of the output shaft and the position within the turn are
+     * kept as integers in units of ticks × den, one turn being resolution × num, so nothing
+     * accumulates however many turns are made. Only reading an angle converts to float, and the
+     * result is limited by nothing but the float representation itself
+     */
+    class MultiTurnEncoder {
+      public:
+        static constexpr int32_t MAX_DENOMINATOR = 1000;
+
+        /**
+         * @brief 构造函数
+         *
+         * @param resolution 转子转一圈的刻度数，大疆电机为8192
+         */
+        /**
+         * @brief constructor
+         *
+         * @param resolution ticks per rotor revolution, 8192 for DJI motors
+         */
+        MultiTurnEncoder(int32_t resolution = 8192);
+
+        /**
+         * @brief 设置减速比，即转子转过的圈数与输出轴转过的圈数之比，已经累计的刻度数保持不变
+         *
+         * @param ratio 减速比，必须为正数
+         */
+        /**
+         * @brief set the gear ratio, i.e. rotor turns per output shaft turn, the accumulated
+         * ticks are kept
+         *
+         * @param ratio gear ratio, must be positive
+         */
+        void SetRatio(float ratio);
+
+        /**
+         * @brief 从当前读数重新开始计数
+         *
+         * @param raw    当前的原始读数，范围为[0, resolution)
+         * @param origin 零点对应的原始读数，起始位置为raw相对origin正向的距离，范围为[0, 1)圈
+         */
+        /**
+         * @brief restart counting from the current reading
+         *
+         * @param raw    current raw reading, in [0, resolution)
+         * @param origin raw reading of the zero, the start is the forward distance from origin to
+         *               raw, within [0, 1) revolution
+         */
+        void Reset(int32_t raw, int32_t origin);
+
+        /**
+         * @brief 输入一帧原始读数
+         *
+         * @param raw 原始读数，范围为[0, resolution)
+         */
+        /**
+         * @brief feed the raw reading of one frame
+         *
+         * @param raw raw reading, in [0, resolution)
+         */
+        void Update(int32_t raw);
+
+        /**
+         * @brief 转子累计转过的刻度数
+         */
+        /**
+         * @brief ticks the rotor has turned in total
+         */
+        int64_t GetTicks() const;
+
+        /**
+         * @brief 输出轴转过的整圈数，向负无穷取整
+         */
+        /**
+         * @brief whole turns of the output shaft, rounded towards negative infinity
+         */
+        int32_t GetTurns() const;
+
+        /**
+         * @brief 输出轴在当前圈内的角度，单位为[rad]，范围为[0, 2PI)
+         */
+        /**
+         * @brief angle of the output shaft within the current turn, in [rad], within [0, 2PI)
+         */
+        float GetAngle() const;
+
+        /**
+         * @brief 输出轴的累计角度，单位为[rad]
+         */
+        /**
+         * @brief accumulated angle of the output shaft, in [rad]
+         */
+        float GetTheta() const;
+
+        /**
+         * @brief 获取减速比近似成的分数
+         */
+        /**
+         * @brief get the fraction the gear ratio is approximated by
+         */
+        void GetRatio(int32_t* numerator, int32_t* denominator) const;
+
+      private:
+        void Rebase();
+
+        int32_t resolution_;
+        int32_t numerator_ = 1;
+        int32_t denominator_ = 1;
+        int32_t period_;   /* 输出轴一圈，单位为[刻度 × den] */
+        float angle_scale_; /* 2PI / period_ */
+
+        int32_t last_raw_ = 0;
+        int64_t ticks_ = 0;
+        int32_t turns_ = 0;
+        int32_t phase_ = 0; /* 圈内位置，范围为[0, period_) */
+    };
+
+}  // namespace control
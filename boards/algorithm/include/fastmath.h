@@ -0,0 +1,209 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#pragma once
+
+/**
+ * @file fastmath.h
+ * @brief 姿态解算和运动学热点路径使用的快速近似数学函数，C和C++均可包含
+ * @details 每个函数都注明了最大误差（在主机上对float全范围或给定范围逐点对比libm得到）。
+ * 所有函数都是static inline，不依赖main.h和CMSIS-DSP
+ */
+/**
+ * @file fastmath.h
+ * @brief fast approximate math for the attitude and kinematics hot paths, includable from both
+ * C and C++
+ * @details every function documents its max error, measured on the host against libm over the
+ * whole float range or the stated range. All functions are static inline and depend on neither
+ * main.h nor CMSIS-DSP
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#define FAST_PI 3.14159265358979f
+#define FAST_PI_2 1.57079632679490f
+
+/**
+ * @brief 四象限反正切
+ *
+ * @param y y坐标
+ * @param x x坐标
+ *
+ * @return 角度[rad]，范围[-pi, pi]，最大误差2e-6 rad；x和y均为0时返回0
+ */
+/**
+ * @brief four quadrant arc tangent
+ *
+ * @param y y coordinate
+ * @param x x coordinate
+ *
+ * @return angle [rad] in [-pi, pi], max error 2e-6 rad; returns 0 when both x and y are 0
+ */
+static inline float fast_atan2f(float y, float x) {
+    const float ax = fabsf(x);
+    const float ay = fabsf(y);
+    const float hi = ax > ay ? ax : ay;
+    const float lo = ax > ay ? ay : ax;
+    if (hi == 0.0f)
+        return 0.0f;
+    // atan在[0, 1]上的11阶奇次极小极大多项式 / degree-11 odd minimax polynomial of atan on [0, 1]
+    const float a = lo / hi;
+    const float s = a * a;
+    float r = -0.0117212f;
+    r = r * s + 0.05265332f;
+    r = r * s - 0.11643287f;
+    r = r * s + 0.19354346f;
+    r = r * s - 0.33262347f;
+    r = r * s + 0.99997726f;
+    r *= a;
+    r = ay > ax ? FAST_PI_2 - r : r;
+    r = x < 0.0f ? FAST_PI - r : r;
+    return copysignf(r, y);
+}
+
+/**
+ * @brief 反正弦
+ *
+ * @param x 正弦值，超出[-1, 1]时按端点计算（libm会返回NaN）
+ *
+ * @return 角度[rad]，范围[-pi/2, pi/2]，最大误差3e-7 rad
+ */
+/**
+ * @brief arc sine
+ *
+ * @param x sine, clamped to [-1, 1] (libm would return NaN, e.g. for a slightly denormalized
+ *          quaternion)
+ *
+ * @return angle [rad] in [-pi/2, pi/2], max error 3e-7 rad
+ */
+static inline float fast_asinf(float x) {
+    const float a = fminf(fabsf(x), 1.0f);
+    // Abramowitz & Stegun 4.4.46
+    float p = -0.0012624911f;
+    p = p * a + 0.0066700901f;
+    p = p * a - 0.0170881256f;
+    p = p * a + 0.0308918810f;
+    p = p * a - 0.0501743046f;
+    p = p * a + 0.0889789874f;
+    p = p * a - 0.2145988016f;
+    p = p * a + 1.5707963050f;
+    return copysignf(FAST_PI_2 - sqrtf(1.0f - a) * p, x);
+}
+
+/**
+ * @brief 同时计算正弦和余弦
+ *
+ * @param x      角度[rad]
+ * @param sine   输出正弦
+ * @param cosine 输出余弦
+ *
+ * @note |x| <= pi时最大误差4e-7，|x| <= 100时4e-6，更大的角度应先环绕
+ */
+/**
+ * @brief sine and cosine of the same angle
+ *
+ * @param x      angle [rad]
+ * @param sine   output sine
+ * @param cosine output cosine
+ *
+ * @note max error 4e-7 for |x| <= pi and 4e-6 for |x| <= 100, wrap larger angles first
+ */
+static inline void fast_sincosf(float x, float* sine, float* cosine) {
+    // 归约到[-pi/4, pi/4]，pi/2拆成两部分减小归约误差
+    // reduce to [-pi/4, pi/4], pi/2 is split in two to keep the reduction exact
+    const int32_t q = (int32_t)(x * 0.63661977f + (x < 0.0f ? -0.5f : 0.5f));
+    const float r = (x - (float)q * 1.5707963705f) + (float)q * 4.37113883e-8f;
+    const float r2 = r * r;
+    float s = -1.98412698e-4f;
+    s = s * r2 + 8.33333333e-3f;
+    s = s * r2 - 1.66666667e-1f;
+    s = s * r2 * r + r;
+    float c = 2.48015873e-5f;
+    c = c * r2 - 1.38888889e-3f;
+    c = c * r2 + 4.16666667e-2f;
+    c = c * r2 - 0.5f;
+    c = c * r2 + 1.0f;
+    // 按象限交换和取反 / swap and negate by quadrant
+    const float ss = (q & 1) ? c : s;
+    const float cc = (q & 1) ? s : c;
+    *sine = (q & 2) ? -ss : ss;
+    *cosine = ((q + 1) & 2) ? -cc : cc;
+}
+
+/**
+ * @brief 无循环地环绕一个值使其落入[min, max)
+ *
+ * @param value 要环绕的值，与min的距离不超过2^31个周期
+ * @param min   范围最小值
+ * @param max   范围最大值
+ *
+ * @return 环绕后的值，误差不超过value、min和max中绝对值最大者的一个float ulp，结果可能因舍入略微
+ *         越过端点
+ */
+/**
+ * @brief wrap a value into [min, max) without loops
+ *
+ * @param value value to be wrapped, within 2^31 cycles of min
+ * @param min   range min
+ * @param max   range max
+ *
+ * @return wrapped value, off by at most one float ulp of the largest of |value|, |min| and
+ *         |max|; rounding may put the result marginally outside the range
+ */
+static inline float fast_wrapf(float value, float min, float max) {
+    const float range = max - min;
+    const float n = (value - min) / range;
+    int32_t k = (int32_t)n;
+    k -= n < (float)k;  // 向下取整 / floor
+    return value - (float)k * range;
+}
+
+/**
+ * @brief 平方根的倒数
+ *
+ * @param x 正数
+ *
+ * @return 1 / sqrt(x)，最大相对误差4.8e-6（1.0f / sqrtf为9e-8）
+ *
+ * @note 两次牛顿迭代。有FPU时1.0f / sqrtf(x)只需VSQRT和VDIV两条指令，这个函数主要给没有FPU的板子用
+ */
+/**
+ * @brief reciprocal square root
+ *
+ * @param x positive number
+ *
+ * @return 1 / sqrt(x), max relative error 4.8e-6 (9e-8 for 1.0f / sqrtf)
+ *
+ * @note two Newton iterations. With an FPU 1.0f / sqrtf(x) is just VSQRT and VDIV, this is
+ * mostly meant for boards without one
+ */
+static inline float fast_invsqrtf(float x) {
+    uint32_t i;
+    float y;
+    memcpy(&i, &x, sizeof(i));
+    i = 0x5f375a86u - (i >> 1);
+    memcpy(&y, &i, sizeof(y));
+    const float half = 0.5f * x;
+    y *= 1.5f - half * y * y;
+    y *= 1.5f - half * y * y;
+    return y;
+}
@@ -0,0 +1,499 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#pragma once
+
+/* NOTE(alvin): DSP libraries depends on macro definitions on FPU
+ * computability, so the main.h must be included before arm_math.h */
+// clang-format off
+#include "main.h"
+// clang-format on
+
+#include "arm_math.h"
+#include "pid.h"
+
+namespace control {
+
+    /**
+     * @brief 定点数换算和饱和运算
+     * @details 定标方式：物理量x，满量程为full_scale，则Qn格式的值为 x / full_scale * 2^n。
+     * 例如电流满量程为30000时，Q15的16384表示15000。所有转换都会四舍五入并饱和到格式范围内，
+     * 浮点转换只应在初始化时使用
+     */
+    /**
+     * @brief fixed point scaling and saturating arithmetic
+     * @details scaling: a physical value x with a full scale of full_scale is stored in Qn as
+     * x / full_scale * 2^n, e.g. with a full scale of 30000, 16384 in Q15 stands for 15000. All
+     * conversions round to nearest and saturate to the range of the format; the float conversions
+     * are meant for initialization only
+     */
+    namespace fixed {
+
+        constexpr int32_t Q15_ONE = 1 << 15;  /// Q15中的1.0，不可表示，仅用于系数
+
+        /**
+         * @brief FixedPID增益和内部状态的小数位数，即Q16.16格式
+         */
+        /**
+         * @brief fractional bits of the gains and internal states of FixedPID, i.e. Q16.16
+         */
+        constexpr int GAIN_FRAC_BITS = 16;
+
+        /**
+         * @brief 饱和到Q15范围
+         */
+        /**
+         * @brief saturate to the Q15 range
+         */
+        inline q15_t SatQ15(int32_t x) {
+            return (q15_t)clip<int32_t>(x, INT16_MIN, INT16_MAX);
+        }
+
+        /**
+         * @brief 饱和到Q31范围
+         */
+        /**
+         * @brief saturate to the Q31 range
+         */
+        inline q31_t SatQ31(q63_t x) {
+            return (q31_t)clip<q63_t>(x, INT32_MIN, INT32_MAX);
+        }
+
+        /**
+         * @brief 浮点数转换为任意小数位数的32位定点数
+         * @param x         浮点数
+         * @param frac_bits 小数位数
+         */
+        /**
+         * @brief convert a float to a 32 bit fixed point number with any number of fractional bits
+         * @param x         float value
+         * @param frac_bits number of fractional bits
+         */
+        inline int32_t FloatToFixed(float x, int frac_bits) {
+            const float scaled = x * (float)(1LL << frac_bits);
+            const float rounded = scaled >= 0 ? scaled + 0.5f : scaled - 0.5f;
+            // 先在浮点中饱和，超出int32范围的浮点转整数是未定义行为
+            return (int32_t)clip<float>(rounded, -2147483648.0f, 2147483520.0f);
+        }
+
+        /**
+         * @brief 32位定点数转换为浮点数
+         */
+        /**
+         * @brief convert a 32 bit fixed point number to float
+         */
+        inline float FixedToFloat(int32_t x, int frac_bits) {
+            return (float)x / (float)(1LL << frac_bits);
+        }
+
+        /**
+         * @brief 物理量转换为Q15
+         * @param x          物理量
+         * @param full_scale 满量程，对应Q15中的1.0
+         */
+        /**
+         * @brief convert a physical value to Q15
+         * @param x          physical value
+         * @param full_scale full scale, mapped to 1.0 in Q15
+         */
+        inline q15_t FloatToQ15(float x, float full_scale = 1.0f) {
+            return SatQ15(FloatToFixed(x / full_scale, 15));
+        }
+
+        /**
+         * @brief Q15转换为物理量
+         */
+        /**
+         * @brief convert Q15 back to a physical value
+         */
+        inline float Q15ToFloat(q15_t x, float full_scale = 1.0f) {
+            return FixedToFloat(x, 15) * full_scale;
+        }
+
+        /**
+         * @brief 物理量转换为Q31
+         */
+        /**
+         * @brief convert a physical value to Q31
+         */
+        inline q31_t FloatToQ31(float x, float full_scale = 1.0f) {
+            return FloatToFixed(x / full_scale, 31);
+        }
+
+        /**
+         * @brief Q31转换为物理量
+         */
+        /**
+         * @brief convert Q31 back to a physical value
+         */
+        inline float Q31ToFloat(q31_t x, float full_scale = 1.0f) {
+            return FixedToFloat(x, 31) * full_scale;
+        }
+
+        /**
+         * @brief Q15饱和加法
+         */
+        /**
+         * @brief saturating Q15 addition
+         */
+        inline q15_t AddQ15(q15_t a, q15_t b) {
+            return SatQ15((int32_t)a + b);
+        }
+
+        /**
+         * @brief Q15饱和乘法，-1 * -1 饱和为最大值
+         */
+        /**
+         * @brief saturating Q15 multiplication, -1 * -1 saturates to the maximum
+         */
+        inline q15_t MulQ15(q15_t a, q15_t b) {
+            return SatQ15(((int32_t)a * b) >> 15);
+        }
+
+        /**
+         * @brief Q31饱和加法
+         */
+        /**
+         * @brief saturating Q31 addition
+         */
+        inline q31_t AddQ31(q31_t a, q31_t b) {
+            return SatQ31((q63_t)a + b);
+        }
+
+        /**
+         * @brief Q31饱和乘法，-1 * -1 饱和为最大值
+         */
+        /**
+         * @brief saturating Q31 multiplication, -1 * -1 saturates to the maximum
+         */
+        inline q31_t MulQ31(q31_t a, q31_t b) {
+            return SatQ31(((q63_t)a * b) >> 31);
+        }
+
+    }  // namespace fixed
+
+    /**
+     * @brief 定点PID控制器
+     * @details 功能和ConstrainedPID一致的整数实现，适用于没有FPU的板子。
+     * 输入输出都是整数的物理单位（例如电机反馈的转速和发送给电机的电流值），
+     * 增益在初始化时转换为Q16.16，计算中只使用整数乘加，增益的分辨率为 2^-16。
+     * 输出和ConstrainedPID的差别在1个单位左右
+     * @note 不支持ErrorHandle（堵转检测）模式，也不支持按时间间隔缩放
+     * @note 各项的幅值（增益 * 误差）需要在int32范围内
+     */
+    /**
+     * @brief fixed point PID controller
+     * @details integer implementation with the same features as ConstrainedPID, meant for boards
+     * without an FPU. Inputs and outputs are integers in physical units (e.g. the speed reported
+     * by a motor and the current sent to it). The gains are converted to Q16.16 once during
+     * initialization and only integer multiply-adds are used per call, so gains have a resolution
+     * of 2^-16. The output stays within about one unit of ConstrainedPID.
+     * @note the ErrorHandle (motor blocked detection) mode and dt scaling are not supported
+     * @note every term (gain * error) must stay within the int32 range
+     */
+    class FixedPID {
+      public:
+        /**
+         * @brief 默认构造函数
+         */
+        /**
+         * @brief default constructor
+         */
+        FixedPID();
+
+        /**
+         * @brief 构造函数
+         *
+         * @param kp 比例增益
+         * @param ki 积分增益
+         * @param kd 微分增益
+         * @param max_iout 积分输出限制
+         * @param max_out 输出限制
+         */
+        /**
+         * @brief constructor
+         *
+         * @param kp proportional gain
+         * @param ki integral gain
+         * @param kd derivative gain
+         * @param max_iout integral output constraint
+         * @param max_out output constraint
+         */
+        FixedPID(float kp, float ki, float kd, int32_t max_iout, int32_t max_out);
+
+        /**
+         * @brief 使用ConstrainedPID的初始化结构体构造
+         * @param pid_init PID控制器的初始化结构体，限幅、死区和变速积分参数会被取整
+         */
+        /**
+         * @brief construct from the initialization structure of ConstrainedPID
+         * @param pid_init initialization structure, limits, dead band and the changing integral
+         * rate parameters are rounded to integers
+         */
+        FixedPID(ConstrainedPID::PID_Init_t pid_init);
+
+        /**
+         * @brief 计算输出
+         *
+         * @param target 目标值
+         * @param measure 测量值
+         *
+         * @return 输出值，四舍五入到整数
+         */
+        /**
+         * @brief compute the output
+         *
+         * @param target target value
+         * @param measure measured value
+         *
+         * @return output rounded to the nearest integer
+         */
+        int32_t ComputeOutput(int32_t target, int32_t measure);
+
+        /**
+         * @brief 重新初始化PID控制器，但不清除当前状态
+         */
+        /**
+         * @brief reinitialize the gains and constraints, but does not clear current states
+         */
+        void Reinit(float kp, float ki, float kd, int32_t max_iout, int32_t max_out);
+
+        /**
+         * @brief 使用结构体重新初始化PID控制器，但不清除当前状态
+         */
+        /**
+         * @brief reinitialize using an initialization structure, but does not clear current states
+         */
+        void Reinit(ConstrainedPID::PID_Init_t pid_init);
+
+        /**
+         * @brief 清除PID控制器的状态
+         */
+        /**
+         * @brief clear the remembered states of the controller
+         */
+        void Reset();
+
+        /**
+         * @brief 重设积分项
+         */
+        /**
+         * @brief clear the integral term
+         */
+        void ResetIntegral();
+
+        /**
+         * @brief 修改PID控制器的输出限制
+         */
+        /**
+         * @brief change the output constraint of the controller
+         */
+        void ChangeMax(int32_t max_iout, int32_t max_out);
+
+        /**
+         * @brief 获取PID控制器的状态，转换为浮点数，仅用于调试
+         */
+        /**
+         * @brief get the states of the controller converted to float, for debugging only
+         */
+        ConstrainedPID::PID_State_t State() const;
+
+      private:
+        // 增益，Q16.16
+        int32_t kp_ = 0;
+        int32_t ki_ = 0;
+        int32_t kd_ = 0;
+        // 限幅，Q16.16
+        int64_t max_out_ = 0;
+        int64_t max_iout_ = 0;
+        // 死区和变速积分参数，和输入的单位相同
+        int32_t dead_band_ = 0;
+        int32_t scalar_a_ = 0;
+        int32_t scalar_b_ = 0;
+        int64_t inv_scalar_a_ = 0; /* 2^62 / scalar_a_，避免M3上的64位除法 */
+        // 滤波系数，Q15，Q15_ONE表示不滤波
+        int32_t output_filter_ = fixed::Q15_ONE;
+        int32_t derivative_filter_ = fixed::Q15_ONE;
+        uint8_t mode_ = ConstrainedPID::Integral_Limit;
+
+        // 状态，误差和测量值和输入的单位相同，其余为Q16.16
+        int32_t measure_ = 0;
+        int32_t last_measure_ = 0;
+        int32_t error_ = 0;
+        int32_t last_error_ = 0;
+        int64_t pout_ = 0;
+        int64_t iout_ = 0;
+        int64_t dout_ = 0;
+        int64_t output_ = 0;
+        int64_t last_output_ = 0;
+        int64_t last_dout_ = 0;
+    };
+
+    /**
+     * @brief CMSIS-DSP的Q15 PID控制器
+     * @details 与PIDController相同，但使用arm_pid_q15计算，误差和输出都是满量程为1的Q15
+     * @note arm_pid_q15没有积分限幅，kp + ki + kd需要小于1，否则系数会被饱和
+     */
+    /**
+     * @brief Q15 PID controller of CMSIS-DSP
+     * @details same as PIDController but computed with arm_pid_q15, error and output are Q15
+     * values with a full scale of 1
+     * @note arm_pid_q15 has no integral limit, and kp + ki + kd must be less than 1 or the
+     * coefficients saturate
+     */
+    class PIDControllerQ15 {
+      public:
+        /**
+         * @brief 构造函数，增益为Q15
+         */
+        /**
+         * @brief constructor, gains are in Q15
+         */
+        PIDControllerQ15(q15_t kp = 0, q15_t ki = 0, q15_t kd = 0);
+
+        /**
+         * @brief 根据当前误差计算输出
+         */
+        /**
+         * @brief compute output base on current error
+         */
+        q15_t ComputeOutput(q15_t error);
+
+        /**
+         * @brief 重新初始化PID控制器，但不清除当前状态
+         */
+        /**
+         * @brief reinitialize the gains, but does not clear current status
+         */
+        void Reinit(q15_t kp, q15_t ki, q15_t kd);
+
+        /**
+         * @brief 清除PID控制器的状态
+         */
+        /**
+         * @brief clear the remembered states of the controller
+         */
+        void Reset();
+
+      private:
+        arm_pid_instance_q15 pid_q15_;
+    };
+
+    /**
+     * @brief CMSIS-DSP的Q31 PID控制器
+     * @details 与PIDControllerQ15相同，但使用arm_pid_q31计算
+     */
+    /**
+     * @brief Q31 PID controller of CMSIS-DSP
+     * @details same as PIDControllerQ15 but computed with arm_pid_q31
+     */
+    class PIDControllerQ31 {
+      public:
+        PIDControllerQ31(q31_t kp = 0, q31_t ki = 0, q31_t kd = 0);
+        q31_t ComputeOutput(q31_t error);
+        void Reinit(q31_t kp, q31_t ki, q31_t kd);
+        void Reset();
+
+      private:
+        arm_pid_instance_q31 pid_q31_;
+    };
+
+    /**
+     * @brief 定点斜坡信号源
+     * @details 与RampSource相同，内部以Q32.32保存输出，可以使用小于1的步长
+     */
+    /**
+     * @brief fixed point ramp signal source
+     * @details same as RampSource, the output is kept in Q32.32 internally so steps below 1 work
+     */
+    class FixedRampSource {
+      public:
+        /**
+         * @brief 构造函数
+         * @param initial 初始值
+         * @param min     最小值
+         * @param max     最大值
+         * @param step    步长，每次计算的变化量为 step * input
+         */
+        /**
+         * @brief constructor
+         * @param initial initial value
+         * @param min     min value
+         * @param max     max value
+         * @param step    step, the output changes by step * input on every call
+         */
+        FixedRampSource(int32_t initial, int32_t min, int32_t max, float step);
+        int32_t Calc(int32_t input);
+        int32_t Get() const;
+        void SetMax(int32_t max);
+        void SetMin(int32_t min);
+        void SetCurrent(int32_t current);
+
+      private:
+        int64_t output_;
+        int64_t min_;
+        int64_t max_;
+        int64_t step_;
+    };
+
+    /**
+     * @brief 定点缓动
+     * @details 与Ease相同，内部以Q32.32保存当前值，可以使用小于1的步长
+     */
+    /**
+     * @brief fixed point ease
+     * @details same as Ease, the current value is kept in Q32.32 internally so steps below 1 work
+     */
+    class FixedEase {
+      public:
+        FixedEase(int32_t initial, float step);
+        void SetTarget(int32_t target);
+        int32_t Calc(int32_t target);
+        int32_t Calc();
+        int32_t GetOutput() const;
+        int32_t GetTarget() const;
+        bool IsAtTarget() const;
+
+      private:
+        int64_t current_;
+        int64_t target_;
+        int64_t step_;
+    };
+
+    /**
+     * @brief 按板子选择的电机PID控制器
+     * @details 板子的CMake选项定义CONTROL_FIXED_POINT时为FixedPID（例如没有FPU的
+     * F103_Nano_general），否则为ConstrainedPID。两者的五参数构造函数和ComputeOutput(target,
+     * measure)兼容，以整数单位（例如电机反馈的原始转速）调用时可以直接替换
+     */
+    /**
+     * @brief motor PID controller selected per board
+     * @details FixedPID when the CMake options of the board define CONTROL_FIXED_POINT (e.g. the
+     * FPU-less F103_Nano_general), ConstrainedPID otherwise. The five argument constructors and
+     * ComputeOutput(target, measure) of the two are compatible, so they are interchangeable when
+     * called with integer units (e.g. the raw speed reported by a motor)
+     */
+#ifdef CONTROL_FIXED_POINT
+    typedef FixedPID MotorPID;
+#else
+    typedef ConstrainedPID MotorPID;
+#endif
+
+}  // namespace control
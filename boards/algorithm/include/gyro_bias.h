@@ -0,0 +1,170 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#pragma once
+
+#include "main.h"
+
+namespace control {
+
+    /**
+     * @brief 陀螺仪零漂在线估计的参数
+     */
+    /**
+     * @brief parameters of the online gyro bias estimator
+     */
+    typedef struct {
+        float gyro_noise;     /// 静止时角速度的标准差上限，单位为[rad/s]
+        float accel_noise;    /// 静止时加速度模长的标准差上限，单位为[m/s^2]
+        float max_bias;       /// 零漂的最大可能值，单位为[rad/s]
+        float window;         /// 统计均值和方差的时间常数，也是判定静止前需要持续的时间，单位为[s]
+        float ready_time;     /// 置信度从0到1需要累计的静止时间，单位为[s]
+        float time_constant;  /// 收敛后跟随零漂变化的时间常数，单位为[s]
+        float forget_time;    /// 运动时置信度衰减的时间常数，单位为[s]
+    } gyro_bias_init_t;
+
+    /**
+     * @brief 默认参数，零漂范围按MPU6500的规格(约5°/s)取
+     */
+    /**
+     * @brief default parameters, the bias range follows the MPU6500 spec (about 5 deg/s)
+     */
+    constexpr gyro_bias_init_t GYRO_BIAS_DEFAULT_INIT = {0.02f, 0.2f, 0.1f, 0.2f,
+                                                         1.0f,  5.0f, 60.0f};
+
+    /**
+     * @brief 陀螺仪零漂在线估计
+     * @details 持续统计角速度和加速度模长的滑动均值与方差，两者都足够小并且平均角速度在零漂的
+     * 可能范围内时认为静止。静止的样本按window分段平均，下一段也静止时才用这一段更新零漂，
+     * 使判定为运动之前的样本不会进入零漂：刚开始时等价于对所有静止样本求平均，累计的静止时间
+     * 达到time_constant后变为时间常数固定的一阶低通，以跟随温度造成的缓慢变化。
+     *
+     * 估计器不会阻塞姿态解算，零漂一开始为先验值(默认为0)，置信度表示累计了多少静止数据，
+     * 可以用上一次保存的零漂作为先验直接启动。置信度越高，平均角速度需要越接近当前的零漂才认为
+     * 静止，但低于gyro_noise的匀速转动仍然无法与零漂区分
+     */
+    /**
+     * @brief online gyro bias estimator
+     * @details running means and variances of the angular rate and the acceleration norm are
+     * kept all the time. The sensor is considered stationary when both are small and the average
+     * rate is within the possible range of the bias. Still samples are averaged in chunks of one
+     * window and a chunk updates the bias once the next one is still as well, so the samples
+     * before motion is detected never reach the bias: at first this is the plain average of all
+     * stationary samples, after time_constant worth of stationary data it becomes a fixed time
+     * constant low pass that follows the slow drift caused by temperature.
+     *
+     * The estimator never blocks attitude fusion. The bias starts from the prior (zero by
+     * default) and the confidence tells how much stationary data has been collected, so a bias
+     * saved from a previous run can be used as the prior to start right away. The higher the
+     * confidence, the closer the average rate has to be to the current bias to count as
+     * stationary, but a perfectly steady rotation slower than gyro_noise still cannot be told
+     * apart from the bias.
+     */
+    class GyroBiasEstimator {
+      public:
+        /**
+         * @brief 构造函数
+         * @param init 参数
+         */
+        /**
+         * @brief constructor
+         * @param init parameters
+         */
+        GyroBiasEstimator(gyro_bias_init_t init = GYRO_BIAS_DEFAULT_INIT);
+
+        /**
+         * @brief 设置零漂的先验值
+         * @param bias       零漂，单位为[rad/s]
+         * @param confidence 先验的置信度，范围为[0, 1]
+         */
+        /**
+         * @brief set a prior of the bias
+         * @param bias       bias in [rad/s]
+         * @param confidence confidence of the prior in the range [0, 1]
+         */
+        void SetPrior(const float bias[3], float confidence);
+
+        /**
+         * @brief 将置信度清零，重新开始累计静止数据，当前的零漂作为先验保留
+         */
+        /**
+         * @brief clear the confidence and start collecting stationary data again, the current bias
+         * is kept as the prior
+         */
+        void Reset();
+
+        /**
+         * @brief 更新估计
+         * @param gyro  未补偿的角速度，单位为[rad/s]
+         * @param accel 加速度，单位为[m/s^2]
+         * @param dt    距离上一次更新的时间，单位为[s]
+         */
+        /**
+         * @brief update the estimation
+         * @param gyro  uncompensated angular rate in [rad/s]
+         * @param accel acceleration in [m/s^2]
+         * @param dt    time since the last update in [s]
+         */
+        void Update(const float gyro[3], const float accel[3], float dt);
+
+        /**
+         * @brief 获取零漂的估计值，单位为[rad/s]
+         */
+        /**
+         * @brief get the estimated bias in [rad/s]
+         */
+        void GetBias(float bias[3]) const;
+
+        /**
+         * @brief 获取置信度，范围为[0, 1]，1表示已经累计了ready_time的静止数据
+         */
+        /**
+         * @brief get the confidence in the range [0, 1], 1 means ready_time worth of stationary
+         * data has been collected
+         */
+        float GetConfidence() const;
+
+        /**
+         * @brief 判断当前是否静止
+         */
+        /**
+         * @brief check if the sensor is currently stationary
+         */
+        bool IsStationary() const;
+
+      private:
+        gyro_bias_init_t param_;
+        float bias_[3] = {};
+        float weight_ = 0;       /* 零漂中累计的静止时间 */
+        float still_time_ = 0;   /* 本次连续静止的时间 */
+        bool initialized_ = false;
+        float gyro_mean_[3] = {};
+        float gyro_var_[3] = {};
+        float accel_mean_ = 0;
+        float accel_var_ = 0;
+        float chunk_sum_[2][3] = {};  /* 上一段和当前段静止样本的角速度积分 */
+        float chunk_time_[2] = {};    /* 上一段和当前段的时长 */
+
+        // 用一段静止样本的平均值更新零漂
+        void Commit(const float sum[3], float duration);
+        void ClearChunks();
+    };
+
+}  // namespace control
@@ -0,0 +1,151 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#pragma once
+
+#include "main.h"
+
+namespace control {
+
+    /**
+     * @brief 陀螺仪零漂随温度变化的模型，可以保存在flash中供下一次启动使用
+     */
+    /**
+     * @brief model of the gyro bias over temperature, may be saved to flash for the next boot
+     */
+    typedef struct {
+        float reference;    /// 参考温度，一般为加热的目标温度，单位为[°C]
+        float min_temp;     /// 拟合数据覆盖的最低温度，单位为[°C]
+        float max_temp;     /// 拟合数据覆盖的最高温度，超出范围时按端点计算，单位为[°C]
+        float coeff[3][3];  /// 每个轴的c0、c1、c2，零漂为c0 + c1*t + c2*t^2，t为与参考温度之差
+    } gyro_temp_model_t;
+
+    /**
+     * @brief 陀螺仪零漂的温度模型
+     * @details 预热过程中静止时调用AddSample()记录原始角速度，数据按block_time分块平均后
+     * 累加到二次多项式最小二乘的正规方程中，只占用固定的内存。温度覆盖的范围足够大时Fit()
+     * 给出每个轴的二次多项式。把模型保存下来并在下一次启动时用SetModel()载入，预热期间就可以
+     * 用Evaluate()补偿随温度变化的零漂，剩下的常值部分交给在线的零漂估计
+     */
+    /**
+     * @brief temperature model of the gyro bias
+     * @details while stationary during warmup AddSample() records the raw rate. The samples are
+     * averaged in blocks of block_time and accumulated into the normal equations of a quadratic
+     * least squares fit, so the memory use is fixed. Once the covered temperature span is large
+     * enough Fit() gives a quadratic per axis. Save the model and load it with SetModel() on the
+     * next boot, then Evaluate() compensates the temperature dependent bias during warmup and the
+     * online bias estimator only has to take care of the constant remainder.
+     */
+    class GyroTempModel {
+      public:
+        /**
+         * @brief 构造函数
+         * @param reference  参考温度，单位为[°C]
+         * @param block_time 每个数据块的时长，单位为[s]
+         * @param min_span   拟合需要覆盖的最小温度范围，单位为[°C]
+         */
+        /**
+         * @brief constructor
+         * @param reference  reference temperature in [°C]
+         * @param block_time length of every block of samples in [s]
+         * @param min_span   minimum temperature span required for a fit in [°C]
+         */
+        GyroTempModel(float reference, float block_time = 0.1f, float min_span = 5.0f);
+
+        /**
+         * @brief 载入模型，之后Evaluate()按该模型计算
+         */
+        /**
+         * @brief load a model that Evaluate() uses from now on
+         */
+        void SetModel(const gyro_temp_model_t& model);
+
+        /**
+         * @brief 判断是否已经载入模型
+         */
+        /**
+         * @brief check if a model has been loaded
+         */
+        bool IsValid() const;
+
+        /**
+         * @brief 计算给定温度下的零漂，没有模型时为0
+         * @param temp 温度，单位为[°C]
+         * @param bias 零漂，单位为[rad/s]
+         */
+        /**
+         * @brief compute the bias at a given temperature, zero without a model
+         * @param temp temperature in [°C]
+         * @param bias bias in [rad/s]
+         */
+        void Evaluate(float temp, float bias[3]) const;
+
+        /**
+         * @brief 记录一个静止时的样本
+         * @param temp 温度，单位为[°C]
+         * @param gyro 未补偿的角速度，单位为[rad/s]
+         * @param dt   距离上一次记录的时间，单位为[s]
+         */
+        /**
+         * @brief record a stationary sample
+         * @param temp temperature in [°C]
+         * @param gyro uncompensated angular rate in [rad/s]
+         * @param dt   time since the last sample in [s]
+         */
+        void AddSample(float temp, const float gyro[3], float dt);
+
+        /**
+         * @brief 清空记录的样本
+         */
+        /**
+         * @brief clear the recorded samples
+         */
+        void ClearSamples();
+
+        /**
+         * @brief 用记录的样本拟合模型，不影响当前载入的模型
+         * @param model 拟合的结果
+         * @return 温度范围不足或者方程病态时返回false
+         */
+        /**
+         * @brief fit a model to the recorded samples, the loaded model is not affected
+         * @param model result of the fit
+         * @return false if the temperature span is too small or the equations are ill conditioned
+         */
+        bool Fit(gyro_temp_model_t* model) const;
+
+      private:
+        float reference_;
+        float block_time_;
+        float min_span_;
+        gyro_temp_model_t model_ = {};
+        bool valid_ = false;
+
+        float block_elapsed_ = 0;
+        float block_temp_ = 0;
+        float block_gyro_[3] = {};
+        // 正规方程的累加量，温差缩小10倍以保持数值范围
+        float sum_x_[5] = {};
+        float sum_xy_[3][3] = {};
+        float min_temp_ = 0;
+        float max_temp_ = 0;
+    };
+
+}  // namespace control
@@ -0,0 +1,279 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#pragma once
+
+#include <math.h>
+
+#include "main.h"
+
+namespace control {
+
+    /**
+     * @brief 维度在编译期确定的卡尔曼滤波器
+     * @details 所有矩阵都是成员数组，不使用动态内存，可以放在栈上或者静态存储中，也可以同时存在
+     * 任意多个实例。循环边界都是编译期常量，编译器可以完全展开。协方差只计算上三角再镜像，
+     * 保证对称并节省约一半的计算量。新息协方差S是对称正定的，用Cholesky分解求逆，不需要通用的
+     * 矩阵求逆。
+     *
+     * 线性系统直接调用Predict()和Update()；扩展卡尔曼滤波自己完成非线性的状态预测和观测，
+     * 只使用PredictCovariance()、ComputeGain()、Correct()和UpdateCovariance()这几个步骤
+     *
+     * @tparam NX 状态的维度
+     * @tparam NZ 观测的维度
+     * @tparam NU 控制输入的维度，可以为0
+     */
+    /**
+     * @brief Kalman filter with compile time dimensions
+     * @details every matrix is a member array, nothing is allocated, so instances can live on the
+     * stack or in static storage and any number of them can coexist. All loop bounds are compile
+     * time constants the compiler can fully unroll. Only the upper triangle of the covariance is
+     * computed and then mirrored, which keeps it symmetric and saves about half of the work. The
+     * innovation covariance S is symmetric positive definite and is inverted through a Cholesky
+     * factorization instead of a general matrix inverse.
+     *
+     * Linear systems call Predict() and Update(). An extended Kalman filter does the nonlinear
+     * state prediction and observation itself and only uses the PredictCovariance(),
+     * ComputeGain(), Correct() and UpdateCovariance() steps.
+     *
+     * @tparam NX dimension of the state
+     * @tparam NZ dimension of the measurement
+     * @tparam NU dimension of the control input, may be 0
+     */
+    template <int NX, int NZ, int NU = 0>
+    class KalmanFilter {
+      public:
+        static_assert(NX > 0 && NZ > 0 && NU >= 0, "invalid kalman filter dimensions");
+
+        float x[NX] = {};                   /* 状态估计 */
+        float P[NX][NX] = {};               /* 状态协方差 */
+        float F[NX][NX] = {};               /* 状态转移矩阵 */
+        float B[NX][NU > 0 ? NU : 1] = {};  /* 控制矩阵 */
+        float Q[NX][NX] = {};               /* 过程噪声协方差 */
+        float H[NZ][NX] = {};               /* 观测矩阵 */
+        float R[NZ][NZ] = {};               /* 观测噪声协方差 */
+        float K[NX][NZ] = {};               /* 卡尔曼增益 */
+        float S_inv[NZ][NZ] = {};           /* 新息协方差的逆 */
+
+        /**
+         * @brief 线性状态预测 x = F*x + B*u，并预测协方差
+         * @param u 控制输入，NU为0时忽略
+         */
+        /**
+         * @brief linear state prediction x = F*x + B*u followed by the covariance prediction
+         * @param u control input, ignored when NU is 0
+         */
+        void Predict(const float* u = nullptr) {
+            float next[NX];
+            for (int i = 0; i < NX; ++i) {
+                float sum = 0;
+                for (int j = 0; j < NX; ++j)
+                    sum += F[i][j] * x[j];
+                for (int j = 0; j < NU; ++j)
+                    sum += u != nullptr ? B[i][j] * u[j] : 0;
+                next[i] = sum;
+            }
+            for (int i = 0; i < NX; ++i)
+                x[i] = next[i];
+            PredictCovariance();
+        }
+
+        /**
+         * @brief 预测协方差 P = F*P*F' + Q
+         */
+        /**
+         * @brief predict the covariance P = F*P*F' + Q
+         */
+        void PredictCovariance() {
+            float FP[NX][NX];
+            for (int i = 0; i < NX; ++i)
+                for (int j = 0; j < NX; ++j) {
+                    float sum = 0;
+                    for (int k = 0; k < NX; ++k)
+                        sum += F[i][k] * P[k][j];
+                    FP[i][j] = sum;
+                }
+            for (int i = 0; i < NX; ++i)
+                for (int j = i; j < NX; ++j) {
+                    float sum = Q[i][j];
+                    for (int k = 0; k < NX; ++k)
+                        sum += FP[i][k] * F[j][k];
+                    P[i][j] = P[j][i] = sum;
+                }
+        }
+
+        /**
+         * @brief 计算新息协方差的逆S_inv和卡尔曼增益K = P*H'*S_inv
+         * @return S不是正定矩阵时返回false，此时K和S_inv保持不变
+         */
+        /**
+         * @brief compute the inverse of the innovation covariance S_inv and the Kalman gain
+         * K = P*H'*S_inv
+         * @return false if S is not positive definite, K and S_inv are left unchanged
+         */
+        bool ComputeGain() {
+            for (int i = 0; i < NX; ++i)
+                for (int j = 0; j < NZ; ++j) {
+                    float sum = 0;
+                    for (int k = 0; k < NX; ++k)
+                        sum += P[i][k] * H[j][k];
+                    PHt_[i][j] = sum;
+                }
+            float S[NZ][NZ];
+            for (int i = 0; i < NZ; ++i)
+                for (int j = i; j < NZ; ++j) {
+                    float sum = R[i][j];
+                    for (int k = 0; k < NX; ++k)
+                        sum += H[i][k] * PHt_[k][j];
+                    S[i][j] = S[j][i] = sum;
+                }
+            if (!InvertSymmetric(S, S_inv))
+                return false;
+            for (int i = 0; i < NX; ++i)
+                for (int j = 0; j < NZ; ++j) {
+                    float sum = 0;
+                    for (int k = 0; k < NZ; ++k)
+                        sum += PHt_[i][k] * S_inv[k][j];
+                    K[i][j] = sum;
+                }
+            return true;
+        }
+
+        /**
+         * @brief 计算新息的马氏距离平方 y'*S_inv*y，用于卡方检验
+         * @param y 新息，即观测值减去预测的观测值
+         */
+        /**
+         * @brief squared Mahalanobis distance of the innovation y'*S_inv*y for a chi-square test
+         * @param y innovation, i.e. measurement minus predicted measurement
+         */
+        float Mahalanobis(const float y[NZ]) const {
+            float sum = 0;
+            for (int i = 0; i < NZ; ++i)
+                for (int j = 0; j < NZ; ++j)
+                    sum += y[i] * S_inv[i][j] * y[j];
+            return sum;
+        }
+
+        /**
+         * @brief 用新息修正状态 x = x + K*y
+         */
+        /**
+         * @brief correct the state with the innovation x = x + K*y
+         */
+        void Correct(const float y[NZ]) {
+            for (int i = 0; i < NX; ++i) {
+                float sum = 0;
+                for (int j = 0; j < NZ; ++j)
+                    sum += K[i][j] * y[j];
+                x[i] += sum;
+            }
+        }
+
+        /**
+         * @brief 更新协方差 P = P - K*H*P，只计算上三角
+         * @note 使用ComputeGain()中保存的P*H'，因此调用前不能修改P和H
+         */
+        /**
+         * @brief update the covariance P = P - K*H*P, only the upper triangle is computed
+         * @note uses P*H' saved by ComputeGain(), so P and H must not change in between
+         */
+        void UpdateCovariance() {
+            // H*P = (P*H')'，P对称
+            for (int i = 0; i < NX; ++i)
+                for (int j = i; j < NX; ++j) {
+                    float sum = 0;
+                    for (int k = 0; k < NZ; ++k)
+                        sum += K[i][k] * PHt_[j][k];
+                    P[i][j] -= sum;
+                    P[j][i] = P[i][j];
+                }
+        }
+
+        /**
+         * @brief 线性观测更新
+         * @param z 观测值
+         * @return S不是正定矩阵时不更新并返回false
+         */
+        /**
+         * @brief linear measurement update
+         * @param z measurement
+         * @return false without updating if S is not positive definite
+         */
+        bool Update(const float z[NZ]) {
+            float y[NZ];
+            for (int i = 0; i < NZ; ++i) {
+                float sum = z[i];
+                for (int j = 0; j < NX; ++j)
+                    sum -= H[i][j] * x[j];
+                y[i] = sum;
+            }
+            if (!ComputeGain())
+                return false;
+            Correct(y);
+            UpdateCovariance();
+            return true;
+        }
+
+      private:
+        float PHt_[NX][NZ] = {};
+
+        // 用Cholesky分解S = L*L'求对称正定矩阵的逆
+        static bool InvertSymmetric(const float S[NZ][NZ], float out[NZ][NZ]) {
+            float L[NZ][NZ] = {};
+            for (int j = 0; j < NZ; ++j) {
+                float diagonal = S[j][j];
+                for (int k = 0; k < j; ++k)
+                    diagonal -= L[j][k] * L[j][k];
+                if (!(diagonal > 0))
+                    return false;
+                L[j][j] = sqrtf(diagonal);
+                const float inv = 1.0f / L[j][j];
+                for (int i = j + 1; i < NZ; ++i) {
+                    float sum = S[i][j];
+                    for (int k = 0; k < j; ++k)
+                        sum -= L[i][k] * L[j][k];
+                    L[i][j] = sum * inv;
+                }
+            }
+            // L的逆仍是下三角
+            float Li[NZ][NZ] = {};
+            for (int i = 0; i < NZ; ++i) {
+                Li[i][i] = 1.0f / L[i][i];
+                for (int j = 0; j < i; ++j) {
+                    float sum = 0;
+                    for (int k = j; k < i; ++k)
+                        sum -= L[i][k] * Li[k][j];
+                    Li[i][j] = sum * Li[i][i];
+                }
+            }
+            // S^-1 = L^-T * L^-1
+            for (int i = 0; i < NZ; ++i)
+                for (int j = i; j < NZ; ++j) {
+                    float sum = 0;
+                    for (int k = j; k < NZ; ++k)
+                        sum += Li[k][i] * Li[k][j];
+                    out[i][j] = out[j][i] = sum;
+                }
+            return true;
+        }
+    };
+
+}  // namespace control
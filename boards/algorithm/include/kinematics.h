@@ -0,0 +1,220 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#pragma once
+
+#include "main.h"
+
+#define MAX_WHEEL_NUM 8
+
+namespace control {
+
+    /**
+     * @brief 轮子的类型
+     */
+    /**
+     * @brief types of wheels
+     */
+    typedef enum {
+        WHEEL_MECANUM,      /// 麦克纳姆轮
+        WHEEL_OMNI,         /// 全向轮
+        WHEEL_SWERVE,       /// 舵轮，由转向电机控制轮子朝向
+        WHEEL_DIFFERENTIAL  /// 普通轮，没有侧向的自由度
+    } wheel_type_t;
+
+    /**
+     * @brief 单个轮子的安装位置和朝向
+     * @details 底盘坐标系x轴向右，y轴向前，角速度逆时针为正。驱动方向为电机正转时轮子接地点
+     * 相对底盘运动的方向，所以左右镜像安装的电机只需要让heading相差π。麦克纳姆轮的辊子角是
+     * 从驱动方向逆时针转到辊子轴线的角度，辊子轴线方向不能打滑，一般为±π/4；全向轮和普通轮
+     * 为0。舵轮的heading为转向电机零位时的驱动方向。半径除以减速比后，输出即为电机转子的角速度
+     */
+    /**
+     * @brief mounting position and direction of one wheel
+     * @details the chassis frame has x to the right, y to the front and counter-clockwise positive
+     * turning. The heading is the direction the contact point moves relative to the chassis when
+     * the motor turns forward, so mirrored motors on the left and right just differ by π. The
+     * roller angle of a mecanum wheel is measured counter-clockwise from the heading to the roller
+     * axis, the direction that cannot slip, usually ±π/4; it is 0 for omni and plain wheels. The
+     * heading of a swerve module is its driving direction at the zero of the steering motor.
+     * Divide the radius by the gear ratio to get the speed of the motor rotor as output
+     */
+    typedef struct {
+        wheel_type_t type;  /// 轮子类型
+        float x;            /// 相对旋转中心向右的位置，单位为[m]
+        float y;            /// 相对旋转中心向前的位置，单位为[m]
+        float heading;      /// 驱动方向，从x轴逆时针计，单位为[rad]
+        float roller;       /// 辊子角，单位为[rad]
+        float radius;       /// 轮子半径，单位为[m]
+    } wheel_geometry_t;
+
+    /**
+     * @brief 通用的N轮底盘运动学
+     * @details 构造时根据轮子的几何描述预先算好逆运动学矩阵，每个控制周期只需要一次3维向量的
+     * 点乘（舵轮两次）。轮速超过上限时所有轮子按同一比例缩小，底盘的运动方向和转弯半径不变。
+     * 舵轮转向超过90°时改为反转轮子并转到补角，转向电机最多只需要转90°。正运动学用预先算好的
+     * 最小二乘伪逆，由轮速（和舵轮角度）估计底盘速度；差速底盘侧向速度不可观，估计值为0
+     */
+    /**
+     * @brief generic kinematics for chassis with N wheels
+     * @details the inverse kinematics matrix is precomputed from the wheel geometry, so every
+     * control cycle only costs one 3-vector dot product per wheel (two for a swerve module). Wheel
+     * speeds above the limit are all scaled down by the same ratio, which keeps the direction of
+     * motion and the turning radius. A swerve module that would steer more than 90° reverses the
+     * wheel and steers to the supplementary angle instead, so the steering motor never turns more
+     * than 90°. The forward kinematics estimates the chassis velocity from the wheel speeds (and
+     * module angles) with a precomputed least squares pseudo inverse; the lateral velocity of a
+     * differential chassis is not observable and is estimated as 0
+     */
+    class Kinematics {
+      public:
+        /**
+         * @brief 构造函数
+         *
+         * @param wheels    每个轮子的几何描述，顺序与电机顺序一致
+         * @param wheel_num 轮子数量，不超过MAX_WHEEL_NUM
+         * @param max_speed 轮子的最大角速度，单位为[rad/s]
+         */
+        /**
+         * @brief constructor
+         *
+         * @param wheels    geometry of every wheel, in the same order as the motors
+         * @param wheel_num number of wheels, no more than MAX_WHEEL_NUM
+         * @param max_speed maximum angular velocity of the wheels, in [rad/s]
+         */
+        Kinematics(const wheel_geometry_t* wheels, int wheel_num, float max_speed);
+
+        /**
+         * @brief 逆运动学，由底盘速度计算每个轮子的角速度和舵轮的角度
+         *
+         * @param vx    向右的速度，单位为[m/s]
+         * @param vy    向前的速度，单位为[m/s]
+         * @param wz    逆时针的角速度，单位为[rad/s]
+         * @param speed 输出每个轮子的角速度，单位为[rad/s]
+         * @param angle 输出每个轮子相对转向零位的角度，范围为[-π, π)，单位为[rad]，可以为nullptr
+         *
+         * @return 为了不超过最大轮速对底盘速度的缩放系数，范围为(0, 1]
+         */
+        /**
+         * @brief inverse kinematics, angular velocity of every wheel and angle of the swerve
+         * modules from the chassis velocity
+         *
+         * @param vx    velocity to the right, in [m/s]
+         * @param vy    velocity to the front, in [m/s]
+         * @param wz    counter-clockwise angular velocity, in [rad/s]
+         * @param speed output angular velocity of every wheel, in [rad/s]
+         * @param angle output angle of every wheel to its steering zero in [-π, π), in [rad], may
+         *              be nullptr
+         *
+         * @return scale applied to the chassis velocity to stay within the maximum wheel speed,
+         *         in (0, 1]
+         */
+        float Inverse(float vx, float vy, float wz, float* speed, float* angle = nullptr);
+
+        /**
+         * @brief 正运动学，由每个轮子的角速度估计底盘速度
+         *
+         * @param speed 每个轮子的角速度，单位为[rad/s]
+         * @param angle 每个轮子相对转向零位的角度，单位为[rad]，为nullptr时使用上一次的指令角度
+         * @param vx    输出向右的速度，单位为[m/s]
+         * @param vy    输出向前的速度，单位为[m/s]
+         * @param wz    输出逆时针的角速度，单位为[rad/s]
+         */
+        /**
+         * @brief forward kinematics, chassis velocity estimated from the wheel speeds
+         *
+         * @param speed angular velocity of every wheel, in [rad/s]
+         * @param angle angle of every wheel to its steering zero, in [rad], the last commanded
+         *              angles are used when nullptr
+         * @param vx    output velocity to the right, in [m/s]
+         * @param vy    output velocity to the front, in [m/s]
+         * @param wz    output counter-clockwise angular velocity, in [rad/s]
+         */
+        void Forward(const float* speed, const float* angle, float* vx, float* vy,
+                     float* wz) const;
+
+        /**
+         * @brief 底盘以给定速度运动且没有打滑时单个轮子的角速度，舵轮按当前角度投影，不做限幅
+         *
+         * @param wheel 轮子序号
+         * @param vx    向右的速度，单位为[m/s]
+         * @param vy    向前的速度，单位为[m/s]
+         * @param wz    逆时针的角速度，单位为[rad/s]
+         *
+         * @return 轮子的角速度，单位为[rad/s]
+         */
+        /**
+         * @brief angular velocity of one wheel when the chassis moves at the given velocity
+         * without slip, swerve modules are projected on their current angle, nothing is limited
+         *
+         * @param wheel index of the wheel
+         * @param vx    velocity to the right, in [m/s]
+         * @param vy    velocity to the front, in [m/s]
+         * @param wz    counter-clockwise angular velocity, in [rad/s]
+         *
+         * @return angular velocity of the wheel, in [rad/s]
+         */
+        float Project(int wheel, float vx, float vy, float wz) const;
+
+        /**
+         * @brief 设置轮子的最大角速度
+         *
+         * @param max_speed 最大角速度，单位为[rad/s]
+         */
+        /**
+         * @brief set the maximum angular velocity of the wheels
+         *
+         * @param max_speed maximum angular velocity, in [rad/s]
+         */
+        void SetMaxSpeed(float max_speed);
+
+        /**
+         * @brief 设置舵轮当前的角度，比如转向电机校准后，下一次逆运动学从该角度开始优化
+         *
+         * @param wheel 轮子序号
+         * @param angle 相对转向零位的角度，单位为[rad]
+         */
+        /**
+         * @brief set the current angle of a swerve module, e.g. after the steering motor is
+         * aligned, the next inverse kinematics optimizes the steering from there
+         *
+         * @param wheel index of the wheel
+         * @param angle angle to the steering zero, in [rad]
+         */
+        void SetModuleAngle(int wheel, float angle);
+
+        int GetWheelNum() const;
+
+        bool IsSwerve(int wheel) const;
+
+      private:
+        int wheel_num_;
+        float max_speed_;
+        wheel_type_t type_[MAX_WHEEL_NUM];
+
+        // 逆运动学矩阵，舵轮使用两行 / inverse kinematics matrix, swerve modules use both rows
+        float inverse_[MAX_WHEEL_NUM][2][3];
+        // 正运动学的伪逆，每个轮子两列 / forward pseudo inverse, two columns per wheel
+        float forward_[3][MAX_WHEEL_NUM][2];
+
+        float angle_[MAX_WHEEL_NUM];
+    };
+
+}  // namespace control
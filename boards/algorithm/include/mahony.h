@@ -0,0 +1,154 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#pragma once
+
+#include "main.h"
+
+namespace control {
+
+    /**
+     * @brief Mahony姿态解算的增益
+     */
+    /**
+     * @brief gains of the Mahony attitude filter
+     */
+    typedef struct {
+        float kp;            /// 比例增益，决定加速度计(和磁力计)修正陀螺仪的速度
+        float ki;            /// 积分增益，用于估计陀螺仪零漂，0表示不使用
+        float startup_kp;    /// 启动阶段的比例增益，用于快速收敛，不大于kp表示不使用
+        float startup_time;  /// 启动阶段的时长，单位为[s]
+    } mahony_init_t;
+
+    /**
+     * @brief 默认增益，与原来的MahonyAHRS.c相同，并在启动的1秒内使用较大的比例增益
+     */
+    /**
+     * @brief default gains, the same as the old MahonyAHRS.c plus a high proportional gain during
+     * the first second
+     */
+    constexpr mahony_init_t MAHONY_DEFAULT_INIT = {0.5f, 0.0f, 5.0f, 1.0f};
+
+    /**
+     * @brief Mahony互补滤波姿态解算
+     * @details 每个实例拥有自己的四元数、积分项和增益，可以同时存在多个实例。每次更新使用实际的
+     * 时间间隔，四元数按照旋转增量的级数展开积分，采样率较低时也不会因为一阶近似产生漂移。
+     * 启动阶段使用startup_kp快速收敛到加速度计给出的姿态，之后切换为kp以降低噪声，
+     * 启动阶段不进行积分以免初始的大误差造成积分饱和
+     */
+    /**
+     * @brief Mahony complementary attitude filter
+     * @details every instance owns its quaternion, integral and gains so multiple instances can
+     * coexist. Every update uses the measured time step and the quaternion is integrated with a
+     * series expansion of the rotation increment, so low sample rates do not drift because of a
+     * first order approximation. During startup startup_kp quickly pulls the attitude to the one
+     * given by the accelerometer, afterwards kp takes over to reduce noise. The integral is frozen
+     * during startup so the large initial error does not wind it up.
+     */
+    class Mahony {
+      public:
+        /**
+         * @brief 构造函数
+         * @param init 增益
+         */
+        /**
+         * @brief constructor
+         * @param init gains
+         */
+        Mahony(mahony_init_t init = MAHONY_DEFAULT_INIT);
+
+        /**
+         * @brief 修改增益，立即生效，不会重新开始启动阶段
+         */
+        /**
+         * @brief change the gains, takes effect immediately and does not restart the startup phase
+         */
+        void SetGain(mahony_init_t init);
+
+        /**
+         * @brief 将姿态重置为单位四元数，清空积分项并重新开始启动阶段
+         */
+        /**
+         * @brief reset the attitude to identity, clear the integral and restart the startup phase
+         */
+        void Reset();
+
+        /**
+         * @brief 用加速度计测量的重力方向初始化roll和pitch，yaw为0，并重新开始启动阶段
+         */
+        /**
+         * @brief initialize roll and pitch from the gravity measured by the accelerometer with zero
+         * yaw, and restart the startup phase
+         */
+        void Reset(float ax, float ay, float az);
+
+        /**
+         * @brief 使用陀螺仪和加速度计更新姿态
+         * @param gx, gy, gz 角速度，单位为[rad/s]
+         * @param ax, ay, az 加速度，单位任意，全为0时只积分陀螺仪
+         * @param dt         距离上一次更新的时间，单位为[s]
+         */
+        /**
+         * @brief update the attitude with gyroscope and accelerometer
+         * @param gx, gy, gz angular rate in [rad/s]
+         * @param ax, ay, az acceleration in any unit, only the gyroscope is integrated if all zero
+         * @param dt         time since the last update in [s]
+         */
+        void Update(float gx, float gy, float gz, float ax, float ay, float az, float dt);
+
+        /**
+         * @brief 使用陀螺仪、加速度计和磁力计更新姿态，磁力计全为0时退化为不使用磁力计
+         * @param mx, my, mz 磁场强度，单位任意
+         */
+        /**
+         * @brief update the attitude with gyroscope, accelerometer and magnetometer, falls back to
+         * the version without magnetometer if the magnetometer reads all zero
+         * @param mx, my, mz magnetic field in any unit
+         */
+        void Update(float gx, float gy, float gz, float ax, float ay, float az, float mx, float my,
+                    float mz, float dt);
+
+        /**
+         * @brief 获取姿态四元数，顺序为w, x, y, z
+         */
+        /**
+         * @brief get the attitude quaternion in the order of w, x, y, z
+         */
+        void GetQuaternion(float q[4]) const;
+
+        /**
+         * @brief 判断启动阶段是否已经结束
+         */
+        /**
+         * @brief check if the startup phase has finished
+         */
+        bool IsConverged() const;
+
+      private:
+        mahony_init_t param_;
+        float q_[4] = {1, 0, 0, 0};
+        float integral_[3] = {};
+        float elapsed_ = 0;
+
+        // 由姿态误差计算修正后的角速度，并积分四元数
+        void Correct(float gx, float gy, float gz, float ex, float ey, float ez, float dt);
+    };
+
+}  // namespace control
@@ -27,6 +27,7 @@
 // clang-format on
 
 #include "arm_math.h"
+#include "utils.h"
 
 namespace control {
 
@@ -162,6 +163,50 @@ namespace control {
         arm_pid_instance_f32 pid_f32_;
     };
 
+    namespace pid_internal {
+
+        /**
+         * @brief ConstrainedPID和PID共用的参数
+         */
+        /**
+         * @brief parameters shared by ConstrainedPID and PID
+         */
+        typedef struct {
+            float kp;         /// 比例系数
+            float ki;         /// 积分系数
+            float kd;         /// 微分系数
+            float max_out;    /// 输出限制
+            float max_iout;   /// 积分输出限制
+            float dead_band;  /// 死区
+            float scalar_a;   /// For Changing Integral
+            float scalar_b;   /// ITerm = Err*((A-abs(err)+B)/A)  when B<|err|<A+B
+            float output_filtering_coefficient;      /// 输出滤波系数
+            float derivative_filtering_coefficient;  /// 微分滤波系数
+        } pid_param_t;
+
+        /**
+         * @brief ConstrainedPID和PID共用的状态
+         */
+        /**
+         * @brief states shared by ConstrainedPID and PID
+         */
+        typedef struct {
+            float target;        /// 目标值
+            float measure;       /// 当前实际值
+            float last_measure;  /// 上一次实际值
+            float error;         /// 误差
+            float last_error;    /// 上一次误差
+            float pout;          /// 比例输出
+            float iout;          /// 积分输出
+            float dout;          /// 微分输出
+            float iterm;         /// 积分临时变量
+            float output;        /// 输出值
+            float last_output;   /// 上一次输出值
+            float last_dout;     /// 上一次微分输出
+        } pid_state_t;
+
+    }  // namespace pid_internal
+
     /**
      * @brief 带有积分输出限制的PID控制器，又名复杂PID控制器
      * @note
@@ -305,6 +350,73 @@ namespace control {
          */
         float ComputeOutput(float target, float measure = 0);
 
+        /**
+         * @brief 根据当前误差和距上次调用的时间间隔计算输出
+         *
+         * @param target 目标值
+         * @param measure 当前实际值
+         * @param dt 距上次调用的时间间隔，单位为 [s]
+         * @return 可以将误差驱动到0的输出值
+         *
+         * @note 仅在调用SetControlPeriod()设置了整定周期后生效，否则与不带dt的版本完全相同。
+         * 积分项按 dt / 整定周期 缩放，微分项按 整定周期 / dt 缩放，
+         * 因此同一组参数在不同控制频率下的闭环响应一致。
+         * 第一次调用和dt异常（小于0.1倍或大于5倍整定周期）时按整定周期积分并跳过本次微分
+         */
+        /**
+         * @brief compute output base on current error and the time elapsed since the last call
+         *
+         * @param target target value
+         * @param measure measured value
+         * @param dt time since the last call in [s]
+         * @return output value that could potentially drive the error to 0
+         *
+         * @note only takes effect after SetControlPeriod() is called, otherwise it is identical to
+         * the version without dt. The integral term is scaled by dt / tuned period and the
+         * derivative term by tuned period / dt, so the same gains give the same closed loop
+         * response at any control rate. On the first call and for outliers (below 0.1 or above 5
+         * times the tuned period) the integral uses the tuned period and the derivative is skipped
+         * once.
+         */
+        float ComputeOutput(float target, float measure, float dt);
+
+        /**
+         * @brief 根据当前误差和时间戳计算输出
+         *
+         * @param target 目标值
+         * @param measure 当前实际值
+         * @param timestamp_us 当前时间戳，单位为 [us]，允许溢出回绕
+         * @return 可以将误差驱动到0的输出值
+         */
+        /**
+         * @brief compute output base on current error and a timestamp
+         *
+         * @param target target value
+         * @param measure measured value
+         * @param timestamp_us current time in [us], wrap around is handled
+         * @return output value that could potentially drive the error to 0
+         */
+        float ComputeOutputWithTimestamp(float target, float measure, uint32_t timestamp_us);
+
+        /**
+         * @brief 设置参数整定时的控制周期，开启按实际时间间隔计算积分和微分
+         * @param period 整定周期，单位为 [s]，为0时关闭（默认，兼容旧的按调用次数计算的行为）
+         */
+        /**
+         * @brief set the control period the gains were tuned at, enabling dt aware integral and
+         * derivative terms
+         * @param period tuned period in [s], 0 disables it (default, legacy per call behavior)
+         */
+        void SetControlPeriod(float period);
+
+        /**
+         * @brief 获取参数整定时的控制周期，为0时表示未开启
+         */
+        /**
+         * @brief get the control period the gains were tuned at, 0 if disabled
+         */
+        float GetControlPeriod() const;
+
         /**
          * @brief 根据当前误差计算输出，但输出值被限制在DJI电机的范围内（适用于DJI电机输出）
          * @param target 目标值
@@ -371,41 +483,19 @@ namespace control {
         void RegisterErrorCallcack(PID_ErrorCallback_t callback, void* instance);
 
       private:
-        float target_ = 0.0f;                 /// 目标值
-        float last_none_zero_target_ = 0.0f;  /// 上一次非零目标值
-        float kp_ = 0.0f;                     /// 比例系数
-        float ki_ = 0.0f;                     /// 积分系数
-        float kd_ = 0.0f;                     /// 微分系数
-
-        float pout_ = 0.0f;   /// 比例输出
-        float iout_ = 0.0f;   /// 积分输出
-        float dout_ = 0.0f;   /// 微分输出
-        float iterm_ = 0.0f;  /// 积分临时变量
-
-        float measure_ = 0.0f;       /// 当前实际值
-        float last_measure_ = 0.0f;  /// 上一次实际值
-
-        float error_ = 0.0f;       /// 误差
-        float last_error_ = 0.0f;  /// 上一次误差
-
-        float output_ = 0.0f;       /// 输出值
-        float last_output_ = 0.0f;  /// 上一次输出值
-        float last_dout_ = 0.0f;    /// 上一次微分输出
-
-        float max_iout_ = 0.0f;        /// 积分输出限制
-        float max_out_ = 0.0f;         /// 输出限制
-        float dead_band_ = 0.0f;       /// 死区
+        pid_internal::pid_param_t param_ = {};  /// PID参数
+        pid_internal::pid_state_t state_ = {};  /// PID状态
+
         float control_period_ = 0.0f;  /// 控制周期
-        float max_error_ = 0.0f;       /// 最大误差
 
-        float ScalarA = 0.0f;  /// For Changing Integral
-        float ScalarB = 0.0f;  /// ITerm = Err*((A-abs(err)+B)/A)  when B<|err|<A+B
-        float Output_Filtering_Coefficient = 0.0f;      /// 输出滤波系数
-        float Derivative_Filtering_Coefficient = 0.0f;  /// 微分滤波系数
+        uint32_t thistime = 0;  /// 本次调用的时间戳 [us]
+        uint32_t lasttime = 0;  /// 上一次调用的时间戳 [us]
+        float dtime = 0.0f;     /// 本次使用的时间间隔 [s]
 
-        uint32_t thistime = 0;
-        uint32_t lasttime = 0;
-        uint8_t dtime = 0;
+        float integral_scale_ = 1.0f;    /// 积分项的时间缩放系数
+        float derivative_scale_ = 1.0f;  /// 微分项的时间缩放系数
+        bool derivative_ready_ = false;  /// 是否已有可用于计算微分的上一次数据
+        bool timestamp_ready_ = false;   /// 是否已有上一次的时间戳
 
         uint8_t mode_ = 0x00;  /// PID控制器的模式
 
@@ -420,23 +510,297 @@ namespace control {
         };
         void* error_callback_instance_ = nullptr;
 
+        float Compute(float target, float measure);
+
         void PID_ErrorHandle();
+    };
+
+    namespace pid_internal {
+
+        /**
+         * @brief 运行时决定的PID模式，每次计算都需要判断模式位
+         */
+        /**
+         * @brief PID mode known at run time, every stage checks its mode bit
+         */
+        struct RuntimeMode {
+            uint8_t mode;
+            bool Has(uint8_t flag) const {
+                return mode & flag;
+            }
+        };
+
+        /**
+         * @brief 编译期决定的PID模式，未使用的功能在编译时被优化掉
+         */
+        /**
+         * @brief PID mode known at compile time, unused stages are folded away by the compiler
+         */
+        template <uint8_t MODE>
+        struct StaticMode {
+            static constexpr bool Has(uint8_t flag) {
+                return MODE & flag;
+            }
+        };
 
-        void PID_TrapezoidIntegral();
+        /**
+         * @brief ConstrainedPID和PID共用的计算过程
+         * @details 参考此文章中的实现 https://www.cnblogs.com/WangHongxi/p/12404424.html
+         */
+        /**
+         * @brief computation shared by ConstrainedPID and PID
+         *
+         * @param s                 controller states
+         * @param p                 controller parameters
+         * @param mode              RuntimeMode or StaticMode
+         * @param target            target value
+         * @param measure           measured value
+         * @param integral_scale    time scale of the integral term, 1 for per call integration
+         * @param derivative_scale  time scale of the derivative term, 1 for per call derivative
+         *
+         * @return controller output
+         */
+        template <typename Mode>
+        inline float Compute(pid_state_t& s, const pid_param_t& p, Mode mode, float target,
+                             float measure, float integral_scale, float derivative_scale) {
+            // 更新目标值和当前的测量值
+            s.target = target;
+            s.measure = measure;
+            s.error = s.target - s.measure;
+
+            // 如果误差小于死区，则不进行处理
+            if (fabsf(s.error) > p.dead_band) {
+                // 比死区大，则进行pid计算
+                s.pout = p.kp * s.error;
+                // 此处的iterm仅仅计算了当前的积分值，累积积分值后续会进行计算
+                s.iterm = p.ki * integral_scale * s.error;
+                s.dout = p.kd * derivative_scale * (s.error - s.last_error);
+
+                // 梯形积分计算
+                if (mode.Has(ConstrainedPID::Trapezoid_Intergral)) {
+                    s.iterm = p.ki * integral_scale * (s.error + s.last_error) / 2;
+                }
+
+                // 变速积分，参考此文章中的变速积分计算
+                // https://www.cnblogs.com/WangHongxi/p/12409382.html
+                if (mode.Has(ConstrainedPID::ChangingIntegralRate)) {
+                    // 符号相同，且误差超出了全速积分的范围
+                    if (s.error * s.iout > 0 && fabsf(s.error) > p.scalar_b) {
+                        if (fabsf(s.error) <= (p.scalar_a + p.scalar_b)) {
+                            s.iterm *= (p.scalar_a + p.scalar_b - fabsf(s.error)) / p.scalar_a;
+                        } else {
+                            s.iterm = 0;
+                        }
+                    }
+                }
+
+                // 积分限幅
+                if (mode.Has(ConstrainedPID::Integral_Limit)) {
+                    const float temp_iout = s.iout + s.iterm;
+                    const float temp_output = s.pout + s.iout + s.dout;
+                    if (fabsf(temp_output) > p.max_out) {
+                        if (s.error * s.iout > 0) {
+                            // Integral still increasing
+                            s.iterm = 0;
+                        }
+                    }
+                    if (temp_iout > p.max_iout) {
+                        s.iterm = 0;
+                        s.iout = p.max_iout;
+                    }
+                    if (temp_iout < -p.max_iout) {
+                        s.iterm = 0;
+                        s.iout = -p.max_iout;
+                    }
+                }
+
+                // 将微分的参考值转为对实际测量值的参考而不是对误差的参考，
+                // 避免突然修改error导致的微分爆炸
+                if (mode.Has(ConstrainedPID::Derivative_On_Measurement)) {
+                    s.dout = p.kd * derivative_scale * (s.measure - s.last_measure);
+                }
+
+                // 微分滤波，采取当前值和上一次的值的加权平均
+                if (mode.Has(ConstrainedPID::DerivativeFilter)) {
+                    s.dout = s.dout * p.derivative_filtering_coefficient +
+                             s.last_dout * (1 - p.derivative_filtering_coefficient);
+                }
+
+                // 计算输出值
+                s.iout += s.iterm;
+                s.output = s.pout + s.iout + s.dout;
+
+                // 计算输出滤波，采取当前值和上一次的值的加权平均
+                if (mode.Has(ConstrainedPID::OutputFilter)) {
+                    s.output = s.output * p.output_filtering_coefficient +
+                               s.last_output * (1 - p.output_filtering_coefficient);
+                }
+
+                // 输出限幅
+                s.output = clip<float>(s.output, -p.max_out, p.max_out);
+
+                // 比例限幅
+                s.pout = clip<float>(s.pout, -p.max_out, p.max_out);
+            }
+
+            // 将本次计算的值保存，用于下一次计算
+            s.last_measure = s.measure;
+            s.last_output = s.output;
+            s.last_dout = s.dout;
+            s.last_error = s.error;
+            return s.output;
+        }
+
+        /**
+         * @brief 从初始化结构体中读取PID参数
+         */
+        /**
+         * @brief load the parameters from an initialization structure
+         */
+        inline void LoadParam(pid_param_t& p, const ConstrainedPID::PID_Init_t& pid_init) {
+            p.kp = pid_init.kp;
+            p.ki = pid_init.ki;
+            p.kd = pid_init.kd;
+            p.max_out = pid_init.max_out;
+            p.max_iout = pid_init.max_iout;
+            p.dead_band = pid_init.deadband;
+            p.scalar_a = pid_init.A;
+            p.scalar_b = pid_init.B;
+            p.output_filtering_coefficient = pid_init.output_filtering_coefficient;
+            p.derivative_filtering_coefficient = pid_init.derivative_filtering_coefficient;
+        }
+
+    }  // namespace pid_internal
 
-        void PID_ChangingIntegralRate();
+    /**
+     * @brief 编译期特化的PID控制器
+     * @details 功能与ConstrainedPID相同，但模式在编译期通过模板参数决定，
+     * 未使用的功能在编译时被优化掉，计算结果与相同模式的ConstrainedPID逐位一致
+     * @note 不支持ErrorHandle（堵转检测）和按时间间隔缩放，需要时请使用ConstrainedPID
+     *
+     * @tparam FLAGS 启用的功能，取值为ConstrainedPID::pid_mode
+     *
+     * 使用示例：
+     * control::PID<control::ConstrainedPID::Integral_Limit,
+     *              control::ConstrainedPID::OutputFilter> pid(pid_init);
+     */
+    /**
+     * @brief PID controller specialized at compile time
+     * @details same features as ConstrainedPID, but the mode is a template parameter so unused
+     * stages are compiled away. Results are bit identical to a ConstrainedPID with the same mode.
+     * @note the ErrorHandle (motor blocked detection) mode and dt scaling are not supported, use
+     * ConstrainedPID for those
+     *
+     * @tparam FLAGS enabled features, values of ConstrainedPID::pid_mode
+     */
+    template <uint8_t... FLAGS>
+    class PID {
+      public:
+        static constexpr uint8_t MODE = (FLAGS | ... | 0);
+        static_assert(!(MODE & ConstrainedPID::ErrorHandle),
+                      "ErrorHandle needs the callbacks of ConstrainedPID");
 
-        void PID_IntegralLimit();
+        /**
+         * @brief PID控制器默认构造函数
+         */
+        /**
+         * @brief PID controller default constructor
+         */
+        PID() = default;
+
+        /**
+         * @brief 使用结构体的PID控制器构造函数
+         * @param pid_init PID控制器的初始化结构体，其中的mode会被忽略
+         */
+        /**
+         * @brief PID controller constructor
+         * @param pid_init initialization structure, its mode field is ignored
+         */
+        explicit PID(ConstrainedPID::PID_Init_t pid_init) {
+            Reinit(pid_init);
+        }
+
+        /**
+         * @brief 根据当前误差计算输出
+         *
+         * @param target 目标值
+         * @param measure 当前实际值
+         * @return 可以将误差驱动到0的输出值
+         */
+        /**
+         * @brief compute output base on current error
+         *
+         * @param target target value
+         * @param measure measured value
+         * @return output value that could potentially drive the error to 0
+         */
+        float ComputeOutput(float target, float measure = 0) {
+            return pid_internal::Compute(state_, param_, pid_internal::StaticMode<MODE>(), target,
+                                         measure, 1.0f, 1.0f);
+        }
 
-        void PID_DerivativeOnMeasurement();
+        /**
+         * @brief 重新初始化PID控制器，但不清除当前状态
+         */
+        /**
+         * @brief reinitialize the gains, but does not clear current status
+         */
+        void Reinit(ConstrainedPID::PID_Init_t pid_init) {
+            pid_internal::LoadParam(param_, pid_init);
+            state_.iterm = 0;
+            state_.target = 0;
+            state_.output = 0;
+        }
 
-        void PID_OutputFilter();
+        /**
+         * @brief 清除PID控制器的状态
+         */
+        /**
+         * @brief clear the remembered states of the controller
+         */
+        void Reset() {
+            state_.pout = 0;
+            state_.iout = 0;
+            state_.dout = 0;
+            state_.error = 0;
+            state_.last_error = 0;
+        }
 
-        void PID_DerivativeFilter();
+        /**
+         * @brief 重设积分项
+         */
+        /**
+         * @brief reset the integral term
+         */
+        void ResetIntegral() {
+            state_.iout = 0;
+            state_.iterm = 0;
+        }
 
-        void PID_OutputLimit();
+        /**
+         * @brief 修改PID控制器的输出限制
+         */
+        /**
+         * @brief change the output constraint of the controller
+         */
+        void ChangeMax(float max_iout, float max_out) {
+            param_.max_iout = max_iout;
+            param_.max_out = max_out;
+        }
+
+        ConstrainedPID::PID_State_t State() const {
+            return {
+                .error = state_.error,
+                .pout = state_.pout,
+                .iout = state_.iout,
+                .dout = state_.dout,
+                .output = state_.output,
+            };
+        }
 
-        void PID_ProportionLimit();
+      private:
+        pid_internal::pid_param_t param_ = {};
+        pid_internal::pid_state_t state_ = {};
     };
 
 } /* namespace control */
@@ -0,0 +1,194 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#pragma once
+
+#include "main.h"
+#include "pid.h"
+
+namespace control {
+
+    /**
+     * @brief PID控制器组的最大容量
+     */
+    /**
+     * @brief maximum number of controllers in one bank
+     */
+    constexpr int MAX_PID_BANK_SIZE = 32;
+
+    /**
+     * @brief 批量PID控制器组
+     * @details 以结构数组（SoA）的方式保存多个ConstrainedPID的参数和状态，一次遍历更新所有控制器。
+     * 各个模式被转换为系数或选择，循环内没有按模式的分支，和ConstrainedPID的计算结果逐位一致
+     * @note 不支持ErrorHandle（堵转检测）模式，也不支持按时间间隔缩放，需要时请使用ConstrainedPID
+     */
+    /**
+     * @brief batched PID controller bank
+     * @details keeps the gains and states of several ConstrainedPID controllers in struct of
+     * arrays and updates all of them in a single pass. Every mode bit is turned into a coefficient
+     * or a select, so the loop has no per mode branches and produces bit identical results to
+     * ConstrainedPID.
+     * @note the ErrorHandle (motor blocked detection) mode and dt scaling are not supported, use
+     * ConstrainedPID for those
+     */
+    class PIDBank {
+      public:
+        /**
+         * @brief 构造函数
+         */
+        /**
+         * @brief constructor
+         */
+        PIDBank();
+
+        /**
+         * @brief 添加一个控制器
+         * @param pid_init PID控制器的初始化结构体
+         * @return 控制器编号，控制器组已满时返回-1
+         */
+        /**
+         * @brief add a controller
+         * @param pid_init initialization structure of the controller
+         * @return slot of the controller, -1 if the bank is full
+         */
+        int Add(ConstrainedPID::PID_Init_t pid_init);
+
+        /**
+         * @brief 重新初始化控制器参数，但不清除当前状态
+         * @param slot 控制器编号
+         * @param pid_init PID控制器的初始化结构体
+         */
+        /**
+         * @brief reinitialize the gains of a controller, but does not clear its states
+         * @param slot slot of the controller
+         * @param pid_init initialization structure of the controller
+         */
+        void Reinit(int slot, ConstrainedPID::PID_Init_t pid_init);
+
+        /**
+         * @brief 设置控制器本次计算的目标值和测量值
+         * @param slot 控制器编号
+         * @param target 目标值
+         * @param measure 当前实际值
+         */
+        /**
+         * @brief set target and measurement used by the next Update()
+         * @param slot slot of the controller
+         * @param target target value
+         * @param measure measured value
+         */
+        void SetInput(int slot, float target, float measure);
+
+        /**
+         * @brief 一次更新所有控制器
+         */
+        /**
+         * @brief update every controller in one pass
+         */
+        void Update();
+
+        /**
+         * @brief 使用数组输入输出一次更新所有控制器
+         * @param target 目标值数组，长度为Size()
+         * @param measure 测量值数组，长度为Size()
+         * @param output 输出数组，长度为Size()，可以为nullptr
+         */
+        /**
+         * @brief update every controller in one pass with array inputs and outputs
+         * @param target array of target values, Size() elements
+         * @param measure array of measured values, Size() elements
+         * @param output array of outputs, Size() elements, can be nullptr
+         */
+        void Update(const float* target, const float* measure, float* output);
+
+        /**
+         * @brief 获取控制器最近一次的输出
+         */
+        /**
+         * @brief latest output of a controller
+         */
+        float Output(int slot) const;
+
+        /**
+         * @brief 获取控制器的状态，和ConstrainedPID::State()相同
+         */
+        /**
+         * @brief states of a controller, same as ConstrainedPID::State()
+         */
+        ConstrainedPID::PID_State_t State(int slot) const;
+
+        /**
+         * @brief 清除控制器的状态
+         */
+        /**
+         * @brief clear the remembered states of a controller
+         */
+        void Reset(int slot);
+
+        /**
+         * @brief 重设控制器的积分项
+         */
+        /**
+         * @brief reset the integral term of a controller
+         */
+        void ResetIntegral(int slot);
+
+        /**
+         * @brief 获取控制器数量
+         */
+        /**
+         * @brief number of controllers in the bank
+         */
+        int Size() const;
+
+      private:
+        int size_ = 0;
+
+        // 参数
+        float kp_[MAX_PID_BANK_SIZE];
+        float ki_[MAX_PID_BANK_SIZE];
+        float kd_[MAX_PID_BANK_SIZE];
+        float max_out_[MAX_PID_BANK_SIZE];
+        float max_iout_[MAX_PID_BANK_SIZE];
+        float dead_band_[MAX_PID_BANK_SIZE];
+        float scalar_a_[MAX_PID_BANK_SIZE];
+        float scalar_b_[MAX_PID_BANK_SIZE];
+        float integral_weight_[MAX_PID_BANK_SIZE];   /* 1 for rectangle, 0.5 for trapezoid */
+        float output_filter_[MAX_PID_BANK_SIZE];     /* 1 when output filter is disabled */
+        float derivative_filter_[MAX_PID_BANK_SIZE]; /* 1 when derivative filter is disabled */
+        bool integral_limit_[MAX_PID_BANK_SIZE];
+        bool changing_integral_[MAX_PID_BANK_SIZE];
+        bool derivative_on_measurement_[MAX_PID_BANK_SIZE];
+
+        // 输入
+        float target_[MAX_PID_BANK_SIZE];
+        float measure_[MAX_PID_BANK_SIZE];
+
+        // 状态
+        float last_measure_[MAX_PID_BANK_SIZE];
+        float error_[MAX_PID_BANK_SIZE];
+        float last_error_[MAX_PID_BANK_SIZE];
+        float pout_[MAX_PID_BANK_SIZE];
+        float iout_[MAX_PID_BANK_SIZE];
+        float dout_[MAX_PID_BANK_SIZE];
+        float output_[MAX_PID_BANK_SIZE];
+    };
+
+} /* namespace control */
@@ -40,6 +40,33 @@ namespace control {
         float power_total_current_limit;   // 电机功率总电流限制，单位为A
     } power_limit_t;
 
+    /**
+     * @brief 整数版本的电机限流信息，由PowerLimitToFixed从power_limit_t转换
+     * @details 功率单位为mW，能量单位为mJ，电流限制与电机的电流值单位相同
+     */
+    /**
+     * @brief integer motor current limit information, converted from power_limit_t by
+     * PowerLimitToFixed
+     * @details power is in mW, energy in mJ, and the current limits are in the units of the motor
+     * current values
+     */
+    typedef struct {
+        int32_t power_limit;                 // 电机功率限制，单位为mW
+        int32_t WARNING_power;               // 电机功率警告，单位为mW
+        int32_t WARNING_power_buff;          // 电机缓冲能量警告，单位为mJ
+        int32_t buffer_total_current_limit;  // 电机缓冲总电流限制
+        int32_t power_total_current_limit;   // 电机功率总电流限制
+    } power_limit_fixed_t;
+
+    /**
+     * @brief 将限流信息转换为整数版本，使用浮点运算，只应在初始化或修改限制时调用
+     */
+    /**
+     * @brief convert the current limit information to the integer version, uses float and is
+     * meant to be called only when initializing or changing the limits
+     */
+    power_limit_fixed_t PowerLimitToFixed(power_limit_t power_limit_info);
+
     /**
      * @brief 电机功率限制
      * @details 用于限制电机功率，防止电机过载
@@ -77,8 +104,34 @@ namespace control {
         void Output(bool turn_on, power_limit_t power_limit_info, float current_power,
                     float current_power_buffer, float* input, float* output);
 
+        /**
+         * @brief 电机功率限制输出，整数版本
+         * @details 只使用32位整数运算，适用于没有FPU的板子。比例以Q15计算，除法前移位使被除数
+         * 不超过32位；每个电机的缩放是一次Q15整数乘法
+         * @param power_limit_info 整数版本的限流信息，参考PowerLimitToFixed
+         * @param current_power 当前电源功率，单位为mW
+         * @param current_power_buffer 当前电源可用缓冲能量，单位为mJ
+         */
+        /**
+         * @brief Motor power limit output, integer version
+         * @details only uses 32 bit integer arithmetic, meant for boards without an FPU. Ratios
+         * are computed in Q15 with the operands shifted before the divide so the dividend fits in
+         * 32 bits; every motor is scaled with one Q15 integer multiplication
+         * @param power_limit_info integer current limit information, see PowerLimitToFixed
+         * @param current_power Current power of the power supply, in mW
+         * @param current_power_buffer Current available buffer energy of the power supply, in mJ
+         */
+        void Output(bool turn_on, power_limit_fixed_t power_limit_info, int32_t current_power,
+                    int32_t current_power_buffer, int16_t* input, int16_t* output);
+
       private:
         int motor_num_;
+
+        float TotalCurrentLimit(power_limit_t power_limit_info, float current_power,
+                                float current_power_buffer);
+
+        int32_t TotalCurrentLimit(power_limit_fixed_t power_limit_info, int32_t current_power,
+                                  int32_t current_power_buffer);
     };
 
 }  // namespace control
@@ -0,0 +1,202 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#pragma once
+
+#include "main.h"
+
+namespace control {
+
+    /**
+     * @brief 底盘功率模型的参数
+     * @details 每个电机的功率为 k1·I² + k2·I·ω + k3·ω² + p0，I为电流，ω为转子角速度
+     */
+    /**
+     * @brief parameters of the chassis power model
+     * @details the power of every motor is k1·I² + k2·I·ω + k3·ω² + p0, with I the current and
+     * ω the rotor angular velocity
+     */
+    typedef struct {
+        float k1;              /// 铜损系数，单位为[W/A^2]
+        float k2;              /// 转矩常数，即输出机械功率的系数，单位为[W/(A·rad/s)]
+        float k3;              /// 铁损和摩擦系数，单位为[W/(rad/s)^2]
+        float p0;              /// 静态功耗，单位为[W]
+        float max_current;     /// 电流满量程，用于辨识时归一化，单位为[A]
+        float max_omega;       /// 转速满量程，用于辨识时归一化，单位为[rad/s]
+        float forgetting;      /// 递推最小二乘的遗忘因子，每个功率测量值更新一次
+        float buffer_reserve;  /// 分配功率时保留的缓冲能量，单位为[J]
+        float buffer_horizon;  /// 把多余的缓冲能量用完的时间，单位为[s]
+    } power_model_init_t;
+
+    /**
+     * @brief M3508电机和C620电调的默认参数
+     */
+    /**
+     * @brief default parameters of the M3508 motor with the C620 ESC
+     */
+    constexpr power_model_init_t POWER_MODEL_3508_INIT = {0.3f,  0.0156f, 5e-6f, 1.0f, 20.0f,
+                                                          950.0f, 0.95f, 20.0f, 1.0f};
+
+    /**
+     * @brief 基于模型的底盘功率预测和分配
+     * @details 裁判系统的功率只有10~50Hz并且有延迟，按它线性缩放电流要么超功率消耗缓冲能量，
+     * 要么限得过死。这里用电机反馈在控制频率下计算功率，然后求出满足功率预算的最大电流缩放
+     * 系数。模型系数用递推最小二乘对照裁判系统（或超级电容）的功率测量值在线辨识：两次测量之间
+     * 每个控制周期调用Accumulate累计回归量，新测量到达时调用Identify。模型对系数是线性的，
+     * 所以用测量窗口内回归量的平均值即可对应平均功率
+     */
+    /**
+     * @brief model based chassis power prediction and allocation
+     * @details the referee power comes at 10~50 Hz and late, scaling the currents linearly by it
+     * either overshoots the limit and drains the buffer energy or throttles far below the
+     * allowance. Here the power is predicted at the control rate from the motor feedback, and
+     * the largest current scale meeting a power budget is solved for. The coefficients are
+     * identified online with recursive least squares against the referee (or super capacitor)
+     * measurements: call Accumulate every control cycle between two measurements and Identify
+     * when a new one arrives. The model is linear in the coefficients, so the regressors averaged
+     * over the measurement window match the averaged power
+     */
+    class PowerModel {
+      public:
+        /**
+         * @brief 构造函数
+         *
+         * @param motor_num 电机数量
+         * @param init      模型参数
+         */
+        /**
+         * @brief constructor
+         *
+         * @param motor_num number of motors
+         * @param init      model parameters
+         */
+        PowerModel(int motor_num, power_model_init_t init = POWER_MODEL_3508_INIT);
+
+        /**
+         * @brief 预测总功率
+         *
+         * @param current 每个电机的电流，单位为[A]
+         * @param omega   每个电机的转子角速度，单位为[rad/s]
+         *
+         * @return 总功率，单位为[W]
+         */
+        /**
+         * @brief predict the total power
+         *
+         * @param current current of every motor, in [A]
+         * @param omega   rotor angular velocity of every motor, in [rad/s]
+         *
+         * @return total power, in [W]
+         */
+        float Predict(const float* current, const float* omega) const;
+
+        /**
+         * @brief 求满足功率预算的最大电流缩放系数
+         *
+         * @param current 每个电机想要输出的电流，单位为[A]
+         * @param omega   每个电机的转子角速度，单位为[rad/s]
+         * @param budget  功率预算，单位为[W]
+         *
+         * @return [0, 1]之间的缩放系数；预算无论如何都满足不了时返回功率最小的系数
+         */
+        /**
+         * @brief solve for the largest current scale that meets a power budget
+         *
+         * @param current current every motor wants to output, in [A]
+         * @param omega   rotor angular velocity of every motor, in [rad/s]
+         * @param budget  power budget, in [W]
+         *
+         * @return scale in [0, 1]; the scale with the least power when no scale meets the budget
+         */
+        float Scale(const float* current, const float* omega, float budget) const;
+
+        /**
+         * @brief 根据裁判系统的功率上限和剩余缓冲能量计算功率预算
+         *
+         * @param power_limit 功率上限，单位为[W]
+         * @param buffer      剩余缓冲能量，单位为[J]
+         *
+         * @return 功率预算，超过buffer_reserve的缓冲能量在buffer_horizon内用完，单位为[W]
+         */
+        /**
+         * @brief power budget from the referee power limit and the remaining buffer energy
+         *
+         * @param power_limit power limit, in [W]
+         * @param buffer      remaining buffer energy, in [J]
+         *
+         * @return power budget that spends the buffer above buffer_reserve within buffer_horizon,
+         *         in [W]
+         */
+        float Budget(float power_limit, float buffer) const;
+
+        /**
+         * @brief 累计一个控制周期实际输出的电流和转速
+         *
+         * @param current 每个电机实际输出的电流，单位为[A]
+         * @param omega   每个电机的转子角速度，单位为[rad/s]
+         */
+        /**
+         * @brief accumulate the current actually output and the speed of one control cycle
+         *
+         * @param current current actually output by every motor, in [A]
+         * @param omega   rotor angular velocity of every motor, in [rad/s]
+         */
+        void Accumulate(const float* current, const float* omega);
+
+        /**
+         * @brief 用新的功率测量值更新模型系数，并开始下一个累计窗口
+         *
+         * @param measured_power 上一个窗口内测得的平均功率，单位为[W]
+         */
+        /**
+         * @brief update the coefficients with a new power measurement and start the next window
+         *
+         * @param measured_power average power measured over the last window, in [W]
+         */
+        void Identify(float measured_power);
+
+        /**
+         * @brief 获取当前的模型系数
+         *
+         * @param k 输出k1, k2, k3, p0
+         */
+        /**
+         * @brief get the current model coefficients
+         *
+         * @param k output k1, k2, k3, p0
+         */
+        void GetCoefficients(float k[4]) const;
+
+      private:
+        void Regressors(const float* current, const float* omega, float phi[4]) const;
+        void Constrained(float theta[4]) const;
+
+        int motor_num_;
+        power_model_init_t init_;
+
+        // 归一化后的系数和协方差 / normalized coefficients and covariance
+        float theta_[4];
+        float P_[4][4];
+
+        float sum_phi_[4] = {0, 0, 0, 0};
+        int samples_ = 0;
+    };
+
+}  // namespace control
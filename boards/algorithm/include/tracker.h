@@ -0,0 +1,157 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "kalman.h"
+
+namespace control {
+
+    /**
+     * @brief 目标跟踪的参数
+     */
+    /**
+     * @brief parameters of the target tracker
+     */
+    typedef struct {
+        float process_noise;      /// 目标角加速度的功率谱密度，单位为[(rad/s^2)^2·s]
+        float measurement_noise;  /// 观测角度的标准差，单位为[rad]
+        float latency;            /// 从拍摄到收到观测的延迟，单位为[s]
+        float lead;               /// 云台跟上目标所需的超前时间，单位为[s]
+        float max_prediction;     /// 外推的最长时间，单位为[s]
+        float timeout;            /// 超过该时间没有观测认为目标丢失，单位为[s]
+        float gate;               /// 新息马氏距离平方的门限，连续两次超过认为换了目标
+    } tracker_init_t;
+
+    /**
+     * @brief 自瞄目标的跟踪和延迟补偿
+     * @details 上位机以相机帧率发来目标在世界坐标系（IMU坐标系）下的pitch和yaw，
+     * 收到时已经过了拍摄、识别和传输的延迟，直接作为云台目标会滞后并且抖动。这里对两个角度
+     * 分别用匀速模型的卡尔曼滤波器跟踪，观测按拍摄时刻（收到的时间减去latency）更新，
+     * 云台每个控制周期从滤波结果外推到当前时刻再加上lead，得到平滑的角度和角速度目标。
+     * 单个超出门限的观测被丢弃，连续两个则认为换了目标并重新初始化。
+     * 协议中没有目标距离，所以在角度空间跟踪；时间戳都以[us]为单位
+     */
+    /**
+     * @brief tracking and latency compensation of the auto aim target
+     * @details the host sends the pitch and yaw of the target in the world (IMU) frame at the
+     * camera rate, already late by the exposure, detection and transfer, so using them as the
+     * gimbal target directly lags and jitters. Here each angle is tracked by a constant velocity
+     * Kalman filter, updated at the capture time (the receive time minus latency). Every control
+     * period the gimbal extrapolates the estimate to the current time plus lead, giving smooth
+     * angle and rate targets. A single observation beyond the gate is dropped, two in a row mean
+     * the target changed and the filter starts over. The protocol carries no distance to the
+     * target, so tracking is done in angles. All timestamps are in [us]
+     */
+    class TargetTracker {
+      public:
+        /**
+         * @brief 构造函数
+         *
+         * @param init 目标跟踪的参数
+         */
+        /**
+         * @brief constructor
+         *
+         * @param init parameters of the target tracker
+         */
+        TargetTracker(tracker_init_t init);
+
+        /**
+         * @brief 加入一个目标的观测
+         *
+         * @param pitch     目标的pitch，单位为[rad]
+         * @param yaw       目标的yaw，单位为[rad]
+         * @param timestamp 收到观测的时间，单位为[us]
+         */
+        /**
+         * @brief add an observation of the target
+         *
+         * @param pitch     pitch of the target, in [rad]
+         * @param yaw       yaw of the target, in [rad]
+         * @param timestamp time the observation was received, in [us]
+         */
+        void Observe(float pitch, float yaw, uint64_t timestamp);
+
+        /**
+         * @brief 加入一个拍摄时间已知的观测，例如与上位机同步时钟之后，不再减去latency
+         *
+         * @param pitch   目标的pitch，单位为[rad]
+         * @param yaw     目标的yaw，单位为[rad]
+         * @param capture 拍摄的时间，单位为[us]
+         */
+        /**
+         * @brief add an observation with a known capture time, e.g. once the clock is
+         * synchronized with the host, latency is not subtracted
+         *
+         * @param pitch   pitch of the target, in [rad]
+         * @param yaw     yaw of the target, in [rad]
+         * @param capture time the image was captured, in [us]
+         */
+        void ObserveAt(float pitch, float yaw, uint64_t capture);
+
+        /**
+         * @brief 预测云台应该瞄准的角度和角速度
+         *
+         * @param now        当前时间，单位为[us]
+         * @param pitch      输出pitch，单位为[rad]
+         * @param yaw        输出yaw，范围为[-pi, pi]
+         * @param pitch_rate 输出pitch角速度，单位为[rad/s]，可以为nullptr
+         * @param yaw_rate   输出yaw角速度，单位为[rad/s]，可以为nullptr
+         *
+         * @return 正在跟踪目标时返回true，否则返回false并且不修改输出
+         */
+        /**
+         * @brief predict the angles and rates the gimbal should aim at
+         *
+         * @param now        current time, in [us]
+         * @param pitch      output pitch, in [rad]
+         * @param yaw        output yaw, in [-pi, pi]
+         * @param pitch_rate output pitch rate, in [rad/s], can be nullptr
+         * @param yaw_rate   output yaw rate, in [rad/s], can be nullptr
+         *
+         * @return true while a target is tracked, otherwise false with the outputs untouched
+         */
+        bool Predict(uint64_t now, float* pitch, float* yaw, float* pitch_rate = nullptr,
+                     float* yaw_rate = nullptr) const;
+
+        /**
+         * @brief 丢弃当前的目标，例如上位机报告没有目标时
+         */
+        /**
+         * @brief drop the current target, e.g. when the host reports no target
+         */
+        void Reset();
+
+      private:
+        void Start(float pitch, float yaw, uint64_t time);
+        void Propagate(KalmanFilter<2, 1>* filter, float dt);
+
+        tracker_init_t init_;
+        KalmanFilter<2, 1> pitch_;
+        KalmanFilter<2, 1> yaw_;
+        uint64_t time_;
+        bool tracking_;
+        bool gated_;
+    };
+
+}  // namespace control
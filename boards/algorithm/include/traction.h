@@ -0,0 +1,166 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#pragma once
+
+#include "kinematics.h"
+#include "main.h"
+
+namespace control {
+
+    /**
+     * @brief 牵引力控制的参数，数组按vx、vy、wz的顺序
+     */
+    /**
+     * @brief parameters of the traction control, arrays are in the order vx, vy, wz
+     */
+    typedef struct {
+        float max_acceleration[3];  /// 加速时的加速度上限，单位为[m/s^2]和[rad/s^2]
+        float max_deceleration[3];  /// 减速时的加速度上限，单位为[m/s^2]和[rad/s^2]
+        float slip_threshold;       /// 轮速与地面速度对应的轮速之差超过该值判定打滑，单位为[rad/s]
+        float slip_torque_scale;    /// 检测到打滑时输出立即降到的比例，打滑持续时继续衰减
+        float recovery_time;        /// 输出从0恢复到满的时间，也是打滑时衰减的时间常数，单位为[s]
+        float odometry_gain;        /// 地面速度向里程计收敛的增益，单位为[1/s]
+    } traction_init_t;
+
+    /**
+     * @brief 底盘的加速度限制和打滑检测
+     * @details SetSpeed()直接设置轮速目标时，大幅度的摇杆输入会让速度环饱和，轮子空转，
+     * 功率限制下的能量被浪费在打滑上。这里先在底盘坐标系下按轴限制指令的加速度，再用IMU的
+     * 加速度积分、陀螺仪的角速度作为地面速度，与轮子的里程计互相校验：某个轮子的转速与地面速度
+     * 对应的转速相差超过slip_threshold时判定打滑，该轮电机的输出按比例降低，轮子重新抓地后
+     * 在recovery_time内恢复。只缩小输出而不改变速度目标，估计有误差时也不会让底盘自己跑起来。
+     * 地面速度以odometry_gain收敛到里程计以消除加速度计零偏的积分，打滑时该增益降为五分之一
+     */
+    /**
+     * @brief acceleration limiting and slip detection of a chassis
+     * @details when SetSpeed() sets the wheel targets directly, a large stick input saturates the
+     * speed loops and spins the wheels, wasting the power limited energy on slip. Here the command
+     * is first limited in acceleration per axis in the chassis frame. The ground velocity is
+     * integrated from the IMU acceleration with the gyro yaw rate and checked against the wheel
+     * odometry: a wheel turning more than slip_threshold away from the speed matching the ground
+     * velocity is slipping, the output of its motor is scaled down, and it recovers within
+     * recovery_time once the wheel grips again. Only shrinking the output instead of moving the
+     * speed target means an error of the estimate cannot drive the chassis away. The ground
+     * velocity converges to the odometry at odometry_gain, a fifth of it while slipping, which
+     * cancels the integrated accelerometer bias
+     */
+    class TractionControl {
+      public:
+        /**
+         * @brief 构造函数
+         *
+         * @param kinematics 底盘的运动学模型
+         * @param init       牵引力控制的参数
+         */
+        /**
+         * @brief constructor
+         *
+         * @param kinematics kinematics model of the chassis
+         * @param init       parameters of the traction control
+         */
+        TractionControl(Kinematics* kinematics, traction_init_t init);
+
+        /**
+         * @brief 限制底盘速度指令的加速度
+         *
+         * @param target  目标速度vx、vy、wz，单位为[m/s]和[rad/s]
+         * @param command 输出限制后的速度指令
+         * @param dt      距上一次调用的时间，单位为[s]
+         */
+        /**
+         * @brief limit the acceleration of the chassis velocity command
+         *
+         * @param target  target velocity vx, vy, wz, in [m/s] and [rad/s]
+         * @param command output limited velocity command
+         * @param dt      time since the last call, in [s]
+         */
+        void Limit(const float target[3], float command[3], float dt);
+
+        /**
+         * @brief 估计地面速度并检测每个轮子是否打滑
+         * @note 加速度需要去掉重力并转到底盘坐标系，x轴向右，y轴向前，角速度逆时针为正
+         *
+         * @param wheel_speed 每个轮子测得的角速度，单位为[rad/s]
+         * @param ax          向右的加速度，单位为[m/s^2]
+         * @param ay          向前的加速度，单位为[m/s^2]
+         * @param gz          逆时针的角速度，单位为[rad/s]
+         * @param dt          距上一次调用的时间，单位为[s]
+         */
+        /**
+         * @brief estimate the ground velocity and detect slip of every wheel
+         * @note the acceleration must be free of gravity and in the chassis frame, x to the
+         * right, y to the front, counter-clockwise positive turning
+         *
+         * @param wheel_speed measured angular velocity of every wheel, in [rad/s]
+         * @param ax          acceleration to the right, in [m/s^2]
+         * @param ay          acceleration to the front, in [m/s^2]
+         * @param gz          counter-clockwise angular velocity, in [rad/s]
+         * @param dt          time since the last call, in [s]
+         */
+        void Estimate(const float* wheel_speed, float ax, float ay, float gz, float dt);
+
+        /**
+         * @brief 按打滑情况缩小每个电机的输出，在电机输出前调用
+         *
+         * @param output 每个电机的输出，原地修改
+         */
+        /**
+         * @brief scale down the output of every motor by its slip, call right before the motors
+         * output
+         *
+         * @param output output of every motor, modified in place
+         */
+        void Apply(float* output) const;
+
+        /**
+         * @brief 清空速度指令和地面速度，底盘停止或失能时调用
+         */
+        /**
+         * @brief clear the command and the ground velocity, call when the chassis stops or is
+         * disabled
+         */
+        void Reset();
+
+        /**
+         * @brief 获取估计的地面速度
+         *
+         * @param velocity 输出vx、vy、wz，单位为[m/s]和[rad/s]
+         */
+        /**
+         * @brief get the estimated ground velocity
+         *
+         * @param velocity output vx, vy, wz, in [m/s] and [rad/s]
+         */
+        void GetVelocity(float velocity[3]) const;
+
+        bool IsSlipping(int wheel) const;
+
+      private:
+        Kinematics* kinematics_;
+        traction_init_t init_;
+
+        float command_[3];
+        float velocity_[3];
+        bool slipping_[MAX_WHEEL_NUM];
+        float torque_scale_[MAX_WHEEL_NUM];
+    };
+
+}  // namespace control
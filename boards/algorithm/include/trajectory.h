@@ -0,0 +1,160 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#pragma once
+
+#include "main.h"
+
+namespace control {
+
+    /**
+     * @brief 轨迹的限制
+     */
+    /**
+     * @brief limits of a trajectory
+     */
+    typedef struct {
+        float max_velocity;      /// 最大速度，单位为[unit/s]
+        float max_acceleration;  /// 最大加速度，单位为[unit/s^2]
+        float max_jerk;          /// 最大加加速度，单位为[unit/s^3]
+    } trajectory_limit_t;
+
+    /**
+     * @brief 轨迹的当前状态，速度和加速度可以直接用作前馈
+     */
+    /**
+     * @brief current state of a trajectory, velocity and acceleration can be used as feedforward
+     */
+    typedef struct {
+        float position;
+        float velocity;
+        float acceleration;
+    } trajectory_state_t;
+
+    /**
+     * @brief 在线S型轨迹生成器
+     * @details 每个控制周期调用一次Update()，根据当前的位置、速度和加速度选择一个不超过限制的
+     * 加加速度，以接近时间最优的S型曲线到达目标并停止。目标可以在每个周期改变，
+     * 轨迹会从当前状态平滑地重新规划。速度、加速度和加加速度在每一步都被限制，不会超出设置的限制
+     */
+    /**
+     * @brief online jerk limited (S-curve) trajectory generator
+     * @details call Update() once every control period. Based on the current position, velocity
+     * and acceleration it picks a jerk within the limit that reaches the target and stops there
+     * on a close to time optimal S-curve. The target may change on every call and the trajectory
+     * is replanned smoothly from the current state. Velocity, acceleration and jerk are clamped
+     * on every step so the limits are never exceeded.
+     */
+    class TrajectoryGenerator {
+      public:
+        /**
+         * @brief 构造函数
+         * @param limit 轨迹的限制，所有值都必须大于0
+         */
+        /**
+         * @brief constructor
+         * @param limit limits of the trajectory, all of them must be positive
+         */
+        TrajectoryGenerator(trajectory_limit_t limit);
+
+        /**
+         * @brief 修改轨迹的限制，立即生效
+         */
+        /**
+         * @brief change the limits, takes effect on the next update
+         */
+        void SetLimit(trajectory_limit_t limit);
+
+        /**
+         * @brief 将轨迹的状态设置为给定值，一般在开始跟踪前设置为电机的当前状态
+         * @param position     位置
+         * @param velocity     速度
+         * @param acceleration 加速度
+         */
+        /**
+         * @brief set the state of the trajectory, normally to the current state of the motor
+         * before tracking starts
+         * @param position     position
+         * @param velocity     velocity
+         * @param acceleration acceleration
+         */
+        void Reset(float position, float velocity = 0, float acceleration = 0);
+
+        /**
+         * @brief 向目标位置前进一个周期
+         * @param target 目标位置
+         * @param dt     周期，单位为[s]
+         * @return 本周期结束时的位置、速度和加速度
+         */
+        /**
+         * @brief advance one period towards a target position
+         * @param target target position
+         * @param dt     period in [s]
+         * @return position, velocity and acceleration at the end of the period
+         */
+        trajectory_state_t Update(float target, float dt);
+
+        /**
+         * @brief 向目标速度前进一个周期，目标速度会被限制在最大速度内
+         * @param target 目标速度
+         * @param dt     周期，单位为[s]
+         * @return 本周期结束时的位置、速度和加速度
+         */
+        /**
+         * @brief advance one period towards a target velocity, the target is clamped to the
+         * maximum velocity
+         * @param target target velocity
+         * @param dt     period in [s]
+         * @return position, velocity and acceleration at the end of the period
+         */
+        trajectory_state_t UpdateVelocity(float target, float dt);
+
+        /**
+         * @brief 获取轨迹的当前状态
+         */
+        /**
+         * @brief get the current state of the trajectory
+         */
+        trajectory_state_t State() const;
+
+        /**
+         * @brief 判断轨迹是否已经停在目标上
+         */
+        /**
+         * @brief check if the trajectory has stopped at its target
+         */
+        bool IsFinished() const;
+
+      private:
+        trajectory_limit_t limit_;
+        trajectory_state_t state_ = {};
+        bool finished_ = true;
+
+        // 以恒定的加加速度积分一个周期
+        void Integrate(float jerk, float dt);
+        // 在加速度限制下将速度驱动到目标值所需的加加速度
+        float VelocityJerk(float target_velocity, float dt) const;
+        // 以给定的加加速度前进一个周期后立即刹车，最终停止的位置
+        float StopPosition(float jerk, float dt);
+        // 从给定的速度和加速度以时间最优的方式刹车到静止所走过的距离
+        float BrakingDistance(float velocity, float acceleration) const;
+    };
+
+}  // namespace control
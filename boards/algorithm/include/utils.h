@@ -19,6 +19,7 @@
  ###########################################################*/
 
 #pragma once
+#include "fastmath.h"
 #include "main.h"
 
 /**
@@ -119,6 +120,22 @@ T wrapc(T value, T min, T max) {
     return value;
 }
 
+/**
+ * @brief wrapc的float特化，不用循环，耗时与value离范围多远无关
+ *
+ * @note 结果在[min, max)内，value等于max时返回min
+ */
+/**
+ * @brief float specialization of wrapc without loops, the run time does not depend on how far
+ * value is from the range
+ *
+ * @note the result is in [min, max), value == max gives min
+ */
+template <>
+inline float wrapc<float>(float value, float min, float max) {
+    return fast_wrapf(value, min, max);
+}
+
 /**
  * @brief 将一个值限制范围后，环绕使其落入给定的环绕范围
  *
@@ -533,6 +550,60 @@ class RampSource {
     float step_;
 };
 
+/**
+ * @brief 控制周期计时器
+ * @details 由相邻两次调用的时间戳计算实际的周期，用来按实际的时间间隔积分。第一次调用、
+ * 时间戳不可用（为0）、时间倒退或者间隔超过最大值（线程被挂起过）时返回名义周期
+ */
+/**
+ * @brief control period timer
+ * @details computes the actual period from the timestamps of two consecutive calls, to
+ * integrate over the real interval. Returns the nominal period on the first call, when the
+ * timestamp is unavailable (0), goes backwards or when the gap exceeds the maximum (the thread
+ * was suspended)
+ */
+class PeriodTimer {
+  public:
+    /**
+     * @brief 构造函数
+     * @param nominal 名义周期，单位为[s]
+     * @param max     认为合理的最大周期，单位为[s]
+     */
+    /**
+     * @brief constructor
+     * @param nominal nominal period, in [s]
+     * @param max     largest plausible period, in [s]
+     */
+    PeriodTimer(float nominal, float max);
+    /**
+     * @brief 记录一次调用的时间戳
+     * @param now 当前时间戳，例如bsp::GetHighresTickMicroSec()，单位为[us]
+     * @return 距离上一次调用的时间，单位为[s]
+     */
+    /**
+     * @brief record the timestamp of a call
+     * @param now current timestamp, e.g. bsp::GetHighresTickMicroSec(), in [us]
+     * @return time since the previous call, in [s]
+     */
+    float Update(uint64_t now);
+    /**
+     * @brief 修改名义周期和最大周期
+     * @param nominal 名义周期，单位为[s]
+     * @param max     认为合理的最大周期，单位为[s]
+     */
+    /**
+     * @brief change the nominal and the maximum period
+     * @param nominal nominal period, in [s]
+     * @param max     largest plausible period, in [s]
+     */
+    void SetPeriod(float nominal, float max);
+
+  private:
+    float nominal_;
+    float max_;
+    uint64_t last_ = 0;
+};
+
 void EndianSwap(void* data, size_t size);
 class Ease {
   public:
@@ -20,11 +20,13 @@
 
 #include "AHRS.h"
 
+#include "fastmath.h"
+
 namespace control {
 
-    AHRS::AHRS(bool is_mag) {
+    AHRS::AHRS(bool is_mag, mahony_init_t init, gyro_bias_init_t bias_init)
+        : mahony_(init), bias_(bias_init) {
         is_mag_ = is_mag;
-        cailb_flag_ = false;
         cailb_done_ = false;
         INS_angle[0] = 0;
         INS_angle[1] = 0;
@@ -33,12 +35,12 @@ namespace control {
         q[1] = 0;
         q[2] = 0;
         q[3] = 0;
-        accel_fliter_1[0] = accel_fliter_2[0] = accel_fliter_3[0] = accel_[0] = 0.0f;
-        accel_fliter_1[1] = accel_fliter_2[1] = accel_fliter_3[1] = accel_[1] = 0.0f;
-        accel_fliter_1[2] = accel_fliter_2[2] = accel_fliter_3[2] = accel_[2] = 0.0f;
+        accel_[0] = 0.0f;
+        accel_[1] = 0.0f;
+        accel_[2] = 0.0f;
     }
     void AHRS::Update(float gx, float gy, float gz, float ax, float ay, float az, float mx,
-                      float my, float mz) {
+                      float my, float mz, float dt) {
         accel_[0] = ax;
         accel_[1] = ay;
         accel_[2] = az;
@@ -48,87 +50,88 @@ namespace control {
         mag_[0] = mx;
         mag_[1] = my;
         mag_[2] = mz;
-        accel_fliter_1[0] = accel_fliter_2[0];
-        accel_fliter_2[0] = accel_fliter_3[0];
-        accel_fliter_3[0] = accel_fliter_2[0] * fliter_num[0] + accel_fliter_1[0] * fliter_num[1] +
-                            accel_[0] * fliter_num[2];
-        accel_fliter_1[1] = accel_fliter_2[1];
-        accel_fliter_2[1] = accel_fliter_3[1];
-        accel_fliter_3[1] = accel_fliter_2[1] * fliter_num[0] + accel_fliter_1[1] * fliter_num[1] +
-                            accel_[1] * fliter_num[2];
-        accel_fliter_1[2] = accel_fliter_2[2];
-        accel_fliter_2[2] = accel_fliter_3[2];
-        accel_fliter_3[2] = accel_fliter_2[2] * fliter_num[0] + accel_fliter_1[2] * fliter_num[1] +
-                            accel_[2] * fliter_num[2];
-        if (cailb_done_) {
-            MahonyAHRSupdate(q, gx - g_zerodrift[0], gy - g_zerodrift[1], gz - g_zerodrift[2],
-                             accel_fliter_1[0], accel_fliter_1[1], accel_fliter_1[2], mx, my, mz);
-            INSCalculate();
-        } else if (cailb_flag_) {
-            CailbrateHandler(gx, gy, gz, ax, ay, az, mx, my, mz);
-        }
+        if (!started_)
+            Start(ax, ay, az);
+        accel_filter_.Update(accel_, accel_filtered_);
+        float bias[3];
+        UpdateBias(bias, dt);
+        for (int i = 0; i < 3; ++i)
+            rate_[i] = gyro_[i] - bias[i];
+        mahony_.Update(gx - bias[0], gy - bias[1], gz - bias[2], accel_filtered_[0],
+                       accel_filtered_[1], accel_filtered_[2], mx, my, mz, dt);
+        mahony_.GetQuaternion(q);
+        INSCalculate();
     }
-    void AHRS::Update(float gx, float gy, float gz, float ax, float ay, float az) {
+    void AHRS::Update(float gx, float gy, float gz, float ax, float ay, float az, float dt) {
         accel_[0] = ax;
         accel_[1] = ay;
         accel_[2] = az;
         gyro_[0] = gx;
         gyro_[1] = gy;
         gyro_[2] = gz;
-        accel_fliter_1[0] = accel_fliter_2[0];
-        accel_fliter_2[0] = accel_fliter_3[0];
-        accel_fliter_3[0] = accel_fliter_2[0] * fliter_num[0] + accel_fliter_1[0] * fliter_num[1] +
-                            accel_[0] * fliter_num[2];
-        accel_fliter_1[1] = accel_fliter_2[1];
-        accel_fliter_2[1] = accel_fliter_3[1];
-        accel_fliter_3[1] = accel_fliter_2[1] * fliter_num[0] + accel_fliter_1[1] * fliter_num[1] +
-                            accel_[1] * fliter_num[2];
-        accel_fliter_1[2] = accel_fliter_2[2];
-        accel_fliter_2[2] = accel_fliter_3[2];
-        accel_fliter_3[2] = accel_fliter_2[2] * fliter_num[0] + accel_fliter_1[2] * fliter_num[1] +
-                            accel_[2] * fliter_num[2];
-        if (cailb_done_) {
-            MahonyAHRSupdateIMU(q, gx - g_zerodrift[0], gy - g_zerodrift[1], gz - g_zerodrift[2],
-                                accel_fliter_1[0], accel_fliter_1[1], accel_fliter_1[2]);
-            INSCalculate();
-        } else if (cailb_flag_) {
-            CailbrateHandler(gx, gy, gz, ax, ay, az, 0, 0, 0);
-        }
+        if (!started_)
+            Start(ax, ay, az);
+        accel_filter_.Update(accel_, accel_filtered_);
+        float bias[3];
+        UpdateBias(bias, dt);
+        for (int i = 0; i < 3; ++i)
+            rate_[i] = gyro_[i] - bias[i];
+        mahony_.Update(gx - bias[0], gy - bias[1], gz - bias[2], accel_filtered_[0],
+                       accel_filtered_[1], accel_filtered_[2], dt);
+        mahony_.GetQuaternion(q);
+        INSCalculate();
+    }
+    void AHRS::Start(float ax, float ay, float az) {
+        // 低通滤波器从第一帧开始处于稳态，并直接从重力方向开始解算
+        accel_filter_.Reset(accel_);
+        mahony_.Reset(ax, ay, az);
+        started_ = true;
     }
-    void AHRS::CailbrateHandler(float gx, float gy, float gz, float ax, float ay, float az,
-                                float mx, float my, float mz) {
-        UNUSED(ax);
-        UNUSED(ay);
-        UNUSED(az);
-        UNUSED(mx);
-        UNUSED(my);
-        UNUSED(mz);
-        if (calib_cnt_ < 2000) {
-            calib_cnt_++;
-            g_zerodrift[0] += gx;
-            g_zerodrift[1] += gy;
-            g_zerodrift[2] += gz;
-        } else {
-            g_zerodrift[0] /= 2000;
-            g_zerodrift[1] /= 2000;
-            g_zerodrift[2] /= 2000;
+
+    void AHRS::UpdateBias(float bias[3], float dt) {
+        bias_.Update(gyro_, accel_, dt);
+        bias_.GetBias(bias);
+        if (bias_.GetConfidence() >= 1)
             cailb_done_ = true;
-            cailb_flag_ = false;
-        }
     }
     void AHRS::Cailbrate() {
-        cailb_flag_ = true;
+        bias_.Reset();
         cailb_done_ = false;
     }
 
+    void AHRS::SetGain(mahony_init_t init) {
+        mahony_.SetGain(init);
+    }
+
     bool AHRS::IsCailbrated() {
         return cailb_done_;
     }
+
+    float AHRS::GetBiasConfidence() {
+        return bias_.GetConfidence();
+    }
+
+    void AHRS::GetGyroBias(float bias[3]) {
+        bias_.GetBias(bias);
+    }
+
+    void AHRS::SetGyroBiasPrior(const float bias[3], float confidence) {
+        bias_.SetPrior(bias, confidence);
+    }
+    void AHRS::GetQuaternion(float quat[4]) {
+        for (int i = 0; i < 4; ++i)
+            quat[i] = q[i];
+    }
+
+    void AHRS::GetGyro(float gyro[3]) {
+        for (int i = 0; i < 3; ++i)
+            gyro[i] = rate_[i];
+    }
     void AHRS::INSCalculate() {
-        INS_angle[0] =
-            atan2f(2.0f * (q[0] * q[3] + q[1] * q[2]), 2.0f * (q[0] * q[0] + q[1] * q[1]) - 1.0f);
-        INS_angle[1] = asinf(-2.0f * (q[1] * q[3] - q[0] * q[2]));
-        INS_angle[2] =
-            atan2f(2.0f * (q[0] * q[1] + q[2] * q[3]), 2.0f * (q[0] * q[0] + q[3] * q[3]) - 1.0f);
+        INS_angle[0] = fast_atan2f(2.0f * (q[0] * q[3] + q[1] * q[2]),
+                                   2.0f * (q[0] * q[0] + q[1] * q[1]) - 1.0f);
+        INS_angle[1] = fast_asinf(-2.0f * (q[1] * q[3] - q[0] * q[2]));
+        INS_angle[2] = fast_atan2f(2.0f * (q[0] * q[1] + q[2] * q[3]),
+                                   2.0f * (q[0] * q[0] + q[3] * q[3]) - 1.0f);
     }
 }  // namespace control
\ No newline at end of file
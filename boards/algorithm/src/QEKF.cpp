@@ -20,10 +20,16 @@
 
 #include "QEKF.h"
 
+#include <string.h>
+
+#include "fastmath.h"
+
+#include "utils.h"
+
 namespace control {
 
-    QEKF::QEKF(qekf_gettickoffset_t gettickdelta) : gettickdelta_(gettickdelta) {
-        cailb_flag_ = false;
+    QEKF::QEKF(qekf_gettickoffset_t gettickdelta, qekf_init_t init, gyro_bias_init_t bias_init)
+        : gettickdelta_(gettickdelta), bias_(bias_init), param_(init) {
         cailb_done_ = false;
         INS_angle[0] = 0;
         INS_angle[1] = 0;
@@ -33,13 +39,24 @@ namespace control {
         q[2] = 0;
         q[3] = 0;
 
-        IMU_QuaternionEKF_Init(10, 0.001, 10000000, 1, 0);
+        if (param_.lambda > 1)
+            param_.lambda = 1;
+        kf_.x[0] = 1;
+        // 四元数的初始方差很大，让第一次观测直接决定姿态
+        for (int i = 0; i < 6; ++i)
+            for (int j = 0; j < 6; ++j)
+                kf_.P[i][j] = i != j ? 0.1f : i < 4 ? 100000 : 100;
+        for (int i = 0; i < 3; ++i)
+            kf_.R[i][i] = param_.measure_noise;
     }
 
     void QEKF::Update(float gx, float gy, float gz, float ax, float ay, float az) {
         ticks_count_current_ = gettickdelta_(&last_tick_);
         ticks_count_ += ticks_count_current_;
+        Update(gx, gy, gz, ax, ay, az, ticks_count_current_);
+    }
 
+    void QEKF::Update(float gx, float gy, float gz, float ax, float ay, float az, float dt) {
         accel_[0] = ax;
         accel_[1] = ay;
         accel_[2] = az;
@@ -47,50 +64,181 @@ namespace control {
         gyro_[1] = gy;
         gyro_[2] = gz;
 
-        if (cailb_done_) {
-            IMU_QuaternionEKF_Update(gx - g_zerodrift[0], gy - g_zerodrift[1], gz - g_zerodrift[2],
-                                     ax, ay, az, ticks_count_current_);
-            INS_angle[0] = QEKF_INS.Yaw;
-            INS_angle[1] = QEKF_INS.Pitch;
-            INS_angle[2] = QEKF_INS.Roll;
-        } else if (cailb_flag_) {
-            CailbrateHandler(gx, gy, gz, ax, ay, az, 0, 0, 0);
-        }
+        float bias[3];
+        bias_.Update(gyro_, accel_, dt);
+        bias_.GetBias(bias);
+        if (bias_.GetConfidence() >= 1)
+            cailb_done_ = true;
+        Filter(gx - bias[0], gy - bias[1], gz - bias[2], ax, ay, az, dt);
+        INSCalculate();
     }
-    void QEKF::CailbrateHandler(float gx, float gy, float gz, float ax, float ay, float az,
-                                float mx, float my, float mz) {
-        UNUSED(ax);
-        UNUSED(ay);
-        UNUSED(az);
-        UNUSED(mx);
-        UNUSED(my);
-        UNUSED(mz);
-        if (calib_cnt_ < 2000) {
-            calib_cnt_++;
-            g_zerodrift[0] += gx;
-            g_zerodrift[1] += gy;
-            g_zerodrift[2] += gz;
+
+    void QEKF::Filter(float gx, float gy, float gz, float ax, float ay, float az, float dt) {
+        float* x = kf_.x;
+        const float wx = gx - gyro_bias_[0];
+        const float wy = gy - gyro_bias_[1];
+        const float wz = gz - gyro_bias_[2];
+        const float hx = 0.5f * wx * dt;
+        const float hy = 0.5f * wy * dt;
+        const float hz = 0.5f * wz * dt;
+
+        // 加速度计低通滤波，第一次进入时用当前值初始化
+        if (update_count_ == 0) {
+            accel_filtered_[0] = ax;
+            accel_filtered_[1] = ay;
+            accel_filtered_[2] = az;
+        }
+        const float lpf = param_.accel_lpf;
+        accel_filtered_[0] = accel_filtered_[0] * lpf / (dt + lpf) + ax * dt / (dt + lpf);
+        accel_filtered_[1] = accel_filtered_[1] * lpf / (dt + lpf) + ay * dt / (dt + lpf);
+        accel_filtered_[2] = accel_filtered_[2] * lpf / (dt + lpf) + az * dt / (dt + lpf);
+        const float accel_norm = sqrtf(accel_filtered_[0] * accel_filtered_[0] +
+                                       accel_filtered_[1] * accel_filtered_[1] +
+                                       accel_filtered_[2] * accel_filtered_[2]);
+        float z[3];
+        for (int i = 0; i < 3; ++i)
+            z[i] = accel_filtered_[i] / accel_norm;
+        const float gyro_norm = sqrtf(wx * wx + wy * wy + wz * wz);
+        const bool stable =
+            gyro_norm < 0.3f && accel_norm > 9.8f - 0.5f && accel_norm < 9.8f + 0.5f;
+
+        for (int i = 0; i < 6; ++i)
+            kf_.Q[i][i] = (i < 4 ? param_.quaternion_noise : param_.bias_noise) * dt;
+
+        // 四元数按角速度积分，零漂保持不变
+        const float p0 = x[0], p1 = x[1], p2 = x[2], p3 = x[3];
+        const float q0 = p0 - hx * p1 - hy * p2 - hz * p3;
+        const float q1 = hx * p0 + p1 + hz * p2 - hy * p3;
+        const float q2 = hy * p0 - hz * p1 + p2 + hx * p3;
+        const float q3 = hz * p0 + hy * p1 - hx * p2 + p3;
+        const float inv_norm = 1.0f / sqrtf(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+        x[0] = q0 * inv_norm;
+        x[1] = q1 * inv_norm;
+        x[2] = q2 * inv_norm;
+        x[3] = q3 * inv_norm;
+
+        // 线性化的状态转移矩阵，右上角是四元数对零漂的偏导
+        float(&F)[6][6] = kf_.F;
+        memset(F, 0, sizeof(F));
+        for (int i = 0; i < 6; ++i)
+            F[i][i] = 1;
+        F[0][1] = -hx, F[0][2] = -hy, F[0][3] = -hz;
+        F[1][0] = hx, F[1][2] = hz, F[1][3] = -hy;
+        F[2][0] = hy, F[2][1] = -hz, F[2][3] = hx;
+        F[3][0] = hz, F[3][1] = hy, F[3][2] = -hx;
+        F[0][4] = q1 * dt / 2, F[0][5] = q2 * dt / 2;
+        F[1][4] = -q0 * dt / 2, F[1][5] = q3 * dt / 2;
+        F[2][4] = -q3 * dt / 2, F[2][5] = -q0 * dt / 2;
+        F[3][4] = q2 * dt / 2, F[3][5] = -q1 * dt / 2;
+
+        // 零漂方差渐消并限幅，防止过度收敛和发散
+        kf_.P[4][4] = fminf(kf_.P[4][4] / param_.lambda, 10000);
+        kf_.P[5][5] = fminf(kf_.P[5][5] / param_.lambda, 10000);
+        kf_.PredictCovariance();
+
+        // 观测函数为机体坐标系下的重力方向
+        float(&H)[3][6] = kf_.H;
+        H[0][0] = -2 * x[2], H[0][1] = 2 * x[3], H[0][2] = -2 * x[0], H[0][3] = 2 * x[1];
+        H[1][0] = 2 * x[1], H[1][1] = 2 * x[0], H[1][2] = 2 * x[3], H[1][3] = 2 * x[2];
+        H[2][0] = 2 * x[0], H[2][1] = -2 * x[1], H[2][2] = -2 * x[2], H[2][3] = 2 * x[3];
+        if (!kf_.ComputeGain()) {
+            update_count_++;
+            return;
+        }
+
+        const float h[3] = {2 * (x[1] * x[3] - x[0] * x[2]), 2 * (x[0] * x[1] + x[2] * x[3]),
+                            x[0] * x[0] - x[1] * x[1] - x[2] * x[2] + x[3] * x[3]};
+        float y[3];
+        float orientation_cosine[3];
+        for (int i = 0; i < 3; ++i) {
+            y[i] = z[i] - h[i];
+            orientation_cosine[i] = acosf(fabsf(h[i]));
+        }
+
+        // 卡方检验，收敛后拒绝明显不符合的观测(例如剧烈的线加速度)，静止时仍然持续不通过则
+        // 认为已经发散，重新接受观测
+        const float threshold = 1e-8f;
+        const float chi_square = kf_.Mahalanobis(y);
+        if (chi_square < 0.5f * threshold)
+            converged_ = true;
+        if (chi_square > threshold && converged_) {
+            error_count_ = stable ? error_count_ + 1 : 0;
+            if (error_count_ > 50) {
+                converged_ = false;
+            } else {
+                // 拒绝本次观测，只保留先验
+                update_count_++;
+                return;
+            }
         } else {
-            g_zerodrift[0] /= 2000;
-            g_zerodrift[1] /= 2000;
-            g_zerodrift[2] /= 2000;
-            cailb_done_ = true;
-            cailb_flag_ = false;
+            if (chi_square > 0.1f * threshold && converged_)
+                adaptive_gain_scale_ = (threshold - chi_square) / (0.9f * threshold);
+            else
+                adaptive_gain_scale_ = 1;
+            error_count_ = 0;
+        }
+
+        float(&K)[6][3] = kf_.K;
+        for (int i = 0; i < 6; ++i) {
+            // 零漂的修正量按对应轴与重力的夹角缩放，轴接近竖直时几乎不可观
+            const float scale = i < 4 ? 1 : orientation_cosine[i - 4] / 1.5707963f;
+            for (int j = 0; j < 3; ++j)
+                K[i][j] *= adaptive_gain_scale_ * scale;
+        }
+        float dx[6];
+        for (int i = 0; i < 6; ++i)
+            dx[i] = K[i][0] * y[0] + K[i][1] * y[1] + K[i][2] * y[2];
+        if (converged_) {
+            dx[4] = clip<float>(dx[4], -1e-2f * dt, 1e-2f * dt);
+            dx[5] = clip<float>(dx[5], -1e-2f * dt, 1e-2f * dt);
         }
+        dx[3] = 0;
+        for (int i = 0; i < 6; ++i)
+            x[i] += dx[i];
+        kf_.UpdateCovariance();
+        for (int i = 0; i < 6; ++i)
+            kf_.P[i][i] = fmaxf(kf_.P[i][i], 0);
+
+        gyro_bias_[0] = x[4];
+        gyro_bias_[1] = x[5];
+        gyro_bias_[2] = 0;  // 大部分时候z轴通天，无法观测yaw的漂移
+        update_count_++;
+    }
+
+    void QEKF::GetQuaternion(float quaternion[4]) const {
+        for (int i = 0; i < 4; ++i)
+            quaternion[i] = q[i];
+    }
+
+    void QEKF::GetGyroBias(float bias[3]) const {
+        bias_.GetBias(bias);
+        for (int i = 0; i < 3; ++i)
+            bias[i] += gyro_bias_[i];
     }
+
     void QEKF::Cailbrate() {
-        cailb_flag_ = true;
+        bias_.Reset();
         cailb_done_ = false;
     }
 
     bool QEKF::IsCailbrated() {
         return cailb_done_;
     }
+
+    float QEKF::GetBiasConfidence() {
+        return bias_.GetConfidence();
+    }
+
+    void QEKF::SetGyroBiasPrior(const float bias[3], float confidence) {
+        bias_.SetPrior(bias, confidence);
+    }
     void QEKF::INSCalculate() {
-        INS_angle[0] =
-            atan2f(2.0f * (q[0] * q[3] + q[1] * q[2]), 2.0f * (q[0] * q[0] + q[1] * q[1]) - 1.0f);
-        INS_angle[1] = asinf(-2.0f * (q[1] * q[3] - q[0] * q[2]));
-        INS_angle[2] =
-            atan2f(2.0f * (q[0] * q[1] + q[2] * q[3]), 2.0f * (q[0] * q[0] + q[3] * q[3]) - 1.0f);
+        for (int i = 0; i < 4; ++i)
+            q[i] = kf_.x[i];
+        INS_angle[0] = fast_atan2f(2.0f * (q[0] * q[3] + q[1] * q[2]),
+                                   2.0f * (q[0] * q[0] + q[1] * q[1]) - 1.0f);
+        INS_angle[1] = fast_atan2f(2.0f * (q[0] * q[1] + q[2] * q[3]),
+                                   2.0f * (q[0] * q[0] + q[3] * q[3]) - 1.0f);
+        INS_angle[2] = fast_asinf(-2.0f * (q[1] * q[3] - q[0] * q[2]));
     }
 }  // namespace control
\ No newline at end of file
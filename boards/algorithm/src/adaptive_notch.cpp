@@ -0,0 +1,215 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#include "adaptive_notch.h"
+
+#include <math.h>
+
+#include "fastmath.h"
+#include "utils.h"
+
+namespace control {
+
+    // 连续这么多次没有找到振动后关闭陷波器 / misses in a row before the notch is disabled
+    static constexpr int MAX_MISSES = 3;
+    // 与当前频率相差超过这么多个频点时直接跳到新的频率，不做平滑
+    // jumps of more than this many bins are taken directly instead of smoothed
+    static constexpr float JUMP_BINS = 4.0f;
+    // 其他陷波器频率两侧屏蔽的频点数 / bins masked on each side of the other notches
+    static constexpr int MASK_BINS = 3;
+
+    // 运行时设计陷波器，与BiquadNotch相同但是用单精度的快速三角函数
+    // notch design at runtime, the same as BiquadNotch but with single precision fast sine
+    static biquad_coeff_t NotchCoefficients(float sample_rate, float frequency, float q) {
+        float sine, cosine;
+        fast_sincosf(2 * FAST_PI * frequency / sample_rate, &sine, &cosine);
+        const float alpha = sine / (2 * q);
+        const float inv = 1 / (1 + alpha);
+        return {inv, -2 * cosine * inv, inv, -2 * cosine * inv, (1 - alpha) * inv};
+    }
+
+    AdaptiveNotch::AdaptiveNotch(adaptive_notch_init_t init)
+        : init_(init), filter_(BIQUAD_IDENTITY), pending_mask_(0), samples_(0), full_(false) {
+        for (int i = 0; i < NOTCHES; ++i) {
+            frequency_[i] = 0;
+            misses_[i] = 0;
+        }
+#ifdef BIQUAD_USE_CMSIS
+        arm_rfft_fast_init_f32(&rfft_, FFT_LENGTH);
+#endif
+    }
+
+    void AdaptiveNotch::Update(const float input[3], float output[3]) {
+        // 记录陷波之前的数据，否则振动被滤掉后就找不到了
+        // the data is recorded before the notches, or the vibration would vanish once notched
+        if (!full_.load(std::memory_order_acquire)) {
+            for (int i = 0; i < 3; ++i)
+                buffer_[i][samples_] = input[i];
+            if (++samples_ == FFT_LENGTH) {
+                samples_ = 0;
+                full_.store(true, std::memory_order_release);
+            }
+        }
+        uint32_t mask = pending_mask_.exchange(0, std::memory_order_acquire);
+        for (int i = 0; mask != 0; ++i, mask >>= 1)
+            if (mask & 1)
+                filter_.SetCoefficients(i, pending_[i]);
+        filter_.Update(input, output);
+    }
+
+    void AdaptiveNotch::SetFrequency(int notch, float frequency) {
+        if (frequency < init_.min_frequency || frequency >= init_.sample_rate / 2)
+            frequency = 0;
+        if (frequency == frequency_[notch])
+            return;
+        frequency_[notch] = frequency;
+        // 先撤回旧的请求再改系数，Update打断时不会读到写了一半的系数
+        // withdraw the old request before writing, so an interrupting Update never reads a half
+        // written set
+        const uint32_t bit = 1u << notch;
+        pending_mask_.fetch_and(~bit, std::memory_order_relaxed);
+        pending_[notch] = frequency > 0 ? NotchCoefficients(init_.sample_rate, frequency, init_.q)
+                                        : BIQUAD_IDENTITY;
+        pending_mask_.fetch_or(bit, std::memory_order_release);
+    }
+
+    float AdaptiveNotch::GetFrequency(int notch) const {
+        return frequency_[notch];
+    }
+
+    bool AdaptiveNotch::Analyze(int notch) {
+        if (!full_.load(std::memory_order_acquire))
+            return false;
+        Spectrum();
+        full_.store(false, std::memory_order_release);
+
+        const float resolution = init_.sample_rate / FFT_LENGTH;
+        const int first = max<int>(2, (int)(init_.min_frequency / resolution));
+        const int last = min<int>(FFT_LENGTH / 2 - 2, (int)(init_.max_frequency / resolution) + 1);
+        // 其他陷波器已经处理的振动不参与搜索，缓冲区里的数据是陷波之前的
+        // vibration the other notches already handle is left out, the buffer holds raw data
+        for (int i = 0; i < NOTCHES; ++i) {
+            if (i == notch || frequency_[i] == 0)
+                continue;
+            const int center = (int)(frequency_[i] / resolution + 0.5f);
+            for (int k = max<int>(0, center - MASK_BINS);
+                 k <= min<int>(FFT_LENGTH / 2 - 1, center + MASK_BINS); ++k)
+                power_[k] = -1;
+        }
+        int peak = first;
+        int bins = 0;
+        float sum = 0;
+        for (int k = first; k <= last; ++k) {
+            if (power_[k] < 0)
+                continue;
+            sum += power_[k];
+            ++bins;
+            if (power_[k] > power_[peak])
+                peak = k;
+        }
+        // 平均值不含峰本身和Hann窗泄漏到的两侧频点
+        // the mean leaves out the peak and the two bins the Hann window leaks it into
+        const float peak_power = max<float>(power_[peak - 1], 0) + power_[peak] +
+                                 max<float>(power_[peak + 1], 0);
+        const float mean = (sum - peak_power) / max<int>(1, bins - 3);
+        if (power_[peak - 1] < 0 || power_[peak + 1] < 0 ||
+            !(power_[peak] > init_.peak_ratio * mean)) {
+            if (++misses_[notch] >= MAX_MISSES)
+                SetFrequency(notch, 0);
+            return true;
+        }
+        misses_[notch] = 0;
+
+        // 高斯窗近似下对数功率的抛物线插值 / parabolic interpolation of the log power
+        const float a = logf(power_[peak - 1] + 1e-20f);
+        const float b = logf(power_[peak] + 1e-20f);
+        const float c = logf(power_[peak + 1] + 1e-20f);
+        const float den = a - 2 * b + c;
+        const float delta = den < 0 ? clip<float>(0.5f * (a - c) / den, -0.5f, 0.5f) : 0;
+        const float frequency = (peak + delta) * resolution;
+
+        const float current = frequency_[notch];
+        if (current == 0 || fabsf(frequency - current) > JUMP_BINS * resolution)
+            SetFrequency(notch, frequency);
+        else
+            SetFrequency(notch, current + init_.smoothing * (frequency - current));
+        return true;
+    }
+
+    void AdaptiveNotch::Spectrum() {
+        for (int k = 0; k < FFT_LENGTH / 2; ++k)
+            power_[k] = 0;
+        for (int axis = 0; axis < 3; ++axis) {
+            // 去掉均值后加Hann窗，角速度本身的直流和低频不影响峰值搜索
+            // remove the mean and apply a Hann window so the motion itself does not leak in
+            float mean = 0;
+            for (int n = 0; n < FFT_LENGTH; ++n)
+                mean += buffer_[axis][n];
+            mean /= FFT_LENGTH;
+            for (int n = 0; n < FFT_LENGTH; ++n) {
+                float sine, cosine;
+                fast_sincosf(2 * FAST_PI * n / FFT_LENGTH, &sine, &cosine);
+                work_[n] = (buffer_[axis][n] - mean) * 0.5f * (1 - cosine);
+            }
+#ifdef BIQUAD_USE_CMSIS
+            // 输出为DC、奈奎斯特频率的实部，之后每个频点一对实部和虚部
+            // the output is the real DC and Nyquist terms followed by a real and imaginary pair
+            // per bin
+            arm_rfft_fast_f32(&rfft_, work_, spectrum_, 0);
+            for (int k = 1; k < FFT_LENGTH / 2; ++k)
+                power_[k] += spectrum_[2 * k] * spectrum_[2 * k] +
+                             spectrum_[2 * k + 1] * spectrum_[2 * k + 1];
+#else
+            // 可移植的基2复数FFT，虚部为0 / portable radix 2 complex FFT with a zero imaginary part
+            for (int n = 0; n < FFT_LENGTH; ++n)
+                imag_[n] = 0;
+            for (int i = 1, j = 0; i < FFT_LENGTH; ++i) {
+                int bit = FFT_LENGTH >> 1;
+                for (; j & bit; bit >>= 1)
+                    j ^= bit;
+                j ^= bit;
+                if (i < j) {
+                    const float t = work_[i];
+                    work_[i] = work_[j];
+                    work_[j] = t;
+                }
+            }
+            for (int length = 2; length <= FFT_LENGTH; length <<= 1) {
+                for (int k = 0; k < length / 2; ++k) {
+                    float wi, wr;
+                    fast_sincosf(-2 * FAST_PI * k / length, &wi, &wr);
+                    for (int i = k; i < FFT_LENGTH; i += length) {
+                        const int j = i + length / 2;
+                        const float tr = work_[j] * wr - imag_[j] * wi;
+                        const float ti = work_[j] * wi + imag_[j] * wr;
+                        work_[j] = work_[i] - tr;
+                        imag_[j] = imag_[i] - ti;
+                        work_[i] += tr;
+                        imag_[i] += ti;
+                    }
+                }
+            }
+            for (int k = 1; k < FFT_LENGTH / 2; ++k)
+                power_[k] += work_[k] * work_[k] + imag_[k] * imag_[k];
+#endif
+        }
+    }
+
+}  // namespace control
@@ -0,0 +1,87 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#include "adrc.h"
+
+#include "utils.h"
+
+namespace control {
+
+    ADRC::ADRC(adrc_init_t init) {
+        Reinit(init);
+    }
+
+    void ADRC::Reinit(adrc_init_t init) {
+        param_ = init;
+        param_.order = init.order >= 2 ? 2 : 1;
+    }
+
+    void ADRC::Reset() {
+        z_[0] = z_[1] = z_[2] = 0;
+        output_ = 0;
+        ready_ = false;
+    }
+
+    float ADRC::ComputeOutput(float target, float measure, float dt) {
+        return ComputeOutput(target, 0, measure, dt);
+    }
+
+    float ADRC::ComputeOutput(float target, float target_rate, float measure, float dt) {
+        if (!ready_) {
+            // 从测量值开始观测，扰动和导数初始为0
+            Reset();
+            z_[0] = measure;
+            ready_ = true;
+        } else if (dt > 0) {
+            // 用上一周期实际作用在被控对象上的输出更新观测器
+            const float wo = param_.wo;
+            const float error = z_[0] - measure;
+            if (param_.order == 1) {
+                z_[0] += dt * (z_[1] + param_.b0 * output_ - 2 * wo * error);
+                z_[1] -= dt * wo * wo * error;
+            } else {
+                z_[0] += dt * (z_[1] - 3 * wo * error);
+                z_[1] += dt * (z_[2] + param_.b0 * output_ - 3 * wo * wo * error);
+                z_[2] -= dt * wo * wo * wo * error;
+            }
+        }
+
+        // 抵消总扰动后按纯积分器设计的比例(-微分)控制律
+        const float wc = param_.wc;
+        float output;
+        if (param_.order == 1) {
+            output = (wc * (target - z_[0]) - z_[1]) / param_.b0;
+        } else {
+            output = (wc * wc * (target - z_[0]) + 2 * wc * (target_rate - z_[1]) - z_[2]) /
+                     param_.b0;
+        }
+        output_ = clip<float>(output, -param_.max_out, param_.max_out);
+        return output_;
+    }
+
+    float ADRC::GetEstimate(uint8_t index) const {
+        return index < 3 ? z_[index] : 0;
+    }
+
+    float ADRC::GetDisturbance() const {
+        return z_[param_.order] / param_.b0;
+    }
+
+}  // namespace control
@@ -0,0 +1,178 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#include "attitude_history.h"
+
+#include <math.h>
+
+#include "fastmath.h"
+
+namespace control {
+
+    // 查找过程中被写者覆盖时重新查找的次数 / lookups restarted when the writer overwrote them
+    static constexpr int MAX_RETRY = 3;
+    // 夹角小于该值时用归一化的线性插值代替球面插值，cos(0.5°)
+    // below this angle the normalized linear interpolation replaces slerp, cos(0.5°)
+    static constexpr float SLERP_THRESHOLD = 0.99996f;
+
+    AttitudeHistory::AttitudeHistory() : count_(0), last_(0) {
+        for (int i = 0; i < CAPACITY; ++i)
+            slot_[i].sequence.store(0, std::memory_order_relaxed);
+    }
+
+    void AttitudeHistory::Push(uint64_t timestamp, const float q[4], const float gyro[3]) {
+        const uint32_t index = count_.load(std::memory_order_relaxed);
+        if (index > 0 && timestamp <= last_)
+            return;
+        last_ = timestamp;
+        slot_t& slot = slot_[index % CAPACITY];
+        // 序号清零后读者不会再接受这个格子里的数据
+        // readers reject the slot as soon as the sequence is cleared
+        slot.sequence.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.timestamp = timestamp;
+        for (int i = 0; i < 4; ++i)
+            slot.q[i] = q[i];
+        for (int i = 0; i < 3; ++i)
+            slot.gyro[i] = gyro[i];
+        slot.sequence.store(index + 1, std::memory_order_release);
+        count_.store(index + 1, std::memory_order_release);
+    }
+
+    bool AttitudeHistory::ReadTime(uint32_t index, uint64_t* timestamp) const {
+        const slot_t& slot = slot_[index % CAPACITY];
+        if (slot.sequence.load(std::memory_order_acquire) != index + 1)
+            return false;
+        *timestamp = slot.timestamp;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.sequence.load(std::memory_order_relaxed) == index + 1;
+    }
+
+    bool AttitudeHistory::ReadSample(uint32_t index, uint64_t* timestamp, float q[4],
+                                     float gyro[3]) const {
+        const slot_t& slot = slot_[index % CAPACITY];
+        if (slot.sequence.load(std::memory_order_acquire) != index + 1)
+            return false;
+        *timestamp = slot.timestamp;
+        for (int i = 0; i < 4; ++i)
+            q[i] = slot.q[i];
+        for (int i = 0; i < 3; ++i)
+            gyro[i] = slot.gyro[i];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.sequence.load(std::memory_order_relaxed) == index + 1;
+    }
+
+    bool AttitudeHistory::Query(uint64_t timestamp, float q[4], float gyro[3]) const {
+        for (int retry = 0; retry < MAX_RETRY; ++retry) {
+            const uint32_t count = count_.load(std::memory_order_acquire);
+            if (count == 0)
+                return false;
+            // 最旧的格子随时可能被下一次写入覆盖，不使用
+            // the oldest slot may be overwritten by the next write at any moment, so it is skipped
+            uint32_t lo = count > CAPACITY - 1 ? count - (CAPACITY - 1) : 0;
+            uint32_t hi = count - 1;
+            uint64_t time_lo, time_hi;
+            if (!ReadTime(hi, &time_hi) || !ReadTime(lo, &time_lo))
+                continue;
+            if (timestamp < time_lo || timestamp > time_hi)
+                return false;
+
+            // 二分查找时间不晚于查询时间的最新样本
+            // binary search for the latest sample not later than the query
+            bool overwritten = false;
+            while (hi - lo > 1) {
+                const uint32_t mid = lo + (hi - lo) / 2;
+                uint64_t time_mid;
+                if (!ReadTime(mid, &time_mid)) {
+                    overwritten = true;
+                    break;
+                }
+                if (time_mid <= timestamp)
+                    lo = mid;
+                else
+                    hi = mid;
+            }
+            if (overwritten)
+                continue;
+
+            uint64_t time_a, time_b;
+            float q_a[4], q_b[4], gyro_a[3], gyro_b[3];
+            if (!ReadSample(lo, &time_a, q_a, gyro_a) || !ReadSample(hi, &time_b, q_b, gyro_b))
+                continue;
+            const float t =
+                time_b > time_a ? (float)(timestamp - time_a) / (float)(time_b - time_a) : 0;
+            Slerp(q_a, q_b, t, q);
+            if (gyro != nullptr)
+                for (int i = 0; i < 3; ++i)
+                    gyro[i] = gyro_a[i] + (gyro_b[i] - gyro_a[i]) * t;
+            return true;
+        }
+        return false;
+    }
+
+    bool AttitudeHistory::GetLatest(uint64_t* timestamp, float q[4], float gyro[3]) const {
+        for (int retry = 0; retry < MAX_RETRY; ++retry) {
+            const uint32_t count = count_.load(std::memory_order_acquire);
+            if (count == 0)
+                return false;
+            uint64_t time;
+            float q_latest[4], gyro_latest[3];
+            if (!ReadSample(count - 1, &time, q_latest, gyro_latest))
+                continue;
+            *timestamp = time;
+            for (int i = 0; i < 4; ++i)
+                q[i] = q_latest[i];
+            if (gyro != nullptr)
+                for (int i = 0; i < 3; ++i)
+                    gyro[i] = gyro_latest[i];
+            return true;
+        }
+        return false;
+    }
+
+    void AttitudeHistory::Slerp(const float a[4], const float b[4], float t, float q[4]) {
+        float dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+        // q和-q是同一个姿态，取较短的一段弧 / q and -q are the same attitude, take the short arc
+        const float sign = dot < 0 ? -1.0f : 1.0f;
+        dot *= sign;
+        float weight_a = 1 - t;
+        float weight_b = t;
+        if (dot < SLERP_THRESHOLD) {
+            const float sin_theta = sqrtf(1 - dot * dot);
+            const float theta = fast_atan2f(sin_theta, dot);
+            float cosine;
+            fast_sincosf((1 - t) * theta, &weight_a, &cosine);
+            fast_sincosf(t * theta, &weight_b, &cosine);
+            weight_a /= sin_theta;
+            weight_b /= sin_theta;
+        }
+        weight_b *= sign;
+        float result[4];
+        float norm = 0;
+        for (int i = 0; i < 4; ++i) {
+            result[i] = weight_a * a[i] + weight_b * b[i];
+            norm += result[i] * result[i];
+        }
+        norm = 1.0f / sqrtf(norm);
+        for (int i = 0; i < 4; ++i)
+            q[i] = result[i] * norm;
+    }
+
+}  // namespace control
@@ -0,0 +1,166 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#include "autotune.h"
+
+#include <math.h>
+
+#include "utils.h"
+
+namespace control {
+
+    RelayAutoTuner::RelayAutoTuner(relay_tune_init_t init) : init_(init) {
+        init_.cycles = clip<uint8_t>(init_.cycles, 2, MAX_CYCLES);
+        Restart();
+    }
+
+    void RelayAutoTuner::Restart() {
+        state_ = RUNNING;
+        result_ = {};
+        high_ = true;
+        ticks_ = 0;
+        last_switch_ = 0;
+        switches_ = 0;
+        cycle_cnt_ = 0;
+    }
+
+    float RelayAutoTuner::Update(float measure) {
+        if (state_ != RUNNING)
+            return init_.bias;
+        if (ticks_ == 0) {
+            max_ = measure;
+            min_ = measure;
+        }
+        ++ticks_;
+        if (ticks_ * init_.period > init_.timeout) {
+            state_ = TIMEOUT;
+            return init_.bias;
+        }
+
+        max_ = max(max_, measure);
+        min_ = min(min_, measure);
+
+        // 带滞环的继电器，误差越过滞环时才切换，避免噪声引起的抖动
+        const float error = init_.setpoint - measure;
+        if (!high_ && error > init_.hysteresis) {
+            high_ = true;
+            FinishCycle();
+            max_ = measure;
+            min_ = measure;
+        } else if (high_ && error < -init_.hysteresis) {
+            high_ = false;
+        }
+        if (state_ != RUNNING)
+            return init_.bias;
+        return init_.bias + (high_ ? init_.amplitude : -init_.amplitude);
+    }
+
+    void RelayAutoTuner::FinishCycle() {
+        // 每次切换到高电平时结束一个振荡周期，第一次切换之前的过程是暂态，不记录
+        if (switches_++ > 0) {
+            if (cycle_cnt_ == init_.cycles) {
+                for (int i = 1; i < cycle_cnt_; ++i) {
+                    periods_[i - 1] = periods_[i];
+                    amplitudes_[i - 1] = amplitudes_[i];
+                }
+                --cycle_cnt_;
+            }
+            periods_[cycle_cnt_] = (ticks_ - last_switch_) * init_.period;
+            amplitudes_[cycle_cnt_] = (max_ - min_) / 2;
+            ++cycle_cnt_;
+        }
+        last_switch_ = ticks_;
+        if (cycle_cnt_ < init_.cycles)
+            return;
+
+        // 最近几个周期的前一半和后一半的平均周期和平均幅值都相差不超过5%时，认为已经进入稳定的
+        // 极限环。采样让各个周期的长度相差一个控制周期，单个周期的幅值也随之波动，无噪声时也可能
+        // 超过5%，所以比较两半的平均值而不是极差
+        const int half = cycle_cnt_ / 2;
+        float period_early = 0, period_late = 0, amplitude_early = 0, amplitude_late = 0;
+        for (int i = 0; i < half; ++i) {
+            period_early += periods_[i];
+            amplitude_early += amplitudes_[i];
+            period_late += periods_[cycle_cnt_ - 1 - i];
+            amplitude_late += amplitudes_[cycle_cnt_ - 1 - i];
+        }
+        float period_sum = 0, amplitude_sum = 0;
+        for (int i = 0; i < cycle_cnt_; ++i) {
+            period_sum += periods_[i];
+            amplitude_sum += amplitudes_[i];
+        }
+        const float period = period_sum / cycle_cnt_;
+        const float amplitude = amplitude_sum / cycle_cnt_;
+        if (fabsf(period_late - period_early) > 0.05f * period * half ||
+            fabsf(amplitude_late - amplitude_early) > 0.05f * amplitude * half ||
+            amplitude <= init_.hysteresis) {
+            return;
+        }
+
+        const float hysteresis = init_.hysteresis;
+        result_.ku =
+            4 * init_.amplitude / (PI * sqrtf(amplitude * amplitude - hysteresis * hysteresis));
+        result_.tu = period;
+        result_.amplitude = amplitude;
+        state_ = SUCCESS;
+    }
+
+    RelayAutoTuner::tune_state_t RelayAutoTuner::State() const {
+        return state_;
+    }
+
+    relay_tune_result_t RelayAutoTuner::Result() const {
+        return result_;
+    }
+
+    ConstrainedPID::PID_Init_t RelayAutoTuner::Gains(tune_rule_t rule, float max_iout,
+                                                     float max_out) const {
+        // 各规则的比例增益、积分时间、微分时间，分别为Ku、Tu、Tu的倍数，顺序与tune_rule_t一致
+        static constexpr float rules[][3] = {
+            {0.45f, 1 / 1.2f, 0},         // ZIEGLER_NICHOLS_PI
+            {0.6f, 1 / 2.0f, 1 / 8.0f},   // ZIEGLER_NICHOLS_PID
+            {1 / 3.2f, 2.2f, 0},          // TYREUS_LUYBEN_PI
+            {1 / 2.2f, 2.2f, 1 / 6.3f},   // TYREUS_LUYBEN_PID
+            {0.33f, 1 / 2.0f, 1 / 3.0f},  // SOME_OVERSHOOT_PID
+            {0.2f, 1 / 2.0f, 1 / 3.0f},   // NO_OVERSHOOT_PID
+        };
+        const float* factor = rules[rule <= NO_OVERSHOOT_PID ? rule : NO_OVERSHOOT_PID];
+        const float kp = factor[0] * result_.ku;
+        const float ti = factor[1] * result_.tu;
+        const float td = factor[2] * result_.tu;
+
+        // ConstrainedPID每次调用累加一次积分、计算一次差分，需要换算为每个控制周期的增益
+        const float dt = init_.period;
+        return {
+            .kp = kp,
+            .ki = ti > 0 ? kp * dt / ti : 0,
+            .kd = kp * td / dt,
+            .max_out = max_out,
+            .max_iout = max_iout,
+            .deadband = 0,
+            .A = 0,
+            .B = 0,
+            .output_filtering_coefficient = 0,
+            .derivative_filtering_coefficient = 0,
+            .mode = ConstrainedPID::Integral_Limit,
+        };
+    }
+
+}  // namespace control
@@ -0,0 +1,159 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#include "ballistics.h"
+
+#include <math.h>
+
+#include "fastmath.h"
+#include "utils.h"
+
+namespace control {
+
+    static constexpr float GRAVITY = 9.8f;
+    // 分段数和割线法的迭代次数，固定不变让耗时与输入无关
+    // number of segments and secant steps, both fixed so the run time does not depend on the input
+    static constexpr int SEGMENTS = 4;
+    static constexpr int ITERATIONS = 4;
+    // 只解低弹道，有阻力时最大射程对应的俯仰角小于45°
+    // only the low arc is solved, with drag the maximum range is reached below 45°
+    static constexpr float MAX_PITCH = FAST_PI / 4;
+    static constexpr float MIN_PITCH = -FAST_PI_2 * 0.9f;
+    static constexpr float MAX_STEP = 0.2f;
+    // 每段内水平速度最多衰减到e^-5，更大时早已打不到目标，防止溢出
+    // the horizontal speed decays at most by e^-5 per segment, the target is long out of range
+    // beyond that, keeps the exponential from overflowing
+    static constexpr float MAX_DECAY = 5.0f;
+
+    // expm1(z)/z，z趋于0时为1；每段的z通常小于0.25，用级数代替expm1f
+    // expm1(z)/z, which is 1 as z goes to 0; z of a segment is mostly below 0.25, where the
+    // series replaces expm1f
+    static inline float Expm1Ratio(float z) {
+        if (z >= 0.25f)
+            return expm1f(z) / z;
+        return 1 + z * (1 / 2.0f + z * (1 / 6.0f + z * (1 / 24.0f + z * (1 / 120.0f + z / 720))));
+    }
+
+    // 2(e^z-1-z)/z²，z趋于0时为1 / 2(e^z-1-z)/z², which is 1 as z goes to 0
+    static inline float Expm2Ratio(float z) {
+        if (z >= 0.5f)
+            return 2 * (expm1f(z) - z) / (z * z);
+        return 1 + z * (1 / 3.0f + z * (1 / 12.0f + z * (1 / 60.0f + z * (1 / 360.0f + z / 2520))));
+    }
+
+    Ballistics::Ballistics(ballistics_init_t init)
+        : init_(init), speed_(init.muzzle_speed), measured_(false) {
+    }
+
+    void Ballistics::UpdateMuzzleSpeed(float measured) {
+        if (measured <= 0)
+            return;
+        // 第一发直接采用，之后限制单次的变化量再低通
+        // the first shot is taken as is, later ones are limited in step and low passed
+        if (!measured_) {
+            speed_ = measured;
+            measured_ = true;
+            return;
+        }
+        const float delta = clip<float>(measured - speed_, -init_.speed_tolerance,
+                                        init_.speed_tolerance);
+        speed_ += init_.speed_filter * delta;
+    }
+
+    float Ballistics::Trajectory(float pitch, float distance, float* time) const {
+        float sine, cosine;
+        fast_sincosf(pitch, &sine, &cosine);
+        float vx = speed_ * cosine;
+        float vy = speed_ * sine;
+        const float d = distance / SEGMENTS;
+        float y = 0, t = 0;
+        for (int i = 0; i < SEGMENTS; ++i) {
+            // 以x为自变量，k = drag·|v|/vx看作常数，段长为d，a = k·d时：
+            // vx' = vx·e^-a，t = d/vx·expm1(a)/a，
+            // vy' = (vy - g·d/vx·expm1(2a)/(2a))·e^-a，
+            // y = vy/vx·d - g·d²/(2vx²)·2(e^2a - 1 - 2a)/(2a)²
+            // with x as the variable, k = drag·|v|/vx taken as constant, a segment of length d
+            // and a = k·d, the motion over the segment is the above
+            const float ratio = sqrtf(vx * vx + vy * vy) / vx;
+            // 先用段首的|v|/vx预测段尾的速度，再用两端的平均值计算
+            // predict the end velocity with |v|/vx at the start, then use the mean of both ends
+            float a = fminf(init_.drag * ratio * d, MAX_DECAY);
+            float e1 = Expm1Ratio(a);
+            float decay = 1 + a * e1;
+            const float vx_end = vx / decay;
+            const float vy_end = (vy - GRAVITY * d / vx * e1 * (1 + decay) / 2) / decay;
+            const float ratio_end = sqrtf(vx_end * vx_end + vy_end * vy_end) / vx_end;
+
+            a = fminf(init_.drag * (ratio + ratio_end) / 2 * d, MAX_DECAY);
+            e1 = Expm1Ratio(a);
+            decay = 1 + a * e1;
+            y += vy / vx * d - GRAVITY * d * d / (2 * vx * vx) * Expm2Ratio(2 * a);
+            t += d / vx * e1;
+            // expm1(2a)/(2a) = expm1(a)/a·(1 + e^a)/2
+            vy = (vy - GRAVITY * d / vx * e1 * (1 + decay) / 2) / decay;
+            vx /= decay;
+        }
+        *time = t;
+        return y;
+    }
+
+    bool Ballistics::Solve(float distance, float height, float* pitch, float* time) const {
+        if (distance <= 0 || speed_ <= 0)
+            return false;
+
+        // 从直线瞄准开始，第一步用真空中的斜率dy/dθ ≈ x/cos²θ
+        // start from aiming straight, the first step uses the vacuum slope dy/dθ ≈ x/cos²θ
+        float t;
+        float pitch0 = clip<float>(fast_atan2f(height, distance), MIN_PITCH, MAX_PITCH);
+        float error0 = Trajectory(pitch0, distance, &t) - height;
+        float sine, cosine;
+        fast_sincosf(pitch0, &sine, &cosine);
+        float pitch1 = clip<float>(pitch0 - error0 * cosine * cosine / distance, MIN_PITCH,
+                                   MAX_PITCH);
+        float error1 = 0;
+        for (int i = 0; i < ITERATIONS; ++i) {
+            error1 = Trajectory(pitch1, distance, &t) - height;
+            const float delta = pitch1 - pitch0;
+            float step = 0;
+            if (fabsf(delta) > 1e-6f) {
+                // 斜率不为正说明越过了最大射程，低弹道在它下方
+                // a non-positive slope is past the maximum range, the low arc is below it
+                const float slope = (error1 - error0) / delta;
+                step = slope > 1e-3f ? -error1 / slope : -MAX_STEP / 2;
+            }
+            pitch0 = pitch1;
+            error0 = error1;
+            pitch1 = clip<float>(pitch1 + clip<float>(step, -MAX_STEP, MAX_STEP), MIN_PITCH,
+                                 MAX_PITCH);
+        }
+        error1 = Trajectory(pitch1, distance, &t) - height;
+
+        *pitch = pitch1;
+        if (time != nullptr)
+            *time = t;
+        // 允许1cm加1%距离的误差 / tolerate 1cm plus 1% of the distance
+        return fabsf(error1) < 0.01f + 0.01f * distance;
+    }
+
+    float Ballistics::GetMuzzleSpeed() const {
+        return speed_;
+    }
+
+}  // namespace control
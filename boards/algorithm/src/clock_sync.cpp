@@ -0,0 +1,171 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#include "clock_sync.h"
+
+#include "utils.h"
+
+namespace control {
+
+    // 同步前需要的交换次数 / exchanges needed before the clocks count as synchronized
+    static constexpr int MIN_SAMPLES = 4;
+    // 样本跨度小于该值时不估计漂移，沿用上一次的结果，单位为[s]
+    // the drift is kept from the last fit while the samples span less than this, in [s]
+    static constexpr float MIN_FIT_SPAN = 0.5f;
+
+    ClockSync::ClockSync(clock_sync_init_t init) : init_(init), sequence_(0) {
+        Reset();
+    }
+
+    void ClockSync::Update(uint64_t request, uint64_t remote_receive, uint64_t remote_transmit,
+                           uint64_t response) {
+        if (response < request || remote_transmit < remote_receive)
+            return;
+        const int64_t delay = (int64_t)(response - request) -
+                              (int64_t)(remote_transmit - remote_receive);
+        if (delay < 0)
+            return;
+        // 每个窗口格保留SLOT_EXCHANGES次交换中延迟最小的样本
+        // every slot of the window keeps the sample with the smallest delay of SLOT_EXCHANGES
+        // exchanges
+        if (exchanges_ % SLOT_EXCHANGES == 0) {
+            if (exchanges_ > 0)
+                head_ = (head_ + 1) % WINDOW;
+            delay_[head_] = INT64_MAX;
+            count_ = min<int>(count_ + 1, WINDOW);
+        }
+        ++exchanges_;
+        if (delay < delay_[head_]) {
+            time_[head_] = request + (response - request) / 2;
+            offset_[head_] = ((int64_t)(remote_receive - request) +
+                              (int64_t)(remote_transmit - response)) / 2;
+            delay_[head_] = delay;
+        }
+
+        // 只用延迟接近最小值的样本，参考点取其中最新的一个
+        // only samples with a delay close to the minimum are used, the newest of them is the
+        // reference
+        int64_t min_delay = INT64_MAX;
+        for (int i = 0; i < count_; ++i)
+            min_delay = min<int64_t>(min_delay, delay_[i]);
+        const int64_t max_delay = min_delay + init_.delay_tolerance;
+        bool accepted[WINDOW];
+        int newest = -1;
+        for (int k = 0; k < count_; ++k) {
+            const int i = (head_ - k + WINDOW) % WINDOW;
+            accepted[i] = delay_[i] <= max_delay;
+            if (accepted[i] && newest < 0)
+                newest = i;
+        }
+        reference_time_ = time_[newest];
+        reference_offset_ = offset_[newest];
+
+        int n = 0;
+        float mean_x = 0, mean_y = 0, min_x = 0;
+        for (int i = 0; i < count_; ++i) {
+            if (!accepted[i])
+                continue;
+            const float x = (float)(int64_t)(time_[i] - reference_time_) * 1e-6f;
+            mean_x += x;
+            mean_y += (float)(offset_[i] - reference_offset_);
+            min_x = min<float>(min_x, x);
+            ++n;
+        }
+        mean_x /= n;
+        mean_y /= n;
+        if (-min_x >= MIN_FIT_SPAN) {
+            float sxx = 0, sxy = 0;
+            for (int i = 0; i < count_; ++i) {
+                if (!accepted[i])
+                    continue;
+                const float x = (float)(int64_t)(time_[i] - reference_time_) * 1e-6f - mean_x;
+                const float y = (float)(offset_[i] - reference_offset_) - mean_y;
+                sxx += x * x;
+                sxy += x * y;
+            }
+            drift_ = clip<float>(sxy / sxx, -init_.max_drift, init_.max_drift);
+        }
+        intercept_ = mean_y - drift_ * mean_x;
+        Publish();
+    }
+
+    uint64_t ClockSync::ToRemote(uint64_t local) const {
+        const estimate_t estimate = Load();
+        return local + estimate.reference_offset + (int64_t)Offset(estimate, local);
+    }
+
+    uint64_t ClockSync::ToLocal(uint64_t remote) const {
+        // 偏移随本地时间变化，用远端时间近似本地时间求一次即可，漂移带来的误差远小于1us
+        // the offset depends on the local time, one step from the remote time is enough, the
+        // error from the drift is far below 1us
+        const estimate_t estimate = Load();
+        const uint64_t local = remote - estimate.reference_offset - (int64_t)estimate.intercept;
+        return remote - estimate.reference_offset - (int64_t)Offset(estimate, local);
+    }
+
+    bool ClockSync::IsSynchronized() const {
+        return Load().synchronized;
+    }
+
+    float ClockSync::GetDrift() const {
+        return Load().drift;
+    }
+
+    void ClockSync::Reset() {
+        exchanges_ = 0;
+        count_ = 0;
+        head_ = 0;
+        reference_time_ = 0;
+        reference_offset_ = 0;
+        intercept_ = 0;
+        drift_ = 0;
+        Publish();
+    }
+
+    void ClockSync::Publish() {
+        const uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+        estimate_t& estimate = estimate_[(sequence + 1) & 1];
+        estimate.reference_time = reference_time_;
+        estimate.reference_offset = reference_offset_;
+        estimate.intercept = intercept_;
+        estimate.drift = drift_;
+        estimate.synchronized = exchanges_ >= MIN_SAMPLES;
+        sequence_.store(sequence + 1, std::memory_order_release);
+    }
+
+    ClockSync::estimate_t ClockSync::Load() const {
+        // 拷贝期间没有新的发布就说明拷贝完整；读者打断写者时写者只在改另一份，不会一直重试
+        // the copy is whole if nothing was published meanwhile; a reader preempting the writer
+        // finds it busy with the other copy and does not spin
+        while (true) {
+            const uint32_t sequence = sequence_.load(std::memory_order_acquire);
+            const estimate_t estimate = estimate_[sequence & 1];
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence_.load(std::memory_order_relaxed) == sequence)
+                return estimate;
+        }
+    }
+
+    float ClockSync::Offset(const estimate_t& estimate, uint64_t local) {
+        return estimate.intercept +
+               estimate.drift * (float)(int64_t)(local - estimate.reference_time) * 1e-6f;
+    }
+
+}  // namespace control
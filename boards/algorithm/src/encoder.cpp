@@ -0,0 +1,132 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+
+#include "encoder.h"
+
+#include <math.h>
+
+#include "utils.h"
+
+namespace control {
+
+    // 分子的上限，保证一圈的长度和每帧的增量都不会溢出int32
+    // upper bound of the numerator, so neither a turn nor the increment of a frame overflows int32
+    static constexpr int64_t MAX_PERIOD = INT32_MAX / 4;
+
+    MultiTurnEncoder::MultiTurnEncoder(int32_t resolution) : resolution_(resolution) {
+        period_ = resolution_;
+        angle_scale_ = 2 * FAST_PI / period_;
+    }
+
+    void MultiTurnEncoder::SetRatio(float ratio) {
+        // 连分数的渐近分数是分母不超过某个值时的最佳近似，19、36或者3591/187都能精确表示
+        // the convergents of the continued fraction are the best approximations for a bounded
+        // denominator, 19, 36 or 3591/187 come out exactly
+        int64_t p0 = 0, q0 = 1, p1 = 1, q1 = 0;
+        double x = ratio > 0 ? ratio : 1;
+        for (int i = 0; i < 32; ++i) {
+            const double a = floor(x);
+            const int64_t p2 = (int64_t)a * p1 + p0;
+            const int64_t q2 = (int64_t)a * q1 + q0;
+            if (q2 > MAX_DENOMINATOR || p2 * resolution_ > MAX_PERIOD)
+                break;
+            p0 = p1, q0 = q1, p1 = p2, q1 = q2;
+            if (x - a < 1e-6)
+                break;
+            x = 1 / (x - a);
+        }
+        // 超出可表示范围的减速比取最接近的边界
+        // ratios out of the representable range take the nearest bound
+        if (q1 == 0) {
+            p1 = MAX_PERIOD / resolution_;
+            q1 = 1;
+        } else if (p1 == 0) {
+            p1 = 1;
+            q1 = MAX_DENOMINATOR;
+        }
+        numerator_ = p1;
+        denominator_ = q1;
+        period_ = resolution_ * numerator_;
+        angle_scale_ = 2 * FAST_PI / period_;
+        Rebase();
+    }
+
+    void MultiTurnEncoder::Reset(int32_t raw, int32_t origin) {
+        int32_t start = (raw - origin) % resolution_;
+        if (start < 0)
+            start += resolution_;
+        last_raw_ = raw;
+        ticks_ = start;
+        Rebase();
+    }
+
+    void MultiTurnEncoder::Update(int32_t raw) {
+        int32_t delta = raw - last_raw_;
+        last_raw_ = raw;
+        // 两帧之间转子转过不到半圈，差值回绕到[-resolution / 2, resolution / 2)
+        if (delta >= resolution_ / 2)
+            delta -= resolution_;
+        else if (delta < -resolution_ / 2)
+            delta += resolution_;
+        ticks_ += delta;
+        // 每帧的增量远小于一圈（减速比小于1时除外），循环通常最多执行一次，不需要64位除法
+        phase_ += delta * denominator_;
+        while (phase_ >= period_) {
+            phase_ -= period_;
+            ++turns_;
+        }
+        while (phase_ < 0) {
+            phase_ += period_;
+            --turns_;
+        }
+    }
+
+    int64_t MultiTurnEncoder::GetTicks() const {
+        return ticks_;
+    }
+
+    int32_t MultiTurnEncoder::GetTurns() const {
+        return turns_;
+    }
+
+    float MultiTurnEncoder::GetAngle() const {
+        return phase_ * angle_scale_;
+    }
+
+    float MultiTurnEncoder::GetTheta() const {
+        return turns_ * (2 * FAST_PI) + phase_ * angle_scale_;
+    }
+
+    void MultiTurnEncoder::GetRatio(int32_t* numerator, int32_t* denominator) const {
+        *numerator = numerator_;
+        *denominator = denominator_;
+    }
+
+    void MultiTurnEncoder::Rebase() {
+        const int64_t scaled = ticks_ * denominator_;
+        int64_t turns = scaled / period_;
+        if (turns * period_ > scaled)
+            --turns;
+        turns_ = (int32_t)turns;
+        phase_ = (int32_t)(scaled - turns * period_);
+    }
+
+}  // namespace control
@@ -0,0 +1,333 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#include "fixed_point.h"
+
+namespace control {
+
+    namespace {
+
+        constexpr int64_t Q16_HALF = 1LL << (fixed::GAIN_FRAC_BITS - 1);
+
+        // 整数转换为Q16.16
+        inline int64_t ToQ16(int32_t x) {
+            return (int64_t)x << fixed::GAIN_FRAC_BITS;
+        }
+
+        // Q16.16四舍五入为整数，并饱和到int32范围
+        inline int32_t RoundQ16(int64_t x) {
+            return fixed::SatQ31((x + Q16_HALF) >> fixed::GAIN_FRAC_BITS);
+        }
+
+        // 斜坡和缓动的步长会被累加很多次，使用Q32.32避免步长的舍入误差累积
+        constexpr int RAMP_FRAC_BITS = 32;
+
+        inline int64_t ToQ32(int32_t x) {
+            return (int64_t)x << RAMP_FRAC_BITS;
+        }
+
+        inline int64_t StepToQ32(float step) {
+            const float scaled = step * (float)(1LL << RAMP_FRAC_BITS);
+            return (int64_t)(scaled >= 0 ? scaled + 0.5f : scaled - 0.5f);
+        }
+
+        inline int32_t RoundQ32(int64_t x) {
+            return (int32_t)((x + (1LL << (RAMP_FRAC_BITS - 1))) >> RAMP_FRAC_BITS);
+        }
+
+        inline int64_t Abs64(int64_t x) {
+            return x < 0 ? -x : x;
+        }
+
+        // Q15系数的加权平均：x * c + last * (1 - c)
+        inline int64_t Blend(int64_t x, int64_t last, int32_t c) {
+            return (x * c + last * (fixed::Q15_ONE - c)) >> 15;
+        }
+
+    }  // namespace
+
+    FixedPID::FixedPID() {
+        Reinit(0, 0, 0, 0, 0);
+        Reset();
+        mode_ = ConstrainedPID::Integral_Limit;
+    }
+
+    FixedPID::FixedPID(float kp, float ki, float kd, int32_t max_iout, int32_t max_out) {
+        Reinit(kp, ki, kd, max_iout, max_out);
+        Reset();
+        mode_ = ConstrainedPID::Integral_Limit;
+    }
+
+    FixedPID::FixedPID(ConstrainedPID::PID_Init_t pid_init) {
+        Reinit(pid_init);
+        Reset();
+        ResetIntegral();
+    }
+
+    int32_t FixedPID::ComputeOutput(int32_t target, int32_t measure) {
+        measure_ = measure;
+        error_ = fixed::SatQ31((int64_t)target - measure);
+        const int64_t abs_error = Abs64(error_);
+
+        // 与pid_internal::Compute的步骤一一对应，浮点乘法替换为Q16.16的整数乘法
+        if (abs_error > dead_band_) {
+            pout_ = (int64_t)kp_ * error_;
+            int64_t iterm = (int64_t)ki_ * error_;
+            int64_t dout = (int64_t)kd_ * ((int64_t)error_ - last_error_);
+
+            // 梯形积分
+            if (mode_ & ConstrainedPID::Trapezoid_Intergral) {
+                iterm = (int64_t)ki_ * ((int64_t)error_ + last_error_) / 2;
+            }
+
+            const bool same_sign = (error_ > 0 && iout_ > 0) || (error_ < 0 && iout_ < 0);
+
+            // 变速积分，先计算Q15的积分速率，避免积分项直接乘以误差导致溢出
+            if (mode_ & ConstrainedPID::ChangingIntegralRate) {
+                if (same_sign && abs_error > scalar_b_) {
+                    const int64_t range = (int64_t)scalar_a_ + scalar_b_;
+                    if (abs_error <= range) {
+                        // (range - abs_error) < scalar_a_，乘积不超过2^62；与直接相除最多差1个LSB
+                        const int64_t rate = ((range - abs_error) * inv_scalar_a_) >> 47;
+                        iterm = (iterm * rate) >> 15;
+                    } else {
+                        iterm = 0;
+                    }
+                }
+            }
+
+            // 积分限幅
+            if (mode_ & ConstrainedPID::Integral_Limit) {
+                const int64_t temp_iout = iout_ + iterm;
+                const int64_t temp_output = pout_ + iout_ + dout;
+                if (Abs64(temp_output) > max_out_ && same_sign) {
+                    iterm = 0;
+                }
+                if (temp_iout > max_iout_) {
+                    iterm = 0;
+                    iout_ = max_iout_;
+                }
+                if (temp_iout < -max_iout_) {
+                    iterm = 0;
+                    iout_ = -max_iout_;
+                }
+            }
+
+            // 微分先行
+            if (mode_ & ConstrainedPID::Derivative_On_Measurement) {
+                dout = (int64_t)kd_ * ((int64_t)measure_ - last_measure_);
+            }
+
+            // 微分滤波
+            if (mode_ & ConstrainedPID::DerivativeFilter) {
+                dout = Blend(dout, last_dout_, derivative_filter_);
+            }
+
+            iout_ += iterm;
+            dout_ = dout;
+            output_ = pout_ + iout_ + dout_;
+
+            // 输出滤波
+            if (mode_ & ConstrainedPID::OutputFilter) {
+                output_ = Blend(output_, last_output_, output_filter_);
+            }
+
+            // 输出限幅和比例限幅
+            output_ = clip<int64_t>(output_, -max_out_, max_out_);
+            pout_ = clip<int64_t>(pout_, -max_out_, max_out_);
+        }
+
+        last_measure_ = measure_;
+        last_output_ = output_;
+        last_dout_ = dout_;
+        last_error_ = error_;
+        return RoundQ16(output_);
+    }
+
+    void FixedPID::Reinit(float kp, float ki, float kd, int32_t max_iout, int32_t max_out) {
+        kp_ = fixed::FloatToFixed(kp, fixed::GAIN_FRAC_BITS);
+        ki_ = fixed::FloatToFixed(ki, fixed::GAIN_FRAC_BITS);
+        kd_ = fixed::FloatToFixed(kd, fixed::GAIN_FRAC_BITS);
+        if (ki_ == 0) {
+            iout_ = 0;
+        }
+        ChangeMax(max_iout, max_out);
+    }
+
+    void FixedPID::Reinit(ConstrainedPID::PID_Init_t pid_init) {
+        kp_ = fixed::FloatToFixed(pid_init.kp, fixed::GAIN_FRAC_BITS);
+        ki_ = fixed::FloatToFixed(pid_init.ki, fixed::GAIN_FRAC_BITS);
+        kd_ = fixed::FloatToFixed(pid_init.kd, fixed::GAIN_FRAC_BITS);
+        ChangeMax(fixed::FloatToFixed(pid_init.max_iout, 0),
+                  fixed::FloatToFixed(pid_init.max_out, 0));
+        dead_band_ = fixed::FloatToFixed(pid_init.deadband, 0);
+        scalar_a_ = fixed::FloatToFixed(pid_init.A, 0);
+        scalar_b_ = fixed::FloatToFixed(pid_init.B, 0);
+        inv_scalar_a_ = scalar_a_ > 0 ? ((1LL << 62) + scalar_a_ / 2) / scalar_a_ : 0;
+        output_filter_ = fixed::FloatToFixed(pid_init.output_filtering_coefficient, 15);
+        derivative_filter_ = fixed::FloatToFixed(pid_init.derivative_filtering_coefficient, 15);
+        mode_ = pid_init.mode;
+        output_ = 0;
+    }
+
+    void FixedPID::Reset() {
+        pout_ = 0;
+        iout_ = 0;
+        dout_ = 0;
+        error_ = 0;
+        last_error_ = 0;
+    }
+
+    void FixedPID::ResetIntegral() {
+        iout_ = 0;
+    }
+
+    void FixedPID::ChangeMax(int32_t max_iout, int32_t max_out) {
+        max_iout_ = ToQ16(max_iout);
+        max_out_ = ToQ16(max_out);
+    }
+
+    ConstrainedPID::PID_State_t FixedPID::State() const {
+        constexpr float scale = 1.0f / (1 << fixed::GAIN_FRAC_BITS);
+        return {
+            .error = (float)error_,
+            .pout = (float)pout_ * scale,
+            .iout = (float)iout_ * scale,
+            .dout = (float)dout_ * scale,
+            .output = (float)output_ * scale,
+        };
+    }
+
+    PIDControllerQ15::PIDControllerQ15(q15_t kp, q15_t ki, q15_t kd) {
+        pid_q15_.Kp = kp;
+        pid_q15_.Ki = ki;
+        pid_q15_.Kd = kd;
+        arm_pid_init_q15(&pid_q15_, 1);
+    }
+
+    q15_t PIDControllerQ15::ComputeOutput(q15_t error) {
+        return arm_pid_q15(&pid_q15_, error);
+    }
+
+    void PIDControllerQ15::Reinit(q15_t kp, q15_t ki, q15_t kd) {
+        pid_q15_.Kp = kp;
+        pid_q15_.Ki = ki;
+        pid_q15_.Kd = kd;
+        arm_pid_init_q15(&pid_q15_, 0);
+    }
+
+    void PIDControllerQ15::Reset() {
+        arm_pid_init_q15(&pid_q15_, 1);
+    }
+
+    PIDControllerQ31::PIDControllerQ31(q31_t kp, q31_t ki, q31_t kd) {
+        pid_q31_.Kp = kp;
+        pid_q31_.Ki = ki;
+        pid_q31_.Kd = kd;
+        arm_pid_init_q31(&pid_q31_, 1);
+    }
+
+    q31_t PIDControllerQ31::ComputeOutput(q31_t error) {
+        return arm_pid_q31(&pid_q31_, error);
+    }
+
+    void PIDControllerQ31::Reinit(q31_t kp, q31_t ki, q31_t kd) {
+        pid_q31_.Kp = kp;
+        pid_q31_.Ki = ki;
+        pid_q31_.Kd = kd;
+        arm_pid_init_q31(&pid_q31_, 0);
+    }
+
+    void PIDControllerQ31::Reset() {
+        arm_pid_init_q31(&pid_q31_, 1);
+    }
+
+    FixedRampSource::FixedRampSource(int32_t initial, int32_t min, int32_t max, float step) {
+        output_ = ToQ32(initial);
+        min_ = ToQ32(min);
+        max_ = ToQ32(max);
+        step_ = StepToQ32(step);
+    }
+
+    int32_t FixedRampSource::Calc(int32_t input) {
+        const int64_t delta = (int64_t)step_ * input;
+        const int64_t sub_output = output_ - delta;
+        const int64_t add_output = output_ + delta;
+        if ((output_ > max_ && sub_output < output_) || (output_ < min_ && add_output > output_)) {
+            output_ = sub_output;
+        } else {
+            output_ = clip<int64_t>(add_output, min_, max_);
+        }
+        return RoundQ32(output_);
+    }
+
+    int32_t FixedRampSource::Get() const {
+        return RoundQ32(output_);
+    }
+
+    void FixedRampSource::SetMax(int32_t max) {
+        max_ = ToQ32(max);
+    }
+
+    void FixedRampSource::SetMin(int32_t min) {
+        min_ = ToQ32(min);
+    }
+
+    void FixedRampSource::SetCurrent(int32_t current) {
+        output_ = ToQ32(current);
+    }
+
+    FixedEase::FixedEase(int32_t initial, float step) {
+        current_ = ToQ32(initial);
+        target_ = current_;
+        step_ = StepToQ32(step);
+    }
+
+    void FixedEase::SetTarget(int32_t target) {
+        target_ = ToQ32(target);
+    }
+
+    int32_t FixedEase::Calc() {
+        if (current_ < target_) {
+            current_ = min(current_ + step_, target_);
+        } else if (current_ > target_) {
+            current_ = max(current_ - step_, target_);
+        }
+        return RoundQ32(current_);
+    }
+
+    int32_t FixedEase::Calc(int32_t target) {
+        SetTarget(target);
+        return Calc();
+    }
+
+    int32_t FixedEase::GetOutput() const {
+        return RoundQ32(current_);
+    }
+
+    int32_t FixedEase::GetTarget() const {
+        return RoundQ32(target_);
+    }
+
+    bool FixedEase::IsAtTarget() const {
+        return current_ == target_;
+    }
+
+}  // namespace control
@@ -0,0 +1,138 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#include "gyro_bias.h"
+
+#include <math.h>
+
+#include "utils.h"
+
+namespace control {
+
+    GyroBiasEstimator::GyroBiasEstimator(gyro_bias_init_t init) : param_(init) {
+    }
+
+    void GyroBiasEstimator::SetPrior(const float bias[3], float confidence) {
+        for (int i = 0; i < 3; ++i)
+            bias_[i] = bias[i];
+        weight_ = clip<float>(confidence, 0, 1) * param_.ready_time;
+        ClearChunks();
+    }
+
+    void GyroBiasEstimator::Reset() {
+        weight_ = 0;
+        still_time_ = 0;
+        ClearChunks();
+    }
+
+    void GyroBiasEstimator::Update(const float gyro[3], const float accel[3], float dt) {
+        const float accel_norm =
+            sqrtf(accel[0] * accel[0] + accel[1] * accel[1] + accel[2] * accel[2]);
+        if (!initialized_) {
+            // 方差从阈值开始，至少经过一个window才可能判定为静止
+            for (int i = 0; i < 3; ++i) {
+                gyro_mean_[i] = gyro[i];
+                gyro_var_[i] = param_.gyro_noise * param_.gyro_noise;
+            }
+            accel_mean_ = accel_norm;
+            accel_var_ = param_.accel_noise * param_.accel_noise;
+            initialized_ = true;
+        }
+
+        // 指数加权的均值和方差
+        const float alpha = dt / (param_.window + dt);
+        // 平均角速度与零漂的允许偏差随置信度从max_bias收紧到gyro_noise，以排除缓慢的匀速转动
+        const float confidence = GetConfidence();
+        const float max_deviation =
+            param_.max_bias + (param_.gyro_noise - param_.max_bias) * confidence;
+        float gyro_var = 0;
+        bool in_range = true;
+        for (int i = 0; i < 3; ++i) {
+            const float delta = gyro[i] - gyro_mean_[i];
+            gyro_mean_[i] += alpha * delta;
+            gyro_var_[i] = (1 - alpha) * (gyro_var_[i] + alpha * delta * delta);
+            gyro_var += gyro_var_[i];
+            in_range = in_range && fabsf(gyro_mean_[i] - bias_[i]) < max_deviation;
+        }
+        const float delta = accel_norm - accel_mean_;
+        accel_mean_ += alpha * delta;
+        accel_var_ = (1 - alpha) * (accel_var_ + alpha * delta * delta);
+
+        const bool stationary = in_range && gyro_var < param_.gyro_noise * param_.gyro_noise &&
+                                accel_var_ < param_.accel_noise * param_.accel_noise;
+        if (!stationary) {
+            still_time_ = 0;
+            weight_ -= weight_ * dt / param_.forget_time;
+            ClearChunks();
+            return;
+        }
+        still_time_ += dt;
+
+        // 统计量比角速度滞后，开始转动后要过一段时间才判定为运动。静止的样本按window分段累加，
+        // 下一段也保持静止才用这一段更新零漂，否则判定为运动之前的样本会把零漂拉向转速，
+        // 零漂跟着平均角速度走，缓慢的转动就永远不会被判定为运动
+        // the statistics lag the rate, so motion is only detected a while after it starts. Still
+        // samples are summed in chunks of one window and a chunk only updates the bias once the
+        // next one stays still as well. Otherwise the samples before the detection pull the bias
+        // toward the rate, the bias follows the average rate and a slow rotation is never detected
+        for (int i = 0; i < 3; ++i)
+            chunk_sum_[1][i] += gyro[i] * dt;
+        chunk_time_[1] += dt;
+        if (chunk_time_[1] < param_.window)
+            return;
+        if (chunk_time_[0] > 0)
+            Commit(chunk_sum_[0], chunk_time_[0]);
+        for (int i = 0; i < 3; ++i) {
+            chunk_sum_[0][i] = chunk_sum_[1][i];
+            chunk_sum_[1][i] = 0;
+        }
+        chunk_time_[0] = chunk_time_[1];
+        chunk_time_[1] = 0;
+    }
+
+    void GyroBiasEstimator::Commit(const float sum[3], float duration) {
+        // 先按静止时间加权平均，累计够time_constant后变为固定时间常数的低通
+        const float gain =
+            fmaxf(duration / (weight_ + duration), duration / param_.time_constant);
+        for (int i = 0; i < 3; ++i)
+            bias_[i] += gain * (sum[i] / duration - bias_[i]);
+        weight_ = fminf(weight_ + duration, fmaxf(param_.time_constant, param_.ready_time));
+    }
+
+    void GyroBiasEstimator::ClearChunks() {
+        for (int i = 0; i < 3; ++i)
+            chunk_sum_[0][i] = chunk_sum_[1][i] = 0;
+        chunk_time_[0] = chunk_time_[1] = 0;
+    }
+
+    void GyroBiasEstimator::GetBias(float bias[3]) const {
+        for (int i = 0; i < 3; ++i)
+            bias[i] = bias_[i];
+    }
+
+    float GyroBiasEstimator::GetConfidence() const {
+        return fminf(weight_ / param_.ready_time, 1);
+    }
+
+    bool GyroBiasEstimator::IsStationary() const {
+        return still_time_ >= param_.window;
+    }
+
+}  // namespace control
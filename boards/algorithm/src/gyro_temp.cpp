@@ -0,0 +1,121 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#include "gyro_temp.h"
+
+#include <math.h>
+
+#include "utils.h"
+
+namespace control {
+
+    GyroTempModel::GyroTempModel(float reference, float block_time, float min_span)
+        : reference_(reference), block_time_(block_time), min_span_(min_span) {
+    }
+
+    void GyroTempModel::SetModel(const gyro_temp_model_t& model) {
+        model_ = model;
+        valid_ = true;
+    }
+
+    bool GyroTempModel::IsValid() const {
+        return valid_;
+    }
+
+    void GyroTempModel::Evaluate(float temp, float bias[3]) const {
+        if (!valid_) {
+            bias[0] = bias[1] = bias[2] = 0;
+            return;
+        }
+        // 多项式外推不可靠，超出拟合范围时按端点计算
+        const float t = clip<float>(temp, model_.min_temp, model_.max_temp) - model_.reference;
+        for (int i = 0; i < 3; ++i)
+            bias[i] = model_.coeff[i][0] + (model_.coeff[i][1] + model_.coeff[i][2] * t) * t;
+    }
+
+    void GyroTempModel::AddSample(float temp, const float gyro[3], float dt) {
+        block_elapsed_ += dt;
+        block_temp_ += temp * dt;
+        for (int i = 0; i < 3; ++i)
+            block_gyro_[i] += gyro[i] * dt;
+        if (block_elapsed_ < block_time_)
+            return;
+
+        const float mean_temp = block_temp_ / block_elapsed_;
+        const float x = (mean_temp - reference_) * 0.1f;
+        if (sum_x_[0] == 0) {
+            min_temp_ = max_temp_ = mean_temp;
+        } else {
+            min_temp_ = fminf(min_temp_, mean_temp);
+            max_temp_ = fmaxf(max_temp_, mean_temp);
+        }
+        float power = 1;
+        for (int k = 0; k < 5; ++k) {
+            sum_x_[k] += power;
+            if (k < 3)
+                for (int i = 0; i < 3; ++i)
+                    sum_xy_[i][k] += power * block_gyro_[i] / block_elapsed_;
+            power *= x;
+        }
+        block_elapsed_ = 0;
+        block_temp_ = 0;
+        block_gyro_[0] = block_gyro_[1] = block_gyro_[2] = 0;
+    }
+
+    void GyroTempModel::ClearSamples() {
+        block_elapsed_ = 0;
+        block_temp_ = 0;
+        for (int i = 0; i < 3; ++i) {
+            block_gyro_[i] = 0;
+            sum_xy_[i][0] = sum_xy_[i][1] = sum_xy_[i][2] = 0;
+        }
+        for (int k = 0; k < 5; ++k)
+            sum_x_[k] = 0;
+    }
+
+    bool GyroTempModel::Fit(gyro_temp_model_t* model) const {
+        if (sum_x_[0] < 3 || max_temp_ - min_temp_ < min_span_)
+            return false;
+        // 正规方程 A*c = b，A对称，用伴随矩阵求逆
+        const float* s = sum_x_;
+        const float a00 = s[2] * s[4] - s[3] * s[3];
+        const float a01 = s[2] * s[3] - s[1] * s[4];
+        const float a02 = s[1] * s[3] - s[2] * s[2];
+        const float a11 = s[0] * s[4] - s[2] * s[2];
+        const float a12 = s[1] * s[2] - s[0] * s[3];
+        const float a22 = s[0] * s[2] - s[1] * s[1];
+        const float det = s[0] * a00 + s[1] * a01 + s[2] * a02;
+        if (!(fabsf(det) > 1e-6f * s[0] * s[2] * s[4]))
+            return false;
+
+        model->reference = reference_;
+        model->min_temp = min_temp_;
+        model->max_temp = max_temp_;
+        for (int i = 0; i < 3; ++i) {
+            const float* b = sum_xy_[i];
+            // 系数对应缩小10倍的温差，换算回[°C]
+            model->coeff[i][0] = (a00 * b[0] + a01 * b[1] + a02 * b[2]) / det;
+            model->coeff[i][1] = (a01 * b[0] + a11 * b[1] + a12 * b[2]) / det * 0.1f;
+            model->coeff[i][2] = (a02 * b[0] + a12 * b[1] + a22 * b[2]) / det * 0.01f;
+        }
+        return true;
+    }
+
+}  // namespace control
@@ -0,0 +1,229 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#include "kinematics.h"
+
+#include <math.h>
+
+#include "utils.h"
+
+namespace control {
+
+    // 几何系数中小于该值的部分视为0，消除cos(π/2)之类的舍入误差
+    // geometry terms below this are zeroed, removes round off such as cos(π/2)
+    static constexpr float GEOMETRY_EPSILON = 1e-6f;
+    // 正运动学正规方程的正则化，相对于矩阵的迹 / regularization of the forward normal equations,
+    // relative to the trace of the matrix
+    static constexpr double FORWARD_REGULARIZATION = 1e-9;
+    // 舵轮速度低于最大轮速的该比例时保持角度不变，避免停车时转向电机乱转
+    // swerve modules slower than this fraction of the maximum speed keep their angle, so the
+    // steering motors do not wander when the chassis stops
+    static constexpr float MODULE_HOLD_RATIO = 1e-3f;
+
+    static float snap(float value) {
+        return fabsf(value) < GEOMETRY_EPSILON ? 0 : value;
+    }
+
+    Kinematics::Kinematics(const wheel_geometry_t* wheels, int wheel_num, float max_speed)
+        : wheel_num_(clip<int>(wheel_num, 0, MAX_WHEEL_NUM)), max_speed_(max_speed) {
+
+        // 轮子接地点的速度为 (vx - wz·y, vy + wz·x)
+        // the contact point of a wheel moves at (vx - wz·y, vy + wz·x)
+        for (int i = 0; i < wheel_num_; ++i) {
+            const wheel_geometry_t& wheel = wheels[i];
+            const float x = wheel.x;
+            const float y = wheel.y;
+            type_[i] = wheel.type;
+            angle_[i] = 0;
+            if (wheel.type == WHEEL_SWERVE) {
+                // 在转向零位坐标系下分解：沿驱动方向和垂直于驱动方向
+                // decomposed in the frame of the steering zero: along and across the heading
+                const float c = snap(cosf(wheel.heading)) / wheel.radius;
+                const float s = snap(sinf(wheel.heading)) / wheel.radius;
+                inverse_[i][0][0] = c;
+                inverse_[i][0][1] = s;
+                inverse_[i][0][2] = x * s - y * c;
+                inverse_[i][1][0] = -s;
+                inverse_[i][1][1] = c;
+                inverse_[i][1][2] = x * c + y * s;
+            } else {
+                // 只有沿辊子轴线的速度分量由轮子提供，辊子角为0时即为驱动方向
+                // only the velocity along the roller axis is driven by the wheel, which is the
+                // heading itself for a roller angle of 0
+                const float roller = wheel.type == WHEEL_MECANUM ? wheel.roller : 0;
+                const float k = 1.0f / (wheel.radius * cosf(roller));
+                const float c = snap(cosf(wheel.heading + roller)) * k;
+                const float s = snap(sinf(wheel.heading + roller)) * k;
+                inverse_[i][0][0] = c;
+                inverse_[i][0][1] = s;
+                inverse_[i][0][2] = x * s - y * c;
+                inverse_[i][1][0] = 0;
+                inverse_[i][1][1] = 0;
+                inverse_[i][1][2] = 0;
+            }
+        }
+
+        // 伪逆 (HᵀH + εI)⁻¹Hᵀ，只在构造时计算一次，用double避免病态几何损失精度
+        // pseudo inverse (HᵀH + εI)⁻¹Hᵀ, computed once here in double so that ill conditioned
+        // geometries do not lose precision
+        double A[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+        for (int i = 0; i < wheel_num_; ++i)
+            for (int r = 0; r < 2; ++r)
+                for (int j = 0; j < 3; ++j)
+                    for (int k = 0; k < 3; ++k)
+                        A[j][k] += (double)inverse_[i][r][j] * inverse_[i][r][k];
+        const double eps = FORWARD_REGULARIZATION * (A[0][0] + A[1][1] + A[2][2]);
+        for (int j = 0; j < 3; ++j)
+            A[j][j] += eps;
+
+        double B[3][3];
+        B[0][0] = A[1][1] * A[2][2] - A[1][2] * A[2][1];
+        B[0][1] = A[0][2] * A[2][1] - A[0][1] * A[2][2];
+        B[0][2] = A[0][1] * A[1][2] - A[0][2] * A[1][1];
+        B[1][0] = A[1][2] * A[2][0] - A[1][0] * A[2][2];
+        B[1][1] = A[0][0] * A[2][2] - A[0][2] * A[2][0];
+        B[1][2] = A[0][2] * A[1][0] - A[0][0] * A[1][2];
+        B[2][0] = A[1][0] * A[2][1] - A[1][1] * A[2][0];
+        B[2][1] = A[0][1] * A[2][0] - A[0][0] * A[2][1];
+        B[2][2] = A[0][0] * A[1][1] - A[0][1] * A[1][0];
+        // 所有轮子都在同一点上之类的退化几何无法估计，正运动学输出0
+        // degenerated geometries such as all wheels at one point give 0 from the forward
+        // kinematics
+        double det = A[0][0] * B[0][0] + A[0][1] * B[1][0] + A[0][2] * B[2][0];
+        if (det <= 0 || !isfinite(det))
+            det = INFINITY;
+
+        for (int k = 0; k < 3; ++k)
+            for (int i = 0; i < wheel_num_; ++i)
+                for (int r = 0; r < 2; ++r) {
+                    double sum = 0;
+                    for (int j = 0; j < 3; ++j)
+                        sum += B[k][j] * inverse_[i][r][j];
+                    forward_[k][i][r] = sum / det;
+                }
+    }
+
+    float Kinematics::Inverse(float vx, float vy, float wz, float* speed, float* angle) {
+        // 沿驱动方向和垂直于驱动方向的分量，普通轮只有前者
+        // components along and across the heading, only the former for fixed wheels
+        float along[MAX_WHEEL_NUM];
+        float across[MAX_WHEEL_NUM];
+        float peak = 0;
+        for (int i = 0; i < wheel_num_; ++i) {
+            const float(*k)[3] = inverse_[i];
+            along[i] = k[0][0] * vx + k[0][1] * vy + k[0][2] * wz;
+            float magnitude;
+            if (type_[i] == WHEEL_SWERVE) {
+                across[i] = k[1][0] * vx + k[1][1] * vy + k[1][2] * wz;
+                magnitude = sqrtf(along[i] * along[i] + across[i] * across[i]);
+            } else {
+                magnitude = fabsf(along[i]);
+            }
+            peak = fmaxf(peak, magnitude);
+        }
+
+        // 轮速对底盘速度是线性的，统一缩放保持运动方向 / wheel speeds are linear in the chassis
+        // velocity, a uniform scale keeps the direction of motion
+        const float scale = peak > max_speed_ ? max_speed_ / peak : 1.0f;
+        const float hold = MODULE_HOLD_RATIO * max_speed_;
+
+        for (int i = 0; i < wheel_num_; ++i) {
+            if (type_[i] != WHEEL_SWERVE) {
+                speed[i] = scale * along[i];
+                if (angle != nullptr)
+                    angle[i] = 0;
+                continue;
+            }
+
+            const float u = scale * along[i];
+            const float w = scale * across[i];
+            if (u * u + w * w < hold * hold) {
+                // 速度过低时角度没有意义，保持角度并输出速度在该方向上的投影
+                // the angle is meaningless at such low speeds, keep it and output the projection
+                float sine, cosine;
+                fast_sincosf(angle_[i], &sine, &cosine);
+                speed[i] = u * cosine + w * sine;
+            } else {
+                float target = fast_atan2f(w, u);
+                float magnitude = sqrtf(u * u + w * w);
+                // 转向超过90°时反转轮子，转到补角 / reverse the wheel and steer to the
+                // supplementary angle instead of steering more than 90°
+                if (fabsf(wrapc<float>(target - angle_[i], -FAST_PI, FAST_PI)) > FAST_PI_2) {
+                    target = wrapc<float>(target + FAST_PI, -FAST_PI, FAST_PI);
+                    magnitude = -magnitude;
+                }
+                angle_[i] = target;
+                speed[i] = magnitude;
+            }
+            if (angle != nullptr)
+                angle[i] = angle_[i];
+        }
+        return scale;
+    }
+
+    void Kinematics::Forward(const float* speed, const float* angle, float* vx, float* vy,
+                             float* wz) const {
+        float v[3] = {0, 0, 0};
+        for (int i = 0; i < wheel_num_; ++i) {
+            float along = speed[i];
+            float across = 0;
+            if (type_[i] == WHEEL_SWERVE) {
+                float sine, cosine;
+                fast_sincosf(angle != nullptr ? angle[i] : angle_[i], &sine, &cosine);
+                along = speed[i] * cosine;
+                across = speed[i] * sine;
+            }
+            for (int k = 0; k < 3; ++k)
+                v[k] += forward_[k][i][0] * along + forward_[k][i][1] * across;
+        }
+        *vx = v[0];
+        *vy = v[1];
+        *wz = v[2];
+    }
+
+    float Kinematics::Project(int wheel, float vx, float vy, float wz) const {
+        const float(*k)[3] = inverse_[wheel];
+        const float along = k[0][0] * vx + k[0][1] * vy + k[0][2] * wz;
+        if (type_[wheel] != WHEEL_SWERVE)
+            return along;
+        const float across = k[1][0] * vx + k[1][1] * vy + k[1][2] * wz;
+        float sine, cosine;
+        fast_sincosf(angle_[wheel], &sine, &cosine);
+        return along * cosine + across * sine;
+    }
+
+    void Kinematics::SetMaxSpeed(float max_speed) {
+        max_speed_ = max_speed;
+    }
+
+    void Kinematics::SetModuleAngle(int wheel, float angle) {
+        if (wheel >= 0 && wheel < wheel_num_)
+            angle_[wheel] = wrapc<float>(angle, -FAST_PI, FAST_PI);
+    }
+
+    int Kinematics::GetWheelNum() const {
+        return wheel_num_;
+    }
+
+    bool Kinematics::IsSwerve(int wheel) const {
+        return type_[wheel] == WHEEL_SWERVE;
+    }
+
+}  // namespace control
@@ -0,0 +1,186 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#include "mahony.h"
+
+#include <math.h>
+
+namespace control {
+
+    Mahony::Mahony(mahony_init_t init) {
+        SetGain(init);
+    }
+
+    void Mahony::SetGain(mahony_init_t init) {
+        param_ = init;
+    }
+
+    void Mahony::Reset() {
+        q_[0] = 1;
+        q_[1] = q_[2] = q_[3] = 0;
+        integral_[0] = integral_[1] = integral_[2] = 0;
+        elapsed_ = 0;
+    }
+
+    void Mahony::Reset(float ax, float ay, float az) {
+        Reset();
+        const float norm = sqrtf(ax * ax + ay * ay + az * az);
+        if (norm == 0)
+            return;
+        // 从重力方向求出roll和pitch，yaw为0
+        const float roll = atan2f(ay, az);
+        const float pitch = asinf(-ax / norm);
+        const float cr = cosf(roll * 0.5f), sr = sinf(roll * 0.5f);
+        const float cp = cosf(pitch * 0.5f), sp = sinf(pitch * 0.5f);
+        q_[0] = cr * cp;
+        q_[1] = sr * cp;
+        q_[2] = cr * sp;
+        q_[3] = -sr * sp;
+    }
+
+    void Mahony::Update(float gx, float gy, float gz, float ax, float ay, float az, float dt) {
+        if (ax == 0 && ay == 0 && az == 0) {
+            // 加速度计数据无效，只积分陀螺仪
+            Correct(gx, gy, gz, 0, 0, 0, dt);
+            return;
+        }
+        const float recip_norm = 1.0f / sqrtf(ax * ax + ay * ay + az * az);
+        ax *= recip_norm;
+        ay *= recip_norm;
+        az *= recip_norm;
+
+        // 估计的重力方向的一半
+        const float vx = q_[1] * q_[3] - q_[0] * q_[2];
+        const float vy = q_[0] * q_[1] + q_[2] * q_[3];
+        const float vz = q_[0] * q_[0] - 0.5f + q_[3] * q_[3];
+
+        // 误差为测量的重力方向与估计的重力方向的叉积
+        Correct(gx, gy, gz, ay * vz - az * vy, az * vx - ax * vz, ax * vy - ay * vx, dt);
+    }
+
+    void Mahony::Update(float gx, float gy, float gz, float ax, float ay, float az, float mx,
+                        float my, float mz, float dt) {
+        if ((mx == 0 && my == 0 && mz == 0) || (ax == 0 && ay == 0 && az == 0)) {
+            Update(gx, gy, gz, ax, ay, az, dt);
+            return;
+        }
+        float recip_norm = 1.0f / sqrtf(ax * ax + ay * ay + az * az);
+        ax *= recip_norm;
+        ay *= recip_norm;
+        az *= recip_norm;
+        recip_norm = 1.0f / sqrtf(mx * mx + my * my + mz * mz);
+        mx *= recip_norm;
+        my *= recip_norm;
+        mz *= recip_norm;
+
+        const float q0q0 = q_[0] * q_[0];
+        const float q0q1 = q_[0] * q_[1];
+        const float q0q2 = q_[0] * q_[2];
+        const float q0q3 = q_[0] * q_[3];
+        const float q1q1 = q_[1] * q_[1];
+        const float q1q2 = q_[1] * q_[2];
+        const float q1q3 = q_[1] * q_[3];
+        const float q2q2 = q_[2] * q_[2];
+        const float q2q3 = q_[2] * q_[3];
+        const float q3q3 = q_[3] * q_[3];
+
+        // 地磁场在世界坐标系下的参考方向
+        const float hx =
+            2.0f * (mx * (0.5f - q2q2 - q3q3) + my * (q1q2 - q0q3) + mz * (q1q3 + q0q2));
+        const float hy =
+            2.0f * (mx * (q1q2 + q0q3) + my * (0.5f - q1q1 - q3q3) + mz * (q2q3 - q0q1));
+        const float bx = sqrtf(hx * hx + hy * hy);
+        const float bz =
+            2.0f * (mx * (q1q3 - q0q2) + my * (q2q3 + q0q1) + mz * (0.5f - q1q1 - q2q2));
+
+        // 估计的重力和地磁场方向的一半
+        const float vx = q1q3 - q0q2;
+        const float vy = q0q1 + q2q3;
+        const float vz = q0q0 - 0.5f + q3q3;
+        const float wx = bx * (0.5f - q2q2 - q3q3) + bz * (q1q3 - q0q2);
+        const float wy = bx * (q1q2 - q0q3) + bz * (q0q1 + q2q3);
+        const float wz = bx * (q0q2 + q1q3) + bz * (0.5f - q1q1 - q2q2);
+
+        const float ex = (ay * vz - az * vy) + (my * wz - mz * wy);
+        const float ey = (az * vx - ax * vz) + (mz * wx - mx * wz);
+        const float ez = (ax * vy - ay * vx) + (mx * wy - my * wx);
+        Correct(gx, gy, gz, ex, ey, ez, dt);
+    }
+
+    void Mahony::GetQuaternion(float q[4]) const {
+        q[0] = q_[0];
+        q[1] = q_[1];
+        q[2] = q_[2];
+        q[3] = q_[3];
+    }
+
+    bool Mahony::IsConverged() const {
+        return elapsed_ >= param_.startup_time;
+    }
+
+    void Mahony::Correct(float gx, float gy, float gz, float ex, float ey, float ez, float dt) {
+        if (dt <= 0)
+            return;
+        const bool startup = !IsConverged();
+        elapsed_ += dt;
+        const float kp = startup && param_.startup_kp > param_.kp ? param_.startup_kp : param_.kp;
+
+        // 积分反馈，启动阶段误差较大，暂停积分
+        if (param_.ki > 0) {
+            if (!startup) {
+                integral_[0] += 2 * param_.ki * ex * dt;
+                integral_[1] += 2 * param_.ki * ey * dt;
+                integral_[2] += 2 * param_.ki * ez * dt;
+            }
+            gx += integral_[0];
+            gy += integral_[1];
+            gz += integral_[2];
+        } else {
+            integral_[0] = integral_[1] = integral_[2] = 0;
+        }
+
+        // 比例反馈
+        gx += 2 * kp * ex;
+        gy += 2 * kp * ey;
+        gz += 2 * kp * ez;
+
+        // 旋转增量 dq = [cos(|h|), sin(|h|) * h / |h|]，h = w * dt / 2，用级数展开避免三角函数
+        const float hx = gx * 0.5f * dt;
+        const float hy = gy * 0.5f * dt;
+        const float hz = gz * 0.5f * dt;
+        const float n2 = hx * hx + hy * hy + hz * hz;
+        const float c = 1 - n2 * (0.5f - n2 * (1.0f / 24));
+        const float s = 1 - n2 * (1.0f / 6 - n2 * (1.0f / 120));
+        const float q0 = q_[0], q1 = q_[1], q2 = q_[2], q3 = q_[3];
+        q_[0] = c * q0 - s * (q1 * hx + q2 * hy + q3 * hz);
+        q_[1] = c * q1 + s * (q0 * hx + q2 * hz - q3 * hy);
+        q_[2] = c * q2 + s * (q0 * hy - q1 * hz + q3 * hx);
+        q_[3] = c * q3 + s * (q0 * hz + q1 * hy - q2 * hx);
+
+        // 归一化，消除舍入误差的累积
+        const float recip_norm = 1.0f / sqrtf(q_[0] * q_[0] + q_[1] * q_[1] + q_[2] * q_[2] +
+                                              q_[3] * q_[3]);
+        q_[0] *= recip_norm;
+        q_[1] *= recip_norm;
+        q_[2] *= recip_norm;
+        q_[3] *= recip_norm;
+    }
+
+}  // namespace control
@@ -107,6 +107,46 @@ namespace control {
     }
 
     float ConstrainedPID::ComputeOutput(float target, float measure) {
+        integral_scale_ = 1.0f;
+        derivative_scale_ = 1.0f;
+        return Compute(target, measure);
+    }
+
+    float ConstrainedPID::ComputeOutput(float target, float measure, float dt) {
+        if (control_period_ <= 0) {
+            // 未设置整定周期，保持按调用次数计算的旧行为
+            return ComputeOutput(target, measure);
+        }
+        // 第一次调用或者dt异常（任务被挂起、时间戳错误等）时，按整定周期积分并跳过本次微分
+        const bool valid = dt > control_period_ * 0.1f && dt < control_period_ * 5.0f;
+        dtime = valid ? dt : control_period_;
+        integral_scale_ = dtime / control_period_;
+        derivative_scale_ = valid && derivative_ready_ ? control_period_ / dtime : 0.0f;
+        derivative_ready_ = true;
+        return Compute(target, measure);
+    }
+
+    float ConstrainedPID::ComputeOutputWithTimestamp(float target, float measure,
+                                                     uint32_t timestamp_us) {
+        thistime = timestamp_us;
+        // 无符号减法可以正确处理时间戳溢出
+        const float dt = timestamp_ready_ ? (thistime - lasttime) * 1e-6f : 0.0f;
+        lasttime = thistime;
+        timestamp_ready_ = true;
+        return ComputeOutput(target, measure, dt);
+    }
+
+    void ConstrainedPID::SetControlPeriod(float period) {
+        control_period_ = period > 0 ? period : 0;
+        derivative_ready_ = false;
+        timestamp_ready_ = false;
+    }
+
+    float ConstrainedPID::GetControlPeriod() const {
+        return control_period_;
+    }
+
+    float ConstrainedPID::Compute(float target, float measure) {
         if (mode_ & ErrorHandle) {
             // 异常处理
             PID_ErrorHandle();
@@ -119,68 +159,8 @@ namespace control {
                 return 0;
             }
         }
-
-        // 更新目标值和当前的测量值
-        target_ = target;
-        measure_ = measure;
-        error_ = target_ - measure_;
-
-        // 如果误差小于死区，则不进行处理
-        if (abs(error_) > dead_band_) {
-            // 比死区大，则进行pid计算
-            pout_ = kp_ * error_;
-            // 此处的iterm_仅仅计算了当前的积分值，累积积分值后续会进行计算
-            iterm_ = ki_ * error_;
-            dout_ = kd_ * (error_ - last_error_);
-
-            // 梯形积分计算
-            if (mode_ & Trapezoid_Intergral) {
-                PID_TrapezoidIntegral();
-            }
-
-            // 变速积分，参考此文章中的变速积分计算
-            // https://www.cnblogs.com/WangHongxi/p/12409382.html
-            if (mode_ & ChangingIntegralRate) {
-                PID_ChangingIntegralRate();
-            }
-
-            // 积分限幅
-            if (mode_ & Integral_Limit) {
-                PID_IntegralLimit();
-            }
-
-            // 将微分的参考值转为对实际测量值的参考而不是对误差的参考，避免突然修改error导致的微分爆炸
-            if (mode_ & Derivative_On_Measurement) {
-                PID_DerivativeOnMeasurement();
-            }
-
-            // 微分滤波，采取当前值和上一次的值的加权平均
-            if (mode_ & DerivativeFilter) {
-                PID_DerivativeFilter();
-            }
-
-            // 计算输出值
-            iout_ += iterm_;
-            output_ = pout_ + iout_ + dout_;
-
-            // 计算输出滤波，采取当前值和上一次的值的加权平均
-            if (mode_ & OutputFilter) {
-                PID_OutputFilter();
-            }
-
-            // 输出限幅
-            PID_OutputLimit();
-
-            // 微分限幅
-            PID_ProportionLimit();
-        }
-
-        // 将本次计算的值保存，用于下一次计算
-        last_measure_ = measure_;
-        last_output_ = output_;
-        last_dout_ = dout_;
-        last_error_ = error_;
-        return output_;
+        return pid_internal::Compute(state_, param_, pid_internal::RuntimeMode{mode_}, target,
+                                     measure, integral_scale_, derivative_scale_);
     }
 
     int16_t ConstrainedPID::ComputeConstrainedOutput(float error) {
@@ -188,11 +168,11 @@ namespace control {
     }
 
     void ConstrainedPID::Reinit(float kp, float ki, float kd, float max_iout, float max_out) {
-        kp_ = kp;
-        ki_ = ki;
-        kd_ = kd;
-        if (ki_ == 0) {
-            iout_ = 0;
+        param_.kp = kp;
+        param_.ki = ki;
+        param_.kd = kd;
+        if (param_.ki == 0) {
+            state_.iout = 0;
         }
         ChangeMax(max_iout, max_out);
     }
@@ -202,35 +182,37 @@ namespace control {
     }
 
     void ConstrainedPID::Reset() {
-        pout_ = 0;
-        iout_ = 0;
-        dout_ = 0;
-        error_ = 0;
-        last_error_ = 0;
+        state_.pout = 0;
+        state_.iout = 0;
+        state_.dout = 0;
+        state_.error = 0;
+        state_.last_error = 0;
+        derivative_ready_ = false;
+        timestamp_ready_ = false;
     }
     void ConstrainedPID::ChangeMax(float max_iout, float max_out) {
-        max_iout_ = max_iout;
-        max_out_ = max_out;
+        param_.max_iout = max_iout;
+        param_.max_out = max_out;
     }
     ConstrainedPID::PID_State_t ConstrainedPID::State() const {
         return {
-            .error = error_,
-            .pout = pout_,
-            .iout = iout_,
-            .dout = dout_,
-            .output = output_,
+            .error = state_.error,
+            .pout = state_.pout,
+            .iout = state_.iout,
+            .dout = state_.dout,
+            .output = state_.output,
         };
     }
 
     void ConstrainedPID::PID_ErrorHandle() {
         // pid错误处理，目前用于判断电机堵转
         // 请在速度环使用电机堵转判断
-        if (output_ < max_out_ * 0.01f) {
+        if (state_.output < param_.max_out * 0.01f) {
             // 排除PID输出本身很小的情况
             return;
         }
         // 电机是否难以移动，此处的意思是当实际速度几乎等于0的时候，电机无法转动
-        if (abs(target_ - measure_) / target_ > 0.9f) {
+        if (abs(state_.target - state_.measure) / state_.target > 0.9f) {
             PID_ErrorHandler.error_count++;
         } else {
             PID_ErrorHandler.error_count = 0;
@@ -243,85 +225,21 @@ namespace control {
             PID_ErrorHandler.error_type = Motor_Blocked;
         }
     }
-    void ConstrainedPID::PID_ChangingIntegralRate() {
-        if (error_ * iout_ > 0) {
-            // 符号相同
-            if (abs(error_) <= ScalarB) {
-                return;  // 满了
-            }
-            if (abs(error_) <= (ScalarA + ScalarB)) {
-                iterm_ *= (ScalarA + ScalarB - abs(error_)) / ScalarA;
-            } else {
-                iterm_ = 0;
-            }
-        }
-    }
-    void ConstrainedPID::PID_TrapezoidIntegral() {
-        iterm_ = ki_ * (error_ + last_error_) / 2;
-    }
-    void ConstrainedPID::PID_IntegralLimit() {
-        float temp_Output, temp_Iout;
-        temp_Iout = iout_ + iterm_;
-        temp_Output = pout_ + iout_ + dout_;
-        if (abs(temp_Output) > max_out_) {
-            if (error_ * iout_ > 0) {
-                // Integral still increasing
-                iterm_ = 0;
-            }
-        }
-
-        if (temp_Iout > max_iout_) {
-            iterm_ = 0;
-            iout_ = max_iout_;
-        }
-        if (temp_Iout < -max_iout_) {
-            iterm_ = 0;
-            iout_ = -max_iout_;
-        }
-    }
-    void ConstrainedPID::PID_DerivativeOnMeasurement() {
-        dout_ = kd_ * (measure_ - last_measure_);
-    }
-    void ConstrainedPID::PID_OutputFilter() {
-        output_ = output_ * Output_Filtering_Coefficient +
-                  last_output_ * (1 - Output_Filtering_Coefficient);
-    }
-    void ConstrainedPID::PID_OutputLimit() {
-        output_ = clip<float>(output_, -max_out_, max_out_);
-    }
-    void ConstrainedPID::PID_DerivativeFilter() {
-        dout_ = dout_ * Derivative_Filtering_Coefficient +
-                last_dout_ * (1 - Derivative_Filtering_Coefficient);
-    }
-    void ConstrainedPID::PID_ProportionLimit() {
-        pout_ = clip<float>(pout_, -max_out_, max_out_);
-    }
     void ConstrainedPID::ResetIntegral() {
-        iout_ = 0;
-        iterm_ = 0;
+        state_.iout = 0;
+        state_.iterm = 0;
     }
     void ConstrainedPID::Reinit(ConstrainedPID::PID_Init_t pid_init) {
-        kp_ = pid_init.kp;
-        ki_ = pid_init.ki;
-        kd_ = pid_init.kd;
-        iterm_ = 0;
-        max_out_ = pid_init.max_out;
-        max_iout_ = pid_init.max_iout;
-        dead_band_ = pid_init.deadband;
-        target_ = 0;
-
-        ScalarA = pid_init.A;
-        ScalarB = pid_init.B;
-
-        Output_Filtering_Coefficient = pid_init.output_filtering_coefficient;
-        Derivative_Filtering_Coefficient = pid_init.derivative_filtering_coefficient;
+        pid_internal::LoadParam(param_, pid_init);
+        state_.iterm = 0;
+        state_.target = 0;
 
         mode_ = pid_init.mode;
 
         PID_ErrorHandler.error_count = 0;
         PID_ErrorHandler.error_type = PID_ERROR_NONE;
 
-        output_ = 0;
+        state_.output = 0;
     }
     void ConstrainedPID::RegisterErrorCallcack(ConstrainedPID::PID_ErrorCallback_t callback,
                                                void* instance) {
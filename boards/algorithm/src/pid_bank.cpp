@@ -0,0 +1,174 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#include "pid_bank.h"
+
+#include <string.h>
+
+#include "utils.h"
+
+namespace control {
+
+    PIDBank::PIDBank() {
+        memset(target_, 0, sizeof(target_));
+        memset(measure_, 0, sizeof(measure_));
+    }
+
+    int PIDBank::Add(ConstrainedPID::PID_Init_t pid_init) {
+        if (size_ >= MAX_PID_BANK_SIZE)
+            return -1;
+        const int slot = size_++;
+        Reinit(slot, pid_init);
+        Reset(slot);
+        ResetIntegral(slot);
+        target_[slot] = 0;
+        measure_[slot] = 0;
+        last_measure_[slot] = 0;
+        output_[slot] = 0;
+        return slot;
+    }
+
+    void PIDBank::Reinit(int slot, ConstrainedPID::PID_Init_t pid_init) {
+        kp_[slot] = pid_init.kp;
+        ki_[slot] = pid_init.ki;
+        kd_[slot] = pid_init.kd;
+        max_out_[slot] = pid_init.max_out;
+        max_iout_[slot] = pid_init.max_iout;
+        dead_band_[slot] = pid_init.deadband;
+        scalar_a_[slot] = pid_init.A;
+        scalar_b_[slot] = pid_init.B;
+
+        // 将模式转换为系数，更新时不需要判断模式
+        const uint8_t mode = pid_init.mode;
+        integral_weight_[slot] = mode & ConstrainedPID::Trapezoid_Intergral ? 0.5f : 1.0f;
+        output_filter_[slot] =
+            mode & ConstrainedPID::OutputFilter ? pid_init.output_filtering_coefficient : 1.0f;
+        derivative_filter_[slot] = mode & ConstrainedPID::DerivativeFilter
+                                       ? pid_init.derivative_filtering_coefficient
+                                       : 1.0f;
+        integral_limit_[slot] = mode & ConstrainedPID::Integral_Limit;
+        changing_integral_[slot] = mode & ConstrainedPID::ChangingIntegralRate;
+        derivative_on_measurement_[slot] = mode & ConstrainedPID::Derivative_On_Measurement;
+
+        output_[slot] = 0;
+    }
+
+    void PIDBank::SetInput(int slot, float target, float measure) {
+        target_[slot] = target;
+        measure_[slot] = measure;
+    }
+
+    void PIDBank::Update() {
+        // 每个量都是独立的数组，循环内只有选择运算，编译器可以在有SIMD的平台上自动向量化
+        for (int i = 0; i < size_; ++i) {
+            const float error = target_[i] - measure_[i];
+            const float last_error = last_error_[i];
+            const float abs_error = fabsf(error);
+            const float iout = iout_[i];
+
+            const float pout = kp_[i] * error;
+            // 矩形积分时权重为1，梯形积分时为0.5，两种情况都和ConstrainedPID的结果逐位一致
+            const float w = integral_weight_[i];
+            float iterm = ki_[i] * (w * error + (1.0f - w) * last_error);
+            const float derror = kd_[i] * (error - last_error);
+
+            // 变速积分
+            const float a = scalar_a_[i];
+            const float b = scalar_b_[i];
+            const bool same_sign = error * iout > 0;
+            const float rate = abs_error <= b       ? 1.0f
+                               : abs_error <= a + b ? (a + b - abs_error) / a
+                                                    : 0.0f;
+            iterm = changing_integral_[i] && same_sign ? iterm * rate : iterm;
+
+            // 积分限幅，先使用未限幅的积分计算是否超出限制，和ConstrainedPID的顺序一致
+            const float max_iout = max_iout_[i];
+            const float temp_iout = iout + iterm;
+            const bool saturated = fabsf(pout + iout + derror) > max_out_[i] && same_sign;
+            const bool limit = integral_limit_[i];
+            iterm = limit && saturated ? 0.0f : iterm;
+            const bool over = limit && temp_iout > max_iout;
+            const bool under = limit && temp_iout < -max_iout;
+            const float new_iout = over ? max_iout : under ? -max_iout : iout + iterm;
+
+            // 微分先行和微分滤波
+            float dout = derivative_on_measurement_[i] ? kd_[i] * (measure_[i] - last_measure_[i])
+                                                       : derror;
+            const float dc = derivative_filter_[i];
+            dout = dout * dc + dout_[i] * (1 - dc);
+
+            // 输出滤波和输出限幅
+            const float oc = output_filter_[i];
+            float output = pout + new_iout + dout;
+            output = output * oc + output_[i] * (1 - oc);
+            output = clip<float>(output, -max_out_[i], max_out_[i]);
+
+            // 误差在死区内时保持上一次的输出
+            const bool active = abs_error > dead_band_[i];
+            pout_[i] = active ? clip<float>(pout, -max_out_[i], max_out_[i]) : pout_[i];
+            iout_[i] = active ? new_iout : iout;
+            dout_[i] = active ? dout : dout_[i];
+            output_[i] = active ? output : output_[i];
+
+            error_[i] = error;
+            last_error_[i] = error;
+            last_measure_[i] = measure_[i];
+        }
+    }
+
+    void PIDBank::Update(const float* target, const float* measure, float* output) {
+        memcpy(target_, target, size_ * sizeof(float));
+        memcpy(measure_, measure, size_ * sizeof(float));
+        Update();
+        if (output)
+            memcpy(output, output_, size_ * sizeof(float));
+    }
+
+    float PIDBank::Output(int slot) const {
+        return output_[slot];
+    }
+
+    ConstrainedPID::PID_State_t PIDBank::State(int slot) const {
+        return {
+            .error = error_[slot],
+            .pout = pout_[slot],
+            .iout = iout_[slot],
+            .dout = dout_[slot],
+            .output = output_[slot],
+        };
+    }
+
+    void PIDBank::Reset(int slot) {
+        pout_[slot] = 0;
+        iout_[slot] = 0;
+        dout_[slot] = 0;
+        error_[slot] = 0;
+        last_error_[slot] = 0;
+    }
+
+    void PIDBank::ResetIntegral(int slot) {
+        iout_[slot] = 0;
+    }
+
+    int PIDBank::Size() const {
+        return size_;
+    }
+
+} /* namespace control */
@@ -20,8 +20,44 @@
 
 #include "power_limit.h"
 
+#include "utils.h"
+
 namespace control {
 
+    namespace {
+
+        // 缓冲能量的临界值，单位为mJ，与浮点版本的5J相同
+        constexpr int32_t CRITICAL_POWER_BUFF = 5000;
+
+        // num / den，0 <= num <= den，结果为Q15。两者同时右移到num不超过16位，num << 15就在
+        // 32位以内，只需要一次32位除法，相对误差约为2^-15
+        inline int32_t RatioQ15(uint32_t num, uint32_t den) {
+            while (num >= (1u << 16)) {
+                num >>= 1;
+                den >>= 1;
+            }
+            return den == 0 ? (1 << 15) : (int32_t)((num << 15) / den);
+        }
+
+        // x * scale / 2^15，x >= 0，0 <= scale <= 2^15。x分成高低两部分，乘积都在32位以内
+        inline int32_t ScaleQ15(int32_t x, int32_t scale) {
+            return (x >> 15) * scale + (((x & 0x7fff) * scale) >> 15);
+        }
+
+    }  // namespace
+
+    power_limit_fixed_t PowerLimitToFixed(power_limit_t power_limit_info) {
+        return {
+            .power_limit = (int32_t)lroundf(power_limit_info.power_limit * 1000),
+            .WARNING_power = (int32_t)lroundf(power_limit_info.WARNING_power * 1000),
+            .WARNING_power_buff = (int32_t)lroundf(power_limit_info.WARNING_power_buff * 1000),
+            .buffer_total_current_limit =
+                (int32_t)lroundf(power_limit_info.buffer_total_current_limit),
+            .power_total_current_limit =
+                (int32_t)lroundf(power_limit_info.power_total_current_limit),
+        };
+    }
+
     PowerLimit::PowerLimit(int motor_num) {
         motor_num_ = motor_num;
     }
@@ -36,7 +72,54 @@ namespace control {
             return;
         }
 
-        float total_current_limit;
+        float total_current_limit =
+            TotalCurrentLimit(power_limit_info, current_power, current_power_buffer);
+        float total_current = 0;
+        for (int i = 0; i < motor_num_; ++i) {
+            total_current += fabs(input[i]);
+        }
+        if (total_current > total_current_limit) {
+            float current_scale = total_current_limit / total_current;
+            for (int i = 0; i < motor_num_; ++i) {
+                output[i] = input[i] * current_scale;
+            }
+        } else {
+            for (int i = 0; i < motor_num_; ++i) {
+                output[i] = input[i];
+            }
+        }
+    }
+
+    void PowerLimit::Output(bool turn_on, power_limit_fixed_t power_limit_info,
+                            int32_t current_power, int32_t current_power_buffer, int16_t* input,
+                            int16_t* output) {
+        if (!turn_on) {
+            for (int i = 0; i < motor_num_; ++i)
+                output[i] = input[i];
+            return;
+        }
+
+        const int32_t total_current_limit =
+            TotalCurrentLimit(power_limit_info, current_power, current_power_buffer);
+        int32_t total_current = 0;
+        for (int i = 0; i < motor_num_; ++i) {
+            total_current += input[i] < 0 ? -input[i] : input[i];
+        }
+        if (total_current > total_current_limit) {
+            // 缩放系数小于1，以Q15表示，每个电机只需要一次整数乘法
+            const int32_t current_scale = RatioQ15(max(total_current_limit, 0), total_current);
+            for (int i = 0; i < motor_num_; ++i) {
+                output[i] = (int16_t)((input[i] * current_scale) >> 15);
+            }
+        } else {
+            for (int i = 0; i < motor_num_; ++i) {
+                output[i] = input[i];
+            }
+        }
+    }
+
+    float PowerLimit::TotalCurrentLimit(power_limit_t power_limit_info, float current_power,
+                                        float current_power_buffer) {
         // 如果当前可用缓冲能量小于警告缓冲能量
         if (current_power_buffer < power_limit_info.WARNING_power_buff) {
             float power_scale;
@@ -49,7 +132,7 @@ namespace control {
                 power_scale = 5.0f / power_limit_info.WARNING_power_buff;
             }
             // scale down
-            total_current_limit = power_limit_info.buffer_total_current_limit * power_scale;
+            return power_limit_info.buffer_total_current_limit * power_scale;
         } else {
             // power > WARNING_POWER
             if (current_power > power_limit_info.WARNING_power) {
@@ -63,27 +146,36 @@ namespace control {
                     // power > 80w
                     power_scale = 0.0f;
                 }
-                total_current_limit = power_limit_info.buffer_total_current_limit +
-                                      power_limit_info.power_total_current_limit * power_scale;
+                return power_limit_info.buffer_total_current_limit +
+                       power_limit_info.power_total_current_limit * power_scale;
             } else {
                 // power < WARNING_POWER
-                total_current_limit = power_limit_info.buffer_total_current_limit +
-                                      power_limit_info.power_total_current_limit;
+                return power_limit_info.buffer_total_current_limit +
+                       power_limit_info.power_total_current_limit;
             }
         }
-        float total_current = 0;
-        for (int i = 0; i < motor_num_; ++i) {
-            total_current += fabs(input[i]);
-        }
-        if (total_current > total_current_limit) {
-            float current_scale = total_current_limit / total_current;
-            for (int i = 0; i < motor_num_; ++i) {
-                output[i] = input[i] * current_scale;
+    }
+
+    int32_t PowerLimit::TotalCurrentLimit(power_limit_fixed_t power_limit_info,
+                                          int32_t current_power, int32_t current_power_buffer) {
+        // 与浮点版本的分支相同，比例以Q15计算
+        if (current_power_buffer < power_limit_info.WARNING_power_buff) {
+            const int32_t buffer = max(current_power_buffer, CRITICAL_POWER_BUFF);
+            const int32_t power_scale = RatioQ15(min(buffer, power_limit_info.WARNING_power_buff),
+                                                 power_limit_info.WARNING_power_buff);
+            return ScaleQ15(power_limit_info.buffer_total_current_limit, power_scale);
+        } else if (current_power > power_limit_info.WARNING_power) {
+            if (current_power >= power_limit_info.power_limit) {
+                return power_limit_info.buffer_total_current_limit;
             }
+            const int32_t power_scale =
+                RatioQ15(power_limit_info.power_limit - current_power,
+                         power_limit_info.power_limit - power_limit_info.WARNING_power);
+            return power_limit_info.buffer_total_current_limit +
+                   ScaleQ15(power_limit_info.power_total_current_limit, power_scale);
         } else {
-            for (int i = 0; i < motor_num_; ++i) {
-                output[i] = input[i];
-            }
+            return power_limit_info.buffer_total_current_limit +
+                   power_limit_info.power_total_current_limit;
         }
     }
 
@@ -0,0 +1,154 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#include "power_model.h"
+
+#include <math.h>
+
+#include "utils.h"
+
+namespace control {
+
+    // 协方差迹的上限，激励不足时防止遗忘因子让协方差无限增大
+    // upper bound of the covariance trace, keeps forgetting from blowing it up without excitation
+    static constexpr float MAX_COVARIANCE_TRACE = 1e5f;
+    static constexpr float INITIAL_COVARIANCE = 1e4f;
+
+    PowerModel::PowerModel(int motor_num, power_model_init_t init)
+        : motor_num_(motor_num), init_(init) {
+        const float im = init_.max_current;
+        const float wm = init_.max_omega;
+        theta_[0] = init_.k1 * im * im;
+        theta_[1] = init_.k2 * im * wm;
+        theta_[2] = init_.k3 * wm * wm;
+        theta_[3] = init_.p0;
+        for (int i = 0; i < 4; ++i)
+            for (int j = 0; j < 4; ++j)
+                P_[i][j] = i == j ? INITIAL_COVARIANCE : 0;
+    }
+
+    void PowerModel::Regressors(const float* current, const float* omega, float phi[4]) const {
+        const float inv_im = 1.0f / init_.max_current;
+        const float inv_wm = 1.0f / init_.max_omega;
+        phi[0] = phi[1] = phi[2] = 0;
+        for (int i = 0; i < motor_num_; ++i) {
+            const float in = current[i] * inv_im;
+            const float wn = omega[i] * inv_wm;
+            phi[0] += in * in;
+            phi[1] += in * wn;
+            phi[2] += wn * wn;
+        }
+        phi[3] = motor_num_;
+    }
+
+    float PowerModel::Predict(const float* current, const float* omega) const {
+        float phi[4];
+        float theta[4];
+        Regressors(current, omega, phi);
+        Constrained(theta);
+        return theta[0] * phi[0] + theta[1] * phi[1] + theta[2] * phi[2] + theta[3] * phi[3];
+    }
+
+    float PowerModel::Scale(const float* current, const float* omega, float budget) const {
+        float phi[4];
+        float theta[4];
+        Regressors(current, omega, phi);
+        Constrained(theta);
+        // 电流乘以s后功率为 a·s² + b·s + c / scaling the currents by s gives a·s² + b·s + c
+        const float a = theta[0] * phi[0];
+        const float b = theta[1] * phi[1];
+        const float c = theta[2] * phi[2] + theta[3] * phi[3] - budget;
+        if (a + b + c <= 0)
+            return 1;
+        if (a <= 0)
+            return b < 0 ? 1 : clip<float>(-c / b, 0, 1);
+        const float discriminant = b * b - 4 * a * c;
+        if (discriminant < 0)
+            return clip<float>(-b / (2 * a), 0, 1);
+        return clip<float>((-b + sqrtf(discriminant)) / (2 * a), 0, 1);
+    }
+
+    float PowerModel::Budget(float power_limit, float buffer) const {
+        const float spare = buffer - init_.buffer_reserve;
+        return power_limit + (spare > 0 ? spare : 0) / init_.buffer_horizon;
+    }
+
+    void PowerModel::Accumulate(const float* current, const float* omega) {
+        float phi[4];
+        Regressors(current, omega, phi);
+        for (int i = 0; i < 4; ++i)
+            sum_phi_[i] += phi[i];
+        ++samples_;
+    }
+
+    void PowerModel::Identify(float measured_power) {
+        if (samples_ == 0)
+            return;
+        float phi[4];
+        for (int i = 0; i < 4; ++i) {
+            phi[i] = sum_phi_[i] / samples_;
+            sum_phi_[i] = 0;
+        }
+        samples_ = 0;
+
+        // 递推最小二乘 / recursive least squares
+        float Pphi[4];
+        float denominator = init_.forgetting;
+        float error = measured_power;
+        for (int i = 0; i < 4; ++i) {
+            Pphi[i] = 0;
+            for (int j = 0; j < 4; ++j)
+                Pphi[i] += P_[i][j] * phi[j];
+            denominator += phi[i] * Pphi[i];
+            error -= theta_[i] * phi[i];
+        }
+        float trace = 0;
+        for (int i = 0; i < 4; ++i) {
+            theta_[i] += Pphi[i] / denominator * error;
+            for (int j = 0; j < 4; ++j)
+                P_[i][j] -= Pphi[i] * Pphi[j] / denominator;
+            trace += P_[i][i];
+        }
+        if (trace * (1.0f / init_.forgetting) < MAX_COVARIANCE_TRACE)
+            for (int i = 0; i < 4; ++i)
+                for (int j = 0; j < 4; ++j)
+                    P_[i][j] *= 1.0f / init_.forgetting;
+    }
+
+    void PowerModel::Constrained(float theta[4]) const {
+        // 铜损、铁损和静态功耗不可能为负。只在使用时限制，直接截断估计值会让最小二乘发散
+        // copper loss, iron loss and idle power cannot be negative. They are only clamped where
+        // used, clamping the estimate itself makes the least squares diverge
+        theta[0] = fmaxf(theta_[0], 0);
+        theta[1] = theta_[1];
+        theta[2] = fmaxf(theta_[2], 0);
+        theta[3] = fmaxf(theta_[3], 0);
+    }
+
+    void PowerModel::GetCoefficients(float k[4]) const {
+        const float im = init_.max_current;
+        const float wm = init_.max_omega;
+        Constrained(k);
+        k[0] /= im * im;
+        k[1] /= im * wm;
+        k[2] /= wm * wm;
+    }
+
+}  // namespace control
@@ -0,0 +1,131 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#include "tracker.h"
+
+#include "fastmath.h"
+#include "utils.h"
+
+namespace control {
+
+    // 新目标的角速度未知，取一个较大的初始方差，单位为[(rad/s)^2]
+    // the rate of a new target is unknown, so its variance starts large, in [(rad/s)^2]
+    static constexpr float START_RATE_VARIANCE = 4.0f;
+
+    static inline float Seconds(uint64_t from, uint64_t to) {
+        return (float)(int64_t)(to - from) * 1e-6f;
+    }
+
+    TargetTracker::TargetTracker(tracker_init_t init)
+        : init_(init), time_(0), tracking_(false), gated_(false) {
+        const float variance = init.measurement_noise * init.measurement_noise;
+        pitch_.H[0][0] = yaw_.H[0][0] = 1;
+        pitch_.R[0][0] = yaw_.R[0][0] = variance;
+    }
+
+    void TargetTracker::Observe(float pitch, float yaw, uint64_t timestamp) {
+        const uint64_t latency = (uint64_t)(init_.latency * 1e6f);
+        ObserveAt(pitch, yaw, timestamp > latency ? timestamp - latency : 0);
+    }
+
+    void TargetTracker::ObserveAt(float pitch, float yaw, uint64_t time) {
+        if (!tracking_ || Seconds(time_, time) > init_.timeout) {
+            Start(pitch, yaw, time);
+            return;
+        }
+        // 重复或者乱序的观测 / duplicated or out of order observation
+        if (time <= time_)
+            return;
+
+        Propagate(&pitch_, Seconds(time_, time));
+        Propagate(&yaw_, Seconds(time_, time));
+        time_ = time;
+
+        const float pitch_error = pitch - pitch_.x[0];
+        const float yaw_error = wrapc<float>(yaw - yaw_.x[0], -FAST_PI, FAST_PI);
+        pitch_.ComputeGain();
+        yaw_.ComputeGain();
+        if (pitch_.Mahalanobis(&pitch_error) + yaw_.Mahalanobis(&yaw_error) > init_.gate) {
+            // 单个异常值只做预测，连续两个说明目标变了
+            // a single outlier is only predicted over, two in a row mean a new target
+            if (gated_)
+                Start(pitch, yaw, time);
+            else
+                gated_ = true;
+            return;
+        }
+        gated_ = false;
+        pitch_.Correct(&pitch_error);
+        pitch_.UpdateCovariance();
+        yaw_.Correct(&yaw_error);
+        yaw_.UpdateCovariance();
+        yaw_.x[0] = wrapc<float>(yaw_.x[0], -FAST_PI, FAST_PI);
+    }
+
+    bool TargetTracker::Predict(uint64_t now, float* pitch, float* yaw, float* pitch_rate,
+                                float* yaw_rate) const {
+        if (!tracking_)
+            return false;
+        const float elapsed = Seconds(time_, now);
+        if (elapsed > init_.timeout)
+            return false;
+
+        const float horizon = clip<float>(elapsed + init_.lead, 0, init_.max_prediction);
+        *pitch = pitch_.x[0] + pitch_.x[1] * horizon;
+        *yaw = wrapc<float>(yaw_.x[0] + yaw_.x[1] * horizon, -FAST_PI, FAST_PI);
+        if (pitch_rate != nullptr)
+            *pitch_rate = pitch_.x[1];
+        if (yaw_rate != nullptr)
+            *yaw_rate = yaw_.x[1];
+        return true;
+    }
+
+    void TargetTracker::Reset() {
+        tracking_ = false;
+        gated_ = false;
+    }
+
+    void TargetTracker::Start(float pitch, float yaw, uint64_t time) {
+        KalmanFilter<2, 1>* filters[2] = {&pitch_, &yaw_};
+        const float angles[2] = {pitch, yaw};
+        for (int i = 0; i < 2; ++i) {
+            filters[i]->x[0] = angles[i];
+            filters[i]->x[1] = 0;
+            filters[i]->P[0][0] = filters[i]->R[0][0];
+            filters[i]->P[0][1] = filters[i]->P[1][0] = 0;
+            filters[i]->P[1][1] = START_RATE_VARIANCE;
+        }
+        time_ = time;
+        tracking_ = true;
+        gated_ = false;
+    }
+
+    void TargetTracker::Propagate(KalmanFilter<2, 1>* filter, float dt) {
+        // 白噪声角加速度的离散化 / discretized white noise angular acceleration
+        const float q = init_.process_noise;
+        filter->F[0][0] = filter->F[1][1] = 1;
+        filter->F[0][1] = dt;
+        filter->Q[0][0] = q * dt * dt * dt / 3;
+        filter->Q[0][1] = filter->Q[1][0] = q * dt * dt / 2;
+        filter->Q[1][1] = q * dt;
+        filter->Predict();
+    }
+
+}  // namespace control
@@ -0,0 +1,112 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#include "traction.h"
+
+#include <math.h>
+
+#include "utils.h"
+
+namespace control {
+
+    // 打滑时里程计的增益相对odometry_gain的比例，防止IMU积分的误差一直被当作打滑
+    // odometry gain while slipping relative to odometry_gain, keeps an error of the integrated
+    // IMU from being taken as slip forever
+    static constexpr float SLIP_ODOMETRY_RATIO = 0.2f;
+
+    TractionControl::TractionControl(Kinematics* kinematics, traction_init_t init)
+        : kinematics_(kinematics), init_(init) {
+        Reset();
+    }
+
+    void TractionControl::Limit(const float target[3], float command[3], float dt) {
+        for (int i = 0; i < 3; ++i) {
+            const float delta = target[i] - command_[i];
+            // 速度朝0变化时为减速，否则为加速 / moving the velocity towards 0 decelerates,
+            // anything else accelerates
+            const bool braking = command_[i] * delta < 0;
+            const float step =
+                (braking ? init_.max_deceleration[i] : init_.max_acceleration[i]) * dt;
+            command_[i] += clip<float>(delta, -step, step);
+            command[i] = command_[i];
+        }
+    }
+
+    void TractionControl::Estimate(const float* wheel_speed, float ax, float ay, float gz,
+                                   float dt) {
+        // 底盘坐标系随底盘转动，dv/dt = a - ω × v
+        // the chassis frame rotates with the chassis, dv/dt = a - ω × v
+        const float vx = velocity_[0];
+        const float vy = velocity_[1];
+        velocity_[0] = vx + (ax + gz * vy) * dt;
+        velocity_[1] = vy + (ay - gz * vx) * dt;
+        velocity_[2] = gz;
+
+        const int wheel_num = kinematics_->GetWheelNum();
+        const float step = dt / init_.recovery_time;
+        bool slipping = false;
+        for (int i = 0; i < wheel_num; ++i) {
+            const float ground = kinematics_->Project(i, velocity_[0], velocity_[1], velocity_[2]);
+            slipping_[i] = fabsf(wheel_speed[i] - ground) > init_.slip_threshold;
+            if (slipping_[i])
+                torque_scale_[i] = fminf(torque_scale_[i], init_.slip_torque_scale) * (1 - step);
+            else
+                torque_scale_[i] = fminf(torque_scale_[i] + step, 1.0f);
+            slipping = slipping || slipping_[i];
+        }
+
+        // 有轮子打滑时里程计不可信，主要依靠IMU积分
+        // the odometry cannot be trusted while any wheel slips, mostly the IMU is integrated
+        float odometry[3];
+        kinematics_->Forward(wheel_speed, nullptr, &odometry[0], &odometry[1], &odometry[2]);
+        const float rate =
+            slipping ? init_.odometry_gain * SLIP_ODOMETRY_RATIO : init_.odometry_gain;
+        const float gain = fminf(rate * dt, 1.0f);
+        velocity_[0] += gain * (odometry[0] - velocity_[0]);
+        velocity_[1] += gain * (odometry[1] - velocity_[1]);
+    }
+
+    void TractionControl::Apply(float* output) const {
+        const int wheel_num = kinematics_->GetWheelNum();
+        for (int i = 0; i < wheel_num; ++i)
+            output[i] *= torque_scale_[i];
+    }
+
+    void TractionControl::Reset() {
+        for (int i = 0; i < 3; ++i) {
+            command_[i] = 0;
+            velocity_[i] = 0;
+        }
+        for (int i = 0; i < MAX_WHEEL_NUM; ++i) {
+            slipping_[i] = false;
+            torque_scale_[i] = 1;
+        }
+    }
+
+    void TractionControl::GetVelocity(float velocity[3]) const {
+        for (int i = 0; i < 3; ++i)
+            velocity[i] = velocity_[i];
+    }
+
+    bool TractionControl::IsSlipping(int wheel) const {
+        return slipping_[wheel];
+    }
+
+}  // namespace control
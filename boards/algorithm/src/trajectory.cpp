@@ -0,0 +1,170 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#include "trajectory.h"
+
+#include <math.h>
+
+#include "utils.h"
+
+namespace control {
+
+    TrajectoryGenerator::TrajectoryGenerator(trajectory_limit_t limit) {
+        SetLimit(limit);
+    }
+
+    void TrajectoryGenerator::SetLimit(trajectory_limit_t limit) {
+        limit_ = limit;
+    }
+
+    void TrajectoryGenerator::Reset(float position, float velocity, float acceleration) {
+        state_.position = position;
+        state_.velocity = velocity;
+        state_.acceleration = acceleration;
+        finished_ = velocity == 0 && acceleration == 0;
+    }
+
+    trajectory_state_t TrajectoryGenerator::Update(float target, float dt) {
+        const float jerk_step = limit_.max_jerk * dt;
+        const float distance = target - state_.position;
+
+        // 离目标足够近时直接停在目标上，剩余的距离小于一个最小加加速度脉冲能走过的距离
+        if (fabsf(distance) <= 2 * jerk_step * dt * dt &&
+            fabsf(state_.velocity) <= jerk_step * dt && fabsf(state_.acceleration) <= jerk_step) {
+            Reset(target);
+            return state_;
+        }
+        finished_ = false;
+
+        // 先试着朝目标加速一个周期，如果从试探后的状态立即刹车仍然不会越过目标，就采用加速，
+        // 否则需要开始刹车。刹车过程本身也是加加速度受限的时间最优过程
+        const float direction = distance >= 0 ? 1.0f : -1.0f;
+        const float accelerate = VelocityJerk(direction * limit_.max_velocity, dt);
+        const float accelerate_error = (StopPosition(accelerate, dt) - target) * direction;
+        if (accelerate_error <= 0) {
+            Integrate(accelerate, dt);
+            return state_;
+        }
+
+        float brake = VelocityJerk(0, dt);
+        float brake_error = (StopPosition(brake, dt) - target) * direction;
+        if (brake_error < 0) {
+            // 按刹车曲线会停在目标之前（刹车的时机被控制周期量化），
+            // 在两个加加速度之间插值，使停止位置落在目标上
+            float upper = accelerate;
+            float upper_error = accelerate_error;
+            for (int i = 0; i < 4; ++i) {
+                const float jerk =
+                    brake - brake_error * (upper - brake) / (upper_error - brake_error);
+                const float error = (StopPosition(jerk, dt) - target) * direction;
+                if (error < 0) {
+                    brake = jerk;
+                    brake_error = error;
+                } else {
+                    upper = jerk;
+                    upper_error = error;
+                }
+            }
+        }
+        Integrate(brake, dt);
+        return state_;
+    }
+
+    trajectory_state_t TrajectoryGenerator::UpdateVelocity(float target, float dt) {
+        target = clip<float>(target, -limit_.max_velocity, limit_.max_velocity);
+        const float jerk_step = limit_.max_jerk * dt;
+        if (fabsf(target - state_.velocity) <= jerk_step * dt &&
+            fabsf(state_.acceleration) <= jerk_step) {
+            state_.position += (state_.velocity + target) / 2 * dt;
+            state_.velocity = target;
+            state_.acceleration = 0;
+            finished_ = true;
+            return state_;
+        }
+        finished_ = false;
+        Integrate(VelocityJerk(target, dt), dt);
+        return state_;
+    }
+
+    trajectory_state_t TrajectoryGenerator::State() const {
+        return state_;
+    }
+
+    bool TrajectoryGenerator::IsFinished() const {
+        return finished_;
+    }
+
+    void TrajectoryGenerator::Integrate(float jerk, float dt) {
+        const float a = state_.acceleration;
+        const float v = state_.velocity;
+        state_.position += (v + (a / 2 + jerk * dt / 6) * dt) * dt;
+        state_.velocity = clip<float>(v + (a + jerk * dt / 2) * dt, -limit_.max_velocity,
+                                      limit_.max_velocity);
+        state_.acceleration =
+            clip<float>(a + jerk * dt, -limit_.max_acceleration, limit_.max_acceleration);
+    }
+
+    float TrajectoryGenerator::VelocityJerk(float target_velocity, float dt) const {
+        // 加速度沿着 a^2 = 2 * J * |dv| 下降时，速度到达目标的同时加速度恰好为0。
+        // 选择下一个周期结束时的加速度，使周期结束时的状态恰好落在这条曲线上，
+        // 本周期内速度的变化为 (a + a_next) / 2 * dt
+        const float j = limit_.max_jerk;
+        const float a = state_.acceleration;
+        const float error = target_velocity - state_.velocity - a * dt / 2;
+        const float root = sqrtf(j * j * dt * dt + 8 * j * fabsf(error));
+        const float next = copysignf(min((root - j * dt) / 2, limit_.max_acceleration), error);
+        return clip<float>((next - a) / dt, -j, j);
+    }
+
+    float TrajectoryGenerator::StopPosition(float jerk, float dt) {
+        const trajectory_state_t current = state_;
+        Integrate(jerk, dt);
+        const float stop = state_.position + BrakingDistance(state_.velocity, state_.acceleration);
+        state_ = current;
+        return stop;
+    }
+
+    float TrajectoryGenerator::BrakingDistance(float velocity, float acceleration) const {
+        const float a_max = limit_.max_acceleration;
+        const float j = limit_.max_jerk;
+        // 以加速度归零后的速度方向为正方向，刹车时加速度先降到-peak，再以最大加加速度回到0
+        const float sign = velocity + acceleration * fabsf(acceleration) / (2 * j) >= 0 ? 1 : -1;
+        float v = velocity * sign;
+        float a = acceleration * sign;
+        float peak = sqrtf(max(j * v + a * a / 2, 0.0f));
+        float hold = 0;
+        if (peak > a_max) {
+            // 中间有一段恒定的最大减速度
+            peak = a_max;
+            hold = (v + a * a / (2 * j) - a_max * a_max / j) / a_max;
+        }
+
+        float p = 0;
+        const float t1 = (a + peak) / j;
+        p += (v + (a / 2 - j * t1 / 6) * t1) * t1;
+        v += (a - j * t1 / 2) * t1;
+        p += (v - peak * hold / 2) * hold;
+        v -= peak * hold;
+        const float t3 = peak / j;
+        p += (v + (-peak / 2 + j * t3 / 6) * t3) * t3;
+        return p * sign;
+    }
+
+}  // namespace control
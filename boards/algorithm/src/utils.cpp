@@ -150,6 +150,24 @@ void RampSource::SetCurrent(float current) {
     output_ = current;
 }
 
+PeriodTimer::PeriodTimer(float nominal, float max) : nominal_(nominal), max_(max) {
+}
+
+float PeriodTimer::Update(uint64_t now) {
+    // 时间倒退时无符号的差值很大，同样超过最大值
+    // a timestamp going backwards gives a huge unsigned difference, also above the maximum
+    float dt = (now - last_) * 1e-6f;
+    if (last_ == 0 || now == 0 || dt <= 0 || dt > max_)
+        dt = nominal_;
+    last_ = now;
+    return dt;
+}
+
+void PeriodTimer::SetPeriod(float nominal, float max) {
+    nominal_ = nominal;
+    max_ = max;
+}
+
 void EndianSwap(void* data, size_t size) {
     uint8_t* p = (uint8_t*)data;
     for (size_t i = 0; i < size / 2; i++) {
@@ -23,18 +23,23 @@
 #include "MotorCanBase.h"
 #include "can_bridge.h"
 #include "connection_driver.h"
+#include "kinematics.h"
 #include "pid.h"
 #include "power_limit.h"
+#include "power_model.h"
 #include "supercap.h"
-
-#define MAX_WHEEL_NUM 8
+#include "traction.h"
 
 namespace control {
 
     /**
      * @brief chassis models
      */
-    typedef enum { CHASSIS_MECANUM_WHEEL, CHASSIS_OMNI_WHEEL } chassis_model_t;
+    typedef enum {
+        CHASSIS_MECANUM_WHEEL,
+        CHASSIS_OMNI_WHEEL,
+        CHASSIS_SWERVE_WHEEL  // requires SetKinematics()
+    } chassis_model_t;
 
     /**
      * @brief structure used when chassis instance is initialized
@@ -92,6 +97,51 @@ namespace control {
         void SetPower(bool power_limit_on, float power_limit, float chassis_power,
                       float chassis_power_buffer, bool enable_supercap = false);
 
+        /**
+         * @brief limit the power with a power model instead of scaling by the referee power
+         * @details the model predicts the power from the motor feedback every cycle and the
+         * currents are scaled down to meet PowerModel::Budget(). Every new chassis power
+         * reading from SetPower() or the can bridge is used to identify the model online
+         *
+         * @param power_model model of the chassis motors, nullptr to go back to PowerLimit
+         */
+        void SetPowerModel(PowerModel* power_model);
+
+        /**
+         * @brief compute the wheel speeds with a kinematics model instead of the built-in four
+         * wheel formulas
+         * @details x_speed, y_speed of SetSpeed() are then in [m/s] and turn_speed in [rad/s], the
+         * wheel speeds of the model go to the motors unchanged. Swerve modules are steered with
+         * relative turns from the current steering target, so align the steering motors before
+         * calling this
+         *
+         * @param kinematics model with one wheel per chassis motor, nullptr to go back to the
+         *                   built-in formulas
+         * @param steering   steering motors in the order of the wheels, entries of non swerve
+         *                   wheels are ignored
+         */
+        void SetKinematics(Kinematics* kinematics, driver::SteeringMotor** steering = nullptr);
+
+        /**
+         * @brief limit the acceleration of SetSpeed() and scale down the output of slipping
+         * wheels
+         * @details needs SetKinematics() first. Update() then ramps towards the speed of
+         * SetSpeed() and checks the wheel odometry against UpdateInertial(), the outputs are
+         * scaled in the same pre output callback as the power limit
+         *
+         * @param traction traction control built on the same kinematics, nullptr to turn it off
+         */
+        void SetTractionControl(TractionControl* traction);
+
+        /**
+         * @brief feed the IMU to the traction control, call every cycle before Update()
+         *
+         * @param ax acceleration to the right without gravity, in [m/s^2]
+         * @param ay acceleration to the front without gravity, in [m/s^2]
+         * @param gz counter-clockwise yaw rate, in [rad/s]
+         */
+        void UpdateInertial(float ax, float ay, float gz);
+
         void Enable();
 
         void Disable();
@@ -161,6 +211,18 @@ namespace control {
 
         volatile float current_chassis_power_ = 0;
         volatile float current_chassis_power_buffer_ = 0;
+        PowerModel* power_model_ = nullptr;
+        volatile bool new_power_sample_ = false;
+
+        Kinematics* kinematics_ = nullptr;
+        driver::SteeringMotor** steering_ = nullptr;
+        float steering_angles_[MAX_WHEEL_NUM] = {};
+        float steering_sent_[MAX_WHEEL_NUM] = {};
+
+        TractionControl* traction_ = nullptr;
+        volatile float target_velocity_[3] = {0, 0, 0};
+        volatile float inertial_[3] = {0, 0, 0};
+        uint64_t last_update_us_ = 0;
 
         float chassis_offset_;
 
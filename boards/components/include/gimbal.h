@@ -125,6 +125,27 @@ namespace control {
          */
         void UpdateIMU(float pitch, float yaw);
 
+        /**
+         * @brief 基于当前传感器数据更新云台的输出，同时用陀螺仪的角速度作为速度环的反馈
+         * @param pitch      陀螺仪测量的pitch角度，范围为[-pi, pi]
+         * @param yaw        陀螺仪测量的yaw角度，范围为[-pi, pi]
+         * @param pitch_rate 陀螺仪测量的pitch角速度，单位为[rad/s]
+         * @param yaw_rate   陀螺仪测量的yaw角速度，单位为[rad/s]
+         * @note 速度环在世界坐标系下闭环，底盘旋转不再需要SetSpeedOffset()补偿，
+         * 一般与EnableADRC()一起使用
+         */
+        /**
+         * @brief update the output of the motors based on current sensor data, the gyro rates
+         * are used as the feedback of the speed loops
+         * @param pitch      pitch angle measured by gyroscope, range is [-pi, pi]
+         * @param yaw        yaw angle measured by gyroscope, range is [-pi, pi]
+         * @param pitch_rate pitch rate measured by gyroscope in [rad/s]
+         * @param yaw_rate   yaw rate measured by gyroscope in [rad/s]
+         * @note the speed loops are closed in the world frame, so chassis rotation no longer
+         * needs to be compensated with SetSpeedOffset(). Normally used with EnableADRC()
+         */
+        void UpdateIMU(float pitch, float yaw, float pitch_rate, float yaw_rate);
+
         /**
          * @brief 将云台指向新的方向，是绝对于车身零点的角度
          * @param new_pitch 新的pitch角度
@@ -173,6 +194,38 @@ namespace control {
          */
         void UpdateOffset(float pitch_offset, float yaw_offset);
 
+        /**
+         * @brief 为云台的两个电机启用S型轨迹生成器，目标角度的突变会被平滑为速度、加速度和
+         * 加加速度受限的轨迹，轨迹的速度作为速度环的前馈
+         *
+         * @param pitch_limit pitch轴的轨迹限制，单位为[rad/s]、[rad/s^2]、[rad/s^3]
+         * @param yaw_limit   yaw轴的轨迹限制
+         */
+        /**
+         * @brief enable the trajectory generator on both gimbal motors, steps of the target
+         * angle are shaped into velocity, acceleration and jerk limited trajectories whose
+         * velocity is fed forward to the speed loop
+         *
+         * @param pitch_limit trajectory limits of pitch, in [rad/s], [rad/s^2] and [rad/s^3]
+         * @param yaw_limit   trajectory limits of yaw
+         */
+        void EnableTrajectory(trajectory_limit_t pitch_limit, trajectory_limit_t yaw_limit);
+
+        /**
+         * @brief 用一阶自抗扰控制器代替两个电机的速度环PID，估计并抵消底盘旋转带来的摩擦等扰动
+         *
+         * @param pitch_init pitch轴速度环的ADRC参数
+         * @param yaw_init   yaw轴速度环的ADRC参数
+         */
+        /**
+         * @brief replace the speed loop PID of both motors with first order ADRC, which estimates
+         * and cancels disturbances such as the friction dragged in by chassis rotation
+         *
+         * @param pitch_init ADRC parameters of the pitch speed loop
+         * @param yaw_init   ADRC parameters of the yaw speed loop
+         */
+        void EnableADRC(adrc_init_t pitch_init, adrc_init_t yaw_init);
+
       private:
         // acquired from user
         driver::MotorCANBase* pitch_motor_ = nullptr;
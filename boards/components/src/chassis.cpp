@@ -23,6 +23,9 @@
 #include "bsp_error_handler.h"
 #include "bsp_os.h"
 
+// C620电调的电流满量程：输出16384对应20A
+static const float C620_AMPERE_PER_OUTPUT = 20.0f / 16384.0f;
+
 namespace control {
 
     Chassis::Chassis(const chassis_t chassis) {
@@ -33,7 +36,8 @@ namespace control {
         switch (chassis.model) {
                 // 麦克纳姆轮
             case CHASSIS_MECANUM_WHEEL:
-            case CHASSIS_OMNI_WHEEL: {
+            case CHASSIS_OMNI_WHEEL:
+            case CHASSIS_SWERVE_WHEEL: {
                 // 新建电机关联
                 motors_ = new driver::MotorCANBase*[FourWheel::motor_num];
                 motors_[FourWheel::front_left] = chassis.motors[FourWheel::front_left];
@@ -72,7 +76,8 @@ namespace control {
         driver::MotorCANBase::RegisterPreOutputCallback([](void* args) { UNUSED(args); }, nullptr);
         switch (model_) {
             case CHASSIS_MECANUM_WHEEL:
-            case CHASSIS_OMNI_WHEEL: {
+            case CHASSIS_OMNI_WHEEL:
+            case CHASSIS_SWERVE_WHEEL: {
                 motors_[FourWheel::front_left] = nullptr;
                 motors_[FourWheel::front_right] = nullptr;
                 motors_[FourWheel::back_left] = nullptr;
@@ -92,6 +97,20 @@ namespace control {
 
     void Chassis::SetSpeed(const float x_speed, const float y_speed, const float turn_speed) {
         Heartbeat();
+        if (kinematics_ != nullptr) {
+            // 运动学模型中逆时针为正，这里的turn_speed顺时针为正
+            // counter-clockwise is positive in the kinematics, clockwise for turn_speed here
+            if (traction_ != nullptr) {
+                // 加速度限制在Update()中按实际的周期计算
+                // the acceleration limit runs in Update() with the actual period
+                target_velocity_[0] = x_speed;
+                target_velocity_[1] = y_speed;
+                target_velocity_[2] = -turn_speed;
+            } else {
+                kinematics_->Inverse(x_speed, y_speed, -turn_speed, speeds_, steering_angles_);
+            }
+            return;
+        }
         switch (model_) {
             case CHASSIS_MECANUM_WHEEL:
             case CHASSIS_OMNI_WHEEL: {
@@ -119,7 +138,7 @@ namespace control {
                            float chassis_power_buffer, bool enable_supercap) {
         if (!power_limit_on_ && power_limit_on) {
             driver::MotorCANBase::RegisterPreOutputCallback(UpdatePowerLimitWrapper, this);
-        } else if (power_limit_on_ && !power_limit_on) {
+        } else if (power_limit_on_ && !power_limit_on && traction_ == nullptr) {
             driver::MotorCANBase::RegisterPreOutputCallback([](void* args) { UNUSED(args); },
                                                             nullptr);
         }
@@ -129,6 +148,9 @@ namespace control {
         power_limit_info_.WARNING_power_buff = 50;
 
         // 检测功率是否发生变化，如果发生变化则更新超级电容
+        // 裁判系统的功率刷新率低于控制频率，数值变化说明收到了新的测量值
+        if (chassis_power != current_chassis_power_)
+            new_power_sample_ = true;
         current_chassis_power_ = chassis_power;
 
         current_chassis_power_buffer_ = chassis_power_buffer;
@@ -164,6 +186,10 @@ namespace control {
             for (int i = 0; i < wheel_num_; i++) {
                 motors_[i]->Disable();
             }
+            if (traction_ != nullptr) {
+                traction_->Reset();
+                last_update_us_ = 0;
+            }
             return;
         } else {
             for (int i = 0; i < wheel_num_; i++) {
@@ -175,6 +201,7 @@ namespace control {
         switch (model_) {
             case CHASSIS_MECANUM_WHEEL:
             case CHASSIS_OMNI_WHEEL:
+            case CHASSIS_SWERVE_WHEEL:
                 power_limit_info_.buffer_total_current_limit = 3500 * FourWheel::motor_num;
                 power_limit_info_.power_total_current_limit =
                     5000 * FourWheel::motor_num / 80.0 * power_limit_info_.power_limit;
@@ -184,9 +211,27 @@ namespace control {
                 RM_ASSERT_TRUE(false, "Not Supported Chassis Mode\r\n");
         }
 
+        if (traction_ != nullptr) {
+            const uint64_t now = bsp::GetHighresTickMicroSec();
+            const float dt = last_update_us_ == 0 ? 0 : (now - last_update_us_) * 1e-6f;
+            last_update_us_ = now;
+
+            const float target[3] = {target_velocity_[0], target_velocity_[1],
+                                     target_velocity_[2]};
+            float command[3];
+            traction_->Limit(target, command, dt);
+            kinematics_->Inverse(command[0], command[1], command[2], speeds_, steering_angles_);
+
+            float wheel_speed[MAX_WHEEL_NUM];
+            for (int i = 0; i < wheel_num_; ++i)
+                wheel_speed[i] = motors_[i]->GetOutputShaftOmega();
+            traction_->Estimate(wheel_speed, inertial_[0], inertial_[1], inertial_[2], dt);
+        }
+
         switch (model_) {
             case CHASSIS_MECANUM_WHEEL:
-            case CHASSIS_OMNI_WHEEL: {
+            case CHASSIS_OMNI_WHEEL:
+            case CHASSIS_SWERVE_WHEEL: {
                 motors_[FourWheel::front_left]->SetTarget(speeds_[FourWheel::front_left]);
                 motors_[FourWheel::front_right]->SetTarget(speeds_[FourWheel::front_right]);
                 motors_[FourWheel::back_left]->SetTarget(speeds_[FourWheel::back_left]);
@@ -197,6 +242,20 @@ namespace control {
             default:
                 RM_ASSERT_TRUE(false, "Not Supported Chassis Mode\r\n");
         }
+
+        if (kinematics_ != nullptr && steering_ != nullptr) {
+            for (int i = 0; i < wheel_num_; ++i) {
+                if (!kinematics_->IsSwerve(i))
+                    continue;
+                // 转向电机的目标是多圈角度，按相对上一次指令的最短转角转动
+                // the steering target is a multi-turn angle, turn by the shortest delta from the
+                // last command
+                steering_[i]->TurnRelative(
+                    wrapc<float>(steering_angles_[i] - steering_sent_[i], -PI, PI));
+                steering_sent_[i] = steering_angles_[i];
+                steering_[i]->Update();
+            }
+        }
     }
 
     void Chassis::CanBridgeUpdateEventXYWrapper(communication::can_bridge_ext_id_t ext_id,
@@ -295,6 +354,8 @@ namespace control {
                 return;
             }
         }
+        if (data.data_two_float.data[0] != current_chassis_power_)
+            new_power_sample_ = true;
         current_chassis_power_ = data.data_two_float.data[0];
         current_chassis_power_buffer_ = data.data_two_float.data[1];
     }
@@ -308,12 +369,39 @@ namespace control {
     void Chassis::UpdatePowerLimit() {
         switch (model_) {
             case CHASSIS_MECANUM_WHEEL:
-            case CHASSIS_OMNI_WHEEL: {
+            case CHASSIS_OMNI_WHEEL:
+            case CHASSIS_SWERVE_WHEEL: {
                 float input[FourWheel::motor_num];
                 float output[FourWheel::motor_num];
                 for (uint8_t i = 0; i < FourWheel::motor_num; ++i)
                     input[i] = motors_[i]->GetOutput();
-                if ((!super_capacitor_enable_) || (!super_capacitor_->IsOnline())) {
+                if (traction_ != nullptr)
+                    traction_->Apply(input);
+                if (power_model_ != nullptr &&
+                    ((!super_capacitor_enable_) || (!super_capacitor_->IsOnline()))) {
+                    float current[FourWheel::motor_num];
+                    float omega[FourWheel::motor_num];
+                    for (uint8_t i = 0; i < FourWheel::motor_num; ++i) {
+                        current[i] = input[i] * C620_AMPERE_PER_OUTPUT;
+                        omega[i] = motors_[i]->GetOmega();
+                    }
+                    if (new_power_sample_) {
+                        new_power_sample_ = false;
+                        power_model_->Identify(current_chassis_power_);
+                    }
+                    // 关闭功率限制时直接输出，但模型仍然用实际的输出继续辨识
+                    float scale = 1.0f;
+                    if (power_limit_on_) {
+                        const float budget = power_model_->Budget(power_limit_info_.power_limit,
+                                                                  current_chassis_power_buffer_);
+                        scale = power_model_->Scale(current, omega, budget);
+                    }
+                    for (uint8_t i = 0; i < FourWheel::motor_num; ++i) {
+                        output[i] = input[i] * scale;
+                        current[i] *= scale;
+                    }
+                    power_model_->Accumulate(current, omega);
+                } else if ((!super_capacitor_enable_) || (!super_capacitor_->IsOnline())) {
                     power_limit_->Output(power_limit_on_, power_limit_info_, current_chassis_power_,
                                          current_chassis_power_buffer_, input, output);
                 } else {
@@ -340,6 +428,50 @@ namespace control {
                 break;
         }
     }
+    void Chassis::SetPowerModel(PowerModel* power_model) {
+        power_model_ = power_model;
+        new_power_sample_ = false;
+    }
+
+    void Chassis::SetKinematics(Kinematics* kinematics, driver::SteeringMotor** steering) {
+        if (kinematics == nullptr && traction_ != nullptr)
+            SetTractionControl(nullptr);
+        if (kinematics != nullptr)
+            RM_ASSERT_EQ(kinematics->GetWheelNum(), wheel_num_, "Wheel number mismatch\r\n");
+        // 转向电机校准后的目标即为转向零位 / the steering target after alignment is the zero
+        for (int i = 0; i < wheel_num_; ++i) {
+            speeds_[i] = 0;
+            steering_angles_[i] = 0;
+            steering_sent_[i] = 0;
+            if (kinematics != nullptr)
+                kinematics->SetModuleAngle(i, 0);
+        }
+        kinematics_ = kinematics;
+        steering_ = steering;
+    }
+
+    void Chassis::SetTractionControl(TractionControl* traction) {
+        if (traction != nullptr) {
+            RM_ASSERT_TRUE(kinematics_ != nullptr, "Traction control needs kinematics\r\n");
+            traction->Reset();
+        }
+        // 输出的缩放和功率限制在同一个回调中 / outputs are scaled in the power limit callback
+        if (!power_limit_on_ && traction != nullptr)
+            driver::MotorCANBase::RegisterPreOutputCallback(UpdatePowerLimitWrapper, this);
+        else if (!power_limit_on_)
+            driver::MotorCANBase::RegisterPreOutputCallback([](void* args) { UNUSED(args); },
+                                                            nullptr);
+        target_velocity_[0] = target_velocity_[1] = target_velocity_[2] = 0;
+        last_update_us_ = 0;
+        traction_ = traction;
+    }
+
+    void Chassis::UpdateInertial(float ax, float ay, float gz) {
+        inertial_[0] = ax;
+        inertial_[1] = ay;
+        inertial_[2] = gz;
+    }
+
     void Chassis::Enable() {
         chassis_enable_ = true;
         if (has_super_capacitor_) {
@@ -355,6 +487,8 @@ namespace control {
 
     void Chassis::SetMaxMotorSpeed(float max_speed) {
         max_motor_speed_ = max_speed;
+        if (kinematics_ != nullptr)
+            kinematics_->SetMaxSpeed(max_speed);
     }
 
     ChassisCanBridgeSender::ChassisCanBridgeSender(communication::CanBridge* can_bridge,
@@ -129,6 +129,12 @@ namespace control {
         //        yaw_motor_->SetOutput(yo_out);
     }
 
+    void Gimbal::UpdateIMU(float pitch, float yaw, float pitch_rate, float yaw_rate) {
+        pitch_motor_->SetOmegaFeedback(pitch_rate);
+        yaw_motor_->SetOmegaFeedback(yaw_rate);
+        UpdateIMU(pitch, yaw);
+    }
+
     void Gimbal::TargetAbs(float abs_pitch, float abs_yaw) {
         if (data_.pitch_inverted)
             abs_pitch = -abs_pitch;
@@ -168,4 +174,14 @@ namespace control {
         yaw_angle_ = wrap<float>(yaw_motor_->GetTheta() + new_yaw, 0, 2 * PI);
     }
 
+    void Gimbal::EnableTrajectory(trajectory_limit_t pitch_limit, trajectory_limit_t yaw_limit) {
+        pitch_motor_->EnableTrajectory(pitch_limit);
+        yaw_motor_->EnableTrajectory(yaw_limit);
+    }
+
+    void Gimbal::EnableADRC(adrc_init_t pitch_init, adrc_init_t yaw_init) {
+        pitch_motor_->EnableADRC(pitch_init, driver::MotorCANBase::OMEGA);
+        yaw_motor_->EnableADRC(yaw_init, driver::MotorCANBase::OMEGA);
+    }
+
 }  // namespace control
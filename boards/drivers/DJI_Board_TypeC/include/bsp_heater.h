@@ -38,10 +38,32 @@ namespace bsp {
         Heater(TIM_HandleTypeDef* htim, uint8_t channel, uint32_t clock_freq, float temp);
         float Update(float real_temp);
 
+        /**
+         * @brief 开启热模型前馈，按第一次更新时的温度估计环境温度，直接输出保持目标温度所需的
+         * 功率，PID只修正剩下的误差。启动时已经是热的则前馈接近0，退化为原来的PID
+         * @param gain 稳态温升与输出的比值，单位为[°C]，可以用保持目标温度时的温升除以输出估计，
+         * 0表示关闭
+         */
+        /**
+         * @brief enable the thermal model feedforward. The ambient temperature is taken from the
+         * first update and the output needed to hold the target is applied directly, so the PID
+         * only corrects the remainder. Starting warm gives almost no feedforward, i.e. the plain
+         * PID as before
+         * @param gain steady state temperature rise per unit of output in [°C], can be estimated
+         * as the temperature rise divided by the output while holding the target, 0 to disable
+         */
+        void SetFeedforward(float gain);
+
       private:
         PWM pwm_;
         float temp_;
         control::ConstrainedPID pid_;
+        float max_iout_ = 800;
+        float max_out_ = 500;
+        float feedforward_gain_ = 0;
+        float feedforward_ = 0;
+        float ambient_ = 0;
+        bool ambient_ready_ = false;
     };
 
 }  // namespace bsp
@@ -24,10 +24,16 @@
 
 #include <map>
 
+#include "adaptive_notch.h"
+#include "biquad.h"
 #include "bsp_gpio.h"
 #include "bsp_heater.h"
 #include "cmsis_os.h"
+#include "gyro_bias.h"
+#include "gyro_temp.h"
+#include "mahony.h"
 #include "spi.h"
+#include "utils.h"
 
 // acc (6 bytes) + temp (2 bytes) + gyro (6 bytes) + mag_ (6 bytes)
 #define MPU6500_SIZEOF_DATA 20
@@ -506,13 +512,49 @@ namespace bsp {
     class IMU_typeC {
       public:
         IMU_typeC(IMU_typeC_init_t init, bool useMag = true);
+        /**
+         * @brief 重新开始估计陀螺仪零漂，姿态解算不会暂停
+         */
         void Calibrate();
+        /**
+         * @brief 达到目标温度后零漂的置信度是否已经达到过1
+         */
         bool CaliDone();
         void Update();
         bool DataReady();
+        /**
+         * @brief 零漂估计的置信度，范围为[0, 1]
+         */
+        float GetBiasConfidence();
+        /**
+         * @brief 设置陀螺仪零漂的先验，单位为[rad/s]，置信度范围为[0, 1]
+         */
+        void SetGyroBiasPrior(const float bias[3], float confidence);
+        /**
+         * @brief 载入零漂的温度模型，预热期间按温度补偿零漂
+         */
+        void SetTempModel(const control::gyro_temp_model_t& model);
+        /**
+         * @brief 用本次预热过程中静止时的数据拟合零漂的温度模型，可以保存后在下一次启动时载入
+         * @return 数据覆盖的温度范围不足时返回false
+         */
+        bool GetTempModel(control::gyro_temp_model_t* model);
+        /**
+         * @brief 开启加热的热模型前馈，见Heater::SetFeedforward()
+         */
+        void SetHeaterFeedforward(float gain);
+        /**
+         * @brief 设置扣除温度模型后、估计零漂前的陀螺仪陷波滤波器，传入nullptr取消
+         * @note 滤波器在Update中调用，频率由其它任务通过SetFrequency或Analyze调整
+         */
+        void SetGyroFilter(control::AdaptiveNotch* filter);
 
         float INS_quat[4] = {0.0f, 0.0f, 0.0f, 0.0f};
         float INS_angle[3] = {0.0f, 0.0f, 0.0f};
+        // 扣除零漂并陷波后的角速度，单位为[rad/s]
+        float INS_gyro[3] = {0.0f, 0.0f, 0.0f};
+        // 低通滤波后的加速度，单位为[m/s^2]
+        float INS_accel[3] = {0.0f, 0.0f, 0.0f};
         float Temp = 0;
         float TempPWM = 0;
 
@@ -521,19 +563,17 @@ namespace bsp {
 
       private:
         bool useMag_;
-        unsigned long count_ = 0;
-        bool calibrate_ = false;
         bool calidone_ = false;
+        control::GyroBiasEstimator bias_;
+        control::GyroTempModel temp_model_;
+        bool temp_valid_ = false;
 
-        unsigned zeroDriftTry = 1000;
-        float zeroDrift[3] = {0, 0, 0};
-        float zeroDriftTemp[3] = {0, 0, 0};
+        control::BiquadFilter<3> accel_filter_{control::ACCEL_LPF_COEFF};
+        control::AdaptiveNotch* gyro_filter_ = nullptr;
 
-        float accel_fliter_1[3] = {0.0f, 0.0f, 0.0f};
-        float accel_fliter_2[3] = {0.0f, 0.0f, 0.0f};
-        float accel_fliter_3[3] = {0.0f, 0.0f, 0.0f};
-        const float fliter_num[3] = {1.929454039488895f, -0.93178349823448126f,
-                                     0.002329458745586203f};
+        control::Mahony mahony_;
+        /* 姿态解算的实际周期，名义为1kHz */
+        PeriodTimer update_period_{0.001f, 0.01f};
 
         friend class IST8310;
 
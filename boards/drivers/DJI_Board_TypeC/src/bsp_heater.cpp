@@ -27,9 +27,7 @@ namespace bsp {
         temp_ = temp;
         pwm_.Start();
         float* pid_param = new float[3]{160, 0.1, 0};
-        float heater_I_limit = 800;
-        float heater_output_limit = 500;
-        pid_.Reinit(pid_param, heater_I_limit, heater_output_limit);
+        pid_.Reinit(pid_param, max_iout_, max_out_);
     }
 
     Heater::Heater(heater_init_t init)
@@ -37,13 +35,25 @@ namespace bsp {
         temp_ = init.temp;
         pwm_.Start();
         float* pid_param = new float[3]{160, 0.1, 0};
-        float heater_I_limit = 800;
-        float heater_output_limit = 500;
-        pid_.Reinit(pid_param, heater_I_limit, heater_output_limit);
+        pid_.Reinit(pid_param, max_iout_, max_out_);
+    }
+
+    void Heater::SetFeedforward(float gain) {
+        feedforward_gain_ = gain > 0 ? gain : 0;
+        feedforward_ = 0;
+        if (feedforward_gain_ > 0 && ambient_ready_)
+            feedforward_ = clip<float>((temp_ - ambient_) / feedforward_gain_, 0, max_out_);
+        // PID的限幅扣除前馈，积分抗饱和按实际的总输出判断
+        pid_.ChangeMax(fminf(max_iout_, max_out_ - feedforward_), max_out_ - feedforward_);
     }
 
     float Heater::Update(float real_temp) {
-        float output = pid_.ComputeOutput(temp_ - real_temp);
+        if (!ambient_ready_) {
+            ambient_ = real_temp;
+            ambient_ready_ = true;
+            SetFeedforward(feedforward_gain_);
+        }
+        float output = pid_.ComputeOutput(temp_ - real_temp) + feedforward_;
         output = output > 0 ? output : 0;
         if (real_temp > temp_ + 0.5)
             output = 0;
@@ -22,11 +22,11 @@
 
 #include <cmath>
 
-#include "MahonyAHRS.h"
 #include "bsp_error_handler.h"
 #include "bsp_mpu6500_reg.h"
 #include "bsp_os.h"
 #include "dma.h"
+#include "fastmath.h"
 
 #define MPU6500_DELAY 55  // SPI delay
 // configured with initialization sequences
@@ -598,7 +598,8 @@ namespace bsp {
     }
 
     IMU_typeC::IMU_typeC(IMU_typeC_init_t init, bool useMag)
-        : IST8310_(init.IST8310, this),
+        : temp_model_(init.heater.temp),
+          IST8310_(init.IST8310, this),
           BMI088_(init.BMI088),
           heater_(init.heater),
           Accel_INT_(init.Accel_INT_pin_, this),
@@ -613,16 +614,15 @@ namespace bsp {
         hdma_spi_rx_ = init.hdma_spi_rx;
         hdma_spi_tx_ = init.hdma_spi_tx;
         BMI088_.Read(BMI088_real_data_.gyro, BMI088_real_data_.accel, &BMI088_real_data_.temp);
-        accel_fliter_1[0] = accel_fliter_2[0] = accel_fliter_3[0] = BMI088_real_data_.accel[0];
-        accel_fliter_1[1] = accel_fliter_2[1] = accel_fliter_3[1] = BMI088_real_data_.accel[1];
-        accel_fliter_1[2] = accel_fliter_2[2] = accel_fliter_3[2] = BMI088_real_data_.accel[2];
+        accel_filter_.Reset(BMI088_real_data_.accel);
         AHRS_init(INS_quat, BMI088_real_data_.accel, IST8310_real_data_.mag);
         SPI_DMA_init((uint32_t)gyro_dma_tx_buf, (uint32_t)gyro_dma_rx_buf, SPI_DMA_GYRO_LENGHT);
         imu_start_dma_flag = 1;
     }
 
     void IMU_typeC::Calibrate() {
-        calibrate_ = true;
+        bias_.Reset();
+        calidone_ = false;
     }
 
     bool IMU_typeC::CaliDone() {
@@ -648,80 +648,91 @@ namespace bsp {
                                           &BMI088_real_data_.temp);
             Temp = BMI088_real_data_.temp;
             TempPWM = TempControl(BMI088_real_data_.temp);
+            temp_valid_ = true;
         }
 
-        if (calibrate_ && Temp > heater_param_.temp - 2) {
-            if (!useMag_) {
-                if (++count_ < zeroDriftTry) {
-                    for (int i = 0; i < 3; ++i) {
-                        zeroDriftTemp[i] += BMI088_real_data_.gyro[i];
-                    }
-                    return;
-                } else if (count_ == zeroDriftTry) {
-                    for (int i = 0; i < 3; ++i) {
-                        zeroDrift[i] = zeroDriftTemp[i] / (float)zeroDriftTry;
-                    }
-                    calidone_ = true;
-                    return;
-                }
-                for (int i = 0; i < 3; ++i) {
-                    BMI088_real_data_.gyro[i] -= zeroDrift[i];
-                }
-            }
-            accel_fliter_1[0] = accel_fliter_2[0];
-            accel_fliter_2[0] = accel_fliter_3[0];
-            accel_fliter_3[0] = accel_fliter_2[0] * fliter_num[0] +
-                                accel_fliter_1[0] * fliter_num[1] +
-                                BMI088_real_data_.accel[0] * fliter_num[2];
-            accel_fliter_1[1] = accel_fliter_2[1];
-            accel_fliter_2[1] = accel_fliter_3[1];
-            accel_fliter_3[1] = accel_fliter_2[1] * fliter_num[0] +
-                                accel_fliter_1[1] * fliter_num[1] +
-                                BMI088_real_data_.accel[1] * fliter_num[2];
-            accel_fliter_1[2] = accel_fliter_2[2];
-            accel_fliter_2[2] = accel_fliter_3[2];
-            accel_fliter_3[2] = accel_fliter_2[2] * fliter_num[0] +
-                                accel_fliter_1[2] * fliter_num[1] +
-                                BMI088_real_data_.accel[2] * fliter_num[2];
-            AHRS_update(INS_quat, 0.001f, BMI088_real_data_.gyro, BMI088_real_data_.accel,
-                        IST8310_real_data_.mag);
-            GetAngle(INS_quat, INS_angle + INS_YAW_ADDRESS_OFFSET,
-                     INS_angle + INS_PITCH_ADDRESS_OFFSET, INS_angle + INS_ROLL_ADDRESS_OFFSET);
-        }
+        // 按实际的时间间隔积分，时间戳不可用或者任务被挂起过时按名义的1kHz计算
+        const float dt = update_period_.Update(GetHighresTickMicroSec());
+
+        // 先按温度模型补偿，剩下的常值部分由在线估计处理
+        float gyro[3], bias[3];
+        temp_model_.Evaluate(Temp, bias);
+        for (int i = 0; i < 3; ++i)
+            gyro[i] = BMI088_real_data_.gyro[i] - bias[i];
+        // 陷波器的直流增益为1，零漂不受影响，先陷波再估计零漂，振动就不会妨碍静止检测
+        if (gyro_filter_ != nullptr)
+            gyro_filter_->Update(gyro, gyro);
+        bias_.Update(gyro, BMI088_real_data_.accel, dt);
+        bias_.GetBias(bias);
+        for (int i = 0; i < 3; ++i)
+            gyro[i] -= bias[i];
+        for (int i = 0; i < 3; ++i)
+            INS_gyro[i] = gyro[i];
+        // 校准完成之前记录静止时的原始零漂，用于拟合温度模型
+        if (temp_valid_ && !calidone_ && bias_.IsStationary())
+            temp_model_.AddSample(Temp, BMI088_real_data_.gyro, dt);
+        // 加热过程中零漂仍在变化，估计器会持续跟随，达到目标温度后才认为校准完成
+        if (DataReady() && bias_.GetConfidence() >= 1)
+            calidone_ = true;
+
+        accel_filter_.Update(BMI088_real_data_.accel, INS_accel);
+        AHRS_update(INS_quat, dt, gyro, BMI088_real_data_.accel, IST8310_real_data_.mag);
+        GetAngle(INS_quat, INS_angle + INS_YAW_ADDRESS_OFFSET, INS_angle + INS_PITCH_ADDRESS_OFFSET,
+                 INS_angle + INS_ROLL_ADDRESS_OFFSET);
     }
 
     bool IMU_typeC::DataReady() {
         return Temp > heater_param_.temp - 2;
     }
 
+    float IMU_typeC::GetBiasConfidence() {
+        return bias_.GetConfidence();
+    }
+
+    void IMU_typeC::SetGyroBiasPrior(const float bias[3], float confidence) {
+        bias_.SetPrior(bias, confidence);
+    }
+
+    void IMU_typeC::SetTempModel(const control::gyro_temp_model_t& model) {
+        temp_model_.SetModel(model);
+    }
+
+    bool IMU_typeC::GetTempModel(control::gyro_temp_model_t* model) {
+        return temp_model_.Fit(model);
+    }
+
+    void IMU_typeC::SetHeaterFeedforward(float gain) {
+        heater_.SetFeedforward(gain);
+    }
+
+    void IMU_typeC::SetGyroFilter(control::AdaptiveNotch* filter) {
+        gyro_filter_ = filter;
+    }
+
     IMU_typeC* IMU_typeC::instance_ = nullptr;
 
     void IMU_typeC::AHRS_init(float* quat, float* accel, float* mag) {
-        UNUSED(accel);
         UNUSED(mag);
-        quat[0] = 1.0f;
-        quat[1] = 0.0f;
-        quat[2] = 0.0f;
-        quat[3] = 0.0f;
+        mahony_.Reset(accel[0], accel[1], accel[2]);
+        mahony_.GetQuaternion(quat);
     }
 
     void IMU_typeC::AHRS_update(float* quat, float time, float* gyro, float* accel, float* mag) {
-        UNUSED(time);
-
         if (useMag_) {
-            MahonyAHRSupdate(quat, gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2], mag[0],
-                             mag[1], mag[2]);
+            mahony_.Update(gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2], mag[0], mag[1],
+                           mag[2], time);
         } else {
-            MahonyAHRSupdateIMU(quat, gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2]);
+            mahony_.Update(gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2], time);
         }
+        mahony_.GetQuaternion(quat);
     }
 
     void IMU_typeC::GetAngle(float* q, float* yaw, float* pitch, float* roll) {
-        *yaw =
-            atan2f(2.0f * (q[0] * q[3] + q[1] * q[2]), 2.0f * (q[0] * q[0] + q[1] * q[1]) - 1.0f);
-        *pitch = asinf(-2.0f * (q[1] * q[3] - q[0] * q[2]));
-        *roll =
-            atan2f(2.0f * (q[0] * q[1] + q[2] * q[3]), 2.0f * (q[0] * q[0] + q[3] * q[3]) - 1.0f);
+        *yaw = fast_atan2f(2.0f * (q[0] * q[3] + q[1] * q[2]),
+                           2.0f * (q[0] * q[0] + q[1] * q[1]) - 1.0f);
+        *pitch = fast_asinf(-2.0f * (q[1] * q[3] - q[0] * q[2]));
+        *roll = fast_atan2f(2.0f * (q[0] * q[1] + q[2] * q[3]),
+                            2.0f * (q[0] * q[0] + q[3] * q[3]) - 1.0f);
     }
 
     float IMU_typeC::TempControl(float real_temp) {
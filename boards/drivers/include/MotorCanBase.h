@@ -22,10 +22,16 @@
 #include <unordered_map>
 
 #include "MotorBase.h"
+#include "adrc.h"
+#include "autotune.h"
 #include "bsp_can.h"
 #include "bsp_thread.h"
 #include "connection_driver.h"
+#include "encoder.h"
+#include "fixed_point.h"
 #include "pid.h"
+#include "pid_bank.h"
+#include "trajectory.h"
 #include "utils.h"
 
 #define M3508P19_MAX_OUTPUT 12000.0f
@@ -204,6 +210,103 @@ namespace driver {
          */
         virtual void ReInitPID(control::ConstrainedPID::PID_Init_t pid_init, uint8_t mode);
 
+        /**
+         * @brief 设置电机PID参数整定时的控制周期
+         * @param period 整定周期，单位为 [s]，为0时关闭
+         * @param mode 所需要设置的pid的环，可以同时设置速度环和角度环
+         * @note 设置后，pid的积分和微分项按后台线程实际测得的周期缩放，SetFrequency()改变输出
+         * 频率或者osDelay抖动时闭环响应保持不变
+         */
+        void SetPIDControlPeriod(float period, uint8_t mode);
+
+        /**
+         * @brief 将电机的速度环交给所有电机共享的批量PID控制器组计算
+         * @param pid_init 速度环pid的初始化参数
+         * @note 后台线程会先收集所有电机的目标值和反馈值，再一次性计算所有的速度环。
+         * 角度环仍然使用每个电机自己的pid。批量PID不支持堵转检测和按时间间隔缩放：pid_init
+         * 开启了ErrorHandle或者速度环调用过SetPIDControlPeriod()时，速度环仍由电机自己的pid计算
+         */
+        void EnableBatchedPID(control::ConstrainedPID::PID_Init_t pid_init);
+
+        /**
+         * @brief 使用S型轨迹生成器平滑电机的目标值
+         * @param limit 轨迹的速度、加速度和加加速度限制，单位与电机的目标值一致
+         * @note 启用角度环时，SetTarget()设置的角度会经过轨迹生成器后再交给角度环，
+         * 轨迹的速度作为前馈加在速度环的目标上；只启用速度环时，只限制目标速度的加速度和加加速度
+         */
+        void EnableTrajectory(control::trajectory_limit_t limit);
+
+        /**
+         * @brief 获取轨迹生成器的当前状态，没有启用轨迹生成器时返回全0
+         */
+        control::trajectory_state_t GetTrajectoryState() const;
+
+        /**
+         * @brief 开始继电器反馈自整定
+         * @param init 自整定参数，setpoint为速度环的目标角速度[rad/s]或角度环的目标角度[rad]，
+         * amplitude为继电器输出的幅值，整定速度环时为电流值，整定角度环时为角速度[rad/s]。
+         * period会被设置为电机的控制周期
+         * @param mode 需要整定的环，OMEGA或THETA。整定角度环前需要先整定好速度环
+         * @note 整定期间电机会围绕setpoint持续振荡，请确保机构有足够的活动空间。
+         * 整定结束后自动恢复原来的控制，通过GetAutoTuner()获取结果
+         */
+        void StartAutoTune(control::relay_tune_init_t init, uint8_t mode);
+
+        /**
+         * @brief 停止自整定，恢复原来的控制
+         */
+        void StopAutoTune();
+
+        /**
+         * @brief 判断是否正在自整定
+         */
+        bool IsAutoTuning() const;
+
+        /**
+         * @brief 获取最近一次自整定的整定器，用于读取状态和结果，从未整定过时返回nullptr
+         */
+        const control::RelayAutoTuner* GetAutoTuner() const;
+
+        /**
+         * @brief 将最近一次成功的自整定结果按照给定规则应用到被整定的环上
+         * @param rule 整定规则
+         * @param max_iout 积分输出限制
+         * @param max_out 输出限制
+         */
+        void ApplyAutoTune(control::RelayAutoTuner::tune_rule_t rule, float max_iout,
+                           float max_out);
+
+        /**
+         * @brief 使用自抗扰控制器代替PID
+         * @param init 控制器参数，order会根据mode设置，b0的单位为[rad/s^2]每单位电流输出
+         * @param mode OMEGA：一阶ADRC代替速度环PID；THETA：二阶ADRC直接从角度计算电流，
+         * 代替角度环和速度环PID，轨迹生成器的速度作为目标角度的变化率
+         * @note SetSpeedOffset()设置的偏移量仍然有效，二阶时作为目标角度的变化率
+         */
+        void EnableADRC(control::adrc_init_t init, uint8_t mode);
+
+        /**
+         * @brief 停止使用自抗扰控制器，恢复PID控制
+         */
+        void DisableADRC();
+
+        /**
+         * @brief 获取自抗扰控制器，用于读取扰动估计，没有启用时返回nullptr
+         */
+        const control::ADRC* GetADRC() const;
+
+        /**
+         * @brief 使用外部测量的角速度(例如陀螺仪)作为速度环的反馈，代替编码器的速度
+         * @param omega 角速度，单位为[rad/s]，方向与输出轴一致
+         * @note 调用一次后一直生效，需要持续更新，直到调用ResetOmegaFeedback()
+         */
+        void SetOmegaFeedback(float omega);
+
+        /**
+         * @brief 恢复使用编码器的速度作为速度环的反馈
+         */
+        void ResetOmegaFeedback();
+
         /**
          * @brief 获取电机PID数值
          */
@@ -232,6 +335,15 @@ namespace driver {
          */
         friend class ServoMotor;
 
+        /**
+         * @brief 设置FlyWheelMotor为MotorCANBase的友元，它的速度环直接使用原始转速读数
+         */
+        /**
+         * @brief set FlyWheelMotor as friend of MotorCANBase, its speed loop runs directly on the
+         *        raw speed readings
+         */
+        friend class FlyWheelMotor;
+
         /**
          * @brief 使能电机
          */
@@ -306,13 +418,11 @@ namespace driver {
 
         // angle control
         volatile float align_angle_ = 0; /* 对齐角度，开机时的角度，单位为[rad] */
-        volatile float motor_angle_ = 0; /* 当前电机相比于开机的角度的旋转的角度，单位为[rad] */
-        volatile float offset_angle_ = 0; /* cumulative offset angle of motor shaft, range between
-                                                    [0, 2PI] in [rad] */
-        volatile float servo_angle_ = 0; /* 电机输出轴的角度，单位为[rad]，范围为[0, 2PI] */
-        volatile float cumulated_angle_ = 0;     /* 累积角度，单位为[rad] */
-        FloatEdgeDetector* inner_wrap_detector_; /* detect motor motion across encoder boarder */
-        FloatEdgeDetector* outer_wrap_detector_; /* detect motor motion across encoder boarder */
+        int16_t raw_theta_ = 0;          /* 编码器的原始读数，由子类在每帧中更新 */
+        int16_t raw_omega_ = 0;          /* 转速的原始读数，由子类在每帧中更新 */
+        float raw_omega_scale_ = 2 * PI / 60; /* 原始转速读数到[rad/s]的换算系数 */
+        bool encoder_ready_ = false;     /* 多圈计数是否已经从第一帧开始 */
+        control::MultiTurnEncoder encoder_; /* 输出轴的多圈计数 */
 
         float transmission_ratio_ = 1; /* 电机的减速比例 */
 
@@ -329,6 +439,18 @@ namespace driver {
         uint8_t mode_ = 0;
         control::ConstrainedPID omega_pid_;
         control::ConstrainedPID theta_pid_;
+        int bank_slot_ = -1; /* 速度环在批量PID中的编号，-1表示未使用 */
+        control::TrajectoryGenerator* trajectory_ = nullptr; /* 目标值的轨迹生成器 */
+        bool trajectory_ready_ = false; /* 轨迹生成器是否已经从电机的当前状态开始 */
+        control::RelayAutoTuner* tuner_ = nullptr; /* 继电器自整定 */
+        uint8_t tune_loop_ = NONE;                  /* 被整定的环 */
+        bool tuning_ = false;                       /* 是否正在自整定 */
+        control::ADRC* adrc_ = nullptr;  /* 代替PID的自抗扰控制器 */
+        uint8_t adrc_loop_ = NONE;       /* 自抗扰控制器代替的环 */
+        bool omega_feedback_ready_ = false; /* 是否使用外部的速度反馈 */
+        float omega_feedback_ = 0;          /* 外部的速度反馈，单位为[rad/s] */
+        /* 计算输出的实际周期，名义周期由delay_time决定 */
+        PeriodTimer output_period_{0.001f, 0.01f};
         float target_;
 
         float speed_offset_;  // 前馈中使用，在角度环输出的速度上加上一个偏移量
@@ -349,6 +471,11 @@ namespace driver {
          */
         static void TransmitOutput(MotorCANBase* motors[], uint8_t num_motors);
 
+        // 清空角度环和速度环的积分项 / clear the integral terms of both loops
+        void ResetIntegrals();
+        // 批量PID的这一路暂不使用时给它零误差的输入 / feed an unused bank slot a zero error
+        void IdleBankSlot();
+
         static const int16_t MAX_OUT = 32767;
 
         static bool is_init_;
@@ -373,6 +500,7 @@ namespace driver {
         static MotorCANBase* motors_[10][4];
         static uint8_t motor_cnt_[10];
         static uint32_t delay_time;
+        static control::PIDBank* pid_bank_;
 
         static callback_t pre_output_callback_;
         static void* pre_output_callback_instance_;
@@ -1081,6 +1209,7 @@ namespace driver {
         bool is_inverted_;
         float max_speed_;
         float target_speed_;
-        control::PIDController omega_pid_;
+        int32_t target_raw_omega_ = 0; /* 目标速度，单位与电机的原始转速读数相同 */
+        control::MotorPID omega_pid_;  /* 以原始转速读数为单位的速度环 */
     };
 }  // namespace driver
@@ -23,6 +23,7 @@
 #include "bsp_error_handler.h"
 #include "bsp_thread.h"
 #include "bsp_uart.h"
+#include "clock_sync.h"
 #include "connection_driver.h"
 #include "dbus_package.h"
 
@@ -602,6 +603,7 @@ namespace communication {
         NO_TARGET_FLAG = 0x0403,
         SHOOT_CMD = 0x0404,
         ROBOT_MOVE_SPEED = 0x0405,
+        TIME_SYNC = 0x0406,
         ROBOT_POWER_HEAT_HP_UPLOAD = 0x0501,
         GIMBAL_CURRENT_STATUS = 0x0502,
         CHASSIS_CURRENT_STATUS = 0x0503,
@@ -623,6 +625,7 @@ namespace communication {
         float target_yaw;
         uint8_t accuracy;  // 置信度 0-100
         uint8_t shoot_cmd;
+        uint64_t capture_time;  // 图像的拍摄时间，上位机单调时钟[us]，旧版上位机不发送，为0
     } __packed target_angle_t;
 
     /* ===== NO_TARGET_FLAG 0x0403 ===== */
@@ -645,6 +648,14 @@ namespace communication {
         float target_turn;
     } __packed robot_move_t;
 
+    /* ===== TIME_SYNC 0x0406 ===== */
+    // MCU发出时只填mcu_request，上位机原样返回并填上自己单调时钟的收发时间，单位均为[us]
+    typedef struct {
+        uint64_t mcu_request;  // MCU发出请求的时间
+        uint64_t pc_receive;   // 上位机收到请求的时间
+        uint64_t pc_transmit;  // 上位机发出回复的时间
+    } __packed time_sync_t;
+
     /* ===== ROBOT_POWER_HEAT_HP_UPLOAD 0x0501 20Hz ===== */
     typedef struct {
         uint8_t robot_id;
@@ -665,6 +676,7 @@ namespace communication {
         float current_imu_yaw;
         uint8_t robot_id;
         uint8_t shooter_id;
+        uint64_t timestamp;  // 姿态的采样时间，换算到上位机单调时钟[us]，时钟未同步时为0
     } __packed gimbal_current_status_t;
 
     /* ===== CHASSIS_CURRENT_STATUS 0x0503 100Hz ===== */
@@ -731,9 +743,13 @@ namespace communication {
         Host(bsp::UART* uart);
         pack_t pack{};
         target_angle_t target_angle{};
+        uint64_t target_angle_timestamp = 0;  // 收到target_angle的时间，单位为[us]
+        uint64_t target_angle_capture = 0;  // 拍摄时间换算到MCU时钟[us]，无法换算时为0
         no_target_flag_t no_target_flag{};
         shoot_cmd_t shoot_cmd{};
         robot_move_t robot_move{};
+        time_sync_t time_sync{};
+        control::ClockSync clock_sync;
         robot_power_heat_hp_upload_t robot_power_heat_hp_upload{};
         gimbal_current_status_t gimbal_current_status{};
         chassis_current_status_t chassis_current_status{};
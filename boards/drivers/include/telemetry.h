@@ -0,0 +1,245 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#pragma once
+
+#include "bsp_thread.h"
+#include "bsp_uart.h"
+#include "bsp_usb.h"
+#include "main.h"
+
+namespace communication {
+
+    constexpr int TELEMETRY_MAX_CHANNEL = 32;   /* one bit per channel in the sample mask */
+    constexpr int TELEMETRY_MAX_NAME_LEN = 24;  /* longer channel names are truncated */
+    constexpr int TELEMETRY_MAX_FRAME_LEN =
+        4 + 8 + TELEMETRY_MAX_CHANNEL * 4 + 2; /* header + index / mask + values + crc16 */
+
+    /**
+     * @brief 遥测通道的数据类型
+     */
+    /**
+     * @brief data type of a telemetry channel, keep in sync with tools/telemetry_receiver.py
+     */
+    typedef enum : uint8_t {
+        TELEMETRY_FLOAT = 0,
+        TELEMETRY_INT32 = 1,
+        TELEMETRY_UINT32 = 2,
+        TELEMETRY_INT16 = 3,
+        TELEMETRY_UINT16 = 4,
+        TELEMETRY_INT8 = 5,
+        TELEMETRY_UINT8 = 6,
+    } telemetry_type_t;
+
+    /**
+     * @brief 遥测通道的取值回调函数
+     */
+    /**
+     * @brief getter used by channels that are not backed by a plain variable
+     */
+    typedef float (*telemetry_getter_t)(void* args);
+
+    /**
+     * @brief 遥测初始化参数，uart和usb只需设置一个
+     */
+    /**
+     * @brief telemetry initialization parameters, only one of uart / usb needs to be set
+     */
+    typedef struct {
+        bsp::UART* uart;
+#ifndef NO_USB
+        bsp::VirtualUSB* usb;
+#endif
+        uint32_t sample_period_us; /* period between two calls to Sample(), reported to the host */
+    } telemetry_init_t;
+
+    /**
+     * @brief 高速结构化遥测
+     * @details 各模块注册带类型的通道（变量地址或取值回调），每次调用Sample()时，
+     * 按各通道的降采样倍数将数值打包成二进制帧，通过USB虚拟串口或串口发出，
+     * 主机端使用 tools/telemetry_receiver.py 接收并保存为CSV
+     */
+    /**
+     * @brief high rate structured telemetry
+     * @details modules register typed channels (address of a variable or a getter callback). Every
+     * call to Sample() packs the channels that are due according to their decimation into one
+     * binary frame and writes it to the usb virtual com port or uart. The host side receiver is
+     * tools/telemetry_receiver.py, which writes the stream into a CSV file.
+     *
+     * frame layout (little endian):
+     *      0x55 0xAA | u8 frame type | u8 payload length | payload | crc16 over everything before
+     * sample payload:
+     *      u32 sample index | u32 channel mask | values of the channels in the mask, in id order
+     * schema payload (one channel per frame, trickled between samples so late hosts can join):
+     *      u8 id | u8 type | u16 decimation | u32 sample period [us] | name
+     */
+    class Telemetry {
+      public:
+        /**
+         * @brief 构造函数
+         * @param init 初始化结构体
+         */
+        /**
+         * @brief constructor
+         * @param init initialization structure
+         */
+        explicit Telemetry(telemetry_init_t init);
+
+        /**
+         * @brief 注册一个变量通道
+         *
+         * @param name       通道名称，必须为常量字符串
+         * @param source     变量地址
+         * @param decimation 降采样倍数，每调用decimation次Sample()发送一次
+         *
+         * @return 通道编号，失败返回-1
+         */
+        /**
+         * @brief register a channel backed by a variable
+         *
+         * @param name       channel name, must outlive the telemetry instance (string literal)
+         * @param source     address of the variable
+         * @param decimation channel is sent once every decimation calls to Sample()
+         *
+         * @return channel id, -1 if the channel table is full
+         */
+        int AddChannel(const char* name, const float* source, uint16_t decimation = 1);
+        int AddChannel(const char* name, const int32_t* source, uint16_t decimation = 1);
+        int AddChannel(const char* name, const uint32_t* source, uint16_t decimation = 1);
+        int AddChannel(const char* name, const int16_t* source, uint16_t decimation = 1);
+        int AddChannel(const char* name, const uint16_t* source, uint16_t decimation = 1);
+        int AddChannel(const char* name, const int8_t* source, uint16_t decimation = 1);
+        int AddChannel(const char* name, const uint8_t* source, uint16_t decimation = 1);
+
+        /**
+         * @brief 注册一个回调通道，例如电机角度或PID状态
+         *
+         * @param name       通道名称，必须为常量字符串
+         * @param getter     取值回调函数
+         * @param args       回调函数参数
+         * @param decimation 降采样倍数
+         *
+         * @return 通道编号，失败返回-1
+         */
+        /**
+         * @brief register a channel backed by a getter, e.g. motor theta or a PID state term
+         *
+         * @param name       channel name, must outlive the telemetry instance (string literal)
+         * @param getter     callback that returns the current value
+         * @param args       argument passed to the getter
+         * @param decimation channel is sent once every decimation calls to Sample()
+         *
+         * @return channel id, -1 if the channel table is full
+         */
+        int AddChannel(const char* name, telemetry_getter_t getter, void* args,
+                       uint16_t decimation = 1);
+
+        /**
+         * @brief 打开或关闭一个通道
+         */
+        /**
+         * @brief enable or disable a channel without unregistering it
+         */
+        void Enable(int id, bool enable);
+
+        /**
+         * @brief 采样并发送一帧，可在控制循环中以1~2kHz调用
+         */
+        /**
+         * @brief sample due channels and send one frame, meant to be called from the control loop
+         * at up to 1-2 kHz
+         */
+        void Sample();
+
+        /**
+         * @brief 创建一个低优先级任务，周期性调用Sample()
+         * @param period_ms 采样周期，单位为 [ms]
+         * @note 受RTOS节拍限制最高1kHz，更高频率请在控制循环中直接调用Sample()
+         */
+        /**
+         * @brief create a task that calls Sample() periodically
+         * @param period_ms sample period in [ms]
+         * @note limited to 1 kHz by the RTOS tick, call Sample() from the control loop for higher
+         * rates
+         */
+        void Start(uint32_t period_ms);
+
+        /**
+         * @brief 估算当前通道配置所需的带宽
+         * @return 带宽，单位为 [bytes/s]
+         */
+        /**
+         * @brief estimate the link bandwidth needed by the current channel set
+         * @return bandwidth in [bytes/s]
+         */
+        float Bandwidth() const;
+
+        /**
+         * @brief 获取因发送缓冲区满而未完整发出的帧数
+         */
+        /**
+         * @brief number of frames that did not fit into the transmit buffer
+         */
+        uint32_t GetOverrun() const;
+
+      private:
+        typedef struct {
+            const char* name;
+            telemetry_type_t type;
+            const void* source;
+            telemetry_getter_t getter;
+            void* args;
+            uint16_t decimation;
+            bool enabled;
+        } channel_t;
+
+        int AddChannel(const char* name, telemetry_type_t type, const void* source,
+                       telemetry_getter_t getter, void* args, uint16_t decimation);
+        void SendSchema(int id);
+        void Send(uint8_t type, uint32_t payload_length);
+
+        bsp::UART* uart_ = nullptr;
+#ifndef NO_USB
+        bsp::VirtualUSB* usb_ = nullptr;
+#endif
+        uint32_t sample_period_us_;
+
+        channel_t channels_[TELEMETRY_MAX_CHANNEL];
+        int channel_num_ = 0;
+        uint32_t index_ = 0;
+        uint32_t overrun_ = 0;
+        uint8_t frame_[TELEMETRY_MAX_FRAME_LEN];
+
+        bsp::Thread* thread_ = nullptr;
+        uint32_t period_ms_ = 1;
+        static void ThreadFunc(void* args);
+
+        const osThreadAttr_t thread_attr_ = {.name = "TelemetryTask",
+                                             .attr_bits = osThreadDetached,
+                                             .cb_mem = nullptr,
+                                             .cb_size = 0,
+                                             .stack_mem = nullptr,
+                                             .stack_size = 256 * 4,
+                                             .priority = (osPriority_t)osPriorityBelowNormal,
+                                             .tz_module = 0,
+                                             .reserved = 0};
+    };
+
+}  // namespace communication
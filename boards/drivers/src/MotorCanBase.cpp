@@ -29,6 +29,9 @@ using namespace bsp;
 
 namespace driver {
 
+    // 大疆电机编码器转一圈的刻度数 / ticks per revolution of the DJI motor encoders
+    static constexpr int32_t ENCODER_RESOLUTION = 8192;
+
     /**
      * @brief standard can motor callback, used to update motor data
      *
@@ -48,6 +51,7 @@ namespace driver {
     uint8_t MotorCANBase::motor_cnt_[10] = {0};
     bsp::Thread* MotorCANBase::can_motor_thread_ = nullptr;
     uint32_t MotorCANBase::delay_time = 1;
+    control::PIDBank* MotorCANBase::pid_bank_ = nullptr;
 
     MotorCANBase::callback_t MotorCANBase::pre_output_callback_ = [](void* args) { UNUSED(args); };
     MotorCANBase::callback_t MotorCANBase::post_output_callback_ = [](void* args) { UNUSED(args); };
@@ -122,12 +126,6 @@ namespace driver {
         theta_pid_ = control::ConstrainedPID();
 
         align_angle_ = -1;  // Wait for Update to initialize
-        motor_angle_ = 0;
-        offset_angle_ = 0;
-        servo_angle_ = 0;
-        cumulated_angle_ = 0;
-        inner_wrap_detector_ = new FloatEdgeDetector(0, PI);
-        outer_wrap_detector_ = new FloatEdgeDetector(0, PI);
 
         target_ = 0;
 
@@ -193,6 +191,20 @@ namespace driver {
                     motors_[i][j]->CalcOutput();
                 }
             }
+            if (pid_bank_) {
+                // 一次性计算所有使用批量PID的速度环，再写回各个电机
+                pid_bank_->Update();
+                for (uint8_t i = 0; i < group_cnt_; i++) {
+                    for (uint8_t j = 0; j < motor_cnt_[i]; j++) {
+                        MotorCANBase* motor = motors_[i][j];
+                        // 速度环自整定时由继电器直接输出，启用ADRC时由ADRC输出
+                        if (motor->bank_slot_ >= 0 && motor->enable_ && motor->mode_ & OMEGA &&
+                            !(motor->tuning_ && motor->tune_loop_ & OMEGA) &&
+                            motor->adrc_ == nullptr)
+                            motor->SetOutput((int16_t)pid_bank_->Output(motor->bank_slot_));
+                    }
+                }
+            }
             pre_output_callback_(pre_output_callback_instance_);
             for (uint8_t i = 0; i < group_cnt_; i++) {
                 // 输出电机指令
@@ -238,14 +250,87 @@ namespace driver {
         }
     }
     void MotorCANBase::CalcOutput() {
+        // 按实际的时间间隔计算，补偿osDelay的抖动；时间戳不可用或者线程被挂起过时按名义周期计算。
+        // 只有调用过SetPIDControlPeriod()的pid才会使用dt
+        const float period = delay_time * 0.001f;
+        output_period_.SetPeriod(period, period * 10);
+        const float dt = output_period_.Update(GetHighresTickMicroSec());
         if (!enable_) {
             // 如果电机被禁用，则清空PID积分项并输出0
             SetOutput(0);
             theta_pid_.ResetIntegral();
             omega_pid_.ResetIntegral();
+            if (bank_slot_ >= 0)
+                IdleBankSlot();
+            if (adrc_ != nullptr)
+                adrc_->Reset();
+            trajectory_ready_ = false;
             return;
         }
         float output = target_;
+        if (tuning_ && tuner_->State() != control::RelayAutoTuner::RUNNING) {
+            // 整定结束，从清空的积分项开始恢复正常的控制
+            tuning_ = false;
+            ResetIntegrals();
+        }
+        if (tuning_) {
+            trajectory_ready_ = false;
+            if (tune_loop_ & OMEGA) {
+                // 速度环整定，继电器直接输出电流，批量PID的这一路不能继续积分
+                if (bank_slot_ >= 0)
+                    IdleBankSlot();
+                SetOutput((int16_t)tuner_->Update(GetOutputShaftOmega()));
+                return;
+            }
+            // 角度环整定，继电器的输出作为速度环的目标
+            output = tuner_->Update(GetOutputShaftTheta());
+            if (bank_slot_ >= 0) {
+                pid_bank_->SetInput(bank_slot_, output, GetOutputShaftOmega());
+                return;
+            }
+            SetOutput((int16_t)omega_pid_.ComputeOutput(output, GetOutputShaftOmega(), dt));
+            return;
+        }
+        float feedforward = 0;
+        if (trajectory_ != nullptr) {
+            if (mode_ & THETA) {
+                if (!trajectory_ready_)
+                    trajectory_->Reset(GetOutputShaftTheta(), GetOutputShaftOmega());
+                float goal = output;
+                if (mode_ & ABSOLUTE) {
+                    // 绝对角度模式下朝最近的等价角度运动
+                    const float position = trajectory_->State().position;
+                    goal = position + wrap<float>(output - position, -PI, PI);
+                }
+                const control::trajectory_state_t state = trajectory_->Update(goal, dt);
+                output = state.position;
+                feedforward = state.velocity;
+                if ((mode_ & ABSOLUTE) && abs(output) > PI) {
+                    output = wrap<float>(output, -PI, PI);
+                    trajectory_->Reset(output, state.velocity, state.acceleration);
+                }
+            } else if (mode_ & OMEGA) {
+                if (!trajectory_ready_)
+                    trajectory_->Reset(0, GetOutputShaftOmega());
+                output = trajectory_->UpdateVelocity(output, dt).velocity;
+            }
+            trajectory_ready_ = true;
+        }
+        // 速度环的反馈，可以由外部的陀螺仪提供
+        const float omega = omega_feedback_ready_ ? omega_feedback_ : GetOutputShaftOmega();
+        if (adrc_ != nullptr && adrc_loop_ & THETA && mode_ & THETA) {
+            // 二阶ADRC直接从角度计算电流，速度偏移量和轨迹的速度作为目标角度的变化率
+            const float theta = GetOutputShaftTheta();
+            if (mode_ & ABSOLUTE && abs(output - theta) > PI) {
+                output = output > theta ? output - 2 * PI : output + 2 * PI;
+            }
+            const float rate = speed_offset_ + feedforward;
+            // ADRC取代了速度环，批量PID的这一路不能继续用旧的输入积分
+            if (bank_slot_ >= 0)
+                IdleBankSlot();
+            SetOutput((int16_t)adrc_->ComputeOutput(output, rate, theta, dt));
+            return;
+        }
         if (mode_ & THETA) {
             // 如果电机启动了角度环PID，则计算角度环PID输出
             float theta = GetOutputShaftTheta();
@@ -255,14 +340,24 @@ namespace driver {
                     // 超过半圈，反方向走
                     output = output > theta ? output - 2 * PI : output + 2 * PI;
                 }
-                output = theta_pid_.ComputeOutput(output, theta);
+                output = theta_pid_.ComputeOutput(output, theta, dt);
             } else {
-                output = theta_pid_.ComputeOutput(output, theta);
+                output = theta_pid_.ComputeOutput(output, theta, dt);
             }
         }
         if (mode_ & OMEGA) {
-            output += speed_offset_;
-            output = omega_pid_.ComputeOutput(output, GetOutputShaftOmega());
+            output += speed_offset_ + feedforward;
+            if (adrc_ != nullptr && adrc_loop_ & OMEGA) {
+                if (bank_slot_ >= 0)
+                    IdleBankSlot();
+                output = adrc_->ComputeOutput(output, omega, dt);
+            } else if (bank_slot_ >= 0) {
+                // 速度环由后台线程中的批量PID统一计算，这里只收集目标值和反馈值
+                pid_bank_->SetInput(bank_slot_, output, omega);
+                return;
+            } else {
+                output = omega_pid_.ComputeOutput(output, omega, dt);
+            }
         }
         if (mode_ != NONE) {
             SetOutput((int16_t)output);
@@ -271,12 +366,132 @@ namespace driver {
     void MotorCANBase::ReInitPID(control::ConstrainedPID::PID_Init_t pid_init, uint8_t mode) {
         if (mode & OMEGA) {
             omega_pid_.Reinit(pid_init);
+            if (bank_slot_ >= 0) {
+                RM_ASSERT_FALSE(pid_init.mode & control::ConstrainedPID::ErrorHandle,
+                                "Batched PID does not support ErrorHandle");
+                pid_bank_->Reinit(bank_slot_, pid_init);
+            }
         } else if (mode & THETA) {
             theta_pid_.Reinit(pid_init);
         }
     }
+    void MotorCANBase::SetPIDControlPeriod(float period, uint8_t mode) {
+        if (mode & OMEGA) {
+            RM_ASSERT_FALSE(bank_slot_ >= 0 && period > 0, "Batched PID does not scale by dt");
+            omega_pid_.SetControlPeriod(period);
+        }
+        if (mode & THETA) {
+            theta_pid_.SetControlPeriod(period);
+        }
+    }
+    void MotorCANBase::EnableBatchedPID(control::ConstrainedPID::PID_Init_t pid_init) {
+        // 批量PID没有堵转检测，也不按时间间隔缩放，需要这两项功能时继续使用电机自己的pid
+        omega_pid_.Reinit(pid_init);
+        if (pid_init.mode & control::ConstrainedPID::ErrorHandle ||
+            omega_pid_.GetControlPeriod() > 0) {
+            RM_ASSERT_TRUE(bank_slot_ < 0, "Batched PID does not support this configuration");
+            return;
+        }
+        if (bank_slot_ >= 0) {
+            pid_bank_->Reinit(bank_slot_, pid_init);
+            return;
+        }
+        if (pid_bank_ == nullptr)
+            pid_bank_ = new control::PIDBank();
+        const int slot = pid_bank_->Add(pid_init);
+        RM_ASSERT_GE(slot, 0, "Too many motors using the batched PID");
+        bank_slot_ = slot;
+    }
+    void MotorCANBase::EnableTrajectory(control::trajectory_limit_t limit) {
+        if (trajectory_ != nullptr) {
+            trajectory_->SetLimit(limit);
+            return;
+        }
+        trajectory_ = new control::TrajectoryGenerator(limit);
+        trajectory_ready_ = false;
+    }
+    control::trajectory_state_t MotorCANBase::GetTrajectoryState() const {
+        if (trajectory_ == nullptr)
+            return control::trajectory_state_t();
+        return trajectory_->State();
+    }
+    void MotorCANBase::EnableADRC(control::adrc_init_t init, uint8_t mode) {
+        RM_ASSERT_TRUE(mode == OMEGA || mode == THETA, "ADRC replaces either loop");
+        init.order = mode == THETA ? 2 : 1;
+        if (adrc_ != nullptr && adrc_loop_ == mode) {
+            adrc_->Reinit(init);
+            return;
+        }
+        if (adrc_ != nullptr)
+            delete adrc_;
+        adrc_ = new control::ADRC(init);
+        adrc_loop_ = mode;
+    }
+    void MotorCANBase::DisableADRC() {
+        if (adrc_ != nullptr)
+            delete adrc_;
+        adrc_ = nullptr;
+        adrc_loop_ = NONE;
+        // 切换回PID时从零开始积分
+        theta_pid_.ResetIntegral();
+        omega_pid_.ResetIntegral();
+        if (bank_slot_ >= 0)
+            pid_bank_->ResetIntegral(bank_slot_);
+    }
+    const control::ADRC* MotorCANBase::GetADRC() const {
+        return adrc_;
+    }
+    void MotorCANBase::SetOmegaFeedback(float omega) {
+        omega_feedback_ = omega;
+        omega_feedback_ready_ = true;
+    }
+    void MotorCANBase::ResetOmegaFeedback() {
+        omega_feedback_ready_ = false;
+    }
+    void MotorCANBase::StartAutoTune(control::relay_tune_init_t init, uint8_t mode) {
+        RM_ASSERT_TRUE(mode == OMEGA || mode == THETA, "Auto tune one loop at a time");
+        RM_ASSERT_TRUE(mode_ & OMEGA, "Auto tuning needs the speed loop");
+        // 继电器的周期必须和电机的控制周期一致
+        init.period = delay_time * 0.001f;
+        if (tuner_ != nullptr)
+            delete tuner_;
+        tuner_ = new control::RelayAutoTuner(init);
+        tune_loop_ = mode;
+        ResetIntegrals();
+        tuning_ = true;
+    }
+    void MotorCANBase::StopAutoTune() {
+        tuning_ = false;
+        ResetIntegrals();
+    }
+    void MotorCANBase::ResetIntegrals() {
+        theta_pid_.ResetIntegral();
+        omega_pid_.ResetIntegral();
+        if (bank_slot_ >= 0)
+            pid_bank_->ResetIntegral(bank_slot_);
+    }
+    void MotorCANBase::IdleBankSlot() {
+        // 后台线程仍会计算这一路批量PID，给它零误差的输入并清除状态，避免用旧的输入积分
+        const float omega = omega_feedback_ready_ ? omega_feedback_ : GetOutputShaftOmega();
+        pid_bank_->SetInput(bank_slot_, omega, omega);
+        pid_bank_->Reset(bank_slot_);
+    }
+    bool MotorCANBase::IsAutoTuning() const {
+        return tuning_;
+    }
+    const control::RelayAutoTuner* MotorCANBase::GetAutoTuner() const {
+        return tuner_;
+    }
+    void MotorCANBase::ApplyAutoTune(control::RelayAutoTuner::tune_rule_t rule, float max_iout,
+                                     float max_out) {
+        if (tuner_ == nullptr || tuner_->State() != control::RelayAutoTuner::SUCCESS)
+            return;
+        ReInitPID(tuner_->Gains(rule, max_iout, max_out), tune_loop_);
+    }
     control::ConstrainedPID::PID_State_t MotorCANBase::GetPIDState(uint8_t mode) const {
         if (mode & OMEGA && mode_ & OMEGA) {
+            if (bank_slot_ >= 0)
+                return pid_bank_->State(bank_slot_);
             return omega_pid_.State();
         } else if (mode & THETA && mode_ & THETA) {
             return theta_pid_.State();
@@ -290,51 +505,20 @@ namespace driver {
     void MotorCANBase::UpdateData(const uint8_t* data) {
         UNUSED(data);
 
-        // 角度速度环控制且非绝对控制模式时，需要使用统计总角度值
-        // 获取初始化时的角度值
-        if (align_angle_ < 0)
-            align_angle_ = theta_;
-
-        // 如果电机角度从接近 2PI 跳到接近
-        // 0，则回绕检测器将检测到下降沿，这意味着电机在穿过编码器边界时正向正方向转动。
-        // 反之亦然，电机角度从接近 0 跃升至接近 2PI
-
-        motor_angle_ = theta_ - align_angle_;
-        if (transmission_ratio_ != 1) {
-            // 获得实际的电机屁股角度
-            inner_wrap_detector_->input(motor_angle_);
-            // 输入电机屁股的角度到边界检测器
-            if (inner_wrap_detector_->negEdge())
-                // 检测到下降沿，代表电机正向转动了一整圈
-                offset_angle_ =
-                    wrap<float>(offset_angle_ + 2 * PI / transmission_ratio_, 0, 2 * PI);
-            // 更新实际的输出轴角度偏差
-            else if (inner_wrap_detector_->posEdge())
-                // 检测到上升沿，代表电机反向转动了一整圈
-                offset_angle_ =
-                    wrap<float>(offset_angle_ - 2 * PI / transmission_ratio_, 0, 2 * PI);
-            // 更新实际的输出轴角度偏差
-
-            servo_angle_ =
-                wrap<float>(offset_angle_ + motor_angle_ / transmission_ratio_, 0, 2 * PI);
+        // 第一帧确定零点：align_angle_小于0时以开机时的角度为零点，否则（绝对位置电机）
+        // 以align_angle_为零点
+        if (encoder_ready_) {
+            encoder_.Update(raw_theta_);
         } else {
-            servo_angle_ = wrap<float>(motor_angle_, 0, 2 * PI);
-        }
-        // 更新实际输出轴角度
-        outer_wrap_detector_->input(servo_angle_);
-        // 输入实际输出轴角度到边界检测器
-
-        // 绝对模式下不需要累积角度
-        if (!(mode_ & ABSOLUTE)) {
-            if (outer_wrap_detector_->negEdge())
-                cumulated_angle_ += 2 * PI;
-            // 检测到下降沿，代表电机输出轴正向转动了一整圈
-            else if (outer_wrap_detector_->posEdge())
-                cumulated_angle_ -= 2 * PI;
-            // 检测到上升沿，代表电机输出轴反向转动了一整圈
+            if (align_angle_ < 0)
+                align_angle_ = theta_;
+            const int32_t origin = (int32_t)(align_angle_ / (2 * PI) * ENCODER_RESOLUTION + 0.5f);
+            encoder_.Reset(raw_theta_, origin);
+            encoder_ready_ = true;
         }
 
-        output_shaft_theta_ = servo_angle_ + cumulated_angle_;
+        // 多圈计数全部是整数运算，每帧只在这里转换一次浮点数；绝对模式下只需要圈内的角度
+        output_shaft_theta_ = mode_ & ABSOLUTE ? encoder_.GetAngle() : encoder_.GetTheta();
         output_shaft_omega_ = omega_ / transmission_ratio_;
 
         if (mode_ & THETA) {
@@ -360,6 +544,7 @@ namespace driver {
         // 设置电机的传动比
         // 这里的传动比不是电机的实际传动比，而是电机与编码器的传动比
         transmission_ratio_ = ratio;
+        encoder_.SetRatio(ratio);
     }
     float MotorCANBase::GetOutputShaftTheta() const {
         return output_shaft_theta_;
@@ -433,6 +618,8 @@ namespace driver {
 
         constexpr float THETA_SCALE = 2 * PI / 8192;  // digital -> rad
         constexpr float OMEGA_SCALE = 2 * PI / 60;    // rpm -> rad / sec
+        raw_theta_ = raw_theta;
+        raw_omega_ = raw_omega;
         theta_ = raw_theta * THETA_SCALE;
         omega_ = raw_omega * OMEGA_SCALE;
 
@@ -477,6 +664,8 @@ namespace driver {
 
         constexpr float THETA_SCALE = 2 * PI / 8192;  // digital -> rad
         constexpr float OMEGA_SCALE = 2 * PI / 60;    // rpm -> rad / sec
+        raw_theta_ = raw_theta;
+        raw_omega_ = raw_omega;
         theta_ = raw_theta * THETA_SCALE;
         omega_ = raw_omega * OMEGA_SCALE;
 
@@ -517,6 +706,8 @@ namespace driver {
 
         constexpr float THETA_SCALE = 2 * PI / 8192;  // digital -> rad
         constexpr float OMEGA_SCALE = 2 * PI / 60;    // rpm -> rad / sec
+        raw_theta_ = raw_theta;
+        raw_omega_ = raw_omega;
         theta_ = raw_theta * THETA_SCALE;
         omega_ = raw_omega * OMEGA_SCALE;
 
@@ -545,6 +736,8 @@ namespace driver {
         : MotorCANBase(can, rx_id, tx_id) {
         // 绝对位置电机不需要初始化align_angle_
         align_angle_ = 0;
+        // 转速反馈的单位为0.01rpm
+        raw_omega_scale_ = 2 * PI / 60 / 100;
         can->RegisterRxCallback(rx_id, can_motor_callback, this);
     }
 
@@ -557,6 +750,8 @@ namespace driver {
 
         constexpr float THETA_SCALE = 2 * PI / 8192;      // digital -> rad
         constexpr float OMEGA_SCALE = 2 * PI / 60 / 100;  // rpm -> rad / sec
+        raw_theta_ = raw_theta;
+        raw_omega_ = raw_omega;
         theta_ = raw_theta * THETA_SCALE;
         omega_ = raw_omega * OMEGA_SCALE;
 
@@ -869,7 +1064,12 @@ namespace driver {
         max_speed_ = data.max_speed;
         target_speed_ = 0;
         is_inverted_ = data.is_inverted;
-        omega_pid_ = control::PIDController(data.omega_pid_param);
+        // 速度环以原始转速读数为单位，增益按读数的换算系数缩放，与以[rad/s]为单位时等价；
+        // 限幅与ClipMotorRange相同
+        const float scale = motor_->raw_omega_scale_;
+        const float* param = data.omega_pid_param;
+        omega_pid_ = control::MotorPID(param[0] * scale, param[1] * scale, param[2] * scale,
+                                       control::MOTOR_RANGE, control::MOTOR_RANGE);
     }
     void FlyWheelMotor::SetSpeed(float speed) {
         if (is_inverted_) {
@@ -877,10 +1077,11 @@ namespace driver {
         }
         speed = clip<float>(speed, -max_speed_, max_speed_);
         target_speed_ = speed;
+        // 只在设置目标时换算一次，CalcOutput中只有整数输入
+        target_raw_omega_ = control::fixed::FloatToFixed(speed / motor_->raw_omega_scale_, 0);
     }
     void FlyWheelMotor::CalcOutput() {
-        motor_->SetOutput(
-            omega_pid_.ComputeConstrainedOutput(motor_->GetOmegaDelta(target_speed_)));
+        motor_->SetOutput((int16_t)omega_pid_.ComputeOutput(target_raw_omega_, motor_->raw_omega_));
     }
     float FlyWheelMotor::GetTarget() const {
         if (is_inverted_) {
@@ -42,13 +42,27 @@ namespace driver {
         pwm_ = init.pwm;
         pwm_->Start();
         float* pid_param = init.pid_param;
-        float heater_I_limit = init.heater_I_limit;
-        float heater_output_limit = init.heater_output_limit;
-        pid_.Reinit(pid_param, heater_I_limit, heater_output_limit);
+        max_iout_ = init.heater_I_limit;
+        max_out_ = init.heater_output_limit;
+        pid_.Reinit(pid_param, max_iout_, max_out_);
+    }
+
+    void Heater::SetFeedforward(float gain) {
+        feedforward_gain_ = gain > 0 ? gain : 0;
+        feedforward_ = 0;
+        if (feedforward_gain_ > 0 && ambient_ready_)
+            feedforward_ = clip<float>((temp_ - ambient_) / feedforward_gain_, 0, max_out_);
+        // PID的限幅扣除前馈，积分抗饱和按实际的总输出判断
+        pid_.ChangeMax(fminf(max_iout_, max_out_ - feedforward_), max_out_ - feedforward_);
     }
 
     float Heater::Update(float real_temp) {
-        float output = pid_.ComputeOutput(temp_, real_temp);
+        if (!ambient_ready_) {
+            ambient_ = real_temp;
+            ambient_ready_ = true;
+            SetFeedforward(feedforward_gain_);
+        }
+        float output = pid_.ComputeOutput(temp_, real_temp) + feedforward_;
         output = output > 0 ? output : 0;
         if (real_temp > temp_ + 0.5)
             output = 0;
@@ -22,6 +22,7 @@
 
 #include <cstring>
 
+#include "bsp_os.h"
 #include "crc_check.h"
 
 static const uint8_t SOF = 0xA5;
@@ -30,27 +31,40 @@ static const int CMD_ID_LEN = 2;
 static const int FRAME_TAIL_LEN = 2;
 static const int BYTE = 8;
 
+// 复制收到的包，比结构体短时（例如旧版本的包没有新增的字段）剩下的部分清零，多余的数据丢弃
+static void CopyPacket(void* packet, int size, const uint8_t* data, int length) {
+    const int copied = length < size ? length : size;
+    memcpy(packet, data, copied);
+    memset((uint8_t*)packet + copied, 0, size - copied);
+}
+
 namespace communication {
 
     bool Protocol::Receive(package_t package) {
         Heartbeat();
-        memcpy(bufferRx, package.data, package.length);
-        int start_idx;
-        int end_idx = 0;
-        while (end_idx < package.length) {
-            start_idx = end_idx;
-            while (++end_idx < package.length && bufferRx[end_idx] != SOF)
-                ;
-            if (end_idx - start_idx > FRAME_HEADER_LEN + CMD_ID_LEN + FRAME_TAIL_LEN) {
-                int DATA_LENGTH = bufferRx[start_idx + 2] << BYTE | bufferRx[start_idx + 1];
-                if (VerifyHeader(bufferRx + start_idx, FRAME_HEADER_LEN) &&
-                    VerifyFrame(bufferRx + start_idx,
-                                FRAME_HEADER_LEN + CMD_ID_LEN + DATA_LENGTH + FRAME_TAIL_LEN)) {
-                    int cmd_id = bufferRx[start_idx + FRAME_HEADER_LEN + 1] << BYTE |
-                                 bufferRx[start_idx + FRAME_HEADER_LEN];
-                    ProcessDataRx(cmd_id, bufferRx + start_idx + FRAME_HEADER_LEN + CMD_ID_LEN,
-                                  DATA_LENGTH);
-                }
+        const int length = package.length < MAX_FRAME_LEN ? package.length : MAX_FRAME_LEN;
+        memcpy(bufferRx, package.data, length);
+        const int min_frame_len = FRAME_HEADER_LEN + CMD_ID_LEN + FRAME_TAIL_LEN;
+        int start_idx = 0;
+        while (start_idx + min_frame_len <= length) {
+            const uint8_t* sof = (const uint8_t*)memchr(bufferRx + start_idx, SOF,
+                                                        length - min_frame_len + 1 - start_idx);
+            if (sof == nullptr)
+                break;
+            start_idx = sof - bufferRx;
+            int DATA_LENGTH = bufferRx[start_idx + 2] << BYTE | bufferRx[start_idx + 1];
+            int frame_len = min_frame_len + DATA_LENGTH;
+            if (start_idx + frame_len <= length &&
+                VerifyHeader(bufferRx + start_idx, FRAME_HEADER_LEN) &&
+                VerifyFrame(bufferRx + start_idx, frame_len)) {
+                int cmd_id = bufferRx[start_idx + FRAME_HEADER_LEN + 1] << BYTE |
+                             bufferRx[start_idx + FRAME_HEADER_LEN];
+                ProcessDataRx(cmd_id, bufferRx + start_idx + FRAME_HEADER_LEN + CMD_ID_LEN,
+                              DATA_LENGTH);
+                // 整帧跳过，数据段里的0xA5不会再被当成帧头重新校验
+                start_idx += frame_len;
+            } else {
+                ++start_idx;
             }
         }
         return true;
@@ -242,7 +256,11 @@ namespace communication {
                 memcpy(&pack, data, length);
                 break;
             case TARGET_ANGLE:
-                memcpy(&target_angle, data, length);
+                CopyPacket(&target_angle, sizeof(target_angle), data, length);
+                target_angle_timestamp = bsp::GetHighresTickMicroSec();
+                target_angle_capture = 0;
+                if (target_angle.capture_time != 0 && clock_sync.IsSynchronized())
+                    target_angle_capture = clock_sync.ToLocal(target_angle.capture_time);
                 break;
             case NO_TARGET_FLAG:
                 memcpy(&no_target_flag, data, length);
@@ -253,6 +271,14 @@ namespace communication {
             case ROBOT_MOVE_SPEED:
                 memcpy(&robot_move, data, length);
                 break;
+            case TIME_SYNC: {
+                const uint64_t now = bsp::GetHighresTickMicroSec();
+                CopyPacket(&time_sync, sizeof(time_sync), data, length);
+                if (time_sync.pc_receive != 0)
+                    clock_sync.Update(time_sync.mcu_request, time_sync.pc_receive,
+                                      time_sync.pc_transmit, now);
+                break;
+            }
             case ROBOT_POWER_HEAT_HP_UPLOAD:
                 memcpy(&robot_power_heat_hp_upload, data, length);
                 break;
@@ -297,6 +323,12 @@ namespace communication {
                 data_len = sizeof(robot_move_t);
                 memcpy(data, &robot_move, data_len);
                 break;
+            case TIME_SYNC:
+                time_sync.mcu_request = bsp::GetHighresTickMicroSec();
+                time_sync.pc_receive = time_sync.pc_transmit = 0;
+                data_len = sizeof(time_sync_t);
+                memcpy(data, &time_sync, data_len);
+                break;
             case ROBOT_POWER_HEAT_HP_UPLOAD:
                 data_len = sizeof(robot_power_heat_hp_upload_t);
                 memcpy(data, &robot_power_heat_hp_upload, data_len);
@@ -0,0 +1,215 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#include "telemetry.h"
+
+#include <cstring>
+
+#include "bsp_error_handler.h"
+#include "cmsis_os.h"
+#include "crc_check.h"
+
+#define TELEMETRY_SOF_1 0x55
+#define TELEMETRY_SOF_2 0xAA
+#define TELEMETRY_HEADER_LEN 4
+#define TELEMETRY_TAIL_LEN 2
+#define TELEMETRY_SAMPLE 0x01
+#define TELEMETRY_SCHEMA 0x02
+#define TELEMETRY_SCHEMA_INTERVAL 64 /* samples between two schema frames */
+
+namespace communication {
+
+    static const uint8_t telemetry_type_size[] = {4, 4, 4, 2, 2, 1, 1};
+
+    Telemetry::Telemetry(telemetry_init_t init) {
+        uart_ = init.uart;
+#ifndef NO_USB
+        usb_ = init.usb;
+        RM_ASSERT_TRUE(uart_ != nullptr || usb_ != nullptr, "Telemetry needs a uart or usb port");
+#else
+        RM_ASSERT_TRUE(uart_ != nullptr, "Telemetry needs a uart port");
+#endif
+        sample_period_us_ = init.sample_period_us;
+    }
+
+    int Telemetry::AddChannel(const char* name, telemetry_type_t type, const void* source,
+                              telemetry_getter_t getter, void* args, uint16_t decimation) {
+        if (channel_num_ >= TELEMETRY_MAX_CHANNEL) {
+            RM_EXPECT_TRUE(false, "Too many telemetry channels");
+            return -1;
+        }
+        channels_[channel_num_] = {.name = name,
+                                   .type = type,
+                                   .source = source,
+                                   .getter = getter,
+                                   .args = args,
+                                   .decimation = decimation > 0 ? decimation : (uint16_t)1,
+                                   .enabled = true};
+        return channel_num_++;
+    }
+
+    int Telemetry::AddChannel(const char* name, const float* source, uint16_t decimation) {
+        return AddChannel(name, TELEMETRY_FLOAT, source, nullptr, nullptr, decimation);
+    }
+
+    int Telemetry::AddChannel(const char* name, const int32_t* source, uint16_t decimation) {
+        return AddChannel(name, TELEMETRY_INT32, source, nullptr, nullptr, decimation);
+    }
+
+    int Telemetry::AddChannel(const char* name, const uint32_t* source, uint16_t decimation) {
+        return AddChannel(name, TELEMETRY_UINT32, source, nullptr, nullptr, decimation);
+    }
+
+    int Telemetry::AddChannel(const char* name, const int16_t* source, uint16_t decimation) {
+        return AddChannel(name, TELEMETRY_INT16, source, nullptr, nullptr, decimation);
+    }
+
+    int Telemetry::AddChannel(const char* name, const uint16_t* source, uint16_t decimation) {
+        return AddChannel(name, TELEMETRY_UINT16, source, nullptr, nullptr, decimation);
+    }
+
+    int Telemetry::AddChannel(const char* name, const int8_t* source, uint16_t decimation) {
+        return AddChannel(name, TELEMETRY_INT8, source, nullptr, nullptr, decimation);
+    }
+
+    int Telemetry::AddChannel(const char* name, const uint8_t* source, uint16_t decimation) {
+        return AddChannel(name, TELEMETRY_UINT8, source, nullptr, nullptr, decimation);
+    }
+
+    int Telemetry::AddChannel(const char* name, telemetry_getter_t getter, void* args,
+                              uint16_t decimation) {
+        return AddChannel(name, TELEMETRY_FLOAT, nullptr, getter, args, decimation);
+    }
+
+    void Telemetry::Enable(int id, bool enable) {
+        if (id >= 0 && id < channel_num_)
+            channels_[id].enabled = enable;
+    }
+
+    void Telemetry::Sample() {
+        uint8_t* payload = frame_ + TELEMETRY_HEADER_LEN;
+        uint8_t* p = payload + 8;
+        uint32_t mask = 0;
+
+        for (int i = 0; i < channel_num_; ++i) {
+            const channel_t& channel = channels_[i];
+            if (!channel.enabled || index_ % channel.decimation != 0)
+                continue;
+            mask |= 1u << i;
+            if (channel.getter) {
+                const float value = channel.getter(channel.args);
+                memcpy(p, &value, sizeof(value));
+            } else {
+                memcpy(p, channel.source, telemetry_type_size[channel.type]);
+            }
+            p += telemetry_type_size[channel.type];
+        }
+
+        if (mask) {
+            memcpy(payload, &index_, 4);
+            memcpy(payload + 4, &mask, 4);
+            Send(TELEMETRY_SAMPLE, p - payload);
+        }
+        // trickle the channel table so a host that connects late can still name the columns
+        if (channel_num_ && index_ % TELEMETRY_SCHEMA_INTERVAL == 0)
+            SendSchema((index_ / TELEMETRY_SCHEMA_INTERVAL) % channel_num_);
+        ++index_;
+    }
+
+    void Telemetry::SendSchema(int id) {
+        const channel_t& channel = channels_[id];
+        uint8_t* payload = frame_ + TELEMETRY_HEADER_LEN;
+        const uint32_t name_len = strnlen(channel.name, TELEMETRY_MAX_NAME_LEN);
+
+        payload[0] = (uint8_t)id;
+        payload[1] = channel.type;
+        memcpy(payload + 2, &channel.decimation, 2);
+        memcpy(payload + 4, &sample_period_us_, 4);
+        memcpy(payload + 8, channel.name, name_len);
+        Send(TELEMETRY_SCHEMA, 8 + name_len);
+    }
+
+    void Telemetry::Send(uint8_t type, uint32_t payload_length) {
+        const uint32_t length = TELEMETRY_HEADER_LEN + payload_length + TELEMETRY_TAIL_LEN;
+        uint32_t written = 0;
+
+        frame_[0] = TELEMETRY_SOF_1;
+        frame_[1] = TELEMETRY_SOF_2;
+        frame_[2] = type;
+        frame_[3] = (uint8_t)payload_length;
+        append_crc16_check_sum(frame_, length);
+
+        if (uart_)
+            written = (uint32_t)uart_->Write(frame_, length);
+#ifndef NO_USB
+        else
+            written = usb_->Write(frame_, length);
+#endif
+        if (written != length)
+            ++overrun_;
+    }
+
+    void Telemetry::Start(uint32_t period_ms) {
+        period_ms_ = period_ms > 0 ? period_ms : 1;
+        sample_period_us_ = period_ms_ * 1000;
+        if (thread_)
+            return;
+        bsp::thread_init_t thread_init = {
+            .func = ThreadFunc,
+            .args = this,
+            .attr = thread_attr_,
+        };
+        thread_ = new bsp::Thread(thread_init);
+        thread_->Start();
+    }
+
+    void Telemetry::ThreadFunc(void* args) {
+        bsp::Thread* thread = reinterpret_cast<bsp::Thread*>(args);
+        Telemetry* telemetry = reinterpret_cast<Telemetry*>(thread->GetArgs());
+        uint32_t wake = osKernelGetTickCount();
+        while (true) {
+            telemetry->Sample();
+            wake += telemetry->period_ms_;
+            osDelayUntil(wake);
+        }
+    }
+
+    float Telemetry::Bandwidth() const {
+        const float rate = sample_period_us_ > 0 ? 1e6f / sample_period_us_ : 0;
+        float bytes = TELEMETRY_HEADER_LEN + 8 + TELEMETRY_TAIL_LEN;  // sent on every sample
+        float schema = 0;
+
+        for (int i = 0; i < channel_num_; ++i) {
+            const channel_t& channel = channels_[i];
+            schema += TELEMETRY_HEADER_LEN + 8 + TELEMETRY_TAIL_LEN +
+                      strnlen(channel.name, TELEMETRY_MAX_NAME_LEN);
+            if (channel.enabled)
+                bytes += (float)telemetry_type_size[channel.type] / channel.decimation;
+        }
+        if (channel_num_)
+            bytes += schema / channel_num_ / TELEMETRY_SCHEMA_INTERVAL;
+        return bytes * rate;
+    }
+
+    uint32_t Telemetry::GetOverrun() const {
+        return overrun_;
+    }
+
+}  // namespace communication
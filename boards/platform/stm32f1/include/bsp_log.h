@@ -0,0 +1,314 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+#include "main.h"
+
+/* NOTE: the deferred logger stores the *address* of the format string instead of the formatted
+ * text. The address is resolved back to the literal by tools/log_decoder.py using the .elf of the
+ * running firmware, so the format argument must always be a string literal. */
+
+namespace bsp {
+
+    /**
+     * @brief 无锁多生产者单消费者字节环形缓冲区
+     * @details 生产者通过CAS预留空间后写入数据，最后写入记录头表示提交；
+     * 消费者按顺序取出已提交的记录
+     */
+    /**
+     * @brief lock-free multi-producer single-consumer ring of variable length records
+     * @details producers reserve space with a CAS on the head index, copy their payload and then
+     * publish the record by writing its header word last; the single consumer pops committed
+     * records in order and clears the consumed space
+     *
+     * @tparam SIZE ring capacity in bytes, must be a power of 2 and a multiple of 4
+     */
+    template <uint32_t SIZE>
+    class LogRing {
+      public:
+        static_assert((SIZE & (SIZE - 1)) == 0, "ring size must be a power of 2");
+        static_assert(SIZE % 4 == 0, "ring size must be a multiple of 4");
+
+        /**
+         * @brief 写入一条记录，可在任意任务或中断中调用
+         *
+         * @param data   记录内容
+         * @param length 记录长度
+         *
+         * @return 成功返回true，缓冲区已满返回false
+         */
+        /**
+         * @brief push one record, safe to call from any task or interrupt
+         *
+         * @param data   record payload
+         * @param length payload length in bytes
+         *
+         * @return true on success, false if the ring does not have enough free space
+         */
+        bool Push(const uint8_t* data, uint32_t length) {
+            // header word + payload, rounded up so every header stays word aligned
+            const uint32_t total = (length + HEADER_LEN + 3) & ~3u;
+            if (length == 0 || total > SIZE / 2) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            uint32_t head = head_.load(std::memory_order_relaxed);
+            do {
+                if (head + total - tail_.load(std::memory_order_acquire) > SIZE) {
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+            } while (!head_.compare_exchange_weak(head, head + total, std::memory_order_acq_rel,
+                                                  std::memory_order_relaxed));
+            CopyIn(head + HEADER_LEN, data, length);
+            // publishing the header commits the record to the consumer
+            __atomic_store_n(&buffer_[(head & MASK) / 4], total | (length << 16), __ATOMIC_RELEASE);
+            return true;
+        }
+
+        /**
+         * @brief 取出一条已提交的记录，仅能在单个消费者任务中调用
+         *
+         * @param data     输出缓冲区
+         * @param capacity 输出缓冲区大小
+         *
+         * @return 记录长度，没有可读记录时返回0
+         */
+        /**
+         * @brief pop one committed record, only to be called from a single consumer task
+         *
+         * @param data     output buffer
+         * @param capacity size of the output buffer
+         *
+         * @return record length, 0 if nothing is ready
+         */
+        uint32_t Pop(uint8_t* data, uint32_t capacity) {
+            const uint32_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail == head_.load(std::memory_order_acquire))
+                return 0;
+            const uint32_t header = __atomic_load_n(&buffer_[(tail & MASK) / 4], __ATOMIC_ACQUIRE);
+            if (header == 0)
+                return 0;  // reserved by a producer that has not committed yet
+            const uint32_t total = header & 0xffff;
+            const uint32_t length = header >> 16;
+            if (length <= capacity)
+                CopyOut(tail + HEADER_LEN, data, length);
+            // consumed space must read as zero so stale bytes never look like a header
+            Clear(tail, total);
+            tail_.store(tail + total, std::memory_order_release);
+            return length <= capacity ? length : 0;
+        }
+
+        /**
+         * @brief 获取因缓冲区满而被丢弃的记录数
+         */
+        /**
+         * @brief number of records dropped because the ring was full
+         */
+        uint32_t Dropped() const {
+            return dropped_.load(std::memory_order_relaxed);
+        }
+
+      private:
+        static constexpr uint32_t MASK = SIZE - 1;
+        static constexpr uint32_t HEADER_LEN = 4;
+
+        uint32_t buffer_[SIZE / 4] = {0};
+        std::atomic<uint32_t> head_{0};
+        std::atomic<uint32_t> tail_{0};
+        std::atomic<uint32_t> dropped_{0};
+
+        void CopyIn(uint32_t pos, const uint8_t* data, uint32_t length) {
+            uint8_t* bytes = reinterpret_cast<uint8_t*>(buffer_);
+            const uint32_t offset = pos & MASK;
+            const uint32_t first = length < SIZE - offset ? length : SIZE - offset;
+            memcpy(bytes + offset, data, first);
+            memcpy(bytes, data + first, length - first);
+        }
+
+        void CopyOut(uint32_t pos, uint8_t* data, uint32_t length) const {
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(buffer_);
+            const uint32_t offset = pos & MASK;
+            const uint32_t first = length < SIZE - offset ? length : SIZE - offset;
+            memcpy(data, bytes + offset, first);
+            memcpy(data + first, bytes, length - first);
+        }
+
+        void Clear(uint32_t pos, uint32_t length) {
+            uint8_t* bytes = reinterpret_cast<uint8_t*>(buffer_);
+            const uint32_t offset = pos & MASK;
+            const uint32_t first = length < SIZE - offset ? length : SIZE - offset;
+            memset(bytes + offset, 0, first);
+            memset(bytes, 0, length - first);
+        }
+    };
+
+    /**
+     * @brief 参数类型标记，和 tools/log_decoder.py 保持一致
+     */
+    /**
+     * @brief argument type tags, keep in sync with tools/log_decoder.py
+     */
+    enum log_arg_t : uint8_t {
+        LOG_ARG_I32 = 1,
+        LOG_ARG_U32 = 2,
+        LOG_ARG_I64 = 3,
+        LOG_ARG_U64 = 4,
+        LOG_ARG_F32 = 5,
+        LOG_ARG_F64 = 6,
+        LOG_ARG_STR = 7,
+        LOG_ARG_PTR = 8,
+    };
+
+    constexpr uint32_t LOG_RING_SIZE = 2048;   /* deferred log ring capacity in bytes */
+    constexpr uint32_t LOG_MAX_RECORD = 96;    /* maximum encoded record length */
+    constexpr uint32_t LOG_MAX_STR_LEN = 31;   /* strings longer than this are truncated */
+
+    extern LogRing<LOG_RING_SIZE> log_ring;
+
+    namespace log_internal {
+
+        inline void Put(uint8_t*& p, uint8_t tag, const void* value, uint32_t size) {
+            *p++ = tag;
+            memcpy(p, value, size);
+            p += size;
+        }
+
+        template <typename T>
+        inline void Encode(uint8_t*& p, const uint8_t* end, T value) {
+            if (p + 1 + 8 > end)
+                return;
+            if constexpr (std::is_same<T, float>::value) {
+                Put(p, LOG_ARG_F32, &value, 4);
+            } else if constexpr (std::is_floating_point<T>::value) {
+                const double v = value;
+                Put(p, LOG_ARG_F64, &v, 8);
+            } else if constexpr (std::is_pointer<T>::value) {
+                const uint32_t v = (uint32_t)(uintptr_t)value;
+                Put(p, LOG_ARG_PTR, &v, 4);
+            } else if constexpr (sizeof(T) > 4) {
+                Put(p, std::is_signed<T>::value ? LOG_ARG_I64 : LOG_ARG_U64, &value, 8);
+            } else if constexpr (std::is_signed<T>::value) {
+                const int32_t v = value;
+                Put(p, LOG_ARG_I32, &v, 4);
+            } else {
+                const uint32_t v = value;
+                Put(p, LOG_ARG_U32, &v, 4);
+            }
+        }
+
+        inline void Encode(uint8_t*& p, const uint8_t* end, const char* value) {
+            uint32_t length = value == nullptr ? 0 : strnlen(value, LOG_MAX_STR_LEN);
+            if (p + 2 > end)
+                return;
+            if (p + 2 + length > end)
+                length = end - p - 2;
+            *p++ = LOG_ARG_STR;
+            *p++ = (uint8_t)length;
+            memcpy(p, value, length);
+            p += length;
+        }
+
+        inline void Encode(uint8_t*& p, const uint8_t* end, char* value) {
+            Encode(p, end, (const char*)value);
+        }
+
+    }  // namespace log_internal
+
+    /**
+     * @brief 延迟日志：仅记录格式字符串地址和参数的原始字节，由低优先级任务发送，主机端解码
+     *
+     * @param format 格式化字符串，必须为字符串常量
+     * @param args   与 printf 相同的参数列表
+     *
+     * @return 成功写入缓冲区返回true
+     *
+     * @note    可在中断和任意优先级的任务中调用，不会阻塞
+     * @note    会在 NDEBUG 模式下不执行任何操作
+     */
+    /**
+     * @brief deferred log: records the format string address plus the raw argument bytes, the
+     * text is rendered on the host by tools/log_decoder.py
+     *
+     * @param format  format string, must be a string literal
+     * @param args    same argument list as in printf
+     *
+     * @return true if the record is queued
+     *
+     * @note    non-blocking, safe to call from interrupts and tasks of any priority
+     * @note    will perform no-op in NDEBUG mode
+     */
+    template <typename... Args>
+    bool log_deferred(const char* format, Args... args) {
+#ifdef NDEBUG
+        UNUSED(format);
+        (UNUSED(args), ...);
+        return false;
+#else
+        uint8_t record[LOG_MAX_RECORD];
+        uint8_t* p = record;
+        const uint32_t address = (uint32_t)(uintptr_t)format;
+        const uint32_t tick = HAL_GetTick();
+        memcpy(p, &address, 4);
+        memcpy(p + 4, &tick, 4);
+        p += 8;
+        (log_internal::Encode(p, record + LOG_MAX_RECORD, args), ...);
+        return log_ring.Push(record, p - record);
+#endif
+    }
+
+    /**
+     * @brief 启动延迟日志的发送任务，日志通过 print 所使用的串口或USB输出
+     *
+     * @param period_ms 发送任务的运行周期
+     */
+    /**
+     * @brief start the low priority task that drains the deferred log through the same uart / usb
+     * port used by print
+     *
+     * @param period_ms drain period in [ms]
+     */
+    void log_start(uint32_t period_ms = 5);
+
+    /**
+     * @brief 判断延迟日志的发送任务是否已经启动
+     */
+    /**
+     * @brief if the deferred log drain task is running
+     */
+    bool log_started();
+
+    /**
+     * @brief 立即发送缓冲区中的所有日志
+     * @note 环形缓冲区只允许一个读者，发送任务启动后只能由发送任务调用
+     */
+    /**
+     * @brief flush every pending record now
+     * @note the ring buffer allows a single reader, so once the drain task is started only the
+     * drain task may call this
+     */
+    void log_flush();
+
+}  // namespace bsp
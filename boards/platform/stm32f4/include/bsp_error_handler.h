@@ -24,10 +24,10 @@
 
 #define BSP_DEBUG print("[DEBUG] %s:%d ", __FUNCTION__, __LINE__)
 // non-fatal assertions (does not hang)
-#define RM_EXPECT_TRUE(cond, msg)                           \
-    do {                                                    \
-        if (!(cond))                                        \
-            bsp_error_handler(__FUNCTION__, __LINE__, msg); \
+#define RM_EXPECT_TRUE(cond, msg)                            \
+    do {                                                     \
+        if (!(cond))                                         \
+            bsp_expect_handler(__FUNCTION__, __LINE__, msg); \
     } while (0)
 #define RM_EXPECT_FALSE(cond, msg) RM_EXPECT_TRUE(!(cond), msg)
 #define RM_EXPECT_EQ(expr, ref, msg) RM_EXPECT_TRUE((expr) == (ref), msg)
@@ -65,3 +65,14 @@
  * @date   2018-04-15
  */
 void bsp_error_handler(const char* func, int line, const char* msg);
+
+/**
+ * Handle non-fatal expectation failures. Once the deferred logger is started
+ * (bsp::log_start) the message is queued in binary form instead of being
+ * formatted in place, so failing expectations in hot paths stay cheap.
+ *
+ * @param  func       Which function the error occured
+ * @param  line       Which line the error occured
+ * @param  msg        Message want to print
+ */
+void bsp_expect_handler(const char* func, int line, const char* msg);
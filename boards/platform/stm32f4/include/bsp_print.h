@@ -77,6 +77,24 @@ void print_use_usb();
  */
 int32_t print(const char* format, ...);
 
+/**
+ * @brief 将原始字节直接输出到调试串口或USB，不做格式化
+ *
+ * @param data   数据
+ * @param length 数据长度
+ *
+ * @return 写入的字节数
+ */
+/**
+ * @brief write raw bytes to the debug uart / usb port without formatting
+ *
+ * @param data    bytes to be written
+ * @param length  number of bytes
+ *
+ * @return  number of bytes written
+ */
+int32_t print_raw(const uint8_t* data, uint32_t length);
+
 /* escape codes helper functions -- http://www.termsys.demon.co.uk/vtansi.htm
  */
 
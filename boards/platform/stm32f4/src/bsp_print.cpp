@@ -80,6 +80,23 @@ int32_t print(const char* format, ...) {
 #endif  // #ifdef NDEBUG
 }
 
+int32_t print_raw(const uint8_t* data, uint32_t length) {
+#ifdef NDEBUG
+    UNUSED(data);
+    UNUSED(length);
+    return 0;
+#else
+    if (print_uart)
+        return print_uart->Write(data, length);
+#ifndef NO_USB
+    else if (print_usb)
+        return print_usb->Write(const_cast<uint8_t*>(data), length);
+#endif
+    else
+        return 0;
+#endif  // #ifdef NDEBUG
+}
+
 void set_cursor(int row, int col) {
     print("\033[%d;%dH", row, col);
 }
@@ -20,6 +20,8 @@
 
 #include "bsp_error_handler.h"
 
+#include "bsp_log.h"
+
 void bsp_error_handler(const char* func, int line, const char* msg) {
     print("[ERROR at ");
     print("%s:", func);
@@ -27,3 +29,11 @@ void bsp_error_handler(const char* func, int line, const char* msg) {
     print("%s\r\n", msg);
     return;
 }
+
+void bsp_expect_handler(const char* func, int line, const char* msg) {
+    if (bsp::log_started()) {
+        bsp::log_deferred("[ERROR at %s:%d] %s\r\n", func, line, msg);
+        return;
+    }
+    bsp_error_handler(func, line, msg);
+}
@@ -0,0 +1,113 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#include "bsp_log.h"
+
+#include "bsp_print.h"
+#include "bsp_thread.h"
+#include "cmsis_os.h"
+
+#define LOG_FRAME_SOF_1 0xA5
+#define LOG_FRAME_SOF_2 0x5A
+#define LOG_FRAME_OVERHEAD 4 /* 2 bytes sof + 1 byte length + 1 byte checksum */
+#define LOG_TX_LEN 256
+
+namespace bsp {
+
+    LogRing<LOG_RING_SIZE> log_ring;
+
+    static Thread* log_thread = nullptr;
+    static uint32_t log_period = 5;
+    static uint32_t log_reported_dropped = 0;
+    static uint8_t log_tx_buffer[LOG_TX_LEN];
+
+    static const osThreadAttr_t log_thread_attr = {.name = "LogDrainTask",
+                                                   .attr_bits = osThreadDetached,
+                                                   .cb_mem = nullptr,
+                                                   .cb_size = 0,
+                                                   .stack_mem = nullptr,
+                                                   .stack_size = 128 * 4,
+                                                   .priority = (osPriority_t)osPriorityLow,
+                                                   .tz_module = 0,
+                                                   .reserved = 0};
+
+    static uint32_t log_frame(uint8_t* frame, const uint8_t* payload, uint32_t length) {
+        uint8_t checksum = 0;
+        frame[0] = LOG_FRAME_SOF_1;
+        frame[1] = LOG_FRAME_SOF_2;
+        frame[2] = (uint8_t)length;
+        for (uint32_t i = 0; i < length; ++i) {
+            frame[3 + i] = payload[i];
+            checksum += payload[i];
+        }
+        frame[3 + length] = checksum;
+        return length + LOG_FRAME_OVERHEAD;
+    }
+
+    void log_flush() {
+        uint8_t record[LOG_MAX_RECORD + 4];
+        uint32_t tx_len = 0;
+
+        // a record with a null format address tells the host how many records were lost
+        const uint32_t dropped = log_ring.Dropped();
+        if (dropped != log_reported_dropped) {
+            const uint32_t header[2] = {0, HAL_GetTick()};
+            memcpy(record, header, sizeof(header));
+            record[8] = LOG_ARG_U32;
+            memcpy(record + 9, &dropped, 4);
+            tx_len += log_frame(log_tx_buffer + tx_len, record, 13);
+            log_reported_dropped = dropped;
+        }
+
+        uint32_t length;
+        while ((length = log_ring.Pop(record, sizeof(record))) != 0) {
+            if (tx_len + length + LOG_FRAME_OVERHEAD > LOG_TX_LEN) {
+                print_raw(log_tx_buffer, tx_len);
+                tx_len = 0;
+            }
+            tx_len += log_frame(log_tx_buffer + tx_len, record, length);
+        }
+        if (tx_len)
+            print_raw(log_tx_buffer, tx_len);
+    }
+
+    static void log_thread_func(void* args) {
+        UNUSED(args);
+        while (true) {
+            log_flush();
+            osDelay(log_period);
+        }
+    }
+
+    void log_start(uint32_t period_ms) {
+        log_period = period_ms > 0 ? period_ms : 1;
+        if (log_thread)
+            return;
+        thread_init_t thread_init = {
+            .func = log_thread_func, .args = nullptr, .attr = log_thread_attr};
+        log_thread = new Thread(thread_init);
+        log_thread->Start();
+    }
+
+    bool log_started() {
+        return log_thread != nullptr;
+    }
+
+}  // namespace bsp
@@ -27,6 +27,44 @@ extern "C" {
 
 #include "main.h"
 
+/**
+ * Bytes consumed per round of table lookups: 1, 4 or 8. Slicing by 4 adds 2.25 KB of tables to
+ * flash, slicing by 8 another 3 KB
+ */
+#ifndef CRC_CHECK_SLICE
+#define CRC_CHECK_SLICE 4
+#endif
+
+/**
+ * Compute the one-shot checksums with the CRC unit of chips that have a programmable polynomial
+ * (STM32H7). Off by default; the incremental API always uses the software tables
+ */
+#ifndef CRC_CHECK_HARDWARE
+#define CRC_CHECK_HARDWARE 0
+#endif
+
+#if CRC_CHECK_SLICE != 1 && CRC_CHECK_SLICE != 4 && CRC_CHECK_SLICE != 8
+#error "CRC_CHECK_SLICE must be 1, 4 or 8"
+#endif
+
+#if CRC_CHECK_HARDWARE && !(defined(CRC) && defined(CRC_POL_POL))
+#error "CRC_CHECK_HARDWARE needs a CRC unit with a programmable polynomial"
+#endif
+
+/**
+ * Running CRC8 of a message that arrives in pieces
+ */
+typedef struct {
+    uint8_t crc;
+} crc8_context_t;
+
+/**
+ * Running CRC16 of a message that arrives in pieces
+ */
+typedef struct {
+    uint16_t crc;
+} crc16_context_t;
+
 /**
  * Verify CRC8
  *
@@ -61,6 +99,64 @@ uint8_t verify_crc16_check_sum(const uint8_t* pchMessage, uint32_t dwLength);
  */
 void append_crc16_check_sum(uint8_t* pchMessage, uint32_t dwLength);
 
+/**
+ * CRC16 checksum calculation
+ *
+ * @param  pchMessage Message to check
+ * @param  dwLength   Length of the message
+ * @param  wCRC       Initialized checksum
+ * @return            CRC checksum
+ */
+uint16_t get_crc16_check_sum(const uint8_t* pchMessage, uint32_t dwLength, uint16_t wCRC);
+
+/**
+ * Start an incremental CRC8
+ *
+ * @param  ctx Context to initialize
+ */
+void crc8_init(crc8_context_t* ctx);
+
+/**
+ * Feed the next piece of the message
+ *
+ * @param  ctx    Context started by crc8_init
+ * @param  data   Next bytes of the message
+ * @param  length Number of bytes
+ */
+void crc8_update(crc8_context_t* ctx, const uint8_t* data, uint32_t length);
+
+/**
+ * CRC8 of everything fed so far, the context can keep being updated
+ *
+ * @param  ctx Context
+ * @return     CRC checksum, same as the one-shot functions over the concatenated pieces
+ */
+uint8_t crc8_final(const crc8_context_t* ctx);
+
+/**
+ * Start an incremental CRC16
+ *
+ * @param  ctx Context to initialize
+ */
+void crc16_init(crc16_context_t* ctx);
+
+/**
+ * Feed the next piece of the message
+ *
+ * @param  ctx    Context started by crc16_init
+ * @param  data   Next bytes of the message
+ * @param  length Number of bytes
+ */
+void crc16_update(crc16_context_t* ctx, const uint8_t* data, uint32_t length);
+
+/**
+ * CRC16 of everything fed so far, the context can keep being updated
+ *
+ * @param  ctx Context
+ * @return     CRC checksum, same as the one-shot functions over the concatenated pieces
+ */
+uint16_t crc16_final(const crc16_context_t* ctx);
+
 #ifdef __cplusplus
 }
 #endif
@@ -27,6 +27,7 @@
 #include "cmsis_os.h"
 #include "heater.h"
 #include "main.h"
+#include "utils.h"
 
 #define ONBOARD_IMU_SPI hspi5
 #define ONBOARD_IMU_CS_GROUP GPIOF
@@ -45,12 +46,16 @@ static bsp::GPIT* mpu6500_it = nullptr;
 static bsp::SPI* spi5 = nullptr;
 static bsp::SPIMaster* spi5_master = nullptr;
 
+/* 姿态解算的实际周期，名义为1kHz */
+static PeriodTimer imu_period(0.001f, 0.01f);
+
 void MPU6500ReceiveDone() {
+    const float dt = imu_period.Update(bsp::GetHighresTickMicroSec());
     // ahrs->Update(mpu6500->gyro_[0], mpu6500->gyro_[1], mpu6500->gyro_[2],
     // mpu6500->accel_[0], mpu6500->accel_[1], mpu6500->accel_[2], mpu6500->mag_[0],
     // mpu6500->mag_[1], mpu6500->mag_[2]);
     ahrs->Update(mpu6500->gyro_[0], mpu6500->gyro_[1], mpu6500->gyro_[2], mpu6500->accel_[0],
-                 mpu6500->accel_[1], mpu6500->accel_[2]);
+                 mpu6500->accel_[1], mpu6500->accel_[2], dt);
     heater->Update(mpu6500->temperature_);
 }
 
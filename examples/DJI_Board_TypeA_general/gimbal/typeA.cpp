@@ -30,6 +30,7 @@
 #include "gimbal.h"
 #include "heater.h"
 #include "main.h"
+#include "utils.h"
 
 #define ONBOARD_IMU_SPI hspi5
 #define ONBOARD_IMU_CS_GROUP GPIOF
@@ -66,14 +67,17 @@ void MPU6500ReceiveDone() {
 
 void imuUpdateTask(void* arguments) {
     UNUSED(arguments);
+    // 姿态解算的实际周期，名义为1kHz
+    PeriodTimer imu_period(0.001f, 0.01f);
     while (true) {
         uint32_t flags = osThreadFlagsWait(RX_SIGNAL, osFlagsWaitAll, osWaitForever);
         if (flags & RX_SIGNAL) {
+            const float dt = imu_period.Update(bsp::GetHighresTickMicroSec());
             // ahrs->Update(mpu6500->gyro_[0], mpu6500->gyro_[1], mpu6500->gyro_[2],
             // mpu6500->accel_[0], mpu6500->accel_[1], mpu6500->accel_[2], mpu6500->mag_[0],
             // mpu6500->mag_[1], mpu6500->mag_[2]);
             ahrs->Update(mpu6500->gyro_[0], mpu6500->gyro_[1], mpu6500->gyro_[2],
-                         mpu6500->accel_[0], mpu6500->accel_[1], mpu6500->accel_[2]);
+                         mpu6500->accel_[0], mpu6500->accel_[1], mpu6500->accel_[2], dt);
             heater->Update(mpu6500->temperature_);
         }
     }
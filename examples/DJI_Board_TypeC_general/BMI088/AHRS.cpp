@@ -28,6 +28,7 @@
 #include "cmsis_os.h"
 #include "heater.h"
 #include "main.h"
+#include "utils.h"
 
 #define RX_SIGNAL (1 << 0)
 
@@ -48,9 +49,13 @@ static bsp::GPIO* ist8310_rst = nullptr;
 static bsp::GPIT* ist8310_int = nullptr;
 static imu::IST8310* ist8310 = nullptr;
 
+/* 姿态解算的实际周期，名义为1kHz */
+static PeriodTimer imu_period(0.001f, 0.01f);
+
 void BMI088ReceiveDone() {
+    const float dt = imu_period.Update(bsp::GetHighresTickMicroSec());
     ahrs->Update(bmi088->gyro_[0], bmi088->gyro_[1], bmi088->gyro_[2], bmi088->accel_[0],
-                 bmi088->accel_[1], bmi088->accel_[2]);
+                 bmi088->accel_[1], bmi088->accel_[2], dt);
     heater->Update(bmi088->temperature_);
 }
 
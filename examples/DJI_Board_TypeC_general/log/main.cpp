@@ -0,0 +1,60 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#include "main.h"
+
+#include "bsp_dwt.h"
+#include "bsp_log.h"
+#include "bsp_print.h"
+#include "cmsis_os.h"
+
+static uint32_t print_cycles = 0;
+static uint32_t log_cycles = 0;
+
+void RM_RTOS_Init(void) {
+    print_use_uart(&huart1);
+    DWT_Init(168);
+    bsp::log_start();
+}
+
+void RM_RTOS_Default_Task(const void* arg) {
+    UNUSED(arg);
+    uint32_t start;
+    int counter = 0;
+    float value = 0;
+
+    while (true) {
+        // compare the hot path cost of formatting on target against deferring it to the host
+        start = DWT->CYCCNT;
+        print("counter: %d value: %.3f\r\n", counter, value);
+        print_cycles = DWT->CYCCNT - start;
+
+        start = DWT->CYCCNT;
+        bsp::log_deferred("counter: %d value: %.3f\r\n", counter, value);
+        log_cycles = DWT->CYCCNT - start;
+
+        bsp::log_deferred("print: %lu cycles, log_deferred: %lu cycles\r\n", print_cycles,
+                          log_cycles);
+
+        ++counter;
+        value += 0.1f;
+        osDelay(100);
+    }
+}
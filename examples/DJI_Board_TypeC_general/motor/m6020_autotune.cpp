@@ -0,0 +1,116 @@
+/*###########################################################
+# Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+#                                                          #
+# This program is free software: you can redistribute it   #
+# and/or modify it under the terms of the GNU General      #
+# Public License as published by the Free Software         #
+# Foundation, either version 3 of the License, or (at      #
+# your option) any later version.                          #
+#                                                          #
+# This program is distributed in the hope that it will be  #
+# useful, but WITHOUT ANY WARRANTY; without even           #
+# the implied warranty of MERCHANTABILITY or FITNESS       #
+# FOR A PARTICULAR PURPOSE.  See the GNU General           #
+# Public License for more details.                         #
+#                                                          #
+# You should have received a copy of the GNU General       #
+# Public License along with this program.  If not, see     #
+# <https://www.gnu.org/licenses/>.                         #
+###########################################################*/
+
+#include "MotorCanBase.h"
+#include "bsp_gpio.h"
+#include "bsp_print.h"
+#include "cmsis_os.h"
+#include "main.h"
+#include "pid.h"
+
+#define KEY_GPIO_GROUP KEY_GPIO_Port
+#define KEY_GPIO_PIN KEY_Pin
+
+// 按一次按键整定速度环，再按一次整定角度环，结果通过串口打印
+static bsp::CAN* can1 = nullptr;
+static driver::Motor6020* motor1 = nullptr;
+
+static const char* rule_names[] = {"Ziegler-Nichols PI", "Ziegler-Nichols PID",
+                                   "Tyreus-Luyben PI",   "Tyreus-Luyben PID",
+                                   "Some overshoot PID", "No overshoot PID"};
+
+static void PrintResult(const control::RelayAutoTuner* tuner, float max_iout, float max_out) {
+    if (tuner->State() != control::RelayAutoTuner::SUCCESS) {
+        print("auto tune timeout, try a larger amplitude\r\n");
+        return;
+    }
+    const control::relay_tune_result_t result = tuner->Result();
+    print("Ku: %.3f Tu: %.4f s amplitude: %.4f\r\n", result.ku, result.tu, result.amplitude);
+    for (int i = 0; i <= control::RelayAutoTuner::NO_OVERSHOOT_PID; ++i) {
+        const control::ConstrainedPID::PID_Init_t gains =
+            tuner->Gains((control::RelayAutoTuner::tune_rule_t)i, max_iout, max_out);
+        print("%-20s kp: %10.4f ki: %10.4f kd: %10.4f\r\n", rule_names[i], gains.kp, gains.ki,
+              gains.kd);
+    }
+}
+
+static void WaitKey(bsp::GPIO* key) {
+    while (key->Read() != 0)
+        osDelay(30);
+    while (key->Read() == 0)
+        osDelay(30);
+}
+
+void RM_RTOS_Init() {
+    print_use_uart(&huart1);
+    can1 = new bsp::CAN(&hcan1, true);
+    motor1 = new driver::Motor6020(can1, 0x209, 0x2fe);
+    motor1->SetTransmissionRatio(1);
+    motor1->SetMode(driver::MotorCANBase::THETA | driver::MotorCANBase::OMEGA);
+    HAL_Delay(1000);
+}
+
+void RM_RTOS_Default_Task(const void* args) {
+    UNUSED(args);
+    bsp::GPIO key(KEY_GPIO_GROUP, KEY_GPIO_PIN);
+
+    // 速度环：继电器输出±3000的电流，围绕2rad/s振荡
+    WaitKey(&key);
+    motor1->StartAutoTune(
+        {
+            .setpoint = 2,
+            .amplitude = 3000,
+            .bias = 0,
+            .hysteresis = 0.2,
+            .period = 0,
+            .timeout = 10,
+            .cycles = 4,
+        },
+        driver::MotorCANBase::OMEGA);
+    while (motor1->IsAutoTuning())
+        osDelay(10);
+    PrintResult(motor1->GetAutoTuner(), 3000, 16384);
+    // 速度环测量噪声较大，推荐使用PI规则
+    motor1->ApplyAutoTune(control::RelayAutoTuner::TYREUS_LUYBEN_PI, 3000, 16384);
+    motor1->SetTarget(motor1->GetOutputShaftTheta());
+
+    // 角度环：继电器输出±5rad/s的目标速度，围绕当前角度振荡
+    WaitKey(&key);
+    motor1->StartAutoTune(
+        {
+            .setpoint = motor1->GetOutputShaftTheta(),
+            .amplitude = 5,
+            .bias = 0,
+            .hysteresis = 0.01,
+            .period = 0,
+            .timeout = 10,
+            .cycles = 4,
+        },
+        driver::MotorCANBase::THETA);
+    while (motor1->IsAutoTuning())
+        osDelay(10);
+    PrintResult(motor1->GetAutoTuner(), 0, 6 * PI);
+    motor1->ApplyAutoTune(control::RelayAutoTuner::TYREUS_LUYBEN_PID, 0, 6 * PI);
+
+    while (true) {
+        WaitKey(&key);
+        motor1->SetTarget(motor1->GetTarget() + PI / 2);
+    }
+}
@@ -0,0 +1,99 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#include "MotorCanBase.h"
+#include "bsp_gpio.h"
+#include "bsp_usb.h"
+#include "cmsis_os.h"
+#include "main.h"
+#include "pid.h"
+#include "telemetry.h"
+
+#define KEY_GPIO_GROUP KEY_GPIO_Port
+#define KEY_GPIO_PIN KEY_Pin
+
+static bsp::CAN* can1 = nullptr;
+static bsp::VirtualUSB* usb = nullptr;
+static driver::Motor3508* motor1 = nullptr;
+static communication::Telemetry* telemetry = nullptr;
+
+static float target = 0;
+
+static float get_omega(void* args) {
+    return reinterpret_cast<driver::Motor3508*>(args)->GetOmega();
+}
+
+static float get_current(void* args) {
+    return reinterpret_cast<driver::Motor3508*>(args)->GetCurr();
+}
+
+static float get_pout(void* args) {
+    driver::Motor3508* motor = reinterpret_cast<driver::Motor3508*>(args);
+    return motor->GetPIDState(driver::MotorCANBase::OMEGA).pout;
+}
+
+static float get_iout(void* args) {
+    driver::Motor3508* motor = reinterpret_cast<driver::Motor3508*>(args);
+    return motor->GetPIDState(driver::MotorCANBase::OMEGA).iout;
+}
+
+static float get_dout(void* args) {
+    driver::Motor3508* motor = reinterpret_cast<driver::Motor3508*>(args);
+    return motor->GetPIDState(driver::MotorCANBase::OMEGA).dout;
+}
+
+static void sample_telemetry(void* args) {
+    reinterpret_cast<communication::Telemetry*>(args)->Sample();
+}
+
+void RM_RTOS_Init() {
+    usb = new bsp::VirtualUSB();
+    usb->SetupTx(2048);
+
+    can1 = new bsp::CAN(&hcan1, true);
+    motor1 = new driver::Motor3508(can1, 0x201);
+    motor1->SetMode(driver::MotorCANBase::OMEGA);
+
+    // sampled right after every motor output, i.e. at the 1 kHz motor loop rate
+    telemetry =
+        new communication::Telemetry({.uart = nullptr, .usb = usb, .sample_period_us = 1000});
+    telemetry->AddChannel("target", &target);
+    telemetry->AddChannel("omega", get_omega, motor1);
+    telemetry->AddChannel("current", get_current, motor1);
+    telemetry->AddChannel("pout", get_pout, motor1, 2);
+    telemetry->AddChannel("iout", get_iout, motor1, 2);
+    telemetry->AddChannel("dout", get_dout, motor1, 2);
+    driver::MotorCANBase::RegisterPostOutputCallback(sample_telemetry, telemetry);
+}
+
+void RM_RTOS_Default_Task(const void* args) {
+    UNUSED(args);
+    bsp::GPIO key(KEY_GPIO_GROUP, KEY_GPIO_PIN);
+    bool last_key = key.Read();
+    while (true) {
+        // toggle a step on the speed target with the key, then inspect the response on the host
+        const bool key_state = key.Read();
+        if (last_key && !key_state)
+            target = target == 0 ? 15 * PI : 0;
+        last_key = key_state;
+        motor1->SetTarget(target);
+        osDelay(20);
+    }
+}
@@ -28,6 +28,7 @@
 #include "cmsis_os.h"
 #include "heater.h"
 #include "main.h"
+#include "utils.h"
 
 #define RX_SIGNAL (1 << 0)
 
@@ -61,14 +62,17 @@ void BMI088ReceiveDone() {
 
 void imuUpdateTask(void* arguments) {
     UNUSED(arguments);
+    // 姿态解算的实际周期，名义为1kHz
+    PeriodTimer imu_period(0.001f, 0.01f);
     while (true) {
         uint32_t flags = osThreadFlagsWait(RX_SIGNAL, osFlagsWaitAll, osWaitForever);
         if (flags & RX_SIGNAL) {
+            const float dt = imu_period.Update(bsp::GetHighresTickMicroSec());
             // ahrs->Update(bmi088->gyro_[0], bmi088->gyro_[1], bmi088->gyro_[2], bmi088->accel_[0],
             // bmi088->accel_[1], bmi088->accel_[2], ist8310->mag_[0], ist8310->mag_[1],
             // ist8310->mag_[2]);
             ahrs->Update(bmi088->gyro_[0], bmi088->gyro_[1], bmi088->gyro_[2], bmi088->accel_[0],
-                         bmi088->accel_[1], bmi088->accel_[2]);
+                         bmi088->accel_[1], bmi088->accel_[2], dt);
             heater->Update(bmi088->temperature_);
         }
     }
@@ -28,6 +28,7 @@
 #include "cmsis_os.h"
 #include "heater.h"
 #include "main.h"
+#include "utils.h"
 
 #define RX_SIGNAL (1 << 0)
 
@@ -43,9 +44,13 @@ static bsp::GPIO* bmi088_gyro_cs = nullptr;
 static bsp::GPIT* bmi088_accel_int = nullptr;
 static bsp::GPIT* bmi088_gyro_int = nullptr;
 
+/* 姿态解算的实际周期，名义为1kHz */
+static PeriodTimer imu_period(0.001f, 0.01f);
+
 void BMI088ReceiveDone() {
+    const float dt = imu_period.Update(bsp::GetHighresTickMicroSec());
     ahrs->Update(bmi088->gyro_[0], bmi088->gyro_[1], bmi088->gyro_[2], bmi088->accel_[0],
-                 bmi088->accel_[1], bmi088->accel_[2]);
+                 bmi088->accel_[1], bmi088->accel_[2], dt);
     heater->Update(bmi088->temperature_);
 }
 
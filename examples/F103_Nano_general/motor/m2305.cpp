@@ -23,6 +23,7 @@
 #include "bsp_print.h"
 #include "cmsis_os.h"
 #include "dbus.h"
+#include "fixed_point.h"
 #include "main.h"
 #include "utils.h"
 
@@ -56,8 +57,9 @@ void RM_RTOS_Init() {
 void RM_RTOS_Default_Task(const void* args) {
     UNUSED(args);
     bsp::GPIO key(KEY_GPIO_GROUP, KEY_GPIO_PIN);
-    RampSource ramp_1 = RampSource(0, 0, 450, 0.001);
-    RampSource ramp_2 = RampSource(0, 0, 450, 0.001);
+    // M3没有FPU，斜坡使用定点实现
+    control::FixedRampSource ramp_1(0, 0, 450, 0.001f);
+    control::FixedRampSource ramp_2(0, 0, 450, 0.001f);
     int current = 0;
     int state = 0;
     int8_t last_state = remote::MID;
@@ -78,8 +80,8 @@ void RM_RTOS_Default_Task(const void* args) {
                 }
             }
         }
-        motor1->SetOutput((int16_t)ramp_1.Calc((float)current));
-        motor2->SetOutput((int16_t)ramp_2.Calc((float)current));
+        motor1->SetOutput((int16_t)ramp_1.Calc(current));
+        motor2->SetOutput((int16_t)ramp_2.Calc(current));
         osDelay(1);
     }
 }
@@ -19,6 +19,8 @@
  ###########################################################*/
 
 #include "chassis_task.h"
+
+#include "fastmath.h"
 osThreadId_t chassisTaskHandle;
 driver::MotorCANBase* fl_motor = nullptr;
 driver::MotorCANBase* fr_motor = nullptr;
@@ -129,8 +131,7 @@ void chassisTask(void* arg) {
 
         relative_angle = yaw_motor->GetThetaDelta(gimbal_param->yaw_offset_);
 
-        sin_yaw = arm_sin_f32(relative_angle);
-        cos_yaw = arm_cos_f32(relative_angle);
+        fast_sincosf(relative_angle, &sin_yaw, &cos_yaw);
 
         // 平移速度控制
         if (ch1_edge->get()) {
@@ -21,6 +21,8 @@
 #pragma once
 #include "AHRS.h"
 #include "MPU6500.h"
+#include "adaptive_notch.h"
+#include "attitude_history.h"
 #include "bsp_i2c.h"
 #include "bsp_pwm.h"
 #include "bsp_spi.h"
@@ -37,6 +39,8 @@
 
 extern imu::MPU6500* mpu6500;
 extern control::AHRS* ahrs;
+extern control::AttitudeHistory* attitude_history;
+extern control::AdaptiveNotch* gyro_notch;
 
 // extern osThreadId_t extimuTaskHandle;
 // const osThreadAttr_t extimuTaskAttribute = {.name = "extimuTask",
@@ -19,6 +19,8 @@
  ###########################################################*/
 
 #include "chassis_task.h"
+
+#include "fastmath.h"
 osThreadId_t chassisTaskHandle;
 
 const float chassis_max_xy_speed = 2 * PI * 10;
@@ -91,8 +93,8 @@ void chassisTask(void* arg) {
         float chassis_yaw_diff = yaw_motor->GetThetaDelta(gimbal_param->yaw_offset_);
 
         // 底盘以底盘自己为基准的运动速度
-        float sin_yaw = arm_sin_f32(chassis_yaw_diff);
-        float cos_yaw = arm_cos_f32(chassis_yaw_diff);
+        float sin_yaw, cos_yaw;
+        fast_sincosf(chassis_yaw_diff, &sin_yaw, &cos_yaw);
         chassis_vx = cos_yaw * car_vx + sin_yaw * car_vy;
         chassis_vy = -sin_yaw * car_vx + cos_yaw * car_vy;
         chassis_vt = 0;
@@ -22,12 +22,15 @@
 
 #include "bsp_os.h"
 #include "bsp_uart.h"
+#include "utils.h"
 
 #define ONBOARD_IMU_SPI hspi5
 #define ONBOARD_IMU_CS_GROUP GPIOF
 #define ONBOARD_IMU_CS_PIN GPIO_PIN_6
 
 control::AHRS* ahrs = nullptr;
+control::AttitudeHistory* attitude_history = nullptr;
+control::AdaptiveNotch* gyro_notch = nullptr;
 driver::Heater* heater = nullptr;
 bsp::PWM* heater_pwm = nullptr;
 
@@ -37,6 +40,9 @@ bsp::GPIT* mpu6500_it = nullptr;
 bsp::SPI* spi5 = nullptr;
 bsp::SPIMaster* spi5_master = nullptr;
 
+/* 姿态解算的实际周期，名义为1kHz */
+static PeriodTimer imu_period(0.001f, 0.01f);
+
 // bsp::UART* wituart = nullptr;
 //
 ///// The class WITUART is not an UART, It means that the WIT-IMU using UART
@@ -48,11 +54,20 @@ bsp::SPIMaster* spi5_master = nullptr;
 // bool imu_ok = false;
 
 /**
- * @brief  收到MPU6500数据后的回调函数，用来更新AHRS和加热器
+ * @brief  收到MPU6500数据后的回调函数，用来更新陷波滤波器、AHRS、姿态历史和加热器
  */
 void MPU6500ReceiveDone() {
-    ahrs->Update(mpu6500->gyro_[0], mpu6500->gyro_[1], mpu6500->gyro_[2], mpu6500->accel_[0],
-                 mpu6500->accel_[1], mpu6500->accel_[2]);
+    const uint64_t now = bsp::GetHighresTickMicroSec();
+    const float dt = imu_period.Update(now);
+    // 陷波器的直流增益为1，零漂不受影响，先陷波再估计零漂，振动就不会妨碍静止检测
+    float gyro[3] = {mpu6500->gyro_[0], mpu6500->gyro_[1], mpu6500->gyro_[2]};
+    gyro_notch->Update(gyro, gyro);
+    ahrs->Update(gyro[0], gyro[1], gyro[2], mpu6500->accel_[0], mpu6500->accel_[1],
+                 mpu6500->accel_[2], dt);
+    float quat[4];
+    ahrs->GetQuaternion(quat);
+    ahrs->GetGyro(gyro);
+    attitude_history->Push(now, quat, gyro);
     heater->Update(mpu6500->temperature_);
 }
 
@@ -92,6 +107,10 @@ void init_imu() {
     mpu6500 = new imu::MPU6500(mpu6500_init);
     // 初始化AHRS对象，此处的AHRS指MahonyAHRS算法
     ahrs = new control::AHRS(false);
+    // 姿态历史用于查询相机曝光时刻的云台姿态
+    attitude_history = new control::AttitudeHistory();
+    // 摩擦轮是PWM电调，没有转速反馈，振动频率由云台任务中的频谱分析寻找
+    gyro_notch = new control::AdaptiveNotch();
     // 初始化一组PWM对象，用来控制加热器维持IMU温度恒定
     heater_pwm = new bsp::PWM(&htim3, 2, 1000000, 2000, 0);
     driver::heater_init_t heater_init = {
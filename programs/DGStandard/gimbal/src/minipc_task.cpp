@@ -20,10 +20,12 @@
 
 #include "minipc_task.h"
 
+#include "bsp_os.h"
 #include "bsp_thread.h"
 #include "bsp_uart.h"
 #include "chassis_task.h"
 #include "gimbal_task.h"
+#include "imu_task.h"
 #include "protocol.h"
 #include "referee_task.h"
 
@@ -71,8 +73,19 @@ void minipc_task(void* args) {
             minipc->gimbal_current_status.current_imu_roll = INS_Angle.roll;
             minipc->gimbal_current_status.robot_id = referee->game_robot_status.robot_id;
             minipc->gimbal_current_status.shooter_id = 0;
+            // 时钟同步后附上上位机时钟下的IMU采样时间，用于对齐图像和姿态
+            uint64_t sample_time;
+            float quat[4];
+            minipc->gimbal_current_status.timestamp = 0;
+            if (minipc->clock_sync.IsSynchronized() &&
+                attitude_history->GetLatest(&sample_time, quat))
+                minipc->gimbal_current_status.timestamp = minipc->clock_sync.ToRemote(sample_time);
             minipc->Transmit(communication::GIMBAL_CURRENT_STATUS);
         }
+        if (i % 100 == 0) {
+            // 与上位机同步时钟，回复在Host中处理
+            minipc->Transmit(communication::TIME_SYNC);
+        }
         if (i % 10 == 0) {
             minipc->chassis_current_status.chassis_enabled = 1;  // 暂时底盘默认为打开
             minipc->chassis_current_status.speed_x = chassis_vx;
@@ -19,6 +19,8 @@
 ###########################################################*/
 
 #include "chassis_task.h"
+
+#include "fastmath.h"
 osThreadId_t chassisTaskHandle;
 
 float chassis_vx = 0;
@@ -126,8 +128,7 @@ void chassisTask(void* arg) {
         relative_angle = yaw_motor->GetThetaDelta(gimbal_param->yaw_offset_);
 
         // 计算角度的sin/cos
-        sin_yaw = arm_sin_f32(relative_angle);
-        cos_yaw = arm_cos_f32(relative_angle);
+        fast_sincosf(relative_angle, &sin_yaw, &cos_yaw);
         // 检测到ctrl，切换速度模式
         if (ctrl_edge->posEdge()) {
             if (chassis_boost_flag) {
@@ -19,6 +19,8 @@
  ###########################################################*/
 
 #pragma once
+#include "adaptive_notch.h"
+#include "attitude_history.h"
 #include "bsp_imu.h"
 #include "cmsis_os2.h"
 #include "i2c.h"
@@ -44,6 +46,8 @@ class IMU : public bsp::IMU_typeC {
     void RxCompleteCallback() final;
 };
 extern IMU* imu;
+extern control::AttitudeHistory* attitude_history;
+extern control::AdaptiveNotch* gyro_notch;
 void imuTask(void* arg);
 
 void init_imu();
\ No newline at end of file
@@ -20,6 +20,7 @@
 
 #include "chassis_task.h"
 
+#include "fastmath.h"
 #include "remote_task.h"
 osThreadId_t chassisTaskHandle;
 
@@ -108,8 +109,8 @@ void chassisTask(void* arg) {
         }
 
         // 底盘以底盘自己为基准的运动速度
-        float sin_yaw = arm_sin_f32(chassis_yaw_diff);
-        float cos_yaw = arm_cos_f32(chassis_yaw_diff);
+        float sin_yaw, cos_yaw;
+        fast_sincosf(chassis_yaw_diff, &sin_yaw, &cos_yaw);
         chassis_vx = cos_yaw * car_vx + sin_yaw * car_vy;
         chassis_vy = -sin_yaw * car_vx + cos_yaw * car_vy;
         chassis_vt = 0;
@@ -24,6 +24,7 @@
 #include "chassis_task.h"
 #include "dbus_package.h"
 #include "minipc_task.h"
+#include "tracker.h"
 
 osThreadId_t gimbalTaskHandle;
 
@@ -36,8 +37,43 @@ INS_Angle_t INS_Angle;
 
 control::gimbal_t gimbal_data;
 
+// 自瞄目标的跟踪和延迟补偿，延迟按相机曝光、识别和串口传输估计；有角速度前馈时云台
+// 基本不滞后，lead为0
+static const control::tracker_init_t tracker_init = {5.0f,  0.002f, 0.025f, 0.0f,
+                                                     0.12f, 0.2f,   16.0f};
+static control::TargetTracker* tracker = nullptr;
+static uint64_t last_observation = 0;
+
 void check_kill();
 
+// 收到新的目标角度时加入跟踪器，上位机报告没有目标时丢弃；时钟同步后直接使用拍摄时间
+static void observe_target() {
+    if (minipc->target_angle_timestamp == last_observation)
+        return;
+    last_observation = minipc->target_angle_timestamp;
+    const float pitch = minipc->target_angle.target_pitch;
+    const float yaw = minipc->target_angle.target_yaw;
+    if (minipc->target_angle.target_robot_id == 0)
+        tracker->Reset();
+    else if (minipc->target_angle_capture != 0)
+        tracker->ObserveAt(pitch, yaw, minipc->target_angle_capture);
+    else
+        tracker->Observe(pitch, yaw, last_observation);
+}
+
+// 用跟踪器外推到当前时刻的角度作为目标，角速度作为速度环前馈；没有跟踪到目标时直接使用
+// 上位机的角度
+static void target_autoaim(float speed_offset) {
+    float pitch, yaw, pitch_rate, yaw_rate;
+    if (tracker->Predict(bsp::GetHighresTickMicroSec(), &pitch, &yaw, &pitch_rate, &yaw_rate)) {
+        gimbal->TargetAbs(pitch, -yaw);
+        pitch_motor->SetSpeedOffset(pitch_rate);
+        yaw_motor->SetSpeedOffset(speed_offset - yaw_rate);
+    } else {
+        gimbal->TargetAbs(minipc->target_angle.target_pitch, -minipc->target_angle.target_yaw);
+    }
+}
+
 void gimbalTask(void* arg) {
     UNUSED(arg);
     // 任务启动时先关掉两个电机，然后等待遥控器连接
@@ -134,8 +170,10 @@ void gimbalTask(void* arg) {
         const float ratio = 0.1875;
         float speed_offset = chassis_vt * ratio;
         yaw_motor->SetSpeedOffset(speed_offset);
+        pitch_motor->SetSpeedOffset(0);
+        observe_target();
         if (is_autoaim && minipc->IsOnline()) {
-            gimbal->TargetAbs(minipc->target_angle.target_pitch, -minipc->target_angle.target_yaw);
+            target_autoaim(speed_offset);
             gimbal->UpdateIMU(INS_Angle.pitch, INS_Angle.yaw);
         } else {
             switch (remote_mode) {
@@ -159,8 +197,7 @@ void gimbalTask(void* arg) {
                     //                gimbal->Update();
                     //                break;
                 case REMOTE_MODE_AUTOMATIC:
-                    gimbal->TargetAbs(minipc->target_angle.target_pitch,
-                                      -minipc->target_angle.target_yaw);
+                    target_autoaim(speed_offset);
                     gimbal->UpdateIMU(INS_Angle.pitch, INS_Angle.yaw);
                     break;
                 default:
@@ -264,6 +301,7 @@ void init_gimbal() {
     gimbal_data.yaw_motor = yaw_motor;
     gimbal_data.data = gimbal_init_data;
     gimbal = new control::Gimbal(gimbal_data);
+    tracker = new control::TargetTracker(tracker_init);
     gimbal_param = gimbal->GetData();
 }
 void check_kill() {
@@ -20,6 +20,8 @@
 
 #include "imu_task.h"
 
+#include "bsp_os.h"
+
 osThreadId_t imuTaskHandle;
 
 void IMU::RxCompleteCallback() {
@@ -27,6 +29,8 @@ void IMU::RxCompleteCallback() {
 }
 
 IMU* imu = nullptr;
+control::AttitudeHistory* attitude_history = nullptr;
+control::AdaptiveNotch* gyro_notch = nullptr;
 
 void imuTask(void* arg) {
     UNUSED(arg);
@@ -35,6 +39,7 @@ void imuTask(void* arg) {
         uint32_t flags = osThreadFlagsWait(RX_SIGNAL, osFlagsWaitAll, osWaitForever);
         if (flags & RX_SIGNAL) {  // unnecessary check
             imu->Update();
+            attitude_history->Push(bsp::GetHighresTickMicroSec(), imu->INS_quat, imu->INS_gyro);
         }
     }
 }
@@ -65,5 +70,10 @@ void init_imu() {
     imu_init.hdma_spi_tx = &hdma_spi1_tx;
     imu_init.Accel_INT_pin_ = INT1_ACCEL_Pin;
     imu_init.Gyro_INT_pin_ = INT1_GYRO_Pin;
+    // 姿态历史用于查询相机曝光时刻的云台姿态
+    attitude_history = new control::AttitudeHistory();
     imu = new IMU(imu_init, false);
+    // 陷波0跟随摩擦轮转速，陷波1由频谱分析寻找底盘等其它振动，见shootTask
+    gyro_notch = new control::AdaptiveNotch();
+    imu->SetGyroFilter(gyro_notch);
 }
\ No newline at end of file
@@ -61,6 +61,9 @@ void shootTask(void* arg) {
 
     while (true) {
         check_kill_shoot();
+        // 摩擦轮每转一圈振动一次，转速已知，直接把陷波放在转频上；其它振动交给频谱分析
+        gyro_notch->SetFrequency(0, flywheel_right->GetOmega() / (2 * PI));
+        gyro_notch->Analyze(1);
 
         switch (shoot_flywheel_mode) {
             case SHOOT_FRIC_MODE_PREPARING:
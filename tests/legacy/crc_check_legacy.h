@@ -0,0 +1,46 @@
+/****************************************************************************
+ *                                                                          *
+ *  Copyright (C) 2022 RoboMaster.                                          *
+ *  Illini RoboMaster @ University of Illinois at Urbana-Champaign          *
+ *                                                                          *
+ *  This program is free software: you can redistribute it and/or modify    *
+ *  it under the terms of the GNU General Public License as published by    *
+ *  the Free Software Foundation, either version 3 of the License, or       *
+ *  (at your option) any later version.                                     *
+ *                                                                          *
+ *  This program is distributed in the hope that it will be useful,         *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *  GNU General Public License for more details.                            *
+ *                                                                          *
+ *  You should have received a copy of the GNU General Public License       *
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.    *
+ *                                                                          *
+ ****************************************************************************/
+
+#ifndef _CRC_CHECK_LEGACY_H_
+#define _CRC_CHECK_LEGACY_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+uint8_t legacy_get_crc8_check_sum(const uint8_t* pchMessage, uint16_t dwLength, uint8_t ucCRC8);
+
+uint8_t legacy_verify_crc8_check_sum(const uint8_t* pchMessage, uint16_t dwLength);
+
+void legacy_append_crc8_check_sum(uint8_t* pchMessage, uint16_t dwLength);
+
+uint16_t legacy_get_crc16_check_sum(const uint8_t* pchMessage, uint32_t dwLength, uint16_t wCRC);
+
+uint8_t legacy_verify_crc16_check_sum(const uint8_t* pchMessage, uint32_t dwLength);
+
+void legacy_append_crc16_check_sum(uint8_t* pchMessage, uint32_t dwLength);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
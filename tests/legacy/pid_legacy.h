@@ -0,0 +1,374 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// 改为模板和批量实现之前的ConstrainedPID，放在legacy命名空间里，作为等价性测试的参考
+// ConstrainedPID before the template and batched versions, in the legacy namespace, the reference
+// of the equivalence tests
+
+#pragma once
+
+#include "main.h"
+
+namespace legacy {
+
+    /**
+     * @brief 带有积分输出限制的PID控制器，又名复杂PID控制器
+     * @note
+     * 该PID控制器支持的功能有：积分输出限制、微分先行、梯形积分、输出滤波、变积分、微分滤波、异常处理
+     * 具体功能实现请打开此链接：https://www.cnblogs.com/WangHongxi/p/12404424.html
+     * 本PID类是基于此链接的代码进行移植的
+     */
+    /**
+     * @brief PID controller with integral output constraint, also known as
+     * complex PID controller
+     * @note this PID controller supports the following features: integral output
+     * constraint, derivative on measurement, trapezoid integral, output filtering,
+     * changing integral rate, derivative filtering, error handling
+     * For specific implementation, please refer to this link:
+     * https://www.cnblogs.com/WangHongxi/p/12404424.html
+     */
+    class ConstrainedPID {
+      public:
+        /**
+         * @brief PID控制器的模式
+         * @details 用于控制PID控制器的行为，可以决定每个功能的开关
+         */
+        enum pid_mode {
+            NONE = 0X00,                         /// 无
+            Integral_Limit = 0x01,               /// 积分限幅
+            Derivative_On_Measurement = 0x02,    /// 微分先行
+            Trapezoid_Intergral = 0x04,          /// 梯形积分
+            Proportional_On_Measurement = 0x08,  /// 该系列不涉及
+            OutputFilter = 0x10,                 /// 输出滤波
+            ChangingIntegralRate = 0x20,         /// 变积分
+            DerivativeFilter = 0x40,             /// 微分滤波
+            ErrorHandle = 0x80,                  /// 异常处理
+        };
+
+        /**
+         * @brief PID控制器的错误类型
+         * @details 用于记录PID控制器的错误类型
+         */
+        enum pid_error_type {
+            PID_ERROR_NONE = 0x00U,  /// 没错误
+            Motor_Blocked = 0x01U    /// 电机被卡住
+        };
+
+        /**
+         * @brief PID控制器的错误处理类型
+         * @details 用于统计持续出错的时间
+         */
+        typedef struct {
+            uint64_t error_count;
+            pid_error_type error_type;
+        } PID_ErrorHandler_t;
+
+        typedef void (*PID_ErrorCallback_t)(void* instance, PID_ErrorHandler_t error);
+
+        /**
+         * @brief PID控制器的初始化结构体
+         * @details 用于初始化PID控制器
+         */
+        typedef struct {
+            float kp;  /// 比例系数
+            float ki;  /// 积分系数
+            float kd;  /// 微分系数
+
+            float max_out;   /// 输出限幅
+            float max_iout;  /// 积分输出限幅
+            float deadband;  /// 死区
+            /// 变速积分
+            float A;                                 /// 变速积分所能达到的最大值为A+B
+            float B;                                 /// 启动变速积分的死区
+            float output_filtering_coefficient;      /// 输出滤波系数
+            float derivative_filtering_coefficient;  /// 微分滤波系数
+            uint8_t mode;                            /// PID控制器的模式
+        } PID_Init_t;
+
+        /**
+         * @brief State()函数的返回值，用于获取PID控制器的状态
+         * */
+        typedef struct {
+            float error;   /// 误差
+            float pout;    /// 比例输出
+            float iout;    /// 积分输出
+            float dout;    /// 微分输出
+            float output;  /// 输出值
+        } PID_State_t;
+
+        /**
+         * @brief PID控制器默认构造函数
+         */
+        /**
+         * @brief PID controller default constructor
+         */
+        ConstrainedPID();
+        /**
+         * @brief PID控制器构造函数
+         *
+         * @param kp 比例增益
+         * @param ki 积分增益
+         * @param kd 微分增益
+         * @param max_iout 积分输出限制
+         * @param max_out 输出限制
+         */
+        /**
+         * @brief PID controller constructor
+         *
+         * @param kp proportional gain
+         * @param ki integral gain
+         * @param kd derivative gain
+         * @param max_iout integral output constraint
+         * @param max_out output constraint
+         */
+        ConstrainedPID(float kp, float ki, float kd, float max_iout, float max_out);
+
+        /**
+         * @brief PID控制器构造函数
+         *
+         * @param param PID控制器的增益，格式为[kp, ki, kd]
+         * @param max_iout 积分输出限制
+         * @param max_out 输出限制
+         */
+        /**
+         * @brief PID controller constructor
+         *
+         * @param param gains of PID controller, formated as [kp, ki, kd]
+         * @param max_iout integral output constraint
+         * @param max_out output constraint
+         */
+        ConstrainedPID(float* param, float max_iout, float max_out);
+
+        /**
+         * @brief 使用结构体的PID控制器构造函数
+         * @param pid_init PID控制器的初始化结构体
+         */
+        explicit ConstrainedPID(PID_Init_t pid_init);
+
+        /**
+         * @brief 根据当前误差计算输出
+         *
+         * @param target 目标值
+         * @param measure 当前实际值
+         * @return 可以将误差驱动到0的输出值
+         */
+        float ComputeOutput(float target, float measure = 0);
+
+        /**
+         * @brief 根据当前误差和距上次调用的时间间隔计算输出
+         *
+         * @param target 目标值
+         * @param measure 当前实际值
+         * @param dt 距上次调用的时间间隔，单位为 [s]
+         * @return 可以将误差驱动到0的输出值
+         *
+         * @note 仅在调用SetControlPeriod()设置了整定周期后生效，否则与不带dt的版本完全相同。
+         * 积分项按 dt / 整定周期 缩放，微分项按 整定周期 / dt 缩放，
+         * 因此同一组参数在不同控制频率下的闭环响应一致。
+         * 第一次调用和dt异常（小于0.1倍或大于5倍整定周期）时按整定周期积分并跳过本次微分
+         */
+        /**
+         * @brief compute output base on current error and the time elapsed since the last call
+         *
+         * @param target target value
+         * @param measure measured value
+         * @param dt time since the last call in [s]
+         * @return output value that could potentially drive the error to 0
+         *
+         * @note only takes effect after SetControlPeriod() is called, otherwise it is identical to
+         * the version without dt. The integral term is scaled by dt / tuned period and the
+         * derivative term by tuned period / dt, so the same gains give the same closed loop
+         * response at any control rate. On the first call and for outliers (below 0.1 or above 5
+         * times the tuned period) the integral uses the tuned period and the derivative is skipped
+         * once.
+         */
+        float ComputeOutput(float target, float measure, float dt);
+
+        /**
+         * @brief 根据当前误差和时间戳计算输出
+         *
+         * @param target 目标值
+         * @param measure 当前实际值
+         * @param timestamp_us 当前时间戳，单位为 [us]，允许溢出回绕
+         * @return 可以将误差驱动到0的输出值
+         */
+        /**
+         * @brief compute output base on current error and a timestamp
+         *
+         * @param target target value
+         * @param measure measured value
+         * @param timestamp_us current time in [us], wrap around is handled
+         * @return output value that could potentially drive the error to 0
+         */
+        float ComputeOutputWithTimestamp(float target, float measure, uint32_t timestamp_us);
+
+        /**
+         * @brief 设置参数整定时的控制周期，开启按实际时间间隔计算积分和微分
+         * @param period 整定周期，单位为 [s]，为0时关闭（默认，兼容旧的按调用次数计算的行为）
+         */
+        /**
+         * @brief set the control period the gains were tuned at, enabling dt aware integral and
+         * derivative terms
+         * @param period tuned period in [s], 0 disables it (default, legacy per call behavior)
+         */
+        void SetControlPeriod(float period);
+
+        /**
+         * @brief 根据当前误差计算输出，但输出值被限制在DJI电机的范围内（适用于DJI电机输出）
+         * @param target 目标值
+         * @param measure 当前实际值
+         * @return 可以将误差驱动到0的输出值，被限制在-30000到30000之间
+         */
+        int16_t ComputeConstrainedOutput(float error);
+
+        /**
+         * @brief 重新初始化PID控制器，但不清除当前状态
+         *
+         * @param kp 新的比例增益
+         * @param ki 新的积分增益
+         * @param kd 新的微分增益
+         *
+         * @param max_iout 积分输出限制
+         * @param max_out 输出限制
+         */
+        void Reinit(float kp, float ki, float kd, float max_iout, float max_out);
+
+        /**
+         * @brief 重新初始化PID控制器，但不清除当前状态
+         *
+         * @param param PID控制器的增益，格式为[kp, ki, kd]
+         *
+         * @param max_iout 积分输出限制
+         * @param max_out 输出限制
+         */
+        void Reinit(float* param, float max_iout, float max_out);
+
+        /**
+         * @brief 使用结构体的PID控制器重新初始化，但不清除当前状态
+         * @param pid_init PID控制器的初始化结构体
+         */
+        void Reinit(PID_Init_t pid_init);
+
+        /**
+         * @brief 清除PID控制器的状态
+         */
+        /**
+         * @brief clear the remembered states of the controller
+         */
+        void Reset();
+
+        /**
+         * @brief 修改PID控制器的输出限制
+         * @param max_iout 积分输出限制
+         * @param max_out 输出限制
+         */
+        /**
+         * @brief change the output constraint of the controller
+         * @param max_iout integral output constraint
+         * @param max_out output constraint
+         */
+        void ChangeMax(float max_iout, float max_out);
+
+        PID_State_t State() const;
+
+        /**
+         * @brief 重设积分项
+         */
+        void ResetIntegral();
+
+        void RegisterErrorCallcack(PID_ErrorCallback_t callback, void* instance);
+
+      private:
+        float target_ = 0.0f;                 /// 目标值
+        float last_none_zero_target_ = 0.0f;  /// 上一次非零目标值
+        float kp_ = 0.0f;                     /// 比例系数
+        float ki_ = 0.0f;                     /// 积分系数
+        float kd_ = 0.0f;                     /// 微分系数
+
+        float pout_ = 0.0f;   /// 比例输出
+        float iout_ = 0.0f;   /// 积分输出
+        float dout_ = 0.0f;   /// 微分输出
+        float iterm_ = 0.0f;  /// 积分临时变量
+
+        float measure_ = 0.0f;       /// 当前实际值
+        float last_measure_ = 0.0f;  /// 上一次实际值
+
+        float error_ = 0.0f;       /// 误差
+        float last_error_ = 0.0f;  /// 上一次误差
+
+        float output_ = 0.0f;       /// 输出值
+        float last_output_ = 0.0f;  /// 上一次输出值
+        float last_dout_ = 0.0f;    /// 上一次微分输出
+
+        float max_iout_ = 0.0f;        /// 积分输出限制
+        float max_out_ = 0.0f;         /// 输出限制
+        float dead_band_ = 0.0f;       /// 死区
+        float control_period_ = 0.0f;  /// 控制周期
+        float max_error_ = 0.0f;       /// 最大误差
+
+        float ScalarA = 0.0f;  /// For Changing Integral
+        float ScalarB = 0.0f;  /// ITerm = Err*((A-abs(err)+B)/A)  when B<|err|<A+B
+        float Output_Filtering_Coefficient = 0.0f;      /// 输出滤波系数
+        float Derivative_Filtering_Coefficient = 0.0f;  /// 微分滤波系数
+
+        uint32_t thistime = 0;  /// 本次调用的时间戳 [us]
+        uint32_t lasttime = 0;  /// 上一次调用的时间戳 [us]
+        float dtime = 0.0f;     /// 本次使用的时间间隔 [s]
+
+        float integral_scale_ = 1.0f;    /// 积分项的时间缩放系数
+        float derivative_scale_ = 1.0f;  /// 微分项的时间缩放系数
+        bool derivative_ready_ = false;  /// 是否已有可用于计算微分的上一次数据
+        bool timestamp_ready_ = false;   /// 是否已有上一次的时间戳
+
+        uint8_t mode_ = 0x00;  /// PID控制器的模式
+
+        PID_ErrorHandler_t PID_ErrorHandler = {
+            .error_count = 0,
+            .error_type = PID_ERROR_NONE,
+        };
+
+        PID_ErrorCallback_t error_callback_ = [](void* instance, PID_ErrorHandler_t error) {
+            UNUSED(instance);
+            UNUSED(error);
+        };
+        void* error_callback_instance_ = nullptr;
+
+        float Compute(float target, float measure);
+
+        void PID_ErrorHandle();
+
+        void PID_TrapezoidIntegral();
+
+        void PID_ChangingIntegralRate();
+
+        void PID_IntegralLimit();
+
+        void PID_DerivativeOnMeasurement();
+
+        void PID_OutputFilter();
+
+        void PID_DerivativeFilter();
+
+        void PID_OutputLimit();
+
+        void PID_ProportionLimit();
+    };
+
+} /* namespace legacy */
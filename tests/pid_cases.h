@@ -0,0 +1,110 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// PID测试共用的参数和被控对象 / parameters and plant shared by the PID tests
+
+#pragma once
+
+#include <string.h>
+
+#include "pid.h"
+#include "pid_legacy.h"
+#include "test.h"
+
+namespace test {
+
+    typedef control::ConstrainedPID::PID_Init_t pid_init_t;
+
+    /**
+     * @brief 随机的PID参数，范围覆盖底盘、云台和拨弹电机的实际参数
+     */
+    /**
+     * @brief random PID parameters, the ranges cover the actual chassis, gimbal and loader gains
+     */
+    inline pid_init_t RandomPIDInit(Random* random, uint8_t mode) {
+        return pid_init_t{
+            .kp = random->Uniform(0, 50),
+            .ki = random->Uniform(0, 2),
+            .kd = random->Uniform(0, 20),
+            .max_out = random->Uniform(10, 30000),
+            .max_iout = random->Uniform(1, 10000),
+            .deadband = random->Uniform(0, 0.2f),
+            .A = random->Uniform(0.1f, 5),
+            .B = random->Uniform(0, 3),
+            .output_filtering_coefficient = random->Uniform(0, 1),
+            .derivative_filtering_coefficient = random->Uniform(0, 1),
+            .mode = mode,
+        };
+    }
+
+    inline legacy::ConstrainedPID::PID_Init_t ToLegacy(const pid_init_t& init) {
+        return legacy::ConstrainedPID::PID_Init_t{
+            .kp = init.kp,
+            .ki = init.ki,
+            .kd = init.kd,
+            .max_out = init.max_out,
+            .max_iout = init.max_iout,
+            .deadband = init.deadband,
+            .A = init.A,
+            .B = init.B,
+            .output_filtering_coefficient = init.output_filtering_coefficient,
+            .derivative_filtering_coefficient = init.derivative_filtering_coefficient,
+            .mode = init.mode,
+        };
+    }
+
+    /**
+     * @brief 一阶惯性的被控对象，输出按比例缩放到被控量的量级
+     */
+    /**
+     * @brief first order lag plant, the output is scaled to the magnitude of the measurement
+     */
+    class Plant {
+      public:
+        explicit Plant(float gain = 0.001f) : gain_(gain) {
+        }
+
+        float Step(float output) {
+            value_ += (output * gain_ - value_) * 0.1f;
+            return value_;
+        }
+
+        float Value() const {
+            return value_;
+        }
+
+      private:
+        float gain_;
+        float value_ = 0;
+    };
+
+    // 目标每100步在随机值和常数之间切换 / the target switches between random and constant values
+    // every 100 steps
+    inline float Target(Random* random, int step) {
+        return step % 200 < 100 ? random->Uniform(-20, 20) : 5;
+    }
+
+    template <typename A, typename B>
+    inline bool SameBits(const A& a, const B& b) {
+        static_assert(sizeof(A) == sizeof(B), "different sizes");
+        return memcmp(&a, &b, sizeof(A)) == 0;
+    }
+
+}  // namespace test
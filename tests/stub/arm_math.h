@@ -0,0 +1,294 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// 主机测试用的arm_math.h，按CMSIS-DSP中不使用DSP扩展的参考实现编写，只包含算法库和旧的
+// kalman_filter.c用到的函数
+// arm_math.h for the host tests, written after the CMSIS-DSP reference code without the DSP
+// extension, with only the functions the algorithm library and the old kalman_filter.c use
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PI 3.14159265358979f
+
+typedef float float32_t;
+typedef int16_t q15_t;
+typedef int32_t q31_t;
+typedef int64_t q63_t;
+
+typedef enum {
+    ARM_MATH_SUCCESS = 0,
+    ARM_MATH_ARGUMENT_ERROR = -1,
+    ARM_MATH_LENGTH_ERROR = -2,
+    ARM_MATH_SIZE_MISMATCH = -3,
+    ARM_MATH_NANINF = -4,
+    ARM_MATH_SINGULAR = -5,
+    ARM_MATH_TEST_FAILURE = -6
+} arm_status;
+
+static inline int32_t __SSAT(int64_t value, uint32_t bits) {
+    const int64_t max = ((int64_t)1 << (bits - 1)) - 1;
+    const int64_t min = -max - 1;
+    return (int32_t)(value > max ? max : value < min ? min : value);
+}
+
+static inline q31_t clip_q63_to_q31(q63_t x) {
+    return (q31_t)__SSAT(x, 32);
+}
+
+static inline float32_t arm_sin_f32(float32_t x) {
+    return sinf(x);
+}
+
+static inline float32_t arm_cos_f32(float32_t x) {
+    return cosf(x);
+}
+
+static inline arm_status arm_sqrt_f32(float32_t in, float32_t* out) {
+    if (in >= 0) {
+        *out = sqrtf(in);
+        return ARM_MATH_SUCCESS;
+    }
+    *out = 0;
+    return ARM_MATH_ARGUMENT_ERROR;
+}
+
+/* PID ------------------------------------------------------------------------------------------*/
+
+typedef struct {
+    float32_t A0;
+    float32_t A1;
+    float32_t A2;
+    float32_t state[3];
+    float32_t Kp;
+    float32_t Ki;
+    float32_t Kd;
+} arm_pid_instance_f32;
+
+typedef struct {
+    q15_t A0;
+    q15_t A1;
+    q15_t A2;
+    q15_t state[3];
+    q15_t Kp;
+    q15_t Ki;
+    q15_t Kd;
+} arm_pid_instance_q15;
+
+typedef struct {
+    q31_t A0;
+    q31_t A1;
+    q31_t A2;
+    q31_t state[3];
+    q31_t Kp;
+    q31_t Ki;
+    q31_t Kd;
+} arm_pid_instance_q31;
+
+static inline void arm_pid_init_f32(arm_pid_instance_f32* S, int32_t resetStateFlag) {
+    S->A0 = S->Kp + S->Ki + S->Kd;
+    S->A1 = (-S->Kp) - ((float32_t)2.0 * S->Kd);
+    S->A2 = S->Kd;
+    if (resetStateFlag)
+        memset(S->state, 0, 3U * sizeof(float32_t));
+}
+
+static inline void arm_pid_init_q15(arm_pid_instance_q15* S, int32_t resetStateFlag) {
+    S->A0 = (q15_t)__SSAT((q31_t)S->Kp + S->Ki + S->Kd, 16);
+    S->A1 = (q15_t)__SSAT(-((q31_t)S->Kd + S->Kd + S->Kp), 16);
+    S->A2 = S->Kd;
+    if (resetStateFlag)
+        memset(S->state, 0, 3U * sizeof(q15_t));
+}
+
+static inline void arm_pid_init_q31(arm_pid_instance_q31* S, int32_t resetStateFlag) {
+    S->A0 = clip_q63_to_q31((q63_t)clip_q63_to_q31((q63_t)S->Kp + S->Ki) + S->Kd);
+    S->A1 = -clip_q63_to_q31((q63_t)clip_q63_to_q31((q63_t)S->Kd + S->Kd) + S->Kp);
+    S->A2 = S->Kd;
+    if (resetStateFlag)
+        memset(S->state, 0, 3U * sizeof(q31_t));
+}
+
+static inline float32_t arm_pid_f32(arm_pid_instance_f32* S, float32_t in) {
+    const float32_t out =
+        (S->A0 * in) + (S->A1 * S->state[0]) + (S->A2 * S->state[1]) + (S->state[2]);
+    S->state[1] = S->state[0];
+    S->state[0] = in;
+    S->state[2] = out;
+    return out;
+}
+
+static inline q31_t arm_pid_q31(arm_pid_instance_q31* S, q31_t in) {
+    q63_t acc = (q63_t)S->A0 * in;
+    acc += (q63_t)S->A1 * S->state[0];
+    acc += (q63_t)S->A2 * S->state[1];
+    q31_t out = (q31_t)(acc >> 31U);
+    out += S->state[2];
+    S->state[1] = S->state[0];
+    S->state[0] = in;
+    S->state[2] = out;
+    return out;
+}
+
+static inline q15_t arm_pid_q15(arm_pid_instance_q15* S, q15_t in) {
+    q63_t acc = ((q31_t)S->A0) * in;
+    acc += (q31_t)S->A1 * S->state[0];
+    acc += (q31_t)S->A2 * S->state[1];
+    acc += (q31_t)S->state[2] << 15;
+    const q15_t out = (q15_t)__SSAT(acc >> 15, 16);
+    S->state[1] = S->state[0];
+    S->state[0] = in;
+    S->state[2] = out;
+    return out;
+}
+
+/* 滤波 / filtering -----------------------------------------------------------------------------*/
+
+// 与CMSIS-DSP相同的声明，定义在板子上的arm_biquad_cascade_df2T_f32.c中，只有按ARM_MATH_CM4编译的
+// 测试链接它
+// declared as in CMSIS-DSP and defined in arm_biquad_cascade_df2T_f32.c of the boards, which only
+// the tests built with ARM_MATH_CM4 link
+
+#define LOW_OPTIMIZATION_ENTER
+#define LOW_OPTIMIZATION_EXIT
+
+typedef struct {
+    uint8_t numStages;
+    float32_t* pState;
+    float32_t* pCoeffs;
+} arm_biquad_cascade_df2T_instance_f32;
+
+void arm_biquad_cascade_df2T_f32(const arm_biquad_cascade_df2T_instance_f32* S, float32_t* pSrc,
+                                 float32_t* pDst, uint32_t blockSize);
+
+/* 矩阵 / matrix --------------------------------------------------------------------------------*/
+
+typedef struct {
+    uint16_t numRows;
+    uint16_t numCols;
+    float32_t* pData;
+} arm_matrix_instance_f32;
+
+static inline void arm_mat_init_f32(arm_matrix_instance_f32* S, uint16_t nRows, uint16_t nColumns,
+                                    float32_t* pData) {
+    S->numRows = nRows;
+    S->numCols = nColumns;
+    S->pData = pData;
+}
+
+static inline arm_status arm_mat_add_f32(const arm_matrix_instance_f32* pSrcA,
+                                         const arm_matrix_instance_f32* pSrcB,
+                                         arm_matrix_instance_f32* pDst) {
+    for (int i = 0; i < pSrcA->numRows * pSrcA->numCols; ++i)
+        pDst->pData[i] = pSrcA->pData[i] + pSrcB->pData[i];
+    return ARM_MATH_SUCCESS;
+}
+
+static inline arm_status arm_mat_sub_f32(const arm_matrix_instance_f32* pSrcA,
+                                         const arm_matrix_instance_f32* pSrcB,
+                                         arm_matrix_instance_f32* pDst) {
+    for (int i = 0; i < pSrcA->numRows * pSrcA->numCols; ++i)
+        pDst->pData[i] = pSrcA->pData[i] - pSrcB->pData[i];
+    return ARM_MATH_SUCCESS;
+}
+
+static inline arm_status arm_mat_mult_f32(const arm_matrix_instance_f32* pSrcA,
+                                          const arm_matrix_instance_f32* pSrcB,
+                                          arm_matrix_instance_f32* pDst) {
+    if (pSrcA->numCols != pSrcB->numRows)
+        return ARM_MATH_SIZE_MISMATCH;
+    for (int i = 0; i < pSrcA->numRows; ++i)
+        for (int j = 0; j < pSrcB->numCols; ++j) {
+            float32_t sum = 0;
+            for (int k = 0; k < pSrcA->numCols; ++k)
+                sum += pSrcA->pData[i * pSrcA->numCols + k] * pSrcB->pData[k * pSrcB->numCols + j];
+            pDst->pData[i * pSrcB->numCols + j] = sum;
+        }
+    return ARM_MATH_SUCCESS;
+}
+
+static inline arm_status arm_mat_trans_f32(const arm_matrix_instance_f32* pSrc,
+                                           arm_matrix_instance_f32* pDst) {
+    for (int i = 0; i < pSrc->numRows; ++i)
+        for (int j = 0; j < pSrc->numCols; ++j)
+            pDst->pData[j * pSrc->numRows + i] = pSrc->pData[i * pSrc->numCols + j];
+    return ARM_MATH_SUCCESS;
+}
+
+// 带列主元的高斯-约当消元，与CMSIS相同 / Gauss-Jordan elimination with partial pivoting as in
+// CMSIS
+static inline arm_status arm_mat_inverse_f32(const arm_matrix_instance_f32* pSrc,
+                                             arm_matrix_instance_f32* pDst) {
+    enum { MAX_SIZE = 8 };
+    const int n = pSrc->numRows;
+    if (n != pSrc->numCols || n > MAX_SIZE)
+        return ARM_MATH_SIZE_MISMATCH;
+    float32_t a[MAX_SIZE][MAX_SIZE], inv[MAX_SIZE][MAX_SIZE];
+    for (int i = 0; i < n; ++i)
+        for (int j = 0; j < n; ++j) {
+            a[i][j] = pSrc->pData[i * n + j];
+            inv[i][j] = i == j ? 1.0f : 0.0f;
+        }
+    for (int c = 0; c < n; ++c) {
+        int pivot = c;
+        for (int r = c + 1; r < n; ++r)
+            if (fabsf(a[r][c]) > fabsf(a[pivot][c]))
+                pivot = r;
+        if (a[pivot][c] == 0)
+            return ARM_MATH_SINGULAR;
+        for (int k = 0; k < n; ++k) {
+            float32_t t = a[c][k];
+            a[c][k] = a[pivot][k];
+            a[pivot][k] = t;
+            t = inv[c][k];
+            inv[c][k] = inv[pivot][k];
+            inv[pivot][k] = t;
+        }
+        const float32_t d = a[c][c];
+        for (int k = 0; k < n; ++k) {
+            a[c][k] /= d;
+            inv[c][k] /= d;
+        }
+        for (int r = 0; r < n; ++r) {
+            if (r == c)
+                continue;
+            const float32_t f = a[r][c];
+            for (int k = 0; k < n; ++k) {
+                a[r][k] -= f * a[c][k];
+                inv[r][k] -= f * inv[c][k];
+            }
+        }
+    }
+    for (int i = 0; i < n; ++i)
+        for (int j = 0; j < n; ++j)
+            pDst->pData[i * n + j] = inv[i][j];
+    return ARM_MATH_SUCCESS;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,37 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// 主机上断言失败直接退出 / failed assertions exit on the host
+
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define RM_ASSERT_TRUE(cond, msg)                                                 \
+    do {                                                                          \
+        if (!(cond)) {                                                            \
+            printf("%s:%d: assertion failed: %s\n", __FUNCTION__, __LINE__, msg); \
+            exit(1);                                                              \
+        }                                                                         \
+    } while (0)
+#define RM_ASSERT_FALSE(cond, msg) RM_ASSERT_TRUE(!(cond), msg)
+#define RM_EXPECT_TRUE(cond, msg) (void)(cond)
+#define RM_EXPECT_FALSE(cond, msg) (void)(cond)
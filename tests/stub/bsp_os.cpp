@@ -0,0 +1,43 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#include "bsp_os.h"
+
+namespace bsp {
+
+    static uint64_t highres_tick_us = 0;
+
+    uint64_t GetHighresTickMicroSec(void) {
+        return highres_tick_us;
+    }
+
+    uint32_t GetHighresTickMilliSec(void) {
+        return highres_tick_us / 1000;
+    }
+
+    void SetHighresTickMicroSec(uint64_t time) {
+        highres_tick_us = time;
+    }
+
+}  // namespace bsp
+
+uint32_t HAL_GetTick(void) {
+    return bsp::GetHighresTickMilliSec();
+}
@@ -0,0 +1,36 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// 主机上的时钟由测试设定 / the clock on the host is set by the tests
+
+#pragma once
+
+#include "main.h"
+
+namespace bsp {
+
+    uint64_t GetHighresTickMicroSec(void);
+
+    uint32_t GetHighresTickMilliSec(void);
+
+    // 只在主机上存在 / host only
+    void SetHighresTickMicroSec(uint64_t time);
+
+}  // namespace bsp
@@ -0,0 +1,35 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+#include "bsp_print.h"
+
+namespace bsp {
+
+    std::vector<uint8_t>& PrintedRaw() {
+        static std::vector<uint8_t> printed;
+        return printed;
+    }
+
+}  // namespace bsp
+
+int32_t print_raw(const uint8_t* data, uint32_t length) {
+    bsp::PrintedRaw().insert(bsp::PrintedRaw().end(), data, data + length);
+    return length;
+}
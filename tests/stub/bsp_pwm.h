@@ -0,0 +1,57 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// 主机上的PWM只记录最近一次设置的脉宽 / the host PWM only keeps the last pulse width set
+
+#pragma once
+
+#include "main.h"
+
+typedef struct {
+    int instance;
+} TIM_HandleTypeDef;
+
+namespace bsp {
+
+    class PWM {
+      public:
+        PWM(TIM_HandleTypeDef* htim, uint8_t channel, uint32_t clock_freq, uint32_t output_freq,
+            uint32_t pulse_width)
+            : pulse_width(pulse_width) {
+            (void)htim;
+            (void)channel;
+            (void)clock_freq;
+            (void)output_freq;
+        }
+
+        void Start() {
+        }
+
+        void Stop() {
+        }
+
+        void SetPulseWidth(uint32_t pulse_width) {
+            this->pulse_width = pulse_width;
+        }
+
+        uint32_t pulse_width;
+    };
+
+}  // namespace bsp
@@ -0,0 +1,67 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// 主机上的线程不会运行，协议驱动只需要能构造 / threads never run on the host, the protocol
+// drivers only need to construct them
+
+#pragma once
+
+#include "cmsis_os.h"
+#include "main.h"
+
+namespace bsp {
+
+    typedef void (*thread_func_t)(void* args);
+
+    typedef struct {
+        thread_func_t func;
+        void* args;
+        osThreadAttr_t attr;
+    } thread_init_t;
+
+    class Thread {
+      public:
+        Thread(thread_init_t init) : init_(init) {
+        }
+
+        virtual ~Thread() = default;
+
+        virtual void Start() {
+        }
+
+        void Set(uint32_t signal = 0) {
+            (void)signal;
+        }
+
+        void* GetArgs() {
+            return init_.args;
+        }
+
+      protected:
+        thread_init_t init_;
+    };
+
+    class EventThread : public Thread {
+      public:
+        EventThread(thread_init_t init) : Thread(init) {
+        }
+    };
+
+}  // namespace bsp
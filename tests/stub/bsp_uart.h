@@ -0,0 +1,58 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// 主机上的串口把写出的数据存起来给测试检查 / the host UART keeps what is written for the
+// tests to check
+
+#pragma once
+
+#include <vector>
+
+#include "main.h"
+
+namespace bsp {
+
+    typedef void (*uart_rx_callback_t)(void* args);
+
+    class UART {
+      public:
+        int32_t Write(const uint8_t* data, uint32_t length) {
+            // 发送缓冲区满时只写入一部分 / only part is written when the tx buffer is full
+            if (length > tx_space)
+                length = tx_space;
+            written.insert(written.end(), data, data + length);
+            return length;
+        }
+
+        void SetupRxData(uint8_t** rx_ptr, uint32_t* rx_len) {
+            (void)rx_ptr;
+            (void)rx_len;
+        }
+
+        void RegisterCallback(uart_rx_callback_t callback, void* args) {
+            (void)callback;
+            (void)args;
+        }
+
+        std::vector<uint8_t> written;
+        uint32_t tx_space = UINT32_MAX;
+    };
+
+}  // namespace bsp
@@ -0,0 +1,43 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// 主机上的USB虚拟串口把写出的数据存起来给测试检查 / the host USB virtual com port keeps what
+// is written for the tests to check
+
+#pragma once
+
+#include <vector>
+
+#include "main.h"
+
+namespace bsp {
+
+    class VirtualUSB {
+      public:
+        template <bool FromISR = false>
+        uint32_t Write(uint8_t* data, uint32_t length) {
+            written.insert(written.end(), data, data + length);
+            return length;
+        }
+
+        std::vector<uint8_t> written;
+    };
+
+}  // namespace bsp
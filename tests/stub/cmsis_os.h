@@ -0,0 +1,74 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// CMSIS-RTOS2的主机替身，只有驱动和日志用到的部分
+// host stand-in for CMSIS-RTOS2, only what the drivers and the logger use
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define pvPortMalloc malloc
+
+#define osThreadDetached 0x00000000U
+
+typedef void* osThreadId_t;
+
+typedef enum {
+    osOK = 0,
+} osStatus_t;
+
+static inline osStatus_t osDelay(uint32_t ticks) {
+    (void)ticks;
+    return osOK;
+}
+
+static inline uint32_t osKernelGetTickCount(void) {
+    return 0;
+}
+
+static inline osStatus_t osDelayUntil(uint32_t ticks) {
+    (void)ticks;
+    return osOK;
+}
+
+typedef enum {
+    osPriorityNone = 0,
+    osPriorityIdle = 1,
+    osPriorityLow = 8,
+    osPriorityBelowNormal = 16,
+    osPriorityNormal = 24,
+    osPriorityAboveNormal = 32,
+    osPriorityHigh = 40,
+    osPriorityRealtime = 48,
+} osPriority_t;
+
+typedef struct {
+    const char* name;
+    uint32_t attr_bits;
+    void* cb_mem;
+    uint32_t cb_size;
+    void* stack_mem;
+    uint32_t stack_size;
+    osPriority_t priority;
+    uint32_t tz_module;
+    uint32_t reserved;
+} osThreadAttr_t;
@@ -0,0 +1,170 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// 主机测试的公共工具：检查宏、简单的随机数和计时
+// common helpers of the host tests: check macros, a simple random generator and timing
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace test {
+
+    inline int& Failures() {
+        static int failures = 0;
+        return failures;
+    }
+
+    /**
+     * @brief 打印结果，有检查失败时返回非0，作为main的返回值
+     */
+    /**
+     * @brief print the result and return non-zero on any failed check, used as the return value
+     * of main
+     */
+    inline int Finish() {
+        if (Failures() == 0) {
+            printf("all checks passed\n");
+            return 0;
+        }
+        printf("%d check(s) failed\n", Failures());
+        return 1;
+    }
+
+    /**
+     * @brief 固定种子的xorshift随机数，保证每次运行的输入相同
+     */
+    /**
+     * @brief xorshift random numbers with a fixed seed so every run sees the same input
+     */
+    class Random {
+      public:
+        explicit Random(uint32_t seed = 1) : state_(seed != 0 ? seed : 1) {
+        }
+
+        uint32_t Next() {
+            state_ ^= state_ << 13;
+            state_ ^= state_ >> 17;
+            state_ ^= state_ << 5;
+            return state_;
+        }
+
+        // [lo, hi)内的均匀分布 / uniform in [lo, hi)
+        float Uniform(float lo, float hi) {
+            return lo + (hi - lo) * (Next() >> 8) * (1.0f / 16777216.0f);
+        }
+
+        // 均值为0的正态分布 / zero mean normal distribution
+        float Normal(float sigma) {
+            float sum = 0;
+            for (int i = 0; i < 12; ++i)
+                sum += Uniform(0, 1);
+            return (sum - 6) * sigma;
+        }
+
+      private:
+        uint32_t state_;
+    };
+
+    /**
+     * @brief 计时器，x86上同时读取时间戳计数器作为周期数的近似
+     */
+    /**
+     * @brief stopwatch, also reading the time stamp counter on x86 as an estimate of cycles
+     */
+    class Stopwatch {
+      public:
+        Stopwatch() {
+            Restart();
+        }
+
+        void Restart() {
+            start_ = std::chrono::steady_clock::now();
+            start_ticks_ = Ticks();
+        }
+
+        double Nanoseconds() const {
+            return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() -
+                                                            start_)
+                .count();
+        }
+
+        // 没有时间戳计数器时返回0 / 0 without a time stamp counter
+        double Cycles() const {
+            return (double)(Ticks() - start_ticks_);
+        }
+
+      private:
+        static uint64_t Ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#else
+            return 0;
+#endif
+        }
+
+        std::chrono::steady_clock::time_point start_;
+        uint64_t start_ticks_;
+    };
+
+    /**
+     * @brief 打印每次调用的平均耗时，基准测试只打印结果，不作为检查条件
+     */
+    /**
+     * @brief print the average cost of a call, benchmarks only report and never fail a test
+     */
+    inline void Report(const char* name, const Stopwatch& stopwatch, long calls) {
+        printf("  %-40s %8.1f ns/call %8.1f cycles/call\n", name, stopwatch.Nanoseconds() / calls,
+               stopwatch.Cycles() / calls);
+    }
+
+    // 防止编译器把基准测试的结果优化掉 / keeps benchmark results from being optimized away
+    template <typename T>
+    inline void Consume(const T& value) {
+        asm volatile("" : : "g"(&value) : "memory");
+    }
+
+}  // namespace test
+
+#define CHECK(condition)                                                           \
+    do {                                                                           \
+        if (!(condition)) {                                                        \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);   \
+            ++test::Failures();                                                    \
+        }                                                                          \
+    } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance)                                              \
+    do {                                                                                     \
+        const double actual_ = (actual), expected_ = (expected);                             \
+        if (!(fabs(actual_ - expected_) <= (tolerance))) {                                   \
+            printf("%s:%d: CHECK_NEAR(%s, %s, %s) failed: %.9g vs %.9g\n", __FILE__, __LINE__, \
+                   #actual, #expected, #tolerance, actual_, expected_);                      \
+            ++test::Failures();                                                              \
+        }                                                                                    \
+    } while (0)
@@ -0,0 +1,339 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// AdaptiveNotch的测试：合成的陀螺仪数据中有2Hz和7Hz的转动、白噪声、从60Hz扫到180Hz的摩擦轮振动
+// 和在95Hz附近漂移的底盘振动，分别由电机转速和频谱分析调节陷波器，测量稳定后振动的衰减、转动
+// 本身的失真和频率跟踪的误差；运行时设计的系数与BiquadNotch的频响一致；陷波器在控制频段内的
+// 相位滞后与50Hz低通的比较；关闭、屏蔽其他陷波器的频率和没有振动时关闭；以及耗时
+// tests of AdaptiveNotch: synthetic gyro data with 2 Hz and 7 Hz motion, white noise, a flywheel
+// vibration swept from 60 Hz to 180 Hz and a chassis vibration drifting around 95 Hz, with the
+// notches tuned from the motor speed and from the spectrum analysis, measuring the attenuation of
+// the vibration once settled, the distortion of the motion itself and the tracking error; the
+// coefficients designed at runtime match the response of BiquadNotch; the phase lag of the
+// notches in the control band compared to a 50 Hz low pass; disabling, masking the frequencies
+// of the other notches and disabling when the vibration stops; and the cost
+
+#include <math.h>
+
+#include <complex>
+#include <initializer_list>
+
+#include "adaptive_notch.h"
+#include "test.h"
+
+using control::AdaptiveNotch;
+using control::biquad_coeff_t;
+
+namespace {
+
+    constexpr double FS = 1000;                    // [Hz]
+    constexpr double DURATION = 12;                // [s]
+    constexpr double SETTLED = 6;                  // 之后认为已经稳定 / settled after this [s]
+    constexpr int ANALYZED = AdaptiveNotch::NOTCHES - 1;  // 由频谱分析调节 / tuned by Analyze
+
+    struct scenario_t {
+        const char* name;
+        bool speed;     // 摩擦轮转速调节陷波器0 / the flywheel speed tunes notch 0
+        bool spectrum;  // 频谱分析调节陷波器 / the spectrum analysis tunes a notch
+        bool flywheel;
+        bool chassis;
+        double max_attenuation;  // 稳定后振动衰减的上限 / bound on the settled attenuation [dB]
+    };
+
+    struct result_t {
+        double attenuation;  // 稳定后振动的衰减 / attenuation of the vibration once settled [dB]
+        double distortion;   // 转动本身的均方根失真 / rms distortion of the motion [rad/s]
+        double tracking;     // 频谱分析的均方根频率误差 / rms error of the analysis [Hz]
+    };
+
+    // 摩擦轮停1秒，4秒内从60Hz加速到180Hz后保持
+    // the flywheel is off for 1 s, spins up from 60 Hz to 180 Hz over 4 s and holds
+    double FlywheelFrequency(double t) {
+        return t < 1 ? 0 : t < 5 ? 60 + 30 * (t - 1) : 180;
+    }
+
+    // 底盘轮子的振动在95Hz附近缓慢漂移 / chassis wheel vibration drifting slowly around 95 Hz
+    double ChassisFrequency(double t) {
+        return 95 + 3 * sin(2 * M_PI * 0.1 * t);
+    }
+
+    double Response(const biquad_coeff_t& k, double f, double* phase) {
+        const std::complex<double> z = std::polar(1.0, -2 * M_PI * f / FS);
+        const std::complex<double> h =
+            ((double)k.b0 + (double)k.b1 * z + (double)k.b2 * z * z) /
+            (1.0 + (double)k.a1 * z + (double)k.a2 * z * z);
+        if (phase != nullptr)
+            *phase = std::arg(h);
+        return std::abs(h);
+    }
+
+    // 稳定后正弦经过滤波器的幅值 / amplitude of a sine through the filter once settled
+    double Amplitude(AdaptiveNotch* filter, double f) {
+        constexpr int N = 4 * (int)FS;
+        double sine = 0, cosine = 0;
+        for (int n = 0; n < N; ++n) {
+            const double phase = 2 * M_PI * f * n / FS;
+            float x[3], y[3];
+            for (int a = 0; a < 3; ++a)
+                x[a] = sin(phase);
+            filter->Update(x, y);
+            if (n >= N / 2) {
+                sine += y[2] * sin(phase);
+                cosine += y[2] * cos(phase);
+            }
+        }
+        return 2 * hypot(sine, cosine) / (N / 2);
+    }
+
+    // 主滤波器处理完整的信号，另外两个按相同的频率分别只处理振动和转动，由此分开测量
+    // the main filter sees the whole signal, two replicas follow its frequencies and see only the
+    // vibration or only the motion, to measure them apart
+    result_t Run(const scenario_t& scenario) {
+        test::Random random(7);
+        AdaptiveNotch filter, vibration_filter, motion_filter;
+        double flywheel_phase = 0, chassis_phase = 0;
+        double vibration_in = 0, vibration_out = 0, distortion = 0, tracking = 0;
+        int samples = 0, tracked = 0;
+        for (int n = 0; n < (int)(DURATION * FS); ++n) {
+            const double t = n / FS;
+            const double flywheel = FlywheelFrequency(t);
+            const double chassis = ChassisFrequency(t);
+            flywheel_phase += 2 * M_PI * flywheel / FS;
+            chassis_phase += 2 * M_PI * chassis / FS;
+            float motion[3], vibration[3], input[3], output[3];
+            float vibration_output[3], motion_output[3];
+            for (int a = 0; a < 3; ++a) {
+                motion[a] = 0.8 * sin(2 * M_PI * 2 * t + a) + 0.3 * sin(2 * M_PI * 7 * t + 2 * a);
+                double v = 0;
+                if (scenario.flywheel && flywheel > 0)
+                    v += (0.4 + 0.2 * a) * sin(flywheel_phase + a);
+                if (scenario.chassis)
+                    v += (0.3 - 0.1 * a) * sin(chassis_phase + 0.5 * a);
+                vibration[a] = v;
+                input[a] = motion[a] + vibration[a] + random.Normal(0.02f);
+            }
+            // 转速的测量有0.5%的噪声 / the measured speed has 0.5% noise
+            if (scenario.speed)
+                filter.SetFrequency(0, flywheel * (1 + random.Normal(0.005f)));
+            if (scenario.spectrum)
+                filter.Analyze(scenario.speed ? ANALYZED : 0);
+            for (int i = 0; i < AdaptiveNotch::NOTCHES; ++i) {
+                vibration_filter.SetFrequency(i, filter.GetFrequency(i));
+                motion_filter.SetFrequency(i, filter.GetFrequency(i));
+            }
+            filter.Update(input, output);
+            vibration_filter.Update(vibration, vibration_output);
+            motion_filter.Update(motion, motion_output);
+            if (t < 1)
+                continue;
+            for (int a = 0; a < 3; ++a)
+                distortion += (motion_output[a] - motion[a]) * (motion_output[a] - motion[a]);
+            ++samples;
+            if (t >= SETTLED) {
+                for (int a = 0; a < 3; ++a) {
+                    vibration_in += vibration[a] * vibration[a];
+                    vibration_out += vibration_output[a] * vibration_output[a];
+                }
+                if (scenario.spectrum) {
+                    const double target = scenario.speed || !scenario.flywheel ? chassis : flywheel;
+                    const double error =
+                        filter.GetFrequency(scenario.speed ? ANALYZED : 0) - target;
+                    tracking += error * error;
+                    ++tracked;
+                }
+            }
+        }
+        result_t result;
+        result.attenuation = 10 * log10(vibration_out / vibration_in);
+        result.distortion = sqrt(distortion / (3 * samples));
+        result.tracking = tracked > 0 ? sqrt(tracking / tracked) : 0;
+        return result;
+    }
+
+}  // namespace
+
+// 四种振动和调节方式下的衰减、失真和跟踪误差
+// attenuation, distortion and tracking error for four vibrations and ways of tuning
+static void TestScenarios() {
+    const scenario_t scenarios[] = {
+        {"flywheel sweep, speed", true, false, true, false, -30},
+        {"flywheel sweep, spectrum", false, true, true, false, -30},
+        {"flywheel speed, chassis spectrum", true, true, true, true, -25},
+        {"chassis only, spectrum", false, true, false, true, -18},
+    };
+    for (const scenario_t& scenario : scenarios) {
+        const result_t result = Run(scenario);
+        printf("%-33s attenuation %6.1f dB, distortion %.4f rad/s", scenario.name,
+               result.attenuation, result.distortion);
+        if (scenario.spectrum)
+            printf(", tracking %.2f Hz", result.tracking);
+        printf("\n");
+        CHECK(result.attenuation < scenario.max_attenuation);
+        CHECK(result.distortion < 0.01);
+        CHECK(result.tracking < 1.5);
+    }
+}
+
+// 运行时用快速三角函数设计的系数与双精度的BiquadNotch频响相同
+// the coefficients designed at runtime with the fast sine match the response of BiquadNotch in
+// double precision
+static void TestResponse() {
+    double max_error = 0;
+    for (double notch : {45.0, 120.0, 333.0}) {
+        const biquad_coeff_t k = control::BiquadNotch(FS, notch, 5);
+        for (double f : {10.0, 30.0, notch * 0.8, notch * 0.95, notch * 1.1, 480.0}) {
+            AdaptiveNotch filter;
+            filter.SetFrequency(0, notch);
+            max_error = fmax(max_error, fabs(Amplitude(&filter, f) - Response(k, f, nullptr)));
+        }
+    }
+    printf("response: max amplitude error %.2e\n", max_error);
+    CHECK(max_error < 1e-3);
+
+    // 陷波器在控制频段内的相位滞后远小于同样能衰减振动的低通
+    // in the control band a notch lags far less than a low pass that also attenuates the
+    // vibration
+    const biquad_coeff_t low_pass = control::BiquadLowPass(FS, 50);
+    for (double f : {5.0, 10.0, 20.0, 30.0}) {
+        double phase;
+        Response(low_pass, f, &phase);
+        const double low_pass_lag = -phase * 180 / M_PI;
+        printf("%2.0f Hz: low pass 50 Hz lags %5.2f deg, notches", f, low_pass_lag);
+        for (double notch : {60.0, 95.0, 180.0}) {
+            const double gain = Response(control::BiquadNotch(FS, notch, 5), f, &phase);
+            printf(" %3.0f Hz %4.2f deg %.3f dB", notch, -phase * 180 / M_PI, 20 * log10(gain));
+            CHECK(-phase * 180 / M_PI < 8);
+            CHECK(-phase * 180 / M_PI < low_pass_lag / 5);
+            CHECK(20 * log10(gain) > -0.1);
+        }
+        printf("\n");
+    }
+}
+
+// 频率超出范围时关闭，关闭时输出与输入逐位相同
+// out of range frequencies disable the notch, and a disabled filter passes its input bit for bit
+static void TestDisable() {
+    AdaptiveNotch filter;
+    for (float frequency : {39.0f, 500.0f, 600.0f, -1.0f}) {
+        filter.SetFrequency(0, 100);
+        CHECK(filter.GetFrequency(0) == 100);
+        filter.SetFrequency(0, frequency);
+        CHECK(filter.GetFrequency(0) == 0);
+    }
+    filter.SetFrequency(1, 40);
+    CHECK(filter.GetFrequency(1) == 40);
+    filter.SetFrequency(1, 0);
+
+    test::Random random(3);
+    int mismatches = 0;
+    for (int n = 0; n < 1000; ++n) {
+        float x[3], y[3];
+        for (int a = 0; a < 3; ++a)
+            x[a] = random.Uniform(-10, 10);
+        filter.Update(x, y);
+        for (int a = 0; a < 3; ++a)
+            if (x[a] != y[a])
+                ++mismatches;
+    }
+    CHECK(mismatches == 0);
+}
+
+// 频谱分析跳过其他陷波器已经处理的频率，振动停止后连续三次没有找到时关闭
+// the analysis skips the frequencies the other notches handle, and disables the notch after
+// three misses in a row once the vibration stops
+static void TestAnalyze() {
+    AdaptiveNotch filter;
+    float y[3];
+    const float zero[3] = {0, 0, 0};
+    for (int n = 0; n < AdaptiveNotch::FFT_LENGTH - 1; ++n)
+        filter.Update(zero, y);
+    CHECK(!filter.Analyze(0));
+
+    // 150Hz的振动更强，但是已经由陷波器0处理 / the 150 Hz vibration is stronger but notch 0 has it
+    filter.SetFrequency(0, 150);
+    test::Random random(5);
+    for (int n = 0; n < 20 * AdaptiveNotch::FFT_LENGTH; ++n) {
+        float x[3];
+        for (int a = 0; a < 3; ++a)
+            x[a] = sin(2 * M_PI * 150 * n / FS) + 0.3 * sin(2 * M_PI * 230 * n / FS + a) +
+                   random.Normal(0.02f);
+        filter.Update(x, y);
+        filter.Analyze(1);
+    }
+    printf("analyze: notches at %.2f Hz and %.2f Hz\n", filter.GetFrequency(0),
+           filter.GetFrequency(1));
+    CHECK(filter.GetFrequency(0) == 150);
+    CHECK_NEAR(filter.GetFrequency(1), 230, 0.5);
+
+    int analyses = 0;
+    while (filter.GetFrequency(1) != 0 && analyses < 10) {
+        float x[3];
+        for (int a = 0; a < 3; ++a)
+            x[a] = random.Normal(0.02f);
+        filter.Update(x, y);
+        analyses += filter.Analyze(1);
+    }
+    printf("analyze: disabled after %d analyses without vibration\n", analyses);
+    CHECK(filter.GetFrequency(1) == 0);
+    // 第一次分析的缓冲区里还有振动 / the buffer of the first analysis still holds vibration
+    CHECK(analyses <= 4);
+}
+
+static void Benchmark() {
+    printf("benchmark:\n");
+    AdaptiveNotch filter;
+    filter.SetFrequency(0, 120);
+    filter.SetFrequency(1, 95);
+    float x[3] = {0.1f, 0.2f, 0.3f}, y[3];
+    const int N = 1 << 22;
+    test::Stopwatch stopwatch;
+    for (int n = 0; n < N; ++n) {
+        x[n % 3] = (n & 255) * 0.01f;
+        filter.Update(x, y);
+        x[0] += y[2] * 1e-3f;
+    }
+    test::Report("Update, 2 notches", stopwatch, N);
+    test::Consume(y);
+
+    const int rounds = 2000;
+    double update_ns = stopwatch.Nanoseconds() / N;
+    int analyses = 0;
+    stopwatch.Restart();
+    for (int r = 0; r < rounds; ++r) {
+        for (int n = 0; n < AdaptiveNotch::FFT_LENGTH; ++n) {
+            x[n % 3] = sinf(n * 0.7f);
+            filter.Update(x, y);
+        }
+        analyses += filter.Analyze(1);
+    }
+    // 减去Update的耗时 / the cost of Update is subtracted
+    printf("  %-40s %8.1f ns/call\n", "Analyze, portable FFT",
+           stopwatch.Nanoseconds() / analyses - AdaptiveNotch::FFT_LENGTH * update_ns);
+    test::Consume(y);
+}
+
+int main() {
+    TestScenarios();
+    TestResponse();
+    TestDisable();
+    TestAnalyze();
+    Benchmark();
+    return test::Finish();
+}
@@ -0,0 +1,420 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// ADRC的测试：观测器估计出恒定扰动并消除稳态误差，闭环响应符合带宽wc，二阶的目标变化率前馈、
+// 输出限幅不积分饱和、b0偏差的鲁棒性和Reset，以及底盘小陀螺时云台yaw稳定的仿真，与原来的PID
+// 加上速度偏置的方案对比
+// tests of ADRC: the observer estimates a constant disturbance and removes the steady state error,
+// the closed loop follows the bandwidth wc, the second order target rate feedforward, no wind up
+// under a clamped output, robustness to an error in b0 and Reset, and a simulation of the gimbal
+// yaw stabilization with a spinning chassis, compared to the old PID and speed offset scheme
+
+#include <math.h>
+
+#include <initializer_list>
+
+#include "adrc.h"
+#include "pid.h"
+#include "test.h"
+
+using control::ADRC;
+using control::ConstrainedPID;
+
+namespace {
+
+    constexpr float DT = 0.001f;
+
+    // y' = f + b * u 或 y'' = f + b * u，按控制周期的1/10积分
+    // y' = f + b * u or y'' = f + b * u, integrated at a tenth of the control period
+    class Integrators {
+      public:
+        Integrators(int order, double gain, double disturbance)
+            : order_(order), gain_(gain), disturbance_(disturbance) {
+        }
+
+        void Step(float output) {
+            const double h = DT / 10.0;
+            for (int i = 0; i < 10; ++i) {
+                const double acceleration = disturbance_ + gain_ * output;
+                if (order_ == 1) {
+                    y_ += acceleration * h;
+                } else {
+                    rate_ += acceleration * h;
+                    y_ += rate_ * h;
+                }
+            }
+        }
+
+        float Value() const {
+            return (float)y_;
+        }
+
+      private:
+        int order_;
+        double gain_;
+        double disturbance_;
+        double y_ = 0;
+        double rate_ = 0;
+    };
+
+    constexpr double B = 50;
+    constexpr double DISTURBANCE = -300;
+
+    control::adrc_init_t Init(uint8_t order, float b0_error = 1) {
+        return {
+            .order = order,
+            .b0 = (float)B * b0_error,
+            .wc = order == 1 ? 60.0f : 30.0f,
+            .wo = 200,
+            .max_out = 1000,
+        };
+    }
+
+    /* 云台的仿真：6020驱动的yaw云台装在小陀螺的底盘上，底盘按指令旋转，功率限制时减速，转速
+     * 变化，最后反转，轴承和滑环的摩擦带着云台转。编码器、电机转速和陀螺仪按实际传感器的分辨率、
+     * 噪声和CAN延迟采样。控制1kHz，被控对象10kHz积分 */
+    /* gimbal simulation: a GM6020 yaw gimbal on a spinning chassis. The chassis follows the
+     * commanded spin, slows down when power limited, varies its spin rate and reverses, bearing
+     * and slip ring friction drag the gimbal along. Encoder, motor speed and gyro are sampled
+     * with the resolution, noise and CAN delay of the real sensors. Control runs at 1 kHz, the
+     * plant is integrated at 10 kHz */
+    constexpr int PLANT_STEPS = 10;
+    constexpr double DURATION = 12.0;
+    constexpr double INERTIA = 0.03;
+    constexpr double TORQUE_PER_COUNT = 0.741 * 3 / 16384;
+    constexpr double VISCOUS = 0.02;
+    constexpr double COULOMB = 0.06;
+    constexpr double CURRENT_TAU = 0.001;
+    constexpr double CHASSIS_ACCEL = 25.0;
+    constexpr double ENCODER_RES = 2 * M_PI / 8192;
+    constexpr double RPM_RES = 2 * M_PI / 60;
+    constexpr float GYRO_NOISE = 0.01f;
+
+    enum scheme_t {
+        PID_OFFSET = 0,  // 编码器上的角度环和速度环，SetSpeedOffset抵消底盘转速
+        ADRC_ENCODER,    // 只把速度环换成ADRC / only the speed loop replaced by ADRC
+        PID_GYRO,        // 速度环用陀螺仪反馈，没有偏置 / speed loop on the gyro, no offset
+        ADRC_GYRO,       // 陀螺仪反馈的ADRC速度环 / ADRC speed loop on the gyro
+    };
+
+    const char* const SCHEMES[] = {"pid+offset", "adrc-encoder", "pid+gyro", "adrc"};
+
+    // 指令底盘转速 [rad/s] 和功率限制允许的比例 / commanded spin [rad/s] and the fraction the
+    // power limit lets through
+    void SpinCommand(double t, double* spin, double* power) {
+        *power = 1;
+        if (t < 1.0) {
+            *spin = 0;
+        } else if (t < 4.0) {
+            *spin = 8;
+        } else if (t < 6.0) {
+            *spin = 8;
+            *power = 0.65;
+        } else if (t < 9.0) {
+            *spin = 8 + 3 * sin(2 * M_PI * 0.8 * (t - 6.0));
+        } else {
+            *spin = -8;
+        }
+    }
+
+    // 哨兵云台的yaw角度环和速度环参数 / yaw angle and speed loops of programs/Sentry/gimbal
+    ConstrainedPID::PID_Init_t ThetaInit() {
+        return {
+            .kp = 6,
+            .ki = 0,
+            .kd = 4,
+            .max_out = 6 * PI,
+            .max_iout = 0,
+            .deadband = 0,
+            .A = 0,
+            .B = 0,
+            .output_filtering_coefficient = 0.15,
+            .derivative_filtering_coefficient = 0,
+            .mode = ConstrainedPID::OutputFilter,
+        };
+    }
+
+    ConstrainedPID::PID_Init_t OmegaInit() {
+        return {
+            .kp = 7300,
+            .ki = 35,
+            .kd = 500,
+            .max_out = 16384,
+            .max_iout = 2000,
+            .deadband = 0,
+            .A = 0.5 * PI,
+            .B = 0.5 * PI,
+            .output_filtering_coefficient = 0.03,
+            .derivative_filtering_coefficient = 0.1,
+            .mode = ConstrainedPID::Integral_Limit | ConstrainedPID::OutputFilter |
+                    ConstrainedPID::Trapezoid_Intergral | ConstrainedPID::ChangingIntegralRate |
+                    ConstrainedPID::Derivative_On_Measurement | ConstrainedPID::DerivativeFilter,
+        };
+    }
+
+    struct spin_error_t {
+        double rms;    // [rad]
+        double worst;  // [rad]
+    };
+
+    spin_error_t SimulateSpin(scheme_t scheme, float b0_error) {
+        test::Random random(1);
+        ConstrainedPID theta(ThetaInit());
+        ConstrainedPID speed_pid(OmegaInit());
+        ADRC speed_adrc({
+            .order = 1,
+            .b0 = (float)(TORQUE_PER_COUNT / INERTIA) * b0_error,
+            .wc = 60,
+            .wo = 250,
+            .max_out = 16384,
+        });
+
+        double chassis_angle = 0, chassis_rate = 0;
+        double yaw = 0, yaw_rate = 0;  // 世界坐标系下的云台 / gimbal in the world frame
+        double current = 0;
+        float encoder = 0, motor_speed = 0;  // 上一帧CAN反馈 / last CAN frame
+        double squared = 0, worst = 0;
+        int samples = 0;
+
+        const int steps = (int)lround(DURATION / DT);
+        for (int k = 0; k < steps; ++k) {
+            const double t = k * (double)DT;
+            double spin, power;
+            SpinCommand(t, &spin, &power);
+
+            // 电机反馈经过CAN晚一帧，陀螺仪当前采样 / the motor feedback arrives one frame late
+            // over CAN, the gyro is sampled now
+            const float last_encoder = encoder, last_speed = motor_speed;
+            encoder = (float)(round((yaw - chassis_angle) / ENCODER_RES) * ENCODER_RES);
+            motor_speed = (float)(round((yaw_rate - chassis_rate) / RPM_RES) * RPM_RES);
+            const float gyro = (float)yaw_rate + random.Normal(GYRO_NOISE);
+            const float yaw_error = (float)-yaw;
+
+            // Gimbal::UpdateIMU()让角度环的目标为编码器加上世界坐标系的误差
+            // Gimbal::UpdateIMU() keeps the angle loop target at encoder + world error
+            float speed_target = theta.ComputeOutput(last_encoder + yaw_error, last_encoder);
+            float command;
+            switch (scheme) {
+                case PID_OFFSET:
+                    command = speed_pid.ComputeOutput(speed_target - (float)spin, last_speed);
+                    break;
+                case ADRC_ENCODER:
+                    command = speed_adrc.ComputeOutput(speed_target - (float)spin, last_speed, DT);
+                    break;
+                case PID_GYRO:
+                    command = speed_pid.ComputeOutput(speed_target, gyro);
+                    break;
+                default:
+                    command = speed_adrc.ComputeOutput(speed_target, gyro, DT);
+                    break;
+            }
+
+            const double h = DT / (double)PLANT_STEPS;
+            for (int i = 0; i < PLANT_STEPS; ++i) {
+                const double goal = spin * power;
+                const double limit = CHASSIS_ACCEL * h;
+                chassis_rate += fmin(limit, fmax(-limit, goal - chassis_rate));
+                chassis_angle += chassis_rate * h;
+                current += (command - current) * h / CURRENT_TAU;
+                const double slip = yaw_rate - chassis_rate;
+                const double torque =
+                    current * TORQUE_PER_COUNT - VISCOUS * slip - COULOMB * tanh(slip / 0.05);
+                yaw_rate += torque / INERTIA * h;
+                yaw += yaw_rate * h;
+            }
+
+            if (t >= 1.0) {
+                squared += yaw * yaw;
+                worst = fmax(worst, fabs(yaw));
+                ++samples;
+            }
+        }
+        return {sqrt(squared / samples), worst};
+    }
+
+}  // namespace
+
+// 一阶：恒定扰动被观测器估计出来，没有稳态误差，观测器收敛后阶跃响应的时间常数为1/wc
+// first order: the observer estimates the constant disturbance, there is no steady state error
+// and once the observer has converged the step response has a time constant of 1/wc
+static void TestFirstOrder() {
+    const control::adrc_init_t init = Init(1);
+    ADRC adrc(init);
+    Integrators plant(1, B, DISTURBANCE);
+    const int step = 500;
+    float at_tau = 0;
+    for (int tick = 0; tick < 1500; ++tick) {
+        plant.Step(adrc.ComputeOutput(tick < step ? 0 : 1, plant.Value(), DT));
+        if (tick + 1 == step + (int)lroundf(1 / init.wc / DT))
+            at_tau = plant.Value();
+    }
+    printf("first order: %.4f after 1/wc, %.6f at the end, disturbance %.3f\n", at_tau,
+           plant.Value(), adrc.GetDisturbance());
+    CHECK_NEAR(at_tau, 1 - expf(-1), 0.1f);
+    CHECK_NEAR(plant.Value(), 1, 1e-4f);
+    CHECK_NEAR(adrc.GetDisturbance(), DISTURBANCE / B, 1e-2f);
+    CHECK_NEAR(adrc.GetEstimate(0), 1, 1e-3f);
+}
+
+// 二阶：跟踪斜坡目标，给出目标变化率时没有跟踪误差，不给时有速度误差
+// second order: with the target rate a ramp is tracked without error, without it the error is
+// the lag of the velocity loop
+static void TestSecondOrder() {
+    const control::adrc_init_t init = Init(2);
+    const float slope = 2;
+    float errors[2] = {};
+    for (int feedforward = 0; feedforward < 2; ++feedforward) {
+        ADRC adrc(init);
+        Integrators plant(2, B, DISTURBANCE);
+        for (int tick = 0; tick < 2000; ++tick) {
+            const float target = tick < 500 ? 0 : slope * (tick - 500) * DT;
+            const float rate = tick < 500 || !feedforward ? 0 : slope;
+            plant.Step(adrc.ComputeOutput(target, rate, plant.Value(), DT));
+            errors[feedforward] = target - plant.Value();
+        }
+    }
+    printf("second order ramp: error %.5f without rate, %.6f with rate\n", errors[0], errors[1]);
+    // 没有前馈时误差为slope * 2 / wc / without feedforward the error is slope * 2 / wc
+    CHECK_NEAR(errors[0], slope * 2 / init.wc, 0.1f * slope * 2 / init.wc);
+    CHECK(fabsf(errors[1]) < 1e-3f);
+}
+
+// 输出被限幅时观测器用限幅后的输出更新，大阶跃后没有积分饱和引起的超调。二阶的线性控制律在
+// 加速度受限时来不及减速，更大的阶跃应该用轨迹给出目标和目标变化率
+// with a clamped output the observer is updated with what was applied, a large step has no wind
+// up overshoot. The linear second order law can not brake in time with a limited acceleration,
+// larger steps should come from a trajectory with the target rate
+static void TestSaturation() {
+    for (uint8_t order : {1, 2}) {
+        control::adrc_init_t init = Init(order);
+        // 抵消扰动后只剩700的加速度 / 700 of acceleration left over the disturbance
+        init.max_out = 20;
+        const float target = order == 1 ? 100 : 20;
+        ADRC adrc(init);
+        Integrators plant(order, B, DISTURBANCE);
+        int saturated = 0;
+        float peak = 0;
+        for (int tick = 0; tick < 3000; ++tick) {
+            const float output = adrc.ComputeOutput(target, plant.Value(), DT);
+            CHECK(fabsf(output) <= init.max_out);
+            if (fabsf(output) == init.max_out)
+                ++saturated;
+            plant.Step(output);
+            peak = fmaxf(peak, plant.Value());
+        }
+        printf("saturation, order %d: %d ticks clamped, overshoot %.4f, final %.5f\n", order,
+               saturated, peak - target, plant.Value());
+        CHECK(saturated > 100);
+        CHECK(peak < target + 0.01f);
+        CHECK_NEAR(plant.Value(), target, 1e-3f);
+    }
+}
+
+// b0偏差50%时仍然稳定并消除稳态误差 / with b0 off by 50% the loop is still stable and has no
+// steady state error
+static void TestRobustness() {
+    for (uint8_t order : {1, 2}) {
+        for (float b0_error : {0.5f, 1.5f}) {
+            ADRC adrc(Init(order, b0_error));
+            Integrators plant(order, B, DISTURBANCE);
+            float peak = 0;
+            for (int tick = 0; tick < 2000; ++tick) {
+                plant.Step(adrc.ComputeOutput(1, plant.Value(), DT));
+                peak = fmaxf(peak, plant.Value());
+            }
+            printf("b0 x %.1f, order %d: overshoot %.2f%%, final %.6f\n", b0_error, order,
+                   (peak - 1) * 100, plant.Value());
+            CHECK(peak < 1.15f);
+            CHECK_NEAR(plant.Value(), 1, 1e-3f);
+        }
+    }
+}
+
+// 第一次计算和Reset之后观测器从测量值开始，dt不大于0时不更新观测器
+// the first computation and the one after Reset start the observer at the measurement, dt <= 0
+// does not update the observer
+static void TestReset() {
+    const control::adrc_init_t init = Init(1);
+    ADRC adrc(init);
+    CHECK_NEAR(adrc.ComputeOutput(2, 0.5f, DT), init.wc * 1.5f / init.b0, 1e-5f);
+    CHECK(adrc.GetEstimate(0) == 0.5f);
+    CHECK(adrc.GetEstimate(1) == 0);
+    adrc.ComputeOutput(2, 0.7f, 0);
+    CHECK(adrc.GetEstimate(0) == 0.5f);
+    adrc.ComputeOutput(2, 0.7f, DT);
+    CHECK(adrc.GetEstimate(0) != 0.5f);
+    adrc.Reset();
+    CHECK(adrc.GetEstimate(0) == 0);
+    CHECK_NEAR(adrc.ComputeOutput(2, -1, DT), init.wc * 3 / init.b0, 1e-5f);
+    CHECK(adrc.GetEstimate(0) == -1);
+    CHECK(adrc.GetEstimate(3) == 0);
+    printf("reset: done\n");
+}
+
+// 底盘小陀螺时云台yaw在世界坐标系下的误差。陀螺仪反馈的ADRC速度环不需要速度偏置，误差比原来的
+// 方案小三个数量级，b0偏差50%时仍然远好于PID
+// yaw error in the world frame while the chassis spins. The ADRC speed loop on the gyro needs no
+// speed offset and is three orders of magnitude better than the old scheme, and still far better
+// than the PID with b0 off by 50%
+static void TestSpin() {
+    printf("spin, yaw error rms / max [mrad]:\n");
+    spin_error_t errors[4];
+    for (int scheme = PID_OFFSET; scheme <= ADRC_GYRO; ++scheme) {
+        errors[scheme] = SimulateSpin((scheme_t)scheme, 1);
+        printf("  %-13s %8.2f / %8.2f\n", SCHEMES[scheme], errors[scheme].rms * 1e3,
+               errors[scheme].worst * 1e3);
+    }
+    CHECK(errors[PID_GYRO].rms * 10 < errors[PID_OFFSET].rms);
+    CHECK(errors[ADRC_GYRO].rms * 10 < errors[PID_GYRO].rms);
+    CHECK(errors[ADRC_GYRO].worst < 2e-3);
+    for (float b0_error : {0.5f, 1.5f}) {
+        const spin_error_t error = SimulateSpin(ADRC_GYRO, b0_error);
+        printf("  adrc b0 x %.1f %8.2f / %8.2f\n", b0_error, error.rms * 1e3, error.worst * 1e3);
+        CHECK(error.rms * 5 < errors[PID_GYRO].rms);
+    }
+}
+
+static void Benchmark() {
+    const long calls = 5000000;
+    printf("benchmark:\n");
+    for (uint8_t order : {1, 2}) {
+        ADRC adrc(Init(order));
+        float measure = 0, output = 0;
+        test::Stopwatch stopwatch;
+        for (long i = 0; i < calls; ++i) {
+            measure += 1e-6f;
+            output += adrc.ComputeOutput(1, measure, DT);
+        }
+        test::Report(order == 1 ? "ComputeOutput, first order" : "ComputeOutput, second order",
+                     stopwatch, calls);
+        test::Consume(output);
+    }
+}
+
+int main() {
+    TestFirstOrder();
+    TestSecondOrder();
+    TestSaturation();
+    TestRobustness();
+    TestReset();
+    TestSpin();
+    Benchmark();
+    return test::Finish();
+}
@@ -0,0 +1,323 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// AttitudeHistory的测试：1kHz带抖动的采样下，沿倾斜轴变速旋转的姿态插值误差，与只用最新姿态
+// 相比；窗口边界、时间戳不递增和环形缓冲区回绕；球面插值的端点、180°和较短的弧；一个写者全速
+// 写入、多个读者同时查询时没有撕裂的结果；以及查询和写入的耗时
+// tests of AttitudeHistory: the interpolation error on an attitude spinning at a varying rate
+// about a tilted axis, sampled at 1 kHz with jitter, against using the latest attitude only; the
+// window bounds, timestamps that do not increase and the ring wrapping around; the end points,
+// 180° and short arcs of slerp; no torn results while one writer pushes flat out and several
+// readers query; and the cost of queries and pushes
+
+#include <math.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "attitude_history.h"
+#include "test.h"
+
+using control::AttitudeHistory;
+
+namespace {
+
+    // 真实姿态：绕固定的倾斜轴转动，角度为A·sin(ωt) + r·t，最大角速度约27rad/s
+    // the true attitude: turning about a fixed tilted axis by A·sin(ωt) + r·t, up to about
+    // 27 rad/s
+    constexpr double AMPLITUDE = 1.2;         // [rad]
+    constexpr double FREQUENCY = 2 * M_PI * 3;  // [rad/s]
+    constexpr double RATE = 4.0;              // [rad/s]
+
+    void Truth(uint64_t timestamp, float q[4], float gyro[3]) {
+        const double axis[3] = {1 / sqrt(14.0), 2 / sqrt(14.0), 3 / sqrt(14.0)};
+        const double t = timestamp * 1e-6;
+        const double angle = AMPLITUDE * sin(FREQUENCY * t) + RATE * t;
+        const double rate = AMPLITUDE * FREQUENCY * cos(FREQUENCY * t) + RATE;
+        q[0] = cos(angle / 2);
+        for (int i = 0; i < 3; ++i) {
+            q[i + 1] = sin(angle / 2) * axis[i];
+            gyro[i] = rate * axis[i];
+        }
+    }
+
+    // 两个姿态之间的夹角，由conj(a)·b的向量部分计算，小角度时比acos准确
+    // angle between two attitudes from the vector part of conj(a)·b, which unlike acos stays
+    // accurate for small angles [rad]
+    double AngleBetween(const float a[4], const float b[4]) {
+        const double w = a[0], x = -a[1], y = -a[2], z = -a[3];
+        const double vx = w * b[1] + x * b[0] + y * b[3] - z * b[2];
+        const double vy = w * b[2] - x * b[3] + y * b[0] + z * b[1];
+        const double vz = w * b[3] + x * b[2] - y * b[1] + z * b[0];
+        return 2 * asin(fmin(sqrt(vx * vx + vy * vy + vz * vz), 1.0));
+    }
+
+    // 1kHz、±100us抖动地写入count个样本，返回最新的时间戳
+    // pushes count samples at 1 kHz with ±100us jitter, returning the latest timestamp
+    uint64_t Fill(AttitudeHistory* history, test::Random* random, int count) {
+        uint64_t timestamp = 1000000;
+        for (int i = 0; i < count; ++i) {
+            if (i > 0)
+                timestamp += 900 + random->Next() % 201;
+            float q[4], gyro[3];
+            Truth(timestamp, q, gyro);
+            history->Push(timestamp, q, gyro);
+        }
+        return timestamp;
+    }
+
+}  // namespace
+
+// 窗口内任意时刻的插值误差远小于直接用最新姿态的误差
+// interpolating anywhere within the window is far better than using the latest attitude
+static void TestInterpolation() {
+    static AttitudeHistory history;
+    test::Random random(1);
+    const uint64_t newest = Fill(&history, &random, 200);
+    double max_error = 0, sum_error = 0, max_norm = 0, max_gyro = 0;
+    int queries = 0;
+    for (int i = 0; i < 100000; ++i) {
+        const uint64_t timestamp = newest - random.Next() % 120000;
+        float q[4], gyro[3], expected_q[4], expected_gyro[3];
+        if (!history.Query(timestamp, q, gyro))
+            continue;
+        ++queries;
+        Truth(timestamp, expected_q, expected_gyro);
+        const double error = AngleBetween(q, expected_q);
+        max_error = fmax(max_error, error);
+        sum_error += error;
+        max_norm = fmax(max_norm, fabs(sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] +
+                                            q[3] * q[3]) - 1));
+        for (int k = 0; k < 3; ++k)
+            max_gyro = fmax(max_gyro, fabs(gyro[k] - expected_gyro[k]));
+    }
+
+    uint64_t latest_time;
+    float latest[4];
+    CHECK(history.GetLatest(&latest_time, latest));
+    CHECK(latest_time == newest);
+    double max_latest = 0;
+    for (int i = 0; i < 1000; ++i) {
+        float q[4], gyro[3];
+        Truth(newest - random.Next() % 30000, q, gyro);
+        max_latest = fmax(max_latest, AngleBetween(latest, q));
+    }
+    printf("interpolation: %d queries, mean error %.2e, max %.2e rad, norm error %.1e, "
+           "rate error %.3f rad/s; latest attitude up to 30 ms old %.3f rad\n",
+           queries, sum_error / queries, max_error, max_norm, max_gyro, max_latest);
+    CHECK(queries > 99000);
+    CHECK(sum_error / queries < 5e-5);
+    CHECK(max_error < 1e-4);
+    CHECK(max_norm < 1e-6);
+    // 角加速度最大约430rad/s^2，相邻样本之间线性插值的误差不超过它乘以样本间隔的1/8
+    // the angular acceleration peaks at about 430 rad/s^2, linear interpolation between samples
+    // is off by at most an eighth of that times the sample interval
+    CHECK(max_gyro < 430 * 1.1e-3 / 8);
+    CHECK(max_latest > 100 * max_error);
+}
+
+// 空的历史、窗口之外、恰好在样本上的查询，丢弃不递增的时间戳，回绕后窗口为最近的CAPACITY - 1
+// 个样本
+// an empty history, queries outside the window or right at a sample, timestamps that do not
+// increase are dropped, and after wrapping around the window is the latest CAPACITY - 1 samples
+static void TestWindow() {
+    static AttitudeHistory history;
+    float q[4] = {9, 9, 9, 9}, gyro[3];
+    uint64_t timestamp;
+    CHECK(!history.Query(0, q));
+    CHECK(!history.GetLatest(&timestamp, q));
+    CHECK(q[0] == 9);
+
+    float sample[4], sample_gyro[3];
+    for (int i = 0; i < 3 * AttitudeHistory::CAPACITY; ++i) {
+        Truth(1000 * (i + 1), sample, sample_gyro);
+        history.Push(1000 * (i + 1), sample, sample_gyro);
+        // 时间戳相同或倒退的样本被丢弃 / samples with equal or older timestamps are dropped
+        const float wrong[4] = {0, 1, 0, 0};
+        history.Push(1000 * (i + 1), wrong, sample_gyro);
+        history.Push(1000 * i + 500, wrong, sample_gyro);
+    }
+    const uint64_t newest = 1000 * 3 * AttitudeHistory::CAPACITY;
+    const uint64_t oldest = newest - 1000 * (AttitudeHistory::CAPACITY - 2);
+    CHECK(history.GetLatest(&timestamp, q, gyro));
+    CHECK(timestamp == newest);
+    CHECK(q[0] == sample[0] && q[1] == sample[1]);
+    CHECK(gyro[2] == sample_gyro[2]);
+
+    q[0] = 9;
+    CHECK(!history.Query(newest + 1, q));
+    CHECK(!history.Query(oldest - 1, q));
+    CHECK(q[0] == 9);
+    CHECK(history.Query(oldest, q));
+    CHECK(history.Query(newest, q));
+
+    int mismatches = 0;
+    for (uint64_t t = oldest; t <= newest; t += 1000) {
+        Truth(t, sample, sample_gyro);
+        if (!history.Query(t, q, gyro) || AngleBetween(q, sample) > 1e-6 ||
+            fabs(gyro[0] - sample_gyro[0]) > 1e-5)
+            ++mismatches;
+    }
+    printf("window: %d mismatches at the samples\n", mismatches);
+    CHECK(mismatches == 0);
+}
+
+// 球面插值：端点，180°，q和-q取较短的弧，输出可以与输入相同，很小的夹角
+// slerp: the end points, 180°, the short arc between q and -q, output aliasing an input, tiny
+// angles
+static void TestSlerp() {
+    const float identity[4] = {1, 0, 0, 0};
+    const float half_turn[4] = {0, 1, 0, 0};
+    float q[4];
+    AttitudeHistory::Slerp(identity, half_turn, 0.3f, q);
+    CHECK_NEAR(q[0], cos(0.3 * M_PI / 2), 1e-6);
+    CHECK_NEAR(q[1], sin(0.3 * M_PI / 2), 1e-6);
+    AttitudeHistory::Slerp(identity, half_turn, 0, q);
+    CHECK_NEAR(q[0], 1, 1e-6);
+    AttitudeHistory::Slerp(identity, half_turn, 1, q);
+    CHECK_NEAR(q[1], 1, 1e-6);
+
+    // -90°绕z轴写成w为负的形式，中点应为-45°而不是绕远路的135°
+    // -90° about z written with a negative w, the midpoint is -45° rather than 135° the long way
+    const float negated[4] = {-0.70710678f, 0, 0, 0.70710678f};
+    AttitudeHistory::Slerp(identity, negated, 0.5f, q);
+    CHECK_NEAR(q[0], cos(M_PI / 8), 1e-6);
+    CHECK_NEAR(q[3], -sin(M_PI / 8), 1e-6);
+
+    float a[4] = {1, 0, 0, 0};
+    const float small[4] = {(float)cos(1e-4), 0, (float)sin(1e-4), 0};
+    AttitudeHistory::Slerp(a, small, 0.5f, a);
+    CHECK_NEAR(a[0], cos(0.5e-4), 1e-7);
+    CHECK_NEAR(a[2], sin(0.5e-4), 1e-7);
+
+    // 夹角在阈值两侧时结果连续 / continuous across the threshold angle
+    double max_error = 0;
+    for (int i = 1; i < 2000; ++i) {
+        const double angle = i * 1e-5;
+        const float b[4] = {(float)cos(angle), (float)sin(angle), 0, 0};
+        AttitudeHistory::Slerp(identity, b, 0.25f, q);
+        max_error = fmax(max_error, fabs(atan2(q[1], q[0]) - 0.25 * angle));
+    }
+    printf("slerp: max error %.2e rad over small angles\n", max_error);
+    CHECK(max_error < 1e-6);
+}
+
+// 一个写者全速写入，三个读者在窗口内随机查询，结果与真实姿态一致，查询失败的比例很小
+// one writer pushing flat out and three readers querying at random within the window, every
+// result matches the true attitude and only a few queries fail
+static void TestConcurrent() {
+    constexpr int READERS = 3;
+    static AttitudeHistory history;
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> written{0};
+    std::thread writer([&stop, &written] {
+        uint64_t timestamp = 1000;
+        while (!stop.load(std::memory_order_relaxed)) {
+            float q[4], gyro[3];
+            Truth(timestamp, q, gyro);
+            history.Push(timestamp, q, gyro);
+            written.store(timestamp);
+            timestamp += 1000;
+        }
+    });
+    std::atomic<long> passed{0}, failed{0}, wrong{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < READERS; ++r) {
+        readers.emplace_back([r, &written, &passed, &failed, &wrong] {
+            test::Random random(10 + r);
+            long local_passed = 0, local_failed = 0, local_wrong = 0;
+            for (int i = 0; i < 1000000; ++i) {
+                const uint64_t now = written.load();
+                if (now < 200000) {
+                    std::this_thread::yield();
+                    --i;
+                    continue;
+                }
+                // 最多130个样本之前，包括窗口最旧的一端 / up to 130 samples back, including the
+                // oldest end of the window
+                const uint64_t timestamp = now - random.Next() % 130000;
+                float q[4], gyro[3], expected_q[4], expected_gyro[3];
+                if (!history.Query(timestamp, q, gyro)) {
+                    ++local_failed;
+                    continue;
+                }
+                Truth(timestamp, expected_q, expected_gyro);
+                if (AngleBetween(q, expected_q) > 1e-3)
+                    ++local_wrong;
+                else
+                    ++local_passed;
+            }
+            passed += local_passed;
+            failed += local_failed;
+            wrong += local_wrong;
+        });
+    }
+    for (std::thread& reader : readers)
+        reader.join();
+    stop = true;
+    writer.join();
+    printf("concurrent: %ld passed, %ld outside the window or overwritten, %ld wrong, %llu "
+           "pushes\n",
+           passed.load(), failed.load(), wrong.load(),
+           (unsigned long long)(written.load() / 1000));
+    CHECK(wrong.load() == 0);
+    CHECK(failed.load() < passed.load() / 10);
+}
+
+static void Benchmark() {
+    static AttitudeHistory history;
+    test::Random random(4);
+    const uint64_t newest = Fill(&history, &random, 200);
+    const int N = 1 << 20;
+    float q[4], gyro[3], sum = 0;
+    printf("benchmark:\n");
+    test::Stopwatch stopwatch;
+    for (int i = 0; i < N; ++i) {
+        history.Query(newest - ((uint64_t)i * 7919) % 120000, q, gyro);
+        sum += q[0];
+    }
+    test::Report("Query", stopwatch, N);
+
+    const float a[4] = {1, 0, 0, 0};
+    const float b[4] = {-0.70710678f, 0, 0, 0.70710678f};
+    stopwatch.Restart();
+    for (int i = 0; i < N; ++i) {
+        AttitudeHistory::Slerp(a, b, (i % 100) * 0.01f, q);
+        sum += q[0];
+    }
+    test::Report("Slerp", stopwatch, N);
+
+    static AttitudeHistory pushed;
+    stopwatch.Restart();
+    for (int i = 0; i < N; ++i)
+        pushed.Push(i + 1, a, gyro);
+    test::Report("Push", stopwatch, N);
+    test::Consume(sum);
+}
+
+int main() {
+    TestInterpolation();
+    TestWindow();
+    TestSlerp();
+    TestConcurrent();
+    Benchmark();
+    return test::Finish();
+}
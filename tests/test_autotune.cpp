@@ -0,0 +1,330 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// 继电器自整定的测试：在3508和6020的速度环以及闭合速度环后的角度环的仿真上，带噪声和无噪声时
+// 都能收敛，临界增益和临界周期与描述函数法的解析解一致，各整定规则得到的参数闭环稳定，以及超时
+// 和重新开始的处理
+// tests of the relay auto tuner: on simulated 3508 and 6020 speed loops, and angle loops around a
+// closed speed loop, the tuning converges with and without noise, the ultimate gain and period
+// match the describing function analysis, the gains of every rule give a stable closed loop, and
+// timeouts and restarts are handled
+
+#include <math.h>
+
+#include <initializer_list>
+
+#include "autotune.h"
+#include "test.h"
+
+using control::ConstrainedPID;
+using control::RelayAutoTuner;
+using control::relay_tune_result_t;
+
+namespace {
+
+    constexpr float PERIOD = 0.001f;
+    constexpr float MAX_CURRENT = 16384;
+    constexpr int STEP_TICKS = 3000;  // 阶跃响应的仿真时长 / length of the step responses
+
+    // 电流到转速为一阶惯性加上若干个控制周期的纯延迟（CAN通信和电流环）
+    // current to speed is a first order lag plus a delay of a few control periods (CAN and the
+    // current loop)
+    struct motor_t {
+        const char* name;
+        float gain;  // 稳态转速与电流之比 [rad/s] / steady speed per current [rad/s]
+        float tau;   // 时间常数 [s] / time constant [s]
+        int delay;   // 纯延迟的周期数 / delay in control periods
+    };
+
+    constexpr motor_t MOTORS[] = {
+        {"3508", 0.003f, 0.25f, 2},
+        {"6020", 0.004f, 0.08f, 3},
+    };
+
+    class Motor {
+      public:
+        Motor(const motor_t& motor, float noise, uint64_t seed)
+            : motor_(motor), noise_(noise), random_(seed) {
+        }
+
+        void Step(float current) {
+            buffer_[index_] = clip<float>(current, -MAX_CURRENT, MAX_CURRENT);
+            const float delayed = buffer_[(index_ + DELAY_SIZE - motor_.delay) % DELAY_SIZE];
+            index_ = (index_ + 1) % DELAY_SIZE;
+            omega_ += (motor_.gain * delayed - omega_) / motor_.tau * PERIOD;
+            theta_ += omega_ * PERIOD;
+        }
+
+        // 编码器测量带有均匀分布的噪声 / encoder measurements carry uniform noise
+        float MeasureOmega() {
+            return omega_ + random_.Uniform(-noise_, noise_);
+        }
+
+        float MeasureTheta() {
+            return theta_ + random_.Uniform(-noise_, noise_) * 0.01f;
+        }
+
+        float Omega() const {
+            return omega_;
+        }
+
+        float Theta() const {
+            return theta_;
+        }
+
+      private:
+        static constexpr int DELAY_SIZE = 16;
+        motor_t motor_;
+        float noise_;
+        test::Random random_;
+        float buffer_[DELAY_SIZE] = {0};
+        int index_ = 0;
+        float omega_ = 0;
+        float theta_ = 0;
+    };
+
+    constexpr control::relay_tune_init_t OMEGA_TUNE = {
+        .setpoint = 5,
+        .amplitude = 3000,
+        .bias = 0,
+        .hysteresis = 0.06f,
+        .period = PERIOD,
+        .timeout = 10,
+        .cycles = 4,
+    };
+
+    constexpr control::relay_tune_init_t THETA_TUNE = {
+        .setpoint = 1,
+        .amplitude = 10,
+        .bias = 0,
+        .hysteresis = 0.005f,
+        .period = PERIOD,
+        .timeout = 10,
+        .cycles = 4,
+    };
+
+    constexpr float OMEGA_MAX_IOUT = 8000;
+    constexpr float THETA_MAX_IOUT = 5;
+    constexpr float THETA_MAX_OUT = 30;
+
+    // 对速度环整定，返回用掉的周期数 / tune the speed loop, returns the periods used
+    int TuneOmega(RelayAutoTuner* tuner, Motor* motor) {
+        int ticks = 0;
+        while (tuner->State() == RelayAutoTuner::RUNNING) {
+            motor->Step(tuner->Update(motor->MeasureOmega()));
+            ++ticks;
+        }
+        return ticks;
+    }
+
+    // 速度环闭合时对角度环整定 / tune the angle loop around the closed speed loop
+    int TuneTheta(RelayAutoTuner* tuner, Motor* motor, const ConstrainedPID::PID_Init_t& omega) {
+        ConstrainedPID omega_pid(omega);
+        int ticks = 0;
+        while (tuner->State() == RelayAutoTuner::RUNNING) {
+            const float target = tuner->Update(motor->MeasureTheta());
+            motor->Step(omega_pid.ComputeOutput(target, motor->MeasureOmega()));
+            ++ticks;
+        }
+        return ticks;
+    }
+
+    // 描述函数法：带滞环eps、幅值d的继电器在相角为-pi + asin(eps / a)、幅值为pi * a / (4 * d)
+    // 的频率上振荡。仿真中测量比输出晚一个周期，零阶保持再相当于半个周期的延迟
+    // describing function analysis: a relay with hysteresis eps and amplitude d oscillates where
+    // the phase is -pi + asin(eps / a) and the magnitude pi * a / (4 * d). In the simulation the
+    // measurement lags the output by one period, and the zero order hold adds half a period
+    relay_tune_result_t Predict(const motor_t& motor, const control::relay_tune_init_t& init) {
+        const double delay = (motor.delay + 1.5) * PERIOD;
+        const double d = init.amplitude, eps = init.hysteresis;
+        double a = 1, omega = 0;
+        for (int iteration = 0; iteration < 100; ++iteration) {
+            const double phase = -M_PI + asin(fmin(1, eps / a));
+            double lo = 0.1, hi = 1e5;
+            for (int bisect = 0; bisect < 100; ++bisect) {
+                omega = sqrt(lo * hi);
+                if (-atan(omega * motor.tau) - omega * delay > phase)
+                    lo = omega;
+                else
+                    hi = omega;
+            }
+            a = 4 * d / M_PI * motor.gain / sqrt(1 + omega * omega * motor.tau * motor.tau);
+        }
+        return {
+            .ku = (float)(4 * d / (M_PI * sqrt(a * a - eps * eps))),
+            .tu = (float)(2 * M_PI / omega),
+            .amplitude = (float)a,
+        };
+    }
+
+    // 阶跃响应的超调 [%] 和进入2%误差带的时间 [s] / overshoot [%] of a step response and the
+    // time [s] it enters the 2% band
+    struct step_t {
+        float overshoot;
+        float settle;
+    };
+
+    template <typename Response>
+    step_t StepResponse(float target, Response response) {
+        float peak = 0;
+        int last_out = 0;
+        for (int tick = 0; tick < STEP_TICKS; ++tick) {
+            const float value = response();
+            peak = fmaxf(peak, value);
+            if (fabsf(value - target) > 0.02f * target)
+                last_out = tick + 1;
+        }
+        return {(peak - target) / target * 100, (last_out + 1) * PERIOD};
+    }
+
+    const char* const RULES[] = {"ZN PI", "ZN PID", "TL PI", "TL PID", "some os", "no os"};
+
+}  // namespace
+
+// 速度环带噪声和无噪声时都收敛，结果与描述函数的解析解一致。无噪声时各个周期的长度相差一个控制
+// 周期，不能按单个周期的极差判断收敛
+// speed loops converge with and without noise and match the describing function. Without noise
+// the cycles differ by one control period, so convergence can not be judged on the spread of
+// single cycles
+static void TestIdentify() {
+    printf("identify:\n");
+    for (const motor_t& motor : MOTORS) {
+        const relay_tune_result_t predicted = Predict(motor, OMEGA_TUNE);
+        printf("  %s predicted:   Ku %7.1f, Tu %.4f s\n", motor.name, predicted.ku, predicted.tu);
+        for (float noise : {0.0f, 0.02f}) {
+            RelayAutoTuner tuner(OMEGA_TUNE);
+            Motor plant(motor, noise, 1);
+            const int ticks = TuneOmega(&tuner, &plant);
+            const relay_tune_result_t result = tuner.Result();
+            printf("  %s noise %.2f: Ku %7.1f, Tu %.4f s after %.3f s\n", motor.name, noise,
+                   result.ku, result.tu, ticks * PERIOD);
+            CHECK(tuner.State() == RelayAutoTuner::SUCCESS);
+            CHECK(ticks * PERIOD < 1);
+            // 描述函数只考虑基波，周期又按整数个控制周期测量
+            // the describing function only keeps the fundamental, and the period is measured in
+            // whole control periods
+            CHECK_NEAR(result.ku, predicted.ku, 0.1f * predicted.ku);
+            CHECK_NEAR(result.tu, predicted.tu, 0.2f * predicted.tu);
+        }
+    }
+}
+
+// 每种规则的参数在速度环和角度环上都稳定并在仿真结束前进入2%误差带。PID规则的微分项对目标阶跃
+// 有冲击，速度环的超调可达40%；保守的Tyreus-Luyben PI在两个环上的超调都不到20%
+// the gains of every rule are stable on speed and angle loops and enter the 2% band well before
+// the end. The derivative kicks on the target step, so the PID rules overshoot speed loops by up
+// to 40%, the conservative Tyreus-Luyben PI stays under 20% on both loops
+static void TestRules() {
+    printf("rules, overshoot and settling time:\n");
+    for (const motor_t& motor : MOTORS) {
+        RelayAutoTuner omega_tuner(OMEGA_TUNE);
+        Motor tune_plant(motor, 0.02f, 1);
+        TuneOmega(&omega_tuner, &tune_plant);
+        CHECK(omega_tuner.State() == RelayAutoTuner::SUCCESS);
+        const ConstrainedPID::PID_Init_t omega_init =
+            omega_tuner.Gains(RelayAutoTuner::TYREUS_LUYBEN_PI, OMEGA_MAX_IOUT, MAX_CURRENT);
+
+        RelayAutoTuner theta_tuner(THETA_TUNE);
+        Motor theta_plant(motor, 0.02f, 2);
+        TuneTheta(&theta_tuner, &theta_plant, omega_init);
+        CHECK(theta_tuner.State() == RelayAutoTuner::SUCCESS);
+
+        for (int rule = RelayAutoTuner::ZIEGLER_NICHOLS_PI;
+             rule <= RelayAutoTuner::NO_OVERSHOOT_PID; ++rule) {
+            const auto tune_rule = (RelayAutoTuner::tune_rule_t)rule;
+
+            ConstrainedPID omega_pid(omega_tuner.Gains(tune_rule, OMEGA_MAX_IOUT, MAX_CURRENT));
+            Motor omega_plant(motor, 0.02f, 3);
+            const step_t omega = StepResponse(5, [&]() {
+                omega_plant.Step(omega_pid.ComputeOutput(5, omega_plant.MeasureOmega()));
+                return omega_plant.Omega();
+            });
+
+            ConstrainedPID theta_pid(theta_tuner.Gains(tune_rule, THETA_MAX_IOUT, THETA_MAX_OUT));
+            ConstrainedPID inner_pid(omega_init);
+            Motor plant(motor, 0.02f, 4);
+            const step_t theta = StepResponse(1, [&]() {
+                const float target = theta_pid.ComputeOutput(1, plant.MeasureTheta());
+                plant.Step(inner_pid.ComputeOutput(target, plant.MeasureOmega()));
+                return plant.Theta();
+            });
+
+            printf("  %s %-7s: speed %5.1f%% %.3f s, angle %5.1f%% %.3f s\n", motor.name,
+                   RULES[rule], omega.overshoot, omega.settle, theta.overshoot, theta.settle);
+            CHECK(omega.settle < 0.2f);
+            CHECK(theta.settle < 1.2f);
+            CHECK(omega.overshoot < 50);
+            CHECK(theta.overshoot < 30);
+            if (tune_rule == RelayAutoTuner::TYREUS_LUYBEN_PI) {
+                CHECK(omega.overshoot < 20);
+                CHECK(theta.overshoot < 20);
+            }
+        }
+    }
+}
+
+// 继电器幅值太小时越不过滞环，超时后输出偏置；重新开始后可以再次整定
+// a relay too weak to cross the hysteresis times out and outputs the bias, after a restart the
+// tuning runs again
+static void TestTimeout() {
+    control::relay_tune_init_t init = OMEGA_TUNE;
+    init.amplitude = 1000;
+    init.bias = 1200;
+    init.timeout = 0.5f;
+    RelayAutoTuner tuner(init);
+    Motor plant(MOTORS[0], 0.02f, 5);
+    const int ticks = TuneOmega(&tuner, &plant);
+    printf("timeout: after %.3f s\n", ticks * PERIOD);
+    // 输出最多2200，稳态转速6.6，振荡中心5，低电平200只能降到0.6
+    // the output is at most 2200 or 6.6 rad/s steady, the low level of 200 only reaches 0.6
+    CHECK(tuner.State() == RelayAutoTuner::TIMEOUT);
+    CHECK(ticks == 501);
+    CHECK(tuner.Update(plant.MeasureOmega()) == init.bias);
+    CHECK(tuner.Result().ku == 0);
+
+    tuner.Restart();
+    CHECK(tuner.State() == RelayAutoTuner::RUNNING);
+    CHECK(tuner.Update(0) == init.bias + init.amplitude);
+}
+
+static void Benchmark() {
+    const long calls = 5000000;
+    control::relay_tune_init_t init = OMEGA_TUNE;
+    init.timeout = 1e9f;
+    RelayAutoTuner tuner(init);
+    float measure = 0, output = 0;
+    printf("benchmark:\n");
+    test::Stopwatch stopwatch;
+    for (long i = 0; i < calls; ++i) {
+        // 周期和幅值一直变化，不会收敛 / period and amplitude keep changing, never converges
+        measure = 5 + sinf(i * 1e-2f * (1 + (i & 0xFFFF) * 1e-4f)) * (i & 0xFF);
+        output += tuner.Update(measure);
+    }
+    test::Report("Update", stopwatch, calls);
+    test::Consume(output);
+}
+
+int main() {
+    TestIdentify();
+    TestRules();
+    TestTimeout();
+    Benchmark();
+    return test::Finish();
+}
@@ -0,0 +1,261 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// Ballistics的测试：17mm和42mm弹丸在各自的弹速、距离和高度范围内，解出的俯仰角用双精度RK4
+// 积分完整的平方阻力模型检验落点和飞行时间，射程内的目标不会被拒绝；没有阻力时与解析解相同；
+// 弹速估计的低通和限幅；以及每次解算的耗时
+// tests of Ballistics: over the muzzle speeds, distances and heights of the 17mm and 42mm
+// projectiles the solved pitch is flown through a double precision RK4 integration of the full
+// quadratic drag model to check the point of impact and the time of flight, and no target in
+// range is rejected; without drag it matches the closed form; the low pass and step limit of the
+// muzzle speed estimate; and the cost of a solve
+
+#include <math.h>
+
+#include <initializer_list>
+
+#include "ballistics.h"
+#include "test.h"
+
+using control::Ballistics;
+using control::ballistics_init_t;
+
+namespace {
+
+    constexpr double GRAVITY = 9.8;
+    // 检验落点的积分步长和判断能否打到的粗步长，RK4在后者下仍准到微米
+    // integration step checking the impact and a coarse one for the reachability sweep, RK4 is
+    // still accurate to micrometers with the latter
+    constexpr double DT = 1e-3;         // [s]
+    constexpr double COARSE_DT = 1e-2;  // [s]
+    constexpr double DEGREE = M_PI / 180;
+
+    // 双精度RK4积分到水平距离distance，返回该处的高度和时间；到不了时返回false
+    // double precision RK4 up to the horizontal distance, returning the height and time there;
+    // false when the projectile never gets there
+    bool Fly(double speed, double pitch, double drag, double distance, double* height,
+             double* time, double dt = DT) {
+        double s[4] = {0, 0, speed * cos(pitch), speed * sin(pitch)};
+        auto derivative = [drag](const double* state, double* out) {
+            const double v = hypot(state[2], state[3]);
+            out[0] = state[2];
+            out[1] = state[3];
+            out[2] = -drag * v * state[2];
+            out[3] = -drag * v * state[3] - GRAVITY;
+        };
+        double t = 0;
+        while (s[2] > 1e-6 && t < 20) {
+            double k[4][4], tmp[4];
+            derivative(s, k[0]);
+            for (int stage = 1; stage < 4; ++stage) {
+                const double h = stage == 3 ? dt : dt / 2;
+                for (int j = 0; j < 4; ++j)
+                    tmp[j] = s[j] + h * k[stage - 1][j];
+                derivative(tmp, k[stage]);
+            }
+            double next[4];
+            for (int j = 0; j < 4; ++j)
+                next[j] = s[j] + dt / 6 * (k[0][j] + 2 * k[1][j] + 2 * k[2][j] + k[3][j]);
+            if (next[0] >= distance) {
+                const double fraction = (distance - s[0]) / (next[0] - s[0]);
+                *height = s[1] + fraction * (next[1] - s[1]);
+                *time = t + fraction * dt;
+                return true;
+            }
+            for (int j = 0; j < 4; ++j)
+                s[j] = next[j];
+            t += dt;
+        }
+        return false;
+    }
+
+    // 在-80°到45°之间是否有俯仰角能打到目标高度 / whether any pitch from -80° to 45° reaches
+    // the height of the target
+    bool Reachable(double speed, double drag, double distance, double height) {
+        for (int degree = -80; degree <= 45; ++degree) {
+            double y, t;
+            if (Fly(speed, degree * DEGREE, drag, distance, &y, &t, COARSE_DT) && y >= height)
+                return true;
+        }
+        return false;
+    }
+
+    struct Envelope {
+        const char* name;
+        ballistics_init_t init;
+        float speeds[4];
+        float distances[11];
+        // 最大误差的上限 / bounds of the max errors
+        double miss;
+        double miss_30;
+        double time;
+    };
+
+}  // namespace
+
+// 弹速、距离和高度的网格：解出的弹道落点在1cm加1%距离以内，30°以内1cm以内，飞行时间差5ms以内，
+// 射程内的目标都能解出
+// a grid of muzzle speeds, distances and heights: solved arcs land within 1cm plus 1% of the
+// distance, within 1cm up to 30°, the time of flight is within 5ms, and every target in range is
+// solved
+static void TestEnvelope() {
+    const Envelope envelopes[] = {
+        {"17mm",
+         control::BALLISTICS_17MM_INIT,
+         {15, 20, 25, 30},
+         {0.5f, 1, 2, 3, 5, 8, 10, 12, 14, 16, 18},
+         0.03,
+         0.01,
+         0.005},
+        {"42mm",
+         control::BALLISTICS_42MM_INIT,
+         {10, 12, 14, 16},
+         {1, 2, 5, 8, 10, 12, 15, 18, 20, 22, 25},
+         0.12,
+         0.01,
+         0.005},
+    };
+    for (const Envelope& envelope : envelopes) {
+        int solved = 0, rejected = 0, wrong_rejects = 0, misses = 0;
+        double miss = 0, miss_30 = 0, time = 0;
+        for (float speed : envelope.speeds) {
+            Ballistics ballistics(envelope.init);
+            ballistics.UpdateMuzzleSpeed(speed);
+            for (float distance : envelope.distances) {
+                for (float height : {-1.0f, -0.5f, 0.0f, 0.5f, 1.0f, 2.0f}) {
+                    float pitch, flight;
+                    if (!ballistics.Solve(distance, height, &pitch, &flight)) {
+                        ++rejected;
+                        if (Reachable(speed, envelope.init.drag, distance, height))
+                            ++wrong_rejects;
+                        continue;
+                    }
+                    double y, t;
+                    if (!Fly(speed, pitch, envelope.init.drag, distance, &y, &t) ||
+                        fabs(y - height) > 0.01 + 0.01 * distance) {
+                        ++misses;
+                        continue;
+                    }
+                    ++solved;
+                    miss = fmax(miss, fabs(y - height));
+                    time = fmax(time, fabs(t - flight));
+                    if (pitch <= 30 * DEGREE)
+                        miss_30 = fmax(miss_30, fabs(y - height));
+                }
+            }
+        }
+        printf("%s: %d solved, %d rejected (%d in range), %d missed, max miss %.2f cm "
+               "(%.2f cm up to 30 deg), time of flight within %.2f ms\n",
+               envelope.name, solved, rejected, wrong_rejects, misses, miss * 100,
+               miss_30 * 100, time * 1000);
+        CHECK(wrong_rejects == 0);
+        CHECK(misses == 0);
+        CHECK(solved > 100);
+        CHECK(miss < envelope.miss);
+        CHECK(miss_30 < envelope.miss_30);
+        CHECK(time < envelope.time);
+    }
+}
+
+// 没有阻力时与真空中的解析解相同，低弹道超过45°的目标被拒绝
+// without drag the closed form in vacuum, targets whose low arc is above 45° are rejected
+static void TestVacuum() {
+    ballistics_init_t init = control::BALLISTICS_17MM_INIT;
+    init.drag = 0;
+    Ballistics ballistics(init);
+    ballistics.UpdateMuzzleSpeed(20);
+    const double v = 20;
+    double pitch_error = 0, time_error = 0;
+    for (float distance : {1.0f, 5.0f, 10.0f, 20.0f, 30.0f}) {
+        for (float height : {-1.0f, 0.0f, 1.0f, 3.0f}) {
+            float pitch, time;
+            const bool solved = ballistics.Solve(distance, height, &pitch, &time);
+            const double x = distance;
+            const double root =
+                sqrt(v * v * v * v - GRAVITY * (GRAVITY * x * x + 2 * height * v * v));
+            const double expected = atan((v * v - root) / (GRAVITY * x));
+            if (expected > M_PI / 4) {
+                CHECK(!solved);
+                CHECK_NEAR(pitch, M_PI / 4, 1e-6);
+                continue;
+            }
+            CHECK(solved);
+            pitch_error = fmax(pitch_error, fabs(pitch - expected));
+            time_error = fmax(time_error, fabs(time - x / (v * cos(expected))));
+        }
+    }
+    printf("vacuum: max pitch error %.3g rad, time of flight %.3g s\n", pitch_error, time_error);
+    CHECK(pitch_error < 1e-4);
+    CHECK(time_error < 1e-4);
+
+    // 超出射程时返回false / false beyond the range
+    float pitch;
+    CHECK(!ballistics.Solve(50, 0, &pitch));
+    CHECK(!ballistics.Solve(0, 0, &pitch));
+}
+
+// 第一发直接采用，之后每发最多改变speed_tolerance再低通，非正数忽略
+// the first shot is taken as is, later ones move at most speed_tolerance before the low pass,
+// non-positive readings are ignored
+static void TestMuzzleSpeed() {
+    const ballistics_init_t init = control::BALLISTICS_17MM_INIT;
+    Ballistics ballistics(init);
+    CHECK(ballistics.GetMuzzleSpeed() == init.muzzle_speed);
+    ballistics.UpdateMuzzleSpeed(24.5f);
+    CHECK(ballistics.GetMuzzleSpeed() == 24.5f);
+    ballistics.UpdateMuzzleSpeed(24.8f);
+    CHECK_NEAR(ballistics.GetMuzzleSpeed(), 24.5 + init.speed_filter * 0.3, 1e-5);
+    const float before = ballistics.GetMuzzleSpeed();
+    ballistics.UpdateMuzzleSpeed(40);
+    CHECK_NEAR(ballistics.GetMuzzleSpeed(), before + init.speed_filter * init.speed_tolerance,
+               1e-5);
+    ballistics.UpdateMuzzleSpeed(0);
+    ballistics.UpdateMuzzleSpeed(-3);
+    CHECK_NEAR(ballistics.GetMuzzleSpeed(), before + init.speed_filter * init.speed_tolerance,
+               1e-5);
+    // 弹速真的变了时几十发后跟上 / a real change is followed within a few dozen shots
+    for (int i = 0; i < 40; ++i)
+        ballistics.UpdateMuzzleSpeed(28);
+    CHECK_NEAR(ballistics.GetMuzzleSpeed(), 28, 0.01);
+}
+
+static void Benchmark() {
+    Ballistics ballistics(control::BALLISTICS_17MM_INIT);
+    ballistics.UpdateMuzzleSpeed(25);
+    const int N = 1 << 20;
+    float sum = 0;
+    printf("benchmark:\n");
+    test::Stopwatch stopwatch;
+    for (int i = 0; i < N; ++i) {
+        float pitch, time;
+        ballistics.Solve(1 + (i % 150) * 0.1f, (i % 7) * 0.2f - 0.5f, &pitch, &time);
+        sum += pitch + time;
+    }
+    test::Report("Solve", stopwatch, N);
+    test::Consume(sum);
+}
+
+int main() {
+    TestEnvelope();
+    TestVacuum();
+    TestMuzzleSpeed();
+    Benchmark();
+    return test::Finish();
+}
@@ -0,0 +1,326 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// BiquadFilter的测试：低通、高通和陷波的系数在各截止频率和Q下与预畸变的模拟原型经双线性变换后的
+// 解析频响一致；级联滤波器在时域中用Update和Process测得的幅值等于各节频响的乘积；稳态复位；
+// ACCEL_LPF_COEFF与原来AHRS中的加速度计滤波逐位相同；Process与Update混用时结果相同；3通道和
+// 8通道的耗时。按ARM_MATH_CM4编译时Process调用板子上CMSIS-DSP的arm_biquad_cascade_df2T_f32
+// tests of BiquadFilter: the low pass, high pass and notch coefficients over several cutoffs and
+// Qs match the analytic response of the prewarped analog prototype through the bilinear
+// transform; the amplitude of a cascade measured in the time domain through Update and Process
+// equals the product of the section responses; the steady state reset; ACCEL_LPF_COEFF is bit
+// for bit the old accelerometer filter of AHRS; Process and Update mixed give the same result;
+// and the cost with 3 and 8 channels. Built with ARM_MATH_CM4, Process calls the
+// arm_biquad_cascade_df2T_f32 of CMSIS-DSP on the boards
+
+#include <math.h>
+
+#include <complex>
+#include <initializer_list>
+
+#include "biquad.h"
+#include "test.h"
+
+using control::biquad_coeff_t;
+using control::BiquadFilter;
+
+namespace {
+
+    constexpr double FS = 1000;  // [Hz]
+
+    enum filter_type_t { LOW_PASS, HIGH_PASS, NOTCH };
+
+    // 模拟原型H(s)在预畸变频率上的幅值，截止频率归一化为1
+    // magnitude of the analog prototype H(s) at the prewarped frequency, normalized to a cutoff
+    // of 1
+    double Analytic(filter_type_t type, double fc, double q, double f) {
+        const std::complex<double> s(0, tan(M_PI * f / FS) / tan(M_PI * fc / FS));
+        const std::complex<double> den = s * s + s / q + 1.0;
+        const std::complex<double> num = type == LOW_PASS    ? 1.0
+                                         : type == HIGH_PASS ? s * s
+                                                             : s * s + 1.0;
+        return std::abs(num / den);
+    }
+
+    // 系数在频率f处的幅值 / magnitude of the coefficients at the frequency f
+    double Response(const biquad_coeff_t& k, double f) {
+        const std::complex<double> z = std::polar(1.0, -2 * M_PI * f / FS);
+        return std::abs(((double)k.b0 + (double)k.b1 * z + (double)k.b2 * z * z) /
+                        (1.0 + (double)k.a1 * z + (double)k.a2 * z * z));
+    }
+
+    biquad_coeff_t Design(filter_type_t type, double fc, double q) {
+        switch (type) {
+            case LOW_PASS:
+                return control::BiquadLowPass(FS, fc, q);
+            case HIGH_PASS:
+                return control::BiquadHighPass(FS, fc, q);
+            default:
+                return control::BiquadNotch(FS, fc, q);
+        }
+    }
+
+    // 用正弦输入运行4秒，由后一半的输出和正弦、余弦的相关求最后一个通道的幅值
+    // runs a sine through the filter for 4 seconds and takes the amplitude of the last channel
+    // from the correlation of the second half with a sine and a cosine
+    template <int CHANNELS, int STAGES>
+    double Measure(BiquadFilter<CHANNELS, STAGES>* filter, double f, bool block) {
+        constexpr int N = 4 * (int)FS;
+        static float input[CHANNELS][N], output[CHANNELS][N];
+        filter->Reset();
+        for (int n = 0; n < N; ++n)
+            for (int c = 0; c < CHANNELS; ++c)
+                input[c][n] = sin(2 * M_PI * f * n / FS + c);
+        if (block) {
+            for (int c = 0; c < CHANNELS; ++c)
+                filter->Process(c, input[c], output[c], N);
+        } else {
+            for (int n = 0; n < N; ++n) {
+                float x[CHANNELS], y[CHANNELS];
+                for (int c = 0; c < CHANNELS; ++c)
+                    x[c] = input[c][n];
+                filter->Update(x, y);
+                for (int c = 0; c < CHANNELS; ++c)
+                    output[c][n] = y[c];
+            }
+        }
+        double sine = 0, cosine = 0;
+        for (int n = N / 2; n < N; ++n) {
+            const double phase = 2 * M_PI * f * n / FS + (CHANNELS - 1);
+            sine += output[CHANNELS - 1][n] * sin(phase);
+            cosine += output[CHANNELS - 1][n] * cos(phase);
+        }
+        return 2 * hypot(sine, cosine) / (N / 2);
+    }
+
+}  // namespace
+
+// 系数的频响与解析值的差，只比较增益大于-20dB的频率
+// the response of the coefficients against the analytic one, at frequencies with a gain over
+// -20 dB only
+static void TestDesign() {
+    const char* names[] = {"low pass", "high pass", "notch"};
+    for (filter_type_t type : {LOW_PASS, HIGH_PASS, NOTCH}) {
+        double max_error = 0;
+        for (double fc : {5.0, 30.0, 100.0, 250.0, 400.0}) {
+            for (double q : {0.5, 0.70710678, 2.0, 10.0}) {
+                const biquad_coeff_t k = Design(type, fc, q);
+                for (double f = 0.5; f < FS / 2; f *= 1.05) {
+                    const double expected = Analytic(type, fc, q, f);
+                    if (expected > 0.1)
+                        max_error = fmax(max_error, fabs(20 * log10(Response(k, f) / expected)));
+                }
+            }
+        }
+        printf("%s: max error %.4f dB\n", names[type], max_error);
+        // 5Hz、Q为10的陷波紧挨零点处受float系数舍入的影响较大
+        // a 5 Hz notch with a Q of 10 suffers more from rounding the coefficients to float next to
+        // its null
+        CHECK(max_error < (type == NOTCH ? 0.05 : 0.01));
+    }
+
+    constexpr biquad_coeff_t low_pass = control::BiquadLowPass(1000, 50);
+    constexpr biquad_coeff_t notch = control::BiquadNotch(1000, 120, 5);
+    constexpr biquad_coeff_t high_pass = control::BiquadHighPass(1000, 2);
+    static_assert(low_pass.b0 > 0 && notch.b0 > 0 && high_pass.b0 > 0, "constexpr design");
+    CHECK_NEAR(Response(low_pass, 0), 1, 1e-6);
+    CHECK_NEAR(20 * log10(Response(low_pass, 50)), -3.0103, 1e-3);
+    CHECK(Response(notch, 120) < 1e-5);
+    CHECK_NEAR(Response(notch, 0), 1, 1e-6);
+    CHECK(Response(high_pass, 0) < 1e-6);
+    CHECK_NEAR(Response(high_pass, FS / 2), 1, 1e-5);
+}
+
+// 两节级联在时域中的幅值等于两节频响的乘积，Update和Process相同
+// the amplitude of a cascade of two sections in the time domain is the product of their
+// responses, for Update as for Process
+static void TestCascade() {
+    const biquad_coeff_t stages[2] = {control::BiquadLowPass(FS, 40),
+                                      control::BiquadNotch(FS, 120, 3)};
+    BiquadFilter<3, 2> filter(stages);
+    double max_error = 0;
+    for (double f : {10.0, 40.0, 80.0, 120.0, 200.0}) {
+        const double expected = Response(stages[0], f) * Response(stages[1], f);
+        max_error = fmax(max_error, fabs(Measure(&filter, f, false) - expected));
+        max_error = fmax(max_error, fabs(Measure(&filter, f, true) - expected));
+    }
+    printf("cascade: max amplitude error %.2e\n", max_error);
+    CHECK(max_error < 1e-5);
+}
+
+// 复位到稳态后，恒定输入的第一个输出就等于直流增益乘以输入
+// after a reset to the steady state the first output of a constant input is the DC gain times
+// the input
+static void TestReset() {
+    const biquad_coeff_t stages[2] = {control::BiquadLowPass(FS, 40),
+                                      control::BiquadHighPass(FS, 0.5f)};
+    BiquadFilter<3, 2> filter(stages);
+    const float input[3] = {0, -3, 9.8f};
+    float output[3];
+    filter.Reset(input);
+    for (int n = 0; n < 100; ++n) {
+        filter.Update(input, output);
+        const double gain = Response(stages[0], 0) * Response(stages[1], 0);
+        for (int c = 0; c < 3; ++c)
+            CHECK_NEAR(output[c], gain * input[c], 1e-5);
+    }
+    // 原来的系数舍入到float后直流增益为1.00002 / the DC gain of the old coefficients rounded to
+    // float is 1.00002
+    BiquadFilter<1> low_pass(control::ACCEL_LPF_COEFF);
+    low_pass.Reset(&input[2]);
+    CHECK_NEAR(low_pass.Update(9.8f), Response(control::ACCEL_LPF_COEFF, 0) * 9.8, 1e-5);
+}
+
+// ACCEL_LPF_COEFF与原来AHRS::Update中逐轴展开的滤波器逐位相同
+// ACCEL_LPF_COEFF is bit for bit the filter unrolled per axis in the old AHRS::Update
+static void TestLegacy() {
+    const float fliter_num[3] = {1.929454039488895f, -0.93178349823448126f,
+                                 0.002329458745586203f};
+    float accel_fliter_1 = 0, accel_fliter_2 = 0, accel_fliter_3 = 0;
+    BiquadFilter<1> filter(control::ACCEL_LPF_COEFF);
+    int mismatches = 0;
+    for (int n = 0; n < 5000; ++n) {
+        const float accel = 9.8f + sinf(n * 0.05f) + 0.3f * sinf(n * 1.7f);
+        accel_fliter_1 = accel_fliter_2;
+        accel_fliter_2 = accel_fliter_3;
+        accel_fliter_3 = accel_fliter_2 * fliter_num[0] + accel_fliter_1 * fliter_num[1] +
+                         accel * fliter_num[2];
+        if (filter.Update(accel) != accel_fliter_3)
+            ++mismatches;
+    }
+    printf("legacy: %d mismatches\n", mismatches);
+    CHECK(mismatches == 0);
+}
+
+// Process和Update处理同一段数据逐位相同，两者交替使用时共享状态
+// Process and Update give bit for bit the same output on one block, and share the state when
+// they take turns
+static void TestBlock() {
+    const biquad_coeff_t stages[3] = {control::BiquadLowPass(FS, 80, 0.54f),
+                                      control::BiquadLowPass(FS, 80, 1.31f),
+                                      control::BiquadNotch(FS, 50, 2)};
+    BiquadFilter<1, 3> block(stages), sample(stages);
+    test::Random random(1);
+    float input[1000], output[1000];
+    int mismatches = 0;
+    int position = 0;
+    while (position < 1000) {
+        const int length = 1 + random.Next() % 37;
+        const int end = position + length < 1000 ? position + length : 1000;
+        for (int n = position; n < end; ++n)
+            input[n] = random.Uniform(-1, 1);
+        // 交替用Process和Update推进block / block advances by Process and Update in turns
+        if (random.Next() % 2) {
+            block.Process(0, input + position, output + position, end - position);
+        } else {
+            for (int n = position; n < end; ++n)
+                output[n] = block.Update(input[n]);
+        }
+        for (int n = position; n < end; ++n)
+            if (sample.Update(input[n]) != output[n])
+                ++mismatches;
+        position = end;
+    }
+    // 原地处理 / in place
+    float in_place[1000];
+    for (int n = 0; n < 1000; ++n)
+        in_place[n] = input[n];
+    block.Reset();
+    sample.Reset();
+    block.Process(0, in_place, in_place, 1000);
+    for (int n = 0; n < 1000; ++n)
+        if (sample.Update(input[n]) != in_place[n])
+            ++mismatches;
+    printf("block, %s: %d mismatches\n",
+#ifdef BIQUAD_USE_CMSIS
+           "arm_biquad_cascade_df2T_f32",
+#else
+           "inline",
+#endif
+           mismatches);
+    CHECK(mismatches == 0);
+}
+
+template <int CHANNELS, int STAGES>
+static void BenchmarkUpdate(const biquad_coeff_t* stages, const char* name) {
+    BiquadFilter<CHANNELS, STAGES> filter(stages);
+    float x[CHANNELS], y[CHANNELS];
+    for (int c = 0; c < CHANNELS; ++c)
+        x[c] = c + 1;
+    const int N = 1 << 22;
+    test::Stopwatch stopwatch;
+    for (int n = 0; n < N; ++n) {
+        x[n % CHANNELS] += 1e-3f;
+        filter.Update(x, y);
+        x[0] = y[CHANNELS - 1] * 0.5f + 1;
+    }
+    test::Report(name, stopwatch, N);
+    test::Consume(y);
+}
+
+static void Benchmark() {
+    const biquad_coeff_t stages[2] = {control::ACCEL_LPF_COEFF, control::BiquadNotch(FS, 120, 3)};
+    printf("benchmark, one sample of every channel:\n");
+    {
+        const float fliter_num[3] = {1.929454039488895f, -0.93178349823448126f,
+                                     0.002329458745586203f};
+        float accel_fliter_1[3] = {0, 0, 0}, accel_fliter_2[3] = {0, 0, 0};
+        float accel_fliter_3[3] = {0, 0, 0}, accel[3] = {1, 2, 3};
+        const int N = 1 << 22;
+        test::Stopwatch stopwatch;
+        for (int n = 0; n < N; ++n) {
+            accel[n % 3] += 1e-3f;
+            for (int i = 0; i < 3; ++i) {
+                accel_fliter_1[i] = accel_fliter_2[i];
+                accel_fliter_2[i] = accel_fliter_3[i];
+                accel_fliter_3[i] = accel_fliter_2[i] * fliter_num[0] +
+                                    accel_fliter_1[i] * fliter_num[1] + accel[i] * fliter_num[2];
+            }
+            accel[0] = accel_fliter_3[2] * 0.5f + 1;
+        }
+        test::Report("old AHRS filter, 3 channels", stopwatch, N);
+        test::Consume(accel_fliter_3);
+    }
+    BenchmarkUpdate<3, 1>(stages, "Update, 3 channels x 1 stage");
+    BenchmarkUpdate<3, 2>(stages, "Update, 3 channels x 2 stages");
+    BenchmarkUpdate<8, 1>(stages, "Update, 8 channels x 1 stage");
+    BenchmarkUpdate<8, 2>(stages, "Update, 8 channels x 2 stages");
+
+    BiquadFilter<1, 2> filter(stages);
+    static float block[256];
+    for (int n = 0; n < 256; ++n)
+        block[n] = sinf(n * 0.1f);
+    const int rounds = 1 << 14;
+    test::Stopwatch stopwatch;
+    for (int r = 0; r < rounds; ++r)
+        filter.Process(0, block, block, 256);
+    test::Report("Process, 2 stages, per sample", stopwatch, rounds * 256L);
+    test::Consume(block);
+}
+
+int main() {
+    TestDesign();
+    TestCascade();
+    TestReset();
+    TestLegacy();
+    TestBlock();
+    Benchmark();
+    return test::Finish();
+}
@@ -0,0 +1,169 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// 切片查表的crc_check.c与原来逐字节查表的实现的等价性测试和耗时对比，分别按CRC_CHECK_SLICE为
+// 1、4、8编译
+// equivalence of the sliced table crc_check.c with the old byte at a time tables and their cost
+// per byte, built once for each of CRC_CHECK_SLICE 1, 4 and 8
+
+#include "crc_check.h"
+#include "crc_check_legacy.h"
+#include "test.h"
+
+static uint8_t buffer[4096 + 8];
+
+static void Fill(test::Random* random, uint8_t* data, int length) {
+    for (int i = 0; i < length; ++i)
+        data[i] = random->Next();
+}
+
+// 任意长度、初值和起始地址的校验和都与原来相同
+// checksums match the old ones for any length, initial value and start address
+static void TestChecksum() {
+    test::Random random(1);
+    int mismatches = 0;
+    for (int i = 0; i < 100000; ++i) {
+        const int offset = random.Next() % 8;
+        const int length = random.Next() % (i < 50000 ? 40 : 300);
+        uint8_t* data = buffer + offset;
+        Fill(&random, data, length);
+        const uint16_t init16 = i % 2 ? 0xffff : random.Next();
+        const uint8_t init8 = i % 2 ? 0xff : random.Next();
+        if (get_crc16_check_sum(data, length, init16) !=
+            legacy_get_crc16_check_sum(data, length, init16))
+            ++mismatches;
+        crc8_context_t crc8 = {init8};
+        crc8_update(&crc8, data, length);
+        if (crc8_final(&crc8) != legacy_get_crc8_check_sum(data, length, init8))
+            ++mismatches;
+    }
+    printf("checksum: %d mismatches\n", mismatches);
+    CHECK(mismatches == 0);
+}
+
+// 分段累加的结果与一次算完相同 / updating piece by piece gives the one shot result
+static void TestIncremental() {
+    test::Random random(2);
+    int mismatches = 0;
+    for (int i = 0; i < 20000; ++i) {
+        const int length = random.Next() % 300;
+        Fill(&random, buffer, length);
+        crc8_context_t crc8;
+        crc16_context_t crc16;
+        crc8_init(&crc8);
+        crc16_init(&crc16);
+        int position = 0;
+        while (position < length) {
+            const int piece = random.Next() % (length - position + 1);
+            crc8_update(&crc8, buffer + position, piece);
+            crc16_update(&crc16, buffer + position, piece);
+            position += piece;
+        }
+        if (crc8_final(&crc8) != legacy_get_crc8_check_sum(buffer, length, 0xff))
+            ++mismatches;
+        if (crc16_final(&crc16) != legacy_get_crc16_check_sum(buffer, length, 0xffff))
+            ++mismatches;
+    }
+    printf("incremental: %d mismatches\n", mismatches);
+    CHECK(mismatches == 0);
+}
+
+// 追加的校验和能被原来的实现验证，反之亦然，损坏的数据两边都拒绝
+// appended checksums verify with the old code and the other way round, both reject corrupted
+// data
+static void TestAppendVerify() {
+    test::Random random(3);
+    int mismatches = 0;
+    for (int i = 0; i < 20000; ++i) {
+        const int length = 3 + random.Next() % 297;
+        Fill(&random, buffer, length);
+        append_crc8_check_sum(buffer, length);
+        if (!legacy_verify_crc8_check_sum(buffer, length) || !verify_crc8_check_sum(buffer, length))
+            ++mismatches;
+        legacy_append_crc16_check_sum(buffer, length);
+        if (!verify_crc16_check_sum(buffer, length))
+            ++mismatches;
+        buffer[random.Next() % length] ^= 1 << random.Next() % 8;
+        if (verify_crc16_check_sum(buffer, length) != legacy_verify_crc16_check_sum(buffer, length))
+            ++mismatches;
+        if (verify_crc8_check_sum(buffer, length) != legacy_verify_crc8_check_sum(buffer, length))
+            ++mismatches;
+        if (verify_crc16_check_sum(buffer, length))
+            ++mismatches;
+    }
+    // 长度不够放校验和时不写也不通过 / too short for a checksum: nothing written, never valid
+    uint8_t small[2] = {0x12, 0x34};
+    append_crc16_check_sum(small, 2);
+    append_crc8_check_sum(small, 2);
+    CHECK(small[0] == 0x12 && small[1] == 0x34);
+    CHECK(!verify_crc16_check_sum(small, 2));
+    CHECK(!verify_crc8_check_sum(small, 2));
+    printf("append and verify: %d mismatches\n", mismatches);
+    CHECK(mismatches == 0);
+}
+
+static void Benchmark() {
+    test::Random random(4);
+    Fill(&random, buffer, 4096);
+    printf("benchmark, CRC_CHECK_SLICE %d:\n", CRC_CHECK_SLICE);
+    const int lengths[] = {9, 64, 300, 4096};
+    for (int length : lengths) {
+        const long calls = 50000000L / length;
+        char name[64];
+        uint16_t crc16 = 0;
+        test::Stopwatch stopwatch;
+        for (long i = 0; i < calls; ++i)
+            crc16 = legacy_get_crc16_check_sum(buffer, length, crc16);
+        snprintf(name, sizeof(name), "old crc16, %d bytes", length);
+        test::Report(name, stopwatch, calls);
+        test::Consume(crc16);
+
+        stopwatch.Restart();
+        for (long i = 0; i < calls; ++i)
+            crc16 = get_crc16_check_sum(buffer, length, crc16);
+        snprintf(name, sizeof(name), "crc16, %d bytes", length);
+        test::Report(name, stopwatch, calls);
+        test::Consume(crc16);
+
+        uint8_t crc8 = 0;
+        stopwatch.Restart();
+        for (long i = 0; i < calls; ++i)
+            crc8 = legacy_get_crc8_check_sum(buffer, length, crc8);
+        snprintf(name, sizeof(name), "old crc8, %d bytes", length);
+        test::Report(name, stopwatch, calls);
+        test::Consume(crc8);
+
+        crc8_context_t context = {0};
+        stopwatch.Restart();
+        for (long i = 0; i < calls; ++i)
+            crc8_update(&context, buffer, length);
+        snprintf(name, sizeof(name), "crc8, %d bytes", length);
+        test::Report(name, stopwatch, calls);
+        test::Consume(context);
+    }
+}
+
+int main() {
+    TestChecksum();
+    TestIncremental();
+    TestAppendVerify();
+    Benchmark();
+    return test::Finish();
+}
@@ -0,0 +1,228 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// MultiTurnEncoder长时间转动不漂移的测试：按整数刻度算出真值，与原来MotorCANBase里的浮点累加
+// 对比，以及每帧的耗时
+// long rotation test of MultiTurnEncoder: the truth is computed from integer ticks and compared
+// with the float accumulation in the old MotorCANBase, plus the cost of a frame
+
+#include <math.h>
+
+#include <initializer_list>
+
+#include "arm_math.h"
+#include "encoder.h"
+#include "test.h"
+#include "utils.h"
+
+using control::MultiTurnEncoder;
+
+namespace {
+
+    constexpr int RESOLUTION = 8192;
+
+    // 原来MotorCANBase::UpdateData里的计算 / the computation in the old MotorCANBase::UpdateData
+    class LegacyEncoder {
+      public:
+        explicit LegacyEncoder(float ratio) : ratio_(ratio) {
+        }
+
+        float Update(int raw) {
+            const float theta = raw * (2 * PI / RESOLUTION);
+            if (align_angle_ < 0)
+                align_angle_ = theta;
+            const float motor_angle = theta - align_angle_;
+            float servo_angle;
+            if (ratio_ != 1) {
+                inner_.input(motor_angle);
+                if (inner_.negEdge())
+                    offset_angle_ = wrap<float>(offset_angle_ + 2 * PI / ratio_, 0, 2 * PI);
+                else if (inner_.posEdge())
+                    offset_angle_ = wrap<float>(offset_angle_ - 2 * PI / ratio_, 0, 2 * PI);
+                servo_angle = wrap<float>(offset_angle_ + motor_angle / ratio_, 0, 2 * PI);
+            } else {
+                servo_angle = wrap<float>(motor_angle, 0, 2 * PI);
+            }
+            outer_.input(servo_angle);
+            if (outer_.negEdge())
+                cumulated_angle_ += 2 * PI;
+            else if (outer_.posEdge())
+                cumulated_angle_ -= 2 * PI;
+            return servo_angle + cumulated_angle_;
+        }
+
+      private:
+        float ratio_;
+        float align_angle_ = -1;
+        float offset_angle_ = 0;
+        float cumulated_angle_ = 0;
+        FloatEdgeDetector inner_ = FloatEdgeDetector(0, PI);
+        FloatEdgeDetector outer_ = FloatEdgeDetector(0, PI);
+    };
+
+    typedef struct {
+        const char* name;
+        double ratio;
+        int32_t numerator;    // 期望的分数 / expected fraction
+        int32_t denominator;
+        double rpm;           // 转子转速 / rotor speed
+        double seconds;
+        bool reverse;         // 3秒一次往返 / back and forth every 3 s
+    } rotation_t;
+
+    const rotation_t ROTATIONS[] = {
+        {"loader 2006 36:1", 36, 36, 1, 21000, 420, false},
+        {"loader 2006 36:1, back and forth", 36, 36, 1, 21000, 420, true},
+        {"chassis 3508 3591:187", 3591.0 / 187, 3591, 187, 9000, 420, false},
+        {"chassis 3508 rounded to 19:1", 19, 19, 1, 9000, 420, false},
+        {"flywheel 3508 1:1", 1, 1, 1, 7500, 420, false},
+        {"step up 1:2", 0.5, 1, 2, 3000, 120, true},
+    };
+
+}  // namespace
+
+// 减速比化成的分数 / the fraction the gear ratio turns into
+static void TestRatio() {
+    for (const rotation_t& rotation : ROTATIONS) {
+        MultiTurnEncoder encoder;
+        encoder.SetRatio(rotation.ratio);
+        int32_t numerator, denominator;
+        encoder.GetRatio(&numerator, &denominator);
+        CHECK(numerator == rotation.numerator);
+        CHECK(denominator == rotation.denominator);
+    }
+}
+
+// 转子按带噪声的速度转动几分钟，输出轴的整圈数和刻度数始终精确，累计角度的误差只有float表示
+// 真值本身的舍入
+// the rotor turns for minutes at a noisy speed; whole turns and ticks of the output shaft stay
+// exact and the accumulated angle is only off by the rounding of the truth to float
+static void TestLongRotation() {
+    for (const rotation_t& rotation : ROTATIONS) {
+        MultiTurnEncoder encoder;
+        encoder.SetRatio(rotation.ratio);
+        LegacyEncoder legacy(rotation.ratio);
+        test::Random random(7);
+        const int64_t origin = 1234;
+        int64_t position = origin;
+        double speed = 0, fraction = 0;
+        encoder.Reset(origin % RESOLUTION, origin % RESOLUTION);
+        legacy.Update(origin % RESOLUTION);
+        const int64_t period = (int64_t)RESOLUTION * rotation.numerator;
+        int wrong = 0;
+        double max_error = 0, max_error_rad = 0, max_legacy_error = 0;
+        const int frames = rotation.seconds * 1000;
+        for (int k = 0; k < frames; ++k) {
+            // 1kHz的反馈帧，每帧的刻度数 / 1 kHz feedback, ticks per frame
+            double target = rotation.rpm / 60 * RESOLUTION / 1000;
+            if (rotation.reverse)
+                target *= sin(2 * M_PI * k / 3000);
+            speed += 0.02 * (target - speed);
+            fraction += speed + random.Uniform(-3, 3);
+            const int64_t step = (int64_t)floor(fraction);
+            fraction -= step;
+            position += step;
+            const int raw = (int)(((position % RESOLUTION) + RESOLUTION) % RESOLUTION);
+            encoder.Update(raw);
+            const float legacy_theta = legacy.Update(raw);
+
+            const int64_t ticks = position - origin;
+            const int64_t scaled = ticks * rotation.denominator;
+            const int64_t turns =
+                scaled >= 0 ? scaled / period : -((-scaled + period - 1) / period);
+            if (encoder.GetTicks() != ticks || encoder.GetTurns() != turns)
+                ++wrong;
+            const double truth = 2 * M_PI * scaled / period;
+            // 圈内角度本身也是float，不足一圈时按2PI的ulp算
+            // the angle within the turn is a float too, below one turn the ulp of 2PI applies
+            const float magnitude = fmax(fabs(truth), 2 * M_PI);
+            const double ulp = nextafterf(magnitude, INFINITY) - magnitude;
+            max_error = fmax(max_error, fabs(encoder.GetTheta() - truth) / ulp);
+            max_error_rad = fmax(max_error_rad, fabs(encoder.GetTheta() - truth));
+            max_legacy_error = fmax(max_legacy_error, fabs(legacy_theta - truth));
+        }
+        const double turns = (double)(position - origin) * rotation.denominator / period;
+        printf("%-34s %6.0f turns, max error %.1f ulp (%.2g rad), old code %.3g rad\n",
+               rotation.name, turns, max_error, max_error_rad, max_legacy_error);
+        CHECK(wrong == 0);
+        CHECK(max_error <= 2);
+    }
+}
+
+// 往返后回到起点时角度严格为0 / back at the start the angle is exactly zero
+static void TestReturn() {
+    MultiTurnEncoder encoder;
+    encoder.SetRatio(3591.0f / 187);
+    encoder.Reset(100, 100);
+    int64_t position = 100;
+    for (int direction : {1, -1}) {
+        for (int k = 0; k < 200000; ++k) {
+            position += direction * 2000;
+            encoder.Update(position % RESOLUTION);
+        }
+    }
+    CHECK(encoder.GetTicks() == 0);
+    CHECK(encoder.GetTurns() == 0);
+    CHECK(encoder.GetTheta() == 0);
+}
+
+static void Benchmark() {
+    const int N = 1 << 16;
+    static int raws[N];
+    int64_t position = 0;
+    for (int i = 0; i < N; ++i) {
+        position += 2000;
+        raws[i] = position % RESOLUTION;
+    }
+    printf("benchmark, one frame:\n");
+    const int rounds = 100;
+    for (float ratio : {1.0f, 36.0f}) {
+        char name[64];
+        LegacyEncoder legacy(ratio);
+        float theta = 0;
+        test::Stopwatch stopwatch;
+        for (int r = 0; r < rounds; ++r)
+            for (int i = 0; i < N; ++i)
+                theta += legacy.Update(raws[i]);
+        snprintf(name, sizeof(name), "old MotorCANBase, ratio %.0f", ratio);
+        test::Report(name, stopwatch, (long)rounds * N);
+
+        MultiTurnEncoder encoder;
+        encoder.SetRatio(ratio);
+        stopwatch.Restart();
+        for (int r = 0; r < rounds; ++r) {
+            for (int i = 0; i < N; ++i) {
+                encoder.Update(raws[i]);
+                theta += encoder.GetTheta();
+            }
+        }
+        snprintf(name, sizeof(name), "MultiTurnEncoder, ratio %.0f", ratio);
+        test::Report(name, stopwatch, (long)rounds * N);
+        test::Consume(theta);
+    }
+}
+
+int main() {
+    TestRatio();
+    TestLongRotation();
+    TestReturn();
+    Benchmark();
+    return test::Finish();
+}
@@ -0,0 +1,302 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// fastmath.h的测试：各函数在文档给出的范围内的最大误差（反正弦逐个float的步长采样，反正切包括
+// 接近坐标轴的点，正余弦分别在[-pi, pi]和[-100, 100]内），wrapc<float>与循环实现一致，以C编译的
+// 结果与C++相同，以及与libm和板子上CMSIS-DSP查表arm_sin_f32的耗时对比
+// tests of fastmath.h: the max error of every function over its documented range (arc sine
+// strided through every float, arc tangent including points close to the axes, sine and cosine
+// within [-pi, pi] and [-100, 100]), wrapc<float> against the loop version, the C build giving
+// the C++ results, and the cost against libm and the table based arm_sin_f32 of CMSIS-DSP on the
+// boards
+
+#include <math.h>
+#include <string.h>
+
+#include <initializer_list>
+
+#include "fastmath.h"
+#include "test.h"
+#include "utils.h"
+
+extern "C" {
+float cmsis_sin_f32(float x);
+float cmsis_cos_f32(float x);
+void fastmath_c(float x, float y, float result[6]);
+}
+
+namespace {
+
+    // 逐个float遍历时的步长，取与2的幂互质的数使尾数的每一位都被覆盖
+    // stride when stepping through the floats, coprime with powers of 2 so every mantissa bit is
+    // covered
+    constexpr uint32_t STRIDE = 61;
+
+    float FromBits(uint32_t bits) {
+        float x;
+        memcpy(&x, &bits, sizeof(x));
+        return x;
+    }
+
+    // x处相邻两个float的间距 / spacing of the floats around x
+    double Ulp(float x) {
+        x = fabsf(x);
+        return (double)nextafterf(x, INFINITY) - x;
+    }
+
+    // 原来的循环实现，即通用的wrapc<T> / the loop version, i.e. the generic wrapc<T>
+    float LoopWrap(float value, float min, float max) {
+        const float range = max - min;
+        while (value < min)
+            value += range;
+        while (value > max)
+            value -= range;
+        return value;
+    }
+
+}  // namespace
+
+// 反正弦：[-1, 1]内的float，端点和越界的输入被限制
+// arc sine: floats in [-1, 1], the end points and clamped inputs out of range
+static void TestAsin() {
+    double max_error = 0;
+    for (uint32_t bits = 0; bits <= 0x3f800000u; bits += STRIDE) {
+        const float x = FromBits(bits);
+        for (float v : {x, -x})
+            max_error = fmax(max_error, fabs(fast_asinf(v) - asin((double)v)));
+    }
+    printf("asin: max error %.3g\n", max_error);
+    CHECK(max_error < 3e-7);
+    CHECK_NEAR(fast_asinf(1), M_PI / 2, 3e-7);
+    CHECK_NEAR(fast_asinf(-1), -M_PI / 2, 3e-7);
+    CHECK_NEAR(fast_asinf(1.0001f), M_PI / 2, 3e-7);
+    CHECK_NEAR(fast_asinf(-1.5f), -M_PI / 2, 3e-7);
+}
+
+// 四象限反正切：随机点，其中一半贴近x轴或y轴，以及坐标轴上的点
+// four quadrant arc tangent: random points, half of them close to the x or y axis, and points on
+// the axes
+static void TestAtan2() {
+    test::Random random(1);
+    double max_error = 0;
+    for (int i = 0; i < 4000000; ++i) {
+        float y = random.Uniform(-1, 1);
+        float x = random.Uniform(-1, 1);
+        if (i % 4 == 1)
+            y *= 1e-3f;
+        if (i % 4 == 2)
+            x *= 1e-3f;
+        max_error = fmax(max_error, fabs(fast_atan2f(y, x) - atan2((double)y, (double)x)));
+    }
+    printf("atan2: max error %.3g\n", max_error);
+    CHECK(max_error < 2e-6);
+    CHECK(fast_atan2f(0, 0) == 0);
+    CHECK(fast_atan2f(0, 1) == 0);
+    CHECK_NEAR(fast_atan2f(0, -1), M_PI, 2e-6);
+    CHECK_NEAR(fast_atan2f(1, 0), M_PI / 2, 2e-6);
+    CHECK_NEAR(fast_atan2f(-1, 0), -M_PI / 2, 2e-6);
+    CHECK_NEAR(fast_atan2f(-1, -1), -3 * M_PI / 4, 2e-6);
+}
+
+// 正余弦：[-pi, pi]和[-100, 100]内的均匀网格，同时给出CMSIS-DSP查表的误差作比较。板子上的
+// arm_sin_f32在x / 2pi舍入为负整数时（如-14 * 2pi）下标回绕到0而插值系数仍为512，返回约6.28
+// sine and cosine: uniform grids over [-pi, pi] and [-100, 100], with the error of the CMSIS-DSP
+// table for comparison. When x / 2pi rounds to a negative integer (e.g. -14 * 2pi) the arm_sin_f32
+// on the boards wraps its table index to 0 but keeps an interpolation fraction of 512, returning
+// about 6.28
+static void TestSinCos() {
+    const int N = 2000000;
+    for (float range : {FAST_PI, 100.0f, 1000.0f}) {
+        double max_error = 0, cmsis_error = 0;
+        for (int i = 0; i <= N; ++i) {
+            const float x = -range + 2 * range * i / N;
+            float s, c;
+            fast_sincosf(x, &s, &c);
+            const double sine = sin((double)x), cosine = cos((double)x);
+            max_error = fmax(max_error, fmax(fabs(s - sine), fabs(c - cosine)));
+            cmsis_error = fmax(cmsis_error, fmax(fabs(cmsis_sin_f32(x) - sine),
+                                                 fabs(cmsis_cos_f32(x) - cosine)));
+        }
+        printf("sincos |x| <= %g: max error %.3g, arm_sin_f32 and arm_cos_f32 %.3g\n", range,
+               max_error, cmsis_error);
+        if (range == FAST_PI)
+            CHECK(max_error < 4e-7);
+        else if (range == 100)
+            CHECK(max_error < 4e-6);
+        CHECK(max_error < cmsis_error);
+    }
+}
+
+// 环绕：误差不超过value和范围端点中最大者的一个ulp，与循环实现和wrapc<float>一致
+// wrap: off by at most one ulp of the largest of value and the range ends, agreeing with the loop
+// version and wrapc<float>
+static void TestWrap() {
+    test::Random random(2);
+    int failures = 0;
+    double max_error = 0;
+    for (int i = 0; i < 4000000; ++i) {
+        const bool degrees = i % 2;
+        const float min = degrees ? 0 : -FAST_PI;
+        const float max = degrees ? 360 : FAST_PI;
+        const float value = random.Uniform(-50, 50) * (degrees ? 100 : 1);
+        const float wrapped = fast_wrapf(value, min, max);
+        const double ulp = fmax(Ulp(value), fmax(Ulp(min), Ulp(max)));
+        const double error = fabs(remainder((double)wrapped - value, (double)max - min)) / ulp;
+        max_error = fmax(max_error, error);
+        if (error > 1 || wrapped < min - ulp || wrapped > max + ulp)
+            ++failures;
+        if (wrapc<float>(value, min, max) != wrapped)
+            ++failures;
+        // 循环实现每加减一次就舍入一次，差值可能与范围同余
+        // the loop version rounds at every step and may differ by a whole range
+        const float loop = LoopWrap(value, min, max);
+        if (fabs(remainder((double)loop - wrapped, (double)max - min)) > 2 * fabs(value) * 1e-6)
+            ++failures;
+    }
+    printf("wrap: max error %.3g ulp, %d failures\n", max_error, failures);
+    CHECK(failures == 0);
+    CHECK(fast_wrapf(FAST_PI, -FAST_PI, FAST_PI) == -FAST_PI);
+    CHECK(fast_wrapf(-FAST_PI, -FAST_PI, FAST_PI) == -FAST_PI);
+    CHECK(fast_wrapf(1, -FAST_PI, FAST_PI) == 1);
+}
+
+// 平方根的倒数：所有正规化的正float按步长采样
+// reciprocal square root: positive normal floats, strided
+static void TestInvSqrt() {
+    double max_error = 0;
+    for (uint32_t bits = 0x00800000u; bits < 0x7f800000u; bits += STRIDE) {
+        const float x = FromBits(bits);
+        const double expected = 1 / sqrt((double)x);
+        max_error = fmax(max_error, fabs(fast_invsqrtf(x) - expected) / expected);
+    }
+    printf("invsqrt: max relative error %.3g\n", max_error);
+    CHECK(max_error < 4.8e-6);
+}
+
+// 以C编译的结果与C++逐位相同 / the C build gives bit for bit the C++ results
+static void TestC() {
+    test::Random random(3);
+    int mismatches = 0;
+    for (int i = 0; i < 100000; ++i) {
+        const float x = random.Uniform(-10, 10);
+        const float y = random.Uniform(-1, 1);
+        float c[6], cpp[6];
+        fastmath_c(x, y, c);
+        cpp[0] = fast_atan2f(y, x);
+        cpp[1] = fast_asinf(y);
+        fast_sincosf(x, &cpp[2], &cpp[3]);
+        cpp[4] = fast_wrapf(x, -FAST_PI, FAST_PI);
+        cpp[5] = fast_invsqrtf(fabsf(x) + 1e-3f);
+        if (memcmp(c, cpp, sizeof(c)) != 0)
+            ++mismatches;
+    }
+    printf("c: %d mismatches\n", mismatches);
+    CHECK(mismatches == 0);
+}
+
+static void Benchmark() {
+    const int N = 1 << 16;
+    const int ROUNDS = 64;
+    static float a[N], b[N];
+    test::Random random(4);
+    for (int i = 0; i < N; ++i) {
+        a[i] = random.Uniform(-1, 1);
+        b[i] = random.Uniform(-1, 1);
+    }
+    const long calls = (long)N * ROUNDS;
+
+    printf("benchmark:\n");
+    float sum = 0;
+    test::Stopwatch stopwatch;
+    for (int r = 0; r < ROUNDS; ++r)
+        for (int i = 0; i < N; ++i)
+            sum += atan2f(a[i], b[i]);
+    test::Report("atan2f", stopwatch, calls);
+    stopwatch.Restart();
+    for (int r = 0; r < ROUNDS; ++r)
+        for (int i = 0; i < N; ++i)
+            sum += fast_atan2f(a[i], b[i]);
+    test::Report("fast_atan2f", stopwatch, calls);
+
+    stopwatch.Restart();
+    for (int r = 0; r < ROUNDS; ++r)
+        for (int i = 0; i < N; ++i)
+            sum += asinf(a[i]);
+    test::Report("asinf", stopwatch, calls);
+    stopwatch.Restart();
+    for (int r = 0; r < ROUNDS; ++r)
+        for (int i = 0; i < N; ++i)
+            sum += fast_asinf(a[i]);
+    test::Report("fast_asinf", stopwatch, calls);
+
+    stopwatch.Restart();
+    for (int r = 0; r < ROUNDS; ++r)
+        for (int i = 0; i < N; ++i)
+            sum += sinf(3 * a[i]) + cosf(3 * a[i]);
+    test::Report("sinf + cosf", stopwatch, calls);
+    stopwatch.Restart();
+    for (int r = 0; r < ROUNDS; ++r)
+        for (int i = 0; i < N; ++i)
+            sum += cmsis_sin_f32(3 * a[i]) + cmsis_cos_f32(3 * a[i]);
+    test::Report("arm_sin_f32 + arm_cos_f32", stopwatch, calls);
+    stopwatch.Restart();
+    for (int r = 0; r < ROUNDS; ++r) {
+        for (int i = 0; i < N; ++i) {
+            float s, c;
+            fast_sincosf(3 * a[i], &s, &c);
+            sum += s + c;
+        }
+    }
+    test::Report("fast_sincosf", stopwatch, calls);
+
+    stopwatch.Restart();
+    for (int r = 0; r < ROUNDS; ++r)
+        for (int i = 0; i < N; ++i)
+            sum += LoopWrap(20 * a[i], -FAST_PI, FAST_PI);
+    test::Report("loop wrap, |x| <= 20", stopwatch, calls);
+    stopwatch.Restart();
+    for (int r = 0; r < ROUNDS; ++r)
+        for (int i = 0; i < N; ++i)
+            sum += fast_wrapf(20 * a[i], -FAST_PI, FAST_PI);
+    test::Report("fast_wrapf, |x| <= 20", stopwatch, calls);
+
+    stopwatch.Restart();
+    for (int r = 0; r < ROUNDS; ++r)
+        for (int i = 0; i < N; ++i)
+            sum += 1.0f / sqrtf(a[i] + 2);
+    test::Report("1.0f / sqrtf", stopwatch, calls);
+    stopwatch.Restart();
+    for (int r = 0; r < ROUNDS; ++r)
+        for (int i = 0; i < N; ++i)
+            sum += fast_invsqrtf(a[i] + 2);
+    test::Report("fast_invsqrtf", stopwatch, calls);
+    test::Consume(sum);
+}
+
+int main() {
+    TestAsin();
+    TestAtan2();
+    TestSinCos();
+    TestWrap();
+    TestInvSqrt();
+    TestC();
+    Benchmark();
+    return test::Finish();
+}
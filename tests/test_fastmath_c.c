@@ -0,0 +1,33 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// 以C编译fastmath.h，确认头文件在C中可用，并给test_fastmath.cpp提供C编译的结果作对比
+// fastmath.h built as C, to make sure the header works from C and to give test_fastmath.cpp the
+// C build's results to compare with
+
+#include "fastmath.h"
+
+void fastmath_c(float x, float y, float result[6]) {
+    result[0] = fast_atan2f(y, x);
+    result[1] = fast_asinf(y);
+    fast_sincosf(x, &result[2], &result[3]);
+    result[4] = fast_wrapf(x, -FAST_PI, FAST_PI);
+    result[5] = fast_invsqrtf(fabsf(x) + 1e-3f);
+}
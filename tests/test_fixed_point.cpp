@@ -0,0 +1,368 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// 定点控制内核的测试：FixedPID、PIDControllerQ15/Q31、FixedRampSource、FixedEase和整数版本的
+// PowerLimit与浮点实现对比的误差上限，FlyWheelMotor改用MotorPID后的速度环，Q15/Q31辅助函数的
+// 饱和，以及主机上的耗时
+// tests of the fixed point control kernels: error bounds of FixedPID, PIDControllerQ15/Q31,
+// FixedRampSource, FixedEase and the integer PowerLimit against the float implementations, the
+// FlyWheelMotor speed loop on MotorPID, saturation of the Q15/Q31 helpers, and the host timings
+
+#include <math.h>
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+#include "fixed_point.h"
+#include "pid_cases.h"
+#include "power_limit.h"
+#include "utils.h"
+
+using control::ConstrainedPID;
+using control::FixedPID;
+using namespace control::fixed;
+
+namespace {
+
+    constexpr uint8_t IL = ConstrainedPID::Integral_Limit;
+    constexpr uint8_t DOM = ConstrainedPID::Derivative_On_Measurement;
+    constexpr uint8_t TI = ConstrainedPID::Trapezoid_Intergral;
+    constexpr uint8_t OF = ConstrainedPID::OutputFilter;
+    constexpr uint8_t CIR = ConstrainedPID::ChangingIntegralRate;
+    constexpr uint8_t DF = ConstrainedPID::DerivativeFilter;
+
+    // 浮点参考使用定点实现能表示的参数：增益取到2^-16的整数倍，滤波系数取到2^-15的整数倍，
+    // 死区、变速积分参数和限幅取整，比较的只是运算本身的误差
+    // the float reference uses parameters the fixed point code can represent: gains on multiples
+    // of 2^-16, filter coefficients on multiples of 2^-15, and the dead band, the changing
+    // integral parameters and the limits rounded, so only the arithmetic itself is compared
+    test::pid_init_t RepresentableInit(test::Random* random, uint8_t mode) {
+        test::pid_init_t init = test::RandomPIDInit(random, mode);
+        init.kp = roundf(init.kp * 65536) / 65536;
+        init.ki = roundf(init.ki * 65536) / 65536;
+        init.kd = roundf(init.kd * 65536) / 65536;
+        init.max_out = roundf(init.max_out);
+        init.max_iout = roundf(init.max_iout);
+        init.deadband = roundf(random->Uniform(0, 3));
+        init.A = roundf(random->Uniform(1, 2000));
+        init.B = roundf(random->Uniform(0, 1000));
+        init.output_filtering_coefficient =
+            roundf(init.output_filtering_coefficient * 32768) / 32768;
+        init.derivative_filtering_coefficient =
+            roundf(init.derivative_filtering_coefficient * 32768) / 32768;
+        return init;
+    }
+
+    // 浮点PID驱动被控对象，两个PID看到相同的整数测量值，比较取整后的输出。
+    // 积分限幅和变速积分按积分的符号做判断，积分在0附近时两边的舍入误差可能让判断不同，之后积分
+    // 相差一整步且不会再回到一致，这种情况记为一次分歧并结束本次比较
+    // the float PID drives the plant, both PIDs see the same integer measurement and the rounded
+    // outputs are compared. The integral limit and the changing integral rate branch on the sign
+    // of the integral, near zero the rounding on either side can take different branches, after
+    // which the integrals differ by a whole step for good; that is counted as a divergence and
+    // ends the comparison
+    float MaxPIDError(const test::pid_init_t& init, uint32_t seed, int* divergences) {
+        ConstrainedPID reference(init);
+        FixedPID pid(init);
+        test::Plant plant(0.5f);
+        test::Random random(seed);
+        float worst = 0;
+        for (int step = 0; step < 2000; ++step) {
+            const int32_t target = (int32_t)roundf(test::Target(&random, step) * 400);
+            const int32_t measure = (int32_t)roundf(plant.Value());
+            const float output = reference.ComputeOutput((float)target, (float)measure);
+            const int32_t fixed = pid.ComputeOutput(target, measure);
+            const float iout = reference.State().iout;
+            if (fabsf(pid.State().iout - iout) > 1 + fabsf(iout) * 1e-4f) {
+                ++*divergences;
+                break;
+            }
+            worst = fmaxf(worst, fabsf(fixed - output));
+            plant.Step(output);
+        }
+        return worst;
+    }
+
+    // FlyWheelMotor的参数，与examples/F103_Nano_general/motor/m3508_flywheel.cpp相同
+    // the FlyWheelMotor gains of examples/F103_Nano_general/motor/m3508_flywheel.cpp
+    float flywheel_pid[3] = {150, 1, 0.15f};
+    constexpr float RPM_TO_RAD = 2 * PI / 60;
+
+    // 速度环驱动被控对象，测量值和电机的反馈一样是整数转速[rpm]，返回每步的转速
+    // the speed loop drives the plant, the measurement is an integer speed [rpm] like the motor
+    // feedback; returns the speed of every step
+    template <typename Compute>
+    std::vector<float> RunFlywheel(const std::vector<int32_t>& targets, Compute compute) {
+        test::Plant plant(0.5f);
+        std::vector<float> speeds;
+        for (const int32_t target : targets) {
+            const int16_t measure = (int16_t)roundf(plant.Value());
+            speeds.push_back(plant.Step(compute(target, measure)));
+        }
+        return speeds;
+    }
+
+    // 与ConstrainedPID和FixedPID都兼容的构造和调用方式，即FlyWheelMotor使用MotorPID的方式
+    // construction and calls compatible with both ConstrainedPID and FixedPID, i.e. the way
+    // FlyWheelMotor uses MotorPID
+    template <typename PID>
+    std::vector<float> RunMotorPID(const std::vector<int32_t>& targets) {
+        const float* param = flywheel_pid;
+        PID pid(param[0] * RPM_TO_RAD, param[1] * RPM_TO_RAD, param[2] * RPM_TO_RAD,
+                control::MOTOR_RANGE, control::MOTOR_RANGE);
+        return RunFlywheel(targets, [&pid](int32_t target, int16_t measure) {
+            return (int16_t)pid.ComputeOutput(target, measure);
+        });
+    }
+
+}  // namespace
+
+// FixedPID与ConstrainedPID在每种模式组合下的最大输出误差
+// the largest output difference of FixedPID and ConstrainedPID for every mode combination
+static void TestPID() {
+    struct {
+        const char* name;
+        uint8_t mode;
+        float bound;
+    } cases[] = {
+        // 积分不限幅时浮点参考自身的舍入误差随积分变大 / without the integral limit the float
+        // reference's own rounding grows with the integral
+        {"plain", 0, 2.5f},
+        // 只有输出取整 / only the rounding of the output
+        {"integral limit", IL, 0.51f},
+        // 变速积分的速率是Q15，每步差不到1个LSB，会在积分里累积
+        // the changing integral rate is Q15, less than one LSB off per step, which adds up in the
+        // integral
+        {"speed loop", IL | TI | CIR, 1.25f},
+        {"with filters", IL | TI | CIR | DOM | DF | OF, 2.0f},
+    };
+    test::Random random(1);
+    printf("FixedPID, largest output error [LSB]:\n");
+    for (const auto& c : cases) {
+        const int trials = 200;
+        int divergences = 0;
+        float worst = 0;
+        for (int trial = 0; trial < trials; ++trial) {
+            const test::pid_init_t init = RepresentableInit(&random, c.mode);
+            worst = fmaxf(worst, MaxPIDError(init, trial, &divergences));
+        }
+        printf("  %-16s %.3f, %d of %d runs diverged\n", c.name, worst, divergences, trials);
+        CHECK(worst <= c.bound);
+        CHECK(divergences <= trials / 50);
+    }
+}
+
+// arm_pid_q15/q31与arm_pid_f32各自跑一个闭环，比较被控量。arm_pid_q15每步截断输出，开环时
+// 积分每步偏0.5个LSB，闭环时剩下一个与ki成反比的死区
+// arm_pid_q15/q31 and arm_pid_f32 each run a closed loop and the plant values are compared.
+// arm_pid_q15 truncates its output every step, which drifts the integral by half an LSB per step
+// in open loop and leaves a dead band inversely proportional to ki in closed loop
+static void TestArmPID() {
+    // 参考实现使用Q15能表示的增益 / the reference uses the gains Q15 can represent
+    const q15_t kp = FloatToQ15(0.5f), ki = FloatToQ15(0.05f), kd = FloatToQ15(0.2f);
+    control::PIDController reference(Q15ToFloat(kp), Q15ToFloat(ki), Q15ToFloat(kd));
+    control::PIDControllerQ15 q15(kp, ki, kd);
+    control::PIDControllerQ31 q31((q31_t)kp << 16, (q31_t)ki << 16, (q31_t)kd << 16);
+    float y = 0, y15 = 0, y31 = 0;
+    float q15_error = 0, q31_error = 0;
+    for (int step = 0; step < 4000; ++step) {
+        const float target = step % 1000 < 500 ? 0.3f : -0.2f;
+        const float u = reference.ComputeOutput(target - y);
+        const float u15 = Q15ToFloat(q15.ComputeOutput(FloatToQ15(target - y15)));
+        const float u31 = Q31ToFloat(q31.ComputeOutput(FloatToQ31(target - y31)));
+        y += (u - y) * 0.1f;
+        y15 += (u15 - y15) * 0.1f;
+        y31 += (u31 - y31) * 0.1f;
+        q15_error = fmaxf(q15_error, fabsf(y15 - y));
+        q31_error = fmaxf(q31_error, fabsf(y31 - y));
+    }
+    printf("arm pid: largest error q15 %.1f LSB, q31 %.2e of full scale\n", q15_error * Q15_ONE,
+           q31_error);
+    printf("  settled error q15 %.2f LSB\n", fabsf(y15 - y) * Q15_ONE);
+    // 增量式的输出每步截断，ki * 误差不到1个LSB时积分不再变化，稳态误差最多1 / ki个LSB
+    // the incremental output is truncated every step, the integral stops once ki * error is below
+    // one LSB, leaving up to 1 / ki LSB of steady state error
+    const float dead_band = (float)Q15_ONE / ki;
+    CHECK(q15_error * Q15_ONE < dead_band);
+    CHECK(fabsf(y15 - y) * Q15_ONE < dead_band);
+    CHECK(q31_error < 1e-5f);
+}
+
+// 斜坡和缓动与精确值对比：浮点的步长误差会累积，Q32.32不会
+// ramp and ease against the exact values: float step errors accumulate, Q32.32 ones do not
+static void TestRampEase() {
+    const float step = 0.37f;
+    RampSource ramp(0, -16384, 16384, step);
+    control::FixedRampSource fixed_ramp(0, -16384, 16384, step);
+    Ease ease(0, step);
+    control::FixedEase fixed_ease(0, step);
+    ease.SetTarget(10000);
+    fixed_ease.SetTarget(10000);
+    double exact = 0;
+    float ramp_error = 0, fixed_ramp_error = 0, ease_error = 0, fixed_ease_error = 0;
+    for (int n = 0; n < 40000; ++n) {
+        const int32_t input = n < 30000 ? 1 : -2;
+        exact = fmin(fmax(exact + (double)step * input, -16384), 16384);
+        ramp_error = fmaxf(ramp_error, fabs(ramp.Calc(input) - exact));
+        fixed_ramp_error = fmaxf(fixed_ramp_error, fabs(fixed_ramp.Calc(input) - exact));
+        const double exact_ease = fmin((double)step * (n + 1), 10000);
+        ease_error = fmaxf(ease_error, fabs(ease.Calc() - exact_ease));
+        fixed_ease_error = fmaxf(fixed_ease_error, fabs(fixed_ease.Calc() - exact_ease));
+    }
+    printf("ramp: largest error float %.3f, fixed %.3f\n", ramp_error, fixed_ramp_error);
+    printf("ease: largest error float %.3f, fixed %.3f\n", ease_error, fixed_ease_error);
+    // 定点只有输出取整的误差 / fixed point only has the rounding of the output
+    CHECK(fixed_ramp_error <= 0.5f);
+    CHECK(fixed_ease_error <= 0.5f);
+    CHECK(fabsf(fixed_ramp.Get() - ramp.Get()) <= 0.5f + ramp_error);
+    CHECK(fixed_ease.IsAtTarget() && fixed_ease.GetOutput() == 10000);
+}
+
+// 整数版本的PowerLimit与浮点版本对比 / the integer PowerLimit against the float one
+static void TestPowerLimit() {
+    constexpr int MOTORS = 4;
+    control::PowerLimit limiter(MOTORS);
+    const control::power_limit_t info = {80, 72, 50, 3500.0f * MOTORS, 2000.0f * MOTORS};
+    const control::power_limit_fixed_t fixed_info = control::PowerLimitToFixed(info);
+    CHECK(fixed_info.WARNING_power == 72000 && fixed_info.WARNING_power_buff == 50000);
+    test::Random random(2);
+    float worst = 0;
+    for (int trial = 0; trial < 10000; ++trial) {
+        float input[MOTORS], output[MOTORS];
+        int16_t fixed_input[MOTORS], fixed_output[MOTORS];
+        for (int i = 0; i < MOTORS; ++i) {
+            fixed_input[i] = (int16_t)random.Uniform(-16384, 16384);
+            input[i] = fixed_input[i];
+        }
+        // 整数版本的功率和能量单位为mW和mJ / the integer version takes mW and mJ
+        const int32_t power = (int32_t)random.Uniform(0, 120000);
+        const int32_t buffer = (int32_t)random.Uniform(0, 60000);
+        limiter.Output(true, info, power * 1e-3f, buffer * 1e-3f, input, output);
+        limiter.Output(true, fixed_info, power, buffer, fixed_input, fixed_output);
+        for (int i = 0; i < MOTORS; ++i)
+            worst = fmaxf(worst, fabsf(fixed_output[i] - output[i]));
+    }
+    printf("power limit: largest error %.2f LSB\n", worst);
+    CHECK(worst <= 2.5f);
+}
+
+// FlyWheelMotor的速度环：以原始转速读数为单位、增益按2pi/60缩放的MotorPID（两种选择都测）与原来
+// 以[rad/s]为单位的PIDController对比。不饱和时转速一致；饱和起转时MotorPID有积分限幅，超调不更大
+// the FlyWheelMotor speed loop: MotorPID on raw speed readings with the gains scaled by 2pi/60,
+// for either choice, against the former PIDController on [rad/s]. The speeds agree while not
+// saturated; on a saturated spin-up MotorPID has the integral limit and overshoots no more
+static void TestMotorPID() {
+    // 主机不定义CONTROL_FIXED_POINT / the host does not define CONTROL_FIXED_POINT
+    static_assert(std::is_same<control::MotorPID, ConstrainedPID>::value, "float on the host");
+    constexpr int SMALL = 4000;
+    constexpr int SPIN_UP = 5000;
+    test::Random random(3);
+    std::vector<int32_t> targets;
+    int32_t level = 0;
+    // 目标每500步变化一次，和摩擦轮的使用方式一样 / the target changes every 500 steps, the way
+    // friction wheels are used
+    for (int step = 0; step < SMALL; ++step) {
+        if (step % 500 == 0)
+            level = (int32_t)roundf(random.Uniform(-400, 400));
+        targets.push_back(level);
+    }
+    for (int step = 0; step < 4000; ++step)
+        targets.push_back(SPIN_UP);
+
+    control::PIDController reference(flywheel_pid);
+    const std::vector<float> expected =
+        RunFlywheel(targets, [&reference](int32_t target, int16_t measure) {
+            return reference.ComputeConstrainedOutput(target * RPM_TO_RAD - measure * RPM_TO_RAD);
+        });
+    const std::vector<float> speeds[] = {RunMotorPID<ConstrainedPID>(targets),
+                                         RunMotorPID<FixedPID>(targets)};
+    const char* names[] = {"ConstrainedPID", "FixedPID"};
+
+    const float expected_peak = *std::max_element(expected.begin() + SMALL, expected.end());
+    printf("flywheel: PIDController overshoot %.1f rpm\n", expected_peak - SPIN_UP);
+    for (int i = 0; i < 2; ++i) {
+        float worst = 0;
+        for (int step = 0; step < SMALL; ++step)
+            worst = fmaxf(worst, fabsf(speeds[i][step] - expected[step]));
+        const float peak = *std::max_element(speeds[i].begin() + SMALL, speeds[i].end());
+        const float settled = fabsf(speeds[i].back() - SPIN_UP);
+        printf("  %-16s largest difference %.2f rpm, overshoot %.1f rpm, settled error %.2f rpm\n",
+               names[i], worst, peak - SPIN_UP, settled);
+        CHECK(worst <= 2);
+        CHECK(peak <= expected_peak + 1);
+        CHECK(settled <= 1);
+    }
+}
+
+// Q15/Q31辅助函数的取整和饱和 / rounding and saturation of the Q15/Q31 helpers
+static void TestHelpers() {
+    CHECK(FloatToQ15(0.5f) == 16384);
+    CHECK(FloatToQ15(-1) == INT16_MIN);
+    CHECK(FloatToQ15(1) == INT16_MAX);
+    CHECK(FloatToQ15(100, 16384) == 200);
+    // 2^31不能用float表示，饱和到它下面的float / 2^31 is not a float, it saturates to the float
+    // below it
+    CHECK(FloatToQ31(2) == INT32_MAX - 127);
+    CHECK(FloatToQ31(-2) == INT32_MIN);
+    CHECK_NEAR(Q15ToFloat(FloatToQ15(0.123f, 10), 10), 0.123f, 10.0 / Q15_ONE);
+    CHECK(MulQ15(INT16_MIN, INT16_MIN) == INT16_MAX);
+    CHECK(MulQ15(16384, 16384) == 8192);
+    CHECK(AddQ15(30000, 30000) == INT16_MAX);
+    CHECK(AddQ15(-30000, -30000) == INT16_MIN);
+    CHECK(MulQ31(INT32_MIN, INT32_MIN) == INT32_MAX);
+    CHECK(AddQ31(INT32_MAX, 1) == INT32_MAX);
+    CHECK(AddQ31(INT32_MIN, -1) == INT32_MIN);
+    CHECK(FloatToFixed(1e12f, 16) == INT32_MAX - 127);
+    CHECK(FloatToFixed(-1e12f, 16) == INT32_MIN);
+    printf("helpers: done\n");
+}
+
+// 速度环路径（积分限幅模式）在主机上的耗时。主机有FPU，不能代表没有FPU的M3上的比例
+// host timings of the speed loop path (integral limit mode). The host has an FPU, so the ratio
+// does not carry over to the FPU-less M3
+static void Benchmark() {
+    const test::pid_init_t init = {2500, 3, 0, 16384, 10000, 0, 0, 0, 0, 0, IL};
+    ConstrainedPID reference(init);
+    FixedPID pid(init);
+    const long calls = 2000000;
+    int32_t sum = 0;
+    printf("benchmark:\n");
+    test::Stopwatch stopwatch;
+    for (long i = 0; i < calls; ++i)
+        sum += (int32_t)reference.ComputeOutput(100, (float)(i & 127));
+    test::Report("ConstrainedPID", stopwatch, calls);
+    stopwatch.Restart();
+    for (long i = 0; i < calls; ++i)
+        sum += pid.ComputeOutput(100, (int32_t)(i & 127));
+    test::Report("FixedPID", stopwatch, calls);
+    test::Consume(sum);
+}
+
+int main() {
+    TestPID();
+    TestArmPID();
+    TestRampEase();
+    TestPowerLimit();
+    TestMotorPID();
+    TestHelpers();
+    Benchmark();
+    return test::Finish();
+}
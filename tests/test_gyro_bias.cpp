@@ -0,0 +1,319 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// 陀螺仪零漂在线估计的测试：静止启动时的就绪时间和带先验时的就绪时间，混合运动和零漂缓慢变化时
+// 零漂的误差与原来开机静止平均2000个样本的比较，运动不被误判为静止，缓慢匀速转动不被吸收进零漂，
+// 以及AHRS和QEKF从第一个样本开始解算并补偿零漂
+// tests of the online gyro bias estimator: time to ready when booting still and with a prior, the
+// bias error under mixed motion and slow drift compared to the old 2000 sample average at boot,
+// motion not mistaken for stillness, a slow steady rotation not absorbed into the bias, and AHRS
+// and QEKF fusing from the first sample while compensating the bias
+
+#include <math.h>
+
+#include <initializer_list>
+
+#include "AHRS.h"
+#include "QEKF.h"
+#include "gyro_bias.h"
+#include "test.h"
+
+using control::GyroBiasEstimator;
+
+namespace {
+
+    constexpr float DT = 0.001f;
+    constexpr int OLD_SAMPLES = 2000;  // 原来开机时平均的样本数 / samples the old code averaged
+
+    enum motion_t {
+        STILL = 0,
+        GIMBAL,     // 云台的转动 / gimbal motion
+        VIBRATION,  // 底盘行驶的振动 / chassis vibration while driving
+        SLOW_SPIN,  // 0.05rad/s的匀速转动 / steady 0.05 rad/s rotation
+    };
+
+    struct segment_t {
+        double end;  // [s]
+        motion_t motion;
+    };
+
+    // 开机静止2秒后混合各种运动，中间有两段短暂的静止
+    // two seconds still at boot, then mixed motion with two short still periods
+    constexpr segment_t PROFILE[] = {
+        {2, STILL},  {30, GIMBAL},     {35, STILL},  {60, VIBRATION},
+        {62, STILL}, {90, GIMBAL},     {100, SLOW_SPIN}, {120, GIMBAL},
+    };
+
+    // 合成的IMU数据，零漂从(12, -8, 5)mrad/s开始按drift倍的(4, -2, 3)mrad/s每120秒线性变化
+    // synthetic IMU data, the bias starts at (12, -8, 5) mrad/s and changes linearly by drift
+    // times (4, -2, 3) mrad/s every 120 s
+    class IMU {
+      public:
+        IMU(double drift, uint32_t seed) : drift_(drift), random_(seed) {
+        }
+
+        void Sample(double t, motion_t motion, float gyro[3], float accel[3], double bias[3]) {
+            bias[0] = 0.012 + drift_ * 0.004 * t / 120;
+            bias[1] = -0.008 - drift_ * 0.002 * t / 120;
+            bias[2] = 0.005 + drift_ * 0.003 * t / 120;
+            double rate[3] = {0, 0, 0};
+            float accel_noise = 0.03f, gyro_noise = 0.005f;
+            if (motion == GIMBAL) {
+                rate[1] = 0.6 * sin(2.1 * t);
+                rate[2] = 1.0 * sin(0.9 * t);
+            } else if (motion == VIBRATION) {
+                accel_noise = 1.0f;
+                gyro_noise = 0.05f;
+                rate[2] = 0.2 * sin(0.5 * t);
+            } else if (motion == SLOW_SPIN) {
+                rate[2] = 0.05;
+            }
+            for (int i = 0; i < 3; ++i) {
+                gyro[i] = (float)(rate[i] + bias[i]) + random_.Normal(gyro_noise);
+                accel[i] = (i == 2 ? 9.8f : 0) + random_.Normal(accel_noise);
+            }
+        }
+
+      private:
+        double drift_;
+        test::Random random_;
+    };
+
+    double Distance(const float estimate[3], const double truth[3]) {
+        double sum = 0;
+        for (int i = 0; i < 3; ++i)
+            sum += (estimate[i] - truth[i]) * (estimate[i] - truth[i]);
+        return sqrt(sum);
+    }
+
+    // 静止时直到置信度达到1的时间 [s] / time [s] until the confidence reaches 1 while still
+    double TimeToReady(GyroBiasEstimator* estimator, double* error) {
+        IMU imu(0, 2);
+        for (int k = 0; k < 10000; ++k) {
+            float gyro[3], accel[3], bias[3];
+            double truth[3];
+            imu.Sample(k * DT, STILL, gyro, accel, truth);
+            estimator->Update(gyro, accel, DT);
+            if (estimator->GetConfidence() >= 1) {
+                estimator->GetBias(bias);
+                *error = Distance(bias, truth);
+                return (k + 1) * DT;
+            }
+        }
+        return INFINITY;
+    }
+
+    struct profile_result_t {
+        double new_rms;      // 3秒之后零漂误差的均方根 / rms bias error after 3 s [rad/s]
+        double old_rms;      // 开机平均的误差 / the same for the boot average [rad/s]
+        double still_found;  // 检测到的静止时间 [s] / stillness detected [s]
+        double false_still;  // 运动时误判为静止的时间 [s] / motion taken as still [s]
+        double motion;       // 运动的总时间 [s] / total time in motion [s]
+    };
+
+    profile_result_t RunProfile(double drift) {
+        GyroBiasEstimator estimator;
+        IMU imu(drift, 3);
+        double old_bias[3] = {0, 0, 0};
+        double new_sum = 0, old_sum = 0;
+        profile_result_t result = {};
+        int samples = 0, segment = 0;
+        const int steps = (int)lround(PROFILE[sizeof(PROFILE) / sizeof(PROFILE[0]) - 1].end / DT);
+        for (int k = 0; k < steps; ++k) {
+            const double t = k * DT;
+            while (t >= PROFILE[segment].end)
+                ++segment;
+            const motion_t motion = PROFILE[segment].motion;
+            float gyro[3], accel[3], bias[3];
+            double truth[3];
+            imu.Sample(t, motion, gyro, accel, truth);
+            estimator.Update(gyro, accel, DT);
+            if (k < OLD_SAMPLES)
+                for (int i = 0; i < 3; ++i)
+                    old_bias[i] += gyro[i] / OLD_SAMPLES;
+
+            if (motion == STILL && estimator.IsStationary())
+                result.still_found += DT;
+            if (motion != STILL) {
+                result.motion += DT;
+                if (estimator.IsStationary())
+                    result.false_still += DT;
+            }
+            if (t > 3) {
+                estimator.GetBias(bias);
+                const float old[3] = {(float)old_bias[0], (float)old_bias[1], (float)old_bias[2]};
+                new_sum += pow(Distance(bias, truth), 2);
+                old_sum += pow(Distance(old, truth), 2);
+                ++samples;
+            }
+        }
+        result.new_rms = sqrt(new_sum / samples);
+        result.old_rms = sqrt(old_sum / samples);
+        return result;
+    }
+
+}  // namespace
+
+// 静止开机时不到1.5秒就绪，原来要阻塞2秒；有0.8置信度的先验时不到1秒
+// booting still it is ready in less than 1.5 s where the old code blocked for 2 s, and in less
+// than a second with a prior of confidence 0.8
+static void TestReady() {
+    GyroBiasEstimator cold;
+    double cold_error;
+    const double cold_time = TimeToReady(&cold, &cold_error);
+    GyroBiasEstimator warm;
+    const float prior[3] = {0.011f, -0.007f, 0.006f};
+    warm.SetPrior(prior, 0.8f);
+    CHECK_NEAR(warm.GetConfidence(), 0.8f, 1e-6f);
+    double warm_error;
+    const double warm_time = TimeToReady(&warm, &warm_error);
+    printf("ready: %.3f s, bias error %.2e rad/s; with a prior %.3f s, bias error %.2e rad/s\n",
+           cold_time, cold_error, warm_time, warm_error);
+    CHECK(cold_time < 1.5);
+    CHECK(warm_time < 1);
+    CHECK(cold_error < 1e-3);
+    CHECK(warm_error < 2e-3);
+
+    // Reset清空置信度，保留零漂 / Reset clears the confidence and keeps the bias
+    float before[3], after[3];
+    cold.GetBias(before);
+    cold.Reset();
+    cold.GetBias(after);
+    CHECK(cold.GetConfidence() == 0);
+    CHECK(!cold.IsStationary());
+    for (int i = 0; i < 3; ++i)
+        CHECK(before[i] == after[i]);
+}
+
+// 两分钟的混合运动：零漂不变和缓慢变化时误差都比开机平均小，运动几乎不被误判为静止，包括10秒
+// 0.05rad/s的匀速转动
+// two minutes of mixed motion: with a constant and a drifting bias the error is below the boot
+// average, and motion is almost never taken as stillness, including 10 s of a steady 0.05 rad/s
+// rotation
+static void TestProfile() {
+    printf("profile, rms bias error after 3 s [rad/s]:\n");
+    for (double drift : {0.0, 1.0}) {
+        const profile_result_t result = RunProfile(drift);
+        printf("  drift %.0f: new %.2e, boot average %.2e, still found %.2f s of 9 s, "
+               "%.3f s of %.0f s motion taken as still\n",
+               drift, result.new_rms, result.old_rms, result.still_found, result.false_still,
+               result.motion);
+        CHECK(result.new_rms < result.old_rms);
+        CHECK(result.still_found > 4);
+        CHECK(result.false_still < 0.01);
+        if (drift == 0)
+            CHECK(result.new_rms < 3e-4);
+        else
+            CHECK(result.new_rms < 0.75 * result.old_rms);
+    }
+}
+
+// 置信度为1之后，比gyro_noise快的缓慢匀速转动不被当作零漂，判定为运动之前的样本也不进入零漂。
+// 运动时置信度逐渐衰减，允许的偏差随之放宽，所以只看5秒
+// once confident, a steady rotation faster than gyro_noise is not taken as bias, and neither are
+// the samples before the motion is detected. The confidence decays while moving and the allowed
+// deviation widens with it, so only 5 s are checked
+static void TestSlowSpin() {
+    GyroBiasEstimator estimator;
+    double error;
+    TimeToReady(&estimator, &error);
+    float before[3];
+    estimator.GetBias(before);
+    IMU imu(0, 4);
+    int stationary = 0;
+    for (int k = 0; k < 5000; ++k) {
+        float gyro[3], accel[3];
+        double truth[3];
+        imu.Sample(k * DT, STILL, gyro, accel, truth);
+        gyro[2] += 0.03f;
+        estimator.Update(gyro, accel, DT);
+        stationary += estimator.IsStationary();
+    }
+    float bias[3];
+    estimator.GetBias(bias);
+    printf("slow spin: %d ms taken as still, z bias %.5f rad/s before, %.5f rad/s after\n",
+           stationary, before[2], bias[2]);
+    CHECK(stationary < 300);
+    CHECK_NEAR(bias[2], before[2], 2e-4f);
+}
+
+// AHRS和QEKF从第一个样本开始解算，零漂估计好之后yaw不再漂移
+// AHRS and QEKF fuse from the first sample, and yaw stops drifting once the bias is known
+static void TestFusion() {
+    control::AHRS ahrs(false);
+    control::QEKF qekf(nullptr);
+    ahrs.Cailbrate();
+    qekf.Cailbrate();
+    test::Random random(5);
+    double ahrs_ready = -1, qekf_ready = -1;
+    for (int k = 0; k < 20000; ++k) {
+        float gyro[3], accel[3];
+        for (int i = 0; i < 3; ++i) {
+            gyro[i] = 0.01f * (i + 1) + random.Normal(0.005f);
+            accel[i] = (i == 2 ? 9.8f : 0) + random.Normal(0.03f);
+        }
+        ahrs.Update(gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2], DT);
+        qekf.Update(gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2], DT);
+        if (ahrs_ready < 0 && ahrs.IsCailbrated())
+            ahrs_ready = (k + 1) * DT;
+        if (qekf_ready < 0 && qekf.IsCailbrated())
+            qekf_ready = (k + 1) * DT;
+    }
+    float bias[3];
+    qekf.GetGyroBias(bias);
+    printf("fusion: ready ahrs %.3f s, qekf %.3f s; yaw after 20 s with a 30 mrad/s bias ahrs "
+           "%.4f, qekf %.4f rad\n",
+           ahrs_ready, qekf_ready, ahrs.INS_angle[0], qekf.INS_angle[0]);
+    CHECK(ahrs_ready > 0 && ahrs_ready < 1.5);
+    CHECK(qekf_ready > 0 && qekf_ready < 1.5);
+    // 不补偿时yaw漂移0.6rad / uncompensated yaw would drift 0.6 rad
+    CHECK(fabsf(ahrs.INS_angle[0]) < 0.03f);
+    CHECK(fabsf(qekf.INS_angle[0]) < 0.03f);
+    for (int i = 0; i < 3; ++i)
+        CHECK_NEAR(bias[i], 0.01f * (i + 1), 1e-3f);
+}
+
+static void Benchmark() {
+    const int N = 2000000;
+    IMU imu(0, 6);
+    static float gyro[N / 1000][3], accel[N / 1000][3];
+    for (int k = 0; k < N / 1000; ++k) {
+        double truth[3];
+        imu.Sample(k * DT, STILL, gyro[k], accel[k], truth);
+    }
+    printf("benchmark:\n");
+    GyroBiasEstimator estimator;
+    test::Stopwatch stopwatch;
+    for (int k = 0; k < N; ++k)
+        estimator.Update(gyro[k % (N / 1000)], accel[k % (N / 1000)], DT);
+    test::Report("GyroBiasEstimator::Update", stopwatch, N);
+    float bias[3];
+    estimator.GetBias(bias);
+    test::Consume(bias[0]);
+}
+
+int main() {
+    TestReady();
+    TestProfile();
+    TestSlowSpin();
+    TestFusion();
+    Benchmark();
+    return test::Finish();
+}
@@ -0,0 +1,241 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// 加热前馈和陀螺仪温漂模型的仿真：两节点的热模型，BMI088温度寄存器的分辨率和更新周期，陀螺仪
+// z轴零漂为芯片温度的二次函数。对比bsp::Heater只用PID和加上前馈的升温过程，以及开机就运动时
+// 有无温漂模型的yaw漂移，另外检查拟合和每次调用的耗时
+// simulation of the heater feedforward and the gyro temperature model: a two node thermal
+// plant, the resolution and update period of the BMI088 temperature register, and a gyro z bias
+// quadratic in the die temperature. The warmup of bsp::Heater with PID only and with
+// feedforward is compared, as is the yaw drift of a robot moving from boot with and without the
+// temperature model, plus checks of the fit and the cost of the calls
+
+#include <math.h>
+
+#include "bsp_heater.h"
+#include "gyro_temp.h"
+#include "test.h"
+
+using control::GyroTempModel;
+using control::gyro_temp_model_t;
+
+namespace {
+
+    constexpr double CONTROL_DT = 0.001;
+    constexpr double DURATION = 180.0;
+    constexpr double RIPPLE_WINDOW = 60.0;
+    constexpr float SETPOINT = 45.0f;
+    constexpr double AMBIENT = 25.0;
+
+    // 热模型 / thermal plant
+    constexpr double MAX_OUT = 500.0;     // 加热PWM输出上限 / heater pwm output limit
+    constexpr double HEATER_RISE = 40.0;  // 满输出时的稳态温升 / steady rise at full output [°C]
+    constexpr double BOARD_TAU = 60.0;    // [s]
+    constexpr double CHIP_TAU = 5.0;      // [s]
+
+    // 传感器 / sensor
+    constexpr double TEMP_RES = 0.125;    // [°C]
+    constexpr double TEMP_PERIOD = 1.28;  // [s]
+    constexpr float GYRO_NOISE = 0.003f;  // 每个样本 / rms per sample [rad/s]
+    // z轴零漂为c0 + c1 (T - 25) + c2 (T - 25)^2 / z bias [rad/s]
+    constexpr double BIAS[3] = {0.002, 1.5e-4, -4e-6};
+
+    double GyroBias(double temp) {
+        const double t = temp - 25.0;
+        return BIAS[0] + (BIAS[1] + BIAS[2] * t) * t;
+    }
+
+    typedef struct {
+        double reached;    // 第一次进入目标±0.5°C的时间 / first time within 0.5 °C [s]
+        double overshoot;  // [°C]
+        double ripple;     // 最后RIPPLE_WINDOW秒的峰峰值 / peak to peak over the end [°C]
+        double drift_boot;
+        double drift_model;
+    } warmup_t;
+
+    // 一次升温，learn不为空时记录静止的样本，model不为空时计算补偿后的yaw漂移
+    // one warmup, recording stationary samples into learn and integrating the compensated yaw
+    // drift with model when given
+    warmup_t Warmup(bool feedforward, uint32_t seed, const GyroTempModel* model,
+                    GyroTempModel* learn) {
+        test::Random random(seed);
+        TIM_HandleTypeDef htim = {0};
+        bsp::Heater heater(&htim, 1, 1000000, SETPOINT);
+        if (feedforward)
+            heater.SetFeedforward(HEATER_RISE / MAX_OUT);
+        double board = AMBIENT, chip = AMBIENT;
+        float reading = round(chip / TEMP_RES) * TEMP_RES;
+        double next_read = TEMP_PERIOD;
+        warmup_t result = {-1, 0, 0, 0, 0};
+        double low = INFINITY, high = -INFINITY;
+        // 开始运动前在线估计收敛到的零漂 / what the online estimator converged to before moving
+        const double boot_bias = GyroBias(chip);
+        float bias[3] = {0, 0, 0};
+        if (model != nullptr)
+            model->Evaluate(reading, bias);
+        const double residual = boot_bias - bias[2];
+
+        const int steps = DURATION / CONTROL_DT;
+        for (int k = 0; k < steps; ++k) {
+            const double t = k * CONTROL_DT;
+            if (t >= next_read) {
+                reading = round(chip / TEMP_RES) * TEMP_RES;
+                next_read += TEMP_PERIOD;
+            }
+            const float output = heater.Update(reading);
+            board += CONTROL_DT / BOARD_TAU * (AMBIENT + HEATER_RISE * output / MAX_OUT - board);
+            chip += CONTROL_DT / CHIP_TAU * (board - chip);
+
+            const float gyro[3] = {0, 0, (float)GyroBias(chip) + random.Normal(GYRO_NOISE)};
+            if (learn != nullptr)
+                learn->AddSample(reading, gyro, CONTROL_DT);
+            result.drift_boot += (gyro[2] - boot_bias) * CONTROL_DT;
+            if (model != nullptr) {
+                model->Evaluate(reading, bias);
+                result.drift_model += (gyro[2] - bias[2] - residual) * CONTROL_DT;
+            }
+
+            if (result.reached < 0 && fabs(chip - SETPOINT) <= 0.5)
+                result.reached = t;
+            result.overshoot = fmax(result.overshoot, chip - SETPOINT);
+            if (t >= DURATION - RIPPLE_WINDOW) {
+                low = fmin(low, chip);
+                high = fmax(high, chip);
+            }
+        }
+        result.ripple = high - low;
+        return result;
+    }
+
+}  // namespace
+
+// 升温受输出上限限制，两种方式到达目标的时间相同，前馈减小了稳定后的波动
+// the warmup is output limited so both reach the setpoint at the same time, the feedforward
+// reduces the ripple once warm
+static void TestHeater() {
+    printf("ambient %.1f degC, setpoint %.1f degC\n", AMBIENT, SETPOINT);
+    printf("%-12s %12s %14s %14s\n", "heater", "reach [s]", "overshoot [C]", "ripple [C]");
+    const warmup_t pid = Warmup(false, 1, nullptr, nullptr);
+    const warmup_t feedforward = Warmup(true, 1, nullptr, nullptr);
+    printf("%-12s %12.1f %14.2f %14.2f\n", "pid", pid.reached, pid.overshoot, pid.ripple);
+    printf("%-12s %12.1f %14.2f %14.2f\n", "feedforward", feedforward.reached,
+           feedforward.overshoot, feedforward.ripple);
+    CHECK(pid.reached > 0 && pid.reached < 60);
+    CHECK(feedforward.reached > 0 && feedforward.reached < pid.reached + 1);
+    CHECK(feedforward.overshoot < 1.5);
+    CHECK(feedforward.ripple < 0.8 * pid.ripple);
+}
+
+// 静止升温时学到的模型用于下一次开机，开机就运动时的yaw漂移降到十分之一以下
+// a model learned on a stationary warmup is used at the next boot, and the yaw drift of a robot
+// moving from boot drops below a tenth
+static void TestDrift() {
+    GyroTempModel learner(SETPOINT);
+    Warmup(true, 2, nullptr, &learner);
+    gyro_temp_model_t fitted;
+    CHECK(learner.Fit(&fitted));
+    GyroTempModel model(SETPOINT);
+    model.SetModel(fitted);
+    CHECK(model.IsValid());
+    const warmup_t warmup = Warmup(true, 3, &model, nullptr);
+    const double to_degrees = 180 / M_PI;
+    printf("yaw drift over %.0f s: boot bias %.1f deg, model %.1f deg\n", DURATION,
+           warmup.drift_boot * to_degrees, warmup.drift_model * to_degrees);
+    CHECK(fabs(warmup.drift_boot) * to_degrees > 5);
+    CHECK(fabs(warmup.drift_model) < 0.1 * fabs(warmup.drift_boot));
+}
+
+// 无噪声的样本拟合出原来的系数，范围外按端点计算，温度范围不足时拒绝拟合
+// noise free samples fit back the coefficients, temperatures outside the range use the end
+// points, and a too narrow temperature span is refused
+static void TestFit() {
+    GyroTempModel model(SETPOINT);
+    gyro_temp_model_t fitted;
+    for (double temp = 30; temp < 33; temp += 0.001) {
+        const float gyro[3] = {0.01f, -0.02f, (float)GyroBias(temp)};
+        model.AddSample(temp, gyro, 0.001f);
+    }
+    CHECK(!model.Fit(&fitted));
+    for (double temp = 33; temp < 50; temp += 0.001) {
+        const float gyro[3] = {0.01f, -0.02f, (float)GyroBias(temp)};
+        model.AddSample(temp, gyro, 0.001f);
+    }
+    CHECK(model.Fit(&fitted));
+    CHECK_NEAR(fitted.min_temp, 30, 0.1);
+    CHECK_NEAR(fitted.max_temp, 50, 0.1);
+    float bias[3];
+    GyroTempModel loaded(SETPOINT);
+    loaded.Evaluate(40, bias);
+    CHECK(bias[0] == 0 && bias[1] == 0 && bias[2] == 0);
+    loaded.SetModel(fitted);
+    double max_error = 0;
+    for (float temp = 30; temp <= 50; temp += 0.5f) {
+        loaded.Evaluate(temp, bias);
+        max_error = fmax(max_error, fabs(bias[2] - GyroBias(temp)));
+        max_error = fmax(max_error, fabs(bias[0] - 0.01) + fabs(bias[1] + 0.02));
+    }
+    printf("fit of noise free samples: max error %.2g rad/s\n", max_error);
+    CHECK(max_error < 2e-5);
+    float end[3];
+    loaded.Evaluate(50, end);
+    loaded.Evaluate(70, bias);
+    CHECK(bias[2] == end[2]);
+    model.ClearSamples();
+    CHECK(!model.Fit(&fitted));
+}
+
+static void Benchmark() {
+    GyroTempModel model(SETPOINT);
+    gyro_temp_model_t fitted = {SETPOINT, 30, 50, {{0.001f, 1e-4f, 1e-6f}}};
+    model.SetModel(fitted);
+    test::Random random(4);
+    const int N = 1 << 16;
+    float sum = 0;
+    printf("benchmark:\n");
+    test::Stopwatch stopwatch;
+    for (int i = 0; i < N; ++i) {
+        float bias[3];
+        model.Evaluate(random.Uniform(25, 55), bias);
+        sum += bias[0] + bias[1] + bias[2];
+    }
+    test::Report("Evaluate", stopwatch, N);
+    stopwatch.Restart();
+    for (int i = 0; i < N; ++i) {
+        const float gyro[3] = {0.001f, 0.002f, 0.003f};
+        model.AddSample(random.Uniform(25, 55), gyro, 0.001f);
+    }
+    test::Report("AddSample", stopwatch, N);
+    TIM_HandleTypeDef htim = {0};
+    bsp::Heater heater(&htim, 1, 1000000, SETPOINT);
+    heater.SetFeedforward(HEATER_RISE / MAX_OUT);
+    stopwatch.Restart();
+    for (int i = 0; i < N; ++i)
+        sum += heater.Update(random.Uniform(40, 46));
+    test::Report("Heater::Update", stopwatch, N);
+    test::Consume(sum);
+}
+
+int main() {
+    TestHeater();
+    TestDrift();
+    TestFit();
+    Benchmark();
+    return test::Finish();
+}
@@ -0,0 +1,340 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// Kinematics的测试：麦克纳姆、全向X、三轮全向、舵轮和差速底盘上逆运动学后正运动学还原底盘
+// 速度，轮速与轮子接地点的速度一致，麦克纳姆轮与Chassis原来的四轮公式相同，限幅保持运动方向，
+// 舵轮每次最多转90°，以及每个控制周期的耗时
+// tests of Kinematics: on mecanum, omni X, three wheel omni, swerve and differential chassis the
+// forward kinematics recovers the chassis velocity after the inverse, the wheel speeds match the
+// velocity of their contact points, mecanum wheels match the old four wheel formulas of Chassis,
+// desaturation keeps the direction of motion, swerve modules never steer more than 90° at once,
+// and the cost per control period
+
+#include <math.h>
+
+#include <initializer_list>
+
+#include "arm_math.h"
+#include "kinematics.h"
+#include "test.h"
+
+using control::Kinematics;
+using control::wheel_geometry_t;
+
+namespace {
+
+    constexpr float RADIUS = 0.076f;     // [m]
+    constexpr float HALF_TRACK = 0.2f;   // [m]
+    constexpr float HALF_BASE = 0.2f;    // [m]
+    constexpr float MAX_SPEED = 1000.0f;  // [rad/s]，往返测试中不限幅 / no limit in round trips
+    // 舵轮速度低于最大轮速的该比例时保持角度，与kinematics.cpp相同
+    // swerve modules below this fraction of the maximum speed hold their angle, as in
+    // kinematics.cpp
+    constexpr double MODULE_HOLD_RATIO = 1e-3;
+
+    const wheel_geometry_t MECANUM[4] = {
+        {control::WHEEL_MECANUM, -HALF_TRACK, HALF_BASE, PI / 2, -PI / 4, RADIUS},
+        {control::WHEEL_MECANUM, HALF_TRACK, HALF_BASE, -PI / 2, PI / 4, RADIUS},
+        {control::WHEEL_MECANUM, -HALF_TRACK, -HALF_BASE, PI / 2, PI / 4, RADIUS},
+        {control::WHEEL_MECANUM, HALF_TRACK, -HALF_BASE, -PI / 2, -PI / 4, RADIUS},
+    };
+    const wheel_geometry_t OMNI_X[4] = {
+        {control::WHEEL_OMNI, -HALF_TRACK, HALF_BASE, PI / 4, 0, RADIUS},
+        {control::WHEEL_OMNI, HALF_TRACK, HALF_BASE, -PI / 4, 0, RADIUS},
+        {control::WHEEL_OMNI, -HALF_TRACK, -HALF_BASE, 3 * PI / 4, 0, RADIUS},
+        {control::WHEEL_OMNI, HALF_TRACK, -HALF_BASE, -3 * PI / 4, 0, RADIUS},
+    };
+    const wheel_geometry_t SWERVE[4] = {
+        {control::WHEEL_SWERVE, -HALF_TRACK, HALF_BASE, PI / 2, 0, RADIUS},
+        {control::WHEEL_SWERVE, HALF_TRACK, HALF_BASE, PI / 2, 0, RADIUS},
+        {control::WHEEL_SWERVE, -HALF_TRACK, -HALF_BASE, PI / 2, 0, RADIUS},
+        {control::WHEEL_SWERVE, HALF_TRACK, -HALF_BASE, PI / 2, 0, RADIUS},
+    };
+    const wheel_geometry_t DIFFERENTIAL[2] = {
+        {control::WHEEL_DIFFERENTIAL, -HALF_TRACK, 0, PI / 2, 0, RADIUS},
+        {control::WHEEL_DIFFERENTIAL, HALF_TRACK, 0, -PI / 2, 0, RADIUS},
+    };
+
+    // 三个全向轮相隔120°，驱动方向沿切向 / three omni wheels 120° apart, driving tangentially
+    struct OmniThree {
+        wheel_geometry_t wheels[3];
+
+        OmniThree() {
+            for (int i = 0; i < 3; ++i) {
+                const float a = PI / 2 + i * 2 * PI / 3;
+                wheels[i] = {control::WHEEL_OMNI, 0.2f * cosf(a), 0.2f * sinf(a), a + PI / 2, 0,
+                             RADIUS};
+            }
+        }
+    };
+    const OmniThree OMNI_THREE;
+
+    struct Layout {
+        const char* name;
+        const wheel_geometry_t* wheels;
+        int wheel_num;
+    };
+    const Layout LAYOUTS[] = {
+        {"mecanum", MECANUM, 4},
+        {"omni X", OMNI_X, 4},
+        {"three wheel omni", OMNI_THREE.wheels, 3},
+        {"swerve", SWERVE, 4},
+        {"differential", DIFFERENTIAL, 2},
+    };
+
+    bool IsHeld(const wheel_geometry_t& wheel, float vx, float vy, float wz, float max_speed) {
+        const double px = vx - (double)wz * wheel.y;
+        const double py = vy + (double)wz * wheel.x;
+        return wheel.type == control::WHEEL_SWERVE &&
+               hypot(px, py) / wheel.radius < MODULE_HOLD_RATIO * max_speed;
+    }
+
+    bool IsDifferential(const Layout& layout) {
+        return layout.wheels[0].type == control::WHEEL_DIFFERENTIAL;
+    }
+
+    // 由接地点的速度直接计算轮子应有的角速度：轮子表面沿驱动方向运动，辊子轴线方向不能打滑；
+    // 舵轮的轮子整体转到接地点速度的方向，速度过低时保持角度，轮速为接地点速度在该方向的投影
+    // the wheel speed straight from the velocity of the contact point: the wheel surface moves
+    // along the heading and cannot slip along the roller axis; a swerve module turns the whole
+    // wheel towards the contact point velocity, or at very low speeds holds its angle and drives
+    // the projection of the contact point velocity on it
+    double ContactError(const wheel_geometry_t& wheel, float vx, float vy, float wz, float speed,
+                        float angle, float max_speed) {
+        const double px = vx - (double)wz * wheel.y;
+        const double py = vy + (double)wz * wheel.x;
+        if (wheel.type == control::WHEEL_SWERVE) {
+            const double heading = wheel.heading + angle;
+            if (IsHeld(wheel, vx, vy, wz, max_speed))
+                return fabs(speed * wheel.radius - px * cos(heading) - py * sin(heading));
+            return hypot(speed * wheel.radius * cos(heading) - px,
+                         speed * wheel.radius * sin(heading) - py);
+        }
+        const double roller = wheel.type == control::WHEEL_MECANUM ? wheel.roller : 0;
+        const double axis = wheel.heading + roller;
+        const double along_axis = px * cos(axis) + py * sin(axis);
+        return fabs(speed * wheel.radius * cos(roller) - along_axis);
+    }
+
+    // 改为运动学模型之前Chassis::SetSpeed()的麦克纳姆轮和全向轮公式，turn_speed顺时针为正
+    // the mecanum and omni formulas of Chassis::SetSpeed() before the kinematics model, with
+    // turn_speed clockwise positive
+    void LegacySetSpeed(float x_speed, float y_speed, float turn_speed, float chassis_offset,
+                        float max_motor_speed, float speeds[4]) {
+        const float move_sum = fabs(x_speed) + fabs(y_speed) + fabs(turn_speed);
+        const float scale = move_sum > max_motor_speed ? max_motor_speed / move_sum : 1.0f;
+        speeds[0] = scale * (y_speed + x_speed + turn_speed * (1 - chassis_offset));
+        speeds[1] = -scale * (y_speed - x_speed - turn_speed * (1 - chassis_offset));
+        speeds[2] = scale * (y_speed - x_speed + turn_speed * (1 + chassis_offset));
+        speeds[3] = -scale * (y_speed + x_speed - turn_speed * (1 + chassis_offset));
+    }
+
+}  // namespace
+
+// 逆运动学后正运动学还原底盘速度（有舵轮保持角度时除外），每个轮子的速度与接地点的速度一致；
+// 差速底盘不能横移
+// the forward kinematics recovers the chassis velocity after the inverse (unless a swerve module
+// holds its angle), every wheel agrees with the velocity of its contact point; a differential
+// chassis cannot move sideways
+static void TestRoundTrip() {
+    for (const Layout& layout : LAYOUTS) {
+        Kinematics kinematics(layout.wheels, layout.wheel_num, MAX_SPEED);
+        test::Random random(1);
+        double round_trip = 0, contact = 0;
+        int held = 0;
+        for (int i = 0; i < 100000; ++i) {
+            const float vx = IsDifferential(layout) ? 0 : random.Uniform(-3, 3);
+            const float vy = random.Uniform(-3, 3);
+            const float wz = random.Uniform(-6, 6);
+            float speed[MAX_WHEEL_NUM], angle[MAX_WHEEL_NUM], fx, fy, fw;
+            CHECK(kinematics.Inverse(vx, vy, wz, speed, angle) == 1);
+            kinematics.Forward(speed, angle, &fx, &fy, &fw);
+            bool any_held = false;
+            for (int w = 0; w < layout.wheel_num; ++w) {
+                any_held |= IsHeld(layout.wheels[w], vx, vy, wz, MAX_SPEED);
+                contact = fmax(contact, ContactError(layout.wheels[w], vx, vy, wz, speed[w],
+                                                     angle[w], MAX_SPEED));
+                CHECK_NEAR(kinematics.Project(w, vx, vy, wz), speed[w], 1e-3);
+            }
+            if (any_held)
+                ++held;
+            else
+                round_trip =
+                    fmax(round_trip, fmax(fabs(fx - vx), fmax(fabs(fy - vy), fabs(fw - wz))));
+        }
+        printf("%s: round trip max error %.3g, contact point max error %.3g m/s, %d held\n",
+               layout.name, round_trip, contact, held);
+        CHECK(round_trip < 2e-5);
+        // 舵轮的角度来自fast_atan2f，2e-6 rad的误差乘以最高约6 m/s的速度
+        // swerve angles come from fast_atan2f, its 2e-6 rad error times speeds up to about 6 m/s
+        CHECK(contact < (layout.wheels[0].type == control::WHEEL_SWERVE ? 2e-5 : 2e-6));
+    }
+
+    // 差速底盘的横向速度不可观，估计为0 / the lateral velocity of a differential chassis is not
+    // observable and estimated as 0
+    Kinematics differential(DIFFERENTIAL, 2, MAX_SPEED);
+    const float speed[2] = {3, -3};
+    float vx, vy, wz;
+    differential.Forward(speed, nullptr, &vx, &vy, &wz);
+    CHECK(vx == 0);
+    CHECK_NEAR(vy, 3 * RADIUS, 1e-6);
+    CHECK_NEAR(wz, 0, 1e-6);
+}
+
+// 麦克纳姆轮与原来的公式相同：平移时原来的输出乘以半径，旋转时原来的turn_speed对应顺时针的
+// 角速度乘以轮子到中心的x、y距离之和；chassis_offset相当于把旋转中心前后移动
+// mecanum wheels match the old formulas: when translating the old output is the new one times
+// the radius, for turning the old turn_speed is the clockwise angular velocity times the x plus y
+// distance of the wheels to the center; chassis_offset moves the center of rotation along y
+static void TestLegacy() {
+    test::Random random(2);
+    double max_error = 0;
+    for (float offset : {0.0f, 0.1f, -0.25f}) {
+        const float shift = offset * (HALF_TRACK + HALF_BASE);
+        wheel_geometry_t wheels[4];
+        for (int w = 0; w < 4; ++w) {
+            wheels[w] = MECANUM[w];
+            wheels[w].y -= shift;
+        }
+        Kinematics kinematics(wheels, 4, MAX_SPEED);
+        for (int i = 0; i < 10000; ++i) {
+            const float x_speed = random.Uniform(-3, 3);
+            const float y_speed = random.Uniform(-3, 3);
+            const float turn_speed = random.Uniform(-3, 3);
+            float legacy[4], speed[4];
+            LegacySetSpeed(x_speed, y_speed, turn_speed, offset, 1e6f, legacy);
+            kinematics.Inverse(x_speed, y_speed, -turn_speed / (HALF_TRACK + HALF_BASE), speed);
+            for (int w = 0; w < 4; ++w)
+                max_error = fmax(max_error, fabs(speed[w] * RADIUS - legacy[w]));
+        }
+    }
+    printf("legacy: max error %.3g\n", max_error);
+    CHECK(max_error < 1e-5);
+}
+
+// 超过最大轮速时统一缩放：最快的轮子正好达到上限，正运动学给出同方向、按比例缩小的速度
+// over the maximum wheel speed everything is scaled: the fastest wheel is right at the limit and
+// the forward kinematics gives the same direction scaled down
+static void TestDesaturation() {
+    const float max_speed = 50;
+    for (const Layout& layout : LAYOUTS) {
+        Kinematics kinematics(layout.wheels, layout.wheel_num, max_speed);
+        test::Random random(3);
+        int failures = 0;
+        for (int i = 0; i < 10000; ++i) {
+            const float vx = IsDifferential(layout) ? 0 : random.Uniform(-8, 8);
+            const float vy = random.Uniform(-8, 8);
+            const float wz = random.Uniform(-20, 20);
+            float speed[MAX_WHEEL_NUM], angle[MAX_WHEEL_NUM], fx, fy, fw;
+            const float scale = kinematics.Inverse(vx, vy, wz, speed, angle);
+            kinematics.Forward(speed, angle, &fx, &fy, &fw);
+            float peak = 0;
+            for (int w = 0; w < layout.wheel_num; ++w)
+                peak = fmaxf(peak, fabsf(speed[w]));
+            if (scale <= 0 || scale > 1 || peak > max_speed * (1 + 1e-5f))
+                ++failures;
+            if (scale < 1 && peak < max_speed * (1 - 1e-5f))
+                ++failures;
+            const double error = fmax(fabs(fx - scale * vx),
+                                      fmax(fabs(fy - scale * vy), fabs(fw - scale * wz)));
+            if (error > 2e-5 * (1 + fabs(wz)))
+                ++failures;
+        }
+        printf("desaturation, %s: %d failures\n", layout.name, failures);
+        CHECK(failures == 0);
+    }
+}
+
+// 舵轮：随机指令下每次转向不超过90°，向后时反转轮子而不转向，停车时保持角度
+// swerve: random commands never steer more than 90° at once, driving backwards reverses the wheels
+// instead of steering, stopping keeps the angles
+static void TestSwerve() {
+    Kinematics kinematics(SWERVE, 4, 50);
+    test::Random random(4);
+    float speed[4], angle[4], last[4] = {0, 0, 0, 0};
+    double max_step = 0;
+    for (int i = 0; i < 100000; ++i) {
+        kinematics.Inverse(random.Uniform(-3, 3), random.Uniform(-3, 3), random.Uniform(-6, 6),
+                           speed, angle);
+        for (int w = 0; w < 4; ++w) {
+            max_step = fmax(max_step, fabs(remainder((double)angle[w] - last[w], 2 * M_PI)));
+            CHECK(angle[w] >= -PI * (1 + 1e-6f) && angle[w] <= PI * (1 + 1e-6f));
+            last[w] = angle[w];
+        }
+    }
+    printf("swerve: max steering step %.2f deg\n", max_step * 180 / M_PI);
+    CHECK(max_step <= M_PI / 2 + 1e-5);
+
+    Kinematics fresh(SWERVE, 4, 50);
+    fresh.Inverse(0, 1, 0, speed, angle);
+    CHECK_NEAR(angle[0], 0, 1e-6);
+    CHECK_NEAR(speed[0], 1 / RADIUS, 1e-4);
+    fresh.Inverse(0, -1, 0, speed, angle);
+    CHECK_NEAR(angle[0], 0, 1e-6);
+    CHECK_NEAR(speed[0], -1 / RADIUS, 1e-4);
+    fresh.Inverse(1, 0.01f, 0, speed, angle);
+    CHECK_NEAR(angle[0], -atan2(1, 0.01), 1e-5);
+    CHECK(speed[0] > 0);
+    fresh.Inverse(0, 0, 0, speed, angle);
+    CHECK_NEAR(angle[0], -atan2(1, 0.01), 1e-5);
+    CHECK(speed[0] == 0);
+
+    // 校准后的角度作为下一次优化的起点 / an aligned angle is where the next optimization starts
+    fresh.SetModuleAngle(0, PI);
+    fresh.Inverse(0, 1, 0, speed, angle);
+    CHECK_NEAR(fabs(angle[0]), M_PI, 1e-5);
+    CHECK_NEAR(speed[0], -1 / RADIUS, 1e-4);
+}
+
+static void Benchmark() {
+    const int N = 1 << 20;
+    printf("benchmark, one control period:\n");
+    for (const Layout& layout : LAYOUTS) {
+        Kinematics kinematics(layout.wheels, layout.wheel_num, 40);
+        float speed[MAX_WHEEL_NUM], angle[MAX_WHEEL_NUM], sum = 0;
+        char name[64];
+        test::Stopwatch stopwatch;
+        for (int i = 0; i < N; ++i) {
+            kinematics.Inverse(0.001f * (i & 1023), 1, 0.5f, speed, angle);
+            sum += speed[0];
+        }
+        snprintf(name, sizeof(name), "Inverse, %s", layout.name);
+        test::Report(name, stopwatch, N);
+        float vx, vy, wz;
+        stopwatch.Restart();
+        for (int i = 0; i < N; ++i) {
+            speed[i % layout.wheel_num] += 0.001f;
+            kinematics.Forward(speed, angle, &vx, &vy, &wz);
+            sum += vx;
+        }
+        snprintf(name, sizeof(name), "Forward, %s", layout.name);
+        test::Report(name, stopwatch, N);
+        test::Consume(sum);
+    }
+}
+
+int main() {
+    TestRoundTrip();
+    TestLegacy();
+    TestDesaturation();
+    TestSwerve();
+    Benchmark();
+    return test::Finish();
+}
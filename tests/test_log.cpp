@@ -0,0 +1,399 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// 延迟日志的测试：按tools/log_decoder.py的格式解码log_flush()的输出，检查参数、丢弃计数和
+// 截断，多个线程同时写入LogRing时记录不丢失也不损坏，以及与snprintf格式化的耗时对比。
+// 带--capture <前缀>运行时把log_flush()的输出和snprintf得到的期望文本写入<前缀>.bin和
+// <前缀>.txt，由test_log_decoder.py交给tools/log_decoder.py按本程序的ELF解码后比较
+// tests of the deferred log: the output of log_flush() is decoded as tools/log_decoder.py does
+// and checked for the arguments, the dropped count and truncation, records stay whole and in
+// order with several threads pushing to a LogRing at once, and the cost is compared with
+// formatting by snprintf. Run with --capture <prefix>, the output of log_flush() and the text
+// expected from snprintf are written to <prefix>.bin and <prefix>.txt, for test_log_decoder.py
+// to decode with tools/log_decoder.py against the ELF of this program and compare
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bsp_log.h"
+#include "bsp_os.h"
+#include "bsp_print.h"
+#include "test.h"
+
+using bsp::LogRing;
+
+namespace {
+
+    typedef struct {
+        uint8_t tag;
+        uint64_t bits;  // 整数和浮点数的原始字节 / raw bytes of integers and floats
+        std::string text;
+    } arg_t;
+
+    typedef struct {
+        uint32_t address;
+        uint32_t tick;
+        std::vector<arg_t> args;
+    } record_t;
+
+    // 与tools/log_decoder.py相同的帧格式：0xA5 0x5A | 长度 | 内容 | 内容字节之和
+    // the frame format of tools/log_decoder.py: 0xA5 0x5A | length | payload | sum of payload
+    std::vector<record_t> Decode(const std::vector<uint8_t>& stream, int* bad_frames) {
+        static const int SIZES[] = {0, 4, 4, 8, 8, 4, 8, 0, 4};
+        std::vector<record_t> records;
+        *bad_frames = 0;
+        size_t i = 0;
+        while (i + 4 <= stream.size()) {
+            if (stream[i] != 0xA5 || stream[i + 1] != 0x5A) {
+                ++i;
+                continue;
+            }
+            const uint8_t length = stream[i + 2];
+            if (i + 4 + length > stream.size())
+                break;
+            const uint8_t* payload = &stream[i + 3];
+            uint8_t checksum = 0;
+            for (int k = 0; k < length; ++k)
+                checksum += payload[k];
+            if (length < 8 || checksum != payload[length]) {
+                ++*bad_frames;
+                ++i;
+                continue;
+            }
+            record_t record;
+            memcpy(&record.address, payload, 4);
+            memcpy(&record.tick, payload + 4, 4);
+            for (int k = 8; k < length;) {
+                arg_t arg = {payload[k++], 0, ""};
+                if (arg.tag == bsp::LOG_ARG_STR) {
+                    arg.text.assign((const char*)payload + k + 1, payload[k]);
+                    k += 1 + payload[k];
+                } else if (arg.tag >= 1 && arg.tag <= 8) {
+                    memcpy(&arg.bits, payload + k, SIZES[arg.tag]);
+                    k += SIZES[arg.tag];
+                } else {
+                    ++*bad_frames;
+                    break;
+                }
+                record.args.push_back(arg);
+            }
+            records.push_back(record);
+            i += 4 + length;
+        }
+        return records;
+    }
+
+    std::vector<record_t> Flush(int* bad_frames) {
+        bsp::PrintedRaw().clear();
+        bsp::log_flush();
+        return Decode(bsp::PrintedRaw(), bad_frames);
+    }
+
+    uint32_t Address(const char* format) {
+        return (uint32_t)(uintptr_t)format;
+    }
+
+    template <typename T>
+    uint64_t Bits(T value) {
+        uint64_t bits = 0;
+        memcpy(&bits, &value, sizeof(value));
+        return bits;
+    }
+
+    // 按tools/log_decoder.py的输出格式追加一行 / appends a line as tools/log_decoder.py prints it
+    __attribute__((format(printf, 3, 4))) void Expect(std::string* text, uint32_t tick,
+                                                      const char* format, ...) {
+        char line[256];
+        snprintf(line, sizeof(line), "[%10u] ", tick);
+        *text += line;
+        va_list args;
+        va_start(args, format);
+        vsnprintf(line, sizeof(line), format, args);
+        va_end(args);
+        *text += line;
+    }
+
+    void Print(std::string* text, const char* plain) {
+        print_raw((const uint8_t*)plain, strlen(plain));
+        *text += plain;
+    }
+
+    bool Write(const std::string& path, const void* data, size_t size) {
+        FILE* file = fopen(path.c_str(), "wb");
+        if (file == nullptr)
+            return false;
+        const bool written = fwrite(data, 1, size, file) == size;
+        return fclose(file) == 0 && written;
+    }
+
+}  // namespace
+
+// 写出一段与板子上相同的输出：普通print的文本夹着日志帧，包括各种参数和格式、截断的字符串、
+// 丢弃计数和跨越多次发送的记录，期望的文本由snprintf按相同的格式生成，%p按解码器的0x%08x
+// writes an output like the one of a board: text of the regular print between log frames, with
+// every kind of argument and format, a truncated string, the dropped count and records spread
+// over several transmissions, the expected text is rendered by snprintf with the same formats,
+// %p as the 0x%08x of the decoder
+static int Capture(const char* prefix) {
+    std::string expected;
+    bsp::PrintedRaw().clear();
+    Print(&expected, "boot\r\n");
+
+    bsp::SetHighresTickMicroSec(1234567);
+    int dummy;
+    const int64_t big = -1234567890123LL;
+    const uint64_t huge = 0xfedcba9876543210ULL;
+    bsp::log_deferred("motor %d: %u %lld %llu %f %.3f %s %p\r\n", -5, 7u, big, huge, 1.5f, 2.25,
+                      "name", &dummy);
+    Expect(&expected, 1234, "motor %d: %u %lld %llu %f %.3f %s 0x%08x\r\n", -5, 7u, (long long)big,
+           (unsigned long long)huge, 1.5f, 2.25, "name", Address((const char*)&dummy));
+    bsp::log_deferred("%-8s|%5.1f|%+d|%x|%hhu|%ld\r\n", "ab", 3.14159f, 42, 255u, (uint8_t)200,
+                      123456L);
+    Expect(&expected, 1234, "%-8s|%5.1f|%+d|%x|%hhu|%ld\r\n", "ab", 3.14159f, 42, 255u,
+           (uint8_t)200, 123456L);
+    const std::string text(100, 'x');
+    bsp::log_deferred("[%s]\r\n", text.c_str());
+    Expect(&expected, 1234, "[%s]\r\n", text.substr(0, bsp::LOG_MAX_STR_LEN).c_str());
+    bsp::log_flush();
+    Print(&expected, "plain text between flushes\r\n");
+
+    // 缓冲区满后丢弃，丢弃计数排在留下的记录前面
+    // records are dropped once the ring is full, the dropped count comes before the rest
+    bsp::SetHighresTickMicroSec(2000000);
+    std::string queued;
+    int dropped = 0;
+    for (int i = 0; i < 1000; ++i) {
+        if (bsp::log_deferred("sample %d %f\r\n", i, 0.5f * i))
+            Expect(&queued, 2000, "sample %d %f\r\n", i, 0.5f * i);
+        else
+            ++dropped;
+    }
+    bsp::log_flush();
+    Expect(&expected, 2000, "<log> %d records dropped so far\r\n", dropped);
+    expected += queued;
+
+    const std::vector<uint8_t>& stream = bsp::PrintedRaw();
+    if (!Write(std::string(prefix) + ".bin", stream.data(), stream.size()) ||
+        !Write(std::string(prefix) + ".txt", expected.data(), expected.size())) {
+        printf("cannot write %s.bin and %s.txt\n", prefix, prefix);
+        return 1;
+    }
+    printf("captured %zu bytes of log frames, %d records dropped\n", stream.size(), dropped);
+    return 0;
+}
+
+// 每种参数按类型打上标记，原始字节原样送到主机
+// every argument is tagged by its type and its raw bytes reach the host unchanged
+static void TestArguments() {
+    static const char* const FORMAT = "motor %d: %u %lld %llu %f %f %s %p\r\n";
+    bsp::SetHighresTickMicroSec(1234567);
+    int dummy;
+    const int64_t big = -1234567890123LL;
+    const uint64_t huge = 0xfedcba9876543210ULL;
+    CHECK(bsp::log_deferred(FORMAT, -5, 7u, big, huge, 1.5f, 2.25, "name", &dummy));
+    int bad_frames;
+    const std::vector<record_t> records = Flush(&bad_frames);
+    CHECK(bad_frames == 0);
+    CHECK(records.size() == 1);
+    if (records.size() != 1)
+        return;
+    const record_t& record = records[0];
+    CHECK(record.address == Address(FORMAT));
+    CHECK(record.tick == 1234);
+    const arg_t expected[] = {
+        {bsp::LOG_ARG_I32, Bits<int32_t>(-5), ""},
+        {bsp::LOG_ARG_U32, 7, ""},
+        {bsp::LOG_ARG_I64, Bits(big), ""},
+        {bsp::LOG_ARG_U64, huge, ""},
+        {bsp::LOG_ARG_F32, Bits(1.5f), ""},
+        {bsp::LOG_ARG_F64, Bits(2.25), ""},
+        {bsp::LOG_ARG_STR, 0, "name"},
+        {bsp::LOG_ARG_PTR, Address((const char*)&dummy), ""},
+    };
+    CHECK(record.args.size() == sizeof(expected) / sizeof(expected[0]));
+    for (size_t i = 0; i < record.args.size() && i < sizeof(expected) / sizeof(expected[0]);
+         ++i) {
+        CHECK(record.args[i].tag == expected[i].tag);
+        CHECK(record.args[i].bits == expected[i].bits);
+        CHECK(record.args[i].text == expected[i].text);
+    }
+}
+
+// 长字符串截断到LOG_MAX_STR_LEN，参数太多时截断到LOG_MAX_RECORD
+// long strings are cut to LOG_MAX_STR_LEN and too many arguments to LOG_MAX_RECORD
+static void TestTruncation() {
+    static const char* const FORMAT = "%s";
+    const std::string text(100, 'x');
+    CHECK(bsp::log_deferred(FORMAT, text.c_str()));
+    CHECK(bsp::log_deferred(FORMAT, (const char*)nullptr));
+    CHECK(bsp::log_deferred(FORMAT, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0, 10.0));
+    int bad_frames;
+    const std::vector<record_t> records = Flush(&bad_frames);
+    CHECK(bad_frames == 0);
+    CHECK(records.size() == 3);
+    if (records.size() != 3)
+        return;
+    CHECK(records[0].args.size() == 1 && records[0].args[0].text == text.substr(0, 31));
+    CHECK(records[1].args.size() == 1 && records[1].args[0].text.empty());
+    // 8字节的头加上每个9字节的double / 8 byte header plus 9 bytes per double
+    CHECK(records[2].args.size() == (bsp::LOG_MAX_RECORD - 8) / 9);
+}
+
+// 缓冲区满时丢弃新记录，下一次发送先报告丢弃的总数，之前的记录按顺序完整送出
+// with the ring full new records are dropped, the next flush reports the total dropped first
+// and the queued records follow whole and in order
+static void TestDropped() {
+    static const char* const FORMAT = "sample %d %f\r\n";
+    int queued = 0, dropped = 0;
+    for (int i = 0; i < 1000; ++i) {
+        if (bsp::log_deferred(FORMAT, i, 0.5f * i))
+            ++queued;
+        else
+            ++dropped;
+    }
+    CHECK(queued > 0 && dropped > 0);
+    CHECK(bsp::log_ring.Dropped() == (uint32_t)dropped);
+    int bad_frames;
+    std::vector<record_t> records = Flush(&bad_frames);
+    CHECK(bad_frames == 0);
+    CHECK((int)records.size() == queued + 1);
+    if ((int)records.size() != queued + 1)
+        return;
+    CHECK(records[0].address == 0);
+    CHECK(records[0].args.size() == 1 && records[0].args[0].bits == (uint64_t)dropped);
+    bool in_order = true;
+    for (int i = 0; i < queued; ++i) {
+        const record_t& record = records[i + 1];
+        in_order = in_order && record.address == Address(FORMAT) && record.args.size() == 2 &&
+                   record.args[0].bits == (uint32_t)i && record.args[1].bits == Bits(0.5f * i);
+    }
+    CHECK(in_order);
+
+    // 丢弃数没有变化时不再报告 / the dropped count is not reported again unchanged
+    CHECK(bsp::log_deferred(FORMAT, 1, 1.0f));
+    records = Flush(&bad_frames);
+    CHECK(records.size() == 1 && records[0].address == Address(FORMAT));
+}
+
+// 多个线程同时写入，单个线程读出，满了就重试：每个写者的记录都按顺序到达，内容完整
+// several threads push while a single one pops, retrying while the ring is full: every record
+// of every producer arrives intact and in order
+static void TestConcurrentRing() {
+    constexpr int PRODUCERS = 4;
+    constexpr uint32_t RECORDS = 20000;
+    static LogRing<1024> ring;
+    std::atomic<uint32_t> pushed{0};
+    std::atomic<int> running{PRODUCERS};
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; ++p) {
+        producers.emplace_back([p, &pushed, &running] {
+            uint8_t record[64];
+            for (uint32_t seq = 0; seq < RECORDS; ++seq) {
+                const uint32_t length = 8 + (seq * 7 + p) % 50;
+                record[0] = (uint8_t)p;
+                memcpy(record + 1, &seq, 4);
+                for (uint32_t k = 5; k < length; ++k)
+                    record[k] = (uint8_t)(seq + k);
+                // 满了就让出处理器等读者 / wait for the reader while the ring is full
+                while (!ring.Push(record, length))
+                    std::this_thread::yield();
+                pushed.fetch_add(1, std::memory_order_relaxed);
+            }
+            running.fetch_sub(1);
+        });
+    }
+    uint32_t popped = 0, corrupted = 0;
+    int64_t last[PRODUCERS];
+    for (int p = 0; p < PRODUCERS; ++p)
+        last[p] = -1;
+    uint8_t record[64];
+    while (true) {
+        const bool done = running.load() == 0;
+        uint32_t length;
+        while ((length = ring.Pop(record, sizeof(record))) != 0) {
+            ++popped;
+            uint32_t seq;
+            memcpy(&seq, record + 1, 4);
+            const int p = record[0];
+            bool ok = p < PRODUCERS && length == 8 + (seq * 7 + p) % 50 && seq == last[p] + 1;
+            for (uint32_t k = 5; ok && k < length; ++k)
+                ok = record[k] == (uint8_t)(seq + k);
+            if (!ok) {
+                ++corrupted;
+                continue;
+            }
+            last[p] = seq;
+        }
+        if (done)
+            break;
+        std::this_thread::yield();
+    }
+    for (std::thread& producer : producers)
+        producer.join();
+    printf("concurrent ring: %u pushed, %u popped, %u retried while full, %u corrupted\n",
+           pushed.load(), popped, ring.Dropped(), corrupted);
+    CHECK(corrupted == 0);
+    CHECK(popped == PRODUCERS * RECORDS);
+    CHECK(pushed.load() == PRODUCERS * RECORDS);
+}
+
+static void Benchmark() {
+    static const char* const FORMAT = "pid %d: error %f output %f\r\n";
+    const int N = 16;
+    const int rounds = 4096;
+    char text[128];
+    printf("benchmark, one record of an int and two floats:\n");
+    test::Stopwatch stopwatch;
+    for (int r = 0; r < rounds; ++r)
+        for (int i = 0; i < N; ++i)
+            test::Consume(snprintf(text, sizeof(text), FORMAT, i, 0.1f * i, 2.0f * i));
+    test::Report("snprintf, the formatting of print", stopwatch, (long)rounds * N);
+    double elapsed = 0, cycles = 0;
+    for (int r = 0; r < rounds; ++r) {
+        stopwatch.Restart();
+        for (int i = 0; i < N; ++i)
+            bsp::log_deferred(FORMAT, i, 0.1f * i, 2.0f * i);
+        elapsed += stopwatch.Nanoseconds();
+        cycles += stopwatch.Cycles();
+        // 发送不计入调用方的耗时 / draining is not part of the cost to the caller
+        bsp::log_flush();
+        bsp::PrintedRaw().clear();
+    }
+    printf("  %-40s %8.1f ns/call %8.1f cycles/call\n", "log_deferred", elapsed / rounds / N,
+           cycles / rounds / N);
+    test::Consume(text);
+}
+
+int main(int argc, char** argv) {
+    if (argc == 3 && strcmp(argv[1], "--capture") == 0)
+        return Capture(argv[2]);
+    TestArguments();
+    TestTruncation();
+    TestDropped();
+    TestConcurrentRing();
+    Benchmark();
+    return test::Finish();
+}
@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+############################################################
+# Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+#                                                          #
+# This program is free software: you can redistribute it   #
+# and/or modify it under the terms of the GNU General      #
+# Public License as published by the Free Software         #
+# Foundation, either version 3 of the License, or (at      #
+# your option) any later version.                          #
+#                                                          #
+# This program is distributed in the hope that it will be  #
+# useful, but WITHOUT ANY WARRANTY; without even           #
+# the implied warranty of MERCHANTABILITY or FITNESS       #
+# FOR A PARTICULAR PURPOSE.  See the GNU General           #
+# Public License for more details.                         #
+#                                                          #
+# You should have received a copy of the GNU General       #
+# Public License along with this program.  If not, see     #
+# <https://www.gnu.org/licenses/>.                         #
+############################################################
+"""Round trip of the deferred log through the shipped host decoder.
+
+Usage:
+    test_log_decoder.py <test_log> <log_decoder.py>
+
+test_log --capture writes the output of log_flush() and the text snprintf renders
+for the same records. tools/log_decoder.py then decodes the capture against the
+ELF of test_log itself, which takes its section reader, the frame parser and the
+format rendering through the same path as on a board, and its output has to
+match the expected text byte for byte.
+"""
+
+import os
+import subprocess
+import sys
+import tempfile
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(__doc__)
+        return 1
+    test, decoder = sys.argv[1:]
+    with tempfile.TemporaryDirectory() as directory:
+        prefix = os.path.join(directory, "log")
+        subprocess.run([test, "--capture", prefix], check=True)
+        decoded = subprocess.run([sys.executable, decoder, test, prefix + ".bin"], check=True,
+                                 stdout=subprocess.PIPE).stdout
+        with open(prefix + ".txt", "rb") as f:
+            expected = f.read()
+    decoded_lines = decoded.split(b"\r\n")
+    expected_lines = expected.split(b"\r\n")
+    mismatches = 0
+    for i in range(max(len(decoded_lines), len(expected_lines))):
+        got = decoded_lines[i] if i < len(decoded_lines) else b"<missing>"
+        want = expected_lines[i] if i < len(expected_lines) else b"<missing>"
+        if got != want:
+            mismatches += 1
+            if mismatches <= 10:
+                print("line %d: decoded %r, expected %r" % (i + 1, got, want))
+    print("%d lines decoded, %d mismatches" % (len(expected_lines) - 1, mismatches))
+    return 1 if mismatches else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,451 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// Mahony姿态解算的测试：合成的旋转和倾斜的IMU数据在不同采样率下，新的实现按实际dt积分，倾角误差
+// 与采样率无关，原来固定1kHz的MahonyAHRS.c只在1kHz下正确；1kHz下两者一致；启动阶段的大增益和
+// 加速度计初始化加快收敛，实例之间互不影响，积分和磁力计，以及调用方计算dt的PeriodTimer
+// tests of the Mahony filter: on synthetic spinning and tilting IMU data at several sample rates
+// the new code integrates the measured dt and its tilt error does not depend on the rate, while
+// the old MahonyAHRS.c fixed at 1 kHz is only right at 1 kHz; at 1 kHz both agree; the startup
+// gain and the accelerometer initialization speed up convergence, instances do not interfere,
+// the integral and magnetometer paths, and the PeriodTimer the callers take dt from
+
+#include <math.h>
+
+#include <initializer_list>
+
+#include "mahony.h"
+#include "test.h"
+#include "utils.h"
+
+extern "C" {
+#include "MahonyAHRS.h"
+}
+
+using control::Mahony;
+
+namespace {
+
+    constexpr double DURATION = 20;
+    constexpr double SETTLED = 10;  // 之后统计误差 / errors are counted after this [s]
+    constexpr int SUBSTEPS = 20;    // 真实姿态每个采样的积分步数 / truth steps per sample
+
+    // 原来的滤波器的增益，关闭启动阶段 / gains of the old filter, no startup phase
+    constexpr control::mahony_init_t OLD_GAINS = {0.5f, 0, 0, 0};
+
+    // 合成的IMU数据：机体绕三轴变化的角速度旋转，真实姿态用二阶龙格库塔细分积分
+    // synthetic IMU data: the body turns with rates varying on all three axes, the true attitude
+    // is integrated with midpoint Runge-Kutta on finer steps
+    class Motion {
+      public:
+        Motion(double rate, uint32_t seed, const double q[4] = nullptr)
+            : dt_(1 / rate), random_(seed) {
+            if (q != nullptr)
+                for (int i = 0; i < 4; ++i)
+                    q_[i] = q[i];
+            UpdateGravity();
+        }
+
+        void Step(float gyro[3], float accel[3]) {
+            const double h = dt_ / SUBSTEPS;
+            for (int i = 0; i < SUBSTEPS; ++i) {
+                double w[3], k[4], mid[4];
+                Rate(t_ + h / 2, w);
+                Derivative(q_, w, k);
+                for (int j = 0; j < 4; ++j)
+                    mid[j] = q_[j] + k[j] * h / 2;
+                Derivative(mid, w, k);
+                for (int j = 0; j < 4; ++j)
+                    q_[j] += k[j] * h;
+                t_ += h;
+            }
+            const double norm = sqrt(q_[0] * q_[0] + q_[1] * q_[1] + q_[2] * q_[2] + q_[3] * q_[3]);
+            for (int i = 0; i < 4; ++i)
+                q_[i] /= norm;
+            UpdateGravity();
+            double w[3];
+            Rate(t_, w);
+            for (int i = 0; i < 3; ++i) {
+                gyro[i] = (float)w[i] + bias_[i] + random_.Normal(0.003f);
+                accel[i] = 9.8f * (float)gravity_[i] + random_.Normal(0.05f);
+            }
+        }
+
+        // 常值零漂 / constant gyro bias
+        void SetBias(float x, float y, float z) {
+            bias_[0] = x;
+            bias_[1] = y;
+            bias_[2] = z;
+        }
+
+        // 世界坐标系下指向北偏下的地磁场在机体坐标系中的测量 / the field pointing north and down
+        // in the world frame, measured in the body frame
+        void Magnetometer(float mag[3]) const {
+            const double field[3] = {0.4, 0, -0.9};
+            const double a = q_[0], b = q_[1], c = q_[2], d = q_[3];
+            const double r[3][3] = {
+                {a * a + b * b - c * c - d * d, 2 * (b * c - a * d), 2 * (b * d + a * c)},
+                {2 * (b * c + a * d), a * a - b * b + c * c - d * d, 2 * (c * d - a * b)},
+                {2 * (b * d - a * c), 2 * (c * d + a * b), a * a - b * b - c * c + d * d},
+            };
+            for (int i = 0; i < 3; ++i)
+                mag[i] = (float)(r[0][i] * field[0] + r[1][i] * field[1] + r[2][i] * field[2]);
+        }
+
+        // 估计的重力方向与真实方向的夹角 [rad] / angle between the estimated and the true gravity
+        // direction [rad]
+        double TiltError(const float q[4]) const {
+            const double g[3] = {2 * (q[1] * q[3] - q[0] * q[2]), 2 * (q[0] * q[1] + q[2] * q[3]),
+                                 q[0] * q[0] - q[1] * q[1] - q[2] * q[2] + q[3] * q[3]};
+            const double cosine = g[0] * gravity_[0] + g[1] * gravity_[1] + g[2] * gravity_[2];
+            return acos(fmin(cosine / sqrt(g[0] * g[0] + g[1] * g[1] + g[2] * g[2]), 1));
+        }
+
+        // 估计的姿态与真实姿态之间的旋转角 [rad] / angle of the rotation between the estimated
+        // and the true attitude [rad]
+        double AttitudeError(const float q[4]) const {
+            const double dot = q[0] * q_[0] + q[1] * q_[1] + q[2] * q_[2] + q[3] * q_[3];
+            return 2 * acos(fmin(fabs(dot), 1));
+        }
+
+        double Time() const {
+            return t_;
+        }
+
+        double Period() const {
+            return dt_;
+        }
+
+      private:
+        double dt_;
+        test::Random random_;
+        double t_ = 0;
+        double q_[4] = {1, 0, 0, 0};
+        double gravity_[3] = {0, 0, 1};
+        float bias_[3] = {0, 0, 0};
+
+        static void Rate(double t, double w[3]) {
+            w[0] = 0.8 * sin(0.7 * t);
+            w[1] = 0.6 * sin(1.1 * t + 1);
+            w[2] = 2.0 + 1.5 * sin(0.3 * t);
+        }
+
+        static void Derivative(const double q[4], const double w[3], double k[4]) {
+            k[0] = 0.5 * (-q[1] * w[0] - q[2] * w[1] - q[3] * w[2]);
+            k[1] = 0.5 * (q[0] * w[0] + q[2] * w[2] - q[3] * w[1]);
+            k[2] = 0.5 * (q[0] * w[1] - q[1] * w[2] + q[3] * w[0]);
+            k[3] = 0.5 * (q[0] * w[2] + q[1] * w[1] - q[2] * w[0]);
+        }
+
+        void UpdateGravity() {
+            gravity_[0] = 2 * (q_[1] * q_[3] - q_[0] * q_[2]);
+            gravity_[1] = 2 * (q_[0] * q_[1] + q_[2] * q_[3]);
+            gravity_[2] = q_[0] * q_[0] - q_[1] * q_[1] - q_[2] * q_[2] + q_[3] * q_[3];
+        }
+    };
+
+    // 稳定后的倾角误差的均方根 [deg] / rms tilt error once settled [deg]
+    struct errors_t {
+        double old_rms;
+        double new_rms;
+    };
+
+    errors_t RunBoth(double rate) {
+        Motion motion(rate, 1);
+        Mahony mahony(OLD_GAINS);
+        float q_old[4] = {1, 0, 0, 0};
+        twoKp = 2 * OLD_GAINS.kp;
+        twoKi = 0;
+        double old_sum = 0, new_sum = 0;
+        int samples = 0;
+        while (motion.Time() < DURATION) {
+            float gyro[3], accel[3];
+            motion.Step(gyro, accel);
+            MahonyAHRSupdateIMU(q_old, gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2]);
+            mahony.Update(gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2],
+                          (float)motion.Period());
+            if (motion.Time() >= SETTLED) {
+                float q[4];
+                mahony.GetQuaternion(q);
+                old_sum += pow(motion.TiltError(q_old), 2);
+                new_sum += pow(motion.TiltError(q), 2);
+                ++samples;
+            }
+        }
+        return {sqrt(old_sum / samples) * 180 / M_PI, sqrt(new_sum / samples) * 180 / M_PI};
+    }
+
+    // 第一次倾角误差不超过1度并保持的时间 [s]，从倾斜30度开始 / time [s] after which the tilt
+    // error stays within 1 degree, starting 30 degrees tilted
+    template <typename Update>
+    double ConvergenceTime(Update update) {
+        const double half = 15 * M_PI / 180;
+        const double tilted[4] = {cos(half), sin(half), 0, 0};
+        Motion motion(1000, 2, tilted);
+        double last_out = 0;
+        while (motion.Time() < 10) {
+            float gyro[3], accel[3], q[4];
+            motion.Step(gyro, accel);
+            update(gyro, accel, q);
+            if (motion.TiltError(q) > M_PI / 180)
+                last_out = motion.Time();
+        }
+        return last_out;
+    }
+
+}  // namespace
+
+// 不同采样率下的倾角误差：原来的实现按1kHz积分，其他采样率下误差大几个数量级。新的实现的误差
+// 随采样周期增大，因为一个周期内角速度按常值积分
+// tilt error at several sample rates: the old code integrates as if at 1 kHz and is orders of
+// magnitude off at any other rate. The error of the new code grows with the period since the
+// rate is held over a sample
+static void TestRates() {
+    printf("rates, rms tilt error after %.0f s [deg]:\n", SETTLED);
+    for (double rate : {200.0, 500.0, 1000.0, 2000.0}) {
+        const errors_t errors = RunBoth(rate);
+        printf("  %5.0f Hz: old %8.4f, new %.4f\n", rate, errors.old_rms, errors.new_rms);
+        CHECK(errors.new_rms < 0.3);
+        if (rate == 1000) {
+            CHECK_NEAR(errors.new_rms, errors.old_rms, 0.05 * errors.old_rms);
+        } else {
+            CHECK(errors.old_rms > 20 * errors.new_rms);
+        }
+    }
+}
+
+// 1kHz且增益相同时与原来的实现是同一个滤波器，只有四元数积分方式和平方根倒数的差别
+// at 1 kHz with the same gains it is the same filter as the old one, only the quaternion
+// integration and the inverse square root differ
+static void TestEquivalence() {
+    Motion motion(1000, 3);
+    Mahony mahony(OLD_GAINS);
+    float q_old[4] = {1, 0, 0, 0};
+    twoKp = 2 * OLD_GAINS.kp;
+    twoKi = 0;
+    double max_tilt = 0, max_attitude = 0;
+    while (motion.Time() < DURATION) {
+        float gyro[3], accel[3], q[4];
+        motion.Step(gyro, accel);
+        MahonyAHRSupdateIMU(q_old, gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2]);
+        mahony.Update(gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2], 0.001f);
+        mahony.GetQuaternion(q);
+        max_tilt = fmax(max_tilt, fabs(motion.TiltError(q) - motion.TiltError(q_old)));
+        const double dot = q[0] * q_old[0] + q[1] * q_old[1] + q[2] * q_old[2] + q[3] * q_old[3];
+        max_attitude = fmax(max_attitude, 2 * acos(fmin(fabs(dot), 1)));
+    }
+    printf("equivalence: max difference in tilt error %.3g deg, in attitude %.3g deg\n",
+           max_tilt * 180 / M_PI, max_attitude * 180 / M_PI);
+    // yaw不可观，积分方式的差别在yaw上累积 / yaw is unobservable and accumulates the difference
+    // in the integration
+    CHECK(max_tilt * 180 / M_PI < 0.01);
+    CHECK(max_attitude * 180 / M_PI < 0.1);
+}
+
+// 从倾斜30度开始：原来的实现要几秒，启动阶段的大增益在启动阶段结束前收敛，用加速度计初始化时
+// 立即收敛
+// starting 30 degrees tilted: the old code takes seconds, the startup gain converges before the
+// startup phase ends, and initializing from the accelerometer converges immediately
+static void TestStartup() {
+    float q_old[4] = {1, 0, 0, 0};
+    twoKp = 2 * OLD_GAINS.kp;
+    twoKi = 0;
+    const double old_time = ConvergenceTime([&](float* gyro, float* accel, float* q) {
+        MahonyAHRSupdateIMU(q_old, gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2]);
+        for (int i = 0; i < 4; ++i)
+            q[i] = q_old[i];
+    });
+    Mahony startup;
+    const double startup_time = ConvergenceTime([&](float* gyro, float* accel, float* q) {
+        startup.Update(gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2], 0.001f);
+        startup.GetQuaternion(q);
+    });
+    Mahony initialized;
+    bool first = true;
+    const double initialized_time = ConvergenceTime([&](float* gyro, float* accel, float* q) {
+        if (first)
+            initialized.Reset(accel[0], accel[1], accel[2]);
+        first = false;
+        initialized.Update(gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2], 0.001f);
+        initialized.GetQuaternion(q);
+    });
+    printf("startup: within 1 deg after old %.3f s, startup gain %.3f s, accel init %.3f s\n",
+           old_time, startup_time, initialized_time);
+    CHECK(old_time > 3);
+    CHECK(startup_time < 1);
+    CHECK(initialized_time < 0.01);
+    CHECK(startup.IsConverged());
+
+    // Reset重新开始启动阶段 / Reset restarts the startup phase
+    startup.Reset();
+    CHECK(!startup.IsConverged());
+    float q[4];
+    startup.GetQuaternion(q);
+    CHECK(q[0] == 1 && q[1] == 0 && q[2] == 0 && q[3] == 0);
+    startup.Update(0, 0, 0, 0, 0, 9.8f, 0);
+    CHECK(!startup.IsConverged());
+}
+
+// 没有全局状态，两个实例交替更新与各自单独更新的结果逐位相同
+// no global state, two interleaved instances give bit identical results to running alone
+static void TestInstances() {
+    Mahony a, b, alone;
+    Motion motion_a(1000, 4), motion_b(500, 5), motion_alone(1000, 4);
+    float gyro[3], accel[3];
+    for (int k = 0; k < 3000; ++k) {
+        motion_a.Step(gyro, accel);
+        a.Update(gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2], 0.001f);
+        motion_b.Step(gyro, accel);
+        b.Update(gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2], 0.002f);
+        motion_alone.Step(gyro, accel);
+        alone.Update(gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2], 0.001f);
+    }
+    float qa[4], qalone[4];
+    a.GetQuaternion(qa);
+    alone.GetQuaternion(qalone);
+    for (int i = 0; i < 4; ++i)
+        CHECK(qa[i] == qalone[i]);
+    printf("instances: done\n");
+}
+
+// 姿态解算的调用方用PeriodTimer由时间戳得到dt：第一次调用、时间戳为0、时间倒退和间隔过长时
+// 返回名义周期，其余返回实际间隔
+// callers of the filter take dt from timestamps with PeriodTimer: the nominal period on the first
+// call, for a zero timestamp, a timestamp going backwards and a gap too long, the real interval
+// otherwise
+static void TestPeriodTimer() {
+    PeriodTimer timer(0.001f, 0.01f);
+    CHECK(timer.Update(5000000) == 0.001f);
+    CHECK_NEAR(timer.Update(5001250), 0.00125, 1e-7);
+    CHECK_NEAR(timer.Update(5001950), 0.0007, 1e-7);
+    CHECK(timer.Update(5001950) == 0.001f);
+    CHECK(timer.Update(0) == 0.001f);
+    CHECK(timer.Update(5003000) == 0.001f);
+    CHECK_NEAR(timer.Update(5012999), 0.009999, 1e-7);
+    CHECK(timer.Update(5023000) == 0.001f);
+    CHECK(timer.Update(5022000) == 0.001f);
+    CHECK_NEAR(timer.Update(5024000), 0.002, 1e-7);
+    // 电机按新的控制频率修改周期 / a motor changes the period with its control frequency
+    timer.SetPeriod(0.002f, 0.02f);
+    CHECK_NEAR(timer.Update(5039000), 0.015, 1e-7);
+    CHECK(timer.Update(5069000) == 0.002f);
+    printf("period timer: done\n");
+}
+
+// 陀螺仪有零漂时积分项消除倾角的稳态误差，磁力计让yaw也收敛
+// with a gyro bias the integral removes the steady tilt error, the magnetometer makes yaw
+// converge as well
+static void TestIntegralAndMagnetometer() {
+    // 积分项的收敛要十几秒 / the integral takes more than ten seconds to converge
+    double tilt[2];
+    for (int use_integral = 0; use_integral < 2; ++use_integral) {
+        Motion motion(1000, 6);
+        motion.SetBias(0.03f, -0.02f, 0.01f);
+        control::mahony_init_t init = control::MAHONY_DEFAULT_INIT;
+        init.ki = use_integral ? 0.3f : 0;
+        Mahony mahony(init);
+        double sum = 0;
+        int samples = 0;
+        while (motion.Time() < 30) {
+            float gyro[3], accel[3], q[4];
+            motion.Step(gyro, accel);
+            mahony.Update(gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2], 0.001f);
+            mahony.GetQuaternion(q);
+            if (motion.Time() >= 20) {
+                sum += pow(motion.TiltError(q), 2);
+                ++samples;
+            }
+        }
+        tilt[use_integral] = sqrt(sum / samples) * 180 / M_PI;
+    }
+    printf("integral: rms tilt error with bias %.4f deg without ki, %.4f deg with ki\n", tilt[0],
+           tilt[1]);
+    CHECK(tilt[1] * 3 < tilt[0]);
+
+    // 从加速度计初始化时yaw为0，真实的yaw为40度。默认增益下yaw的修正很慢，时间常数约20秒
+    // initializing from the accelerometer gives zero yaw while the true yaw is 40 degrees. With
+    // the default gains yaw is corrected slowly, the time constant is about 20 s
+    const double half = 20 * M_PI / 180;
+    const double yawed[4] = {cos(half), 0, 0, sin(half)};
+    double attitude[2];
+    for (int use_magnetometer = 0; use_magnetometer < 2; ++use_magnetometer) {
+        Motion motion(1000, 7, yawed);
+        Mahony mahony;
+        float gyro[3], accel[3], mag[3], q[4];
+        motion.Step(gyro, accel);
+        mahony.Reset(accel[0], accel[1], accel[2]);
+        while (motion.Time() < 30) {
+            motion.Step(gyro, accel);
+            motion.Magnetometer(mag);
+            if (!use_magnetometer)
+                mag[0] = mag[1] = mag[2] = 0;
+            mahony.Update(gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2], mag[0], mag[1],
+                          mag[2], 0.001f);
+        }
+        mahony.GetQuaternion(q);
+        attitude[use_magnetometer] = motion.AttitudeError(q) * 180 / M_PI;
+    }
+    printf("magnetometer: attitude error after 30 s %.3f deg without, %.3f deg with\n",
+           attitude[0], attitude[1]);
+    CHECK(attitude[0] > 35);
+    CHECK(attitude[1] * 4 < attitude[0]);
+}
+
+static void Benchmark() {
+    const int N = 1000000;
+    Motion motion(1000, 8);
+    static float gyro[N / 100][3], accel[N / 100][3];
+    for (int k = 0; k < N / 100; ++k)
+        motion.Step(gyro[k], accel[k]);
+
+    printf("benchmark:\n");
+    float q_old[4] = {1, 0, 0, 0};
+    test::Stopwatch stopwatch;
+    for (int k = 0; k < N; ++k) {
+        const int i = k % (N / 100);
+        MahonyAHRSupdateIMU(q_old, gyro[i][0], gyro[i][1], gyro[i][2], accel[i][0], accel[i][1],
+                            accel[i][2]);
+    }
+    test::Report("MahonyAHRSupdateIMU", stopwatch, N);
+    test::Consume(q_old[0]);
+
+    Mahony mahony;
+    stopwatch.Restart();
+    for (int k = 0; k < N; ++k) {
+        const int i = k % (N / 100);
+        mahony.Update(gyro[i][0], gyro[i][1], gyro[i][2], accel[i][0], accel[i][1], accel[i][2],
+                      0.001f);
+    }
+    test::Report("Mahony::Update", stopwatch, N);
+    float q[4];
+    mahony.GetQuaternion(q);
+    test::Consume(q[0]);
+}
+
+int main() {
+    TestRates();
+    TestEquivalence();
+    TestStartup();
+    TestInstances();
+    TestPeriodTimer();
+    TestIntegralAndMagnetometer();
+    Benchmark();
+    return test::Finish();
+}
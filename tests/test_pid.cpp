@@ -0,0 +1,167 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// 编译期确定模式的PID<FLAGS...>与ConstrainedPID以及改动之前的实现的逐位等价性测试，参数取自
+// DGStandard，以及各模式下的耗时对比
+// bit exact equivalence of the compile time PID<FLAGS...> with ConstrainedPID and the
+// implementation before the change, with the DGStandard parameters, and their cost per mode
+
+#include "pid_cases.h"
+
+using control::ConstrainedPID;
+using control::PID;
+
+namespace {
+
+    constexpr uint8_t IL = ConstrainedPID::Integral_Limit;
+    constexpr uint8_t DOM = ConstrainedPID::Derivative_On_Measurement;
+    constexpr uint8_t TI = ConstrainedPID::Trapezoid_Intergral;
+    constexpr uint8_t OF = ConstrainedPID::OutputFilter;
+    constexpr uint8_t CIR = ConstrainedPID::ChangingIntegralRate;
+    constexpr uint8_t DF = ConstrainedPID::DerivativeFilter;
+
+    // DGStandard云台的角度环 / DGStandard gimbal angle loops
+    const test::pid_init_t PITCH_THETA = {12, 0, 10, 6 * PI, 0, 0, 0, 0, 0.1f, 0, OF};
+    const test::pid_init_t YAW_THETA = {7, 0, 50, 4 * PI, 0, 0, 0, 0, 0.15f, 0, OF};
+    // DGStandard拨弹电机的角度环 / DGStandard loader angle loops
+    const test::pid_init_t STEERING_THETA_NORMAL = {20, 0, 0, 2 * PI, 0, 0, 0, 0, 0.1f, 0, OF};
+    const test::pid_init_t STEERING_THETA_FAST = {25, 0, 0, 4 * PI, 0, 0, 0, 0, 0.1f, 0, OF};
+    const test::pid_init_t STEERING_THETA_BURST = {30, 0, 0, 5 * PI, 0, 0, 0, 0, 0.1f, 0, OF};
+    // DGStandard云台的速度环 / DGStandard gimbal speed loops
+    const test::pid_init_t PITCH_OMEGA = {
+        8192, 0, 0, 16384, 4000, 0, 1.5 * PI, 1 * PI, 0.1f, 0, IL | OF | TI | CIR | DOM | DF};
+    const test::pid_init_t YAW_OMEGA = {
+        6000, 0, 0, 16384, 2000, 0, 0.5 * PI, 0.5 * PI, 0.03f, 0.1f, IL | OF | TI | CIR | DOM | DF};
+    // DGStandard底盘和拨弹电机的速度环，拨弹电机原本还开了PID<>不支持的异常处理
+    // DGStandard chassis and loader speed loops, the loader also had error handling, which PID<>
+    // does not support
+    const test::pid_init_t CHASSIS_OMEGA = {
+        2500, 3, 0, 30000, 10000, 0, 3 * PI, 2 * PI, 0.1f, 0, IL | OF | TI | CIR};
+    const test::pid_init_t STEERING_OMEGA = {
+        1000, 1, 0, 10000, 4000, 0, 3 * PI, 2 * PI, 0.1f, 0, IL | OF | TI | CIR};
+    // DGStandard底盘跟随的ConstrainedPID(kp, ki, kd, max_iout, max_out)
+    // the ConstrainedPID(kp, ki, kd, max_iout, max_out) of the DGStandard chassis follow loop
+    const test::pid_init_t CHASSIS_FOLLOW = {4 / (2 * PI), 0, 0, 1, 0.5f, 0, 0, 0, 0, 0, IL};
+
+    // 三种实现同时跑同一个闭环，plant_gain把输出缩放到被控量的量级
+    // the three implementations run the same closed loop, plant_gain scales the output to the
+    // magnitude of the measurement
+    template <uint8_t... FLAGS>
+    int Compare(const test::pid_init_t& init, float plant_gain, test::Random* random) {
+        PID<FLAGS...> pid(init);
+        ConstrainedPID runtime(init);
+        legacy::ConstrainedPID legacy(test::ToLegacy(init));
+        test::Plant plant(plant_gain);
+        int mismatches = 0;
+        for (int step = 0; step < 2000; ++step) {
+            const float target = test::Target(random, step);
+            const float measure = plant.Value();
+            const float output = pid.ComputeOutput(target, measure);
+            const float expected = runtime.ComputeOutput(target, measure);
+            const float old = legacy.ComputeOutput(target, measure);
+            if (!test::SameBits(output, expected) || !test::SameBits(output, old) ||
+                !test::SameBits(pid.State(), runtime.State()) ||
+                !test::SameBits(pid.State(), legacy.State()))
+                ++mismatches;
+            plant.Step(output);
+            if (step == 700) {
+                pid.ResetIntegral();
+                runtime.ResetIntegral();
+                legacy.ResetIntegral();
+            } else if (step == 1200) {
+                pid.ChangeMax(init.max_iout / 2, init.max_out / 2);
+                runtime.ChangeMax(init.max_iout / 2, init.max_out / 2);
+                legacy.ChangeMax(init.max_iout / 2, init.max_out / 2);
+            } else if (step == 1600) {
+                pid.Reinit(init);
+                runtime.Reinit(init);
+                legacy.Reinit(test::ToLegacy(init));
+            }
+        }
+        return mismatches;
+    }
+
+    // 实际参数跑一次，再随机参数跑多次 / once with the actual parameters, then with random ones
+    template <uint8_t... FLAGS>
+    void TestMode(const char* name, const test::pid_init_t& init, float plant_gain) {
+        constexpr uint8_t MODE = PID<FLAGS...>::MODE;
+        CHECK(init.mode == MODE);
+        test::Random random(MODE + 1);
+        int mismatches = Compare<FLAGS...>(init, plant_gain, &random);
+        for (int trial = 0; trial < 50; ++trial)
+            mismatches +=
+                Compare<FLAGS...>(test::RandomPIDInit(&random, MODE), plant_gain, &random);
+        printf("%-24s %d mismatches\n", name, mismatches);
+        CHECK(mismatches == 0);
+    }
+
+    template <uint8_t... FLAGS>
+    void Benchmark(const char* name, const test::pid_init_t& init) {
+        const long calls = 2000000;
+        PID<FLAGS...> pid(init);
+        ConstrainedPID runtime(init);
+        legacy::ConstrainedPID legacy(test::ToLegacy(init));
+        char label[64];
+        float measure = 0, output = 0;
+        test::Stopwatch stopwatch;
+        for (long i = 0; i < calls; ++i) {
+            measure += 1e-6f;
+            output += legacy.ComputeOutput(10, measure);
+        }
+        snprintf(label, sizeof(label), "%s, old", name);
+        test::Report(label, stopwatch, calls);
+        stopwatch.Restart();
+        for (long i = 0; i < calls; ++i) {
+            measure += 1e-6f;
+            output += runtime.ComputeOutput(10, measure);
+        }
+        snprintf(label, sizeof(label), "%s, ConstrainedPID", name);
+        test::Report(label, stopwatch, calls);
+        stopwatch.Restart();
+        for (long i = 0; i < calls; ++i) {
+            measure += 1e-6f;
+            output += pid.ComputeOutput(10, measure);
+        }
+        snprintf(label, sizeof(label), "%s, PID<>", name);
+        test::Report(label, stopwatch, calls);
+        test::Consume(output);
+    }
+
+}  // namespace
+
+int main() {
+    TestMode<OF>("pitch angle loop", PITCH_THETA, 1);
+    TestMode<OF>("yaw angle loop", YAW_THETA, 1);
+    TestMode<OF>("loader angle loop", STEERING_THETA_NORMAL, 1);
+    TestMode<OF>("loader fast angle loop", STEERING_THETA_FAST, 1);
+    TestMode<OF>("loader burst angle loop", STEERING_THETA_BURST, 1);
+    TestMode<IL, OF, TI, CIR, DOM, DF>("pitch speed loop", PITCH_OMEGA, 0.001f);
+    TestMode<IL, OF, TI, CIR, DOM, DF>("yaw speed loop", YAW_OMEGA, 0.001f);
+    TestMode<IL, OF, TI, CIR>("chassis speed loop", CHASSIS_OMEGA, 0.001f);
+    TestMode<IL, OF, TI, CIR>("loader speed loop", STEERING_OMEGA, 0.001f);
+    TestMode<IL>("chassis follow loop", CHASSIS_FOLLOW, 10);
+    TestMode<>("no flags", test::pid_init_t{10, 0.1f, 1, 100, 10, 0, 0, 0, 0, 0, 0}, 0.01f);
+
+    printf("benchmark:\n");
+    Benchmark<OF>("angle loop", PITCH_THETA);
+    Benchmark<IL, OF, TI, CIR>("chassis speed loop", CHASSIS_OMEGA);
+    Benchmark<IL, OF, TI, CIR, DOM, DF>("gimbal speed loop", YAW_OMEGA);
+    return test::Finish();
+}
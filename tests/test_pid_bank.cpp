@@ -0,0 +1,151 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// PIDBank与逐个调用ConstrainedPID的等价性测试，以及1到32个控制器时的耗时对比
+// equivalence of PIDBank with calling ConstrainedPID one by one, and their cost for 1 to 32
+// controllers
+
+#include "pid_bank.h"
+#include "pid_cases.h"
+
+using control::ConstrainedPID;
+using control::MAX_PID_BANK_SIZE;
+using control::PIDBank;
+
+// PIDBank不支持异常处理 / PIDBank does not support error handling
+static const uint8_t BANK_MODES = 0xff & ~ConstrainedPID::ErrorHandle;
+
+// 每个槽位的输出和状态都与ConstrainedPID以及改动之前的实现逐位相同
+// every slot matches ConstrainedPID and the implementation before the change bit for bit
+static void TestEquivalence() {
+    test::Random random(1);
+    int mismatches = 0, legacy_mismatches = 0;
+    for (int trial = 0; trial < 256; ++trial) {
+        const int n = 1 + trial % MAX_PID_BANK_SIZE;
+        PIDBank bank;
+        ConstrainedPID pids[MAX_PID_BANK_SIZE];
+        legacy::ConstrainedPID legacy_pids[MAX_PID_BANK_SIZE];
+        test::Plant plants[MAX_PID_BANK_SIZE];
+        for (int i = 0; i < n; ++i) {
+            const test::pid_init_t init = test::RandomPIDInit(&random, random.Next() & BANK_MODES);
+            legacy_pids[i] = legacy::ConstrainedPID(test::ToLegacy(init));
+            pids[i] = ConstrainedPID(init);
+            CHECK(bank.Add(init) == i);
+        }
+        CHECK(bank.Size() == n);
+        for (int step = 0; step < 500; ++step) {
+            float target[MAX_PID_BANK_SIZE], measure[MAX_PID_BANK_SIZE];
+            float output[MAX_PID_BANK_SIZE];
+            for (int i = 0; i < n; ++i) {
+                target[i] = test::Target(&random, step);
+                measure[i] = plants[i].Value();
+            }
+            // 两种输入方式轮流使用 / both ways of feeding the bank take turns
+            if (step % 2 == 0) {
+                bank.Update(target, measure, output);
+            } else {
+                for (int i = 0; i < n; ++i)
+                    bank.SetInput(i, target[i], measure[i]);
+                bank.Update();
+                for (int i = 0; i < n; ++i)
+                    output[i] = bank.Output(i);
+            }
+            for (int i = 0; i < n; ++i) {
+                const float expected = pids[i].ComputeOutput(target[i], measure[i]);
+                const float legacy = legacy_pids[i].ComputeOutput(target[i], measure[i]);
+                if (!test::SameBits(output[i], expected) ||
+                    !test::SameBits(bank.State(i), pids[i].State()))
+                    ++mismatches;
+                if (!test::SameBits(expected, legacy) ||
+                    !test::SameBits(pids[i].State(), legacy_pids[i].State()))
+                    ++legacy_mismatches;
+                plants[i].Step(output[i]);
+            }
+            if (step == 250) {
+                const int slot = random.Next() % n;
+                bank.ResetIntegral(slot);
+                pids[slot].ResetIntegral();
+                legacy_pids[slot].ResetIntegral();
+            }
+        }
+    }
+    printf("bank vs ConstrainedPID: %d mismatches, ConstrainedPID vs old: %d mismatches\n",
+           mismatches, legacy_mismatches);
+    CHECK(mismatches == 0);
+    CHECK(legacy_mismatches == 0);
+}
+
+// 底盘速度环的参数 / the chassis speed loop parameters
+static const test::pid_init_t CHASSIS_OMEGA = {
+    .kp = 2500,
+    .ki = 3,
+    .kd = 0,
+    .max_out = 30000,
+    .max_iout = 10000,
+    .deadband = 0,
+    .A = 3 * PI,
+    .B = 2 * PI,
+    .output_filtering_coefficient = 0.1,
+    .derivative_filtering_coefficient = 0,
+    .mode = ConstrainedPID::Integral_Limit | ConstrainedPID::OutputFilter |
+            ConstrainedPID::Trapezoid_Intergral | ConstrainedPID::ChangingIntegralRate,
+};
+
+static void Benchmark() {
+    printf("benchmark, chassis speed loop parameters, one update of all controllers:\n");
+    const int sizes[] = {1, 2, 4, 8, 16, 32};
+    const long calls = 200000;
+    for (int n : sizes) {
+        PIDBank bank;
+        ConstrainedPID pids[MAX_PID_BANK_SIZE];
+        float target[MAX_PID_BANK_SIZE], measure[MAX_PID_BANK_SIZE], output[MAX_PID_BANK_SIZE];
+        for (int i = 0; i < n; ++i) {
+            bank.Add(CHASSIS_OMEGA);
+            pids[i] = ConstrainedPID(CHASSIS_OMEGA);
+            target[i] = i;
+            measure[i] = 0;
+        }
+        char name[64];
+        test::Stopwatch stopwatch;
+        for (long k = 0; k < calls; ++k) {
+            measure[k % n] += 1e-3f;
+            bank.Update(target, measure, output);
+            test::Consume(output);
+        }
+        snprintf(name, sizeof(name), "PIDBank, %d controllers", n);
+        test::Report(name, stopwatch, calls);
+
+        stopwatch.Restart();
+        for (long k = 0; k < calls; ++k) {
+            measure[k % n] += 1e-3f;
+            for (int i = 0; i < n; ++i)
+                output[i] = pids[i].ComputeOutput(target[i], measure[i]);
+            test::Consume(output);
+        }
+        snprintf(name, sizeof(name), "ConstrainedPID, %d controllers", n);
+        test::Report(name, stopwatch, calls);
+    }
+}
+
+int main() {
+    TestEquivalence();
+    Benchmark();
+    return test::Finish();
+}
@@ -0,0 +1,253 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// ConstrainedPID按实际时间间隔计算的测试：在电机速度环的仿真上，参数按1kHz整定，500Hz、1kHz、
+// 2kHz和抖动的控制周期下闭环响应一致，不设整定周期时与旧的按调用次数计算的实现逐位相同，以及
+// 第一次调用、dt异常和时间戳溢出的处理
+// tests of the dt aware ConstrainedPID: on a simulated motor speed loop with gains tuned at 1 kHz,
+// the closed loop response is the same at 500 Hz, 1 kHz, 2 kHz and with a jittery period, without
+// a tuned period it is bit identical to the old per call implementation, and the first call, dt
+// outliers and timestamp wrap around are handled
+
+#include <math.h>
+
+#include <vector>
+
+#include "pid_cases.h"
+
+using control::ConstrainedPID;
+
+namespace {
+
+    constexpr float TUNED_PERIOD = 0.001f;
+    constexpr double SIM_STEP = 1e-5;  // 电机模型的积分步长 [s] / motor model integration step [s]
+    constexpr double DURATION = 0.6;
+    // 各频率共同的记录时刻 / record times common to all rates
+    constexpr double RECORD_PERIOD = 0.002;
+
+    // 电流控制的电机速度，时间常数50ms，0.2s后加上负载
+    // speed of a current controlled motor with a 50 ms time constant, a load is applied at 0.2 s
+    class Motor {
+      public:
+        void Step(float current, double dt) {
+            const double load = time_ >= 0.2 ? 150.0 : 0.0;
+            omega_ += (0.06 * current - load - 20.0 * omega_) * dt;
+            time_ += dt;
+        }
+
+        float Omega() const {
+            return (float)omega_;
+        }
+
+        double Time() const {
+            return time_;
+        }
+
+      private:
+        double omega_ = 0;
+        double time_ = 0;
+    };
+
+    ConstrainedPID SpeedLoop(bool dt_aware) {
+        // 1kHz下整定的参数 / gains tuned at 1 kHz
+        ConstrainedPID pid(40, 5, 200, 10000, 16384);
+        if (dt_aware)
+            pid.SetControlPeriod(TUNED_PERIOD);
+        return pid;
+    }
+
+    // 控制周期由period(n)给出，输出保持到下一次计算，目标为20rad/s的阶跃
+    // the control period comes from period(n), the output holds until the next update, the target
+    // is a 20 rad/s step
+    template <typename Period>
+    std::vector<float> Run(bool dt_aware, Period period) {
+        ConstrainedPID pid = SpeedLoop(dt_aware);
+        Motor motor;
+        std::vector<float> record;
+        uint32_t timestamp_us = 0xFFFFFFFF - 100000;  // 运行中途溢出 / wraps mid run
+        double next_record = 0;
+        for (int n = 0; motor.Time() < DURATION; ++n) {
+            const float output = pid.ComputeOutputWithTimestamp(20, motor.Omega(), timestamp_us);
+            const double dt = period(n);
+            const int steps = (int)lround(dt / SIM_STEP);
+            for (int i = 0; i < steps; ++i) {
+                if (motor.Time() >= next_record - SIM_STEP / 2) {
+                    record.push_back(motor.Omega());
+                    next_record += RECORD_PERIOD;
+                }
+                motor.Step(output, SIM_STEP);
+            }
+            timestamp_us += (uint32_t)lround(dt * 1e6);
+        }
+        return record;
+    }
+
+    std::vector<float> RunAt(bool dt_aware, float rate) {
+        return Run(dt_aware, [rate](int) {
+            return 1.0 / rate;
+        });
+    }
+
+    double RmsDifference(const std::vector<float>& a, const std::vector<float>& b) {
+        const size_t n = a.size() < b.size() ? a.size() : b.size();
+        double sum = 0;
+        for (size_t i = 0; i < n; ++i)
+            sum += (a[i] - b[i]) * (a[i] - b[i]);
+        return sqrt(sum / n);
+    }
+
+}  // namespace
+
+// 参数按1kHz整定，500Hz和2kHz下的响应与1kHz相同，不按时间计算时积分和微分的强度随频率变化
+// gains tuned at 1 kHz give the 1 kHz response at 500 Hz and 2 kHz, while counting per call
+// changes the integral and derivative strength with the rate
+static void TestRates() {
+    const std::vector<float> reference = RunAt(true, 1000);
+    printf("rates, rms difference to 1 kHz [rad/s]:\n");
+    for (float rate : {500.0f, 2000.0f}) {
+        const double aware = RmsDifference(RunAt(true, rate), reference);
+        const double legacy = RmsDifference(RunAt(false, rate), reference);
+        printf("  %4.0f Hz: dt aware %.4f, per call %.4f\n", rate, aware, legacy);
+        CHECK(aware < 0.05);
+        CHECK(aware * 5 < legacy);
+    }
+    // 1kHz下两种方式只差第一次调用的微分冲击 / at 1 kHz both ways only differ by the derivative
+    // kick on the first call
+    const double same = RmsDifference(RunAt(false, 1000), reference);
+    printf("  1000 Hz: per call %.4f\n", same);
+    CHECK(same < 0.1);
+    // 最后应跟上目标，负载被积分项抵消 / the target is reached in the end, the load is cancelled by
+    // the integral
+    CHECK_NEAR(reference.back(), 20, 0.2);
+}
+
+// osDelay造成的周期抖动（0.6到1.4倍）下响应仍与固定周期相同
+// with the period jittering between 0.6 and 1.4 times, as osDelay does, the response still
+// matches the fixed period
+static void TestJitter() {
+    const std::vector<float> reference = RunAt(true, 1000);
+    test::Random random(1);
+    std::vector<double> periods;
+    for (int n = 0; n < 2000; ++n)
+        periods.push_back(round(random.Uniform(0.6f, 1.4f) * 100) * 1e-5);
+    auto jitter = [&periods](int n) {
+        return periods[n];
+    };
+    const double aware = RmsDifference(Run(true, jitter), reference);
+    const double legacy = RmsDifference(Run(false, jitter), reference);
+    printf("jitter: rms difference dt aware %.4f, per call %.4f\n", aware, legacy);
+    CHECK(aware < 0.05);
+    CHECK(aware * 5 < legacy);
+}
+
+// 不设整定周期时带dt的版本忽略dt，与旧的实现逐位相同
+// without a tuned period the dt overload ignores dt and is bit identical to the old implementation
+static void TestLegacy() {
+    test::Random random(2);
+    int mismatches = 0;
+    for (int trial = 0; trial < 50; ++trial) {
+        const test::pid_init_t init = test::RandomPIDInit(&random, random.Next() & 0x7F);
+        ConstrainedPID pid(init);
+        legacy::ConstrainedPID legacy(test::ToLegacy(init));
+        test::Plant plant(1e-3f);
+        for (int step = 0; step < 1000; ++step) {
+            const float target = test::Target(&random, step);
+            const float dt = random.Uniform(0, 0.01f);
+            const float output = pid.ComputeOutput(target, plant.Value(), dt);
+            if (!test::SameBits(output, legacy.ComputeOutput(target, plant.Value())))
+                ++mismatches;
+            plant.Step(output);
+        }
+    }
+    printf("legacy: %d mismatches\n", mismatches);
+    CHECK(mismatches == 0);
+}
+
+// 第一次调用和dt异常时跳过微分，积分按整定周期计算；时间戳溢出得到正确的dt
+// the first call and dt outliers skip the derivative and integrate one tuned period, timestamps
+// that wrap around give the right dt
+static void TestOutliers() {
+    // 只有微分项：第一次调用没有微分冲击 / derivative only: no kick on the first call
+    ConstrainedPID derivative(0, 0, 100, 0, 1e6f);
+    derivative.SetControlPeriod(TUNED_PERIOD);
+    CHECK(derivative.ComputeOutput(10, 0, TUNED_PERIOD) == 0);
+    CHECK_NEAR(derivative.ComputeOutput(10, 1, TUNED_PERIOD), -100, 1e-3);
+    // 2倍周期时微分减半 / twice the period halves the derivative
+    CHECK_NEAR(derivative.ComputeOutput(10, 2, 2 * TUNED_PERIOD), -50, 1e-3);
+    // 任务卡住0.1s后跳过一次微分 / after a 0.1 s stall the derivative is skipped once
+    CHECK(derivative.ComputeOutput(10, 7, 0.1f) == 0);
+    CHECK_NEAR(derivative.ComputeOutput(10, 8, TUNED_PERIOD), -100, 1e-3);
+    // Reset之后又是第一次调用 / after Reset it is the first call again
+    derivative.Reset();
+    CHECK(derivative.ComputeOutput(10, 0, TUNED_PERIOD) == 0);
+
+    // 只有积分项：dt异常时只积分一个整定周期 / integral only: an outlier integrates one tuned
+    // period
+    ConstrainedPID integral(0, 1, 0, 1e6f, 1e6f);
+    integral.SetControlPeriod(TUNED_PERIOD);
+    CHECK_NEAR(integral.ComputeOutput(1, 0, TUNED_PERIOD), 1, 1e-6);
+    CHECK_NEAR(integral.ComputeOutput(1, 0, 2 * TUNED_PERIOD), 3, 1e-6);
+    CHECK_NEAR(integral.ComputeOutput(1, 0, 0.5f), 4, 1e-6);
+    CHECK_NEAR(integral.ComputeOutput(1, 0, 0), 5, 1e-6);
+    CHECK_NEAR(integral.ComputeOutput(1, 0, -TUNED_PERIOD), 6, 1e-6);
+
+    // 时间戳溢出 / timestamp wrap around
+    ConstrainedPID stamped(0, 1, 0, 1e6f, 1e6f);
+    stamped.SetControlPeriod(TUNED_PERIOD);
+    CHECK_NEAR(stamped.ComputeOutputWithTimestamp(1, 0, 0xFFFFFC00), 1, 1e-6);
+    CHECK_NEAR(stamped.ComputeOutputWithTimestamp(1, 0, 0x000003D0), 3, 1e-3);
+    printf("outliers: done\n");
+}
+
+static void Benchmark() {
+    const long calls = 2000000;
+    ConstrainedPID per_call = SpeedLoop(false);
+    ConstrainedPID aware = SpeedLoop(true);
+    float measure = 0, output = 0;
+    printf("benchmark:\n");
+    test::Stopwatch stopwatch;
+    for (long i = 0; i < calls; ++i) {
+        measure += 1e-6f;
+        output += per_call.ComputeOutput(20, measure);
+    }
+    test::Report("ComputeOutput", stopwatch, calls);
+    stopwatch.Restart();
+    for (long i = 0; i < calls; ++i) {
+        measure += 1e-6f;
+        output += aware.ComputeOutput(20, measure, TUNED_PERIOD);
+    }
+    test::Report("ComputeOutput with dt", stopwatch, calls);
+    stopwatch.Restart();
+    for (long i = 0; i < calls; ++i) {
+        measure += 1e-6f;
+        output += aware.ComputeOutputWithTimestamp(20, measure, (uint32_t)i * 1000);
+    }
+    test::Report("ComputeOutputWithTimestamp", stopwatch, calls);
+    test::Consume(output);
+}
+
+int main() {
+    TestRates();
+    TestJitter();
+    TestLegacy();
+    TestOutliers();
+    Benchmark();
+    return test::Finish();
+}
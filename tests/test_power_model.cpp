@@ -0,0 +1,322 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// PowerModel的功率限制仿真：四个M3508驱动的底盘在60W限制下跑合成的工况（全速、刹车、倒车、
+// 原地旋转），裁判系统延迟报告平均功率并在超功率时消耗缓冲能量。与不限制和原来按电流限制的
+// PowerLimit对比，另外检查求解的比例和在线辨识，以及每次调用的耗时
+// power limit simulation of PowerModel: a chassis on four M3508 runs a synthetic cycle (full
+// speed, braking, reversing, spinning) under a 60 W limit, the referee reports the average power
+// late and drains the buffer energy above the limit. Compared with no limit and the current
+// based PowerLimit, plus checks of the solved scale and the online identification, and the cost
+// of the calls
+
+#include <math.h>
+
+#include <deque>
+#include <initializer_list>
+
+#include "power_limit.h"
+#include "power_model.h"
+#include "test.h"
+
+using control::POWER_MODEL_3508_INIT;
+using control::PowerLimit;
+using control::PowerModel;
+using control::power_limit_t;
+
+namespace {
+
+    constexpr double CONTROL_DT = 0.001;
+    constexpr double DURATION = 30.0;
+    constexpr int MOTORS = 4;
+    constexpr float POWER_LIMIT = 60;  // [W]
+
+    // 被控对象 / plant
+    constexpr double KT = 0.3 / 19.2;  // 转子的转矩常数 / rotor torque constant [N m/A]
+    // 每个轮子折算到转子 / per wheel, reflected to the rotor [kg m^2]
+    constexpr double INERTIA = 20.0 / 4 * (0.076 / 19.2) * (0.076 / 19.2) + 1.5e-5;
+    constexpr double VISCOUS = 2e-5;      // [N m s/rad]
+    constexpr double MAX_CURRENT = 20.0;  // [A]
+    constexpr double RAW_PER_AMPERE = 16384 / 20.0;
+    // 实际电机的k1、k2、k3、p0，以及没有建模的随|I|增长的开关损耗
+    // k1, k2, k3, p0 of the real motors, and switching losses growing with |I| left unmodelled
+    constexpr double TRUE_K[4] = {0.45, KT, 8e-6, 2.0};
+    constexpr double UNMODELLED = 0.4;  // [W/A]
+
+    // 裁判系统 / referee
+    constexpr double REFEREE_PERIOD = 0.1;  // [s]
+    constexpr double REFEREE_DELAY = 0.02;  // [s]
+    constexpr double BUFFER_MAX = 60.0;     // [J]
+
+    // 速度环PI，单位为[A]每[rad/s] / speed loop PI in [A] per [rad/s]
+    constexpr double SPEED_KP = 0.08;
+    constexpr double SPEED_KI = 0.002;
+
+    enum scheme_t { NONE, CURRENT, MODEL };
+    const char* const SCHEME_NAMES[] = {"none", "current", "model"};
+
+    // 四个轮子的转子转速目标 / rotor speed targets of the four wheels [rad/s]
+    void Targets(double t, float target[MOTORS]) {
+        const float full = 900;
+        float v;
+        const double phase = fmod(t - 0.5, 10.0);
+        if (t < 0.5)
+            v = 0;
+        else if (phase < 3)
+            v = full;
+        else if (phase < 4)
+            v = 0;
+        else if (phase < 6)
+            v = -full;
+        else if (phase < 7)
+            v = 0.3f * full;
+        else
+            v = 0;
+        // 左侧轮子镜像安装，原地旋转时所有轮子同向
+        // the left wheels are mirrored, spinning in place turns all wheels the same way
+        const bool spin = t >= 0.5 && phase >= 7;
+        for (int i = 0; i < MOTORS; ++i)
+            target[i] = spin ? 0.8f * full : (i < 2 ? v : -v);
+    }
+
+    double TruePower(const float* current, const float* omega) {
+        double power = 0;
+        for (int i = 0; i < MOTORS; ++i)
+            power += TRUE_K[0] * current[i] * current[i] + TRUE_K[1] * current[i] * omega[i] +
+                     TRUE_K[2] * omega[i] * omega[i] + TRUE_K[3] + UNMODELLED * fabs(current[i]);
+        return power;
+    }
+
+    typedef struct {
+        double rms;         // 转速误差 / speed error [rad/s]
+        double min_buffer;  // [J]
+        double below_zero;  // 缓冲能量低于0的时间 / time with the buffer below 0 [s]
+        float k[4];
+    } result_t;
+
+    typedef struct {
+        double time;
+        float power;
+        float buffer;
+    } report_t;
+
+    result_t Simulate(scheme_t scheme) {
+        test::Random random(1);
+        float omega[MOTORS] = {0, 0, 0, 0};
+        double integral[MOTORS] = {0, 0, 0, 0};
+        PowerLimit limiter(MOTORS);
+        const power_limit_t limit_info = {POWER_LIMIT, POWER_LIMIT * 0.9f, 50, 3500.0f * MOTORS,
+                                          5000.0f * MOTORS / 80 * POWER_LIMIT};
+        PowerModel model(MOTORS, POWER_MODEL_3508_INIT);
+
+        double buffer = BUFFER_MAX, window_energy = 0, window_time = 0;
+        std::deque<report_t> reports;
+        float referee_power = 0, referee_buffer = BUFFER_MAX;
+        double next_report = REFEREE_PERIOD, tracked = 0;
+        result_t result = {0, BUFFER_MAX, 0, {0, 0, 0, 0}};
+
+        const int steps = DURATION / CONTROL_DT;
+        for (int k = 0; k < steps; ++k) {
+            const double t = k * CONTROL_DT;
+            while (!reports.empty() && reports.front().time <= t) {
+                referee_power = reports.front().power;
+                referee_buffer = reports.front().buffer;
+                reports.pop_front();
+                if (scheme == MODEL)
+                    model.Identify(referee_power);
+            }
+
+            float target[MOTORS], command[MOTORS], current[MOTORS];
+            Targets(t, target);
+            for (int i = 0; i < MOTORS; ++i) {
+                const double error = target[i] - omega[i];
+                integral[i] = fmin(fmax(integral[i] + SPEED_KI * error, -MAX_CURRENT),
+                                   MAX_CURRENT);
+                command[i] = fmin(fmax(SPEED_KP * error + integral[i], -MAX_CURRENT),
+                                  MAX_CURRENT);
+            }
+
+            if (scheme == CURRENT) {
+                float raw[MOTORS], limited[MOTORS];
+                for (int i = 0; i < MOTORS; ++i)
+                    raw[i] = command[i] * RAW_PER_AMPERE;
+                limiter.Output(true, limit_info, referee_power, referee_buffer, raw, limited);
+                for (int i = 0; i < MOTORS; ++i)
+                    current[i] = limited[i] / RAW_PER_AMPERE;
+            } else if (scheme == MODEL) {
+                const float scale =
+                    model.Scale(command, omega, model.Budget(POWER_LIMIT, referee_buffer));
+                for (int i = 0; i < MOTORS; ++i)
+                    current[i] = command[i] * scale;
+                model.Accumulate(current, omega);
+            } else {
+                for (int i = 0; i < MOTORS; ++i)
+                    current[i] = command[i];
+            }
+
+            const double power = TruePower(current, omega) + random.Normal(0.5f);
+            for (int i = 0; i < MOTORS; ++i) {
+                const double torque = KT * current[i] - VISCOUS * omega[i];
+                omega[i] += torque / INERTIA * CONTROL_DT;
+            }
+
+            // 超过限制时消耗缓冲能量，低于限制时恢复
+            // the buffer drains above the limit and refills below it
+            buffer = fmin(BUFFER_MAX, buffer - (power - POWER_LIMIT) * CONTROL_DT);
+            result.min_buffer = fmin(result.min_buffer, buffer);
+            if (buffer < 0) {
+                result.below_zero += CONTROL_DT;
+                buffer = 0;
+            }
+            window_energy += power * CONTROL_DT;
+            window_time += CONTROL_DT;
+            if (t + CONTROL_DT >= next_report) {
+                reports.push_back({t + REFEREE_DELAY, (float)(window_energy / window_time),
+                                   (float)buffer});
+                window_energy = window_time = 0;
+                next_report += REFEREE_PERIOD;
+            }
+
+            for (int i = 0; i < MOTORS; ++i)
+                tracked += (omega[i] - target[i]) * (omega[i] - target[i]) * CONTROL_DT;
+        }
+        result.rms = sqrt(tracked / DURATION / MOTORS);
+        model.GetCoefficients(result.k);
+        return result;
+    }
+
+}  // namespace
+
+// 不限制时缓冲能量会耗尽，两种限制方式都不会；模型预测功率，少用缓冲能量的同时转速误差
+// 更小，辨识出的铜损和转矩常数接近真实值
+// without a limit the buffer runs out and with either limit it does not; predicting the power
+// the model keeps more of the buffer with a smaller speed error, and identifies copper loss and
+// torque constant close to the real ones
+static void TestCycle() {
+    printf("power limit %.0f W, true k = %.3g %.3g %.3g %.3g\n", POWER_LIMIT, TRUE_K[0],
+           TRUE_K[1], TRUE_K[2], TRUE_K[3]);
+    printf("%-10s %18s %16s %16s\n", "scheme", "rms error [rad/s]", "min buffer [J]",
+           "below 0 J [s]");
+    result_t results[3];
+    for (scheme_t scheme : {NONE, CURRENT, MODEL}) {
+        const result_t& r = results[scheme] = Simulate(scheme);
+        printf("%-10s %18.1f %16.1f %16.2f\n", SCHEME_NAMES[scheme], r.rms, r.min_buffer,
+               r.below_zero);
+    }
+    const float* k = results[MODEL].k;
+    printf("identified k = %.3g %.3g %.3g %.3g\n", k[0], k[1], k[2], k[3]);
+    CHECK(results[NONE].below_zero > 1);
+    CHECK(results[CURRENT].below_zero == 0);
+    CHECK(results[MODEL].below_zero == 0);
+    CHECK(results[MODEL].min_buffer > results[CURRENT].min_buffer);
+    CHECK(results[MODEL].rms < results[CURRENT].rms);
+    CHECK_NEAR(k[0], TRUE_K[0], 0.1 * TRUE_K[0]);
+    CHECK_NEAR(k[1], TRUE_K[1], 0.1 * TRUE_K[1]);
+}
+
+// 求出的比例让预测功率正好等于预算，预算内不缩小；没有未建模项时辨识收敛到真实系数
+// the solved scale puts the predicted power right at the budget and is 1 within it; without
+// unmodelled terms the identification converges to the real coefficients
+static void TestScaleAndIdentify() {
+    PowerModel model(MOTORS, POWER_MODEL_3508_INIT);
+    const float current[MOTORS] = {15, -12, 8, -18};
+    const float omega[MOTORS] = {400, -300, 500, -200};
+    const float full = model.Predict(current, omega);
+    CHECK(model.Scale(current, omega, full + 1) == 1);
+    const float budget = 0.5f * full;
+    const float scale = model.Scale(current, omega, budget);
+    float scaled[MOTORS];
+    for (int i = 0; i < MOTORS; ++i)
+        scaled[i] = current[i] * scale;
+    CHECK(scale > 0 && scale < 1);
+    CHECK_NEAR(model.Predict(scaled, omega), budget, 1e-3 * full);
+    CHECK(model.Scale(current, omega, 0) == 0);
+    CHECK_NEAR(model.Budget(60, 50), 60 + (50 - 20) / 1.0f, 1e-4);
+    CHECK_NEAR(model.Budget(60, 10), 60, 1e-4);
+
+    test::Random random(2);
+    for (int n = 0; n < 300; ++n) {
+        double energy = 0;
+        for (int s = 0; s < 100; ++s) {
+            float c[MOTORS], w[MOTORS];
+            for (int i = 0; i < MOTORS; ++i) {
+                c[i] = random.Uniform(-20, 20);
+                w[i] = random.Uniform(-900, 900);
+            }
+            model.Accumulate(c, w);
+            for (int i = 0; i < MOTORS; ++i)
+                energy += TRUE_K[0] * c[i] * c[i] + TRUE_K[1] * c[i] * w[i] +
+                          TRUE_K[2] * w[i] * w[i] + TRUE_K[3];
+        }
+        model.Identify(energy / 100);
+    }
+    float k[4];
+    model.GetCoefficients(k);
+    for (int i = 0; i < 4; ++i)
+        CHECK_NEAR(k[i], TRUE_K[i], 0.01 * TRUE_K[i]);
+}
+
+// 关闭功率限制时PowerLimit原样输出 / PowerLimit passes the input through when switched off
+static void TestLimitSwitch() {
+    PowerLimit limiter(MOTORS);
+    const power_limit_t info = {POWER_LIMIT, POWER_LIMIT * 0.9f, 50, 3500.0f * MOTORS,
+                                5000.0f * MOTORS / 80 * POWER_LIMIT};
+    float input[MOTORS] = {16000, -16000, 16000, -16000}, output[MOTORS];
+    limiter.Output(false, info, 100, 0, input, output);
+    for (int i = 0; i < MOTORS; ++i)
+        CHECK(output[i] == input[i]);
+    limiter.Output(true, info, 100, 0, input, output);
+    for (int i = 0; i < MOTORS; ++i)
+        CHECK(fabsf(output[i]) < fabsf(input[i]));
+}
+
+static void Benchmark() {
+    PowerModel model(MOTORS, POWER_MODEL_3508_INIT);
+    test::Random random(3);
+    const int N = 1 << 16;
+    float current[MOTORS], omega[MOTORS], sum = 0;
+    for (int i = 0; i < MOTORS; ++i) {
+        current[i] = random.Uniform(-20, 20);
+        omega[i] = random.Uniform(-900, 900);
+    }
+    printf("benchmark:\n");
+    test::Stopwatch stopwatch;
+    for (int i = 0; i < N; ++i) {
+        current[i & 3] = random.Uniform(-20, 20);
+        sum += model.Scale(current, omega, model.Budget(POWER_LIMIT, 40));
+        model.Accumulate(current, omega);
+    }
+    test::Report("Budget, Scale and Accumulate", stopwatch, N);
+    stopwatch.Restart();
+    for (int i = 0; i < N; ++i) {
+        model.Accumulate(current, omega);
+        model.Identify(60 + random.Normal(1));
+    }
+    test::Report("Identify", stopwatch, N);
+    test::Consume(sum);
+}
+
+int main() {
+    TestCycle();
+    TestScaleAndIdentify();
+    TestLimitSwitch();
+    Benchmark();
+    return test::Finish();
+}
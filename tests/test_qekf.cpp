@@ -0,0 +1,231 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// 模板卡尔曼滤波器和QEKF与原来的kalman_filter.c、QuaternionEKF.c的等价性测试和耗时对比
+// equivalence of the template Kalman filter and the QEKF with the old kalman_filter.c and
+// QuaternionEKF.c, and their cost per update
+
+#include <math.h>
+
+#include "QEKF.h"
+#include "kalman.h"
+#include "test.h"
+
+extern "C" {
+#include "QuaternionEKF.h"
+}
+
+static const float DT = 0.001f;
+
+// 匀速模型，观测位置 / constant velocity model observing the position
+static void TestLinearEquivalence() {
+    control::KalmanFilter<2, 1> kf;
+    kf.F[0][0] = 1, kf.F[0][1] = DT, kf.F[1][1] = 1;
+    kf.Q[0][0] = 1e-6f, kf.Q[1][1] = 1e-3f;
+    kf.H[0][0] = 1;
+    kf.R[0][0] = 0.01f;
+    kf.P[0][0] = kf.P[1][1] = 1;
+
+    KalmanFilter_t old;
+    Kalman_Filter_Init(&old, 2, 0, 1);
+    const float F[4] = {1, DT, 0, 1}, Q[4] = {1e-6f, 0, 0, 1e-3f}, H[2] = {1, 0}, R[1] = {0.01f};
+    const float P[4] = {1, 0, 0, 1};
+    memcpy(old.F_data, F, sizeof(F));
+    memcpy(old.Q_data, Q, sizeof(Q));
+    memcpy(old.H_data, H, sizeof(H));
+    memcpy(old.R_data, R, sizeof(R));
+    memcpy(old.P_data, P, sizeof(P));
+
+    test::Random random(7);
+    double max_x = 0, max_p = 0;
+    for (int k = 0; k < 5000; ++k) {
+        const float t = k * DT;
+        const float z = sinf(2 * t) + random.Normal(0.1f);
+        kf.Predict();
+        kf.Update(&z);
+        old.MeasuredVector[0] = z;
+        const float* x = Kalman_Filter_Update(&old);
+        for (int i = 0; i < 2; ++i) {
+            max_x = fmax(max_x, fabs(kf.x[i] - x[i]));
+            for (int j = 0; j < 2; ++j)
+                max_p = fmax(max_p, fabs(kf.P[i][j] - old.P_data[i * 2 + j]) /
+                                        fmax(1e-6, fabs(old.P_data[i * 2 + j])));
+        }
+    }
+    printf("linear: max state difference %.3g, max relative covariance difference %.3g\n", max_x,
+           max_p);
+    CHECK(max_x < 1e-4);
+    CHECK(max_p < 1e-3);
+}
+
+// 合成的IMU数据：真实姿态按角速度积分，加上零漂、噪声和一段线加速度
+// synthetic IMU data: the true attitude integrates the rate, with bias, noise and a burst of
+// linear acceleration
+class Motion {
+  public:
+    explicit Motion(uint32_t seed) : random_(seed) {
+    }
+
+    void Step(int k, float gyro[3], float accel[3]) {
+        const double t = k * DT;
+        double w[3] = {0.8 * sin(0.7 * t), 0.6 * sin(1.1 * t + 1), 1.5 * sin(0.3 * t)};
+        // 每15秒中有5秒几乎静止 / nearly still for 5 s out of every 15 s
+        if ((k / 5000) % 3 == 2)
+            for (int i = 0; i < 3; ++i)
+                w[i] *= 0.05;
+        const double a = q_[0], b = q_[1], c = q_[2], d = q_[3];
+        q_[0] += 0.5 * DT * (-b * w[0] - c * w[1] - d * w[2]);
+        q_[1] += 0.5 * DT * (a * w[0] + c * w[2] - d * w[1]);
+        q_[2] += 0.5 * DT * (a * w[1] - b * w[2] + d * w[0]);
+        q_[3] += 0.5 * DT * (a * w[2] + b * w[1] - c * w[0]);
+        const double norm = sqrt(q_[0] * q_[0] + q_[1] * q_[1] + q_[2] * q_[2] + q_[3] * q_[3]);
+        for (int i = 0; i < 4; ++i)
+            q_[i] /= norm;
+        gravity_[0] = 2 * (q_[1] * q_[3] - q_[0] * q_[2]);
+        gravity_[1] = 2 * (q_[0] * q_[1] + q_[2] * q_[3]);
+        gravity_[2] = q_[0] * q_[0] - q_[1] * q_[1] - q_[2] * q_[2] + q_[3] * q_[3];
+        const float bias[3] = {0.004f, -0.003f, 0.002f};
+        for (int i = 0; i < 3; ++i) {
+            accel[i] = 9.8f * gravity_[i] + random_.Normal(0.05f);
+            gyro[i] = w[i] + bias[i] + random_.Normal(0.003f);
+        }
+        if (k % 7000 > 6800)
+            accel[0] += 6;
+    }
+
+    // 四元数q估计的重力方向与真实方向的夹角 / angle between the true gravity direction and the
+    // one given by the estimated quaternion q
+    double TiltError(const float q[4]) const {
+        const double g[3] = {2 * (q[1] * q[3] - q[0] * q[2]), 2 * (q[0] * q[1] + q[2] * q[3]),
+                             q[0] * q[0] - q[1] * q[1] - q[2] * q[2] + q[3] * q[3]};
+        const double cosine = g[0] * gravity_[0] + g[1] * gravity_[1] + g[2] * gravity_[2];
+        return acos(fmin(cosine / sqrt(g[0] * g[0] + g[1] * g[1] + g[2] * g[2]), 1));
+    }
+
+  private:
+    test::Random random_;
+    double q_[4] = {1, 0, 0, 0};
+    double gravity_[3] = {0, 0, 1};
+};
+
+// 关闭在线零漂估计后，新的QEKF与原来的实现是同一个滤波器。卡方检验的门限很紧，舍入误差迟早会
+// 让两边某一次检验的结果不同，之后两边的零漂状态就各自演化，所以逐步比较只在开始的几秒内进行，
+// 整段数据比较两边相对真值的误差
+// with the online bias estimation off the new QEKF is the same filter as the old one. The
+// chi-square gate is tight, so rounding eventually flips one of its decisions on one side and
+// the bias states evolve apart from there; the step by step comparison only covers the first
+// seconds and the whole run compares the error of each side against the truth
+static void TestQEKFEquivalence() {
+    // 静止判定的噪声上限为0时零漂估计器永远不会判定静止，零漂保持为0
+    // a zero noise bound means the bias estimator never sees the IMU still and keeps a zero bias
+    control::gyro_bias_init_t no_bias = control::GYRO_BIAS_DEFAULT_INIT;
+    no_bias.gyro_noise = 0;
+    control::QEKF qekf(nullptr, control::QEKF_DEFAULT_INIT, no_bias);
+    IMU_QuaternionEKF_Init(10, 0.001f, 10000000, 1, 0);
+
+    Motion motion(1);
+    const int N = 60000, STEPWISE = 5000;
+    double max_diff[3] = {}, max_error_new = 0, max_error_old = 0;
+    for (int k = 0; k < N; ++k) {
+        float gyro[3], accel[3];
+        motion.Step(k, gyro, accel);
+        IMU_QuaternionEKF_Update(gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2], DT);
+        qekf.Update(gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2], DT);
+        const float old[3] = {QEKF_INS.Yaw, QEKF_INS.Pitch, QEKF_INS.Roll};
+        if (k < STEPWISE)
+            for (int i = 0; i < 3; ++i) {
+                const double diff = remainder(old[i] - qekf.INS_angle[i], 2 * M_PI);
+                max_diff[i] = fmax(max_diff[i], fabs(diff));
+            }
+        // 等初始的大协方差收敛 / wait for the large initial covariance to converge
+        if (k > 2000) {
+            float q[4];
+            qekf.GetQuaternion(q);
+            max_error_new = fmax(max_error_new, motion.TiltError(q));
+            max_error_old = fmax(max_error_old, motion.TiltError(QEKF_INS.q));
+        }
+    }
+    printf("qekf: max angle difference over %d steps yaw %.3g pitch %.3g roll %.3g rad\n",
+           STEPWISE, max_diff[0], max_diff[1], max_diff[2]);
+    printf("qekf: max tilt error over %d steps new %.3g old %.3g rad\n", N, max_error_new,
+           max_error_old);
+    for (int i = 0; i < 3; ++i)
+        CHECK(max_diff[i] < 2e-4);
+    CHECK(max_error_new < 0.05);
+    CHECK(max_error_new < 1.5 * max_error_old + 0.005);
+}
+
+// 没有全局状态，两个实例互不影响 / no global state, two instances do not interfere
+static void TestInstances() {
+    control::QEKF a(nullptr), b(nullptr);
+    Motion motion_a(1), motion_b(2);
+    float gyro[3], accel[3];
+    for (int k = 0; k < 3000; ++k) {
+        motion_a.Step(k, gyro, accel);
+        a.Update(gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2], DT);
+        motion_b.Step(k, gyro, accel);
+        b.Update(gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2], DT);
+    }
+    control::QEKF c(nullptr);
+    Motion motion_c(1);
+    for (int k = 0; k < 3000; ++k) {
+        motion_c.Step(k, gyro, accel);
+        c.Update(gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2], DT);
+    }
+    for (int i = 0; i < 3; ++i)
+        CHECK(a.INS_angle[i] == c.INS_angle[i]);
+}
+
+static void Benchmark() {
+    const int N = 200000;
+    Motion motion(3);
+    static float gyro[N / 100][3], accel[N / 100][3];
+    for (int k = 0; k < N / 100; ++k)
+        motion.Step(k, gyro[k], accel[k]);
+
+    printf("benchmark:\n");
+    IMU_QuaternionEKF_Init(10, 0.001f, 10000000, 1, 0);
+    test::Stopwatch stopwatch;
+    for (int k = 0; k < N; ++k) {
+        const int i = k % (N / 100);
+        IMU_QuaternionEKF_Update(gyro[i][0], gyro[i][1], gyro[i][2], accel[i][0], accel[i][1],
+                                 accel[i][2], DT);
+    }
+    test::Report("QuaternionEKF.c update", stopwatch, N);
+    test::Consume(QEKF_INS.Yaw);
+
+    control::QEKF qekf(nullptr);
+    stopwatch.Restart();
+    for (int k = 0; k < N; ++k) {
+        const int i = k % (N / 100);
+        qekf.Update(gyro[i][0], gyro[i][1], gyro[i][2], accel[i][0], accel[i][1], accel[i][2],
+                    DT);
+    }
+    test::Report("control::QEKF update", stopwatch, N);
+    test::Consume(qekf.INS_angle);
+}
+
+int main() {
+    TestLinearEquivalence();
+    TestQEKFEquivalence();
+    TestInstances();
+    Benchmark();
+    return test::Finish();
+}
@@ -0,0 +1,504 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// 遥测的测试：按tools/telemetry_receiver.py的方式解码Sample()发出的数据流，检查每个通道的数值、
+// 降采样、通道表、开关和发送缓冲区满的计数，Bandwidth()与实际字节数对比，以及Sample()的耗时。
+// 带--capture <前缀>运行时把Sample()发出的数据流和期望的CSV写入<前缀>.bin和<前缀>.csv，由
+// test_telemetry_receiver.py交给tools/telemetry_receiver.py接收后比较
+// tests of the telemetry: the stream written by Sample() is decoded as
+// tools/telemetry_receiver.py does and checked for the values of every channel, the decimation,
+// the channel table, enabling and the transmit overrun count, Bandwidth() is compared with the
+// bytes actually written, and Sample() is timed. Run with --capture <prefix>, the stream written
+// by Sample() and the CSV expected from it are written to <prefix>.bin and <prefix>.csv, for
+// test_telemetry_receiver.py to receive with tools/telemetry_receiver.py and compare
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "bsp_uart.h"
+#include "bsp_usb.h"
+#include "telemetry.h"
+#include "test.h"
+
+using communication::Telemetry;
+using communication::telemetry_init_t;
+
+namespace {
+
+    constexpr int HEADER_LEN = 4;
+    constexpr int TAIL_LEN = 2;
+    constexpr uint32_t PERIOD_US = 1000;
+
+    typedef struct {
+        uint32_t index;
+        uint32_t mask;
+        std::vector<uint8_t> values;
+    } sample_t;
+
+    typedef struct {
+        int id;
+        int type;
+        int decimation;
+        uint32_t period_us;
+        std::string name;
+    } schema_t;
+
+    // 与接收脚本相同的逐位crc16，不依赖crc_check的查表实现
+    // the bitwise crc16 of the receiver, independent of the tables in crc_check
+    uint16_t Crc16(const uint8_t* data, size_t length) {
+        uint16_t crc = 0xFFFF;
+        for (size_t i = 0; i < length; ++i) {
+            crc ^= data[i];
+            for (int b = 0; b < 8; ++b)
+                crc = crc & 1 ? (crc >> 1) ^ 0x8408 : crc >> 1;
+        }
+        return crc;
+    }
+
+    // Receiver.feed的C++版本，crc不对时跳过一个字节重新找帧头
+    // Receiver.feed in C++, on a crc mismatch it skips one byte and looks for the next header
+    class Receiver {
+      public:
+        std::vector<sample_t> samples;
+        std::vector<schema_t> schemas;
+        int errors = 0;
+        size_t bytes = 0;
+
+        void Feed(const std::vector<uint8_t>& stream) {
+            size_t start = 0;
+            while (start + HEADER_LEN <= stream.size()) {
+                if (stream[start] != 0x55 || stream[start + 1] != 0xAA) {
+                    ++start;
+                    continue;
+                }
+                const uint8_t* frame = stream.data() + start;
+                const size_t length = HEADER_LEN + frame[3] + TAIL_LEN;
+                if (start + length > stream.size())
+                    return;
+                const uint16_t crc = frame[length - 2] | frame[length - 1] << 8;
+                if (Crc16(frame, length - TAIL_LEN) != crc) {
+                    ++errors;
+                    ++start;
+                    continue;
+                }
+                Handle(frame[2], frame + HEADER_LEN, frame[3]);
+                bytes += length;
+                start += length;
+            }
+        }
+
+      private:
+        void Handle(uint8_t type, const uint8_t* payload, size_t length) {
+            if (type == 1) {
+                sample_t sample;
+                memcpy(&sample.index, payload, 4);
+                memcpy(&sample.mask, payload + 4, 4);
+                sample.values.assign(payload + 8, payload + length);
+                samples.push_back(sample);
+            } else if (type == 2) {
+                schema_t schema;
+                uint16_t decimation;
+                schema.id = payload[0];
+                schema.type = payload[1];
+                memcpy(&decimation, payload + 2, 2);
+                schema.decimation = decimation;
+                memcpy(&schema.period_us, payload + 4, 4);
+                schema.name.assign((const char*)payload + 8, length - 8);
+                schemas.push_back(schema);
+            }
+        }
+    };
+
+    // 每种类型一个通道，加上两个降采样的通道 / one channel of every type plus two decimated ones
+    class Channels {
+      public:
+        float f = 0;
+        int32_t i32 = 0;
+        uint32_t u32 = 0;
+        int16_t i16 = 0;
+        uint16_t u16 = 0;
+        int8_t i8 = 0;
+        uint8_t u8 = 0;
+        float slow = 0;
+        float state = 0;
+
+        static constexpr int NUM = 9;
+        static constexpr const char* NAMES[NUM] = {
+            "chassis/vx", "i32",   "u32", "i16", "u16", "i8", "u8", "a_name_longer_than_24_bytes",
+            "pid/state"};
+        static constexpr int TYPES[NUM] = {0, 1, 2, 3, 4, 5, 6, 0, 0};
+        static constexpr int SIZES[NUM] = {4, 4, 4, 2, 2, 1, 1, 4, 4};
+        static constexpr int DECIMATIONS[NUM] = {1, 1, 1, 1, 1, 1, 1, 5, 3};
+
+        // 回调通道返回状态的两倍，能看出确实调用了回调
+        // the getter channel returns twice the state, showing the getter was really called
+        static float Getter(void* args) {
+            return *(float*)args * 2;
+        }
+
+        void Register(Telemetry* telemetry) {
+            CHECK(telemetry->AddChannel(NAMES[0], &f) == 0);
+            CHECK(telemetry->AddChannel(NAMES[1], &i32) == 1);
+            CHECK(telemetry->AddChannel(NAMES[2], &u32) == 2);
+            CHECK(telemetry->AddChannel(NAMES[3], &i16) == 3);
+            CHECK(telemetry->AddChannel(NAMES[4], &u16) == 4);
+            CHECK(telemetry->AddChannel(NAMES[5], &i8) == 5);
+            CHECK(telemetry->AddChannel(NAMES[6], &u8) == 6);
+            CHECK(telemetry->AddChannel(NAMES[7], &slow, DECIMATIONS[7]) == 7);
+            CHECK(telemetry->AddChannel(NAMES[8], Getter, &state, DECIMATIONS[8]) == 8);
+        }
+
+        void Randomize(test::Random* random) {
+            f = random->Normal(100);
+            i32 = (int32_t)random->Next();
+            u32 = (uint32_t)random->Next();
+            i16 = (int16_t)random->Next();
+            u16 = (uint16_t)random->Next();
+            i8 = (int8_t)random->Next();
+            u8 = (uint8_t)random->Next();
+            slow = random->Uniform(-1, 1);
+            state = random->Uniform(-10, 10);
+        }
+
+        // 按通道顺序写出的原始字节 / the raw bytes of every channel, in channel order
+        std::vector<uint8_t> Bytes(uint32_t mask) const {
+            const float value = state * 2;
+            const void* sources[NUM] = {&f, &i32, &u32, &i16, &u16, &i8, &u8, &slow, &value};
+            std::vector<uint8_t> bytes;
+            for (int i = 0; i < NUM; ++i) {
+                if (mask >> i & 1) {
+                    const uint8_t* p = (const uint8_t*)sources[i];
+                    bytes.insert(bytes.end(), p, p + SIZES[i]);
+                }
+            }
+            return bytes;
+        }
+    };
+
+    constexpr const char* Channels::NAMES[];
+    constexpr int Channels::TYPES[];
+    constexpr int Channels::SIZES[];
+    constexpr int Channels::DECIMATIONS[];
+
+    bool Write(const std::string& path, const void* data, size_t size) {
+        FILE* file = fopen(path.c_str(), "wb");
+        if (file == nullptr)
+            return false;
+        const bool written = fwrite(data, 1, size, file) == size;
+        return fclose(file) == 0 && written;
+    }
+
+    telemetry_init_t UartInit(bsp::UART* uart) {
+        telemetry_init_t init = {};
+        init.uart = uart;
+        init.sample_period_us = PERIOD_US;
+        return init;
+    }
+
+}  // namespace
+
+// 写出带坏帧的数据流和tools/telemetry_receiver.py应当写出的CSV：表头在所有通道的通道表都收到
+// 之后写出，之前的采样先缓存，降采样时不到期的通道留空，数值按%g，时间按%.6f秒，坏帧的采样没有
+// 对应的行
+// writes a stream with bad frames and the CSV tools/telemetry_receiver.py should write from it:
+// the header comes once the table of every channel has arrived and the samples before it are
+// buffered, channels not due because of their decimation are left empty, values are printed
+// with %g and the time with %.6f seconds, and the samples of bad frames have no row
+static int Capture(const char* prefix) {
+    bsp::UART uart;
+    Telemetry telemetry(UartInit(&uart));
+    Channels channels;
+    channels.Register(&telemetry);
+    test::Random random(4);
+
+    std::string csv = "index,time_s";
+    for (int i = 0; i < Channels::NUM; ++i)
+        csv += "," + std::string(Channels::NAMES[i]).substr(0, 24);
+    csv += "\n";
+    // 之前的垃圾字节和普通print的文本被跳过 / leading garbage and text of print are skipped
+    const char garbage[] = "\x55 boot\r\n";
+    uart.written.assign(garbage, garbage + sizeof(garbage) - 1);
+    const int N = 64 * Channels::NUM * 2;
+    int corrupted = 0;
+    for (int n = 0; n < N; ++n) {
+        channels.Randomize(&random);
+        const size_t start = uart.written.size();
+        telemetry.Sample();
+        if (n % 97 == 50) {
+            uart.written[start + HEADER_LEN + random.Next() % 8] ^= 0x04;
+            ++corrupted;
+            continue;
+        }
+        const double values[Channels::NUM] = {
+            channels.f,         (double)channels.i32, (double)channels.u32,
+            (double)channels.i16, (double)channels.u16, (double)channels.i8,
+            (double)channels.u8,  channels.slow,        channels.state * 2};
+        char cell[64];
+        snprintf(cell, sizeof(cell), "%d,%.6f", n, (double)(n * PERIOD_US) * 1e-6);
+        csv += cell;
+        for (int i = 0; i < Channels::NUM; ++i) {
+            csv += ",";
+            if (n % Channels::DECIMATIONS[i] == 0) {
+                snprintf(cell, sizeof(cell), "%g", values[i]);
+                csv += cell;
+            }
+        }
+        csv += "\n";
+    }
+
+    if (!Write(std::string(prefix) + ".bin", uart.written.data(), uart.written.size()) ||
+        !Write(std::string(prefix) + ".csv", csv.data(), csv.size())) {
+        printf("cannot write %s.bin and %s.csv\n", prefix, prefix);
+        return 1;
+    }
+    printf("captured %zu bytes, %d samples, %d frames corrupted\n", uart.written.size(), N,
+           corrupted);
+    return 0;
+}
+
+// 每个采样的通道掩码和数值都能原样解出，通道表轮流发送并覆盖所有通道，Bandwidth()与实际字节数
+// 相符
+// the mask and values of every sample decode unchanged, the channel table is trickled and covers
+// every channel, and Bandwidth() matches the bytes actually written
+static void TestRoundTrip() {
+    bsp::UART uart;
+    Telemetry telemetry(UartInit(&uart));
+    Channels channels;
+    channels.Register(&telemetry);
+    test::Random random(1);
+
+    // 通道表每64个采样发一次，取整数轮让每个通道发送的次数相同
+    // the channel table goes out every 64 samples, whole rounds send every channel equally often
+    const int N = 64 * Channels::NUM * 4;
+    std::vector<std::vector<uint8_t>> expected;
+    std::vector<uint32_t> masks;
+    for (int n = 0; n < N; ++n) {
+        channels.Randomize(&random);
+        uint32_t mask = 0;
+        for (int i = 0; i < Channels::NUM; ++i)
+            if (n % Channels::DECIMATIONS[i] == 0)
+                mask |= 1u << i;
+        masks.push_back(mask);
+        expected.push_back(channels.Bytes(mask));
+        telemetry.Sample();
+    }
+
+    Receiver receiver;
+    receiver.Feed(uart.written);
+    int wrong = 0;
+    for (size_t n = 0; n < receiver.samples.size(); ++n) {
+        const sample_t& sample = receiver.samples[n];
+        if (sample.index != n || sample.mask != masks[n] || sample.values != expected[n])
+            ++wrong;
+    }
+    printf("round trip: %zu samples, %zu schemas, %d wrong, %d crc errors\n",
+           receiver.samples.size(), receiver.schemas.size(), wrong, receiver.errors);
+    CHECK(receiver.samples.size() == (size_t)N);
+    CHECK(wrong == 0);
+    CHECK(receiver.errors == 0);
+
+    std::vector<int> seen(Channels::NUM, 0);
+    CHECK(receiver.schemas.size() == (size_t)N / 64);
+    for (size_t k = 0; k < receiver.schemas.size(); ++k) {
+        const schema_t& schema = receiver.schemas[k];
+        const int id = (int)k % Channels::NUM;
+        // 过长的名字截断为24字节 / names longer than 24 bytes are truncated
+        const std::string name = std::string(Channels::NAMES[id]).substr(0, 24);
+        CHECK(schema.id == id);
+        CHECK(schema.type == Channels::TYPES[id]);
+        CHECK(schema.decimation == Channels::DECIMATIONS[id]);
+        CHECK(schema.period_us == PERIOD_US);
+        CHECK(schema.name == name);
+        ++seen[id];
+    }
+    for (int i = 0; i < Channels::NUM; ++i)
+        CHECK(seen[i] == 4);
+
+    const double measured = (double)uart.written.size() / N * 1e6 / PERIOD_US;
+    printf("  bandwidth: estimated %.0f bytes/s, measured %.0f bytes/s\n",
+           telemetry.Bandwidth(), measured);
+    CHECK(receiver.bytes == uart.written.size());
+    CHECK_NEAR(telemetry.Bandwidth(), measured, measured * 0.01);
+}
+
+// 数据流里的坏字节只让所在的帧丢失，接收端从下一个帧头继续
+// a bad byte in the stream only loses the frame it is in, the receiver resumes at the next header
+static void TestCorruption() {
+    bsp::UART uart;
+    Telemetry telemetry(UartInit(&uart));
+    Channels channels;
+    channels.Register(&telemetry);
+    test::Random random(2);
+    const int N = 1000;
+    std::vector<size_t> starts;
+    for (int n = 0; n < N; ++n) {
+        channels.Randomize(&random);
+        starts.push_back(uart.written.size());
+        telemetry.Sample();
+    }
+
+    // 每10个采样帧中改坏一个字节 / one byte is flipped in every tenth sample frame
+    std::vector<uint8_t> stream = uart.written;
+    int corrupted = 0;
+    for (int n = 5; n < N; n += 10) {
+        const size_t length = (n + 1 < N ? starts[n + 1] : stream.size()) - starts[n];
+        stream[starts[n] + HEADER_LEN + random.Next() % (length - HEADER_LEN)] ^= 0x10;
+        ++corrupted;
+    }
+    Receiver receiver;
+    receiver.Feed(stream);
+    int wrong = 0;
+    for (const sample_t& sample : receiver.samples)
+        if (sample.index % 10 == 5 || sample.values.size() != channels.Bytes(sample.mask).size())
+            ++wrong;
+    printf("corruption: %d frames corrupted, %zu of %d samples decoded, %d crc errors\n",
+           corrupted, receiver.samples.size(), N, receiver.errors);
+    CHECK(receiver.samples.size() == (size_t)(N - corrupted));
+    CHECK(wrong == 0);
+    CHECK(receiver.errors >= corrupted);
+}
+
+// 关闭的通道不再发送，也不计入带宽；全部关闭时只剩通道表
+// disabled channels are no longer sent nor counted in the bandwidth, with all of them disabled
+// only the channel table is left
+static void TestEnable() {
+    bsp::UART uart;
+    Telemetry telemetry(UartInit(&uart));
+    Channels channels;
+    channels.Register(&telemetry);
+    const float full = telemetry.Bandwidth();
+    telemetry.Enable(1, false);
+    telemetry.Enable(8, false);
+    telemetry.Enable(-1, false);
+    telemetry.Enable(Channels::NUM, false);
+    CHECK_NEAR(full - telemetry.Bandwidth(), (4 + 4.0 / 3) * 1e6 / PERIOD_US, 1e-2);
+    for (int n = 0; n < 64; ++n)
+        telemetry.Sample();
+    Receiver receiver;
+    receiver.Feed(uart.written);
+    int leaked = 0;
+    for (const sample_t& sample : receiver.samples)
+        if (sample.mask & (1u << 1 | 1u << 8))
+            ++leaked;
+    CHECK(receiver.samples.size() == 64);
+    CHECK(leaked == 0);
+
+    for (int i = 0; i < Channels::NUM; ++i)
+        telemetry.Enable(i, false);
+    uart.written.clear();
+    for (int n = 0; n < 128; ++n)
+        telemetry.Sample();
+    receiver = Receiver();
+    receiver.Feed(uart.written);
+    printf("enable: %d samples with disabled channels, %zu samples with all disabled\n", leaked,
+           receiver.samples.size());
+    CHECK(receiver.samples.empty());
+    CHECK(receiver.schemas.size() == 2);
+}
+
+// 发送缓冲区放不下整帧时计入overrun，USB口与串口发出相同的数据
+// frames that do not fit into the transmit buffer are counted as overruns, and the usb port
+// writes the same stream as the uart
+static void TestPorts() {
+    bsp::UART uart;
+    uart.tx_space = 10;
+    Telemetry telemetry(UartInit(&uart));
+    Channels channels;
+    channels.Register(&telemetry);
+    for (int n = 0; n < 100; ++n)
+        telemetry.Sample();
+    // 100个采样帧和两个通道表帧 / 100 sample frames and two schema frames
+    printf("ports: %u overruns of 102 frames\n", (unsigned)telemetry.GetOverrun());
+    CHECK(telemetry.GetOverrun() == 102);
+
+    bsp::UART full_uart;
+    bsp::VirtualUSB usb;
+    Telemetry by_uart(UartInit(&full_uart));
+    telemetry_init_t init = {};
+    init.usb = &usb;
+    init.sample_period_us = PERIOD_US;
+    Telemetry by_usb(init);
+    channels.Register(&by_uart);
+    channels.Register(&by_usb);
+    test::Random random(3);
+    for (int n = 0; n < 200; ++n) {
+        channels.Randomize(&random);
+        by_uart.Sample();
+        by_usb.Sample();
+    }
+    CHECK(usb.written == full_uart.written);
+    CHECK(by_usb.GetOverrun() == 0);
+}
+
+// 通道表满32个后再注册返回-1 / registering past the 32 channel table returns -1
+static void TestFull() {
+    bsp::UART uart;
+    Telemetry telemetry(UartInit(&uart));
+    constexpr int MAX = communication::TELEMETRY_MAX_CHANNEL;
+    float values[MAX + 1] = {};
+    for (int i = 0; i < MAX; ++i)
+        CHECK(telemetry.AddChannel("value", &values[i]) == i);
+    CHECK(telemetry.AddChannel("extra", &values[MAX]) == -1);
+
+    // 32个浮点通道正好放满一帧 / 32 float channels exactly fill a frame
+    for (int i = 0; i < MAX; ++i)
+        values[i] = (float)i;
+    telemetry.Sample();
+    Receiver receiver;
+    receiver.Feed(uart.written);
+    CHECK(receiver.samples.size() == 1);
+    CHECK(receiver.samples[0].mask == 0xFFFFFFFF);
+    CHECK(receiver.samples[0].values.size() == sizeof(float) * MAX);
+    CHECK(memcmp(receiver.samples[0].values.data(), values, sizeof(float) * MAX) == 0);
+}
+
+// 发送缓冲区设为0，只计打包和crc的耗时 / the transmit buffer is set to zero so only packing and
+// the crc are timed
+static void Benchmark() {
+    bsp::UART uart;
+    uart.tx_space = 0;
+    Telemetry telemetry(UartInit(&uart));
+    Channels channels;
+    channels.Register(&telemetry);
+    const long N = 200000;
+    printf("benchmark, %d channels:\n", Channels::NUM);
+    test::Stopwatch stopwatch;
+    for (long n = 0; n < N; ++n) {
+        channels.state = (float)n;
+        telemetry.Sample();
+    }
+    test::Report("Sample", stopwatch, N);
+    test::Consume(telemetry.GetOverrun());
+}
+
+int main(int argc, char** argv) {
+    if (argc == 3 && strcmp(argv[1], "--capture") == 0)
+        return Capture(argv[2]);
+    TestRoundTrip();
+    TestCorruption();
+    TestEnable();
+    TestPorts();
+    TestFull();
+    Benchmark();
+    return test::Finish();
+}
@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+############################################################
+# Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+#                                                          #
+# This program is free software: you can redistribute it   #
+# and/or modify it under the terms of the GNU General      #
+# Public License as published by the Free Software         #
+# Foundation, either version 3 of the License, or (at      #
+# your option) any later version.                          #
+#                                                          #
+# This program is distributed in the hope that it will be  #
+# useful, but WITHOUT ANY WARRANTY; without even           #
+# the implied warranty of MERCHANTABILITY or FITNESS       #
+# FOR A PARTICULAR PURPOSE.  See the GNU General           #
+# Public License for more details.                         #
+#                                                          #
+# You should have received a copy of the GNU General       #
+# Public License along with this program.  If not, see     #
+# <https://www.gnu.org/licenses/>.                         #
+############################################################
+"""Round trip of the telemetry stream through the shipped host receiver.
+
+Usage:
+    test_telemetry_receiver.py <test_telemetry> <telemetry_receiver.py>
+
+test_telemetry --capture writes a stream of Sample() frames, with leading garbage
+and a few corrupted frames, and the CSV those samples should turn into.
+tools/telemetry_receiver.py then receives the capture the same way it receives a
+board, its CSV has to match the expected one line for line and it has to report
+the crc errors of the corrupted frames.
+"""
+
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(__doc__)
+        return 1
+    test, receiver = sys.argv[1:]
+    with tempfile.TemporaryDirectory() as directory:
+        prefix = os.path.join(directory, "telemetry")
+        subprocess.run([test, "--capture", prefix], check=True)
+        result = subprocess.run([sys.executable, receiver, prefix + ".bin", prefix + ".out.csv"],
+                                check=True, stderr=subprocess.PIPE, universal_newlines=True)
+        with open(prefix + ".out.csv") as f:
+            received = f.read().splitlines()
+        with open(prefix + ".csv") as f:
+            expected = f.read().splitlines()
+    mismatches = 0
+    for i in range(max(len(received), len(expected))):
+        got = received[i] if i < len(received) else "<missing>"
+        want = expected[i] if i < len(expected) else "<missing>"
+        if got != want:
+            mismatches += 1
+            if mismatches <= 10:
+                print("line %d: received %r, expected %r" % (i + 1, got, want))
+    sys.stdout.write(result.stderr)
+    counts = re.search(r"(\d+) frames, (\d+) crc errors", result.stderr)
+    errors = int(counts.group(2)) if counts else 0
+    print("%d rows received, %d mismatches" % (len(expected) - 1, mismatches))
+    return 1 if mismatches or errors == 0 else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,310 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// TargetTracker的自瞄仿真：5m外的装甲板横穿、正弦平移和随机变向，相机100Hz，25ms延迟加最多
+// 8ms抖动，云台为10Hz带宽的1kHz位置环。与直接使用最新观测对比指向误差，另外检查门限、超时和
+// yaw跨越±pi，以及每次调用的耗时
+// auto aim simulation of TargetTracker: an armor plate 5 m away crossing, strafing and dodging
+// at random, a 100 Hz camera, 25 ms latency plus up to 8 ms jitter and a 1 kHz gimbal position
+// loop with 10 Hz bandwidth. The pointing error is compared with using the latest observation
+// directly, plus checks of the gate, the timeout and yaw across ±pi, and the cost of the calls
+
+#include <math.h>
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+#include "test.h"
+#include "tracker.h"
+
+using control::TargetTracker;
+using control::tracker_init_t;
+
+namespace {
+
+    constexpr double CONTROL_DT = 0.001;
+    constexpr double DURATION = 10.0;
+    constexpr double DISTANCE = 5.0;       // [m]
+    constexpr double HALF_ARMOR = 0.0675;  // [m]
+
+    // 相机和链路 / camera and link
+    constexpr double FRAME_PERIOD = 0.01;  // [s]
+    constexpr float NOISE = 0.002f;        // [rad]
+    constexpr double DROP_RATE = 0.05;
+    constexpr double LATENCY = 0.025;  // [s]
+    constexpr double JITTER = 0.008;   // [s]
+
+    // 云台，带角速度前馈的二阶位置环 / gimbal, second order position loop with rate feed forward
+    constexpr double BANDWIDTH = 2 * M_PI * 10.0;  // [rad/s]
+    constexpr double DAMPING = 0.8;
+
+    constexpr tracker_init_t TRACKER_INIT = {5.0f, NOISE, (float)LATENCY, 0.0f, 0.12f, 0.2f,
+                                             16.0f};
+
+    double Wrap(double value) {
+        return value - 2 * M_PI * floor((value + M_PI) / (2 * M_PI));
+    }
+
+    // 目标的横向位移，单位为[m] / lateral offset of the target, in [m]
+    class Target {
+      public:
+        enum motion_t { CROSSING, STRAFE, DODGE };
+
+        explicit Target(motion_t motion) : motion_(motion) {
+            test::Random random(7);
+            for (double t = 0; t < DURATION;) {
+                t += random.Uniform(0.3, 1.0);
+                switches_.push_back(t);
+            }
+        }
+
+        double Offset(double t) const {
+            switch (motion_) {
+                case CROSSING:
+                    return 2.0 * (t - DURATION / 2);
+                case STRAFE:
+                    return 1.0 * sin(2 * M_PI * t / 1.6);
+                default:
+                    break;
+            }
+            // 2m/s，每0.3到1s变向 / 2 m/s reversing every 0.3 to 1 s
+            double x = 0, last = 0, direction = 1;
+            for (double s : switches_) {
+                if (s >= t)
+                    break;
+                x += direction * 2.0 * (s - last);
+                last = s;
+                direction = -direction;
+            }
+            return x + direction * 2.0 * (t - last);
+        }
+
+        void Angles(double t, double* pitch, double* yaw) const {
+            const double x = Offset(t);
+            *pitch = atan2(0.1, hypot(DISTANCE, x));
+            *yaw = atan2(x, DISTANCE);
+        }
+
+      private:
+        motion_t motion_;
+        std::vector<double> switches_;
+    };
+
+    typedef struct {
+        double rms;
+        double p95;
+        double on_armor;
+    } error_t;
+
+    typedef struct {
+        uint64_t receive;  // [us]
+        float pitch;
+        float yaw;
+    } observation_t;
+
+    error_t Simulate(const Target& target, bool tracker_on) {
+        test::Random random(1);
+        TargetTracker tracker(TRACKER_INIT);
+        std::deque<observation_t> pending;
+        double command[2], gimbal[2], rate[2] = {0, 0};
+        target.Angles(0, &command[0], &command[1]);
+        gimbal[0] = command[0];
+        gimbal[1] = command[1];
+        double next_frame = 0;
+        std::vector<double> errors;
+        for (int step = 0; step < DURATION / CONTROL_DT; ++step) {
+            const double t = step * CONTROL_DT;
+            const uint64_t now = (uint64_t)step * 1000;
+            if (t >= next_frame) {
+                next_frame += FRAME_PERIOD;
+                if (random.Uniform(0, 1) > DROP_RATE) {
+                    double pitch, yaw;
+                    target.Angles(t, &pitch, &yaw);
+                    const double receive = t + LATENCY + random.Uniform(0, JITTER);
+                    pending.push_back({(uint64_t)(receive * 1e6),
+                                       (float)pitch + random.Normal(NOISE),
+                                       (float)yaw + random.Normal(NOISE)});
+                }
+            }
+            // 链路按顺序交付 / the link delivers in order
+            while (!pending.empty() && pending.front().receive <= now) {
+                const observation_t observation = pending.front();
+                pending.pop_front();
+                command[0] = observation.pitch;
+                command[1] = observation.yaw;
+                tracker.Observe(observation.pitch, observation.yaw, now);
+            }
+
+            float prediction[4];
+            double feed_forward[2] = {0, 0};
+            if (tracker_on && tracker.Predict(now, &prediction[0], &prediction[1],
+                                              &prediction[2], &prediction[3])) {
+                for (int axis = 0; axis < 2; ++axis) {
+                    command[axis] = prediction[axis];
+                    feed_forward[axis] = prediction[axis + 2];
+                }
+            }
+            for (int axis = 0; axis < 2; ++axis) {
+                const double acceleration =
+                    BANDWIDTH * BANDWIDTH * Wrap(command[axis] - gimbal[axis]) +
+                    2 * DAMPING * BANDWIDTH * (feed_forward[axis] - rate[axis]);
+                rate[axis] += acceleration * CONTROL_DT;
+                gimbal[axis] += rate[axis] * CONTROL_DT;
+            }
+
+            if (t > 1.0) {
+                double pitch, yaw;
+                target.Angles(t, &pitch, &yaw);
+                errors.push_back(hypot(pitch - gimbal[0], Wrap(yaw - gimbal[1])));
+            }
+        }
+        std::sort(errors.begin(), errors.end());
+        double sum = 0;
+        int inside = 0;
+        for (double error : errors) {
+            sum += error * error;
+            if (error * DISTANCE < HALF_ARMOR)
+                ++inside;
+        }
+        return {sqrt(sum / errors.size()), errors[(size_t)(0.95 * errors.size())],
+                (double)inside / errors.size()};
+    }
+
+}  // namespace
+
+// 跟踪后的误差只有直接使用观测的几分之一，匀速和正弦目标几乎一直在小装甲板内，
+// 随机变向的目标在变向后的一段时间内跟不上
+// tracking cuts the error to a fraction of using the observations directly, the crossing and
+// strafing targets stay on a small armor plate nearly all the time and the dodging one is lost
+// for a moment after each reversal
+static void TestTargets() {
+    const struct {
+        const char* name;
+        Target::motion_t motion;
+        double on_armor;  // 跟踪时至少在装甲板内的比例 / minimum share on the armor when tracked
+    } targets[] = {
+        {"crossing", Target::CROSSING, 0.97},
+        {"strafe", Target::STRAFE, 0.95},
+        {"dodge", Target::DODGE, 0.8},
+    };
+    printf("%-10s %-8s %12s %12s %12s\n", "target", "scheme", "rms [mrad]", "95 % [mrad]",
+           "on armor");
+    for (const auto& item : targets) {
+        const Target target(item.motion);
+        const error_t direct = Simulate(target, false);
+        const error_t tracked = Simulate(target, true);
+        printf("%-10s %-8s %12.1f %12.1f %11.1f%%\n", item.name, "direct", direct.rms * 1000,
+               direct.p95 * 1000, direct.on_armor * 100);
+        printf("%-10s %-8s %12.1f %12.1f %11.1f%%\n", item.name, "tracker", tracked.rms * 1000,
+               tracked.p95 * 1000, tracked.on_armor * 100);
+        CHECK(tracked.rms * 2 < direct.rms);
+        CHECK(tracked.on_armor >= item.on_armor);
+    }
+}
+
+// 单个异常值被丢弃，连续两个重新开始；超时或者Reset之后不再预测
+// a single outlier is dropped and two in a row start over; no prediction after the timeout or
+// Reset
+static void TestGateAndTimeout() {
+    TargetTracker tracker(TRACKER_INIT);
+    float pitch, yaw;
+    CHECK(!tracker.Predict(0, &pitch, &yaw));
+    const uint64_t latency = (uint64_t)(LATENCY * 1e6);
+    uint64_t now = latency;
+    for (int i = 0; i < 50; ++i, now += 10000)
+        tracker.Observe(0.1f, 0.2f + 0.001f * i, now);
+    CHECK(tracker.Predict(now, &pitch, &yaw));
+    CHECK_NEAR(yaw, 0.2525f, 0.001f);
+
+    tracker.Observe(0.1f, 1.0f, now);
+    CHECK(tracker.Predict(now, &pitch, &yaw));
+    CHECK_NEAR(yaw, 0.2525f, 0.001f);
+    now += 10000;
+    tracker.Observe(0.1f, 1.0f, now);
+    CHECK(tracker.Predict(now, &pitch, &yaw));
+    CHECK(yaw == 1.0f);
+
+    // 乱序的观测被忽略 / an out of order observation is ignored
+    tracker.Observe(0.5f, 0.5f, now - 5000);
+    CHECK(tracker.Predict(now, &pitch, &yaw));
+    CHECK(pitch == 0.1f);
+
+    CHECK(tracker.Predict(now + 200000 - latency, &pitch, &yaw));
+    CHECK(!tracker.Predict(now + 201000 - latency, &pitch, &yaw));
+    tracker.Reset();
+    CHECK(!tracker.Predict(now, &pitch, &yaw));
+}
+
+// 目标在身后转过±pi时跟踪不中断，预测的yaw保持在[-pi, pi]内
+// a target passing ±pi behind the robot stays tracked and the predicted yaw stays in [-pi, pi]
+static void TestYawWrap() {
+    TargetTracker tracker(TRACKER_INIT);
+    const double rate = 2.0;  // [rad/s]
+    uint64_t now = (uint64_t)(LATENCY * 1e6);
+    double max_error = 0, max_rate_error = 0;
+    bool in_range = true;
+    for (int i = 0; i < 200; ++i, now += 10000) {
+        const double capture = (double)now * 1e-6 - LATENCY;
+        tracker.Observe(0, (float)Wrap(2.0 + rate * capture), now);
+        float pitch, yaw, pitch_rate, yaw_rate;
+        const uint64_t ahead = now + 5000;
+        CHECK(tracker.Predict(ahead, &pitch, &yaw, &pitch_rate, &yaw_rate));
+        in_range = in_range && fabsf(yaw) <= (float)M_PI;
+        if (i >= 50) {
+            const double truth = 2.0 + rate * (double)ahead * 1e-6;
+            max_error = fmax(max_error, fabs(Wrap(yaw - truth)));
+            max_rate_error = fmax(max_rate_error, fabs(yaw_rate - rate));
+        }
+    }
+    printf("yaw across pi: max error %.2g rad, %.2g rad/s\n", max_error, max_rate_error);
+    CHECK(in_range);
+    CHECK(max_error < 1e-4);
+    CHECK(max_rate_error < 1e-3);
+}
+
+static void Benchmark() {
+    TargetTracker tracker(TRACKER_INIT);
+    test::Random random(3);
+    const int N = 1 << 16;
+    printf("benchmark:\n");
+    test::Stopwatch stopwatch;
+    for (int i = 0; i < N; ++i)
+        tracker.Observe(random.Normal(NOISE), 0.001f * (i % 1000), 25000 + 10000 * (uint64_t)i);
+    test::Report("Observe", stopwatch, N);
+    float sum = 0;
+    const uint64_t last = 25000 + 10000 * (uint64_t)(N - 1);
+    stopwatch.Restart();
+    for (int i = 0; i < N; ++i) {
+        float pitch, yaw, pitch_rate, yaw_rate;
+        tracker.Predict(last + i % 100, &pitch, &yaw, &pitch_rate, &yaw_rate);
+        sum += pitch + yaw + pitch_rate + yaw_rate;
+    }
+    test::Report("Predict", stopwatch, N);
+    test::Consume(sum);
+}
+
+int main() {
+    TestTargets();
+    TestGateAndTimeout();
+    TestYawWrap();
+    Benchmark();
+    return test::Finish();
+}
@@ -0,0 +1,346 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// TractionControl的底盘仿真：20kg的麦克纳姆轮底盘向前阶跃到3m/s、停车、边旋转边斜向行驶，
+// 轮子只沿辊子轴线传递摩擦力。对比直接设置轮速、只限制加速度和加上打滑检测三种方式的响应时间
+// 和打滑损耗，另外检查限幅和输出恢复，以及每次调用的耗时
+// chassis simulation of TractionControl: a 20 kg mecanum chassis stepping forward to 3 m/s,
+// stopping and driving diagonally while spinning, every wheel only transmitting friction along
+// its roller axis. Setting the wheel speeds directly, limiting the acceleration only and adding
+// slip detection are compared by response time and slip loss, plus checks of the limits and the
+// output recovery, and the cost of the calls
+
+#include <math.h>
+
+#include <initializer_list>
+
+#include "arm_math.h"
+#include "kinematics.h"
+#include "test.h"
+#include "traction.h"
+
+using control::Kinematics;
+using control::TractionControl;
+using control::traction_init_t;
+using control::wheel_geometry_t;
+
+namespace {
+
+    constexpr double CONTROL_DT = 0.001;
+    constexpr int SUBSTEPS = 10;
+    constexpr double GRAVITY = 9.81;
+
+    // 被控对象 / plant
+    constexpr double MASS = 20.0;        // [kg]
+    constexpr double YAW_INERTIA = 0.6;  // [kg m^2]
+    constexpr float RADIUS = 0.076f;     // [m]
+    constexpr float HALF_TRACK = 0.2f;   // [m]
+    constexpr float HALF_BASE = 0.2f;    // [m]
+    constexpr double KT = 0.3;           // 输出轴的转矩常数 / output shaft torque constant [N m/A]
+    // 折算到输出轴 / reflected to the output shaft [kg m^2]
+    constexpr double WHEEL_INERTIA = 1.5e-5 * 19.2 * 19.2 + 0.002;
+    constexpr double VISCOUS = 0.005;         // [N m s/rad]
+    constexpr double MAX_CURRENT = 20.0;      // [A]
+    constexpr float MAX_WHEEL_SPEED = 45.0f;  // [rad/s]
+    constexpr double K1 = 0.45, P0 = 2.0;     // 每个电机的铜损和静态功率 / per motor [W/A^2], [W]
+    // 摩擦系数的峰值，达到峰值时的滑移速度和滑动摩擦与峰值之比
+    // peak friction coefficient, slip speed at the peak and sliding over peak friction
+    constexpr double PEAK_FRICTION = 0.8;
+    constexpr double PEAK_SLIP = 0.1;  // [m/s]
+    constexpr double SLIDE_RATIO = 0.7;
+
+    // IMU的噪声和加速度计零偏 / IMU noise and accelerometer bias
+    constexpr float ACCEL_NOISE = 0.05f;             // [m/s^2]
+    constexpr float GYRO_NOISE = 0.005f;             // [rad/s]
+    constexpr double ACCEL_BIAS[2] = {0.03, -0.02};  // [m/s^2]
+
+    // 输出轴上的速度环PI，单位为[A]每[rad/s] / speed loop PI at the output shaft, [A] per [rad/s]
+    constexpr double SPEED_KP = 1.5;
+    constexpr double SPEED_KI = 0.04;
+
+    const wheel_geometry_t WHEELS[4] = {
+        {control::WHEEL_MECANUM, -HALF_TRACK, HALF_BASE, PI / 2, -PI / 4, RADIUS},
+        {control::WHEEL_MECANUM, HALF_TRACK, HALF_BASE, -PI / 2, PI / 4, RADIUS},
+        {control::WHEEL_MECANUM, -HALF_TRACK, -HALF_BASE, PI / 2, PI / 4, RADIUS},
+        {control::WHEEL_MECANUM, HALF_TRACK, -HALF_BASE, -PI / 2, -PI / 4, RADIUS},
+    };
+
+    constexpr traction_init_t TRACTION_INIT = {
+        {5.0f, 5.0f, 15.0f}, {6.0f, 6.0f, 20.0f}, 2.0f, 0.3f, 0.2f, 5.0f};
+
+    enum scheme_t { CURRENT, RAMP, TRACTION };
+    const char* const SCHEME_NAMES[] = {"current", "ramp", "traction"};
+
+    // 沿辊子轴线的滑移速度对应的摩擦系数 / friction coefficient over the slip along the roller
+    double Friction(double slip) {
+        const double magnitude = fabs(slip);
+        double mu;
+        if (magnitude < PEAK_SLIP)
+            mu = PEAK_FRICTION * magnitude / PEAK_SLIP;
+        else
+            mu = PEAK_FRICTION *
+                 (SLIDE_RATIO + (1 - SLIDE_RATIO) * exp(-(magnitude - PEAK_SLIP) / 0.3));
+        return copysign(mu, slip);
+    }
+
+    // 测试循环的底盘速度目标 / chassis velocity target of the test cycle
+    void Target(double t, float target[3]) {
+        const float step[3] = {0, 3, 0};
+        const float diagonal[3] = {1.5f, 1.5f, 4};
+        for (int i = 0; i < 3; ++i) {
+            if (t < 2.0)
+                target[i] = step[i];
+            else if (t >= 3.5 && t < 6.0)
+                target[i] = diagonal[i];
+            else
+                target[i] = 0;
+        }
+    }
+
+    typedef struct {
+        double reach;  // 达到95%目标速度的时间 / time to 95 % of the target speed [s]
+        double stop;   // 停车的时间 / time to stop [s]
+        double step_energy;
+        double step_slip;
+        double energy;
+        double slip;
+    } result_t;
+
+    result_t Simulate(scheme_t scheme) {
+        test::Random random(1);
+        Kinematics kinematics(WHEELS, 4, MAX_WHEEL_SPEED);
+        TractionControl traction(&kinematics, TRACTION_INIT);
+        double roller[4][5];  // 辊子轴线方向、力臂和位置 / roller axis, lever and position
+        for (int i = 0; i < 4; ++i) {
+            const wheel_geometry_t& wheel = WHEELS[i];
+            roller[i][0] = cos(wheel.heading + wheel.roller);
+            roller[i][1] = sin(wheel.heading + wheel.roller);
+            roller[i][2] = RADIUS * cos(wheel.roller);
+            roller[i][3] = wheel.x;
+            roller[i][4] = wheel.y;
+        }
+
+        double v[3] = {0, 0, 0};  // 底盘坐标系下的速度 / velocity in the chassis frame
+        float omega[4] = {0, 0, 0, 0};
+        double integral[4] = {0, 0, 0, 0};
+        double accel[2] = {0, 0};
+        const double normal = MASS * GRAVITY / 4;
+        result_t result = {-1, -1, -1, -1, 0, 0};
+        const int steps = 7.0 / CONTROL_DT;
+        for (int k = 0; k < steps; ++k) {
+            const double t = k * CONTROL_DT;
+            float target[3], wheel_target[4];
+            Target(t, target);
+            if (scheme == CURRENT) {
+                kinematics.Inverse(target[0], target[1], target[2], wheel_target);
+            } else {
+                float command[3];
+                traction.Limit(target, command, CONTROL_DT);
+                kinematics.Inverse(command[0], command[1], command[2], wheel_target);
+                if (scheme == TRACTION) {
+                    const float ax = accel[0] + ACCEL_BIAS[0] + random.Normal(ACCEL_NOISE);
+                    const float ay = accel[1] + ACCEL_BIAS[1] + random.Normal(ACCEL_NOISE);
+                    const float gz = v[2] + random.Normal(GYRO_NOISE);
+                    traction.Estimate(omega, ax, ay, gz, CONTROL_DT);
+                }
+            }
+
+            float current[4];
+            for (int i = 0; i < 4; ++i) {
+                const double error = wheel_target[i] - omega[i];
+                integral[i] = fmin(fmax(integral[i] + SPEED_KI * error, -MAX_CURRENT),
+                                   MAX_CURRENT);
+                current[i] = fmin(fmax(SPEED_KP * error + integral[i], -MAX_CURRENT),
+                                  MAX_CURRENT);
+            }
+            // 电机输出前的回调 / pre output callback
+            if (scheme == TRACTION)
+                traction.Apply(current);
+
+            const double dt = CONTROL_DT / SUBSTEPS;
+            for (int s = 0; s < SUBSTEPS; ++s) {
+                double fx = 0, fy = 0, tz = 0;
+                for (int i = 0; i < 4; ++i) {
+                    const double nx = roller[i][0], ny = roller[i][1], lever = roller[i][2];
+                    const double x = roller[i][3], y = roller[i][4];
+                    const double ground = nx * (v[0] - v[2] * y) + ny * (v[1] + v[2] * x);
+                    const double slip = omega[i] * lever - ground;
+                    const double force = Friction(slip) * normal;
+                    fx += force * nx;
+                    fy += force * ny;
+                    tz += x * force * ny - y * force * nx;
+                    const double torque = KT * current[i] - force * lever - VISCOUS * omega[i];
+                    omega[i] += torque / WHEEL_INERTIA * dt;
+                    result.slip += fabs(force * slip) * dt;
+                }
+                accel[0] = fx / MASS;
+                accel[1] = fy / MASS;
+                v[0] += (accel[0] + v[2] * v[1]) * dt;
+                v[1] += (accel[1] - v[2] * v[0]) * dt;
+                v[2] += tz / YAW_INERTIA * dt;
+            }
+            double power = 0;
+            for (int i = 0; i < 4; ++i)
+                power += K1 * current[i] * current[i] + KT * current[i] * omega[i] + P0;
+            result.energy += fmax(power, 0) * CONTROL_DT;
+
+            if (result.reach < 0 && v[1] >= 0.95 * 3.0)
+                result.reach = t;
+            if (t >= 2.0 && result.stop < 0 && fabs(v[1]) < 0.05)
+                result.stop = t - 2.0;
+            if (result.step_energy < 0 && t >= 3.5) {
+                result.step_energy = result.energy;
+                result.step_slip = result.slip;
+            }
+        }
+        return result;
+    }
+
+}  // namespace
+
+// 限制加速度后起步不再打滑，反而更快达到目标速度；加上打滑检测后停车更快，旋转斜行时的
+// 打滑损耗降到几分之一
+// with the acceleration limited the start no longer slips and reaches the target speed sooner;
+// slip detection stops the chassis faster and cuts the slip loss of the spinning diagonal run
+// to a fraction
+static void TestCycle() {
+    printf("%-10s %10s %10s %12s %12s %12s %12s\n", "scheme", "95 % [s]", "stop [s]",
+           "step [J]", "step slip", "total [J]", "total slip");
+    result_t results[3];
+    for (scheme_t scheme : {CURRENT, RAMP, TRACTION}) {
+        const result_t& r = results[scheme] = Simulate(scheme);
+        printf("%-10s %10.3f %10.3f %12.0f %12.0f %12.0f %12.0f\n", SCHEME_NAMES[scheme], r.reach,
+               r.stop, r.step_energy, r.step_slip, r.energy, r.slip);
+        CHECK(r.reach > 0);
+        CHECK(r.stop > 0);
+    }
+    const result_t &current = results[CURRENT], &ramp = results[RAMP];
+    const result_t& traction = results[TRACTION];
+    CHECK(ramp.reach < current.reach);
+    CHECK(ramp.step_slip * 3 < current.step_slip);
+    CHECK(traction.reach <= ramp.reach + 0.01);
+    CHECK(traction.stop < ramp.stop);
+    CHECK(traction.slip * 3 < ramp.slip);
+    CHECK(traction.energy < ramp.energy);
+}
+
+// 加速和减速分别按各自的上限限幅，Reset后从0开始
+// acceleration and deceleration are limited by their own limits, Reset starts over from 0
+static void TestLimit() {
+    Kinematics kinematics(WHEELS, 4, MAX_WHEEL_SPEED);
+    TractionControl traction(&kinematics, TRACTION_INIT);
+    const float forward[3] = {3, -3, 10};
+    const float stop[3] = {0, 0, 0};
+    float command[3];
+    traction.Limit(forward, command, 0.1f);
+    CHECK_NEAR(command[0], 0.5f, 1e-6f);
+    CHECK_NEAR(command[1], -0.5f, 1e-6f);
+    CHECK_NEAR(command[2], 1.5f, 1e-6f);
+    traction.Limit(stop, command, 0.05f);
+    CHECK_NEAR(command[0], 0.2f, 1e-6f);
+    CHECK_NEAR(command[1], -0.2f, 1e-6f);
+    CHECK_NEAR(command[2], 0.5f, 1e-6f);
+    for (int i = 0; i < 100; ++i)
+        traction.Limit(forward, command, 0.01f);
+    CHECK(command[0] == 3 && command[1] == -3);
+    traction.Reset();
+    traction.Limit(stop, command, 0.01f);
+    CHECK(command[0] == 0 && command[1] == 0 && command[2] == 0);
+}
+
+// 空转的轮子输出立即降到slip_torque_scale，抓地后在recovery_time内恢复，其它轮子不受影响
+// the output of a spinning wheel drops to slip_torque_scale at once and recovers within
+// recovery_time once it grips, the other wheels are left alone
+static void TestSlip() {
+    Kinematics kinematics(WHEELS, 4, MAX_WHEEL_SPEED);
+    TractionControl traction(&kinematics, TRACTION_INIT);
+    float grip[4];
+    kinematics.Inverse(0, 1, 0, grip);
+    float spin[4] = {grip[0], grip[1] + 10, grip[2], grip[3]};
+    const float dt = 0.001f;
+    // 以1m/s^2加速到1m/s后匀速行驶 / accelerating at 1 m/s^2 to 1 m/s, then cruising
+    for (int i = 1; i <= 1000; ++i) {
+        float wheel_speed[4];
+        kinematics.Inverse(0, i * dt, 0, wheel_speed);
+        traction.Estimate(wheel_speed, 0, 1, 0, dt);
+    }
+    for (int i = 0; i < 1000; ++i)
+        traction.Estimate(grip, 0, 0, 0, dt);
+    for (int i = 0; i < 4; ++i)
+        CHECK(!traction.IsSlipping(i));
+    float velocity[3];
+    traction.GetVelocity(velocity);
+    CHECK_NEAR(velocity[1], 1, 1e-3);
+
+    traction.Estimate(spin, 0, 0, 0, dt);
+    CHECK(traction.IsSlipping(1));
+    CHECK(!traction.IsSlipping(0) && !traction.IsSlipping(2) && !traction.IsSlipping(3));
+    float output[4] = {1, 1, 1, 1};
+    traction.Apply(output);
+    CHECK_NEAR(output[1], TRACTION_INIT.slip_torque_scale * (1 - dt / 0.2f), 1e-6);
+    CHECK(output[0] == 1 && output[2] == 1 && output[3] == 1);
+
+    int steps = 0;
+    for (; steps < 1000; ++steps) {
+        traction.Estimate(grip, 0, 0, 0, dt);
+        float scaled[4] = {1, 1, 1, 1};
+        traction.Apply(scaled);
+        if (scaled[1] == 1)
+            break;
+    }
+    CHECK(!traction.IsSlipping(1));
+    CHECK(steps <= TRACTION_INIT.recovery_time / dt);
+}
+
+static void Benchmark() {
+    Kinematics kinematics(WHEELS, 4, MAX_WHEEL_SPEED);
+    TractionControl traction(&kinematics, TRACTION_INIT);
+    test::Random random(5);
+    const int N = 1 << 16;
+    float wheel_speed[4], output[4] = {1, 1, 1, 1}, command[3], sum = 0;
+    printf("benchmark, one control period:\n");
+    test::Stopwatch stopwatch;
+    for (int i = 0; i < N; ++i) {
+        const float target[3] = {random.Uniform(-3, 3), random.Uniform(-3, 3), 0};
+        traction.Limit(target, command, 0.001f);
+        sum += command[0] + command[1];
+    }
+    test::Report("Limit", stopwatch, N);
+    for (int i = 0; i < 4; ++i)
+        wheel_speed[i] = random.Uniform(-40, 40);
+    stopwatch.Restart();
+    for (int i = 0; i < N; ++i) {
+        wheel_speed[i & 3] += random.Uniform(-1, 1);
+        traction.Estimate(wheel_speed, 0.01f, 0.02f, 0.001f, 0.001f);
+        traction.Apply(output);
+        output[i & 3] = 1;
+    }
+    test::Report("Estimate and Apply", stopwatch, N);
+    test::Consume(sum);
+    test::Consume(output);
+}
+
+int main() {
+    TestCycle();
+    TestLimit();
+    TestSlip();
+    Benchmark();
+    return test::Finish();
+}
@@ -0,0 +1,227 @@
+/*###########################################################
+ # Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+ #                                                          #
+ # This program is free software: you can redistribute it   #
+ # and/or modify it under the terms of the GNU General      #
+ # Public License as published by the Free Software         #
+ # Foundation, either version 3 of the License, or (at      #
+ # your option) any later version.                          #
+ #                                                          #
+ # This program is distributed in the hope that it will be  #
+ # useful, but WITHOUT ANY WARRANTY; without even           #
+ # the implied warranty of MERCHANTABILITY or FITNESS       #
+ # FOR A PARTICULAR PURPOSE.  See the GNU General           #
+ # Public License for more details.                         #
+ #                                                          #
+ # You should have received a copy of the GNU General       #
+ # Public License along with this program.  If not, see     #
+ # <https://www.gnu.org/licenses/>.                         #
+ ###########################################################*/
+
+// 加加速度受限的轨迹生成器的测试：速度、加速度和加加速度限制在静止到静止的运动和频繁改变目标时
+// 都不被超过，完成时间与解析的时间最优S曲线对比，速度模式的加速时间，以及每次调用的耗时
+// tests of the jerk limited trajectory generator: the velocity, acceleration and jerk limits hold
+// for rest to rest moves and frequent retargets, the move time is compared with the analytic time
+// optimal S-curve, the speed change time of the velocity mode, and the cost per call
+
+#include <math.h>
+
+#include <initializer_list>
+
+#include "test.h"
+#include "trajectory.h"
+
+using control::trajectory_limit_t;
+using control::trajectory_state_t;
+using control::TrajectoryGenerator;
+
+namespace {
+
+    constexpr float DT = 0.001f;
+    const trajectory_limit_t LIMIT = {20, 200, 4000};
+
+    // 从静止加速到v的时间，加速度按加加速度上升、保持、下降 / time to accelerate from rest to v,
+    // with the acceleration ramping up at the jerk limit, holding and ramping down
+    double AccelerationTime(double v, const trajectory_limit_t& limit) {
+        const double a = limit.max_acceleration, j = limit.max_jerk;
+        if (v >= a * a / j)
+            return v / a + a / j;
+        return 2 * sqrt(v / j);
+    }
+
+    // 静止到静止移动distance的最短时间。加速段对称，平均速度是终速度的一半
+    // shortest rest to rest time over distance. The acceleration phase is symmetric so its mean
+    // velocity is half the final one
+    double OptimalTime(double distance, const trajectory_limit_t& limit) {
+        auto ramp_distance = [&limit](double v) {
+            return v * AccelerationTime(v, limit);
+        };
+        const double v_max = limit.max_velocity;
+        if (ramp_distance(v_max) <= distance)
+            return 2 * AccelerationTime(v_max, limit) + (distance - ramp_distance(v_max)) / v_max;
+        double low = 0, high = v_max;
+        for (int i = 0; i < 100; ++i) {
+            const double mid = (low + high) / 2;
+            if (ramp_distance(mid) < distance)
+                low = mid;
+            else
+                high = mid;
+        }
+        return 2 * AccelerationTime(low, limit);
+    }
+
+    // 记录每个周期的状态，检查限制 / checks the limits on the state of every tick
+    class LimitChecker {
+      public:
+        explicit LimitChecker(const trajectory_limit_t& limit) : limit_(limit) {
+        }
+
+        void Check(const trajectory_state_t& state) {
+            velocity_ = fmaxf(velocity_, fabsf(state.velocity) / limit_.max_velocity);
+            acceleration_ =
+                fmaxf(acceleration_, fabsf(state.acceleration) / limit_.max_acceleration);
+            if (started_) {
+                const float jerk = (state.acceleration - last_acceleration_) / DT;
+                jerk_ = fmaxf(jerk_, fabsf(jerk) / limit_.max_jerk);
+            }
+            last_acceleration_ = state.acceleration;
+            started_ = true;
+        }
+
+        // 最大值与限制之比 / largest ratio of a value to its limit
+        float Worst() const {
+            return fmaxf(velocity_, fmaxf(acceleration_, jerk_));
+        }
+
+        void Print(const char* name) const {
+            printf("%s: largest velocity %.5f, acceleration %.5f, jerk %.5f of the limits\n", name,
+                   velocity_, acceleration_, jerk_);
+        }
+
+      private:
+        trajectory_limit_t limit_;
+        float velocity_ = 0;
+        float acceleration_ = 0;
+        float jerk_ = 0;
+        float last_acceleration_ = 0;
+        bool started_ = false;
+    };
+
+}  // namespace
+
+// 0.001到60的静止到静止的运动在限制之内，不早于解析的最短时间。连续时间的最优停止时刻一般不在
+// 周期边界上，最后一段会越过目标约1e-5再退回，所以最多晚7个周期
+// rest to rest moves from 0.001 to 60 stay within the limits and never beat the analytic shortest
+// time. The continuous time optimal stop rarely falls on a tick, the last segment passes the
+// target by about 1e-5 and comes back, so moves may end up to 7 ticks late
+static void TestRestToRest() {
+    LimitChecker checker(LIMIT);
+    float worst_late = 0, worst_early = 0, worst_overshoot = 0;
+    int moves = 0;
+    printf("rest to rest, distance: ticks / optimal ticks\n");
+    for (float distance = 0.001f; distance < 60; distance *= 1.03f) {
+        for (float direction : {1.0f, -1.0f}) {
+            const float target = distance * direction;
+            TrajectoryGenerator generator(LIMIT);
+            generator.Reset(0);
+            int ticks = 0;
+            float overshoot = 0;
+            do {
+                const trajectory_state_t state = generator.Update(target, DT);
+                checker.Check(state);
+                overshoot = fmaxf(overshoot, (state.position - target) * direction);
+                ++ticks;
+            } while (!generator.IsFinished() && ticks < 100000);
+            const double optimal = OptimalTime(distance, LIMIT) / DT;
+            if (direction > 0 && moves % 40 == 0)
+                printf("  %7.3f: %5d / %8.1f\n", distance, ticks, optimal);
+            worst_late = fmaxf(worst_late, ticks - optimal);
+            worst_early = fmaxf(worst_early, optimal - ticks);
+            worst_overshoot = fmaxf(worst_overshoot, overshoot / fmaxf(1, distance));
+            CHECK(generator.State().position == target);
+            ++moves;
+        }
+    }
+    printf("  %d moves, up to %.2f ticks late, %.2f ticks early, overshoot %.1e\n", moves,
+           worst_late, worst_early, worst_overshoot);
+    checker.Print("  limits");
+    CHECK(worst_late <= 7);
+    CHECK(worst_early <= 1);
+    CHECK(worst_overshoot < 3e-5f);
+    CHECK(checker.Worst() <= 1 + 1e-4f);
+}
+
+// 每50ms随机改变一次目标，包括反向和已在运动中，限制始终成立，最后停在目标上
+// the target changes randomly every 50 ms, including reversals and while moving, the limits
+// always hold and the generator finally stops on the target
+static void TestRetarget() {
+    TrajectoryGenerator generator(LIMIT);
+    generator.Reset(0);
+    LimitChecker checker(LIMIT);
+    test::Random random(1);
+    float target = 0;
+    for (int tick = 0; tick < 20000; ++tick) {
+        if (tick % 50 == 0)
+            target = random.Uniform(-10, 10);
+        checker.Check(generator.Update(target, DT));
+    }
+    int ticks = 0;
+    while (!generator.IsFinished() && ticks < 10000) {
+        checker.Check(generator.Update(target, DT));
+        ++ticks;
+    }
+    checker.Print("retarget");
+    CHECK(checker.Worst() <= 1 + 1e-4f);
+    CHECK(generator.IsFinished());
+    CHECK(generator.State().position == target);
+}
+
+// 速度模式只限制加速度和加加速度，改变速度的时间与解析值相同
+// the velocity mode only limits acceleration and jerk, and changes speed in the analytic time
+static void TestVelocity() {
+    const trajectory_limit_t limit = {1e6f, 200, 4000};
+    LimitChecker checker(limit);
+    float worst = 0;
+    for (float speed : {0.5f, 5.0f, 10.0f, 60.0f}) {
+        TrajectoryGenerator generator(limit);
+        generator.Reset(0);
+        int ticks = 0;
+        trajectory_state_t state;
+        do {
+            state = generator.UpdateVelocity(speed, DT);
+            checker.Check(state);
+            ++ticks;
+        } while ((state.velocity != speed || state.acceleration != 0) && ticks < 100000);
+        const double optimal = AccelerationTime(speed, limit) / DT;
+        printf("velocity %5.1f: %d / %.1f ticks\n", speed, ticks, optimal);
+        worst = fmaxf(worst, fabs(ticks - optimal));
+    }
+    checker.Print("velocity");
+    CHECK(worst <= 2);
+    CHECK(checker.Worst() <= 1 + 1e-4f);
+}
+
+static void Benchmark() {
+    TrajectoryGenerator generator(LIMIT);
+    generator.Reset(0);
+    const long calls = 1000000;
+    float sum = 0;
+    printf("benchmark:\n");
+    test::Stopwatch stopwatch;
+    for (long i = 0; i < calls; ++i)
+        sum += generator.Update((i / 500) % 2 ? 5.0f : -5.0f, DT).position;
+    test::Report("Update", stopwatch, calls);
+    stopwatch.Restart();
+    for (long i = 0; i < calls; ++i)
+        sum += generator.UpdateVelocity((i / 500) % 2 ? 15.0f : -15.0f, DT).velocity;
+    test::Report("UpdateVelocity", stopwatch, calls);
+    test::Consume(sum);
+}
+
+int main() {
+    TestRestToRest();
+    TestRetarget();
+    TestVelocity();
+    Benchmark();
+    return test::Finish();
+}
@@ -0,0 +1,187 @@
+#!/usr/bin/env python3
+############################################################
+# Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+#                                                          #
+# This program is free software: you can redistribute it   #
+# and/or modify it under the terms of the GNU General      #
+# Public License as published by the Free Software         #
+# Foundation, either version 3 of the License, or (at      #
+# your option) any later version.                          #
+#                                                          #
+# This program is distributed in the hope that it will be  #
+# useful, but WITHOUT ANY WARRANTY; without even           #
+# the implied warranty of MERCHANTABILITY or FITNESS       #
+# FOR A PARTICULAR PURPOSE.  See the GNU General           #
+# Public License for more details.                         #
+#                                                          #
+# You should have received a copy of the GNU General       #
+# Public License along with this program.  If not, see     #
+# <https://www.gnu.org/licenses/>.                         #
+############################################################
+"""Decode the binary stream produced by bsp::log_deferred.
+
+Usage:
+    log_decoder.py firmware.elf /dev/ttyACM0        # live, needs pyserial
+    log_decoder.py firmware.elf capture.bin         # offline capture
+
+Every frame on the wire is
+
+    0xA5 0x5A | u8 length | payload | u8 checksum (sum of payload bytes)
+
+and every payload is
+
+    u32 format string address | u32 tick [ms] | tagged arguments ...
+
+The format string is looked up in the .elf that is running on the board. Bytes
+outside of frames (e.g. output of the regular print) are passed through as-is.
+64 bit elf files are read as well, for the host tests that link the logger into
+a non position independent executable with all format strings below 4 GiB.
+"""
+
+import re
+import struct
+import sys
+
+SOF = b"\xa5\x5a"
+
+# keep in sync with bsp::log_arg_t
+ARG_I32, ARG_U32, ARG_I64, ARG_U64, ARG_F32, ARG_F64, ARG_STR, ARG_PTR = range(1, 9)
+ARG_FORMATS = {
+    ARG_I32: "<i",
+    ARG_U32: "<I",
+    ARG_I64: "<q",
+    ARG_U64: "<Q",
+    ARG_F32: "<f",
+    ARG_F64: "<d",
+    ARG_PTR: "<I",
+}
+
+# printf length modifiers have no meaning for python % formatting
+LENGTH_MODIFIER = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(?:hh|h|ll|l|z|j|t)([diouxXcs])")
+
+
+class Elf:
+    """minimal little endian ELF reader, maps load addresses to section bytes"""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF" or self.data[4] not in (1, 2) or self.data[5] != 1:
+            raise ValueError("%s is not a little endian elf" % path)
+        if self.data[4] == 1:
+            shoff, = struct.unpack_from("<I", self.data, 0x20)
+            shentsize, shnum = struct.unpack_from("<HH", self.data, 0x2E)
+            section_format = "<IIIIII"
+        else:
+            shoff, = struct.unpack_from("<Q", self.data, 0x28)
+            shentsize, shnum = struct.unpack_from("<HH", self.data, 0x3A)
+            section_format = "<IIQQQQ"
+        self.sections = []
+        for i in range(shnum):
+            (_, sh_type, _, addr, offset, size) = struct.unpack_from(
+                section_format, self.data, shoff + i * shentsize)
+            # SHT_NOBITS (.bss) has no file content
+            if addr and size and sh_type != 8:
+                self.sections.append((addr, offset, size))
+
+    def string(self, address):
+        for addr, offset, size in self.sections:
+            if addr <= address < addr + size:
+                start = offset + address - addr
+                end = self.data.index(b"\0", start, offset + size)
+                return self.data[start:end].decode("utf-8", "replace")
+        return None
+
+
+def decode_args(payload):
+    args = []
+    i = 0
+    while i < len(payload):
+        tag = payload[i]
+        i += 1
+        if tag == ARG_STR:
+            length = payload[i]
+            args.append(payload[i + 1:i + 1 + length].decode("utf-8", "replace"))
+            i += 1 + length
+        elif tag in ARG_FORMATS:
+            fmt = ARG_FORMATS[tag]
+            args.append(struct.unpack_from(fmt, payload, i)[0])
+            i += struct.calcsize(fmt)
+        else:
+            raise ValueError("unknown argument tag %d" % tag)
+    return args
+
+
+def render(elf, payload):
+    address, tick = struct.unpack_from("<II", payload, 0)
+    args = decode_args(payload[8:])
+    if address == 0:
+        return "[%10d] <log> %d records dropped so far\r\n" % (tick, args[0])
+    fmt = elf.string(address)
+    if fmt is None:
+        return "[%10d] <log> unknown format address 0x%08x %r\r\n" % (tick, address, args)
+    fmt = LENGTH_MODIFIER.sub(r"%\1\2", fmt).replace("%p", "0x%08x")
+    try:
+        return "[%10d] %s" % (tick, fmt % tuple(args))
+    except (TypeError, ValueError):
+        return "[%10d] <log> %r %r\r\n" % (tick, fmt, args)
+
+
+def decode(elf, stream, out, live=False):
+    buffer = b""
+    while True:
+        chunk = stream.read(256)
+        if not chunk:
+            if live:
+                continue
+            break
+        buffer += chunk
+        while True:
+            start = buffer.find(SOF)
+            if start < 0:
+                # keep a trailing 0xA5 that may be the first half of the next sof
+                keep = 1 if buffer.endswith(SOF[:1]) else 0
+                out.write(buffer[:len(buffer) - keep].decode("utf-8", "replace"))
+                buffer = buffer[len(buffer) - keep:]
+                break
+            out.write(buffer[:start].decode("utf-8", "replace"))
+            buffer = buffer[start:]
+            if len(buffer) < 3 or len(buffer) < 4 + buffer[2]:
+                break
+            length = buffer[2]
+            payload = buffer[3:3 + length]
+            if length < 8 or sum(payload) & 0xFF != buffer[3 + length]:
+                # not a valid frame, treat the sof as plain text and resync
+                out.write(buffer[:1].decode("utf-8", "replace"))
+                buffer = buffer[1:]
+                continue
+            try:
+                out.write(render(elf, payload))
+            except (ValueError, IndexError, struct.error) as e:
+                out.write("<log> malformed record: %s\r\n" % e)
+            buffer = buffer[4 + length:]
+        out.flush()
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(__doc__)
+        return 1
+    elf = Elf(sys.argv[1])
+    source = sys.argv[2]
+    if source.startswith("/dev/") or source.startswith("COM"):
+        import serial
+        stream = serial.Serial(source, 115200, timeout=0.05)
+        live = True
+    else:
+        stream = open(source, "rb")
+        live = False
+    try:
+        decode(elf, stream, sys.stdout, live)
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,170 @@
+#!/usr/bin/env python3
+############################################################
+# Copyright (c) 2023-2024. BNU-HKBU UIC RoboMaster         #
+#                                                          #
+# This program is free software: you can redistribute it   #
+# and/or modify it under the terms of the GNU General      #
+# Public License as published by the Free Software         #
+# Foundation, either version 3 of the License, or (at      #
+# your option) any later version.                          #
+#                                                          #
+# This program is distributed in the hope that it will be  #
+# useful, but WITHOUT ANY WARRANTY; without even           #
+# the implied warranty of MERCHANTABILITY or FITNESS       #
+# FOR A PARTICULAR PURPOSE.  See the GNU General           #
+# Public License for more details.                         #
+#                                                          #
+# You should have received a copy of the GNU General       #
+# Public License along with this program.  If not, see     #
+# <https://www.gnu.org/licenses/>.                         #
+############################################################
+"""Receive the binary stream produced by communication::Telemetry and write it to CSV.
+
+Usage:
+    telemetry_receiver.py /dev/ttyACM0 out.csv      # live, needs pyserial
+    telemetry_receiver.py capture.bin out.csv       # offline capture
+
+Every frame on the wire is (little endian)
+
+    0x55 0xAA | u8 type | u8 payload length | payload | crc16 over everything before
+
+sample payload (type 1):  u32 sample index | u32 channel mask | values in channel id order
+schema payload (type 2):  u8 id | u8 type | u16 decimation | u32 sample period [us] | name
+
+One CSV row is written per sample. Channels that are not due in a sample because of their
+decimation are left empty. The header is written once every channel seen in the stream has been
+described by a schema frame; samples received before that are buffered.
+"""
+
+import struct
+import sys
+import time
+
+SOF = b"\x55\xaa"
+HEADER_LEN = 4
+TAIL_LEN = 2
+SAMPLE = 1
+SCHEMA = 2
+
+# keep in sync with communication::telemetry_type_t
+TYPES = ["<f", "<i", "<I", "<h", "<H", "<b", "<B"]
+
+
+def crc16(data):
+    """same crc16 as third_party/crc_check (reflected 0x1021, init 0xffff)"""
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0x8408 if crc & 1 else crc >> 1
+    return crc
+
+
+class Receiver:
+
+    def __init__(self, out):
+        self.out = out
+        self.schema = {}
+        self.columns = None
+        self.pending = []
+        self.frames = 0
+        self.errors = 0
+        self.bytes = 0
+
+    def feed(self, buffer):
+        """parse as many frames as possible, return the unconsumed tail"""
+        while True:
+            start = buffer.find(SOF)
+            if start < 0:
+                return buffer[-1:] if buffer.endswith(SOF[:1]) else b""
+            buffer = buffer[start:]
+            if len(buffer) < HEADER_LEN:
+                return buffer
+            length = HEADER_LEN + buffer[3] + TAIL_LEN
+            if len(buffer) < length:
+                return buffer
+            frame = buffer[:length]
+            if crc16(frame[:-TAIL_LEN]) != struct.unpack_from("<H", frame, length - TAIL_LEN)[0]:
+                self.errors += 1
+                buffer = buffer[1:]
+                continue
+            self.frames += 1
+            self.bytes += length
+            self.handle(frame[2], frame[HEADER_LEN:-TAIL_LEN])
+            buffer = buffer[length:]
+
+    def handle(self, frame_type, payload):
+        if frame_type == SCHEMA:
+            cid, ctype, decimation, period_us = struct.unpack_from("<BBHI", payload, 0)
+            name = payload[8:].decode("utf-8", "replace")
+            self.schema[cid] = (name, TYPES[ctype], decimation, period_us)
+        elif frame_type == SAMPLE:
+            index, mask = struct.unpack_from("<II", payload, 0)
+            self.pending.append((index, mask, payload[8:]))
+            self.flush()
+
+    def flush(self):
+        if self.columns is None:
+            seen = 0
+            for _, mask, _ in self.pending:
+                seen |= mask
+            ids = [i for i in range(32) if seen >> i & 1]
+            if any(i not in self.schema for i in ids):
+                return
+            self.columns = ids
+            self.out.write(",".join(["index", "time_s"] + [self.schema[i][0] for i in ids]) + "\n")
+        for index, mask, values in self.pending:
+            row = {}
+            offset = 0
+            for i in range(32):
+                if not mask >> i & 1:
+                    continue
+                if i not in self.schema:
+                    break  # channel added after the header was written, cannot be placed
+                fmt = self.schema[i][1]
+                row[i] = struct.unpack_from(fmt, values, offset)[0]
+                offset += struct.calcsize(fmt)
+            period_us = self.schema[self.columns[0]][3]
+            cells = [str(index), "%.6f" % (index * period_us * 1e-6)]
+            cells += ["%g" % row[i] if i in row else "" for i in self.columns]
+            self.out.write(",".join(cells) + "\n")
+        self.pending = []
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(__doc__)
+        return 1
+    source = sys.argv[1]
+    if source.startswith("/dev/") or source.startswith("COM"):
+        import serial
+        stream = serial.Serial(source, 115200, timeout=0.05)
+        live = True
+    else:
+        stream = open(source, "rb")
+        live = False
+    receiver = Receiver(open(sys.argv[2], "w"))
+    buffer = b""
+    last = time.time()
+    last_bytes = 0
+    try:
+        while True:
+            chunk = stream.read(4096)
+            if not chunk and not live:
+                break
+            buffer = receiver.feed(buffer + chunk)
+            now = time.time()
+            if live and now - last >= 1.0:
+                sys.stderr.write("%d frames, %d crc errors, %.1f kB/s\n" %
+                                 (receiver.frames, receiver.errors,
+                                  (receiver.bytes - last_bytes) / (now - last) / 1024))
+                last, last_bytes = now, receiver.bytes
+    except KeyboardInterrupt:
+        pass
+    receiver.out.close()
+    sys.stderr.write("%d frames, %d crc errors\n" % (receiver.frames, receiver.errors))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())